@@ -0,0 +1,406 @@
+/**
+  ******************************************************************************
+  * @file 		CAPTURE.c
+	* @author		SINOMCU-AE
+  * @brief 		DMA input capture time stamps, frequency and pulse analysis
+  *
+  *          This file provides the capture functions:
+  *             TIM2 CH3 latches the 32 bit HCLK time of both edges of PA2,
+  *             DMA1 Channel1 moves each CCR3 into a circular ring, so no
+  *             interrupt runs per edge;
+  *             the half and complete interrupts hand over one half of the
+  *             ring as a batch; TIM2 is 32 bit, so a modular difference of
+  *             two stamps is the interval for anything below one wrap (89s
+  *             at 48MHz), no overflow count is needed;
+  *             captures alternate rising and falling: the parity of the
+  *             ring index gives the edge, set from the pin level at a
+  *             restart, so duty needs no second channel;
+  *             a lost edge (CC3OVR) or a batch lapped by the DMA before it
+  *             was read would break the parity: the capture restarts.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "CAPTURE.h"
+#include "CLOCK_PLAN.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CAPTURE_HALF                (CAPTURE_BUF_SIZE / 2U)
+#define CAPTURE_PIN_LEVEL()         ((GPIOA->IDR >> 2) & 0x1U)
+
+/* Variables -----------------------------------------------------------------*/
+static __IO uint32_t CapBuf[CAPTURE_BUF_SIZE] STARTUP_NOINIT;
+/* 1: rising edges at odd ring indexes */
+static uint8_t RiseOdd;
+
+static uint32_t LastRise;
+static uint32_t LastFall;
+static uint8_t HaveRise;
+static uint8_t HaveFall;
+
+/* batch being summed */
+static uint32_t Periods;
+static uint64_t PeriodSum;
+static uint64_t HighSum;
+static uint32_t PeriodMin;
+static uint32_t PeriodMax;
+static uint64_t DevSum;
+/* mean period of the previous batch, 0: none */
+static uint32_t RefPeriod;
+
+/* last batch published */
+static uint8_t PubValid;
+static uint8_t PubRef;
+static uint32_t PubPeriods;
+static uint64_t PubPeriodSum;
+static uint64_t PubHighSum;
+static uint32_t PubPeriodMin;
+static uint32_t PubPeriodMax;
+static uint64_t PubDevSum;
+
+static Capture_StatsTypeDef CapStats;
+
+/**
+  * @brief Integer square root
+  * @param Value
+  * @retval floor(sqrt(Value))
+  */
+static uint32_t Capture_Sqrt(uint64_t Value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > Value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (Value >= (root + bit))
+    {
+      Value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/**
+  * @brief Clear the batch sums
+  * @param None
+  * @retval None
+  */
+static void Capture_ResetBatch(void)
+{
+  Periods = 0;
+  PeriodSum = 0;
+  HighSum = 0;
+  PeriodMin = 0xFFFFFFFFUL;
+  PeriodMax = 0;
+  DevSum = 0;
+}
+
+/**
+  * @brief Restart the ring at index 0 and take the edge parity
+  * @param None
+  * @retval None
+  * @note capture off while the DMA is reset; the level must be the same
+  *       before and after the capture is on again, or an edge came in
+  *       between and the parity is unknown: again
+  */
+static void Capture_Restart(void)
+{
+  uint32_t level;
+
+  do
+  {
+    MS32_TIM_CC_DisableChannel(TIM2, MS32_TIM_CHANNEL_CH3);
+    MS32_TIM_DisableDMAReq_CC3(TIM2);
+    MS32_DMA_DisableChannel(DMA1, CAPTURE_DMA_CHANNEL);
+    /* the CCR read drops a capture still waiting for the DMA */
+    (void)MS32_TIM_IC_GetCaptureCH3(TIM2);
+    MS32_TIM_ClearFlag_CC3OVR(TIM2);
+    MS32_DMA_SetDataLength(DMA1, CAPTURE_DMA_CHANNEL, CAPTURE_BUF_SIZE);
+    MS32_DMA_ClearFlag_HT1(DMA1);
+    MS32_DMA_ClearFlag_TC1(DMA1);
+    MS32_DMA_EnableChannel(DMA1, CAPTURE_DMA_CHANNEL);
+    MS32_TIM_EnableDMAReq_CC3(TIM2);
+    level = CAPTURE_PIN_LEVEL();
+    MS32_TIM_CC_EnableChannel(TIM2, MS32_TIM_CHANNEL_CH3);
+  } while (level != CAPTURE_PIN_LEVEL());
+
+  /* the first stamp, index 0, leaves the level read */
+  RiseOdd = (uint8_t)level;
+  HaveRise = 0;
+  HaveFall = 0;
+  RefPeriod = 0;
+  Capture_ResetBatch();
+}
+
+/**
+  * @brief Sum one half of the ring
+  * @param First index of the half, 0 or CAPTURE_HALF
+  * @retval None
+  */
+static void Capture_Batch(uint32_t First)
+{
+  uint32_t v0 = SysTick->VAL;
+  uint32_t v1;
+  uint32_t pos;
+  uint32_t i;
+  uint32_t t;
+  uint32_t period;
+  uint32_t dev;
+
+  /* the DMA must be writing the other half, before and after the read */
+  pos = CAPTURE_BUF_SIZE - MS32_DMA_GetDataLength(DMA1, CAPTURE_DMA_CHANNEL);
+  if (((pos >= CAPTURE_HALF) ? CAPTURE_HALF : 0U) == First)
+  {
+    CapStats.Overruns++;
+    Capture_Restart();
+    return;
+  }
+  if (MS32_TIM_IsActiveFlag_CC3OVR(TIM2))
+  {
+    CapStats.Overcaptures++;
+    Capture_Restart();
+    return;
+  }
+
+  for (i = First; i < (First + CAPTURE_HALF); i++)
+  {
+    t = CapBuf[i];
+    if (((i ^ RiseOdd) & 0x1U) == 0)
+    {
+      if (HaveRise)
+      {
+        period = t - LastRise;
+        Periods++;
+        PeriodSum += period;
+        if (period < PeriodMin)
+        {
+          PeriodMin = period;
+        }
+        if (period > PeriodMax)
+        {
+          PeriodMax = period;
+        }
+        if (HaveFall)
+        {
+          HighSum += LastFall - LastRise;
+        }
+        if (RefPeriod != 0)
+        {
+          dev = (period >= RefPeriod) ? (period - RefPeriod) : (RefPeriod - period);
+          if (dev > 0xFFFFU)
+          {
+            dev = 0xFFFFU;
+          }
+          DevSum += dev * dev;
+        }
+      }
+      LastRise = t;
+      HaveRise = 1;
+      HaveFall = 0;
+    }
+    else if (HaveRise)
+    {
+      LastFall = t;
+      HaveFall = 1;
+    }
+  }
+  CapStats.Edges += CAPTURE_HALF;
+
+  pos = CAPTURE_BUF_SIZE - MS32_DMA_GetDataLength(DMA1, CAPTURE_DMA_CHANNEL);
+  if (((pos >= CAPTURE_HALF) ? CAPTURE_HALF : 0U) == First)
+  {
+    CapStats.Overruns++;
+    Capture_Restart();
+    return;
+  }
+
+  if (Periods != 0)
+  {
+    PubRef = (RefPeriod != 0) ? 1U : 0U;
+    PubPeriods = Periods;
+    PubPeriodSum = PeriodSum;
+    PubHighSum = HighSum;
+    PubPeriodMin = PeriodMin;
+    PubPeriodMax = PeriodMax;
+    PubDevSum = DevSum;
+    PubValid = 1;
+    RefPeriod = (uint32_t)(PeriodSum / Periods);
+    CapStats.Batches++;
+  }
+  Capture_ResetBatch();
+
+  v1 = SysTick->VAL;
+  /* down counter, one reload at most */
+  CapStats.BatchCycles = (v0 >= v1) ? (v0 - v1) : (v0 + (SysTick->LOAD + 1U) - v1);
+  if (CapStats.BatchCycles > CapStats.BatchCyclesMax)
+  {
+    CapStats.BatchCyclesMax = CapStats.BatchCycles;
+  }
+}
+
+/**
+  * @brief Capture pin, TIM2 CH3 and the DMA ring
+  * @param None
+  * @retval None
+  * @note TIM2 is left running as found (Encoder_Init()), else started here
+  */
+void Capture_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOA);
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_DMA1);
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_TIM2);
+  /**TIM2 GPIO Configuration
+  PA2   ------> TIM2_CH3
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_2;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_NO;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_2;
+  MS32_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  /* TIM2: free running HCLK time */
+  if (!MS32_TIM_IsEnabledCounter(TIM2))
+  {
+    MS32_TIM_SetPrescaler(TIM2, 0);
+    MS32_TIM_SetAutoReload(TIM2, 0xFFFFFFFFUL);
+    MS32_TIM_GenerateEvent_UPDATE(TIM2);
+    MS32_TIM_EnableCounter(TIM2);
+  }
+  MS32_TIM_CC_DisableChannel(TIM2, MS32_TIM_CHANNEL_CH3);
+  MS32_TIM_IC_Config(TIM2, MS32_TIM_CHANNEL_CH3, MS32_TIM_ACTIVEINPUT_DIRECTTI | MS32_TIM_ICPSC_DIV1 |
+                                                 CAPTURE_FILTER | MS32_TIM_IC_POLARITY_BOTHEDGE);
+  MS32_TIM_CC_SetDMAReqTrigger(TIM2, MS32_TIM_CCDMAREQUEST_CC);
+
+  /* DMA: CCR3 into the ring, circular */
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress = (uint32_t)&TIM2->CCR3;
+  DMA_InitStruct.MemoryOrM2MDstAddress = (uint32_t)CapBuf;
+  DMA_InitStruct.Direction = MS32_DMA_DIRECTION_PERIPH_TO_MEMORY;
+  DMA_InitStruct.Mode = MS32_DMA_MODE_CIRCULAR;
+  DMA_InitStruct.PeriphOrM2MSrcIncMode = MS32_DMA_PERIPH_NOINCREMENT;
+  DMA_InitStruct.MemoryOrM2MDstIncMode = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.PeriphOrM2MSrcDataSize = MS32_DMA_PDATAALIGN_WORD;
+  DMA_InitStruct.MemoryOrM2MDstDataSize = MS32_DMA_MDATAALIGN_WORD;
+  DMA_InitStruct.NbData = CAPTURE_BUF_SIZE;
+  DMA_InitStruct.Priority = MS32_DMA_PRIORITY_HIGH;
+  MS32_DMA_DisableChannel(DMA1, CAPTURE_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, CAPTURE_DMA_CHANNEL, &DMA_InitStruct);
+
+  PubValid = 0;
+  Capture_Restart();
+
+  /* not MS32_DMA_ITConfig(): it clears the flags of every channel */
+  MS32_DMA_EnableIT_HT(DMA1, CAPTURE_DMA_CHANNEL);
+  MS32_DMA_EnableIT_TC(DMA1, CAPTURE_DMA_CHANNEL);
+  NVIC_SetPriority(DMA1_Channel1_IRQn, CAPTURE_IRQ_PRIORITY);
+  NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+}
+
+/**
+  * @brief Result of the last batch
+  * @param Result pointer to a Capture_ResultTypeDef structure
+  * @retval SUCCESS, ERROR: no batch with a whole period yet
+  */
+ErrorStatus Capture_GetResult(Capture_ResultTypeDef *Result)
+{
+  uint8_t ref;
+  uint32_t periods;
+  uint64_t sum;
+  uint64_t high;
+  uint64_t dev;
+  uint32_t timclk = ClockPlan_TimClkHz();
+
+  __disable_irq();
+  if (!PubValid)
+  {
+    __enable_irq();
+    return ERROR;
+  }
+  ref = PubRef;
+  periods = PubPeriods;
+  sum = PubPeriodSum;
+  high = PubHighSum;
+  dev = PubDevSum;
+  Result->PeriodMin = PubPeriodMin;
+  Result->PeriodMax = PubPeriodMax;
+  __enable_irq();
+
+  /* divisions here, not in the interrupt */
+  Result->Periods = periods;
+  Result->TickHz = timclk;
+  Result->FreqMilliHz = (uint32_t)(((uint64_t)timclk * 1000U * periods) / sum);
+  Result->DutyBp = (uint16_t)((high * 10000U) / sum);
+  Result->JitterRms = ref ? Capture_Sqrt(dev / periods) : 0U;
+  return SUCCESS;
+}
+
+/**
+  * @brief Read the capture statistics
+  * @param Stats pointer to a Capture_StatsTypeDef structure
+  * @retval None
+  */
+void Capture_GetStats(Capture_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = CapStats;
+  __enable_irq();
+}
+
+/**
+  * @brief DMA half / complete: one batch
+  * @param None
+  * @retval None
+  * @note call by DMA1_Channel1_IRQHandler()
+  */
+void Capture_DMA_IRQHandler(void)
+{
+  /* both halves waiting: a half was lapped, and after a complete the new
+     first half would be summed before the older second one */
+  if (MS32_DMA_IsActiveFlag_HT1(DMA1) && MS32_DMA_IsActiveFlag_TC1(DMA1))
+  {
+    CapStats.Overruns++;
+    Capture_Restart();
+    return;
+  }
+  if (MS32_DMA_IsActiveFlag_HT1(DMA1))
+  {
+    MS32_DMA_ClearFlag_HT1(DMA1);
+    Capture_Batch(0);
+  }
+  if (MS32_DMA_IsActiveFlag_TC1(DMA1))
+  {
+    MS32_DMA_ClearFlag_TC1(DMA1);
+    Capture_Batch(CAPTURE_HALF);
+  }
+}
+
+/******************************** END OF FILE *********************************/
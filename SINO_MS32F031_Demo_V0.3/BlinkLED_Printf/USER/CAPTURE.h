@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    CAPTURE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of CAPTURE.c file.
+  *
+  *          Input capture time stamps by circular DMA:
+  *             PA2   ------> TIM2_CH3 (AF2), both edges
+  *             TIM2 CCR3, 32 bit HCLK time  ------> DMA1 Channel1, circular,
+  *                                                  CAPTURE_BUF_SIZE words
+  *             DMA half / complete          ------> batch: frequency, duty,
+  *                                                  period min / max / rms
+  *          TIM2 runs free, shared with ENCODER: call Encoder_Init() first.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Time stamps in the DMA ring, even; a batch is half of it */
+#define CAPTURE_BUF_SIZE            64U
+/* Digital filter of the input */
+#define CAPTURE_FILTER              MS32_TIM_IC_FILTER_FDIV1
+
+#define CAPTURE_DMA_CHANNEL         MS32_DMA_CHANNEL_1
+#define CAPTURE_IRQ_PRIORITY        0x1U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t FreqMilliHz;
+  uint16_t DutyBp;          /* high time, 0.01% */
+  uint32_t Periods;         /* rising to rising, in the batch */
+  uint32_t PeriodMin;       /* timer clocks */
+  uint32_t PeriodMax;
+  uint32_t JitterRms;       /* timer clocks, period against the mean of the
+                               previous batch, 0 in the first */
+  uint32_t TickHz;          /* timer clock */
+} Capture_ResultTypeDef;
+
+typedef struct
+{
+  uint32_t Edges;           /* time stamps taken from the ring */
+  uint32_t Batches;         /* published */
+  uint32_t Overcaptures;    /* edge lost before DMA read CCR3 */
+  uint32_t Overruns;        /* DMA lapped a batch still being read */
+  uint32_t BatchCycles;     /* last batch, HCLK cycles */
+  uint32_t BatchCyclesMax;
+} Capture_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void Capture_Init(void);
+ErrorStatus Capture_GetResult(Capture_ResultTypeDef *Result);
+void Capture_GetStats(Capture_StatsTypeDef *Stats);
+
+void Capture_DMA_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+#if ((CAPTURE_BUF_SIZE & 1U) != 0) || (CAPTURE_BUF_SIZE < 4U)
+#error "CAPTURE_BUF_SIZE must be even, 4 at least"
+#endif
+
+#endif /* __CAPTURE_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,209 @@
+/**
+  ******************************************************************************
+  * @file 		CLOCK_CSS.c
+	* @author		SINOMCU-AE
+  * @brief 		HSE failover and recovery on the clock security system
+  *
+  *          This file provides the HSE supervision state machine:
+  *             the CSS is armed once HSE runs; on a failure the hardware
+  *             puts SYSCLK on HSI and raises the NMI, which moves
+  *             CLOCK_SCALE to the backup profile and re-times the
+  *             registered peripherals;
+  *             ClockCss_Poll() restarts HSE every CLOCK_CSS_RETRY_MS with
+  *             the CSS off (no NMI on a crystal that does not start);
+  *             after CLOCK_CSS_STABLE_MS of HSERDY the CSS is armed again
+  *             and CLOCK_SCALE goes back to the planned clock.
+  *
+  *          A HSE missing at reset (SystemInit() timeout) counts as a
+  *          failover from ClockCss_Init().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "CLOCK_CSS.h"
+#include "CLOCK_SCALE.h"
+#include "SysTick_Delay.h"
+
+/* Variables -----------------------------------------------------------------*/
+static __IO uint8_t State = CLOCK_CSS_OFF;
+static uint32_t DownTick;
+static uint32_t RetryTick;
+static uint32_t ReadyTick;
+static uint8_t Ready;
+
+static ClockCss_StatsTypeDef CssStats;
+
+/**
+  * @brief Enter CLOCK_CSS_DOWN
+  * @param None
+  * @retval None
+  */
+static void ClockCss_Down(void)
+{
+  DownTick = SysTick_GetTick();
+  RetryTick = DownTick;
+  CssStats.Failovers++;
+  State = CLOCK_CSS_DOWN;
+}
+
+/**
+  * @brief Arm the CSS on a running HSE, or fail over when it did not start
+  * @param None
+  * @retval None
+  * @note call after SysTick_Init(); does nothing with a HSI plan
+  */
+void ClockCss_Init(void)
+{
+#if CLOCK_PLAN_SOURCE != 0
+  if ((RCC->CR & RCC_CR_HSERDY) != 0)
+  {
+    MS32_RCC_ClearFlag_HSECSS();
+    MS32_RCC_HSE_EnableCSS();
+    State = CLOCK_CSS_ARMED;
+    return;
+  }
+
+  /* SystemInit() gave up on HSE and stayed on HSI */
+  RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+  __disable_irq();
+  ClockScale_Failover();
+  __enable_irq();
+  ClockCss_Down();
+#endif
+}
+
+/**
+  * @brief HSE restart and recovery, call periodically
+  * @param None
+  * @retval None
+  * @note the timing follows the call period: a 200ms poll gives
+  *       200ms steps to CLOCK_CSS_STARTUP_MS and CLOCK_CSS_STABLE_MS
+  */
+void ClockCss_Poll(void)
+{
+#if CLOCK_PLAN_SOURCE != 0
+  uint32_t now = SysTick_GetTick();
+  uint32_t down;
+
+  if (State == CLOCK_CSS_DOWN)
+  {
+    if ((now - RetryTick) >= CLOCK_CSS_RETRY_MS)
+    {
+      RetryTick = now;
+      Ready = 0;
+      CssStats.Retries++;
+      RCC->CR |= CLOCK_PLAN_CR_HSE;
+      State = CLOCK_CSS_PROBE;
+    }
+    return;
+  }
+  if (State != CLOCK_CSS_PROBE)
+  {
+    return;
+  }
+
+  if ((RCC->CR & RCC_CR_HSERDY) == 0)
+  {
+    /* not started in time, or lost again */
+    if (Ready || ((now - RetryTick) >= CLOCK_CSS_STARTUP_MS))
+    {
+      RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+      State = CLOCK_CSS_DOWN;
+    }
+    return;
+  }
+  if (!Ready)
+  {
+    Ready = 1;
+    ReadyTick = now;
+    return;
+  }
+  if ((now - ReadyTick) < CLOCK_CSS_STABLE_MS)
+  {
+    return;
+  }
+
+  down = now - DownTick;
+  CssStats.LastDownMs = down;
+  CssStats.TotalDownMs += down;
+  CssStats.Restores++;
+  /* armed before the switch: a failure from here on is a new failover */
+  State = CLOCK_CSS_ARMED;
+  MS32_RCC_ClearFlag_HSECSS();
+  MS32_RCC_HSE_EnableCSS();
+  if (ClockScale_Get() == CLOCK_SCALE_BACKUP)
+  {
+    ClockScale_Set(CLOCK_SCALE_HIGH);
+  }
+#endif
+}
+
+/**
+  * @brief Supervision state
+  * @param None
+  * @retval CLOCK_CSS_OFF, CLOCK_CSS_ARMED, CLOCK_CSS_DOWN or CLOCK_CSS_PROBE
+  */
+uint8_t ClockCss_GetState(void)
+{
+  return State;
+}
+
+/**
+  * @brief Read the failover statistics
+  * @param Stats pointer to a ClockCss_StatsTypeDef structure
+  * @retval None
+  * @note the NMI is not masked: read twice when it matters
+  */
+void ClockCss_GetStats(ClockCss_StatsTypeDef *Stats)
+{
+  *Stats = CssStats;
+}
+
+/**
+  * @brief HSE lost: move to the backup clock, ClockCss_Poll() restarts HSE
+  * @param None
+  * @retval None
+  * @note call with interrupts disabled, SYSCLK on HSI and HSE off: by the
+  *       NMI, or by POWER_MGR when HSE does not restart after STOP
+  */
+void ClockCss_Failover(void)
+{
+  uint32_t start;
+
+  start = SysTick_GetUs();
+  ClockScale_Failover();
+  CssStats.LastFailoverUs = SysTick_GetUs() - start;
+  ClockCss_Down();
+}
+
+/**
+  * @brief CSS failover
+  * @param None
+  * @retval None
+  * @note call by NMI_Handler()
+  */
+void ClockCss_NMI_IRQHandler(void)
+{
+  if (!MS32_RCC_IsActiveFlag_HSECSS())
+  {
+    return;
+  }
+  MS32_RCC_ClearFlag_HSECSS();
+  /* the CSS is off again with HSE; re-armed by ClockCss_Poll() */
+  MS32_RCC_HSE_DisableCSS();
+  ClockCss_Failover();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    CLOCK_CSS.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of CLOCK_CSS.c file.
+  *
+  *          HSE supervision with the clock security system (CSS):
+  *             HSE fails   ------> NMI, CLOCK_SCALE_BACKUP (HSI PLL) and
+  *                                 the CLOCK_SCALE POST callbacks
+  *             HSE down    ------> restarted every CLOCK_CSS_RETRY_MS
+  *             HSE back    ------> ready for CLOCK_CSS_STABLE_MS, then the
+  *                                 planned clock and the CSS again
+  *          Only with an HSE plan (CLOCK_PLAN_SOURCE 1 or 2).
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_CSS_H
+#define __CLOCK_CSS_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "CLOCK_PLAN.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* HSE restart period while it is down */
+#define CLOCK_CSS_RETRY_MS          1000U
+/* HSERDY expected within this time of a restart */
+#define CLOCK_CSS_STARTUP_MS        20U
+/* HSERDY held this long before HSE is used again */
+#define CLOCK_CSS_STABLE_MS         100U
+
+/* States */
+#define CLOCK_CSS_OFF               0U      /* HSI plan, or not initialized */
+#define CLOCK_CSS_ARMED             1U      /* HSE running, CSS on */
+#define CLOCK_CSS_DOWN              2U      /* HSE failed, waiting for the next restart */
+#define CLOCK_CSS_PROBE             3U      /* HSE restarted, checking it */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Failovers;       /* CSS NMI, HSE missing at ClockCss_Init() or after STOP */
+  uint32_t Restores;        /* HSE back in use */
+  uint32_t Retries;         /* HSE restarts */
+  uint32_t LastFailoverUs;  /* NMI entry to the backup clock, callbacks included */
+  uint32_t LastDownMs;      /* failover to restore */
+  uint32_t TotalDownMs;
+} ClockCss_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void ClockCss_Init(void);
+void ClockCss_Poll(void);
+uint8_t ClockCss_GetState(void);
+void ClockCss_GetStats(ClockCss_StatsTypeDef *Stats);
+void ClockCss_Failover(void);
+
+void ClockCss_NMI_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __CLOCK_CSS_H */
+
+/******************************** END OF FILE *********************************/
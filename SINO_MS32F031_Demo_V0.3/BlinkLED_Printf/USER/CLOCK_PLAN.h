@@ -0,0 +1,259 @@
+/**
+  ******************************************************************************
+  * @file    CLOCK_PLAN.h
+  * @author  SINOMCU-AE
+  * @brief   Compile-time clock tree planner for RCC / PLL / FLASH.
+  *
+  *          Set the clock source and the SYSCLK / HCLK / PCLK targets; the
+  *          PLL multiplier, HSE predivider, AHB / APB prescalers and flash
+  *          latency are derived here and packed into the final RCC_CFGR,
+  *          RCC_CFGR2 and FLASH_ACR values used by SystemInit(). A target
+  *          that the clock tree cannot produce exactly stops the build with
+  *          #error.
+  *
+  *          Clock tree:
+  *             HSI(8MHz) / 2          ---+
+  *                                       +--> PLL x2~x16 (16~48MHz)
+  *             HSE(4~32MHz) / PREDIV  ---+
+  *             SYSCLK = HSI, HSE or PLL, 48MHz max
+  *             HCLK = SYSCLK / 1,2,4,8,16,64,128,256,512
+  *             PCLK = HCLK / 1,2,4,8,16
+  *             flash: 0 wait state up to 24MHz SYSCLK, 1 above
+  *
+  *          Examples, HSI:
+  *             SYSCLK 48MHz  ------> PLLMUL 12, RCC_CFGR 0x00280000
+  *             SYSCLK 24MHz  ------> PLLMUL 6,  RCC_CFGR 0x00100000
+  *             SYSCLK 8MHz   ------> HSI direct, no PLL
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_PLAN_H
+#define __CLOCK_PLAN_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* 0: HSI, 1: HSE crystal, 2: HSE bypass (external clock), at HSE_VALUE */
+#ifndef CLOCK_PLAN_SOURCE
+#define CLOCK_PLAN_SOURCE           0
+#endif
+#ifndef CLOCK_PLAN_SYSCLK_HZ
+#define CLOCK_PLAN_SYSCLK_HZ        48000000UL
+#endif
+#ifndef CLOCK_PLAN_HCLK_HZ
+#define CLOCK_PLAN_HCLK_HZ          CLOCK_PLAN_SYSCLK_HZ
+#endif
+#ifndef CLOCK_PLAN_PCLK_HZ
+#define CLOCK_PLAN_PCLK_HZ          CLOCK_PLAN_HCLK_HZ
+#endif
+/* HSERDY polls before SystemInit() gives up and stays on HSI */
+#ifndef CLOCK_PLAN_HSE_TIMEOUT
+#define CLOCK_PLAN_HSE_TIMEOUT      0x5000U
+#endif
+
+/* Device limits */
+#define CLOCK_PLAN_SYSCLK_MAX       48000000UL
+#define CLOCK_PLAN_PLL_OUT_MIN      16000000UL
+#define CLOCK_PLAN_PLL_OUT_MAX      48000000UL
+#define CLOCK_PLAN_HSE_MIN          4000000UL
+#define CLOCK_PLAN_HSE_MAX          32000000UL
+#define CLOCK_PLAN_LATENCY1_FREQ    24000000UL
+
+/* Source and PLL ------------------------------------------------------------*/
+#if CLOCK_PLAN_SOURCE == 0
+#define CLOCK_PLAN_SOURCE_HZ        HSI_VALUE
+#else
+#define CLOCK_PLAN_SOURCE_HZ        HSE_VALUE
+#endif
+
+#if CLOCK_PLAN_SYSCLK_HZ == CLOCK_PLAN_SOURCE_HZ
+/* SYSCLK straight from the oscillator, PLL off */
+#define CLOCK_PLAN_USE_PLL          0
+#define CLOCK_PLAN_PREDIV           1
+#define CLOCK_PLAN_PLLMUL           1
+#define CLOCK_PLAN_PLL_IN_HZ        CLOCK_PLAN_SOURCE_HZ
+#elif CLOCK_PLAN_SOURCE == 0
+/* HSI reaches the PLL through a fixed /2 */
+#define CLOCK_PLAN_USE_PLL          1
+#define CLOCK_PLAN_PREDIV           1
+#define CLOCK_PLAN_PLL_IN_HZ        (CLOCK_PLAN_SOURCE_HZ / 2U)
+#define CLOCK_PLAN_PLLMUL           (CLOCK_PLAN_SYSCLK_HZ / CLOCK_PLAN_PLL_IN_HZ)
+#else
+/* HSE: smallest predivider (highest PLL input) giving an exact multiplier */
+#define CLOCK_PLAN_DIV_FITS(D) \
+        ((((CLOCK_PLAN_SYSCLK_HZ * (D)) % CLOCK_PLAN_SOURCE_HZ) == 0U) && \
+         (((CLOCK_PLAN_SYSCLK_HZ * (D)) / CLOCK_PLAN_SOURCE_HZ) >= 2U) && \
+         (((CLOCK_PLAN_SYSCLK_HZ * (D)) / CLOCK_PLAN_SOURCE_HZ) <= 16U))
+#define CLOCK_PLAN_USE_PLL          1
+#define CLOCK_PLAN_PREDIV \
+        (CLOCK_PLAN_DIV_FITS(1)  ? 1  : CLOCK_PLAN_DIV_FITS(2)  ? 2  : \
+         CLOCK_PLAN_DIV_FITS(3)  ? 3  : CLOCK_PLAN_DIV_FITS(4)  ? 4  : \
+         CLOCK_PLAN_DIV_FITS(5)  ? 5  : CLOCK_PLAN_DIV_FITS(6)  ? 6  : \
+         CLOCK_PLAN_DIV_FITS(7)  ? 7  : CLOCK_PLAN_DIV_FITS(8)  ? 8  : \
+         CLOCK_PLAN_DIV_FITS(9)  ? 9  : CLOCK_PLAN_DIV_FITS(10) ? 10 : \
+         CLOCK_PLAN_DIV_FITS(11) ? 11 : CLOCK_PLAN_DIV_FITS(12) ? 12 : \
+         CLOCK_PLAN_DIV_FITS(13) ? 13 : CLOCK_PLAN_DIV_FITS(14) ? 14 : \
+         CLOCK_PLAN_DIV_FITS(15) ? 15 : CLOCK_PLAN_DIV_FITS(16) ? 16 : 0)
+#define CLOCK_PLAN_PLL_IN_HZ        (CLOCK_PLAN_SOURCE_HZ / CLOCK_PLAN_PREDIV)
+#define CLOCK_PLAN_PLLMUL           ((CLOCK_PLAN_SYSCLK_HZ * CLOCK_PLAN_PREDIV) / CLOCK_PLAN_SOURCE_HZ)
+#endif
+
+/* Bus prescalers ------------------------------------------------------------*/
+#define CLOCK_PLAN_AHB_DIV          (CLOCK_PLAN_SYSCLK_HZ / CLOCK_PLAN_HCLK_HZ)
+#define CLOCK_PLAN_APB_DIV          (CLOCK_PLAN_HCLK_HZ / CLOCK_PLAN_PCLK_HZ)
+/* Timer kernel clock: PCLK, doubled when the APB prescaler is not 1 */
+#define CLOCK_PLAN_TIMCLK_HZ        ((CLOCK_PLAN_APB_DIV == 1U) ? CLOCK_PLAN_PCLK_HZ : (2U * CLOCK_PLAN_PCLK_HZ))
+
+#define CLOCK_PLAN_HPRE \
+        ((CLOCK_PLAN_AHB_DIV == 1U)   ? RCC_CFGR_HPRE_DIV1   : \
+         (CLOCK_PLAN_AHB_DIV == 2U)   ? RCC_CFGR_HPRE_DIV2   : \
+         (CLOCK_PLAN_AHB_DIV == 4U)   ? RCC_CFGR_HPRE_DIV4   : \
+         (CLOCK_PLAN_AHB_DIV == 8U)   ? RCC_CFGR_HPRE_DIV8   : \
+         (CLOCK_PLAN_AHB_DIV == 16U)  ? RCC_CFGR_HPRE_DIV16  : \
+         (CLOCK_PLAN_AHB_DIV == 64U)  ? RCC_CFGR_HPRE_DIV64  : \
+         (CLOCK_PLAN_AHB_DIV == 128U) ? RCC_CFGR_HPRE_DIV128 : \
+         (CLOCK_PLAN_AHB_DIV == 256U) ? RCC_CFGR_HPRE_DIV256 : RCC_CFGR_HPRE_DIV512)
+#define CLOCK_PLAN_PPRE \
+        ((CLOCK_PLAN_APB_DIV == 1U)   ? RCC_CFGR_PPRE_DIV1   : \
+         (CLOCK_PLAN_APB_DIV == 2U)   ? RCC_CFGR_PPRE_DIV2   : \
+         (CLOCK_PLAN_APB_DIV == 4U)   ? RCC_CFGR_PPRE_DIV4   : \
+         (CLOCK_PLAN_APB_DIV == 8U)   ? RCC_CFGR_PPRE_DIV8   : RCC_CFGR_PPRE_DIV16)
+
+/* Final register values -----------------------------------------------------*/
+#if CLOCK_PLAN_SOURCE == 0
+#define CLOCK_PLAN_PLLSRC           RCC_CFGR_PLLSRC_HSI_DIV2
+#else
+#define CLOCK_PLAN_PLLSRC           RCC_CFGR_PLLSRC_HSE_PREDIV
+#endif
+
+#if CLOCK_PLAN_USE_PLL
+#define CLOCK_PLAN_SW               RCC_CFGR_SW_PLL
+#define CLOCK_PLAN_SWS              RCC_CFGR_SWS_PLL
+#define CLOCK_PLAN_CFGR_PLL \
+        (CLOCK_PLAN_PLLSRC | (((uint32_t)CLOCK_PLAN_PLLMUL - 2U) << RCC_CFGR_PLLMUL_Pos))
+#elif CLOCK_PLAN_SOURCE == 0
+#define CLOCK_PLAN_SW               RCC_CFGR_SW_HSI
+#define CLOCK_PLAN_SWS              RCC_CFGR_SWS_HSI
+#define CLOCK_PLAN_CFGR_PLL         0U
+#else
+#define CLOCK_PLAN_SW               RCC_CFGR_SW_HSE
+#define CLOCK_PLAN_SWS              RCC_CFGR_SWS_HSE
+#define CLOCK_PLAN_CFGR_PLL         0U
+#endif
+
+/* RCC_CFGR without SW: PLL and prescalers, written while HSI still runs SYSCLK */
+#define CLOCK_PLAN_CFGR             (CLOCK_PLAN_CFGR_PLL | CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE)
+#define CLOCK_PLAN_CFGR2            ((uint32_t)CLOCK_PLAN_PREDIV - 1U)
+#if CLOCK_PLAN_SYSCLK_HZ > CLOCK_PLAN_LATENCY1_FREQ
+#define CLOCK_PLAN_ACR              (FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY)
+#else
+#define CLOCK_PLAN_ACR              FLASH_ACR_PRFTBE
+#endif
+#if CLOCK_PLAN_SOURCE == 2
+#define CLOCK_PLAN_CR_HSE           (RCC_CR_HSEON | RCC_CR_HSEBYP)
+#elif CLOCK_PLAN_SOURCE == 1
+#define CLOCK_PLAN_CR_HSE           RCC_CR_HSEON
+#else
+#define CLOCK_PLAN_CR_HSE           0U
+#endif
+
+/* Backup plan, clock security system failover (CLOCK_SCALE_BACKUP) -----------*/
+/* HSI / 2 PLL nearest to CLOCK_PLAN_SYSCLK_HZ within the PLL output range,
+   exact when the plan is a multiple of 4MHz; prescalers as planned */
+#define CLOCK_PLAN_BACKUP_PLLMUL_NEAR \
+        ((CLOCK_PLAN_SYSCLK_HZ + (HSI_VALUE / 4U)) / (HSI_VALUE / 2U))
+#define CLOCK_PLAN_BACKUP_PLLMUL \
+        ((CLOCK_PLAN_BACKUP_PLLMUL_NEAR < (CLOCK_PLAN_PLL_OUT_MIN / (HSI_VALUE / 2U))) ? \
+         (CLOCK_PLAN_PLL_OUT_MIN / (HSI_VALUE / 2U)) : \
+         (CLOCK_PLAN_BACKUP_PLLMUL_NEAR > (CLOCK_PLAN_PLL_OUT_MAX / (HSI_VALUE / 2U))) ? \
+         (CLOCK_PLAN_PLL_OUT_MAX / (HSI_VALUE / 2U)) : CLOCK_PLAN_BACKUP_PLLMUL_NEAR)
+#define CLOCK_PLAN_BACKUP_SYSCLK_HZ ((HSI_VALUE / 2U) * CLOCK_PLAN_BACKUP_PLLMUL)
+#define CLOCK_PLAN_BACKUP_CFGR_PLL \
+        (RCC_CFGR_PLLSRC_HSI_DIV2 | (((uint32_t)CLOCK_PLAN_BACKUP_PLLMUL - 2U) << RCC_CFGR_PLLMUL_Pos))
+#if CLOCK_PLAN_BACKUP_SYSCLK_HZ > CLOCK_PLAN_LATENCY1_FREQ
+#define CLOCK_PLAN_BACKUP_ACR       (FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY)
+#else
+#define CLOCK_PLAN_BACKUP_ACR       FLASH_ACR_PRFTBE
+#endif
+
+/* Static validation ---------------------------------------------------------*/
+#if (CLOCK_PLAN_SOURCE < 0) || (CLOCK_PLAN_SOURCE > 2)
+#error "CLOCK_PLAN_SOURCE: 0 HSI, 1 HSE, 2 HSE bypass"
+#endif
+#if (CLOCK_PLAN_SOURCE != 0) && ((HSE_VALUE < CLOCK_PLAN_HSE_MIN) || (HSE_VALUE > CLOCK_PLAN_HSE_MAX))
+#error "HSE_VALUE out of the 4~32MHz oscillator range"
+#endif
+#if (CLOCK_PLAN_SYSCLK_HZ == 0) || (CLOCK_PLAN_SYSCLK_HZ > CLOCK_PLAN_SYSCLK_MAX)
+#error "CLOCK_PLAN_SYSCLK_HZ above 48MHz"
+#endif
+#if CLOCK_PLAN_USE_PLL
+#if CLOCK_PLAN_PREDIV == 0
+#error "CLOCK_PLAN_SYSCLK_HZ cannot be made from HSE_VALUE with PREDIV 1~16 and PLLMUL 2~16"
+#elif (CLOCK_PLAN_SYSCLK_HZ % CLOCK_PLAN_PLL_IN_HZ) != 0
+#error "CLOCK_PLAN_SYSCLK_HZ is not a multiple of the PLL input (HSI / 2)"
+#elif (CLOCK_PLAN_PLLMUL < 2) || (CLOCK_PLAN_PLLMUL > 16)
+#error "PLL multiplier out of 2~16"
+#elif (CLOCK_PLAN_SYSCLK_HZ < CLOCK_PLAN_PLL_OUT_MIN) || (CLOCK_PLAN_SYSCLK_HZ > CLOCK_PLAN_PLL_OUT_MAX)
+#error "PLL output out of 16~48MHz"
+#elif (CLOCK_PLAN_PLL_IN_HZ * CLOCK_PLAN_PLLMUL) != CLOCK_PLAN_SYSCLK_HZ
+/* the same formula as SystemCoreClockUpdate() */
+#error "PLL plan does not give CLOCK_PLAN_SYSCLK_HZ"
+#endif
+#endif
+#if (CLOCK_PLAN_HCLK_HZ == 0) || ((CLOCK_PLAN_SYSCLK_HZ % CLOCK_PLAN_HCLK_HZ) != 0) || \
+    ((CLOCK_PLAN_AHB_DIV != 1) && (CLOCK_PLAN_AHB_DIV != 2) && (CLOCK_PLAN_AHB_DIV != 4) && \
+     (CLOCK_PLAN_AHB_DIV != 8) && (CLOCK_PLAN_AHB_DIV != 16) && (CLOCK_PLAN_AHB_DIV != 64) && \
+     (CLOCK_PLAN_AHB_DIV != 128) && (CLOCK_PLAN_AHB_DIV != 256) && (CLOCK_PLAN_AHB_DIV != 512))
+#error "CLOCK_PLAN_HCLK_HZ must be SYSCLK / 1,2,4,8,16,64,128,256,512"
+#endif
+#if (CLOCK_PLAN_PCLK_HZ == 0) || ((CLOCK_PLAN_HCLK_HZ % CLOCK_PLAN_PCLK_HZ) != 0) || \
+    ((CLOCK_PLAN_APB_DIV != 1) && (CLOCK_PLAN_APB_DIV != 2) && (CLOCK_PLAN_APB_DIV != 4) && \
+     (CLOCK_PLAN_APB_DIV != 8) && (CLOCK_PLAN_APB_DIV != 16))
+#error "CLOCK_PLAN_PCLK_HZ must be HCLK / 1,2,4,8,16"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+/**
+  * @brief PCLK of the running clock tree: HCLK over the live APB prescaler
+  * @param None
+  * @retval Hz
+  * @note follows CLOCK_SCALE changes as long as SystemCoreClock is current
+  */
+__STATIC_INLINE uint32_t ClockPlan_PclkHz(void)
+{
+  return SystemCoreClock >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE) >> RCC_CFGR_PPRE_Pos];
+}
+
+/**
+  * @brief Timer kernel clock of the running clock tree, the run time
+  *        CLOCK_PLAN_TIMCLK_HZ: PCLK, doubled when the APB prescaler is not 1
+  * @param None
+  * @retval Hz
+  */
+__STATIC_INLINE uint32_t ClockPlan_TimClkHz(void)
+{
+  return (RCC->CFGR & RCC_CFGR_PPRE_2) ? (2U * ClockPlan_PclkHz()) : ClockPlan_PclkHz();
+}
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __CLOCK_PLAN_H */
+
+/******************************** END OF FILE *********************************/
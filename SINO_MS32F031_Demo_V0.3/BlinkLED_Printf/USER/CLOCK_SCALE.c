@@ -0,0 +1,346 @@
+/**
+  ******************************************************************************
+  * @file 		CLOCK_SCALE.c
+	* @author		SINOMCU-AE
+  * @brief 		Runtime SYSCLK scaling between HSI and the planned PLL clock
+  *
+  *          This file provides the profile switch:
+  *             up:   PLL locks while HSI still runs the core, then with
+  *                   interrupts off the flash latency goes up before SW
+  *                   selects the PLL;
+  *             down: SW selects HSI first, the flash latency goes down
+  *                   after, then the PLL is stopped, and with a HSE plan
+  *                   the crystal too (leaving LOW starts it and waits for
+  *                   HSERDY before the PLL);
+  *             SystemCoreClock and the SysTick reload follow (tick phase
+  *             kept, see SysTick_Retime()), then the POST callbacks run
+  *             before interrupts come back;
+  *             failover: the clock security system has already put SYSCLK
+  *                   on HSI, the backup PLL is started from HSI / 2 and only
+  *                   the POST callbacks run. Leaving the backup profile goes
+  *                   through HSI, the PLL source changes.
+  *
+  *          Switch time, measured on the SysTick microsecond count, is kept
+  *          in the statistics; the blackout is the interrupts disabled part.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "CLOCK_SCALE.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CLOCK_SCALE_BUS_MASK        (RCC_CFGR_SW | RCC_CFGR_HPRE | RCC_CFGR_PPRE)
+#define CLOCK_SCALE_PLL_MASK        (RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE | RCC_CFGR_PLLMUL)
+
+/* Variables -----------------------------------------------------------------*/
+static ClockScale_Callback Callbacks[CLOCK_SCALE_MAX_CALLBACKS];
+static uint8_t CallbackCount;
+/* SystemInit() starts on the planned clock */
+static uint8_t Profile = CLOCK_SCALE_HIGH;
+/* ClockScale_Set() running, a failover NMI waits for its end */
+static __IO uint8_t Busy;
+static __IO uint8_t FailoverPending;
+/* HSE stopped on entering CLOCK_SCALE_LOW, started again on leaving it */
+static uint8_t HseStopped;
+
+static ClockScale_StatsTypeDef ScaleStats;
+
+/**
+  * @brief Call every registered callback
+  * @param Phase CLOCK_SCALE_PRE or CLOCK_SCALE_POST
+  * @param Sysclk SYSCLK of the new profile in Hz
+  * @retval None
+  */
+static void ClockScale_Notify(uint8_t Phase, uint32_t Sysclk)
+{
+  uint8_t i;
+
+  for (i = 0; i < CallbackCount; i++)
+  {
+    Callbacks[i](Phase, Sysclk);
+  }
+}
+
+/**
+  * @brief Register a re-timing callback
+  * @param Callback called around every profile switch, in register order
+  * @retval SUCCESS, ERROR table full
+  */
+ErrorStatus ClockScale_Register(ClockScale_Callback Callback)
+{
+  if (CallbackCount >= CLOCK_SCALE_MAX_CALLBACKS)
+  {
+    return ERROR;
+  }
+  Callbacks[CallbackCount++] = Callback;
+  return SUCCESS;
+}
+
+/**
+  * @brief Profile switch, ClockScale_Set() body
+  * @param NewProfile CLOCK_SCALE_LOW or CLOCK_SCALE_HIGH
+  * @retval SUCCESS, ERROR HSE not ready or PLL did not lock (clock left on HSI)
+  */
+static ErrorStatus ClockScale_Switch(uint8_t NewProfile)
+{
+  uint32_t start;
+  uint32_t lock;
+  uint32_t off;
+  uint32_t elapsed;
+  uint32_t sysclk;
+  uint32_t hclk;
+  uint8_t hse_started = 0;
+
+  if (NewProfile == Profile)
+  {
+    return SUCCESS;
+  }
+  /* the backup profile is only entered by ClockScale_Failover() */
+  if (NewProfile == CLOCK_SCALE_BACKUP)
+  {
+    return ERROR;
+  }
+#if CLOCK_PLAN_SOURCE != 0
+  if ((NewProfile == CLOCK_SCALE_HIGH) && !HseStopped && ((RCC->CR & RCC_CR_HSERDY) == 0))
+  {
+    ScaleStats.PllFails++;
+    return ERROR;
+  }
+#endif
+  /* the running PLL is on HSI / 2: stop it on HSI before it is set up again */
+  if ((Profile == CLOCK_SCALE_BACKUP) && (NewProfile == CLOCK_SCALE_HIGH) &&
+      (ClockScale_Switch(CLOCK_SCALE_LOW) != SUCCESS))
+  {
+    return ERROR;
+  }
+  start = SysTick_GetUs();
+#if CLOCK_PLAN_SOURCE != 0
+  if ((NewProfile == CLOCK_SCALE_HIGH) && HseStopped)
+  {
+    /* before the PRE phase: nothing to undo when the crystal does not start */
+    RCC->CR |= CLOCK_PLAN_CR_HSE;
+    while ((RCC->CR & RCC_CR_HSERDY) == 0)
+    {
+      if ((SysTick_GetUs() - start) > CLOCK_SCALE_HSE_TIMEOUT_US)
+      {
+        RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+        ScaleStats.PllFails++;
+        return ERROR;
+      }
+    }
+    HseStopped = 0;
+    hse_started = 1;
+  }
+#endif
+  sysclk = (NewProfile == CLOCK_SCALE_HIGH) ? CLOCK_PLAN_SYSCLK_HZ : HSI_VALUE;
+  hclk = (NewProfile == CLOCK_SCALE_HIGH) ? CLOCK_PLAN_HCLK_HZ : HSI_VALUE;
+
+  ClockScale_Notify(CLOCK_SCALE_PRE, sysclk);
+
+#if CLOCK_PLAN_USE_PLL
+  if (NewProfile == CLOCK_SCALE_HIGH)
+  {
+    /* PLL settings are only writable with the PLL off */
+    RCC->CFGR2 = CLOCK_PLAN_CFGR2;
+    RCC->CFGR = (RCC->CFGR & ~CLOCK_SCALE_PLL_MASK) | CLOCK_PLAN_CFGR_PLL;
+    lock = SysTick_GetUs();
+    RCC->CR |= RCC_CR_PLLON;
+    while ((RCC->CR & RCC_CR_PLLRDY) == 0)
+    {
+      if ((SysTick_GetUs() - lock) > CLOCK_SCALE_PLL_TIMEOUT_US)
+      {
+        RCC->CR &= ~RCC_CR_PLLON;
+        if (hse_started)
+        {
+          RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+          HseStopped = 1;
+        }
+        ScaleStats.PllFails++;
+        /* undo the PRE phase on the clock that kept running */
+        __disable_irq();
+        ClockScale_Notify(CLOCK_SCALE_POST, HSI_VALUE);
+        __enable_irq();
+        return ERROR;
+      }
+    }
+  }
+#endif
+
+  __disable_irq();
+  off = SysTick_GetUs();
+  if (NewProfile == CLOCK_SCALE_HIGH)
+  {
+    /* wait states before the clock goes up */
+    FLASH->ACR = CLOCK_PLAN_ACR;
+    RCC->CFGR = (RCC->CFGR & ~CLOCK_SCALE_BUS_MASK) | CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE | CLOCK_PLAN_SW;
+    while (((RCC->CFGR & RCC_CFGR_SWS) != CLOCK_PLAN_SWS) && (FailoverPending == 0))
+    {
+    }
+  }
+  else
+  {
+    RCC->CFGR = (RCC->CFGR & ~CLOCK_SCALE_BUS_MASK) | RCC_CFGR_SW_HSI;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI)
+    {
+    }
+    /* wait states after the clock went down */
+    FLASH->ACR = FLASH_ACR_PRFTBE;
+#if CLOCK_PLAN_USE_PLL
+    RCC->CR &= ~RCC_CR_PLLON;
+#endif
+#if CLOCK_PLAN_SOURCE != 0
+    /* from BACKUP the crystal belongs to CLOCK_CSS, it is probing it */
+    if (Profile == CLOCK_SCALE_HIGH)
+    {
+      RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+      HseStopped = 1;
+    }
+#endif
+  }
+  SystemCoreClock = hclk;
+  SysTick_Retime(hclk);
+  Profile = NewProfile;
+
+  ClockScale_Notify(CLOCK_SCALE_POST, sysclk);
+
+  elapsed = SysTick_GetUs() - off;
+  ScaleStats.LastBlackoutUs = elapsed;
+  if (elapsed > ScaleStats.MaxBlackoutUs)
+  {
+    ScaleStats.MaxBlackoutUs = elapsed;
+  }
+  __enable_irq();
+
+  elapsed = SysTick_GetUs() - start;
+  ScaleStats.LastUs = elapsed;
+  if (elapsed > ScaleStats.MaxUs)
+  {
+    ScaleStats.MaxUs = elapsed;
+  }
+  ScaleStats.Switches++;
+  return SUCCESS;
+}
+
+/**
+  * @brief Switch SYSCLK to a profile
+  * @param NewProfile CLOCK_SCALE_LOW or CLOCK_SCALE_HIGH
+  * @retval SUCCESS, ERROR HSE not ready or PLL did not lock (clock left on HSI)
+  * @note blocks for the HSE start up and PLL lock time when going up; not
+  *       from an interrupt.
+  *       From CLOCK_SCALE_BACKUP both profiles are allowed, HIGH once HSE is
+  *       ready again (see CLOCK_CSS).
+  */
+ErrorStatus ClockScale_Set(uint8_t NewProfile)
+{
+  ErrorStatus status;
+
+  Busy = 1;
+  status = ClockScale_Switch(NewProfile);
+  Busy = 0;
+  if (FailoverPending)
+  {
+    FailoverPending = 0;
+    __disable_irq();
+    ClockScale_Failover();
+    __enable_irq();
+  }
+  return status;
+}
+
+/**
+  * @brief Move to CLOCK_SCALE_BACKUP after the clock security system has
+  *        dropped HSE: SYSCLK is already on HSI, HSE and its PLL are off
+  * @param None
+  * @retval None
+  * @note call by ClockCss_NMI_IRQHandler(), or with interrupts disabled.
+  *       During ClockScale_Set() it is deferred to the end of it.
+  *       Only the POST callbacks run, the clock has already changed.
+  *       The PLL wait is a counted loop, the NMI stops SysTick updates.
+  */
+void ClockScale_Failover(void)
+{
+  uint32_t wait = CLOCK_SCALE_PLL_TIMEOUT_US;
+  uint32_t sysclk = CLOCK_PLAN_BACKUP_SYSCLK_HZ;
+
+  if (Busy)
+  {
+    FailoverPending = 1;
+    return;
+  }
+  /* the low profile ran on HSI already */
+  if ((Profile == CLOCK_SCALE_LOW) || ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI))
+  {
+    return;
+  }
+
+  RCC->CR &= ~RCC_CR_PLLON;
+  while ((RCC->CR & RCC_CR_PLLRDY) != 0)
+  {
+  }
+  RCC->CFGR = (RCC->CFGR & ~(CLOCK_SCALE_PLL_MASK | RCC_CFGR_HPRE | RCC_CFGR_PPRE)) |
+              CLOCK_PLAN_BACKUP_CFGR_PLL | CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE;
+  RCC->CR |= RCC_CR_PLLON;
+  /* about 1us a pass on HSI */
+  while (((RCC->CR & RCC_CR_PLLRDY) == 0) && (wait != 0))
+  {
+    wait--;
+  }
+  if ((RCC->CR & RCC_CR_PLLRDY) != 0)
+  {
+    FLASH->ACR = CLOCK_PLAN_BACKUP_ACR;
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)
+    {
+    }
+  }
+  else
+  {
+    /* stay on HSI */
+    RCC->CR &= ~RCC_CR_PLLON;
+    ScaleStats.PllFails++;
+    sysclk = HSI_VALUE;
+  }
+  SystemCoreClock = sysclk / CLOCK_PLAN_AHB_DIV;
+  SysTick_Retime(SystemCoreClock);
+  Profile = CLOCK_SCALE_BACKUP;
+  ScaleStats.Failovers++;
+
+  ClockScale_Notify(CLOCK_SCALE_POST, sysclk);
+}
+
+/**
+  * @brief Current profile
+  * @param None
+  * @retval CLOCK_SCALE_LOW, CLOCK_SCALE_HIGH or CLOCK_SCALE_BACKUP
+  */
+uint8_t ClockScale_Get(void)
+{
+  return Profile;
+}
+
+/**
+  * @brief Read the switch statistics
+  * @param Stats pointer to a ClockScale_StatsTypeDef structure
+  * @retval None
+  */
+void ClockScale_GetStats(ClockScale_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = ScaleStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    CLOCK_SCALE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of CLOCK_SCALE.c file.
+  *
+  *          Runtime SYSCLK switching between two profiles:
+  *             CLOCK_SCALE_LOW   ------> HSI 8MHz, HCLK = PCLK = SYSCLK, 0 wait state,
+  *                                         PLL and HSE off
+  *             CLOCK_SCALE_HIGH  ------> CLOCK_PLAN.h result (PLL, 48MHz default)
+  *          and a third one entered only on a clock security system failover:
+  *             CLOCK_SCALE_BACKUP ------> HSI / 2 PLL nearest to the plan, plan prescalers
+  *          Each switch updates SystemCoreClock, the SysTick reload and the
+  *          flash latency, and calls the registered re-timing callbacks:
+  *             CLOCK_SCALE_PRE   old clock still running, quiesce the peripheral
+  *             CLOCK_SCALE_POST  new clock running, interrupts disabled,
+  *                               rewrite BRR / TIMINGR / prescalers
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_SCALE_H
+#define __CLOCK_SCALE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "CLOCK_PLAN.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Profiles */
+#define CLOCK_SCALE_LOW             0U
+#define CLOCK_SCALE_HIGH            1U
+#define CLOCK_SCALE_BACKUP          2U
+
+/* Callback phases */
+#define CLOCK_SCALE_PRE             0U
+#define CLOCK_SCALE_POST            1U
+
+#define CLOCK_SCALE_MAX_CALLBACKS   4U
+/* PLLRDY wait, the switch is refused after this */
+#define CLOCK_SCALE_PLL_TIMEOUT_US  1000U
+/* HSERDY wait on leaving CLOCK_SCALE_LOW with a HSE plan, refused after this */
+#define CLOCK_SCALE_HSE_TIMEOUT_US  5000U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Re-timing callback, Sysclk is the SYSCLK of the new profile in Hz
+  *        in both phases
+  */
+typedef void (*ClockScale_Callback)(uint8_t Phase, uint32_t Sysclk);
+
+typedef struct
+{
+  uint32_t Switches;
+  uint32_t PllFails;        /* PLL not locked within CLOCK_SCALE_PLL_TIMEOUT_US, or HSE not ready */
+  uint32_t Failovers;       /* ClockScale_Failover() moves to CLOCK_SCALE_BACKUP */
+  uint32_t LastUs;          /* ClockScale_Set() call, callbacks included */
+  uint32_t MaxUs;
+  uint32_t LastBlackoutUs;  /* interrupts disabled: switch, SysTick, POST callbacks */
+  uint32_t MaxBlackoutUs;
+} ClockScale_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+ErrorStatus ClockScale_Register(ClockScale_Callback Callback);
+ErrorStatus ClockScale_Set(uint8_t Profile);
+uint8_t ClockScale_Get(void);
+void ClockScale_Failover(void);
+void ClockScale_GetStats(ClockScale_StatsTypeDef *Stats);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __CLOCK_SCALE_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,354 @@
+/**
+  ******************************************************************************
+  * @file 		ENCODER.c
+	* @author		SINOMCU-AE
+  * @brief 		Quadrature encoder position and M/T speed estimate
+  *
+  *          This file provides the encoder functions:
+  *             TIM3 counts A and B edges (x4) in 16 bits, the update
+  *             interrupt carries the wraps in a 32 bit high part; the
+  *             direction of a wrap is taken from the counter (near 0: up),
+  *             not from DIR, which may have turned since;
+  *             every A rising edge latches the counter in TIM3 CCR1 and,
+  *             through TRGO (CC1 capture pulse) and ITR, the 32 bit HCLK
+  *             time in TIM2 CCR1, so both belong to the same edge;
+  *             M/T speed: counts between the last captured edges of two
+  *             estimates over the exact time between them; below one edge
+  *             per estimate the time since the last edge bounds the speed,
+  *             so it falls off to 0 when the encoder stops;
+  *             the index pulse latches the counter in TIM3 CCR3; two index
+  *             positions must be a whole revolution or nothing apart.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ENCODER.h"
+#include "CLOCK_PLAN.h"
+#include "SysTick_Delay.h"
+
+/* Variables -----------------------------------------------------------------*/
+static __IO int32_t High;
+
+/* last estimate: position and time of its captured A edge */
+static int64_t EdgePos;
+static uint32_t EdgeTime;
+static uint8_t EdgeValid;
+/* TIM2 CCR1 as last read */
+static uint32_t CaptureTime;
+static int32_t Speed;
+static uint32_t LastPoll;
+
+static int64_t IndexPos;
+static uint8_t IndexValid;
+
+static Encoder_StatsTypeDef EncStats;
+
+/**
+  * @brief Carry a TIM3 wrap into the high part
+  * @param None
+  * @retval None
+  * @note the update flag must be cleared before
+  */
+static void Encoder_Wrap(void)
+{
+  if (MS32_TIM_GetCounter(TIM3) < 0x8000U)
+  {
+    High++;
+  }
+  else
+  {
+    High--;
+  }
+  EncStats.Overflows++;
+}
+
+/**
+  * @brief Encoder pins, TIM3 encoder mode and the TIM2 edge time base
+  * @param None
+  * @retval None
+  * @note TIM2 and TIM3 are used here only
+  */
+void Encoder_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_TIM_ENCODER_InitTypeDef TIM_EncoderInitStruct;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_TIM2);
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_TIM3);
+  /**TIM3 GPIO Configuration
+  PB4   ------> TIM3_CH1
+  PB5   ------> TIM3_CH2
+  PB0   ------> TIM3_CH3
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_4 | MS32_GPIO_PIN_5;
+#if ENCODER_INDEX
+  GPIO_InitStruct.Pin |= MS32_GPIO_PIN_0;
+#endif
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  /* TIM3: x4 encoder, CH1 captures on the A rising edge */
+  MS32_TIM_DisableCounter(TIM3);
+  MS32_TIM_SetPrescaler(TIM3, 0);
+  MS32_TIM_SetAutoReload(TIM3, 0xFFFF);
+  MS32_TIM_ENCODER_StructInit(&TIM_EncoderInitStruct);
+  TIM_EncoderInitStruct.EncoderMode = MS32_TIM_ENCODERMODE_X4_TI12;
+  TIM_EncoderInitStruct.IC1Filter = ENCODER_FILTER;
+  TIM_EncoderInitStruct.IC2Filter = ENCODER_FILTER;
+  MS32_TIM_ENCODER_Init(TIM3, &TIM_EncoderInitStruct);
+  MS32_TIM_SetTriggerOutput(TIM3, MS32_TIM_TRGO_CC1IF);
+#if ENCODER_INDEX
+  MS32_TIM_IC_Config(TIM3, MS32_TIM_CHANNEL_CH3, MS32_TIM_ACTIVEINPUT_DIRECTTI | MS32_TIM_ICPSC_DIV1 |
+                                                 ENCODER_FILTER | MS32_TIM_IC_POLARITY_RISING);
+  MS32_TIM_CC_EnableChannel(TIM3, MS32_TIM_CHANNEL_CH3);
+#endif
+  MS32_TIM_SetCounter(TIM3, 0);
+
+  /* TIM2: free running HCLK time, CH1 captures on TRC (TIM3 TRGO) */
+  MS32_TIM_DisableCounter(TIM2);
+  MS32_TIM_SetPrescaler(TIM2, 0);
+  MS32_TIM_SetAutoReload(TIM2, 0xFFFFFFFFUL);
+  MS32_TIM_SetSlaveMode(TIM2, MS32_TIM_SLAVEMODE_DISABLED);
+  MS32_TIM_SetTriggerInput(TIM2, ENCODER_TIME_TS);
+  MS32_TIM_IC_Config(TIM2, MS32_TIM_CHANNEL_CH1, MS32_TIM_ACTIVEINPUT_TRC | MS32_TIM_ICPSC_DIV1 |
+                                                 MS32_TIM_IC_FILTER_FDIV1 | MS32_TIM_IC_POLARITY_RISING);
+  MS32_TIM_CC_EnableChannel(TIM2, MS32_TIM_CHANNEL_CH1);
+  MS32_TIM_GenerateEvent_UPDATE(TIM2);
+  MS32_TIM_EnableCounter(TIM2);
+
+  High = 0;
+  EdgeValid = 0;
+  MS32_TIM_ClearFlag_CC1(TIM2);
+  CaptureTime = MS32_TIM_IC_GetCaptureCH1(TIM2);
+  IndexValid = 0;
+  Speed = 0;
+  LastPoll = SysTick_GetTick();
+
+  MS32_TIM_GenerateEvent_UPDATE(TIM3);
+  MS32_TIM_ClearFlag_UPDATE(TIM3);
+  MS32_TIM_ClearFlag_CC3(TIM3);
+  MS32_TIM_EnableIT_UPDATE(TIM3);
+#if ENCODER_INDEX
+  MS32_TIM_EnableIT_CC3(TIM3);
+#endif
+  MS32_TIM_EnableCounter(TIM3);
+  NVIC_SetPriority(TIM3_IRQn, ENCODER_IRQ_PRIORITY);
+  NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+/**
+  * @brief Position in counts
+  * @param None
+  * @retval counts since Encoder_Init(), 64 bits
+  * @note a wrap not yet taken by the interrupt is carried here
+  */
+int64_t Encoder_GetPosition(void)
+{
+  uint32_t cnt;
+  int32_t high;
+
+  __disable_irq();
+  cnt = MS32_TIM_GetCounter(TIM3);
+  if (MS32_TIM_IsActiveFlag_UPDATE(TIM3))
+  {
+    MS32_TIM_ClearFlag_UPDATE(TIM3);
+    Encoder_Wrap();
+    cnt = MS32_TIM_GetCounter(TIM3);
+  }
+  high = High;
+  __enable_irq();
+  return ((int64_t)high * 65536) + (int64_t)cnt;
+}
+
+/**
+  * @brief New M/T speed estimate
+  * @param None
+  * @retval None
+  * @note call at a steady rate, at least one per 32768 counts and one per
+  *       TIM2 wrap (89s at 48MHz); from the main loop (Encoder_Poll()) or a
+  *       control loop interrupt
+  */
+void Encoder_Update(void)
+{
+  uint32_t v0 = SysTick->VAL;
+  uint32_t v1;
+  uint32_t now = MS32_TIM_GetCounter(TIM2);
+  uint32_t timclk = ClockPlan_TimClkHz();
+  uint32_t time;
+  uint32_t dt;
+  uint32_t count;
+  uint32_t edge;
+  int64_t pos;
+  int64_t bound;
+  int32_t dp;
+
+  /* CC1IF sampled and cleared before each read of the pair: set again
+     after the reads, an edge came in between and the pair is read again.
+     A CCR read also clears CC1IF, so an edge between the clear and the
+     read shows only as a new CCR1 value */
+  edge = 0;
+  do
+  {
+    if (MS32_TIM_IsActiveFlag_CC1(TIM2))
+    {
+      MS32_TIM_ClearFlag_CC1(TIM2);
+      edge = 1;
+    }
+    time = MS32_TIM_IC_GetCaptureCH1(TIM2);
+    count = MS32_TIM_IC_GetCaptureCH1(TIM3);
+  } while (MS32_TIM_IsActiveFlag_CC1(TIM2));
+  if (time != CaptureTime)
+  {
+    edge = 1;
+  }
+  CaptureTime = time;
+
+  if (edge)
+  {
+    /* captured counter within 32768 counts of the position now */
+    pos = Encoder_GetPosition();
+    pos += (int16_t)(uint16_t)(count - (uint32_t)pos);
+    if (EdgeValid)
+    {
+      dp = (int32_t)(pos - EdgePos);
+      dt = time - EdgeTime;
+      Speed = (dt != 0) ? (int32_t)((((int64_t)dp * timclk) << ENCODER_SPEED_SHIFT) / (int64_t)dt) : 0;
+    }
+    EdgePos = pos;
+    EdgeTime = time;
+    EdgeValid = 1;
+  }
+  else if (EdgeValid)
+  {
+    dt = now - EdgeTime;
+    if (dt >= ((timclk / 1000U) * ENCODER_STOP_MS))
+    {
+      Speed = 0;
+      EdgeValid = 0;
+    }
+    else if (dt != 0)
+    {
+      /* the next edge is at least dt away */
+      bound = (((int64_t)ENCODER_EDGE_COUNTS * timclk) << ENCODER_SPEED_SHIFT) / (int64_t)dt;
+      if (Speed > bound)
+      {
+        Speed = (int32_t)bound;
+      }
+      else if (Speed < -bound)
+      {
+        Speed = -(int32_t)bound;
+      }
+    }
+  }
+
+  EncStats.Updates++;
+  v1 = SysTick->VAL;
+  /* down counter, one reload at most */
+  EncStats.UpdateCycles = (v0 >= v1) ? (v0 - v1) : (v0 + (SysTick->LOAD + 1U) - v1);
+  if (EncStats.UpdateCycles > EncStats.UpdateCyclesMax)
+  {
+    EncStats.UpdateCyclesMax = EncStats.UpdateCycles;
+  }
+}
+
+/**
+  * @brief Estimate every ENCODER_PERIOD_MS
+  * @param None
+  * @retval None
+  * @note call from the main loop
+  */
+void Encoder_Poll(void)
+{
+  if ((SysTick_GetTick() - LastPoll) >= ENCODER_PERIOD_MS)
+  {
+    LastPoll += ENCODER_PERIOD_MS;
+    Encoder_Update();
+  }
+}
+
+/**
+  * @brief Speed of the last estimate
+  * @param None
+  * @retval counts/s << ENCODER_SPEED_SHIFT, + counting up
+  */
+int32_t Encoder_GetSpeed(void)
+{
+  return Speed;
+}
+
+/**
+  * @brief Read the encoder statistics
+  * @param Stats pointer to a Encoder_StatsTypeDef structure
+  * @retval None
+  */
+void Encoder_GetStats(Encoder_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = EncStats;
+  __enable_irq();
+}
+
+/**
+  * @brief TIM3 wrap and index capture
+  * @param None
+  * @retval None
+  * @note call by TIM3_IRQHandler()
+  */
+void Encoder_TIM3_IRQHandler(void)
+{
+  int64_t pos;
+  int32_t err;
+
+  if (MS32_TIM_IsActiveFlag_UPDATE(TIM3))
+  {
+    MS32_TIM_ClearFlag_UPDATE(TIM3);
+    Encoder_Wrap();
+  }
+  if (MS32_TIM_IsActiveFlag_CC3(TIM3))
+  {
+    pos = Encoder_GetPosition();
+    /* the CCR read clears CC3IF */
+    pos += (int16_t)(uint16_t)(MS32_TIM_IC_GetCaptureCH3(TIM3) - (uint32_t)pos);
+    EncStats.IndexPulses++;
+    if (IndexValid)
+    {
+      /* a whole revolution on, or back over the same index */
+      err = (int32_t)(pos - IndexPos);
+      if (err > (ENCODER_COUNTS_PER_REV / 2))
+      {
+        err -= ENCODER_COUNTS_PER_REV;
+      }
+      else if (err < -(ENCODER_COUNTS_PER_REV / 2))
+      {
+        err += ENCODER_COUNTS_PER_REV;
+      }
+      if ((err > ENCODER_INDEX_TOL) || (err < -ENCODER_INDEX_TOL))
+      {
+        EncStats.IndexErrors++;
+        EncStats.LastIndexError = err;
+      }
+    }
+    IndexPos = pos;
+    IndexValid = 1;
+  }
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file    ENCODER.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of ENCODER.c file.
+  *
+  *          Quadrature encoder position and M/T speed:
+  *             PB4   ------> TIM3_CH1, encoder A
+  *             PB5   ------> TIM3_CH2, encoder B
+  *             PB0   ------> TIM3_CH3, index pulse (capture)
+  *             TIM3 x4 encoder counter     ------> position, extended to 64
+  *                                                 bits on update
+  *             TIM3 CH1 capture, TRGO      ------> TIM2 CH1 (TRC) capture:
+  *                                                 position and time of the
+  *                                                 same A edge
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ENCODER_H
+#define __ENCODER_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Counts per revolution, x4: 4 x lines */
+#define ENCODER_COUNTS_PER_REV      4000
+/* Counts between two A rising edges */
+#define ENCODER_EDGE_COUNTS         4
+/* Index pulses further than this from a whole revolution are an error */
+#define ENCODER_INDEX_TOL           2
+#define ENCODER_INDEX               1
+
+/* Digital filter of the A, B and index inputs */
+#define ENCODER_FILTER              MS32_TIM_IC_FILTER_FDIV1_N8
+
+/* Speed in counts/s << ENCODER_SPEED_SHIFT */
+#define ENCODER_SPEED_SHIFT         4
+/* Encoder_Poll() estimate period */
+#define ENCODER_PERIOD_MS           1U
+/* No A edge for this long: speed 0 */
+#define ENCODER_STOP_MS             500U
+
+/* TIM2 trigger input from TIM3 TRGO */
+#define ENCODER_TIME_TS             MS32_TIM_TS_ITR2
+#define ENCODER_IRQ_PRIORITY        0x1U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Updates;             /* speed estimates */
+  uint32_t Overflows;           /* TIM3 counter wraps, both directions */
+  uint32_t IndexPulses;
+  uint32_t IndexErrors;         /* index off a whole revolution: lost counts */
+  int32_t  LastIndexError;      /* counts, at the last error */
+  uint32_t UpdateCycles;        /* last Encoder_Update(), HCLK cycles */
+  uint32_t UpdateCyclesMax;
+} Encoder_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void Encoder_Init(void);
+void Encoder_Update(void);
+void Encoder_Poll(void);
+int64_t Encoder_GetPosition(void);
+int32_t Encoder_GetSpeed(void);
+void Encoder_GetStats(Encoder_StatsTypeDef *Stats);
+
+void Encoder_TIM3_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+#if (ENCODER_COUNTS_PER_REV <= (2 * ENCODER_INDEX_TOL)) || (ENCODER_COUNTS_PER_REV > 32767)
+#error "ENCODER_COUNTS_PER_REV: above 2 x ENCODER_INDEX_TOL, up to 32767"
+#endif
+
+#endif /* __ENCODER_H */
+
+/******************************** END OF FILE *********************************/
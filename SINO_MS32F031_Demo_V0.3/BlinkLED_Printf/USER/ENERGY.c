@@ -0,0 +1,308 @@
+/**
+  ******************************************************************************
+  * @file 		ENERGY.c
+	* @author		SINOMCU-AE
+  * @brief 		Time in state and peripheral clock accounting
+  *
+  *          This file provides the energy accounting:
+  *             POWER_MGR reports every mode change (Energy_Enter()), the
+  *             time since the last one goes to the state it leaves;
+  *             the peripheral clock enables are sampled from RCC at the
+  *             same points (and Energy_Poll()), so enables done by any
+  *             driver are seen without wrapping the bus helpers, to the
+  *             nearest mode change or poll;
+  *             every interval adds time x (state current + current of
+  *             the enabled clocks) to the charge.
+  *
+  *          RUN and SLEEP are timed on SysTick_GetUs(): call Energy_Poll()
+  *          at least every hour (32 bit us wrap). SysTick stops in STOP:
+  *          STOP is timed on the RTC when it runs with the shadow
+  *          registers bypassed (direct reads right after the wake-up),
+  *          otherwise only the SysTick part counts (StopUntimed).
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ENERGY.h"
+#include "RTC_WAKE.h"
+#include "SysTick_Delay.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Clock enable registers */
+#define ENERGY_AHB                  0U
+#define ENERGY_APB1                 1U
+#define ENERGY_APB2                 2U
+
+#define ENERGY_DAY_S                86400U
+/* uA.us in one uA.h */
+#define ENERGY_UAH                  3600000000ULL
+
+/* Variables -----------------------------------------------------------------*/
+/* Tracked clocks, by ENERGY_CLK_xxx: register, enable bit, typical uA/MHz */
+static const uint8_t ClockReg[ENERGY_CLOCKS] =
+{
+  ENERGY_AHB, ENERGY_AHB, ENERGY_AHB, ENERGY_APB2, ENERGY_APB2, ENERGY_APB1,
+  ENERGY_APB1, ENERGY_APB1, ENERGY_APB2, ENERGY_APB2, ENERGY_APB2, ENERGY_APB1,
+};
+static const uint32_t ClockBit[ENERGY_CLOCKS] =
+{
+  RCC_AHBENR_DMAEN, RCC_AHBENR_GPIOAEN, RCC_AHBENR_GPIOBEN, RCC_APB2ENR_USART1EN,
+  RCC_APB2ENR_SPI1EN, RCC_APB1ENR_I2C1EN, RCC_APB1ENR_TIM3EN, RCC_APB1ENR_TIM14EN,
+  RCC_APB2ENR_TIM16EN, RCC_APB2ENR_TIM17EN, RCC_APB2ENR_ADCEN, RCC_APB1ENR_TIM2EN,
+};
+static const uint16_t ClockUaPerMhz[ENERGY_CLOCKS] =
+{
+  6U, 5U, 5U, 13U, 9U, 4U, 9U, 4U, 6U, 6U, 3U, 11U,
+};
+
+static uint8_t Started;
+static uint8_t Current;
+static uint32_t LastUs;
+static uint32_t StopTicks;
+static uint8_t StopTimed;
+/* enabled clocks of the running interval, bit i: ENERGY_CLK i */
+static uint32_t Enabled;
+
+static uint64_t StateUs[ENERGY_STATES] STARTUP_DMAZERO;
+static uint64_t ClockUs[ENERGY_CLOCKS] STARTUP_DMAZERO;
+/* uA.us */
+static uint64_t Charge;
+static uint32_t StopUntimed;
+
+/**
+  * @brief Write a 32 bit value LSB first
+  * @param Buf destination
+  * @param Value value
+  * @retval None
+  */
+static void Energy_Put32(uint8_t *Buf, uint32_t Value)
+{
+  Buf[0] = (uint8_t)Value;
+  Buf[1] = (uint8_t)(Value >> 8);
+  Buf[2] = (uint8_t)(Value >> 16);
+  Buf[3] = (uint8_t)(Value >> 24);
+}
+
+/**
+  * @brief Sample the tracked clock enables
+  * @param None
+  * @retval bit i set: ENERGY_CLK i enabled
+  */
+static uint32_t Energy_SampleClocks(void)
+{
+  uint32_t enr[3];
+  uint32_t mask = 0;
+  uint8_t i;
+
+  enr[ENERGY_AHB] = RCC->AHBENR;
+  enr[ENERGY_APB1] = RCC->APB1ENR;
+  enr[ENERGY_APB2] = RCC->APB2ENR;
+  for (i = 0; i < ENERGY_CLOCKS; i++)
+  {
+    if ((enr[ClockReg[i]] & ClockBit[i]) != 0)
+    {
+      mask |= 1UL << i;
+    }
+  }
+  return mask;
+}
+
+/**
+  * @brief Charge the interval to the current state and clocks
+  * @param Us interval length
+  * @retval None
+  */
+static void Energy_Account(uint32_t Us)
+{
+  uint32_t mhz = SystemCoreClock / 1000000U;
+  uint32_t ua;
+  uint8_t i;
+
+  StateUs[Current] += Us;
+  switch (Current)
+  {
+  case POWER_MGR_RUN:
+    ua = ENERGY_RUN_UA_PER_MHZ * mhz;
+    break;
+  case POWER_MGR_SLEEP:
+    ua = ENERGY_SLEEP_UA_PER_MHZ * mhz;
+    break;
+  case POWER_MGR_STOP:
+    ua = ENERGY_STOP_UA;
+    break;
+  default:
+    ua = ENERGY_STOP_LP_UA;
+    break;
+  }
+  /* no clock runs in STOP */
+  if (Current < POWER_MGR_STOP)
+  {
+    for (i = 0; i < ENERGY_CLOCKS; i++)
+    {
+      if ((Enabled & (1UL << i)) != 0)
+      {
+        ClockUs[i] += Us;
+        ua += ClockUaPerMhz[i] * mhz;
+      }
+    }
+  }
+  Charge += (uint64_t)Us * ua;
+}
+
+/**
+  * @brief Start the accounting in RUN
+  * @param None
+  * @retval None
+  * @note call after SysTick_Init(); before it Energy_Enter() does nothing
+  */
+void Energy_Init(void)
+{
+  __disable_irq();
+  Current = POWER_MGR_RUN;
+  LastUs = SysTick_GetUs();
+  Enabled = Energy_SampleClocks();
+  Started = 1;
+  __enable_irq();
+}
+
+/**
+  * @brief Close the interval of the current state and enter a new one
+  * @param State POWER_MGR mode entered
+  * @retval None
+  * @note call by PowerMgr_Idle() with interrupts disabled: after the clock
+  *       gating on the way in, after the restore on the way out
+  */
+void Energy_Enter(uint8_t State)
+{
+  uint32_t now;
+  uint32_t us;
+  uint32_t ticks;
+  uint32_t s;
+
+  if (!Started)
+  {
+    return;
+  }
+  now = SysTick_GetUs();
+  us = now - LastUs;
+  if (Current >= POWER_MGR_STOP)
+  {
+    if (StopTimed && RtcWake_GetTicks(&ticks))
+    {
+      s = (RTC->PRER & RTC_PRER_PREDIV_S) + 1U;
+      if (ticks < StopTicks)
+      {
+        ticks += ENERGY_DAY_S * s;
+      }
+      us = (uint32_t)(((uint64_t)(ticks - StopTicks) * 1000000U) / s);
+    }
+    else
+    {
+      StopUntimed++;
+    }
+  }
+  Energy_Account(us);
+
+  LastUs = now;
+  Current = State;
+  Enabled = Energy_SampleClocks();
+  if (State >= POWER_MGR_STOP)
+  {
+    StopTimed = RtcWake_GetTicks(&StopTicks);
+  }
+}
+
+/**
+  * @brief Account the time up to now and sample the clock enables again
+  * @param None
+  * @retval None
+  * @note call from the main loop, at least every hour
+  */
+void Energy_Poll(void)
+{
+  __disable_irq();
+  Energy_Enter(Current);
+  __enable_irq();
+}
+
+/**
+  * @brief Accounted time and estimated charge up to now
+  * @param Report pointer to a Energy_ReportTypeDef structure
+  * @retval None
+  */
+void Energy_GetReport(Energy_ReportTypeDef *Report)
+{
+  uint64_t total = 0;
+  uint8_t i;
+
+  Energy_Poll();
+  __disable_irq();
+  for (i = 0; i < ENERGY_STATES; i++)
+  {
+    Report->StateMs[i] = (uint32_t)(StateUs[i] / 1000U);
+    total += StateUs[i];
+  }
+  for (i = 0; i < ENERGY_CLOCKS; i++)
+  {
+    Report->ClockMs[i] = (uint32_t)(ClockUs[i] / 1000U);
+  }
+  Report->StopUntimed = StopUntimed;
+  Report->ChargeUAh = (uint32_t)(Charge / ENERGY_UAH);
+  Report->AverageUA = (total != 0) ? (uint32_t)(Charge / total) : 0;
+  __enable_irq();
+}
+
+/**
+  * @brief USART1_PKT command ENERGY_CMD_ID
+  * @param Req request payload, 1 byte page (empty: ENERGY_PAGE_STATES)
+  * @param ReqLen request length
+  * @param Rsp response payload: page, then the page values, 4 bytes each
+  *        LSB first; the clock pages hold ENERGY_PAGE_CLOCKS_MAX clocks
+  * @retval response length
+  * @note register in the USART1_Pkt_Init() command table
+  */
+uint8_t Energy_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp)
+{
+  Energy_ReportTypeDef report;
+  uint8_t len = 1;
+  uint8_t i;
+  uint8_t end;
+
+  Energy_GetReport(&report);
+  Rsp[0] = (ReqLen != 0) ? Req[0] : ENERGY_PAGE_STATES;
+  if ((Rsp[0] == ENERGY_PAGE_CLOCKS) || (Rsp[0] == ENERGY_PAGE_CLOCKS2))
+  {
+    i = (Rsp[0] - ENERGY_PAGE_CLOCKS) * ENERGY_PAGE_CLOCKS_MAX;
+    end = ((i + ENERGY_PAGE_CLOCKS_MAX) < ENERGY_CLOCKS) ? (i + ENERGY_PAGE_CLOCKS_MAX) : ENERGY_CLOCKS;
+    for (; i < end; i++, len += 4)
+    {
+      Energy_Put32(&Rsp[len], report.ClockMs[i]);
+    }
+    return len;
+  }
+
+  Rsp[0] = ENERGY_PAGE_STATES;
+  for (i = 0; i < ENERGY_STATES; i++, len += 4)
+  {
+    Energy_Put32(&Rsp[len], report.StateMs[i]);
+  }
+  Energy_Put32(&Rsp[len], report.StopUntimed);
+  Energy_Put32(&Rsp[len + 4], report.ChargeUAh);
+  Energy_Put32(&Rsp[len + 8], report.AverageUA);
+  return len + 12;
+}
+
+/******************************** END OF FILE *********************************/
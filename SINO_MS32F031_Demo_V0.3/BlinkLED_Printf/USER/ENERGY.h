@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file    ENERGY.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of ENERGY.c file.
+  *
+  *          Energy accounting for battery life estimates:
+  *             time in each POWER_MGR mode (RUN, SLEEP, STOP, STOP_LP)
+  *             enabled time of each tracked peripheral clock
+  *             charge = sum of time x current of the tables below
+  *          Report over USART1_PKT (ENERGY_CMD_ID) or Energy_GetReport().
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ENERGY_H
+#define __ENERGY_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "POWER_MGR.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Supply current per state, typical figures: measure them on the product
+   and set them per variant. RUN and SLEEP scale with HCLK */
+#define ENERGY_RUN_UA_PER_MHZ       250U
+#define ENERGY_SLEEP_UA_PER_MHZ     80U
+#define ENERGY_STOP_UA              30U
+#define ENERGY_STOP_LP_UA           15U
+
+/* One state per POWER_MGR mode, same numbers */
+#define ENERGY_STATES               POWER_MGR_MODES
+
+/* Tracked peripheral clocks, current per MHz of HCLK in ENERGY.c */
+#define ENERGY_CLK_DMA              0U
+#define ENERGY_CLK_GPIOA            1U
+#define ENERGY_CLK_GPIOB            2U
+#define ENERGY_CLK_USART1           3U
+#define ENERGY_CLK_SPI1             4U
+#define ENERGY_CLK_I2C1             5U
+#define ENERGY_CLK_TIM3             6U
+#define ENERGY_CLK_TIM14            7U
+#define ENERGY_CLK_TIM16            8U
+#define ENERGY_CLK_TIM17            9U
+#define ENERGY_CLK_ADC              10U
+#define ENERGY_CLK_TIM2             11U     /* ENCODER, CAPTURE */
+#define ENERGY_CLOCKS               12U
+
+#define ENERGY_CMD_ID               0x11U
+/* ENERGY_CMD_ID request: 1 byte page */
+#define ENERGY_PAGE_STATES          0x00U   /* StateMs[], StopUntimed, ChargeUAh, AverageUA */
+#define ENERGY_PAGE_CLOCKS          0x01U   /* ClockMs[0~10] */
+#define ENERGY_PAGE_CLOCKS2         0x02U   /* ClockMs[11~] */
+/* ClockMs per page, 1 + 4 x 11 bytes within USART1_PKT_MAX_PAYLOAD */
+#define ENERGY_PAGE_CLOCKS_MAX      11U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t StateMs[ENERGY_STATES];
+  uint32_t ClockMs[ENERGY_CLOCKS];  /* enabled time, RUN and SLEEP only */
+  uint32_t StopUntimed;     /* STOP exits without a RTC time, counted on SysTick only */
+  uint32_t ChargeUAh;       /* estimated from the current tables */
+  uint32_t AverageUA;       /* charge over the accounted time */
+} Energy_ReportTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void Energy_Init(void);
+void Energy_Enter(uint8_t State);
+void Energy_Poll(void);
+void Energy_GetReport(Energy_ReportTypeDef *Report);
+uint8_t Energy_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __ENERGY_H */
+
+/******************************** END OF FILE *********************************/
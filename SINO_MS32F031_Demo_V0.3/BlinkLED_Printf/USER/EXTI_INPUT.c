@@ -0,0 +1,350 @@
+/**
+  ******************************************************************************
+  * @file 		EXTI_INPUT.c
+	* @author		SINOMCU-AE
+  * @brief 		Debounced multi input events on the EXTI lines
+  *
+  *          This file provides the input engine:
+  *             the three EXTI vectors share one handler: it reads PR once,
+  *             clears all of its lines with one write and for each line
+  *             masks it in IMR and starts its debounce time; the line of a
+  *             pending bit is found with a de Bruijn multiply and a 32
+  *             entry table, the same cost for every line and pin count;
+  *             a bouncing contact gives one interrupt per debounce period;
+  *             ExtiInput_Poll() ends the debounce on the ms tick: reads the
+  *             level, unmasks the line and runs the press state machine
+  *             with its long press and click window times.
+  *
+  *          Lines not in the table (SPI1_SLAVE NSS on EXTI4, ...) are left
+  *          to their own handlers.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "EXTI_INPUT.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+#define EXTI_INPUT_NO_SLOT          0xFFU
+/* isolated bit * constant, mod 2^32, >> 27 indexes ExtiInput_DeBruijn */
+#define EXTI_INPUT_DEBRUIJN         0x077CB531UL
+/* a - b of two ms ticks, a not before b */
+#define EXTI_INPUT_DUE(Now, At)     (((Now) - (At)) < 0x80000000UL)
+
+/* Variables -----------------------------------------------------------------*/
+static const uint8_t ExtiInput_DeBruijn[32] =
+{
+  0U, 1U, 28U, 2U, 29U, 14U, 24U, 3U, 30U, 22U, 20U, 15U, 25U, 17U, 4U, 8U,
+  31U, 27U, 13U, 23U, 21U, 19U, 16U, 7U, 26U, 12U, 18U, 6U, 11U, 5U, 10U, 9U,
+};
+
+static const ExtiInput_PinTypeDef *PinTable;
+static uint8_t PinCount;
+static uint8_t LineSlot[16];
+static uint32_t Lines;
+
+/* per table entry */
+static uint32_t Bounce[EXTI_INPUT_MAX_PINS];   /* debounce end, written by the interrupt */
+static uint32_t Timer[EXTI_INPUT_MAX_PINS];    /* long press or click window end */
+static uint8_t Clicks[EXTI_INPUT_MAX_PINS];
+
+/* per line */
+static __IO uint32_t Bouncing;
+static uint32_t Timing;
+static uint32_t Pressed;
+static uint32_t LongDone;
+static uint32_t Settling;       /* first debounce after init, no event */
+
+static uint32_t LastPoll;
+static ExtiInput_StatsTypeDef InputStats;
+
+/**
+  * @brief Pressed level of a table entry
+  * @param Slot table index
+  * @retval 1 pressed, 0 released
+  */
+static uint32_t ExtiInput_Read(uint8_t Slot)
+{
+  return ((PinTable[Slot].Port->IDR >> PinTable[Slot].Pin) & 1U) ^ (PinTable[Slot].ActiveLow ? 1U : 0U);
+}
+
+/**
+  * @brief Count and pass on an event
+  * @param Slot table index
+  * @param Event EXTI_INPUT_EVT_xxx
+  * @param Count clicks
+  * @retval None
+  */
+static void ExtiInput_Emit(uint8_t Slot, uint8_t Event, uint8_t Count)
+{
+  InputStats.Events++;
+  if (PinTable[Slot].Callback != 0)
+  {
+    PinTable[Slot].Callback(PinTable[Slot].Pin, Event, Count);
+  }
+}
+
+/**
+  * @brief Configure the pins, their EXTI lines on both edges and the vectors
+  * @param Table pins, kept by reference
+  * @param Count entries in Table, up to EXTI_INPUT_MAX_PINS
+  * @retval SUCCESS, ERROR too many pins, a pin above 15, a line twice or a
+  *         line another driver triggers on (SPI1_SLAVE NSS: line 4)
+  * @note the levels after the first debounce time are the start state,
+  *       without events
+  */
+ErrorStatus ExtiInput_Init(const ExtiInput_PinTypeDef *Table, uint8_t Count)
+{
+  uint32_t lines = 0;
+  uint32_t port;
+  uint32_t pos;
+  uint8_t line;
+  uint8_t i;
+
+  if (Count > EXTI_INPUT_MAX_PINS)
+  {
+    return ERROR;
+  }
+  for (i = 0; i < Count; i++)
+  {
+    if ((Table[i].Pin > 15U) || (lines & (1UL << Table[i].Pin)))
+    {
+      return ERROR;
+    }
+    lines |= 1UL << Table[i].Pin;
+  }
+  /* the EXTI4_15 vector runs every handler, a shared line loses edges */
+  if ((EXTI->RTSR | EXTI->FTSR) & lines & ~Lines)
+  {
+    return ERROR;
+  }
+
+  /* mask and release the old lines before the table changes */
+  EXTI->IMR &= ~Lines;
+  EXTI->RTSR &= ~Lines;
+  EXTI->FTSR &= ~Lines;
+  PinTable = Table;
+  PinCount = Count;
+  Lines = lines;
+  Bouncing = 0;
+  Timing = 0;
+  Pressed = 0;
+  LongDone = 0;
+  for (i = 0; i < 16U; i++)
+  {
+    LineSlot[i] = EXTI_INPUT_NO_SLOT;
+  }
+
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_SYSCFG);
+  for (i = 0; i < Count; i++)
+  {
+    line = Table[i].Pin;
+    /* GPIOA 0, GPIOB 1, GPIOC 2, GPIOF 5: the EXTICR code and the clock bit */
+    port = ((uint32_t)Table[i].Port - GPIOA_BASE) >> 10;
+    RCC->AHBENR |= RCC_AHBENR_GPIOAEN << port;
+    MS32_GPIO_SetPinMode(Table[i].Port, 1UL << line, MS32_GPIO_MODE_INPUT);
+    MS32_GPIO_SetPinPull(Table[i].Port, 1UL << line, Table[i].ActiveLow ? MS32_GPIO_PULL_UP : MS32_GPIO_PULL_DOWN);
+    /* not MS32_EXTI_PinITConfig(): it clears the pending lines of others */
+    pos = (line & 3U) << 2;
+    MODIFY_REG(SYSCFG->EXTICR[line >> 2], SYSCFG_EXTICR1_EXTI0 << pos, port << pos);
+    LineSlot[line] = i;
+    Clicks[i] = 0;
+  }
+  /* the pull-ups settle before the first read */
+  LastPoll = SysTick_GetTick();
+  for (i = 0; i < Count; i++)
+  {
+    Bounce[i] = LastPoll + EXTI_INPUT_DEBOUNCE_MS;
+  }
+  Settling = lines;
+  /* unmasked by the first ExtiInput_Poll() after the debounce time */
+  Bouncing = lines;
+  EXTI->RTSR |= lines;
+  EXTI->FTSR |= lines;
+
+  if (lines & (MS32_EXTI_LINE_0 | MS32_EXTI_LINE_1))
+  {
+    NVIC_SetPriority(EXTI0_1_IRQn, EXTI_INPUT_IRQ_PRIORITY);
+    NVIC_EnableIRQ(EXTI0_1_IRQn);
+  }
+  if (lines & (MS32_EXTI_LINE_2 | MS32_EXTI_LINE_3))
+  {
+    NVIC_SetPriority(EXTI2_3_IRQn, EXTI_INPUT_IRQ_PRIORITY);
+    NVIC_EnableIRQ(EXTI2_3_IRQn);
+  }
+  if (lines & 0xFFF0UL)
+  {
+    NVIC_SetPriority(EXTI4_15_IRQn, EXTI_INPUT_IRQ_PRIORITY);
+    NVIC_EnableIRQ(EXTI4_15_IRQn);
+  }
+  return SUCCESS;
+}
+
+/**
+  * @brief End due debounces and timers, run the callbacks
+  * @param None
+  * @retval None
+  * @note call from the main loop, works once per ms tick
+  */
+void ExtiInput_Poll(void)
+{
+  uint32_t now = SysTick_GetTick();
+  uint32_t bit;
+  uint32_t level;
+  uint8_t i;
+
+  if (now == LastPoll)
+  {
+    return;
+  }
+  LastPoll = now;
+
+  for (i = 0; i < PinCount; i++)
+  {
+    bit = 1UL << PinTable[i].Pin;
+
+    /* the line is masked while it bounces: Bounce[i] is stable here */
+    if ((Bouncing & bit) && EXTI_INPUT_DUE(now, Bounce[i]))
+    {
+      /* clear, then read: an edge after the read interrupts again */
+      __disable_irq();
+      Bouncing &= ~bit;
+      EXTI->PR = bit;
+      level = ExtiInput_Read(i);
+      EXTI->IMR |= bit;
+      __enable_irq();
+
+      if (Settling & bit)
+      {
+        Settling &= ~bit;
+        Pressed |= level << PinTable[i].Pin;
+        LongDone |= level << PinTable[i].Pin;
+      }
+      else if (level == ((Pressed & bit) ? 1U : 0U))
+      {
+        InputStats.Bounces++;
+      }
+      else if (level)
+      {
+        Pressed |= bit;
+        LongDone &= ~bit;
+        Timer[i] = now + EXTI_INPUT_LONG_MS;
+        Timing |= bit;
+        ExtiInput_Emit(i, EXTI_INPUT_EVT_PRESS, Clicks[i]);
+      }
+      else
+      {
+        Pressed &= ~bit;
+        ExtiInput_Emit(i, EXTI_INPUT_EVT_RELEASE, Clicks[i]);
+        if (LongDone & bit)
+        {
+          Timing &= ~bit;
+        }
+        else
+        {
+          if (Clicks[i] != 0xFFU)
+          {
+            Clicks[i]++;
+          }
+          Timer[i] = now + EXTI_INPUT_CLICK_MS;
+          Timing |= bit;
+        }
+      }
+    }
+
+    if ((Timing & bit) && EXTI_INPUT_DUE(now, Timer[i]))
+    {
+      Timing &= ~bit;
+      if (Pressed & bit)
+      {
+        /* clicks before a long press are dropped */
+        LongDone |= bit;
+        Clicks[i] = 0;
+        ExtiInput_Emit(i, EXTI_INPUT_EVT_LONG, 0);
+      }
+      else
+      {
+        ExtiInput_Emit(i, (Clicks[i] == 1U) ? EXTI_INPUT_EVT_CLICK :
+                          ((Clicks[i] == 2U) ? EXTI_INPUT_EVT_DOUBLE : EXTI_INPUT_EVT_TRAIN), Clicks[i]);
+        Clicks[i] = 0;
+      }
+    }
+  }
+}
+
+/**
+  * @brief Debounced level of a pin
+  * @param Pin 0 ~ 15
+  * @retval 1 pressed, 0 released or not in the table
+  */
+uint8_t ExtiInput_IsPressed(uint8_t Pin)
+{
+  return (uint8_t)((Pressed >> (Pin & 0xFU)) & 1U);
+}
+
+/**
+  * @brief Read the input statistics
+  * @param Stats pointer to a ExtiInput_StatsTypeDef structure
+  * @retval None
+  */
+void ExtiInput_GetStats(ExtiInput_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = InputStats;
+  __enable_irq();
+}
+
+/**
+  * @brief EXTI lines of the table: start the debounce
+  * @param None
+  * @retval None
+  * @note call by EXTI0_1_IRQHandler(), EXTI2_3_IRQHandler() and
+  *       EXTI4_15_IRQHandler(); IsrCycles from the first read on, without
+  *       the exception entry and exit
+  */
+void ExtiInput_IRQHandler(void)
+{
+  uint32_t v0 = SysTick->VAL;
+  uint32_t pending = EXTI->PR & Lines;
+  uint32_t bit;
+  uint32_t done;
+  uint32_t v1;
+
+  if (pending == 0)
+  {
+    return;
+  }
+  EXTI->IMR &= ~pending;
+  EXTI->PR = pending;
+  Bouncing |= pending;
+  done = SysTick_GetTick() + EXTI_INPUT_DEBOUNCE_MS;
+  do
+  {
+    bit = pending & (0UL - pending);
+    Bounce[LineSlot[ExtiInput_DeBruijn[(uint32_t)(bit * EXTI_INPUT_DEBRUIJN) >> 27]]] = done;
+    pending ^= bit;
+    InputStats.Edges++;
+  } while (pending != 0);
+
+  v1 = SysTick->VAL;
+  /* down counter, one reload at most */
+  InputStats.IsrCycles = (v0 >= v1) ? (v0 - v1) : (v0 + (SysTick->LOAD + 1U) - v1);
+  if (InputStats.IsrCycles > InputStats.IsrCyclesMax)
+  {
+    InputStats.IsrCyclesMax = InputStats.IsrCycles;
+  }
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    EXTI_INPUT.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of EXTI_INPUT.c file.
+  *
+  *          Debounced inputs on EXTI lines 0~15:
+  *             edge, any pin of the table    ------> EXTI0_1 / EXTI2_3 /
+  *                                                   EXTI4_15 interrupt, line
+  *                                                   masked for the debounce
+  *             ExtiInput_Poll(), ms tick     ------> stable level, press,
+  *                                                   release, long press,
+  *                                                   click / double click /
+  *                                                   pulse train
+  *          One pin per EXTI line (pin number = line), any port A/B/C/F;
+  *          a line another driver already triggers on is not taken.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __EXTI_INPUT_H
+#define __EXTI_INPUT_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define EXTI_INPUT_MAX_PINS         8U
+
+/* Level must hold this long after the last edge */
+#define EXTI_INPUT_DEBOUNCE_MS      20U
+/* Held this long: EXTI_INPUT_EVT_LONG, no click */
+#define EXTI_INPUT_LONG_MS          800U
+/* Next press within this time after a release counts to the same clicks */
+#define EXTI_INPUT_CLICK_MS         300U
+
+#define EXTI_INPUT_IRQ_PRIORITY     0x2U
+
+/* Events, Count: clicks in the sequence */
+#define EXTI_INPUT_EVT_PRESS        0U
+#define EXTI_INPUT_EVT_RELEASE      1U
+#define EXTI_INPUT_EVT_LONG         2U
+#define EXTI_INPUT_EVT_CLICK        3U      /* one click */
+#define EXTI_INPUT_EVT_DOUBLE       4U      /* two clicks */
+#define EXTI_INPUT_EVT_TRAIN        5U      /* three clicks and more */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Event callback, runs in ExtiInput_Poll()
+  */
+typedef void (*ExtiInput_Callback)(uint8_t Pin, uint8_t Event, uint8_t Count);
+
+typedef struct
+{
+  GPIO_TypeDef *Port;       /* GPIOA, GPIOB, GPIOC or GPIOF */
+  uint8_t Pin;              /* 0 ~ 15, also the EXTI line */
+  uint8_t ActiveLow;        /* 1: pressed reads 0, pull-up; 0: pull-down */
+  ExtiInput_Callback Callback;
+} ExtiInput_PinTypeDef;
+
+typedef struct
+{
+  uint32_t Edges;           /* interrupts taken, bounces included */
+  uint32_t Bounces;         /* debounce ended on the old level */
+  uint32_t Events;
+  uint32_t IsrCycles;       /* last ExtiInput_IRQHandler(), HCLK cycles */
+  uint32_t IsrCyclesMax;
+} ExtiInput_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+ErrorStatus ExtiInput_Init(const ExtiInput_PinTypeDef *Table, uint8_t Count);
+void ExtiInput_Poll(void);
+uint8_t ExtiInput_IsPressed(uint8_t Pin);
+void ExtiInput_GetStats(ExtiInput_StatsTypeDef *Stats);
+
+void ExtiInput_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __EXTI_INPUT_H */
+
+/******************************** END OF FILE *********************************/
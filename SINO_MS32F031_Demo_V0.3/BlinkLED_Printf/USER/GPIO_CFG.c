@@ -6,6 +6,7 @@
   *    
   *          This file provides functions to GPIO config:
   *              LED1 LED2 pin pushpull,output,pull up resistance
+  *              pin table applied with one write per register and port
   *         
  	******************************************************************************
   * @attention
@@ -24,25 +25,86 @@
 /* Includes ------------------------------------------------------------------*/
 #include "GPIO_CFG.h"
 
+/* Variables -----------------------------------------------------------------*/
+static const GPIO_PinCfgTypeDef GPIO_StartupTable[] =
+{
+    {LED_Port, LED1_Pin | LED2_Pin, MS32_GPIO_MODE_OUTPUT, MS32_GPIO_OUTPUT_PUSHPULL, MS32_GPIO_SPEED_HIGH, MS32_GPIO_PULL_UP, MS32_GPIO_AF_0},
+};
+
 /**
-  * @brief USART1 Initialization Function
+  * @brief GPIO Initialization Function
   * @param None
   * @retval None
   */
 void GPIO_Initialization(void)
 {
-    MS32_GPIO_InitTypeDef  GPIO_InitStruct;
-    
     MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
 
-    MS32_GPIO_StructInit(&GPIO_InitStruct);    
-    GPIO_InitStruct.Pin = LED1_Pin | LED2_Pin;
-    GPIO_InitStruct.Mode = MS32_GPIO_MODE_OUTPUT;
-    GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
-    GPIO_InitStruct.Speed = MS32_GPIO_SPEED_HIGH;
-    GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
-    GPIO_InitStruct.Alternate = MS32_GPIO_AF_0;
-    MS32_GPIO_Init(LED_Port,&GPIO_InitStruct);    
+    GPIO_ApplyTable(GPIO_StartupTable, sizeof(GPIO_StartupTable) / sizeof(GPIO_StartupTable[0]));
+}
+
+/**
+  * @brief Apply a pin table
+  * @param Table pin groups, each with one setting for all its pins
+  * @param Count entries in Table
+  * @retval None
+  * @note MS32_GPIO_Init() walks the 16 pins with one read-modify-write per
+  *       pin and register; here each entry costs one per register.
+  *       MODER is written last so a pin leaves input mode already set up.
+  *       The port clocks must be enabled before.
+  */
+void GPIO_ApplyTable(const GPIO_PinCfgTypeDef *Table, uint8_t Count)
+{
+    GPIO_TypeDef *port;
+    uint32_t pins, mask2, val2, mask4l, val4l, mask4h, val4h;
+    uint32_t pos;
+
+    while (Count--)
+    {
+        port = Table->Port;
+        pins = Table->Pins;
+        mask2 = 0;
+        val2 = 0;
+        mask4l = 0;
+        val4l = 0;
+        mask4h = 0;
+        val4h = 0;
+        for (pos = 0; pos < 16U; pos++)
+        {
+            if ((pins & (1UL << pos)) == 0)
+            {
+                continue;
+            }
+            /* 2 bit fields: MODER OSPEEDR PUPDR */
+            mask2 |= 3UL << (pos * 2U);
+            val2 |= 1UL << (pos * 2U);
+            /* 4 bit fields: AFRL AFRH */
+            if (pos < 8U)
+            {
+                mask4l |= 0xFUL << (pos * 4U);
+                val4l |= (uint32_t)Table->Alternate << (pos * 4U);
+            }
+            else
+            {
+                mask4h |= 0xFUL << ((pos - 8U) * 4U);
+                val4h |= (uint32_t)Table->Alternate << ((pos - 8U) * 4U);
+            }
+        }
+        /* val2 holds 01 in every field: multiply by the 2 bit setting */
+        MODIFY_REG(port->OSPEEDR, mask2, val2 * Table->Speed);
+        MODIFY_REG(port->OTYPER, pins, Table->OutputType ? pins : 0);
+        MODIFY_REG(port->PUPDR, mask2, val2 * Table->Pull);
+        if (mask4l)
+        {
+            MODIFY_REG(port->AFRL, mask4l, val4l);
+        }
+        if (mask4h)
+        {
+            MODIFY_REG(port->AFRH, mask4h, val4h);
+        }
+        MODIFY_REG(port->MODER, mask2, val2 * Table->Mode);
+        Table++;
+    }
 }
 
 /******************************** END OF FILE *********************************/
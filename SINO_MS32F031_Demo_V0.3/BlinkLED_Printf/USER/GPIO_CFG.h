@@ -44,9 +44,21 @@
 #define LED2_TOGGLE()               MS32_GPIO_TogglePin(LED_Port,LED2_Pin)  
 
 /* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+    GPIO_TypeDef *Port;
+    uint16_t Pins;          /* MS32_GPIO_PIN_x, or-ed */
+    uint8_t Mode;           /* MS32_GPIO_MODE_xxx */
+    uint8_t OutputType;     /* MS32_GPIO_OUTPUT_xxx */
+    uint8_t Speed;          /* MS32_GPIO_SPEED_xxx */
+    uint8_t Pull;           /* MS32_GPIO_PULL_xxx */
+    uint8_t Alternate;      /* MS32_GPIO_AF_x */
+} GPIO_PinCfgTypeDef;
+
 /* Exported constants --------------------------------------------------------*/
 /* Exported functions prototypes ---------------------------------------------*/
 void GPIO_Initialization(void);
+void GPIO_ApplyTable(const GPIO_PinCfgTypeDef *Table, uint8_t Count);
 
 /* Private defines -----------------------------------------------------------*/
 
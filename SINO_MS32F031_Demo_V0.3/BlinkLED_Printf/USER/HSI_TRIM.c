@@ -0,0 +1,418 @@
+/**
+  ******************************************************************************
+  * @file 		HSI_TRIM.c
+	* @author		SINOMCU-AE
+  * @brief 		HSI frequency trimming against a timing reference
+  *
+  *          This file provides the HSI trimming service:
+  *             TIM14 counts the timer clock (from HSI) between captures of
+  *             every 8th reference edge; HSI_TRIM_CAPTURES intervals make a
+  *             measurement, compared with the count a nominal HSI gives;
+  *             the error, rounded to whole HSITRIM steps, is taken off the
+  *             trim (at most HSI_TRIM_MAX_STEPS at a time);
+  *             after HSI_TRIM_SETTLE measurements without a step the trim
+  *             is appended to the flash page when it differs from the
+  *             saved one, the page is erased when full.
+  *
+  *          Nothing is measured while SYSCLK comes from HSE.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSI_TRIM.h"
+#include "GPIO_CFG.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Record: low half 0xA5 and the trim, high half its complement */
+#define HSI_TRIM_TAG                0xA500U
+#define HSI_TRIM_RECORD(T)          ((((HSI_TRIM_TAG | (T)) ^ 0xFFFFUL) << 16) | HSI_TRIM_TAG | (T))
+#define HSI_TRIM_RECORD_OK(W)       ((((W) >> 16) == (((W) & 0xFFFFUL) ^ 0xFFFFUL)) && \
+                                     (((W) & 0xFF00UL) == HSI_TRIM_TAG) && (((W) & 0xFFUL) <= HSI_TRIM_MAX))
+#define HSI_TRIM_RECORDS            (HSI_TRIM_FLASH_PAGE_SIZE / 4U)
+#define HSI_TRIM_ERASED             0xFFFFFFFFUL
+
+/* Variables -----------------------------------------------------------------*/
+#if defined (__CC_ARM) || defined (__ARMCC_VERSION)
+/* end of the image in flash, from the linker */
+extern const uint32_t Load$$LR$$LR_IROM1$$Limit;
+#endif
+
+static uint8_t SavedTrim = 0xFF;
+static uint32_t StartTick;
+
+#if HSI_TRIM_REF != 2
+static __IO uint8_t Running;
+static __IO uint8_t Done;
+static __IO uint8_t Overrun;
+static uint16_t Captures;
+static uint16_t LastCapture;
+static uint32_t Counts;
+#else
+static uint32_t FeedMeasured;
+static uint32_t FeedExpected;
+#endif
+
+static HsiTrim_StatsTypeDef TrimStats;
+
+/**
+  * @brief Last saved trim, or 0xFF
+  * @param None
+  * @retval trim value
+  */
+static uint8_t HsiTrim_Load(void)
+{
+  const uint32_t *rec = (const uint32_t *)HSI_TRIM_FLASH_ADDR;
+  uint8_t trim = 0xFF;
+  uint32_t i;
+
+  for (i = 0; (i < HSI_TRIM_RECORDS) && (rec[i] != HSI_TRIM_ERASED); i++)
+  {
+    if (HSI_TRIM_RECORD_OK(rec[i]))
+    {
+      trim = (uint8_t)rec[i];
+    }
+  }
+  return trim;
+}
+
+/**
+  * @brief Write HSITRIM
+  * @param Trim 0~HSI_TRIM_MAX
+  * @retval None
+  */
+static void HsiTrim_Write(uint8_t Trim)
+{
+  __disable_irq();
+  MODIFY_REG(RCC->CR, RCC_CR_HSITRIM, (uint32_t)Trim << RCC_CR_HSITRIM_Pos);
+  __enable_irq();
+  TrimStats.Trim = Trim;
+}
+
+/**
+  * @brief Append a trim record, erase the page first when it is full
+  * @param Trim 0~HSI_TRIM_MAX
+  * @retval None
+  * @note the core stalls on flash while programming, about 20ms on an erase
+  */
+static void HsiTrim_Save(uint8_t Trim)
+{
+  const uint32_t *rec = (const uint32_t *)HSI_TRIM_FLASH_ADDR;
+  uint32_t word = HSI_TRIM_RECORD((uint32_t)Trim);
+  uint32_t i;
+
+#if defined (__CC_ARM) || defined (__ARMCC_VERSION)
+  if ((uint32_t)&Load$$LR$$LR_IROM1$$Limit > HSI_TRIM_FLASH_ADDR)
+  {
+    TrimStats.SaveErrors++;
+    return;
+  }
+#endif
+  for (i = 0; (i < HSI_TRIM_RECORDS) && (rec[i] != HSI_TRIM_ERASED); i++)
+  {
+  }
+  if (i == HSI_TRIM_RECORDS)
+  {
+    if (MS32_FLASH_PageErase(HSI_TRIM_FLASH_PAGE) != SUCCESS)
+    {
+      TrimStats.SaveErrors++;
+      return;
+    }
+    i = 0;
+  }
+  if (MS32_FLASH_Write(HSI_TRIM_FLASH_ADDR + (i * 4U), (uint8_t *)&word, 4) != SUCCESS)
+  {
+    TrimStats.SaveErrors++;
+    return;
+  }
+  SavedTrim = Trim;
+  TrimStats.Saves++;
+}
+
+/**
+  * @brief One control step
+  * @param Measured timer clock counts over the reference interval
+  * @param Expected counts a nominal HSI gives over the same interval
+  * @retval None
+  */
+static void HsiTrim_Update(uint32_t Measured, uint32_t Expected)
+{
+  int32_t err;
+  int32_t steps;
+  int32_t trim;
+
+  err = (int32_t)((((int64_t)Measured - (int64_t)Expected) * 1000000) / (int64_t)Expected);
+  TrimStats.LastErrorPpm = err;
+  TrimStats.Measurements++;
+
+  steps = (err >= 0) ? ((err + (HSI_TRIM_STEP_PPM / 2)) / HSI_TRIM_STEP_PPM) :
+                       ((err - (HSI_TRIM_STEP_PPM / 2)) / HSI_TRIM_STEP_PPM);
+  if (steps > HSI_TRIM_MAX_STEPS)
+  {
+    steps = HSI_TRIM_MAX_STEPS;
+  }
+  else if (steps < -HSI_TRIM_MAX_STEPS)
+  {
+    steps = -HSI_TRIM_MAX_STEPS;
+  }
+
+  /* fast HSI: lower trim */
+  trim = (int32_t)TrimStats.Trim - steps;
+  if (trim < 0)
+  {
+    trim = 0;
+  }
+  else if (trim > (int32_t)HSI_TRIM_MAX)
+  {
+    trim = HSI_TRIM_MAX;
+  }
+
+  if (trim != (int32_t)TrimStats.Trim)
+  {
+    HsiTrim_Write((uint8_t)trim);
+    TrimStats.Adjusts++;
+    TrimStats.Settled = 0;
+    return;
+  }
+  if (TrimStats.Settled < HSI_TRIM_SETTLE)
+  {
+    TrimStats.Settled++;
+  }
+  if ((TrimStats.Settled == HSI_TRIM_SETTLE) && (TrimStats.Trim != SavedTrim))
+  {
+    HsiTrim_Save(TrimStats.Trim);
+  }
+}
+
+/**
+  * @brief SYSCLK comes from HSI, directly or through the PLL
+  * @param None
+  * @retval 1 on HSI
+  */
+static uint8_t HsiTrim_OnHsi(void)
+{
+  uint32_t sws = RCC->CFGR & RCC_CFGR_SWS;
+
+  if (sws == RCC_CFGR_SWS_HSE)
+  {
+    return 0;
+  }
+  if ((sws == RCC_CFGR_SWS_PLL) && ((RCC->CFGR & RCC_CFGR_PLLSRC) == RCC_CFGR_PLLSRC_HSE_PREDIV))
+  {
+    return 0;
+  }
+  return 1;
+}
+
+/**
+  * @brief Put the saved trim back
+  * @param None
+  * @retval None
+  * @note call by SystemInit_EarlyHook() first; flash and registers only
+  */
+void HsiTrim_Restore(void)
+{
+  uint8_t trim = HsiTrim_Load();
+
+  if (trim <= HSI_TRIM_MAX)
+  {
+    MODIFY_REG(RCC->CR, RCC_CR_HSITRIM, (uint32_t)trim << RCC_CR_HSITRIM_Pos);
+  }
+}
+
+/**
+  * @brief Reference input and TIM14 setup
+  * @param None
+  * @retval None
+  * @note with HSI_TRIM_REF 0 the LSE is started here and measurements
+  *       wait for LSERDY; the RTC clock is only selected when none is
+  */
+void HsiTrim_Init(void)
+{
+#if HSI_TRIM_REF == 1
+  static const GPIO_PinCfgTypeDef RefPin[] =
+  {
+    {GPIOB, MS32_GPIO_PIN_1, MS32_GPIO_MODE_ALTERNATE, MS32_GPIO_OUTPUT_PUSHPULL, MS32_GPIO_SPEED_LOW, MS32_GPIO_PULL_NO, MS32_GPIO_AF_0},
+  };
+#endif
+
+  SavedTrim = HsiTrim_Load();
+  TrimStats.Trim = (uint8_t)((RCC->CR & RCC_CR_HSITRIM) >> RCC_CR_HSITRIM_Pos);
+  StartTick = SysTick_GetTick();
+
+#if HSI_TRIM_REF == 0
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_PWR);
+  MS32_PWR_EnableBkUpAccess();
+  MS32_RCC_LSE_Enable();
+  if (MS32_RCC_GetRTCClockSource() == MS32_RCC_RTC_CLKSOURCE_NONE)
+  {
+    MS32_RCC_SetRTCClockSource(MS32_RCC_RTC_CLKSOURCE_LSE);
+  }
+#elif HSI_TRIM_REF == 1
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
+  GPIO_ApplyTable(RefPin, 1);
+#endif
+
+#if HSI_TRIM_REF != 2
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_TIM14);
+  MS32_TIM_SetPrescaler(TIM14, 0);
+  MS32_TIM_SetAutoReload(TIM14, 0xFFFF);
+#if HSI_TRIM_REF == 0
+  MS32_TIM_SetRemap(TIM14, MS32_TIM_TIM14_TI1_RMP_RTC_CLK);
+#else
+  MS32_TIM_SetRemap(TIM14, MS32_TIM_TIM14_TI1_RMP_GPIO);
+#endif
+  MS32_TIM_IC_Config(TIM14, MS32_TIM_CHANNEL_CH1, MS32_TIM_ACTIVEINPUT_DIRECTTI | MS32_TIM_ICPSC_DIV8 |
+                                                  MS32_TIM_IC_FILTER_FDIV1 | MS32_TIM_IC_POLARITY_RISING);
+  MS32_TIM_CC_EnableChannel(TIM14, MS32_TIM_CHANNEL_CH1);
+  MS32_TIM_GenerateEvent_UPDATE(TIM14);
+  MS32_TIM_EnableCounter(TIM14);
+
+  NVIC_SetPriority(TIM14_IRQn, 0x1);
+  NVIC_EnableIRQ(TIM14_IRQn);
+#endif
+}
+
+/**
+  * @brief Start measurements and apply the results, call periodically
+  * @param None
+  * @retval None
+  */
+void HsiTrim_Poll(void)
+{
+#if HSI_TRIM_REF != 2
+  uint32_t timclk;
+  uint32_t expected;
+
+  if (Done)
+  {
+    Done = 0;
+    Running = 0;
+    StartTick = SysTick_GetTick();
+    if (Overrun)
+    {
+      TrimStats.Overcaptures++;
+      return;
+    }
+    timclk = ClockPlan_TimClkHz();
+    expected = (uint32_t)(((uint64_t)timclk * (HSI_TRIM_CAPTURES * 8U)) / HSI_TRIM_REF_HZ);
+    HsiTrim_Update(Counts, expected);
+    return;
+  }
+  if (Running || ((SysTick_GetTick() - StartTick) < HSI_TRIM_PERIOD_MS) || !HsiTrim_OnHsi())
+  {
+    return;
+  }
+#if HSI_TRIM_REF == 0
+  if (!MS32_RCC_LSE_IsReady())
+  {
+    return;
+  }
+#endif
+  Captures = 0;
+  Counts = 0;
+  Overrun = 0;
+  Running = 1;
+  MS32_TIM_ClearFlag_CC1OVR(TIM14);
+  MS32_TIM_ClearFlag_CC1(TIM14);
+  MS32_TIM_EnableIT_CC1(TIM14);
+#else
+  uint32_t measured;
+  uint32_t expected;
+
+  __disable_irq();
+  measured = FeedMeasured;
+  expected = FeedExpected;
+  if (expected >= HSI_TRIM_FEED_COUNTS)
+  {
+    FeedMeasured = 0;
+    FeedExpected = 0;
+  }
+  __enable_irq();
+  if ((expected >= HSI_TRIM_FEED_COUNTS) && HsiTrim_OnHsi())
+  {
+    HsiTrim_Update(measured, expected);
+    /* counts taken on the old trim are dropped */
+    __disable_irq();
+    FeedMeasured = 0;
+    FeedExpected = 0;
+    __enable_irq();
+  }
+#endif
+}
+
+/**
+  * @brief Add a measurement from another timing reference
+  * @param Measured timer / kernel clock counts over the reference interval
+  * @param Expected counts a nominal HSI gives over the same interval
+  * @retval None
+  * @note HSI_TRIM_REF 2 only; may be called from an interrupt
+  */
+void HsiTrim_Feed(uint32_t Measured, uint32_t Expected)
+{
+#if HSI_TRIM_REF == 2
+  FeedMeasured += Measured;
+  FeedExpected += Expected;
+#else
+  (void)Measured;
+  (void)Expected;
+#endif
+}
+
+/**
+  * @brief Read the trimming statistics
+  * @param Stats pointer to a HsiTrim_StatsTypeDef structure
+  * @retval None
+  */
+void HsiTrim_GetStats(HsiTrim_StatsTypeDef *Stats)
+{
+  *Stats = TrimStats;
+}
+
+/**
+  * @brief Reference capture: sum the intervals of one measurement
+  * @param None
+  * @retval None
+  * @note call by TIM14_IRQHandler()
+  */
+void HsiTrim_TIM14_IRQHandler(void)
+{
+#if HSI_TRIM_REF != 2
+  uint16_t capture;
+
+  if (!MS32_TIM_IsActiveFlag_CC1(TIM14))
+  {
+    return;
+  }
+  capture = (uint16_t)MS32_TIM_IC_GetCaptureCH1(TIM14);
+  if (MS32_TIM_IsActiveFlag_CC1OVR(TIM14))
+  {
+    MS32_TIM_ClearFlag_CC1OVR(TIM14);
+    Overrun = 1;
+  }
+  if (Captures != 0)
+  {
+    Counts += (uint16_t)(capture - LastCapture);
+  }
+  LastCapture = capture;
+  if (++Captures > HSI_TRIM_CAPTURES)
+  {
+    MS32_TIM_DisableIT_CC1(TIM14);
+    Done = 1;
+  }
+#endif
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    HSI_TRIM.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of HSI_TRIM.c file.
+  *
+  *          HSI closed loop trimming against a reference:
+  *             HSI_TRIM_REF 0  ------> LSE (RTC clock) on TIM14 TI1
+  *             HSI_TRIM_REF 1  ------> pulse on PB1 (TIM14_CH1, AF0)
+  *             HSI_TRIM_REF 2  ------> counts fed by HsiTrim_Feed(),
+  *                                     e.g. LIN sync fields (LIN_SLAVE_HSI_TRIM)
+  *          The settled HSITRIM is kept in the last flash page and written
+  *          back by HsiTrim_Restore() in SystemInit_EarlyHook(), before the
+  *          PLL starts.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSI_TRIM_H
+#define __HSI_TRIM_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "CLOCK_PLAN.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#ifndef HSI_TRIM_REF
+#define HSI_TRIM_REF                0
+#endif
+/* Reference frequency for HSI_TRIM_REF 0 / 1 */
+#define HSI_TRIM_REF_HZ             32768U
+/* Capture intervals per measurement, 8 reference periods each (ICPSC /8) */
+#define HSI_TRIM_CAPTURES           256U
+/* Expected counts per measurement with HSI_TRIM_REF 2 */
+#define HSI_TRIM_FEED_COUNTS        250000U
+/* Time between two measurements */
+#define HSI_TRIM_PERIOD_MS          1000U
+
+/* HSITRIM: 5 bits, 16 = factory value, about 0.4% a step */
+#define HSI_TRIM_DEFAULT            16U
+#define HSI_TRIM_MAX                31U
+#define HSI_TRIM_STEP_PPM           4000
+/* Largest correction per measurement, limits a bad reference */
+#define HSI_TRIM_MAX_STEPS          4
+/* Measurements inside +-HSI_TRIM_STEP_PPM / 2 before the trim is saved */
+#define HSI_TRIM_SETTLE             4U
+
+/* Trim records, 4 bytes each, in the last flash page */
+#define HSI_TRIM_FLASH_PAGE         31U
+#define HSI_TRIM_FLASH_PAGE_SIZE    0x400U
+#define HSI_TRIM_FLASH_ADDR         (FLASH_BASE + (HSI_TRIM_FLASH_PAGE * HSI_TRIM_FLASH_PAGE_SIZE))
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Measurements;
+  uint32_t Adjusts;         /* HSITRIM changed */
+  uint32_t Overcaptures;    /* capture lost, measurement dropped */
+  uint32_t Saves;
+  uint32_t SaveErrors;      /* flash error, or the page is used by the image */
+  int32_t  LastErrorPpm;    /* HSI against the reference, + is fast */
+  uint8_t  Trim;            /* HSITRIM now */
+  uint8_t  Settled;         /* measurements in a row without correction */
+} HsiTrim_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void HsiTrim_Restore(void);
+void HsiTrim_Init(void);
+void HsiTrim_Poll(void);
+void HsiTrim_Feed(uint32_t Measured, uint32_t Expected);
+void HsiTrim_GetStats(HsiTrim_StatsTypeDef *Stats);
+
+void HsiTrim_TIM14_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+#if (HSI_TRIM_REF < 0) || (HSI_TRIM_REF > 2)
+#error "HSI_TRIM_REF: 0 LSE, 1 PB1 pulse, 2 HsiTrim_Feed()"
+#endif
+/* one capture interval must fit the 16 bit counter at the fastest timer clock */
+#if (HSI_TRIM_REF != 2) && ((CLOCK_PLAN_SYSCLK_MAX / HSI_TRIM_REF_HZ) * 8U >= 65536U)
+#error "HSI_TRIM_REF_HZ too low for a 16 bit capture interval at 48MHz"
+#endif
+
+#endif /* __HSI_TRIM_H */
+
+/******************************** END OF FILE *********************************/
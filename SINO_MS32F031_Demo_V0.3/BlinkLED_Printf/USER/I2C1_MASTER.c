@@ -0,0 +1,526 @@
+/**
+  ******************************************************************************
+  * @file 		I2C1_MASTER.c
+	* @author		SINOMCU-AE
+  * @brief 		I2C1 master transaction queue over DMA
+  *
+  *          This file provides a queued, non-blocking I2C1 master:
+  *             every I2C1_XferTypeDef is one bus transaction, write phase
+  *             then repeated start read phase, bytes moved by DMA1
+  *             Channel2 (TX) / Channel3 (RX);
+  *             phases longer than 255 bytes run in RELOAD mode, the DMA
+  *             channel keeps the full length and only NBYTES is reloaded;
+  *             the last phase uses AUTOEND, so the STOP interrupt ends the
+  *             transaction, starts the next queued one and runs the callback.
+  *          NACK and bus errors end the transaction with I2C1_XFER_NACK /
+  *          I2C1_XFER_ERROR; I2C1_Master_Poll() aborts a transaction that
+  *          overruns I2C1_MASTER_TIMEOUT_MS and clocks a stuck slave off
+  *          SDA (up to 9 SCL pulses and a STOP).
+  *
+  *          Needed call I2C1_Master_IRQHandler() in I2C1_IRQHandler() and
+  *          I2C1_Master_Poll() in the main loop.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "I2C1_MASTER.h"
+#include "SysTick_Delay.h"
+#include "CLOCK_SCALE.h"
+
+/* Private define ------------------------------------------------------------*/
+#define I2C_QUEUE_MASK              (I2C1_MASTER_QUEUE_DEPTH - 1U)
+#define I2C_NBYTES_MAX              255U
+
+#define I2C_SCL_PIN                 MS32_GPIO_PIN_6
+#define I2C_SDA_PIN                 MS32_GPIO_PIN_7
+/* Half SCL period of the recovery pulses, 100kHz or slower */
+#define I2C_RECOVERY_HALF_US        5U
+
+/* Variables -----------------------------------------------------------------*/
+static I2C1_XferTypeDef *Queue[I2C1_MASTER_QUEUE_DEPTH];
+static uint32_t QueueIn;
+static uint32_t QueueOut;
+static I2C1_XferTypeDef * __IO Active;
+
+static uint8_t ReadPhase;         /* 0: write phase, 1: read phase */
+static uint16_t Remaining;        /* bytes of the phase not yet given to NBYTES */
+static uint8_t Result;            /* status reported when STOP is detected */
+static uint8_t Enabled;
+
+static uint32_t StartUs;
+static uint32_t StartTick;
+static uint32_t BusyTick;
+static I2C1_MasterStatsTypeDef I2cStats;
+
+/**
+  * @brief Program NBYTES for the next chunk of the current phase
+  * @param Request MS32_I2C_GENERATE_START_xxx for a new phase,
+  *        MS32_I2C_GENERATE_NOSTARTSTOP after TCR
+  * @retval None
+  */
+static void I2C1_Master_NextChunk(uint32_t Request)
+{
+  I2C1_XferTypeDef *xfer = Active;
+  uint32_t chunk;
+  uint32_t end;
+
+  chunk = (Remaining > I2C_NBYTES_MAX) ? I2C_NBYTES_MAX : Remaining;
+  Remaining -= (uint16_t)chunk;
+
+  if (Remaining != 0U)
+  {
+    end = MS32_I2C_MODE_RELOAD;
+  }
+  else if ((ReadPhase == 0U) && (xfer->RxLen != 0U))
+  {
+    /* hold SCL low after the write phase, TC starts the read */
+    end = MS32_I2C_MODE_SOFTEND;
+  }
+  else
+  {
+    end = MS32_I2C_MODE_AUTOEND;
+  }
+
+  MS32_I2C_HandleTransfer(I2C1, (uint32_t)xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                          chunk, end, Request);
+}
+
+/**
+  * @brief Start the write or read phase of the active transaction
+  * @param Read 0: write phase, 1: read phase
+  * @retval None
+  */
+static void I2C1_Master_StartPhase(uint8_t Read)
+{
+  I2C1_XferTypeDef *xfer = Active;
+
+  ReadPhase = Read;
+  if (Read == 0U)
+  {
+    Remaining = xfer->TxLen;
+    if (Remaining != 0U)
+    {
+      MS32_DMA_DisableChannel(DMA1, I2C1_MASTER_TX_DMA_CHANNEL);
+      MS32_DMA_SetMemoryAddress(DMA1, I2C1_MASTER_TX_DMA_CHANNEL, (uint32_t)xfer->TxBuf);
+      MS32_DMA_SetDataLength(DMA1, I2C1_MASTER_TX_DMA_CHANNEL, Remaining);
+      MS32_DMA_EnableChannel(DMA1, I2C1_MASTER_TX_DMA_CHANNEL);
+    }
+    I2C1_Master_NextChunk(MS32_I2C_GENERATE_START_WRITE);
+  }
+  else
+  {
+    Remaining = xfer->RxLen;
+    MS32_DMA_DisableChannel(DMA1, I2C1_MASTER_RX_DMA_CHANNEL);
+    MS32_DMA_SetMemoryAddress(DMA1, I2C1_MASTER_RX_DMA_CHANNEL, (uint32_t)xfer->RxBuf);
+    MS32_DMA_SetDataLength(DMA1, I2C1_MASTER_RX_DMA_CHANNEL, Remaining);
+    MS32_DMA_EnableChannel(DMA1, I2C1_MASTER_RX_DMA_CHANNEL);
+    /* after SOFTEND a START is a repeated start */
+    I2C1_Master_NextChunk(MS32_I2C_GENERATE_START_READ);
+  }
+}
+
+/**
+  * @brief Start the oldest queued transaction if the bus is free
+  * @param None
+  * @retval None
+  * @note call with interrupts disabled or from the I2C1 interrupt
+  */
+static void I2C1_Master_Start(void)
+{
+  I2C1_XferTypeDef *xfer;
+
+  if ((Active != 0) || (QueueIn == QueueOut))
+  {
+    return;
+  }
+  xfer = Queue[QueueOut & I2C_QUEUE_MASK];
+  QueueOut++;
+  Active = xfer;
+  xfer->Status = I2C1_XFER_ACTIVE;
+  Result = I2C1_XFER_DONE;
+
+  StartUs = SysTick_GetUs();
+  StartTick = SysTick_GetTick();
+  /* TxLen 0 and RxLen 0 is an address only probe */
+  I2C1_Master_StartPhase(((xfer->TxLen == 0U) && (xfer->RxLen != 0U)) ? 1U : 0U);
+}
+
+/**
+  * @brief End the active transaction and start the next one
+  * @param Status I2C1_XFER_DONE, I2C1_XFER_NACK or I2C1_XFER_ERROR
+  * @retval None
+  * @note call with interrupts disabled or from the I2C1 interrupt
+  */
+static void I2C1_Master_Finish(uint8_t Status)
+{
+  I2C1_XferTypeDef *xfer = Active;
+
+  MS32_DMA_DisableChannel(DMA1, I2C1_MASTER_TX_DMA_CHANNEL);
+  MS32_DMA_DisableChannel(DMA1, I2C1_MASTER_RX_DMA_CHANNEL);
+  /* a byte left in TXDR by a NACK would go out in the next transaction */
+  MS32_I2C_ClearFlag_TXE(I2C1);
+
+  if (xfer == 0)
+  {
+    return;
+  }
+
+  I2cStats.BusyUs += SysTick_GetUs() - StartUs;
+  I2cStats.Transfers++;
+  if (Status == I2C1_XFER_DONE)
+  {
+    I2cStats.Bytes += (uint32_t)xfer->TxLen + xfer->RxLen;
+  }
+  else if (Status == I2C1_XFER_NACK)
+  {
+    I2cStats.Nacks++;
+  }
+  else
+  {
+    I2cStats.Errors++;
+  }
+
+  Active = 0;
+  xfer->Status = Status;
+
+  /* keep the bus busy before spending time in the callback */
+  I2C1_Master_Start();
+  if (xfer->Callback != 0)
+  {
+    xfer->Callback(xfer);
+  }
+}
+
+/**
+  * @brief Clock a slave that holds SDA low out of its byte, then STOP
+  * @param None
+  * @retval None
+  * @note I2C1 must be disabled, pins are given back to I2C1 on return
+  */
+static void I2C1_Master_RecoverBus(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  uint32_t pulse;
+  uint32_t t0;
+
+  I2cStats.Recoveries++;
+
+  MS32_GPIO_SetOutputPin(GPIOB, I2C_SCL_PIN | I2C_SDA_PIN);
+  GPIO_InitStruct.Pin = I2C_SCL_PIN | I2C_SDA_PIN;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_OUTPUT;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_OPENDRAIN;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  /* 9 clocks cover the worst case: slave driving a 0 data bit */
+  for (pulse = 0; (pulse < 9U) && !MS32_GPIO_IsInputPinSet(GPIOB, I2C_SDA_PIN); pulse++)
+  {
+    MS32_GPIO_ResetOutputPin(GPIOB, I2C_SCL_PIN);
+    t0 = SysTick_GetUs();
+    while ((SysTick_GetUs() - t0) < I2C_RECOVERY_HALF_US)
+    {
+    }
+    MS32_GPIO_SetOutputPin(GPIOB, I2C_SCL_PIN);
+    t0 = SysTick_GetUs();
+    while ((SysTick_GetUs() - t0) < I2C_RECOVERY_HALF_US)
+    {
+    }
+  }
+
+  /* STOP: SDA low to high while SCL is high */
+  MS32_GPIO_ResetOutputPin(GPIOB, I2C_SCL_PIN);
+  MS32_GPIO_ResetOutputPin(GPIOB, I2C_SDA_PIN);
+  t0 = SysTick_GetUs();
+  while ((SysTick_GetUs() - t0) < I2C_RECOVERY_HALF_US)
+  {
+  }
+  MS32_GPIO_SetOutputPin(GPIOB, I2C_SCL_PIN);
+  t0 = SysTick_GetUs();
+  while ((SysTick_GetUs() - t0) < I2C_RECOVERY_HALF_US)
+  {
+  }
+  MS32_GPIO_SetOutputPin(GPIOB, I2C_SDA_PIN);
+
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+}
+
+/**
+  * @brief I2C1 master Initialization Function
+  * @param None
+  * @retval None
+  * @note 7 bit addressing, SCL set by I2C1_MASTER_TIMING (I2C1_TIMING.h)
+  */
+void I2C1_Master_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_I2C_InitTypeDef I2C_InitStruct;
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
+  MS32_RCC_SetI2CClockSource(I2C1_TIMING_CLKSOURCE);
+#if I2C1_TIMING_SPEED_HZ > 400000
+  /* fast mode plus drive on PB6 / PB7 */
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_SYSCFG);
+  MS32_SYSCFG_EnableFastModePlus(MS32_SYSCFG_I2C_FASTMODEPLUS_PB6 | MS32_SYSCFG_I2C_FASTMODEPLUS_PB7);
+#endif
+  /**I2C1 GPIO Configuration
+  PB6   ------> I2C1_SCL
+  PB7   ------> I2C1_SDA
+  */
+  GPIO_InitStruct.Pin = I2C_SCL_PIN | I2C_SDA_PIN;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_OPENDRAIN;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  MS32_I2C_StructInit(&I2C_InitStruct);
+  I2C_InitStruct.PeripheralMode = MS32_I2C_MODE_I2C;
+  I2C_InitStruct.Timing = I2C1_MASTER_TIMING;
+  MS32_I2C_Init(I2C1, &I2C_InitStruct);
+  MS32_I2C_Disable(I2C1);
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_I2C_DMA_GetRegAddr(I2C1, MS32_I2C_DMA_REG_DATA_TRANSMIT);
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_MEMORY_TO_PERIPH;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_NORMAL;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.PeriphOrM2MSrcDataSize = MS32_DMA_PDATAALIGN_BYTE;
+  DMA_InitStruct.MemoryOrM2MDstDataSize = MS32_DMA_MDATAALIGN_BYTE;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_MEDIUM;
+  MS32_DMA_DisableChannel(DMA1, I2C1_MASTER_TX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, I2C1_MASTER_TX_DMA_CHANNEL, &DMA_InitStruct);
+
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_I2C_DMA_GetRegAddr(I2C1, MS32_I2C_DMA_REG_DATA_RECEIVE);
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_PERIPH_TO_MEMORY;
+  MS32_DMA_DisableChannel(DMA1, I2C1_MASTER_RX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, I2C1_MASTER_RX_DMA_CHANNEL, &DMA_InitStruct);
+
+  QueueIn = 0;
+  QueueOut = 0;
+  Active = 0;
+  BusyTick = SysTick_GetTick();
+
+  MS32_I2C_EnableDMAReq_TX(I2C1);
+  MS32_I2C_EnableDMAReq_RX(I2C1);
+  /* TC also covers TCR; ERR covers ARLO and BERR */
+  MS32_I2C_EnableIT_TC(I2C1);
+  MS32_I2C_EnableIT_STOP(I2C1);
+  MS32_I2C_EnableIT_NACK(I2C1);
+  MS32_I2C_EnableIT_ERR(I2C1);
+  NVIC_SetPriority(I2C1_IRQn, 0x1);
+  NVIC_EnableIRQ(I2C1_IRQn);
+
+  Enabled = 1;
+  MS32_I2C_Enable(I2C1);
+}
+
+/**
+  * @brief Queue a transaction, it starts at once when the bus is free
+  * @param Xfer transaction descriptor, TxLen and RxLen 0~65535
+  * @retval SUCCESS queued, ERROR queue full or missing buffer
+  * @note may be called from the completion callback
+  */
+ErrorStatus I2C1_Master_Submit(I2C1_XferTypeDef *Xfer)
+{
+  if (((Xfer->TxLen != 0U) && (Xfer->TxBuf == 0)) ||
+      ((Xfer->RxLen != 0U) && (Xfer->RxBuf == 0)))
+  {
+    return ERROR;
+  }
+
+  __disable_irq();
+  if ((QueueIn - QueueOut) >= I2C1_MASTER_QUEUE_DEPTH)
+  {
+    I2cStats.QueueFull++;
+    __enable_irq();
+    return ERROR;
+  }
+  Xfer->Status = I2C1_XFER_QUEUED;
+  Queue[QueueIn & I2C_QUEUE_MASK] = Xfer;
+  QueueIn++;
+  I2C1_Master_Start();
+  __enable_irq();
+
+  return SUCCESS;
+}
+
+/**
+  * @brief Abort a hung transaction and free a stuck bus
+  * @param None
+  * @retval None
+  * @note call by main loop; a transaction older than I2C1_MASTER_TIMEOUT_MS,
+  *       or BUSY for as long with nothing active, triggers the recovery
+  */
+void I2C1_Master_Poll(void)
+{
+  uint32_t now = SysTick_GetTick();
+  uint8_t stuck = 0;
+
+  __disable_irq();
+  if (Active != 0)
+  {
+    if ((now - StartTick) > I2C1_MASTER_TIMEOUT_MS)
+    {
+      I2cStats.Timeouts++;
+      stuck = 1;
+    }
+  }
+  else if (!MS32_I2C_IsActiveFlag_BUSY(I2C1))
+  {
+    BusyTick = now;
+  }
+  else if ((now - BusyTick) > I2C1_MASTER_TIMEOUT_MS)
+  {
+    stuck = 1;
+  }
+
+  if (stuck != 0U)
+  {
+    /* PE = 0 resets the state machine and releases SCL / SDA */
+    MS32_I2C_Disable(I2C1);
+    I2C1_Master_RecoverBus();
+    MS32_I2C_Enable(I2C1);
+    BusyTick = now;
+    I2C1_Master_Finish(I2C1_XFER_ERROR);
+  }
+  __enable_irq();
+}
+
+/**
+  * @brief Check that nothing is queued or on the bus
+  * @param None
+  * @retval 1 idle, 0 busy
+  */
+uint8_t I2C1_Master_IsIdle(void)
+{
+  return ((Active == 0) && (QueueIn == QueueOut)) ? 1U : 0U;
+}
+
+/**
+  * @brief I2C1 event / error interrupt
+  * @param None
+  * @retval None
+  * @note call by I2C1_IRQHandler()
+  */
+void I2C1_Master_IRQHandler(void)
+{
+  if (Enabled == 0U)
+  {
+    return;
+  }
+  if (MS32_I2C_IsActiveFlag_ARLO(I2C1) || MS32_I2C_IsActiveFlag_BERR(I2C1))
+  {
+    /* no STOP will follow: reset the state machine and end here */
+    MS32_I2C_ClearFlag_ARLO(I2C1);
+    MS32_I2C_ClearFlag_BERR(I2C1);
+    MS32_I2C_Disable(I2C1);
+    MS32_I2C_ClearFlag_NACK(I2C1);
+    MS32_I2C_ClearFlag_STOP(I2C1);
+    MS32_I2C_Enable(I2C1);
+    I2C1_Master_Finish(I2C1_XFER_ERROR);
+    return;
+  }
+
+  if (MS32_I2C_IsActiveFlag_NACK(I2C1))
+  {
+    MS32_I2C_ClearFlag_NACK(I2C1);
+    Result = I2C1_XFER_NACK;
+    /* AUTOEND sends STOP by itself, RELOAD / SOFTEND need it by hand */
+    if (!MS32_I2C_IsEnabledAutoEndMode(I2C1))
+    {
+      MS32_I2C_GenerateStopCondition(I2C1);
+    }
+  }
+
+  if (MS32_I2C_IsActiveFlag_STOP(I2C1))
+  {
+    MS32_I2C_ClearFlag_STOP(I2C1);
+    I2C1_Master_Finish(Result);
+    return;
+  }
+
+  if (Active == 0)
+  {
+    return;
+  }
+
+  if (MS32_I2C_IsActiveFlag_TCR(I2C1))
+  {
+    /* NBYTES done, more of the same phase */
+    I2C1_Master_NextChunk(MS32_I2C_GENERATE_NOSTARTSTOP);
+  }
+  else if (MS32_I2C_IsActiveFlag_TC(I2C1))
+  {
+    /* write phase done under SOFTEND */
+    I2C1_Master_StartPhase(1U);
+  }
+}
+
+/**
+  * @brief Read the transfer statistics
+  * @param Stats pointer to a I2C1_MasterStatsTypeDef structure
+  * @retval None
+  * @note bus utilisation = BusyUs / elapsed time,
+  *       throughput = Bytes * 1000000 / BusyUs bytes per second
+  */
+void I2C1_Master_GetStats(I2C1_MasterStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = I2cStats;
+  __enable_irq();
+}
+
+/**
+  * @brief CLOCK_SCALE re-timing: TIMINGR follows SYSCLK when it clocks I2C1
+  * @param Phase CLOCK_SCALE_PRE or CLOCK_SCALE_POST
+  * @param Sysclk new SYSCLK in Hz
+  * @retval None
+  * @note register with ClockScale_Register(); with I2CCLK = HSI (default)
+  *       the bus timing does not depend on SYSCLK and nothing is done
+  */
+void I2C1_Master_ClockCallback(uint8_t Phase, uint32_t Sysclk)
+{
+#if I2C1_TIMING_USE_SYSCLK
+  uint32_t tick;
+
+  if (Phase == CLOCK_SCALE_PRE)
+  {
+    /* let the queue finish on the old timing */
+    tick = SysTick_GetTick();
+    while (!I2C1_Master_IsIdle() &&
+           ((SysTick_GetTick() - tick) < (I2C1_MASTER_TIMEOUT_MS * I2C1_MASTER_QUEUE_DEPTH)))
+    {
+    }
+    return;
+  }
+
+  /* TIMINGR is written with PE = 0 */
+  MS32_I2C_Disable(I2C1);
+  MS32_I2C_SetTiming(I2C1, (Sysclk == HSI_VALUE) ? I2C1_TIMING_HSI :
+                           (Sysclk == CLOCK_PLAN_SYSCLK_HZ) ? I2C1_MASTER_TIMING : I2C1_TIMING_BACKUP);
+  MS32_I2C_Enable(I2C1);
+#else
+  (void)Phase;
+  (void)Sysclk;
+#endif
+}
+
+/******************************** END OF FILE *********************************/
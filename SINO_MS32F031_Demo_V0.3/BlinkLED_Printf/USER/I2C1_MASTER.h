@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    I2C1_MASTER.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of I2C1_MASTER.c file.
+  *
+  *          This file describes the I2C1 master path:
+  *             PB6   ------> I2C1_SCL
+  *             PB7   ------> I2C1_SDA
+  *             I2C1_TX ------> DMA1 Channel2
+  *             I2C1_RX ------> DMA1 Channel3
+  *          One transaction: START addr+W, TxLen bytes, RESTART addr+R,
+  *          RxLen bytes, STOP; either phase may be empty.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __I2C1_MASTER_H
+#define __I2C1_MASTER_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "I2C1_TIMING.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* TIMINGR from I2C1_TIMING.h: I2C1_TIMING_SPEED_HZ, rise / fall time, I2CCLK */
+#define I2C1_MASTER_TIMING          I2C1_TIMING
+
+/* Queued transactions, must be a power of 2 */
+#define I2C1_MASTER_QUEUE_DEPTH     8U
+/* A transaction still active after this is aborted and the bus recovered */
+#define I2C1_MASTER_TIMEOUT_MS      10U
+
+#define I2C1_MASTER_TX_DMA_CHANNEL  MS32_DMA_CHANNEL_2
+#define I2C1_MASTER_RX_DMA_CHANNEL  MS32_DMA_CHANNEL_3
+
+/* Transaction Status */
+#define I2C1_XFER_IDLE              0U
+#define I2C1_XFER_QUEUED            1U
+#define I2C1_XFER_ACTIVE            2U
+#define I2C1_XFER_DONE              3U
+#define I2C1_XFER_NACK              4U      /* address or data not acknowledged */
+#define I2C1_XFER_ERROR             5U      /* arbitration lost, bus error or timeout */
+
+/* Exported types ------------------------------------------------------------*/
+struct I2C1_Xfer;
+
+/**
+  * @brief Completion callback, runs in the I2C1 interrupt (or in
+  *        I2C1_Master_Poll() after a timeout); may submit further transactions
+  */
+typedef void (*I2C1_XferCallback)(struct I2C1_Xfer *Xfer);
+
+typedef struct I2C1_Xfer
+{
+  uint8_t Addr;             /* 7 bit slave address */
+  const uint8_t *TxBuf;     /* write phase, e.g. register number */
+  uint16_t TxLen;           /* 0: no write phase */
+  uint8_t *RxBuf;           /* read phase after a repeated start */
+  uint16_t RxLen;           /* 0: no read phase */
+  I2C1_XferCallback Callback; /* 0: poll Status */
+  void *Context;            /* free for the callback */
+  __IO uint8_t Status;      /* I2C1_XFER_xxx, written by the driver */
+} I2C1_XferTypeDef;
+
+typedef struct
+{
+  uint32_t Transfers;
+  uint32_t Bytes;           /* data bytes, address bytes not counted */
+  uint32_t BusyUs;          /* START to STOP time, sum */
+  uint32_t Nacks;
+  uint32_t Errors;          /* ARLO, BERR */
+  uint32_t Timeouts;
+  uint32_t Recoveries;      /* SCL pulse sequences */
+  uint32_t QueueFull;
+} I2C1_MasterStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void I2C1_Master_Init(void);
+ErrorStatus I2C1_Master_Submit(I2C1_XferTypeDef *Xfer);
+void I2C1_Master_Poll(void);
+uint8_t I2C1_Master_IsIdle(void);
+void I2C1_Master_GetStats(I2C1_MasterStatsTypeDef *Stats);
+void I2C1_Master_ClockCallback(uint8_t Phase, uint32_t Sysclk);
+
+void I2C1_Master_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __I2C1_MASTER_H */
+
+/******************************** END OF FILE *********************************/
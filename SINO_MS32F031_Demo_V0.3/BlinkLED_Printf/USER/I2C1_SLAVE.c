@@ -0,0 +1,424 @@
+/**
+  ******************************************************************************
+  * @file 		I2C1_SLAVE.c
+	* @author		SINOMCU-AE
+  * @brief 		I2C1 slave register map with shadow copies
+  *
+  *          This file provides an I2C1 slave register server:
+  *             the map is kept in three copies: the published one, the one
+  *             a master read is served from and the one firmware updates;
+  *             a read latches the published copy at the address match and
+  *             DMA1 Channel2 streams it, so multi-byte values read by the
+  *             master are never torn by a firmware update;
+  *             master writes are staged byte by byte and committed to all
+  *             copies at STOP (or repeated start), firmware sees them whole;
+  *             the register pointer moves past every byte written or sent
+  *             to the master and wraps at the map end, so a read without a
+  *             new pointer goes on where the last transaction stopped.
+  *          SCL is stretched only for the address match interrupt and for
+  *          each written byte; reads run from DMA without CPU work. Writes
+  *          to read-only registers are ACKed and dropped, so slave byte
+  *          control (one stretch per byte to choose ACK / NACK) is not used.
+  *
+  *          Needed call I2C1_Slave_IRQHandler() in I2C1_IRQHandler() and
+  *          I2C1_Slave_DMA_IRQHandler() in DMA1_Channel2_3_IRQHandler().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "I2C1_SLAVE.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+#define I2C_SLAVE_COPIES            3U
+
+/* Write transaction state */
+#define WRITE_IDLE                  0U
+#define WRITE_POINTER               1U      /* next byte is the register pointer */
+#define WRITE_DATA                  2U
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t Map[I2C_SLAVE_COPIES][I2C1_SLAVE_MAP_SIZE] STARTUP_DMAZERO;
+static __IO uint8_t Published;
+static __IO uint8_t Serving;
+static uint8_t Updating;
+
+static uint8_t Pointer;
+static uint8_t WriteState;
+static uint8_t WriteLen;
+static uint8_t WriteBuf[I2C1_SLAVE_MAP_SIZE];
+static __IO uint8_t Reading;
+static uint32_t ReadRun;          /* length of the running DMA pass */
+static uint32_t ReadDone;         /* bytes of the passes before it */
+static __IO uint32_t WriteEvents;
+
+static uint8_t Enabled;
+static I2C1_SlaveStatsTypeDef SlaveStats;
+
+/**
+  * @brief Apply the staged master write to every copy of the map
+  * @param None
+  * @retval None
+  * @note call from the I2C1 interrupt
+  */
+static void I2C1_Slave_Commit(void)
+{
+  uint32_t i;
+  uint32_t reg;
+
+  for (i = 0; i < WriteLen; i++)
+  {
+    reg = Pointer + i;
+    if (reg >= I2C1_SLAVE_MAP_SIZE)
+    {
+      reg -= I2C1_SLAVE_MAP_SIZE;
+    }
+    if (reg < I2C1_SLAVE_RW_SIZE)
+    {
+      Map[0][reg] = WriteBuf[i];
+      Map[1][reg] = WriteBuf[i];
+      Map[2][reg] = WriteBuf[i];
+      WriteEvents |= 1UL << reg;
+    }
+    else
+    {
+      SlaveStats.RoWrites++;
+    }
+  }
+  Pointer = (uint8_t)((Pointer + WriteLen) % I2C1_SLAVE_MAP_SIZE);
+  SlaveStats.Writes++;
+  WriteState = WRITE_IDLE;
+  WriteLen = 0;
+}
+
+/**
+  * @brief Stop serving a master read, the pointer moves past the bytes sent
+  * @param None
+  * @retval None
+  */
+static void I2C1_Slave_EndRead(void)
+{
+  uint32_t sent;
+
+  MS32_DMA_DisableChannel(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+  sent = ReadDone + ReadRun - MS32_DMA_GetDataLength(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+  /* the byte DMA prefetched into TXDR after the last one never went out */
+  if (!MS32_I2C_IsActiveFlag_TXE(I2C1) && (sent != 0U))
+  {
+    sent--;
+  }
+  Pointer = (uint8_t)((Pointer + sent) % I2C1_SLAVE_MAP_SIZE);
+  MS32_I2C_ClearFlag_TXE(I2C1);
+  Reading = 0;
+}
+
+/**
+  * @brief I2C1 slave Initialization Function
+  * @param None
+  * @retval None
+  * @note 7 bit address I2C1_SLAVE_ADDR, the map starts all zero
+  */
+void I2C1_Slave_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_I2C_InitTypeDef I2C_InitStruct;
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
+  MS32_RCC_SetI2CClockSource(I2C1_TIMING_CLKSOURCE);
+#if I2C1_TIMING_SPEED_HZ > 400000
+  /* fast mode plus drive on PB6 / PB7 */
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_SYSCFG);
+  MS32_SYSCFG_EnableFastModePlus(MS32_SYSCFG_I2C_FASTMODEPLUS_PB6 | MS32_SYSCFG_I2C_FASTMODEPLUS_PB7);
+#endif
+  /**I2C1 GPIO Configuration
+  PB6   ------> I2C1_SCL
+  PB7   ------> I2C1_SDA
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_6 | MS32_GPIO_PIN_7;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_OPENDRAIN;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_I2C_DMA_GetRegAddr(I2C1, MS32_I2C_DMA_REG_DATA_TRANSMIT);
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_MEMORY_TO_PERIPH;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_NORMAL;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.PeriphOrM2MSrcDataSize = MS32_DMA_PDATAALIGN_BYTE;
+  DMA_InitStruct.MemoryOrM2MDstDataSize = MS32_DMA_MDATAALIGN_BYTE;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_MEDIUM;
+  MS32_DMA_DisableChannel(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL, &DMA_InitStruct);
+  /* transfer complete: the master reads on past the map end, wrap to 0 */
+  MS32_DMA_ITConfig(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL, MS32_DMA_CCR_TCIE, 0x1);
+
+  Published = 0;
+  Serving = 0;
+  Updating = 0;
+  Pointer = 0;
+  WriteState = WRITE_IDLE;
+  WriteLen = 0;
+  Reading = 0;
+  WriteEvents = 0;
+  Enabled = 1;
+
+  MS32_I2C_StructInit(&I2C_InitStruct);
+  I2C_InitStruct.PeripheralMode = MS32_I2C_MODE_I2C;
+  I2C_InitStruct.Timing = I2C1_SLAVE_TIMING;
+  I2C_InitStruct.OwnAddress1 = I2C1_SLAVE_ADDR << 1;
+  I2C_InitStruct.OwnAddrSize = MS32_I2C_OWNADDRESS1_7BIT;
+  I2C_InitStruct.TypeAcknowledge = MS32_I2C_ACK;
+  MS32_I2C_Init(I2C1, &I2C_InitStruct);
+
+  MS32_I2C_EnableDMAReq_TX(I2C1);
+  MS32_I2C_EnableIT_ADDR(I2C1);
+  MS32_I2C_EnableIT_RX(I2C1);
+  MS32_I2C_EnableIT_STOP(I2C1);
+  MS32_I2C_EnableIT_ERR(I2C1);
+  NVIC_SetPriority(I2C1_IRQn, 0x1);
+  NVIC_EnableIRQ(I2C1_IRQn);
+}
+
+/**
+  * @brief Get a copy of the map for firmware updates
+  * @param None
+  * @retval I2C1_SLAVE_MAP_SIZE bytes holding the published values; write the
+  *         read-only (and if needed read-write) registers, then
+  *         I2C1_Slave_EndUpdate() publishes them together
+  * @note call by main loop only, one update at a time
+  */
+uint8_t *I2C1_Slave_BeginUpdate(void)
+{
+  uint8_t *dst;
+  const uint8_t *src;
+  uint32_t i;
+
+  /* neither the published copy nor the one a master read may be using */
+  __disable_irq();
+  Updating = 0;
+  while ((Updating == Published) || (Updating == Serving))
+  {
+    Updating++;
+  }
+  __enable_irq();
+
+  /* a master write committed meanwhile lands in both copies */
+  dst = Map[Updating];
+  src = Map[Published];
+  for (i = 0; i < I2C1_SLAVE_MAP_SIZE; i++)
+  {
+    dst[i] = src[i];
+  }
+  return dst;
+}
+
+/**
+  * @brief Publish the copy returned by I2C1_Slave_BeginUpdate()
+  * @param None
+  * @retval None
+  * @note a read already in progress finishes with the previous values
+  */
+void I2C1_Slave_EndUpdate(void)
+{
+  Published = Updating;
+  SlaveStats.Updates++;
+}
+
+/**
+  * @brief Read published registers, e.g. the read-write ones after a write
+  * @param Reg first register
+  * @param Buf destination
+  * @param Len bytes, Reg + Len at most I2C1_SLAVE_MAP_SIZE
+  * @retval None
+  */
+void I2C1_Slave_Read(uint8_t Reg, uint8_t *Buf, uint8_t Len)
+{
+  const uint8_t *src;
+  uint32_t i;
+
+  __disable_irq();
+  src = Map[Published];
+  for (i = 0; (i < Len) && ((Reg + i) < I2C1_SLAVE_MAP_SIZE); i++)
+  {
+    Buf[i] = src[Reg + i];
+  }
+  __enable_irq();
+}
+
+/**
+  * @brief Take the read-write registers written by the master since last call
+  * @param None
+  * @retval bit n set: register n written (value may be unchanged)
+  */
+uint32_t I2C1_Slave_TakeWrites(void)
+{
+  uint32_t events;
+
+  __disable_irq();
+  events = WriteEvents;
+  WriteEvents = 0;
+  __enable_irq();
+
+  return events;
+}
+
+/**
+  * @brief I2C1 slave event / error interrupt
+  * @param None
+  * @retval None
+  * @note call by I2C1_IRQHandler()
+  */
+void I2C1_Slave_IRQHandler(void)
+{
+  uint8_t data;
+
+  if (Enabled == 0U)
+  {
+    return;
+  }
+
+  if (MS32_I2C_IsActiveFlag_BERR(I2C1) || MS32_I2C_IsActiveFlag_ARLO(I2C1) || MS32_I2C_IsActiveFlag_OVR(I2C1))
+  {
+    MS32_I2C_ClearFlag_BERR(I2C1);
+    MS32_I2C_ClearFlag_ARLO(I2C1);
+    MS32_I2C_ClearFlag_OVR(I2C1);
+    SlaveStats.Errors++;
+    /* a broken write is not committed */
+    WriteState = WRITE_IDLE;
+    WriteLen = 0;
+  }
+
+  /* before ADDR / STOP: the last byte of a write may still be in RXDR */
+  if (MS32_I2C_IsActiveFlag_RXNE(I2C1))
+  {
+    data = MS32_I2C_ReceiveData8(I2C1);
+    if (WriteState == WRITE_POINTER)
+    {
+      if (data >= I2C1_SLAVE_MAP_SIZE)
+      {
+        SlaveStats.BadPointer++;
+        data = 0;
+      }
+      Pointer = data;
+      WriteState = WRITE_DATA;
+    }
+    else if (WriteState == WRITE_DATA)
+    {
+      if (WriteLen < I2C1_SLAVE_MAP_SIZE)
+      {
+        WriteBuf[WriteLen++] = data;
+      }
+      else
+      {
+        SlaveStats.Overflows++;
+      }
+    }
+  }
+
+  if (MS32_I2C_IsActiveFlag_ADDR(I2C1))
+  {
+    /* repeated start after a write or a read */
+    if (WriteState != WRITE_IDLE)
+    {
+      I2C1_Slave_Commit();
+    }
+    if (Reading != 0U)
+    {
+      I2C1_Slave_EndRead();
+    }
+
+    if (MS32_I2C_GetTransferDirection(I2C1) == MS32_I2C_DIRECTION_READ)
+    {
+      /* latch the published copy for the whole read */
+      Serving = Published;
+      MS32_DMA_DisableChannel(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+      MS32_DMA_SetMemoryAddress(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL, (uint32_t)&Map[Serving][Pointer]);
+      MS32_DMA_SetDataLength(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL, I2C1_SLAVE_MAP_SIZE - Pointer);
+      ReadRun = I2C1_SLAVE_MAP_SIZE - Pointer;
+      ReadDone = 0;
+      MS32_I2C_ClearFlag_TXE(I2C1);
+      MS32_DMA_EnableChannel(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+      Reading = 1;
+      SlaveStats.Reads++;
+    }
+    else
+    {
+      WriteState = WRITE_POINTER;
+      WriteLen = 0;
+    }
+    /* releases SCL */
+    MS32_I2C_ClearFlag_ADDR(I2C1);
+  }
+
+  if (MS32_I2C_IsActiveFlag_STOP(I2C1))
+  {
+    MS32_I2C_ClearFlag_STOP(I2C1);
+    /* the master NACKs the last byte it reads */
+    MS32_I2C_ClearFlag_NACK(I2C1);
+    if (Reading != 0U)
+    {
+      I2C1_Slave_EndRead();
+    }
+    if (WriteState != WRITE_IDLE)
+    {
+      I2C1_Slave_Commit();
+    }
+  }
+}
+
+/**
+  * @brief DMA1 Channel2 (I2C1_TX) transfer complete interrupt
+  * @param None
+  * @retval None
+  * @note call by DMA1_Channel2_3_IRQHandler()
+  */
+void I2C1_Slave_DMA_IRQHandler(void)
+{
+  if ((Enabled == 0U) || !MS32_DMA_IsActiveFlag_TC2(DMA1))
+  {
+    return;
+  }
+  MS32_DMA_ClearFlag_GI2(DMA1);
+
+  if (Reading != 0U)
+  {
+    /* auto increment wraps to register 0, same copy */
+    MS32_DMA_DisableChannel(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+    MS32_DMA_SetMemoryAddress(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL, (uint32_t)Map[Serving]);
+    MS32_DMA_SetDataLength(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL, I2C1_SLAVE_MAP_SIZE);
+    ReadDone += ReadRun;
+    ReadRun = I2C1_SLAVE_MAP_SIZE;
+    MS32_DMA_EnableChannel(DMA1, I2C1_SLAVE_TX_DMA_CHANNEL);
+  }
+}
+
+/**
+  * @brief Read the slave statistics
+  * @param Stats pointer to a I2C1_SlaveStatsTypeDef structure
+  * @retval None
+  */
+void I2C1_Slave_GetStats(I2C1_SlaveStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = SlaveStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
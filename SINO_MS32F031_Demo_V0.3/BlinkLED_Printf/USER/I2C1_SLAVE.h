@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    I2C1_SLAVE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of I2C1_SLAVE.c file.
+  *
+  *          I2C1 slave register map:
+  *             PB6   ------> I2C1_SCL
+  *             PB7   ------> I2C1_SDA
+  *             I2C1_TX ------> DMA1 Channel2 (master reads)
+  *          Write: addr+W, register pointer, data bytes (auto increment)
+  *          Read:  addr+R, data bytes from the last written pointer
+  *          registers 0 ~ I2C1_SLAVE_RW_SIZE-1 are read-write, the rest
+  *          read-only; the pointer wraps at I2C1_SLAVE_MAP_SIZE.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __I2C1_SLAVE_H
+#define __I2C1_SLAVE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "I2C1_TIMING.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* 7 bit own address */
+#define I2C1_SLAVE_ADDR             0x30U
+/* TIMINGR from I2C1_TIMING.h, slave only uses SDADEL / SCLDEL */
+#define I2C1_SLAVE_TIMING           I2C1_TIMING
+
+/* Register map size, at most 32 (one bit each in the write event mask) */
+#define I2C1_SLAVE_MAP_SIZE         32U
+/* Registers 0 ~ I2C1_SLAVE_RW_SIZE-1 accept master writes */
+#define I2C1_SLAVE_RW_SIZE          8U
+
+#define I2C1_SLAVE_TX_DMA_CHANNEL   MS32_DMA_CHANNEL_2
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Writes;          /* write transactions committed */
+  uint32_t Reads;           /* read transactions served */
+  uint32_t RoWrites;        /* bytes written to read-only registers, dropped */
+  uint32_t BadPointer;      /* pointer at or above I2C1_SLAVE_MAP_SIZE */
+  uint32_t Overflows;       /* write bytes beyond I2C1_SLAVE_MAP_SIZE, dropped */
+  uint32_t Errors;          /* BERR, ARLO, OVR */
+  uint32_t Updates;         /* I2C1_Slave_EndUpdate() calls */
+} I2C1_SlaveStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void I2C1_Slave_Init(void);
+uint8_t *I2C1_Slave_BeginUpdate(void);
+void I2C1_Slave_EndUpdate(void);
+void I2C1_Slave_Read(uint8_t Reg, uint8_t *Buf, uint8_t Len);
+uint32_t I2C1_Slave_TakeWrites(void);
+void I2C1_Slave_GetStats(I2C1_SlaveStatsTypeDef *Stats);
+
+void I2C1_Slave_IRQHandler(void);
+void I2C1_Slave_DMA_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __I2C1_SLAVE_H */
+
+/******************************** END OF FILE *********************************/
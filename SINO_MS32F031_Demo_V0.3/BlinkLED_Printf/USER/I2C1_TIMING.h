@@ -0,0 +1,206 @@
+/**
+  ******************************************************************************
+  * @file    I2C1_TIMING.h
+  * @author  SINOMCU-AE
+  * @brief   Compile-time TIMINGR calculator for I2C1.
+  *
+  *          Set I2C1_TIMING_SPEED_HZ, I2C1_TIMING_RISE_NS / FALL_NS (bus
+  *          rise / fall time, measured or from the pull-up and bus
+  *          capacitance) and the I2C1 clock source; I2C1_TIMING is the
+  *          TIMINGR value for MS32_I2C_InitTypeDef.Timing. A combination that
+  *          cannot meet the I2C specification stops the build with #error.
+  *
+  *          Analog filter on, digital filter off (MS32_I2C_StructInit()
+  *          defaults). SCL period = (SCLL+1 + SCLH+1) * tPRESC + sync, the
+  *          sync part (tr + tf + 2 analog filter delays + 4 I2CCLK) is taken
+  *          off the budget; the period is rounded up and the sync part
+  *          down, each on its own, so the bus never runs above the set speed.
+  *
+  *          Results, rise 100ns / fall 10ns (test/test_i2c1_timing prints
+  *          and checks these and more):
+  *             I2CCLK    100kHz       400kHz       1MHz
+  *              8MHz     0x00202227   0x00100409   0x00100001
+  *             16MHz     0x00504651   0x00300A15   0x00200205
+  *             24MHz     0x00806A7B   0x00401120   0x00300409
+  *             48MHz     0x10806B7C   0x00902444   0x00700B15
+  *          At the specification maximum rise + fall time (1000 + 300ns
+  *          standard) full speed only fits from 24MHz I2CCLK; a few percent
+  *          lower (95kHz) passes at every clock.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __I2C1_TIMING_H
+#define __I2C1_TIMING_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "CLOCK_PLAN.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#ifndef I2C1_TIMING_SPEED_HZ
+#define I2C1_TIMING_SPEED_HZ        400000
+#endif
+#ifndef I2C1_TIMING_RISE_NS
+#define I2C1_TIMING_RISE_NS         100
+#endif
+#ifndef I2C1_TIMING_FALL_NS
+#define I2C1_TIMING_FALL_NS         10
+#endif
+
+/* 0: I2CCLK = HSI (reset default), 1: I2CCLK = SYSCLK at I2C1_TIMING_SYSCLK_HZ */
+#ifndef I2C1_TIMING_USE_SYSCLK
+#define I2C1_TIMING_USE_SYSCLK      0
+#endif
+#ifndef I2C1_TIMING_SYSCLK_HZ
+#define I2C1_TIMING_SYSCLK_HZ       CLOCK_PLAN_SYSCLK_HZ
+#endif
+
+#if I2C1_TIMING_USE_SYSCLK
+#define I2C1_TIMING_CLKSOURCE       MS32_RCC_I2C1_CLKSOURCE_SYSCLK
+#define I2C1_TIMING_CLK_KHZ         (I2C1_TIMING_SYSCLK_HZ / 1000)
+#else
+#define I2C1_TIMING_CLKSOURCE       MS32_RCC_I2C1_CLKSOURCE_HSI
+#define I2C1_TIMING_CLK_KHZ         (HSI_VALUE / 1000)
+#endif
+
+/* I2C specification limits in ns, by mode: standard / fast / fast plus */
+#define I2C_TIMING_MODE_LIMIT(F, SM, FM, FMP) \
+        (((F) <= 100000) ? (SM) : (((F) <= 400000) ? (FM) : (FMP)))
+#define I2C_TIMING_TLOW_MIN(F)      I2C_TIMING_MODE_LIMIT(F, 4700, 1300, 500)
+#define I2C_TIMING_THIGH_MIN(F)     I2C_TIMING_MODE_LIMIT(F, 4000, 600, 260)
+#define I2C_TIMING_TSUDAT_MIN(F)    I2C_TIMING_MODE_LIMIT(F, 250, 100, 50)
+#define I2C_TIMING_TVDDAT_MAX(F)    I2C_TIMING_MODE_LIMIT(F, 3450, 900, 450)
+/* Analog filter delay */
+#define I2C_TIMING_TAF_MIN          50
+#define I2C_TIMING_TAF_MAX          260
+
+/* Helpers: the clock may be unsigned (HSI_VALUE), never go below zero */
+#define I2C_TIMING_SUB0(A, B)       (((A) > (B)) ? ((A) - (B)) : 0)
+#define I2C_TIMING_MAX(A, B)        (((A) > (B)) ? (A) : (B))
+#define I2C_TIMING_DIV_CEIL(A, B)   (((A) + (B) - 1) / (B))
+/* ns to I2CCLK cycles, K = I2CCLK in kHz */
+#define I2C_TIMING_CYC_CEIL(K, NS)  (((NS) * (K) + 999999) / 1000000)
+#define I2C_TIMING_CYC_FLOOR(K, NS) (((NS) * (K)) / 1000000)
+
+/* Cycles: SCL period, sync overhead, budget left for SCLL + SCLH */
+#define I2C_TIMING_PERIOD(K, F)     I2C_TIMING_DIV_CEIL((K) * 1000, F)
+/* period rounded up, sync rounded down, each on its own: rounding the sync
+   up would shorten SCLL + SCLH below what the bus really needs */
+#define I2C_TIMING_SYNC(K, TR, TF)  (I2C_TIMING_CYC_FLOOR(K, (TR) + (TF) + 2 * I2C_TIMING_TAF_MIN) + 4)
+#define I2C_TIMING_BUDGET(K, F, TR, TF) \
+        I2C_TIMING_SUB0(I2C_TIMING_PERIOD(K, F), I2C_TIMING_SYNC(K, TR, TF))
+
+/* Prescaler + 1: SCLL / SCLH within 8 bits, SCLDEL within 4 bits */
+#define I2C_TIMING_SETUP_CYC(K, F, TR)  I2C_TIMING_CYC_CEIL(K, (TR) + I2C_TIMING_TSUDAT_MIN(F))
+#define I2C_TIMING_P(K, F, TR, TF) \
+        I2C_TIMING_MAX(I2C_TIMING_MAX(I2C_TIMING_DIV_CEIL(I2C_TIMING_BUDGET(K, F, TR, TF), 384), \
+                                      I2C_TIMING_DIV_CEIL(I2C_TIMING_SETUP_CYC(K, F, TR), 16)), 1)
+
+/* Data setup: (SCLDEL+1) * tPRESC >= tr + tSU;DAT */
+#define I2C_TIMING_SCLDEL(K, F, TR, TF) \
+        I2C_TIMING_SUB0(I2C_TIMING_DIV_CEIL(I2C_TIMING_SETUP_CYC(K, F, TR), I2C_TIMING_P(K, F, TR, TF)), 1)
+/* Data hold: SDADEL * tPRESC >= tf - tAF(min) - 3 I2CCLK */
+#define I2C_TIMING_SDADEL(K, F, TR, TF) \
+        I2C_TIMING_DIV_CEIL(I2C_TIMING_SUB0(I2C_TIMING_CYC_CEIL(K, I2C_TIMING_SUB0(TF, I2C_TIMING_TAF_MIN)), 3), \
+                            I2C_TIMING_P(K, F, TR, TF))
+/* Data valid: SDADEL * tPRESC <= tVD;DAT - tr - tAF(max) - 4 I2CCLK */
+#define I2C_TIMING_SDADEL_MAX(K, F, TR, TF) \
+        (I2C_TIMING_SUB0(I2C_TIMING_CYC_FLOOR(K, I2C_TIMING_SUB0(I2C_TIMING_TVDDAT_MAX(F), (TR) + I2C_TIMING_TAF_MAX)), 4) \
+         / I2C_TIMING_P(K, F, TR, TF))
+
+/* SCL low / high in tPRESC units: minimum each (bus time adds tAF + 2
+   I2CCLK), the spare budget shared evenly */
+#define I2C_TIMING_N(K, F, TR, TF) \
+        I2C_TIMING_DIV_CEIL(I2C_TIMING_BUDGET(K, F, TR, TF), I2C_TIMING_P(K, F, TR, TF))
+#define I2C_TIMING_LMIN(K, F, TR, TF) \
+        I2C_TIMING_DIV_CEIL(I2C_TIMING_SUB0(I2C_TIMING_CYC_CEIL(K, I2C_TIMING_TLOW_MIN(F) - I2C_TIMING_TAF_MIN), 2), \
+                            I2C_TIMING_P(K, F, TR, TF))
+#define I2C_TIMING_HMIN(K, F, TR, TF) \
+        I2C_TIMING_DIV_CEIL(I2C_TIMING_SUB0(I2C_TIMING_CYC_CEIL(K, I2C_TIMING_THIGH_MIN(F) - I2C_TIMING_TAF_MIN), 2), \
+                            I2C_TIMING_P(K, F, TR, TF))
+#define I2C_TIMING_L(K, F, TR, TF) \
+        (I2C_TIMING_MAX(I2C_TIMING_LMIN(K, F, TR, TF), 1) + \
+         I2C_TIMING_SUB0(I2C_TIMING_N(K, F, TR, TF), I2C_TIMING_MAX(I2C_TIMING_LMIN(K, F, TR, TF), 1) + \
+                                                     I2C_TIMING_MAX(I2C_TIMING_HMIN(K, F, TR, TF), 1)) / 2)
+#define I2C_TIMING_H(K, F, TR, TF) \
+        I2C_TIMING_SUB0(I2C_TIMING_N(K, F, TR, TF), I2C_TIMING_L(K, F, TR, TF))
+
+/* Same packing as __MS32_I2C_CONVERT_TIMINGS(), whose SCLL shift name is broken */
+#define I2C_TIMING_PACK(PRESC, SCLDEL, SDADEL, SCLH, SCLL) \
+        ((((uint32_t)(PRESC)  << I2C_TIMINGR_PRESC_Pos)  & I2C_TIMINGR_PRESC)  | \
+         (((uint32_t)(SCLDEL) << I2C_TIMINGR_SCLDEL_Pos) & I2C_TIMINGR_SCLDEL) | \
+         (((uint32_t)(SDADEL) << I2C_TIMINGR_SDADEL_Pos) & I2C_TIMINGR_SDADEL) | \
+         (((uint32_t)(SCLH)   << I2C_TIMINGR_SCLH_Pos)   & I2C_TIMINGR_SCLH)   | \
+         (((uint32_t)(SCLL)   << I2C_TIMINGR_SCLL_Pos)   & I2C_TIMINGR_SCLL))
+
+/* TIMINGR for any I2CCLK (kHz), speed (Hz), rise / fall (ns); check with I2C_TIMING_VALID() */
+#define I2C_TIMING_VALUE(K, F, TR, TF) \
+        I2C_TIMING_PACK(I2C_TIMING_P(K, F, TR, TF) - 1, I2C_TIMING_SCLDEL(K, F, TR, TF), \
+                        I2C_TIMING_SDADEL(K, F, TR, TF), I2C_TIMING_H(K, F, TR, TF) - 1, \
+                        I2C_TIMING_L(K, F, TR, TF) - 1)
+#define I2C_TIMING_VALID(K, F, TR, TF) \
+        (((F) <= 1000000) && (I2C_TIMING_P(K, F, TR, TF) <= 16) && \
+         (I2C_TIMING_SCLDEL(K, F, TR, TF) <= 15) && (I2C_TIMING_SDADEL(K, F, TR, TF) <= 15) && \
+         (I2C_TIMING_SDADEL(K, F, TR, TF) <= I2C_TIMING_SDADEL_MAX(K, F, TR, TF)) && \
+         (I2C_TIMING_H(K, F, TR, TF) >= I2C_TIMING_MAX(I2C_TIMING_HMIN(K, F, TR, TF), 1)) && \
+         (I2C_TIMING_L(K, F, TR, TF) <= 256) && (I2C_TIMING_H(K, F, TR, TF) <= 256) && \
+         (I2C_TIMING_SDADEL(K, F, TR, TF) + I2C_TIMING_SCLDEL(K, F, TR, TF) + 1 <= I2C_TIMING_L(K, F, TR, TF)))
+
+/* I2C1 configuration */
+#define I2C1_TIMING                 I2C_TIMING_VALUE(I2C1_TIMING_CLK_KHZ, I2C1_TIMING_SPEED_HZ, \
+                                                     I2C1_TIMING_RISE_NS, I2C1_TIMING_FALL_NS)
+/* While SYSCLK runs from HSI (CLOCK_SCALE_LOW); differs only when I2CCLK = SYSCLK */
+#define I2C1_TIMING_HSI             I2C_TIMING_VALUE(HSI_VALUE / 1000, I2C1_TIMING_SPEED_HZ, \
+                                                     I2C1_TIMING_RISE_NS, I2C1_TIMING_FALL_NS)
+/* After a clock security system failover (CLOCK_SCALE_BACKUP), same condition */
+#define I2C1_TIMING_BACKUP          I2C_TIMING_VALUE(CLOCK_PLAN_BACKUP_SYSCLK_HZ / 1000, I2C1_TIMING_SPEED_HZ, \
+                                                     I2C1_TIMING_RISE_NS, I2C1_TIMING_FALL_NS)
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Private defines -----------------------------------------------------------*/
+#define I2C1_TIMING_K               I2C1_TIMING_CLK_KHZ
+#define I2C1_TIMING_F               I2C1_TIMING_SPEED_HZ
+#define I2C1_TIMING_TR              I2C1_TIMING_RISE_NS
+#define I2C1_TIMING_TF              I2C1_TIMING_FALL_NS
+
+#if I2C1_TIMING_F > 1000000
+#error "I2C1_TIMING_SPEED_HZ above fast mode plus (1MHz)"
+#elif (I2C_TIMING_P(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF) > 16)
+#error "I2C1 timing: prescaler out of range, I2CCLK too fast for this speed"
+#elif I2C_TIMING_SCLDEL(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF) > 15
+#error "I2C1 timing: data setup (rise time) does not fit SCLDEL"
+#elif I2C_TIMING_SDADEL(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF) > \
+      I2C_TIMING_SDADEL_MAX(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF)
+#error "I2C1 timing: data hold and data valid time conflict, reduce rise / fall time"
+#elif I2C_TIMING_H(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF) < \
+      I2C_TIMING_MAX(I2C_TIMING_HMIN(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF), 1)
+#error "I2C1 timing: SCL high too short, I2CCLK too slow or rise / fall too long for this speed"
+#elif !I2C_TIMING_VALID(I2C1_TIMING_K, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF)
+#error "I2C1 timing: no valid TIMINGR for this I2CCLK / speed"
+#elif I2C1_TIMING_USE_SYSCLK && !I2C_TIMING_VALID(HSI_VALUE / 1000, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF)
+#error "I2C1 timing: no valid TIMINGR at HSI for CLOCK_SCALE_LOW, lower the speed"
+#elif I2C1_TIMING_USE_SYSCLK && (CLOCK_PLAN_SOURCE != 0) && \
+      !I2C_TIMING_VALID(CLOCK_PLAN_BACKUP_SYSCLK_HZ / 1000, I2C1_TIMING_F, I2C1_TIMING_TR, I2C1_TIMING_TF)
+#error "I2C1 timing: no valid TIMINGR on the backup PLL for CLOCK_SCALE_BACKUP"
+#endif
+
+#endif /* __I2C1_TIMING_H */
+
+/******************************** END OF FILE *********************************/
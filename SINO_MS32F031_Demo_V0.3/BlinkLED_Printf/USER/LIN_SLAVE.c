@@ -0,0 +1,368 @@
+/**
+  ******************************************************************************
+  * @file 		LIN_SLAVE.c
+	* @author		SINOMCU-AE
+  * @brief 		LIN 2.x slave node on USART1
+  *
+  *          This file provides a LIN slave driven from USART1_IRQHandler():
+  *             break      ------> LBD flag, auto baud re-armed
+  *             sync 0x55  ------> auto baud unit measures the master rate,
+  *                                BRR follows HSI drift frame by frame
+  *             PID        ------> parity by table, frame by FrameIndex[ID]
+  *             response   ------> published byte by byte with read-back of
+  *                                the echo, or received and checked
+  *          Checksum is enhanced (PID + data), classic for 0x3C / 0x3D.
+  *
+  *          Needed call LIN_Slave_IRQHandler() in USART1_IRQHandler(),
+  *          after USART1_UART_Init() and instead of USART1_RxDMA_Init();
+  *          a DMA receive path left on is stopped: the DMA would read RDR
+  *          before the interrupt sees RXNE.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "LIN_SLAVE.h"
+#include "HSI_TRIM.h"
+#include "USART1_BAUD.h"
+#include "USART1_RX.h"
+#include "SysTick_Delay.h"
+
+#if LIN_SLAVE_HSI_TRIM && (HSI_TRIM_REF != 2)
+#error "LIN_SLAVE_HSI_TRIM needs HSI_TRIM_REF 2"
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define LIN_STATE_IDLE              0U      /* wait for break */
+#define LIN_STATE_SYNC              1U
+#define LIN_STATE_PID               2U
+#define LIN_STATE_RX                3U
+#define LIN_STATE_TX                4U
+
+#define LIN_NO_FRAME                0xFFU
+
+/* TResponse_max = 1.4 * 10 * (N + 1) bit times */
+#define LIN_RESPONSE_US_PER_BYTE    (14000000U / LIN_BAUDRATE)
+
+/* Variables -----------------------------------------------------------------*/
+/* PID = ID | P0 << 6 | P1 << 7, P0 = ID0^ID1^ID2^ID4, P1 = !(ID1^ID3^ID4^ID5) */
+static const uint8_t LIN_PidTable[64] =
+{
+  0x80, 0xC1, 0x42, 0x03, 0xC4, 0x85, 0x06, 0x47,
+  0x08, 0x49, 0xCA, 0x8B, 0x4C, 0x0D, 0x8E, 0xCF,
+  0x50, 0x11, 0x92, 0xD3, 0x14, 0x55, 0xD6, 0x97,
+  0xD8, 0x99, 0x1A, 0x5B, 0x9C, 0xDD, 0x5E, 0x1F,
+  0x20, 0x61, 0xE2, 0xA3, 0x64, 0x25, 0xA6, 0xE7,
+  0xA8, 0xE9, 0x6A, 0x2B, 0xEC, 0xAD, 0x2E, 0x6F,
+  0xF0, 0xB1, 0x32, 0x73, 0xB4, 0xF5, 0x76, 0x37,
+  0x78, 0x39, 0xBA, 0xFB, 0x3C, 0x7D, 0xFE, 0xBF
+};
+
+static const LIN_FrameTypeDef *FrameTable;
+static uint8_t FrameIndex[64];               /* ID -> FrameTable index */
+
+static uint8_t LinState;
+static const LIN_FrameTypeDef *LinFrame;
+static uint8_t LinBit;                       /* event bit of LinFrame */
+static uint8_t LinPid;
+static uint8_t LinBuf[9];
+static uint8_t LinCnt;
+static uint32_t LinPidUs;
+
+static uint32_t LinClk;
+static uint16_t LinNominalBRR;
+
+static __IO uint32_t LinEvents;
+static LIN_StatsTypeDef LinStats;
+
+/**
+  * @brief LIN checksum
+  * @param Pid protected ID, classic checksum for diagnostic frames
+  * @param Data response data
+  * @param Len data bytes
+  * @retval checksum byte
+  */
+uint8_t LIN_Checksum(uint8_t Pid, const uint8_t *Data, uint8_t Len)
+{
+  uint16_t sum;
+
+  sum = (((Pid & 0x3FU) == LIN_ID_MASTER_REQ) || ((Pid & 0x3FU) == LIN_ID_SLAVE_RSP)) ? 0U : Pid;
+  while (Len--)
+  {
+    sum += *Data++;
+    if (sum > 0xFFU)
+    {
+      sum -= 0xFFU;
+    }
+  }
+  return (uint8_t)~sum;
+}
+
+/**
+  * @brief Back to the nominal rate after a bad sync field
+  * @param None
+  * @retval None
+  * @note BRR is written with the USART disabled
+  */
+static void LIN_Slave_RestoreBaud(void)
+{
+  MS32_USART_Disable(USART1);
+  USART1->BRR = LinNominalBRR;
+  MS32_USART_Enable(USART1);
+}
+
+/**
+  * @brief Response finished, account the timing against TResponse_max
+  * @param None
+  * @retval None
+  */
+static void LIN_Slave_Done(void)
+{
+  uint32_t us;
+  int32_t margin;
+
+  us = SysTick_GetUs() - LinPidUs;
+  margin = (int32_t)(LIN_RESPONSE_US_PER_BYTE * (LinFrame->Length + 1U)) - (int32_t)us;
+  if (us > LinStats.MaxResponseUs)
+  {
+    LinStats.MaxResponseUs = us;
+  }
+  if (margin < LinStats.MinMarginUs)
+  {
+    LinStats.MinMarginUs = margin;
+  }
+
+  LinEvents |= (1UL << LinBit);
+  LinStats.Frames++;
+  LinState = LIN_STATE_IDLE;
+}
+
+/**
+  * @brief LIN slave Initialization Function
+  * @param Frames frame table, kept by reference (const table in flash)
+  * @param Count entries, up to LIN_MAX_FRAMES
+  * @retval None
+  * @note call after USART1_UART_Init()
+  */
+void LIN_Slave_Init(const LIN_FrameTypeDef *Frames, uint8_t Count)
+{
+  USART1_BaudTypeDef cfg;
+  uint8_t i;
+
+  FrameTable = Frames;
+  for (i = 0; i < 64U; i++)
+  {
+    FrameIndex[i] = LIN_NO_FRAME;
+  }
+  for (i = 0; (i < Count) && (i < LIN_MAX_FRAMES); i++)
+  {
+    FrameIndex[Frames[i].Id & 0x3FU] = i;
+  }
+
+  LinState = LIN_STATE_IDLE;
+  LinEvents = 0;
+  LinStats.MinMarginUs = 0x7FFFFFFF;
+
+  USART1_Baud_Select(LIN_BAUDRATE, USART1_BAUD_MAX_ERROR_PPM, &cfg);
+  USART1_Baud_Apply(&cfg);
+  LinClk = MS32_RCC_GetUSARTClockFreq(MS32_RCC_USART1_CLKSOURCE);
+  LinNominalBRR = cfg.BRR;
+
+  /* LIN mode, break length and auto baud are configured with the USART disabled */
+  MS32_USART_Disable(USART1);
+  /* every byte through RXNE: no DMA request, no USART1_RX frame interrupts */
+  MS32_USART_DisableDMAReq_RX(USART1);
+  MS32_DMA_DisableChannel(DMA1, USART1_RX_DMA_CHANNEL);
+  MS32_USART_DisableIT_IDLE(USART1);
+  MS32_USART_DisableIT_RTO(USART1);
+  MS32_USART_DisableIT_ERROR(USART1);
+  MS32_USART_DisableRxTimeout(USART1);
+  MS32_USART_ConfigLINMode(USART1);
+  MS32_USART_SetLINBrkDetectionLen(USART1, MS32_USART_LINBREAK_DETECT_11B);
+  MS32_USART_SetAutoBaudRateMode(USART1, MS32_USART_AUTOBAUD_DETECT_ON_55_FRAME);
+  MS32_USART_EnableAutoBaudRate(USART1);
+  MS32_USART_Enable(USART1);
+
+  MS32_USART_ITConfig(USART1, MS32_USART_CR2_LBDIE | MS32_USART_CR1_RXNEIE, 0x0);
+}
+
+/**
+  * @brief LIN slave interrupt: break, header and response bytes
+  * @param None
+  * @retval None
+  * @note call by USART1_IRQHandler()
+  */
+void LIN_Slave_IRQHandler(void)
+{
+  uint32_t baud;
+  uint32_t dev;
+  uint8_t data;
+  uint8_t idx;
+  uint8_t i;
+
+  if (!MS32_USART_IsEnabledLIN(USART1))
+  {
+    return;
+  }
+
+  if (MS32_USART_IsActiveFlag_LBD(USART1))
+  {
+    MS32_USART_ClearFlag_LBD(USART1);
+    /* the break itself was received as 0x00 with framing error */
+    if (MS32_USART_IsActiveFlag_RXNE(USART1))
+    {
+      (void)MS32_USART_ReceiveData8(USART1);
+    }
+    MS32_USART_ClearFlag_FE(USART1);
+    MS32_USART_ClearFlag_ORE(USART1);
+    MS32_USART_RequestAutoBaudRate(USART1);
+    LinState = LIN_STATE_SYNC;
+  }
+
+  if (!MS32_USART_IsActiveFlag_RXNE(USART1))
+  {
+    return;
+  }
+  data = MS32_USART_ReceiveData8(USART1);
+
+  switch (LinState)
+  {
+    case LIN_STATE_SYNC:
+      baud = 0;
+      if ((data == 0x55U) && MS32_USART_IsActiveFlag_ABR(USART1) && !MS32_USART_IsActiveFlag_ABRE(USART1))
+      {
+        baud = MS32_USART_GetBaudRate(USART1, LinClk, MS32_USART_OVERSAMPLING_16);
+      }
+      dev = (baud >= LIN_BAUDRATE) ? (baud - LIN_BAUDRATE) : (LIN_BAUDRATE - baud);
+      if ((dev * 100U) > (LIN_BAUDRATE * LIN_SYNC_TOLERANCE_PCT))
+      {
+        LinStats.SyncErrors++;
+        LIN_Slave_RestoreBaud();
+        LinState = LIN_STATE_IDLE;
+        break;
+      }
+      LinStats.LastBaud = baud;
+#if LIN_SLAVE_HSI_TRIM
+      /* bit time in kernel clocks, measured against nominal */
+      HsiTrim_Feed(USART1->BRR, LinNominalBRR);
+#endif
+      LinState = LIN_STATE_PID;
+      break;
+
+    case LIN_STATE_PID:
+      LinState = LIN_STATE_IDLE;
+      if (LIN_PidTable[data & 0x3FU] != data)
+      {
+        LinStats.ParityErrors++;
+        break;
+      }
+      idx = FrameIndex[data & 0x3FU];
+      if (idx == LIN_NO_FRAME)
+      {
+        break;
+      }
+
+      LinStats.Headers++;
+      LinPidUs = SysTick_GetUs();
+      LinFrame = &FrameTable[idx];
+      LinBit = idx;
+      LinPid = data;
+      LinCnt = 0;
+      if (LinFrame->Direction == LIN_PUBLISH)
+      {
+        for (i = 0; i < LinFrame->Length; i++)
+        {
+          LinBuf[i] = LinFrame->Data[i];
+        }
+        LinBuf[i] = LIN_Checksum(LinPid, LinBuf, LinFrame->Length);
+        MS32_USART_TransmitData8(USART1, LinBuf[0]);
+        LinState = LIN_STATE_TX;
+      }
+      else
+      {
+        LinState = LIN_STATE_RX;
+      }
+      break;
+
+    case LIN_STATE_TX:
+      /* single wire bus, every published byte comes back */
+      if (data != LinBuf[LinCnt])
+      {
+        LinStats.BitErrors++;
+        LinState = LIN_STATE_IDLE;
+        break;
+      }
+      LinCnt++;
+      if (LinCnt > LinFrame->Length)
+      {
+        LIN_Slave_Done();
+      }
+      else
+      {
+        MS32_USART_TransmitData8(USART1, LinBuf[LinCnt]);
+      }
+      break;
+
+    case LIN_STATE_RX:
+      LinBuf[LinCnt++] = data;
+      if (LinCnt > LinFrame->Length)
+      {
+        if (LIN_Checksum(LinPid, LinBuf, LinFrame->Length) != data)
+        {
+          LinStats.ChecksumErrors++;
+          LinState = LIN_STATE_IDLE;
+          break;
+        }
+        for (i = 0; i < LinFrame->Length; i++)
+        {
+          LinFrame->Data[i] = LinBuf[i];
+        }
+        LIN_Slave_Done();
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief Frames completed since the last call
+  * @param None
+  * @retval bit n set: FrameTable[n] was received (subscribe) or sent (publish)
+  */
+uint32_t LIN_Slave_TakeEvents(void)
+{
+  uint32_t events;
+
+  __disable_irq();
+  events = LinEvents;
+  LinEvents = 0;
+  __enable_irq();
+  return events;
+}
+
+/**
+  * @brief Read the LIN statistics
+  * @param Stats pointer to a LIN_StatsTypeDef structure
+  * @retval None
+  */
+void LIN_Slave_GetStats(LIN_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = LinStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    LIN_SLAVE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of LIN_SLAVE.c file.
+  *
+  *          LIN 2.x slave node on USART1 (LIN mode):
+  *             PA9   ------> USART1_TX  (transceiver TXD)
+  *             PA10  ------> USART1_RX  (transceiver RXD)
+  *          Header: break(>=11 bits) sync(0x55) PID; the slave publishes
+  *          or subscribes the response (1~8 data bytes + checksum).
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LIN_SLAVE_H
+#define __LIN_SLAVE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define LIN_BAUDRATE                19200U
+/* Sync field accepted within +-LIN_SYNC_TOLERANCE_PCT of LIN_BAUDRATE,
+   LIN 2.x allows +-14% for a slave without a crystal */
+#define LIN_SYNC_TOLERANCE_PCT      15U
+/* 1: sync fields also feed the HSI trimming (HSI_TRIM_REF 2), the master
+      clock is the reference */
+#define LIN_SLAVE_HSI_TRIM          0
+
+/* Frame table entries, one bit each in the event masks */
+#define LIN_MAX_FRAMES              32U
+
+#define LIN_PUBLISH                 0U      /* slave sends the response */
+#define LIN_SUBSCRIBE               1U      /* slave receives the response */
+
+/* Diagnostic frames use the classic checksum */
+#define LIN_ID_MASTER_REQ           0x3CU
+#define LIN_ID_SLAVE_RSP            0x3DU
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t Id;               /* frame ID 0x00~0x3F */
+  uint8_t Direction;        /* LIN_PUBLISH or LIN_SUBSCRIBE */
+  uint8_t Length;           /* data bytes 1~8 */
+  uint8_t *Data;            /* signal buffer, Length bytes */
+} LIN_FrameTypeDef;
+
+typedef struct
+{
+  uint32_t Headers;         /* break + sync + valid PID for this node */
+  uint32_t Frames;          /* responses completed */
+  uint32_t SyncErrors;      /* sync not 0x55, auto baud error or out of tolerance */
+  uint32_t ParityErrors;    /* PID parity */
+  uint32_t ChecksumErrors;
+  uint32_t BitErrors;       /* published byte read back different */
+  uint32_t LastBaud;        /* measured on the last sync field */
+  uint32_t MaxResponseUs;   /* PID received to response done */
+  int32_t  MinMarginUs;     /* TResponse_max (1.4 * nominal) minus response time */
+} LIN_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void LIN_Slave_Init(const LIN_FrameTypeDef *Frames, uint8_t Count);
+uint32_t LIN_Slave_TakeEvents(void);
+void LIN_Slave_GetStats(LIN_StatsTypeDef *Stats);
+uint8_t LIN_Checksum(uint8_t Pid, const uint8_t *Data, uint8_t Len);
+
+void LIN_Slave_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __LIN_SLAVE_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,376 @@
+/**
+  ******************************************************************************
+  * @file 		MODBUS_RTU.c
+	* @author		SINOMCU-AE
+  * @brief 		Modbus RTU slave on USART1 / RS-485
+  *
+  *          This file provides a Modbus RTU slave with the timing in hardware:
+  *             the 3.5 character gap closes a frame by USART receiver
+  *             timeout (USART1_RX, DMA1 Channel5);
+  *             the reply goes out by DMA1 Channel4 and USART driver enable
+  *             mode drives DE, so no interrupt is needed around TX.
+  *          Registers are served straight from Modbus_HoldingRegs[] and
+  *          Modbus_InputRegs[].
+  *
+  *          The CRC unit only computes CRC-32 (fixed polynomial), the
+  *          Modbus CRC-16 (0xA001 reflected, init 0xFFFF) is table driven.
+  *
+  *          Needed call after USART1_UART_Init() and USART1_RxDMA_Init(),
+  *          instead of USART1_Pkt_Init().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "MODBUS_RTU.h"
+#include "USART1_RX.h"
+#include "USART1_BAUD.h"
+#include "SysTick_Delay.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+/* ADDR FC ADDR(2) QTY(2) COUNT DATA CRC(2): largest frame is 0x10 */
+#define MODBUS_BUF_SIZE             (9U + (2U * MODBUS_RTU_MAX_REGS))
+
+#define MODBUS_FC_READ_HOLDING      0x03U
+#define MODBUS_FC_READ_INPUT        0x04U
+#define MODBUS_FC_WRITE_SINGLE      0x06U
+#define MODBUS_FC_WRITE_MULTIPLE    0x10U
+
+/* Variables -----------------------------------------------------------------*/
+uint16_t Modbus_HoldingRegs[MODBUS_RTU_HOLDING_NUM];
+uint16_t Modbus_InputRegs[MODBUS_RTU_INPUT_NUM];
+
+static uint8_t RxBuf[MODBUS_BUF_SIZE] STARTUP_NOINIT;
+static uint8_t TxBuf[MODBUS_BUF_SIZE] STARTUP_NOINIT;
+
+static Modbus_RTU_StatsTypeDef ModbusStats;
+
+static const uint16_t CRC16Table[256] =
+{
+  0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+  0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+  0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+  0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+  0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+  0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+  0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+  0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+  0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+  0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+  0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+  0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+  0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+  0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+  0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+  0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+  0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+  0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+  0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+  0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+  0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+  0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+  0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+  0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+  0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+  0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+  0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+  0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+  0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+  0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+  0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+  0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+/**
+  * @brief Modbus CRC-16
+  * @param Buf data
+  * @param Len number of bytes
+  * @retval CRC, sent LSB first
+  */
+uint16_t Modbus_CRC16(const uint8_t *Buf, uint16_t Len)
+{
+  uint16_t crc = 0xFFFFU;
+
+  while (Len--)
+  {
+    crc = (uint16_t)((crc >> 8) ^ CRC16Table[(uint8_t)(crc ^ *Buf++)]);
+  }
+  return crc;
+}
+
+/**
+  * @brief Read a big endian 16 bit field
+  * @param Buf field
+  * @retval value
+  */
+static uint16_t Modbus_Get16(const uint8_t *Buf)
+{
+  return (uint16_t)(((uint16_t)Buf[0] << 8) | Buf[1]);
+}
+
+/**
+  * @brief Write a big endian 16 bit field
+  * @param Buf field
+  * @param Value value
+  * @retval None
+  */
+static void Modbus_Put16(uint8_t *Buf, uint16_t Value)
+{
+  Buf[0] = (uint8_t)(Value >> 8);
+  Buf[1] = (uint8_t)Value;
+}
+
+/**
+  * @brief Execute one request, build the reply PDU in TxBuf
+  * @param Len request length without CRC
+  * @retval reply length without CRC
+  */
+static uint16_t Modbus_Process(uint16_t Len)
+{
+  const uint16_t *regs;
+  uint16_t num;
+  uint16_t addr;
+  uint16_t qty;
+  uint16_t i;
+  uint8_t fc = RxBuf[1];
+  uint8_t ex = 0;
+
+  TxBuf[0] = RxBuf[0];
+  TxBuf[1] = fc;
+
+  if (Len < 6U)
+  {
+    ex = (fc == MODBUS_FC_READ_HOLDING || fc == MODBUS_FC_READ_INPUT ||
+          fc == MODBUS_FC_WRITE_SINGLE || fc == MODBUS_FC_WRITE_MULTIPLE) ? MODBUS_EX_ILLEGAL_VALUE : MODBUS_EX_ILLEGAL_FUNCTION;
+  }
+  else
+  {
+    addr = Modbus_Get16(&RxBuf[2]);
+    qty = Modbus_Get16(&RxBuf[4]);
+
+    switch (fc)
+    {
+      case MODBUS_FC_READ_HOLDING:
+      case MODBUS_FC_READ_INPUT:
+        regs = (fc == MODBUS_FC_READ_HOLDING) ? Modbus_HoldingRegs : Modbus_InputRegs;
+        num = (fc == MODBUS_FC_READ_HOLDING) ? MODBUS_RTU_HOLDING_NUM : MODBUS_RTU_INPUT_NUM;
+        if ((qty == 0U) || (qty > MODBUS_RTU_MAX_REGS))
+        {
+          ex = MODBUS_EX_ILLEGAL_VALUE;
+        }
+        else if (((uint32_t)addr + qty) > num)
+        {
+          ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        else
+        {
+          TxBuf[2] = (uint8_t)(qty * 2U);
+          for (i = 0; i < qty; i++)
+          {
+            Modbus_Put16(&TxBuf[3U + (2U * i)], regs[addr + i]);
+          }
+          return (uint16_t)(3U + (2U * qty));
+        }
+        break;
+
+      case MODBUS_FC_WRITE_SINGLE:
+        if (addr >= MODBUS_RTU_HOLDING_NUM)
+        {
+          ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        else
+        {
+          Modbus_HoldingRegs[addr] = qty;
+          /* reply echoes the request */
+          for (i = 2; i < 6U; i++)
+          {
+            TxBuf[i] = RxBuf[i];
+          }
+          return 6;
+        }
+        break;
+
+      case MODBUS_FC_WRITE_MULTIPLE:
+        if ((qty == 0U) || (qty > MODBUS_RTU_MAX_REGS) ||
+            (Len < (7U + (2U * qty))) || (RxBuf[6] != (uint8_t)(qty * 2U)))
+        {
+          ex = MODBUS_EX_ILLEGAL_VALUE;
+        }
+        else if (((uint32_t)addr + qty) > MODBUS_RTU_HOLDING_NUM)
+        {
+          ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        else
+        {
+          for (i = 0; i < qty; i++)
+          {
+            Modbus_HoldingRegs[addr + i] = Modbus_Get16(&RxBuf[7U + (2U * i)]);
+          }
+          for (i = 2; i < 6U; i++)
+          {
+            TxBuf[i] = RxBuf[i];
+          }
+          return 6;
+        }
+        break;
+
+      default:
+        ex = MODBUS_EX_ILLEGAL_FUNCTION;
+        break;
+    }
+  }
+
+  ModbusStats.Exceptions++;
+  TxBuf[1] = (uint8_t)(fc | 0x80U);
+  TxBuf[2] = ex;
+  return 3;
+}
+
+/**
+  * @brief Modbus RTU slave Initialization Function
+  * @param None
+  * @retval None
+  * @note call after USART1_UART_Init() and USART1_RxDMA_Init()
+  */
+void Modbus_RTU_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+  uint32_t baud;
+  uint32_t t35;
+
+  /**USART1 GPIO Configuration
+  PA12  ------> USART1_DE
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_12;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_DOWN;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  /* 3.5 characters of 11 bits; fixed 1750us above 19200 baud */
+  baud = USART1_Baud_GetCurrent();
+  t35 = (baud > 19200U) ? ((((baud / 100U) * 175U) + 999U) / 1000U) : 39U;
+
+  /* frame format and DE timing are configured with the USART disabled */
+  while (!MS32_USART_IsActiveFlag_TC(USART1));
+  MS32_USART_Disable(USART1);
+  if (MODBUS_RTU_PARITY != MS32_USART_PARITY_NONE)
+  {
+    MS32_USART_SetDataWidth(USART1, MS32_USART_DATAWIDTH_9B);
+    MS32_USART_SetStopBitsLength(USART1, MS32_USART_STOPBITS_1);
+  }
+  else
+  {
+    MS32_USART_SetDataWidth(USART1, MS32_USART_DATAWIDTH_8B);
+    MS32_USART_SetStopBitsLength(USART1, MS32_USART_STOPBITS_2);
+  }
+  MS32_USART_SetParity(USART1, MODBUS_RTU_PARITY);
+  MS32_USART_SetRxTimeout(USART1, t35);
+  MS32_USART_SetDESignalPolarity(USART1, MS32_USART_DE_POLARITY_HIGH);
+  MS32_USART_SetDEAssertionTime(USART1, MODBUS_RTU_DE_TIME);
+  MS32_USART_SetDEDeassertionTime(USART1, MODBUS_RTU_DE_TIME);
+  MS32_USART_EnableDEMode(USART1);
+  MS32_USART_Enable(USART1);
+
+  /* USART1_TX request on DMA1 Channel4, completion is polled */
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_SYSCFG);
+  MS32_SYSCFG_SetRemapDMA_USART(MS32_SYSCFG_USART1TX_RMP_DMA1CH4);
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_USART_DMA_GetRegAddr(USART1, MS32_USART_DMA_REG_DATA_TRANSMIT);
+  DMA_InitStruct.MemoryOrM2MDstAddress  = (uint32_t)TxBuf;
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_MEMORY_TO_PERIPH;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_NORMAL;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_MEDIUM;
+  MS32_DMA_DisableChannel(DMA1, MODBUS_RTU_TX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, MODBUS_RTU_TX_DMA_CHANNEL, &DMA_InitStruct);
+
+  MS32_USART_EnableDMAReq_TX(USART1);
+}
+
+/**
+  * @brief Answer the next received request
+  * @param None
+  * @retval None
+  * @note call from main loop; the turnaround time is the main loop latency
+  */
+void Modbus_RTU_Poll(void)
+{
+  uint16_t len;
+  uint16_t crc;
+  uint32_t us;
+
+  /* one reply at a time, a master never sends before it is received */
+  if (MS32_DMA_GetDataLength(DMA1, MODBUS_RTU_TX_DMA_CHANNEL) != 0U)
+  {
+    return;
+  }
+
+  len = USART1_RxDMA_GetFrame(RxBuf, sizeof(RxBuf));
+  if (len < 4U)
+  {
+    return;
+  }
+
+  crc = Modbus_CRC16(RxBuf, len - 2U);
+  if ((RxBuf[len - 2U] != (uint8_t)crc) || (RxBuf[len - 1U] != (uint8_t)(crc >> 8)))
+  {
+    ModbusStats.CrcErrors++;
+    return;
+  }
+  if ((RxBuf[0] != MODBUS_RTU_SLAVE_ADDR) && (RxBuf[0] != 0U))
+  {
+    return;
+  }
+  ModbusStats.Requests++;
+
+  len = Modbus_Process(len - 2U);
+  if (RxBuf[0] == 0U)
+  {
+    return;
+  }
+
+  crc = Modbus_CRC16(TxBuf, len);
+  TxBuf[len] = (uint8_t)crc;
+  TxBuf[len + 1U] = (uint8_t)(crc >> 8);
+  len += 2U;
+
+  MS32_DMA_DisableChannel(DMA1, MODBUS_RTU_TX_DMA_CHANNEL);
+  MS32_DMA_SetDataLength(DMA1, MODBUS_RTU_TX_DMA_CHANNEL, len);
+  MS32_DMA_EnableChannel(DMA1, MODBUS_RTU_TX_DMA_CHANNEL);
+
+  us = SysTick_GetUs() - USART1_RxDMA_GetFrameTime();
+  ModbusStats.LastTurnaroundUs = us;
+  if (us > ModbusStats.MaxTurnaroundUs)
+  {
+    ModbusStats.MaxTurnaroundUs = us;
+  }
+}
+
+/**
+  * @brief Read the slave statistics
+  * @param Stats pointer to a Modbus_RTU_StatsTypeDef structure
+  * @retval None
+  */
+void Modbus_RTU_GetStats(Modbus_RTU_StatsTypeDef *Stats)
+{
+  *Stats = ModbusStats;
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    MODBUS_RTU.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of MODBUS_RTU.c file.
+  *
+  *          Modbus RTU slave on USART1, RS-485 half duplex:
+  *             PA9   ------> USART1_TX  (transceiver DI)
+  *             PA10  ------> USART1_RX  (transceiver RO)
+  *             PA12  ------> USART1_DE  (transceiver DE and /RE)
+  *          Function codes: 0x03 0x04 0x06 0x10, broadcast address 0
+  *          executes writes without a reply.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MODBUS_RTU_H
+#define __MODBUS_RTU_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define MODBUS_RTU_SLAVE_ADDR       1U
+/* MS32_USART_PARITY_EVEN / ODD, or MS32_USART_PARITY_NONE (2 stop bits) */
+#define MODBUS_RTU_PARITY           MS32_USART_PARITY_EVEN
+
+#define MODBUS_RTU_HOLDING_NUM      16U
+#define MODBUS_RTU_INPUT_NUM        16U
+/* Registers per read / write request, sizes the frame buffers */
+#define MODBUS_RTU_MAX_REGS         16U
+
+/* DE assertion / deassertion time in sample time units (1/16 bit), 0~31 */
+#define MODBUS_RTU_DE_TIME          16U
+
+#define MODBUS_RTU_TX_DMA_CHANNEL   MS32_DMA_CHANNEL_4
+
+/* Exception codes */
+#define MODBUS_EX_ILLEGAL_FUNCTION  0x01U
+#define MODBUS_EX_ILLEGAL_ADDRESS   0x02U
+#define MODBUS_EX_ILLEGAL_VALUE     0x03U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Requests;        /* CRC good frames for this slave or broadcast */
+  uint32_t CrcErrors;
+  uint32_t Exceptions;
+  uint32_t LastTurnaroundUs;  /* end of request (3.5 char gap) to reply start */
+  uint32_t MaxTurnaroundUs;
+} Modbus_RTU_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+extern uint16_t Modbus_HoldingRegs[MODBUS_RTU_HOLDING_NUM];
+extern uint16_t Modbus_InputRegs[MODBUS_RTU_INPUT_NUM];
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Modbus_RTU_Init(void);
+void Modbus_RTU_Poll(void);
+void Modbus_RTU_GetStats(Modbus_RTU_StatsTypeDef *Stats);
+uint16_t Modbus_CRC16(const uint8_t *Buf, uint16_t Len);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __MODBUS_RTU_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,404 @@
+/**
+  ******************************************************************************
+  * @file 		POWER_MGR.c
+	* @author		SINOMCU-AE
+  * @brief 		Idle power manager with clock restore after STOP
+  *
+  *          This file provides the idle power manager:
+  *             every client votes the deepest mode it allows, a vote mask
+  *             per mode holds the clients that forbid it; PowerMgr_Idle()
+  *             takes the deepest mode with an empty mask;
+  *             the bus clocks of idle clients (voted POWER_MGR_STOP_LP)
+  *             are gated for the sleep, those shared with a busy client
+  *             (DMA) stay on;
+  *             the core sleeps with interrupts masked: the wake-up
+  *             interrupt stays pending while the clock comes back, in
+  *             this order:
+  *               1. HSE (HSE plan), PLL, SYSCLK switch to the profile clock
+  *               2. bus clocks of the idle clients
+  *               3. interrupts, the wake-up handler runs on the full clock
+  *             HSE that does not restart goes to CLOCK_SCALE_BACKUP as a
+  *             CSS failover (CLOCK_CSS restarts it later).
+  *
+  *          SysTick stops in STOP: SysTick_GetTick() does not count the
+  *          STOP time. The wake latency is the restore time, read on
+  *          SysTick running on HSI, so it wraps after one SysTick period
+  *          (6ms for a 48MHz HCLK); the regulator and HSI start before the
+  *          first instruction are not seen.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "POWER_MGR.h"
+#include "CLOCK_SCALE.h"
+#include "CLOCK_CSS.h"
+#include "ENERGY.h"
+#include "RTC_WAKE.h"
+#include "USART1_BAUD.h"
+
+/* Private define ------------------------------------------------------------*/
+#define POWER_MGR_EXTI_PINS         0x0000FFFFU
+/* HSERDY wait after STOP, about 1us a pass on HSI */
+#define POWER_MGR_HSE_WAIT          (CLOCK_CSS_STARTUP_MS * 1000U)
+
+/* Variables -----------------------------------------------------------------*/
+/* Bus clocks of each client, by client bit number */
+static const uint32_t ClientAhb[POWER_MGR_CLIENTS] =
+{
+  0U,
+  RCC_AHBENR_DMAEN,
+  RCC_AHBENR_DMAEN,
+  RCC_AHBENR_DMAEN,
+  0U,
+  0U,
+};
+static const uint32_t ClientApb1[POWER_MGR_CLIENTS] =
+{
+  0U,
+  0U,
+  0U,
+  RCC_APB1ENR_I2C1EN,
+  RCC_APB1ENR_TIM14EN,
+  0U,
+};
+static const uint32_t ClientApb2[POWER_MGR_CLIENTS] =
+{
+  0U,
+  RCC_APB2ENR_USART1EN,
+  RCC_APB2ENR_SPI1EN,
+  0U,
+  0U,
+  0U,
+};
+
+/* Clients forbidding each mode, [POWER_MGR_RUN] unused */
+static uint32_t Blocks[POWER_MGR_MODES];
+/* Clients that have voted, the others are never gated */
+static uint32_t Voted;
+/* Clients that are never gated (wake sources) */
+static uint32_t Keep;
+
+static PowerMgr_StatsTypeDef PowerStats;
+
+/**
+  * @brief Vote the deepest mode a client allows
+  * @param Client POWER_MGR_CLIENT_xxx, several may be or'ed
+  * @param Mode POWER_MGR_RUN ~ POWER_MGR_STOP_LP; POWER_MGR_STOP_LP
+  *        marks the client idle, its bus clocks are gated while sleeping
+  * @retval None
+  * @note may be called from interrupts
+  */
+void PowerMgr_Vote(uint32_t Client, uint8_t Mode)
+{
+  uint8_t m;
+
+  __disable_irq();
+  for (m = POWER_MGR_SLEEP; m < POWER_MGR_MODES; m++)
+  {
+    if (m > Mode)
+    {
+      Blocks[m] |= Client;
+    }
+    else
+    {
+      Blocks[m] &= ~Client;
+    }
+  }
+  Voted |= Client;
+  __enable_irq();
+}
+
+/**
+  * @brief Deepest mode all votes allow
+  * @param None
+  * @retval POWER_MGR_RUN ~ POWER_MGR_STOP_LP
+  */
+uint8_t PowerMgr_GetMode(void)
+{
+  uint8_t mode = POWER_MGR_STOP_LP;
+
+  /* a client forbidding a mode forbids the deeper ones as well */
+  while ((mode != POWER_MGR_RUN) && (Blocks[mode] != 0))
+  {
+    mode--;
+  }
+  return mode;
+}
+
+/**
+  * @brief Bus clocks to gate: those of idle clients and of no busy one
+  * @param Ahb, Apb1, Apb2 gate masks for AHBENR, APB1ENR, APB2ENR
+  * @retval None
+  */
+static void PowerMgr_GateMasks(uint32_t *Ahb, uint32_t *Apb1, uint32_t *Apb2)
+{
+  uint32_t idle = Voted & ~Blocks[POWER_MGR_STOP_LP] & ~Keep;
+  uint32_t keepAhb = 0;
+  uint32_t keepApb1 = 0;
+  uint32_t keepApb2 = 0;
+  uint8_t i;
+
+  *Ahb = 0;
+  *Apb1 = 0;
+  *Apb2 = 0;
+  for (i = 0; i < POWER_MGR_CLIENTS; i++)
+  {
+    if ((idle & (1UL << i)) != 0)
+    {
+      *Ahb |= ClientAhb[i];
+      *Apb1 |= ClientApb1[i];
+      *Apb2 |= ClientApb2[i];
+    }
+    else
+    {
+      keepAhb |= ClientAhb[i];
+      keepApb1 |= ClientApb1[i];
+      keepApb2 |= ClientApb2[i];
+    }
+  }
+  *Ahb &= ~keepAhb;
+  *Apb1 &= ~keepApb1;
+  *Apb2 &= ~keepApb2;
+}
+
+/**
+  * @brief Wake source of the STOP exit, before any handler has run
+  * @param None
+  * @retval POWER_MGR_WAKE_xxx
+  */
+static uint8_t PowerMgr_WakeSource(void)
+{
+  if (MS32_EXTI_IsActiveFlag_0_31(MS32_EXTI_LINE_17))
+  {
+    return POWER_MGR_WAKE_RTC;
+  }
+  if (MS32_USART_IsEnabledIT_WKUP(USART1) && MS32_USART_IsActiveFlag_WKUP(USART1))
+  {
+    return POWER_MGR_WAKE_USART1;
+  }
+  if ((EXTI->PR & POWER_MGR_EXTI_PINS) != 0)
+  {
+    return POWER_MGR_WAKE_EXTI;
+  }
+  return POWER_MGR_WAKE_OTHER;
+}
+
+/**
+  * @brief Bring SYSCLK back to the profile clock after STOP
+  * @param Profile CLOCK_SCALE profile before STOP
+  * @retval SUCCESS, ERROR moved to CLOCK_SCALE_BACKUP or HSI instead
+  * @note SYSCLK is on HSI, HSE and PLL are off, the PLL settings, bus
+  *       prescalers and flash wait states are kept from before STOP
+  */
+static ErrorStatus PowerMgr_RestoreClock(uint8_t Profile)
+{
+  uint32_t wait;
+  uint32_t sw = CLOCK_PLAN_SW;
+  uint32_t sws = CLOCK_PLAN_SWS;
+
+  if (Profile == CLOCK_SCALE_LOW)
+  {
+    return SUCCESS;
+  }
+  if (Profile == CLOCK_SCALE_BACKUP)
+  {
+    sw = RCC_CFGR_SW_PLL;
+    sws = RCC_CFGR_SWS_PLL;
+  }
+#if CLOCK_PLAN_SOURCE != 0
+  else
+  {
+    RCC->CR |= CLOCK_PLAN_CR_HSE;
+    wait = POWER_MGR_HSE_WAIT;
+    while (((RCC->CR & RCC_CR_HSERDY) == 0) && (wait != 0))
+    {
+      wait--;
+    }
+    if ((RCC->CR & RCC_CR_HSERDY) == 0)
+    {
+      RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+      ClockCss_Failover();
+      return ERROR;
+    }
+  }
+#endif
+
+  if (sw == RCC_CFGR_SW_PLL)
+  {
+    RCC->CR |= RCC_CR_PLLON;
+    wait = CLOCK_SCALE_PLL_TIMEOUT_US;
+    while (((RCC->CR & RCC_CR_PLLRDY) == 0) && (wait != 0))
+    {
+      wait--;
+    }
+    if ((RCC->CR & RCC_CR_PLLRDY) == 0)
+    {
+      /* once more from HSI, or stay on it */
+      RCC->CR &= ~RCC_CR_PLLON;
+      ClockScale_Failover();
+      return ERROR;
+    }
+  }
+  RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | sw;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != sws)
+  {
+  }
+  return SUCCESS;
+}
+
+/**
+  * @brief Record the restore time of a STOP exit
+  * @param Source POWER_MGR_WAKE_xxx
+  * @param Counts SysTick counts from the exit to the clock switch
+  * @param Profile CLOCK_SCALE profile before STOP
+  * @retval None
+  */
+static void PowerMgr_RecordWake(uint8_t Source, uint32_t Counts, uint8_t Profile)
+{
+  /* SysTick ran on HCLK = HSI / AHB prescaler, the prescaler of the profile */
+  uint32_t div = (Profile == CLOCK_SCALE_LOW) ? 1U : CLOCK_PLAN_AHB_DIV;
+  uint32_t us = (Counts * div) / (HSI_VALUE / 1000000U);
+
+  PowerStats.Wakes[Source]++;
+  PowerStats.LastWakeUs[Source] = us;
+  if (us > PowerStats.MaxWakeUs[Source])
+  {
+    PowerStats.MaxWakeUs[Source] = us;
+  }
+}
+
+/**
+  * @brief Sleep in the deepest mode the votes allow, until an interrupt
+  * @param None
+  * @retval mode used, POWER_MGR_RUN when a vote forbids sleeping
+  * @note call from the main loop when there is nothing to do; returns
+  *       after the wake-up interrupt has been served
+  */
+uint8_t PowerMgr_Idle(void)
+{
+  uint8_t mode;
+  uint8_t profile;
+  uint8_t source;
+  uint32_t gateAhb;
+  uint32_t gateApb1;
+  uint32_t gateApb2;
+  uint32_t ahb;
+  uint32_t apb1;
+  uint32_t apb2;
+  uint32_t v0;
+  uint32_t v1;
+
+  __disable_irq();
+  mode = PowerMgr_GetMode();
+  PowerStats.Entries[mode]++;
+  if (mode == POWER_MGR_RUN)
+  {
+    __enable_irq();
+    return mode;
+  }
+
+  PowerMgr_GateMasks(&gateAhb, &gateApb1, &gateApb2);
+  ahb = RCC->AHBENR & gateAhb;
+  apb1 = RCC->APB1ENR & gateApb1;
+  apb2 = RCC->APB2ENR & gateApb2;
+  RCC->AHBENR &= ~ahb;
+  RCC->APB1ENR &= ~apb1;
+  RCC->APB2ENR &= ~apb2;
+  Energy_Enter(mode);
+
+  if (mode == POWER_MGR_SLEEP)
+  {
+    MS32_PWR_EnterSLEEPMode(PWR_SLEEPENTRY_WFI);
+  }
+  else
+  {
+    profile = ClockScale_Get();
+    MS32_PWR_EnterSTOPMode((mode == POWER_MGR_STOP) ? MS32_PWR_MODE_STOP_MAINREGU : MS32_PWR_MODE_STOP_LPREGU,
+                           PWR_STOPENTRY_WFI);
+    v0 = SysTick->VAL;
+    source = PowerMgr_WakeSource();
+    if (PowerMgr_RestoreClock(profile) != SUCCESS)
+    {
+      PowerStats.RestoreFails++;
+    }
+    v1 = SysTick->VAL;
+    /* down counter, one reload at most */
+    PowerMgr_RecordWake(source, (v0 >= v1) ? (v0 - v1) : (v0 + (SysTick->LOAD + 1U) - v1), profile);
+    /* SysTick stood still */
+    RtcWake_Resync();
+  }
+
+  RCC->AHBENR |= ahb;
+  RCC->APB1ENR |= apb1;
+  RCC->APB2ENR |= apb2;
+  Energy_Enter(POWER_MGR_RUN);
+  __enable_irq();
+  return mode;
+}
+
+/**
+  * @brief Let a USART1 start bit wake the core from STOP
+  * @param None
+  * @retval None
+  * @note the USART1 kernel clock moves to HSI (running in STOP on demand),
+  *       BRR is recomputed for the same baud rate; USART1 is never gated
+  *       and its interrupt is enabled, with PowerMgr_USART1_IRQHandler()
+  *       in USART1_IRQHandler()
+  */
+void PowerMgr_EnableUsartWake(void)
+{
+  USART1_Baud_ClockCallback(CLOCK_SCALE_PRE, SystemCoreClock);
+  MS32_USART_Disable(USART1);
+  MS32_RCC_SetUSARTClockSource(MS32_RCC_USART1_CLKSOURCE_HSI);
+  MS32_USART_SetWKUPType(USART1, MS32_USART_WAKEUP_ON_STARTBIT);
+  /* BRR for the HSI kernel clock, enables USART1 again */
+  USART1_Baud_ClockCallback(CLOCK_SCALE_POST, SystemCoreClock);
+
+  MS32_USART_ClearFlag_WKUP(USART1);
+  MS32_USART_EnableIT_WKUP(USART1);
+  MS32_USART_EnableInStopMode(USART1);
+  Keep |= POWER_MGR_CLIENT_USART1;
+
+  NVIC_SetPriority(USART1_IRQn, 0x1);
+  NVIC_EnableIRQ(USART1_IRQn);
+}
+
+/**
+  * @brief Read the power statistics
+  * @param Stats pointer to a PowerMgr_StatsTypeDef structure
+  * @retval None
+  */
+void PowerMgr_GetStats(PowerMgr_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = PowerStats;
+  __enable_irq();
+}
+
+/**
+  * @brief Clear the USART1 wake-up flag
+  * @param None
+  * @retval None
+  * @note call by USART1_IRQHandler()
+  */
+void PowerMgr_USART1_IRQHandler(void)
+{
+  if (MS32_USART_IsEnabledIT_WKUP(USART1) && MS32_USART_IsActiveFlag_WKUP(USART1))
+  {
+    MS32_USART_ClearFlag_WKUP(USART1);
+  }
+}
+
+/******************************** END OF FILE *********************************/
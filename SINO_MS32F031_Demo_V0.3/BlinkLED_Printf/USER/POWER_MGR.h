@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    POWER_MGR.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of POWER_MGR.c file.
+  *
+  *          Idle power manager:
+  *             clients vote the deepest mode they allow, PowerMgr_Idle()
+  *             enters the deepest mode all votes allow
+  *             SLEEP   ------> WFI, SysTick and peripherals run
+  *             STOP    ------> all clocks off, main regulator (fast wake)
+  *             STOP_LP ------> all clocks off, low power regulator
+  *          Wake from STOP: EXTI line (pins), RTC alarm (EXTI line 17) or
+  *          USART1 start bit (PowerMgr_EnableUsartWake()).
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __POWER_MGR_H
+#define __POWER_MGR_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Modes, from light to deep */
+#define POWER_MGR_RUN               0U      /* no sleep */
+#define POWER_MGR_SLEEP             1U
+#define POWER_MGR_STOP              2U
+#define POWER_MGR_STOP_LP           3U
+#define POWER_MGR_MODES             4U
+
+/* Clients, one bit each in the vote masks. A client that has voted
+   POWER_MGR_STOP_LP is idle: its bus clocks are gated while the core sleeps */
+#define POWER_MGR_CLIENT_APP        0x01U   /* no clock */
+#define POWER_MGR_CLIENT_USART1     0x02U   /* USART1, DMA */
+#define POWER_MGR_CLIENT_SPI1       0x04U   /* SPI1, DMA */
+#define POWER_MGR_CLIENT_I2C1       0x08U   /* I2C1, DMA */
+#define POWER_MGR_CLIENT_TIM14      0x10U   /* TIM14 (HSI_TRIM) */
+#define POWER_MGR_CLIENT_RTC        0x20U   /* no clock (RTC_WAKE) */
+#define POWER_MGR_CLIENTS           6U
+
+/* Wake sources of STOP */
+#define POWER_MGR_WAKE_EXTI         0U      /* EXTI lines 0~15 */
+#define POWER_MGR_WAKE_RTC          1U      /* RTC alarm, EXTI line 17 */
+#define POWER_MGR_WAKE_USART1       2U
+#define POWER_MGR_WAKE_OTHER        3U
+#define POWER_MGR_WAKE_SOURCES      4U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Entries[POWER_MGR_MODES];          /* POWER_MGR_RUN: idle calls that could not sleep */
+  uint32_t Wakes[POWER_MGR_WAKE_SOURCES];     /* STOP exits */
+  uint32_t LastWakeUs[POWER_MGR_WAKE_SOURCES];  /* STOP exit to SYSCLK back on the profile clock */
+  uint32_t MaxWakeUs[POWER_MGR_WAKE_SOURCES];
+  uint32_t RestoreFails;    /* HSE or PLL did not come back, CLOCK_SCALE_BACKUP or HSI */
+} PowerMgr_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void PowerMgr_Vote(uint32_t Client, uint8_t Mode);
+uint8_t PowerMgr_GetMode(void);
+uint8_t PowerMgr_Idle(void);
+void PowerMgr_EnableUsartWake(void);
+void PowerMgr_GetStats(PowerMgr_StatsTypeDef *Stats);
+
+void PowerMgr_USART1_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __POWER_MGR_H */
+
+/******************************** END OF FILE *********************************/
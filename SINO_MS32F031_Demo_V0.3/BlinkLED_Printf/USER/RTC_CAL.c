@@ -0,0 +1,436 @@
+/**
+  ******************************************************************************
+  * @file 		RTC_CAL.c
+	* @author		SINOMCU-AE
+  * @brief 		RTC smooth calibration and phase correction
+  *
+  *          This file provides the RTC calibration service:
+  *             RTC_CAL_REF 0: TIM14 counts the HSE derived timer clock
+  *             between captures of every 8th RTCCLK edge, RTC_CAL_CAPTURES
+  *             intervals (one second of LSE) make a measurement of the
+  *             crystal error; the correction moves towards its opposite;
+  *             RTC_CAL_REF 1: the RTC to host offset drift between two
+  *             syncs gives the error left after the calibration; the
+  *             correction moves by its opposite;
+  *             the correction is written to RTC_CALR from RtcCal_Poll()
+  *             once the previous write is taken (RECALPF);
+  *             a sync also shifts the RTC onto the host time, at most every
+  *             RTC_CAL_SYNC_MIN_MS with RTC_CAL_REF 1 so the drift between
+  *             two syncs stays measurable.
+  *
+  *          RTC_CALR lives in the backup domain: the calibration carries
+  *          over a reset. Needs RtcWake_Init() first (LSE, 1024 ticks a
+  *          second, direct reads).
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "RTC_CAL.h"
+#include "CLOCK_PLAN.h"
+#include "RTC_WAKE.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+#define RTC_CAL_DAY_MS              86400000U
+#define RTC_CAL_DAY_TICKS           (86400 * (int32_t)RTC_WAKE_TICK_HZ)
+/* CALP adds 512 pulses in 2^20, CALM masks 0~511 */
+#define RTC_CAL_PULSES_MAX          512
+#define RTC_CAL_PULSES_MIN          (-511)
+/* SHPF, a few RTCCLK */
+#define RTC_CAL_SHIFT_WAIT          10000U
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t Started;
+/* correction in pulses per 2^20 RTCCLK, as wanted */
+static int32_t Pulses;
+
+#if RTC_CAL_REF == 0
+static uint32_t StartTick;
+static __IO uint8_t Running;
+static __IO uint8_t Done;
+static __IO uint8_t Overrun;
+static uint16_t Captures;
+static uint16_t LastCapture;
+static uint32_t Counts;
+#else
+/* sync after the last phase correction: host time, offset in ticks */
+static uint8_t Based;
+static uint32_t BaseHostMs;
+static int32_t BaseOffset;
+#endif
+
+static RtcCal_StatsTypeDef CalStats;
+
+/**
+  * @brief Write a 32 bit value LSB first
+  * @param Buf destination
+  * @param Value value
+  * @retval None
+  */
+static void RtcCal_Put32(uint8_t *Buf, uint32_t Value)
+{
+  Buf[0] = (uint8_t)Value;
+  Buf[1] = (uint8_t)(Value >> 8);
+  Buf[2] = (uint8_t)(Value >> 16);
+  Buf[3] = (uint8_t)(Value >> 24);
+}
+
+/**
+  * @brief Correction in RTC_CALR now
+  * @param None
+  * @retval pulses per 2^20 RTCCLK, + speeds the RTC up
+  */
+static int32_t RtcCal_ReadPulses(void)
+{
+  int32_t pulses = -(int32_t)(RTC->CALR & RTC_CALR_CALM);
+
+  if (RTC->CALR & RTC_CALR_CALP)
+  {
+    pulses += RTC_CAL_PULSES_MAX;
+  }
+  return pulses;
+}
+
+/**
+  * @brief Move the correction towards a target
+  * @param TargetPpb correction wanted, + speeds the RTC up
+  * @retval None
+  * @note written to RTC_CALR by RtcCal_Poll()
+  */
+static void RtcCal_Apply(int32_t TargetPpb)
+{
+  int32_t ppb = CalStats.CorrPpb + ((TargetPpb - CalStats.CorrPpb) / RTC_CAL_GAIN);
+  int32_t pulses;
+
+  /* 2^20 / 10^9, rounded */
+  pulses = (int32_t)((((int64_t)ppb * 1048576) + ((ppb >= 0) ? 500000000 : -500000000)) / 1000000000);
+  if (pulses > RTC_CAL_PULSES_MAX)
+  {
+    pulses = RTC_CAL_PULSES_MAX;
+  }
+  else if (pulses < RTC_CAL_PULSES_MIN)
+  {
+    pulses = RTC_CAL_PULSES_MIN;
+  }
+  Pulses = pulses;
+  /* unrounded, so corrections below a step still add up */
+  if ((pulses == RTC_CAL_PULSES_MAX) || (pulses == RTC_CAL_PULSES_MIN))
+  {
+    ppb = (int32_t)(((int64_t)pulses * 1000000000) / 1048576);
+  }
+  CalStats.CorrPpb = ppb;
+}
+
+#if RTC_CAL_REF == 0
+/**
+  * @brief SYSCLK comes from HSE, directly or through the PLL
+  * @param None
+  * @retval 1 on HSE
+  */
+static uint8_t RtcCal_OnHse(void)
+{
+  uint32_t sws = RCC->CFGR & RCC_CFGR_SWS;
+
+  if (sws == RCC_CFGR_SWS_HSE)
+  {
+    return 1;
+  }
+  if ((sws == RCC_CFGR_SWS_PLL) && ((RCC->CFGR & RCC_CFGR_PLLSRC) == RCC_CFGR_PLLSRC_HSE_PREDIV))
+  {
+    return 1;
+  }
+  return 0;
+}
+#endif
+
+/**
+  * @brief Take the calibration in RTC_CALR, TIM14 setup with RTC_CAL_REF 0
+  * @param None
+  * @retval None
+  * @note call after RtcWake_Init(); TIM14 is shared with HSI_TRIM, use one
+  */
+void RtcCal_Init(void)
+{
+  Started = 1;
+  Pulses = RtcCal_ReadPulses();
+  CalStats.CorrPpb = (int32_t)(((int64_t)Pulses * 1000000000) / 1048576);
+
+#if RTC_CAL_REF == 0
+  StartTick = SysTick_GetTick() - RTC_CAL_PERIOD_MS;
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_TIM14);
+  MS32_TIM_SetPrescaler(TIM14, 0);
+  MS32_TIM_SetAutoReload(TIM14, 0xFFFF);
+  MS32_TIM_SetRemap(TIM14, MS32_TIM_TIM14_TI1_RMP_RTC_CLK);
+  MS32_TIM_IC_Config(TIM14, MS32_TIM_CHANNEL_CH1, MS32_TIM_ACTIVEINPUT_DIRECTTI | MS32_TIM_ICPSC_DIV8 |
+                                                  MS32_TIM_IC_FILTER_FDIV1 | MS32_TIM_IC_POLARITY_RISING);
+  MS32_TIM_CC_EnableChannel(TIM14, MS32_TIM_CHANNEL_CH1);
+  MS32_TIM_GenerateEvent_UPDATE(TIM14);
+  MS32_TIM_EnableCounter(TIM14);
+
+  NVIC_SetPriority(TIM14_IRQn, 0x1);
+  NVIC_EnableIRQ(TIM14_IRQn);
+#endif
+}
+
+/**
+  * @brief Run measurements and write the calibration, call periodically
+  * @param None
+  * @retval None
+  */
+void RtcCal_Poll(void)
+{
+#if RTC_CAL_REF == 0
+  uint32_t timclk;
+  uint32_t expected;
+  int32_t err;
+#endif
+
+  if (!Started)
+  {
+    return;
+  }
+  if ((Pulses != RtcCal_ReadPulses()) && !MS32_RTC_IsActiveFlag_RECALP(RTC))
+  {
+    MS32_RTC_Cal(RTC, (Pulses > 0) ? MS32_RTC_CALIB_INSERTPULSE_SET : MS32_RTC_CALIB_INSERTPULSE_NONE,
+                 MS32_RTC_CALIB_PERIOD_32SEC, (uint16_t)((Pulses > 0) ? (RTC_CAL_PULSES_MAX - Pulses) : -Pulses));
+    CalStats.Writes++;
+  }
+
+#if RTC_CAL_REF == 0
+  if (Done)
+  {
+    Done = 0;
+    Running = 0;
+    StartTick = SysTick_GetTick();
+    if (Overrun)
+    {
+      CalStats.Overcaptures++;
+      return;
+    }
+    timclk = ClockPlan_TimClkHz();
+    expected = (uint32_t)(((uint64_t)timclk * (RTC_CAL_CAPTURES * 8U)) / RTC_CAL_LSE_HZ);
+    /* fast LSE: fewer timer clocks over its edges */
+    err = (int32_t)((((int64_t)expected - (int64_t)Counts) * 1000000000) / (int64_t)Counts);
+    CalStats.LastErrorPpb = err;
+    CalStats.Measurements++;
+    RtcCal_Apply(-err);
+    return;
+  }
+  if (Running || ((SysTick_GetTick() - StartTick) < RTC_CAL_PERIOD_MS) || !RtcCal_OnHse() ||
+      !MS32_RCC_LSE_IsReady())
+  {
+    return;
+  }
+  Captures = 0;
+  Counts = 0;
+  Overrun = 0;
+  Running = 1;
+  MS32_TIM_ClearFlag_CC1OVR(TIM14);
+  MS32_TIM_ClearFlag_CC1(TIM14);
+  MS32_TIM_EnableIT_CC1(TIM14);
+#endif
+}
+
+/**
+  * @brief Host time sync: phase correction, with RTC_CAL_REF 1 also the
+  *        frequency error since the last phase correction
+  * @param HostMs host time of day in ms, 0 ~ 86399999, when the message
+  *        started
+  * @retval SUCCESS, ERROR RTC not readable or HostMs out of range
+  * @note main loop only: a shift or a time set waits for the RTC
+  */
+ErrorStatus RtcCal_Sync(uint32_t HostMs)
+{
+  uint32_t ticks;
+  uint32_t host;
+  int32_t offset;
+  uint8_t fix = 1;
+#if RTC_CAL_REF == 1
+  uint32_t elapsed;
+#endif
+  MS32_RTC_TimeTypeDef time;
+  uint32_t wait = RTC_CAL_SHIFT_WAIT;
+
+  if (HostMs >= RTC_CAL_DAY_MS)
+  {
+    return ERROR;
+  }
+  /* host time in RTC ticks */
+  host = ((HostMs / 1000U) * RTC_WAKE_TICK_HZ) + (((HostMs % 1000U) * RTC_WAKE_TICK_HZ) / 1000U);
+
+  __disable_irq();
+  if (!RtcWake_GetTicks(&ticks))
+  {
+    __enable_irq();
+    return ERROR;
+  }
+  offset = (int32_t)(ticks - host);
+  if (offset > (RTC_CAL_DAY_TICKS / 2))
+  {
+    offset -= RTC_CAL_DAY_TICKS;
+  }
+  else if (offset <= -(RTC_CAL_DAY_TICKS / 2))
+  {
+    offset += RTC_CAL_DAY_TICKS;
+  }
+  CalStats.Syncs++;
+  CalStats.LastOffsetMs = (offset * 1000) / (int32_t)RTC_WAKE_TICK_HZ;
+
+#if RTC_CAL_REF == 1
+  if (Based && (offset > -(int32_t)RTC_WAKE_TICK_HZ) && (offset < (int32_t)RTC_WAKE_TICK_HZ))
+  {
+    elapsed = (HostMs >= BaseHostMs) ? (HostMs - BaseHostMs) : (HostMs + RTC_CAL_DAY_MS - BaseHostMs);
+    if (elapsed >= RTC_CAL_SYNC_MIN_MS)
+    {
+      /* drift in ticks over elapsed ms */
+      CalStats.LastErrorPpb = (int32_t)(((int64_t)(offset - BaseOffset) * 1000000000000LL) /
+                                        ((int64_t)elapsed * RTC_WAKE_TICK_HZ));
+      CalStats.Measurements++;
+      RtcCal_Apply(CalStats.CorrPpb - CalStats.LastErrorPpb);
+    }
+    else
+    {
+      /* too close for a drift, keep the base */
+      fix = 0;
+    }
+  }
+#endif
+
+  if (fix && ((offset >= (int32_t)((RTC_CAL_PHASE_MS * RTC_WAKE_TICK_HZ) / 1000U)) ||
+              (offset <= -(int32_t)((RTC_CAL_PHASE_MS * RTC_WAKE_TICK_HZ) / 1000U))))
+  {
+    RtcWake_Resync();
+    if ((offset >= (int32_t)RTC_WAKE_TICK_HZ) || (offset <= -(int32_t)RTC_WAKE_TICK_HZ))
+    {
+      /* whole seconds: set them, the second starts now */
+      time.TimeFormat = MS32_RTC_TIME_FORMAT_AM_OR_24;
+      time.Hours = (uint8_t)(HostMs / 3600000U);
+      time.Minutes = (uint8_t)((HostMs / 60000U) % 60U);
+      time.Seconds = (uint8_t)((HostMs / 1000U) % 60U);
+      MS32_RTC_SetTime(RTC, MS32_RTC_FORMAT_BIN, &time, ENABLE);
+      offset = -(int32_t)(host % RTC_WAKE_TICK_HZ);
+      CalStats.Sets++;
+    }
+    if (offset != 0)
+    {
+      while (MS32_RTC_IsActiveFlag_SHP(RTC) && (wait != 0))
+      {
+        wait--;
+      }
+      if (offset > 0)
+      {
+        MS32_RTC_ShiftSec(RTC, MS32_RTC_SHIFT_SECOND_DELAY, (uint16_t)offset);
+      }
+      else
+      {
+        /* one second ahead, less the fraction */
+        MS32_RTC_ShiftSec(RTC, MS32_RTC_SHIFT_SECOND_ADVANCE, (uint16_t)(RTC_WAKE_TICK_HZ + offset));
+      }
+      wait = RTC_CAL_SHIFT_WAIT;
+      while (MS32_RTC_IsActiveFlag_SHP(RTC) && (wait != 0))
+      {
+        wait--;
+      }
+      CalStats.Shifts++;
+    }
+    RtcWake_Rebase();
+    offset = 0;
+  }
+#if RTC_CAL_REF == 1
+  if (fix)
+  {
+    Based = 1;
+    BaseHostMs = HostMs;
+    BaseOffset = offset;
+  }
+#endif
+  __enable_irq();
+  return SUCCESS;
+}
+
+/**
+  * @brief Read the calibration statistics
+  * @param Stats pointer to a RtcCal_StatsTypeDef structure
+  * @retval None
+  */
+void RtcCal_GetStats(RtcCal_StatsTypeDef *Stats)
+{
+  *Stats = CalStats;
+}
+
+/**
+  * @brief USART1_PKT command RTC_CAL_CMD_ID
+  * @param Req request payload, empty or the host time of day in ms (4 bytes,
+  *        LSB first)
+  * @param ReqLen request length
+  * @param Rsp response payload: status, then LastOffsetMs, LastErrorPpb and
+  *        CorrPpb, 4 bytes each LSB first
+  * @retval response length
+  * @note register in the USART1_Pkt_Init() command table
+  */
+uint8_t RtcCal_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp)
+{
+  uint32_t ms;
+
+  Rsp[0] = RTC_CAL_STATUS_OK;
+  if (ReqLen >= 4U)
+  {
+    ms = (uint32_t)Req[0] | ((uint32_t)Req[1] << 8) | ((uint32_t)Req[2] << 16) | ((uint32_t)Req[3] << 24);
+    if (RtcCal_Sync(ms) != SUCCESS)
+    {
+      Rsp[0] = RTC_CAL_STATUS_REJECT;
+    }
+  }
+  RtcCal_Put32(&Rsp[1], (uint32_t)CalStats.LastOffsetMs);
+  RtcCal_Put32(&Rsp[5], (uint32_t)CalStats.LastErrorPpb);
+  RtcCal_Put32(&Rsp[9], (uint32_t)CalStats.CorrPpb);
+  return 13;
+}
+
+/**
+  * @brief RTCCLK capture: sum the intervals of one measurement
+  * @param None
+  * @retval None
+  * @note call by TIM14_IRQHandler()
+  */
+void RtcCal_TIM14_IRQHandler(void)
+{
+#if RTC_CAL_REF == 0
+  uint16_t capture;
+
+  if (!Running || !MS32_TIM_IsActiveFlag_CC1(TIM14))
+  {
+    return;
+  }
+  capture = (uint16_t)MS32_TIM_IC_GetCaptureCH1(TIM14);
+  if (MS32_TIM_IsActiveFlag_CC1OVR(TIM14))
+  {
+    MS32_TIM_ClearFlag_CC1OVR(TIM14);
+    Overrun = 1;
+  }
+  if (Captures != 0)
+  {
+    Counts += (uint16_t)(capture - LastCapture);
+  }
+  LastCapture = capture;
+  if (++Captures > RTC_CAL_CAPTURES)
+  {
+    MS32_TIM_DisableIT_CC1(TIM14);
+    Done = 1;
+  }
+#endif
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    RTC_CAL.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of RTC_CAL.c file.
+  *
+  *          RTC closed loop smooth calibration against a reference:
+  *             RTC_CAL_REF 0  ------> HSE: TIM14 TI1 on RTCCLK (LSE), timer
+  *                                    clocked from HSE, SYSCLK must be on HSE
+  *             RTC_CAL_REF 1  ------> host time sync, RtcCal_Sync() or
+  *                                    USART1_PKT command RTC_CAL_CMD_ID
+  *          Frequency: RTC_CALR (CALP, CALM, 32s cycle), about 0.95ppm a step.
+  *          Phase: every sync shifts the sub-seconds (RTC_SHIFTR), offsets
+  *          of a second and more set the time first.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTC_CAL_H
+#define __RTC_CAL_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#ifndef RTC_CAL_REF
+#define RTC_CAL_REF                 0
+#endif
+#define RTC_CAL_LSE_HZ              32768U
+/* Capture intervals per measurement, 8 LSE periods each (ICPSC /8): 1s */
+#define RTC_CAL_CAPTURES            4096U
+/* Time between two HSE measurements */
+#define RTC_CAL_PERIOD_MS           60000U
+
+/* Host syncs: shortest interval for a frequency estimate, a 1ms jitter
+   gives 1.7ppm at 10 minutes. Syncs must come less than a day apart */
+#define RTC_CAL_SYNC_MIN_MS         600000U
+/* Phase errors below this are left alone */
+#define RTC_CAL_PHASE_MS            2U
+
+/* Each measurement moves the correction 1/RTC_CAL_GAIN of the way */
+#define RTC_CAL_GAIN                2
+
+#define RTC_CAL_CMD_ID              0x12U
+#define RTC_CAL_STATUS_OK           0x00U
+#define RTC_CAL_STATUS_REJECT       0x01U   /* RTC not readable or time out of range */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Measurements;    /* frequency errors taken */
+  uint32_t Overcaptures;    /* capture lost, measurement dropped */
+  uint32_t Writes;          /* RTC_CALR changed */
+  uint32_t Syncs;
+  uint32_t Shifts;          /* sub-second phase corrections */
+  uint32_t Sets;            /* time set, a second or more off */
+  int32_t  LastErrorPpb;    /* RTC against the reference, + is fast; REF 0: LSE
+                               before calibration, REF 1: after */
+  int32_t  CorrPpb;         /* calibration applied */
+  int32_t  LastOffsetMs;    /* RTC minus host time at the last sync */
+} RtcCal_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void RtcCal_Init(void);
+void RtcCal_Poll(void);
+ErrorStatus RtcCal_Sync(uint32_t HostMs);
+void RtcCal_GetStats(RtcCal_StatsTypeDef *Stats);
+uint8_t RtcCal_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp);
+
+void RtcCal_TIM14_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+#if (RTC_CAL_REF < 0) || (RTC_CAL_REF > 1)
+#error "RTC_CAL_REF: 0 HSE, 1 host time sync"
+#endif
+
+#endif /* __RTC_CAL_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,493 @@
+/**
+  ******************************************************************************
+  * @file 		RTC_LOG.c
+	* @author		SINOMCU-AE
+  * @brief 		RTC timestamp and tamper event journal in flash
+  *
+  *          This file provides the event journal:
+  *             the RTC latches the time of a RTC_TS edge or a tamper event
+  *             (TAMPTS) without the CPU; the interrupt converts the latch
+  *             to Unix time (RTC_TIME) and puts it in a RAM ring, before
+  *             the next event can overwrite it; an overwrite the RTC still
+  *             reports (TSOVF) is journaled as RTC_LOG_EVT_LOST;
+  *             RtcLog_Poll() writes the ring as delta records once
+  *             RTC_LOG_BATCH are waiting or the oldest is RTC_LOG_FLUSH_MS
+  *             old: one flash unlock per batch, every byte programmed once;
+  *             a full page goes on in the other one, erased first, so the
+  *             previous page of events stays readable.
+  *
+  *          The time stamp registers hold no year: it is taken from the
+  *          RTC, one less when the stamp month is after the current one.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "RTC_LOG.h"
+#include "RTC_TIME.h"
+#include "RTC_WAKE.h"
+#include "SysTick_Delay.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+#define RTC_LOG_ERASED              0xFFFFFFFFUL
+#define RTC_LOG_HEADER              8U
+#define RTC_LOG_DELTA_MAX           0xFFFFFUL
+/* seconds field all ones, event 0, sub-seconds 0 */
+#define RTC_LOG_ESCAPE              (RTC_LOG_DELTA_MAX << 10)
+#define RTC_LOG_RECORD(E, D, S)     (((uint32_t)(E) << 30) | ((uint32_t)(D) << 10) | (uint32_t)(S))
+/* largest write: escape, Unix time, record */
+#define RTC_LOG_RECORD_MAX          12U
+#define RTC_LOG_NO_PAGE             0xFFU
+
+/* Variables -----------------------------------------------------------------*/
+#if defined (__CC_ARM) || defined (__ARMCC_VERSION)
+/* end of the image in flash, from the linker */
+extern const uint32_t Load$$LR$$LR_IROM1$$Limit;
+#endif
+
+/* RAM ring: written by the interrupt at Head, read at Tail */
+static uint32_t RingSec[RTC_LOG_RING] STARTUP_NOINIT;
+static uint16_t RingSub[RTC_LOG_RING] STARTUP_NOINIT;
+static uint8_t RingEvt[RTC_LOG_RING] STARTUP_NOINIT;
+static __IO uint8_t Head;
+static __IO uint8_t Tail;
+static __IO uint32_t FirstTick;
+
+/* flash page in use (0 ~ RTC_LOG_FLASH_PAGES-1), its sequence, the next
+   free offset and the time the next record counts from */
+static uint8_t Page = RTC_LOG_NO_PAGE;
+static uint16_t Seq;
+static uint32_t Offset;
+static uint32_t LastSec;
+
+static RtcLog_StatsTypeDef LogStats;
+
+/**
+  * @brief Write a 32 bit value LSB first
+  * @param Buf destination
+  * @param Value value
+  * @retval None
+  */
+static void RtcLog_Put32(uint8_t *Buf, uint32_t Value)
+{
+  Buf[0] = (uint8_t)Value;
+  Buf[1] = (uint8_t)(Value >> 8);
+  Buf[2] = (uint8_t)(Value >> 16);
+  Buf[3] = (uint8_t)(Value >> 24);
+}
+
+/**
+  * @brief Put an event in the RAM ring
+  * @param Evt RTC_LOG_EVT_xxx
+  * @param Sec Unix time
+  * @param Sub sub-second ticks
+  * @retval None
+  * @note interrupt context
+  */
+static void RtcLog_Push(uint8_t Evt, uint32_t Sec, uint32_t Sub)
+{
+  uint8_t head = Head;
+
+  LogStats.Events++;
+  if ((uint8_t)(head - Tail) >= RTC_LOG_RING)
+  {
+    LogStats.Drops++;
+    return;
+  }
+  if (head == Tail)
+  {
+    FirstTick = SysTick_GetTick();
+  }
+  RingSec[head & (RTC_LOG_RING - 1U)] = Sec;
+  RingSub[head & (RTC_LOG_RING - 1U)] = (uint16_t)((Sub > RTC_WAKE_PREDIV_S) ? RTC_WAKE_PREDIV_S : Sub);
+  RingEvt[head & (RTC_LOG_RING - 1U)] = Evt;
+  Head = head + 1U;
+}
+
+/**
+  * @brief Time of the latched stamp
+  * @param Sub sub-second ticks
+  * @retval Unix time
+  */
+static uint32_t RtcLog_Stamp(uint32_t *Sub)
+{
+  uint32_t tr = RTC->TSTR;
+  uint32_t tsdr = RTC->TSDR;
+  uint32_t ssr = RTC->TSSSR & RTC_TSSSR_SS;
+  uint32_t dr = RTC->DR;
+  uint32_t year = dr & (RTC_DR_YT | RTC_DR_YU);
+  uint32_t s = RTC->PRER & RTC_PRER_PREDIV_S;
+  uint32_t sec;
+
+  /* stamp from last year: BCD year minus one */
+  if (((tsdr & (RTC_DR_MT | RTC_DR_MU)) > (dr & (RTC_DR_MT | RTC_DR_MU))) && (year != 0))
+  {
+    year = ((year & RTC_DR_YU) == 0) ? (year - RTC_DR_YT_0 + (9UL << RTC_DR_YU_Pos)) : (year - RTC_DR_YU_0);
+  }
+  sec = RtcTime_ToEpoch(tr, year | (tsdr & ~(RTC_DR_YT | RTC_DR_YU)));
+  if (ssr > s)
+  {
+    sec--;
+    ssr -= s + 1U;
+  }
+  *Sub = s - ssr;
+  return sec;
+}
+
+/**
+  * @brief Address of a journal page
+  * @param Index 0 ~ RTC_LOG_FLASH_PAGES-1
+  * @retval flash address
+  */
+static uint32_t RtcLog_PageAddr(uint8_t Index)
+{
+  return RTC_LOG_FLASH_ADDR + ((uint32_t)Index * RTC_LOG_FLASH_PAGE_SIZE);
+}
+
+/**
+  * @brief Program at the free offset of the page in use
+  * @param Buf data, even length
+  * @param Len length
+  * @retval SUCCESS, ERROR flash error
+  */
+static ErrorStatus RtcLog_Program(uint8_t *Buf, uint32_t Len)
+{
+  if (Len == 0)
+  {
+    return SUCCESS;
+  }
+  if (MS32_FLASH_Write(RtcLog_PageAddr(Page) + Offset, Buf, Len) != SUCCESS)
+  {
+    LogStats.SaveErrors++;
+    return ERROR;
+  }
+  Offset += Len;
+  LogStats.BytesWritten += Len;
+  return SUCCESS;
+}
+
+/**
+  * @brief Erase the next page and start it at a time
+  * @param Sec Unix time the first record counts from
+  * @retval SUCCESS, ERROR flash error
+  */
+static ErrorStatus RtcLog_NewPage(uint32_t Sec)
+{
+  uint8_t header[RTC_LOG_HEADER];
+
+  Page = (Page >= (RTC_LOG_FLASH_PAGES - 1U)) ? 0U : (uint8_t)(Page + 1U);
+  Seq++;
+  Offset = 0;
+  LogStats.Erases++;
+  if (MS32_FLASH_PageErase(RTC_LOG_FLASH_PAGE + Page) != SUCCESS)
+  {
+    LogStats.SaveErrors++;
+    Page = RTC_LOG_NO_PAGE;
+    return ERROR;
+  }
+  RtcLog_Put32(&header[0], RTC_LOG_MAGIC | ((uint32_t)Seq << 16));
+  RtcLog_Put32(&header[4], Sec);
+  LastSec = Sec;
+  return RtcLog_Program(header, RTC_LOG_HEADER);
+}
+
+/**
+  * @brief Find the newest page, its end and the time of its last record
+  * @param None
+  * @retval None
+  */
+static void RtcLog_Scan(void)
+{
+  const uint32_t *word;
+  uint32_t i;
+  uint8_t p;
+
+  for (p = 0; p < RTC_LOG_FLASH_PAGES; p++)
+  {
+    word = (const uint32_t *)RtcLog_PageAddr(p);
+    if ((word[0] & 0xFFFFUL) != RTC_LOG_MAGIC)
+    {
+      continue;
+    }
+    if ((Page == RTC_LOG_NO_PAGE) || ((int16_t)((uint16_t)(word[0] >> 16) - Seq) > 0))
+    {
+      Page = p;
+      Seq = (uint16_t)(word[0] >> 16);
+    }
+  }
+  if (Page == RTC_LOG_NO_PAGE)
+  {
+    return;
+  }
+
+  word = (const uint32_t *)RtcLog_PageAddr(Page);
+  LastSec = word[1];
+  for (i = RTC_LOG_HEADER / 4U; (i < (RTC_LOG_FLASH_PAGE_SIZE / 4U)) && (word[i] != RTC_LOG_ERASED); i++)
+  {
+    if ((word[i] == RTC_LOG_ESCAPE) && ((i + 1U) < (RTC_LOG_FLASH_PAGE_SIZE / 4U)))
+    {
+      LastSec = word[++i];
+    }
+    else
+    {
+      LastSec += (word[i] >> 10) & RTC_LOG_DELTA_MAX;
+    }
+  }
+  Offset = i * 4U;
+}
+
+/**
+  * @brief Resume the journal and enable the time stamp and tamper events
+  * @param None
+  * @retval None
+  * @note call after RtcWake_Init(); the RTC time must be set (RtcTime_Set())
+  *       for meaningful stamps
+  */
+void RtcLog_Init(void)
+{
+  RtcLog_Scan();
+
+  /* library MS32_RTC_SetTamp() masks the wrong TAFCR bits: written here */
+  MODIFY_REG(RTC->TAFCR, RTC_TAFCR_TAMP1E | RTC_TAFCR_TAMP2E | RTC_TAFCR_TAMP1TRG | RTC_TAFCR_TAMP2TRG |
+                         RTC_TAFCR_TAMPTS | RTC_TAFCR_TAMPIE,
+             RTC_LOG_TAMPER_TRG | MS32_RTC_TAMPER_TS_ENABLE | RTC_TAFCR_TAMPIE);
+  MS32_RTC_ClearFlag_TAMP1(RTC);
+  MS32_RTC_ClearFlag_TAMP2(RTC);
+  MS32_RTC_ClearFlag_TS(RTC);
+  MS32_RTC_ClearFlag_TSOV(RTC);
+  MS32_RTC_TAMPER_Enable(RTC, RTC_LOG_TAMPERS);
+
+  MS32_RTC_TimStampConfig(RTC, ENABLE, RTC_LOG_TS_EDGE);
+  MS32_RTC_DisableWriteProtection(RTC);
+  MS32_RTC_EnableIT_TS(RTC);
+  MS32_RTC_EnableWriteProtection(RTC);
+
+  MS32_EXTI_EnableRisingTrig_0_31(MS32_EXTI_LINE_19);
+  MS32_EXTI_EnableIT_0_31(MS32_EXTI_LINE_19);
+  NVIC_SetPriority(RTC_IRQn, 0x1);
+  NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/**
+  * @brief Write the RAM ring to flash
+  * @param None
+  * @retval None
+  * @note the core stalls on flash while programming, about 20ms on an erase
+  */
+void RtcLog_Flush(void)
+{
+  /* a batch, one record with its absolute time: one write */
+  uint8_t buf[((RTC_LOG_BATCH - 1U) * 4U) + RTC_LOG_RECORD_MAX];
+  uint32_t len = 0;
+  uint32_t records = 0;
+  /* time the first record of buf counts from */
+  uint32_t base = LastSec;
+  uint32_t sec;
+  uint32_t delta;
+  uint8_t tail = Tail;
+  uint8_t i;
+
+#if defined (__CC_ARM) || defined (__ARMCC_VERSION)
+  if ((uint32_t)&Load$$LR$$LR_IROM1$$Limit > RTC_LOG_FLASH_ADDR)
+  {
+    LogStats.SaveErrors++;
+    Tail = Head;
+    return;
+  }
+#endif
+  while (tail != Head)
+  {
+    i = tail & (RTC_LOG_RING - 1U);
+    sec = RingSec[i];
+    if ((Page == RTC_LOG_NO_PAGE) || ((Offset + len + RTC_LOG_RECORD_MAX) > RTC_LOG_FLASH_PAGE_SIZE))
+    {
+      if (RtcLog_Program(buf, len) != SUCCESS)
+      {
+        break;
+      }
+      LogStats.Records += records;
+      records = 0;
+      len = 0;
+      if (RtcLog_NewPage(sec) != SUCCESS)
+      {
+        break;
+      }
+      base = LastSec;
+    }
+    if ((len + RTC_LOG_RECORD_MAX) > sizeof(buf))
+    {
+      if (RtcLog_Program(buf, len) != SUCCESS)
+      {
+        break;
+      }
+      LogStats.Records += records;
+      records = 0;
+      len = 0;
+      base = LastSec;
+    }
+    delta = sec - LastSec;
+    if ((sec < LastSec) || (delta >= RTC_LOG_DELTA_MAX))
+    {
+      /* clock set back or a long gap: absolute time */
+      RtcLog_Put32(&buf[len], RTC_LOG_ESCAPE);
+      RtcLog_Put32(&buf[len + 4U], sec);
+      len += 8U;
+      delta = 0;
+    }
+    RtcLog_Put32(&buf[len], RTC_LOG_RECORD(RingEvt[i], delta, RingSub[i]));
+    len += 4U;
+    LastSec = sec;
+    records++;
+    tail++;
+    Tail = tail;
+  }
+  if ((tail == Head) && (RtcLog_Program(buf, len) == SUCCESS))
+  {
+    LogStats.Records += records;
+    return;
+  }
+  /* the events not written are lost, the next record counts from the last
+     one in flash; try again with the next flush */
+  LastSec = base;
+  Tail = Head;
+}
+
+/**
+  * @brief Flush when a batch is waiting or the oldest event is old enough
+  * @param None
+  * @retval None
+  * @note call from the main loop
+  */
+void RtcLog_Poll(void)
+{
+  uint8_t pending = (uint8_t)(Head - Tail);
+
+  if ((pending >= RTC_LOG_BATCH) ||
+      ((pending != 0) && ((SysTick_GetTick() - FirstTick) >= RTC_LOG_FLUSH_MS)))
+  {
+    RtcLog_Flush();
+  }
+}
+
+/**
+  * @brief Read the journal statistics
+  * @param Stats pointer to a RtcLog_StatsTypeDef structure
+  * @retval None
+  */
+void RtcLog_GetStats(RtcLog_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = LogStats;
+  __enable_irq();
+}
+
+/**
+  * @brief USART1_PKT command RTC_LOG_CMD_ID
+  * @param Req request payload: page (empty: RTC_LOG_PAGE_STATS), with
+  *        RTC_LOG_PAGE_FLASH a 2 byte offset into the journal pages
+  * @param ReqLen request length
+  * @param Rsp response payload: page, then the statistics 4 bytes each LSB
+  *        first, or the offset and up to RTC_LOG_READ_MAX flash bytes
+  * @retval response length
+  * @note register in the USART1_Pkt_Init() command table
+  */
+uint8_t RtcLog_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp)
+{
+  RtcLog_StatsTypeDef stats;
+  const uint8_t *flash = (const uint8_t *)RTC_LOG_FLASH_ADDR;
+  uint32_t offset;
+  uint8_t len;
+
+  Rsp[0] = (ReqLen != 0) ? Req[0] : RTC_LOG_PAGE_STATS;
+  if ((Rsp[0] == RTC_LOG_PAGE_FLASH) && (ReqLen >= 3U))
+  {
+    offset = (uint32_t)Req[1] | ((uint32_t)Req[2] << 8);
+    Rsp[1] = Req[1];
+    Rsp[2] = Req[2];
+    for (len = 0; (len < RTC_LOG_READ_MAX) && ((offset + len) < (RTC_LOG_FLASH_PAGES * RTC_LOG_FLASH_PAGE_SIZE)); len++)
+    {
+      Rsp[3U + len] = flash[offset + len];
+    }
+    return 3U + len;
+  }
+
+  Rsp[0] = RTC_LOG_PAGE_STATS;
+  RtcLog_GetStats(&stats);
+  RtcLog_Put32(&Rsp[1], stats.Events);
+  RtcLog_Put32(&Rsp[5], stats.Drops);
+  RtcLog_Put32(&Rsp[9], stats.HwLost);
+  RtcLog_Put32(&Rsp[13], stats.Records);
+  RtcLog_Put32(&Rsp[17], stats.BytesWritten);
+  RtcLog_Put32(&Rsp[21], stats.Erases);
+  RtcLog_Put32(&Rsp[25], stats.SaveErrors);
+  return 29;
+}
+
+/**
+  * @brief Time stamp and tamper interrupt: events to the RAM ring
+  * @param None
+  * @retval None
+  * @note call by RTC_IRQHandler()
+  */
+void RtcLog_IRQHandler(void)
+{
+  RtcTime_StampTypeDef now;
+  uint32_t sec = 0;
+  uint32_t sub = 0;
+  uint8_t stamped = 0;
+
+  if (MS32_RTC_IsActiveFlag_TS(RTC))
+  {
+    sec = RtcLog_Stamp(&sub);
+    stamped = 1;
+    /* TSF first, then TSOVF: an event in between still shows as overflow */
+    MS32_RTC_ClearFlag_TS(RTC);
+    if (MS32_RTC_IsActiveFlag_TSOV(RTC))
+    {
+      MS32_RTC_ClearFlag_TSOV(RTC);
+      LogStats.HwLost++;
+      RtcLog_Push(RTC_LOG_EVT_LOST, sec, sub);
+    }
+  }
+  if (!stamped && (MS32_RTC_IsActiveFlag_TAMP1(RTC) || MS32_RTC_IsActiveFlag_TAMP2(RTC)))
+  {
+    /* tamper without a latched stamp: time now */
+    if (RtcTime_Get(&now))
+    {
+      sec = now.Seconds;
+      sub = now.SubTicks;
+    }
+    stamped = 1;
+  }
+  if (MS32_RTC_IsActiveFlag_TAMP1(RTC))
+  {
+    MS32_RTC_ClearFlag_TAMP1(RTC);
+    RtcLog_Push(RTC_LOG_EVT_TAMP1, sec, sub);
+    stamped = 0;
+  }
+  if (MS32_RTC_IsActiveFlag_TAMP2(RTC))
+  {
+    MS32_RTC_ClearFlag_TAMP2(RTC);
+    RtcLog_Push(RTC_LOG_EVT_TAMP2, sec, sub);
+    stamped = 0;
+  }
+  if (stamped)
+  {
+    RtcLog_Push(RTC_LOG_EVT_TS, sec, sub);
+  }
+  MS32_EXTI_ClearFlag_0_31(MS32_EXTI_LINE_19);
+}
+
+/******************************** END OF FILE *********************************/
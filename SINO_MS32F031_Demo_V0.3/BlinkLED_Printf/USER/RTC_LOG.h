@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    RTC_LOG.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of RTC_LOG.c file.
+  *
+  *          RTC timestamp and tamper event journal:
+  *             RTC_TS edge / RTC_TAMPx     ------> hardware time stamp
+  *             RTC interrupt (EXTI line 19) ------> RAM ring, RTC_LOG_RING
+  *             RtcLog_Poll()               ------> batches to 2 flash pages
+  *          Flash record, 4 bytes LSB first:
+  *             [31:30] event, [29:10] seconds since the previous record,
+  *             [9:0] sub-second ticks (1/1024s);
+  *             seconds field all ones: the next word is the Unix time and
+  *             the record after it counts from there.
+  *          Page: word 0 RTC_LOG_MAGIC | sequence << 16, word 1 Unix time
+  *          the first record counts from, then records up to 0xFFFFFFFF.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTC_LOG_H
+#define __RTC_LOG_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Events */
+#define RTC_LOG_EVT_TS              0U      /* RTC_TS pin edge */
+#define RTC_LOG_EVT_TAMP1           1U
+#define RTC_LOG_EVT_TAMP2           2U
+#define RTC_LOG_EVT_LOST            3U      /* TSOVF: a hardware stamp was overwritten */
+
+/* Sources: time stamp edge, tamper inputs (MS32_RTC_TAMPER_x_EN), active levels */
+#define RTC_LOG_TS_EDGE             MS32_RTC_TIMESTAMP_EDGE_FALLING
+#define RTC_LOG_TAMPERS             (MS32_RTC_TAMPER_1_EN | MS32_RTC_TAMPER_2_EN)
+#define RTC_LOG_TAMPER_TRG          (MS32_RTC_TAMPER_ACTIVELEVEL_TAMP1 | MS32_RTC_TAMPER_ACTIVELEVEL_TAMP2)
+
+/* RAM ring, records between two flushes, power of 2 */
+#define RTC_LOG_RING                16U
+/* Flush at this many records, or this long after the oldest one */
+#define RTC_LOG_BATCH               8U
+#define RTC_LOG_FLUSH_MS            5000U
+
+/* Two flash pages below the HSI_TRIM page */
+#define RTC_LOG_FLASH_PAGE          29U
+#define RTC_LOG_FLASH_PAGES         2U
+#define RTC_LOG_FLASH_PAGE_SIZE     0x400U
+#define RTC_LOG_FLASH_ADDR          (FLASH_BASE + (RTC_LOG_FLASH_PAGE * RTC_LOG_FLASH_PAGE_SIZE))
+#define RTC_LOG_MAGIC               0x474CU
+
+#define RTC_LOG_CMD_ID              0x13U
+/* RTC_LOG_CMD_ID request: 1 byte page, RTC_LOG_PAGE_FLASH also 2 bytes offset */
+#define RTC_LOG_PAGE_STATS          0x00U   /* RtcLog_StatsTypeDef, 4 bytes each */
+#define RTC_LOG_PAGE_FLASH          0x01U   /* offset, then RTC_LOG_READ_MAX bytes of the journal pages */
+#define RTC_LOG_READ_MAX            32U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Events;          /* taken from the RTC */
+  uint32_t Drops;           /* RAM ring full, event not kept */
+  uint32_t HwLost;          /* TSOVF, stamps the RTC overwrote */
+  uint32_t Records;         /* written to flash */
+  uint32_t BytesWritten;    /* records, escapes and page headers */
+  uint32_t Erases;
+  uint32_t SaveErrors;      /* flash error, or the pages are used by the image */
+} RtcLog_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void RtcLog_Init(void);
+void RtcLog_Poll(void);
+void RtcLog_Flush(void);
+void RtcLog_GetStats(RtcLog_StatsTypeDef *Stats);
+uint8_t RtcLog_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp);
+
+void RtcLog_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+#if (RTC_LOG_RING & (RTC_LOG_RING - 1U)) != 0
+#error "RTC_LOG_RING must be a power of 2"
+#endif
+
+#endif /* __RTC_LOG_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,255 @@
+/**
+  ******************************************************************************
+  * @file 		RTC_TIME.c
+	* @author		SINOMCU-AE
+  * @brief 		Division free RTC calendar and Unix time conversion
+  *
+  *          This file provides the RTC timestamp functions:
+  *             a snapshot reads SSR, TR and DR and again until nothing
+  *             changed, so a second or midnight roll in between is never
+  *             mixed into one stamp (direct reads or shadow registers);
+  *             BCD to binary and the day count take multiplications only:
+  *             days = years x 365 + leap days + days before the month;
+  *             the way back divides by multiplying with a fixed point
+  *             reciprocal (exact over the whole input range) and walks
+  *             short tables for the year in a 4 year cycle and the month.
+  *
+  *          Cortex-M0 has no divide instruction: the C library routines
+  *          (mktime / gmtime) call the software divide several times.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "RTC_TIME.h"
+#include "RTC_WAKE.h"
+
+/* Private define ------------------------------------------------------------*/
+/* 1970-01-01 to 2000-01-01 */
+#define RTC_TIME_DAYS_2000          10957U
+#define RTC_TIME_DAY_S              86400U
+#define RTC_TIME_CYCLE_DAYS         1461U   /* 4 years */
+
+/* x / d as (x * m) >> k, exact for the ranges used (checked for every
+   quotient boundary) */
+#define RTC_TIME_DIV86400(X)        ((uint32_t)(((uint64_t)(X) * 3257812231ULL) >> 48))  /* X < 2^32 */
+#define RTC_TIME_DIV3600(X)         (((X) * 37283U) >> 27)      /* X < 86400 */
+#define RTC_TIME_DIV60(X)           (((X) * 2185U) >> 17)       /* X < 3600 */
+#define RTC_TIME_DIV7(X)            (((X) * 74899U) >> 19)      /* X < 49720 */
+#define RTC_TIME_DIV1461(X)         (((X) * 22967U) >> 25)      /* X < 36525 */
+#define RTC_TIME_DIV10(X)           (((X) * 103U) >> 10)        /* X < 100 */
+
+/* Variables -----------------------------------------------------------------*/
+/* Days before each month, non leap year */
+static const uint16_t MonthDays[12] =
+{
+  0U, 31U, 59U, 90U, 120U, 151U, 181U, 212U, 243U, 273U, 304U, 334U,
+};
+
+/**
+  * @brief Two BCD digits to binary
+  * @param Bcd value, low byte
+  * @retval 0 ~ 99
+  */
+static uint32_t RtcTime_FromBcd(uint32_t Bcd)
+{
+  return (((Bcd >> 4) & 0xFU) * 10U) + (Bcd & 0xFU);
+}
+
+/**
+  * @brief Binary to two BCD digits
+  * @param Value 0 ~ 99
+  * @retval BCD value
+  */
+static uint32_t RtcTime_ToBcd(uint32_t Value)
+{
+  uint32_t tens = RTC_TIME_DIV10(Value);
+
+  return (tens << 4) | (Value - (tens * 10U));
+}
+
+/**
+  * @brief RTC register values to Unix time
+  * @param Tr RTC_TR value
+  * @param Dr RTC_DR value
+  * @retval seconds since 1970-01-01 00:00:00
+  * @note the 12 hour format (RTC_CR FMT) is taken from the RTC
+  */
+uint32_t RtcTime_ToEpoch(uint32_t Tr, uint32_t Dr)
+{
+  uint32_t year = RtcTime_FromBcd(Dr >> RTC_DR_YU_Pos);
+  uint32_t month = RtcTime_FromBcd((Dr & (RTC_DR_MT | RTC_DR_MU)) >> RTC_DR_MU_Pos);
+  uint32_t hour = RtcTime_FromBcd((Tr & (RTC_TR_HT | RTC_TR_HU)) >> RTC_TR_HU_Pos);
+  uint32_t days;
+
+  if ((month == 0U) || (month > 12U))
+  {
+    month = 1U;
+  }
+  if (RTC->CR & RTC_CR_FMT)
+  {
+    /* 12 AM is 0h, 12 PM is 12h */
+    if (hour == 12U)
+    {
+      hour = 0U;
+    }
+    if (Tr & RTC_TR_PM)
+    {
+      hour += 12U;
+    }
+  }
+
+  /* leap days before the year: 2000, 2004, ... */
+  days = RTC_TIME_DAYS_2000 + (year * 365U) + ((year + 3U) >> 2) + MonthDays[month - 1U] +
+         RtcTime_FromBcd((Dr & (RTC_DR_DT | RTC_DR_DU)) >> RTC_DR_DU_Pos) - 1U;
+  if (((year & 3U) == 0U) && (month > 2U))
+  {
+    days++;
+  }
+  return (days * RTC_TIME_DAY_S) + (hour * 3600U) +
+         (RtcTime_FromBcd((Tr & (RTC_TR_MNT | RTC_TR_MNU)) >> RTC_TR_MNU_Pos) * 60U) +
+         RtcTime_FromBcd(Tr & (RTC_TR_ST | RTC_TR_SU));
+}
+
+/**
+  * @brief Unix time to date and time
+  * @param Epoch RTC_TIME_EPOCH_MIN ~ RTC_TIME_EPOCH_MAX
+  * @param Date binary date, WeekDay 1 Monday ~ 7 Sunday, Year 0 ~ 99
+  * @param Time binary time, 24 hours
+  * @retval None
+  */
+void RtcTime_FromEpoch(uint32_t Epoch, MS32_RTC_DateTypeDef *Date, MS32_RTC_TimeTypeDef *Time)
+{
+  uint32_t days = RTC_TIME_DIV86400(Epoch);
+  uint32_t sec = Epoch - (days * RTC_TIME_DAY_S);
+  uint32_t hour = RTC_TIME_DIV3600(sec);
+  uint32_t min;
+  uint32_t cycle;
+  uint32_t year;
+  uint32_t len;
+  uint32_t month;
+  uint32_t leap;
+
+  sec -= hour * 3600U;
+  min = RTC_TIME_DIV60(sec);
+  Time->TimeFormat = MS32_RTC_TIME_FORMAT_AM_OR_24;
+  Time->Hours = (uint8_t)hour;
+  Time->Minutes = (uint8_t)min;
+  Time->Seconds = (uint8_t)(sec - (min * 60U));
+
+  /* 1970-01-01 was a Thursday */
+  Date->WeekDay = (uint8_t)((days + 3U) - (RTC_TIME_DIV7(days + 3U) * 7U) + 1U);
+
+  days -= RTC_TIME_DAYS_2000;
+  cycle = RTC_TIME_DIV1461(days);
+  days -= cycle * RTC_TIME_CYCLE_DAYS;
+  year = cycle * 4U;
+  /* first year of a cycle is the leap year */
+  len = 366U;
+  while (days >= len)
+  {
+    days -= len;
+    year++;
+    len = 365U;
+  }
+  leap = ((year & 3U) == 0U) ? 1U : 0U;
+  for (month = 11U; month > 0U; month--)
+  {
+    if (days >= (MonthDays[month] + ((month >= 2U) ? leap : 0U)))
+    {
+      break;
+    }
+  }
+  days -= MonthDays[month] + ((month >= 2U) ? leap : 0U);
+  Date->Year = (uint8_t)year;
+  Date->Month = (uint8_t)(month + 1U);
+  Date->Day = (uint8_t)(days + 1U);
+}
+
+/**
+  * @brief Current RTC time as a consistent snapshot
+  * @param Stamp Unix time and sub-second ticks
+  * @retval 1 valid, 0 RTC stopped or its time never set
+  * @note with shadow registers call after RSF (MS32_RTC_WaitForSynchro())
+  *       following a STOP exit
+  */
+uint8_t RtcTime_Get(RtcTime_StampTypeDef *Stamp)
+{
+  uint32_t ssr;
+  uint32_t tr;
+  uint32_t dr;
+  uint32_t s;
+
+  if (((RCC->BDCR & RCC_BDCR_RTCEN) == 0) || !MS32_RTC_IsActiveFlag_INITS(RTC))
+  {
+    return 0;
+  }
+  /* SSR first: with shadow registers it locks TR and DR until DR is read */
+  do
+  {
+    ssr = RTC->SSR & RTC_SSR_SS;
+    tr = RTC->TR;
+    dr = RTC->DR;
+  } while ((ssr != (RTC->SSR & RTC_SSR_SS)) || (tr != RTC->TR) || (dr != RTC->DR));
+
+  s = RTC->PRER & RTC_PRER_PREDIV_S;
+  Stamp->Seconds = RtcTime_ToEpoch(tr, dr);
+  if (ssr > s)
+  {
+    /* after a shift: one second less than TR shows */
+    Stamp->Seconds--;
+    ssr -= s + 1U;
+  }
+  Stamp->SubTicks = (uint16_t)(s - ssr);
+  return 1;
+}
+
+/**
+  * @brief Set the RTC date and time
+  * @param Epoch RTC_TIME_EPOCH_MIN ~ RTC_TIME_EPOCH_MAX
+  * @retval SUCCESS, ERROR out of range or the RTC did not enter init mode
+  * @note sub-seconds restart at 0; RTC_WAKE tracking is carried over
+  */
+ErrorStatus RtcTime_Set(uint32_t Epoch)
+{
+  MS32_RTC_DateTypeDef date;
+  MS32_RTC_TimeTypeDef time;
+  ErrorStatus status;
+
+  if ((Epoch < RTC_TIME_EPOCH_MIN) || (Epoch > RTC_TIME_EPOCH_MAX))
+  {
+    return ERROR;
+  }
+  RtcTime_FromEpoch(Epoch, &date, &time);
+
+  __disable_irq();
+  RtcWake_Resync();
+  MS32_RTC_DisableWriteProtection(RTC);
+  status = MS32_RTC_EnterInitMode(RTC);
+  if (status == SUCCESS)
+  {
+    /* one init mode for both: no midnight between time and date */
+    MS32_RTC_TIME_Config(RTC, MS32_RTC_TIME_FORMAT_AM_OR_24, RtcTime_ToBcd(time.Hours),
+                         RtcTime_ToBcd(time.Minutes), RtcTime_ToBcd(time.Seconds));
+    MS32_RTC_DATE_Config(RTC, date.WeekDay, RtcTime_ToBcd(date.Day), RtcTime_ToBcd(date.Month),
+                         RtcTime_ToBcd(date.Year));
+    MS32_RTC_DisableInitMode(RTC);
+  }
+  MS32_RTC_EnableWriteProtection(RTC);
+  RtcWake_Rebase();
+  __enable_irq();
+  return status;
+}
+
+/******************************** END OF FILE *********************************/
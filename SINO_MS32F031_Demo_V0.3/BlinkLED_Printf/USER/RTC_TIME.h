@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    RTC_TIME.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of RTC_TIME.c file.
+  *
+  *          RTC timestamps as Unix time:
+  *             RtcTime_Get()       ------> seconds since 1970-01-01 00:00:00
+  *                                         and RTC sub-second ticks, time
+  *                                         and date read as one snapshot
+  *             RtcTime_ToEpoch()   ------> RTC_TR / RTC_DR values to seconds
+  *             RtcTime_FromEpoch() ------> seconds to date and time fields
+  *             RtcTime_Set()       ------> RTC set from seconds
+  *          RTC years 00~99 are 2000~2099. No division: day tables,
+  *          multiplications and shifts only.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTC_TIME_H
+#define __RTC_TIME_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* 2000-01-01 00:00:00 and 2099-12-31 23:59:59 */
+#define RTC_TIME_EPOCH_MIN          946684800UL
+#define RTC_TIME_EPOCH_MAX          4102444799UL
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Seconds;         /* Unix time */
+  uint16_t SubTicks;        /* 0 ~ PREDIV_S, (PREDIV_S + 1) a second */
+} RtcTime_StampTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+uint8_t RtcTime_Get(RtcTime_StampTypeDef *Stamp);
+uint32_t RtcTime_ToEpoch(uint32_t Tr, uint32_t Dr);
+void RtcTime_FromEpoch(uint32_t Epoch, MS32_RTC_DateTypeDef *Date, MS32_RTC_TimeTypeDef *Time);
+ErrorStatus RtcTime_Set(uint32_t Epoch);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __RTC_TIME_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,421 @@
+/**
+  ******************************************************************************
+  * @file 		RTC_WAKE.c
+	* @author		SINOMCU-AE
+  * @brief 		RTC alarm wake scheduler and SysTick resynchronization
+  *
+  *          This file provides the long interval scheduler:
+  *             RtcWake_Run() runs the jobs that are due, then sleeps until
+  *             the next one: a short wait in SLEEP on SysTick, a long one
+  *             in STOP until alarm A (time of day and sub-seconds, date
+  *             masked);
+  *             every RTC read adds the ticks since the previous read to a
+  *             ms count (the remainder of the ms conversion is kept, so
+  *             nothing is lost over days); after any STOP exit the SysTick
+  *             tick is moved forward to that count (RtcWake_Resync() from
+  *             PowerMgr_Idle()), the SysTick timers carry on from there.
+  *
+  *          The RTC time and prescalers survive a reset with the backup
+  *          domain and are only set up when they differ.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "RTC_WAKE.h"
+#include "POWER_MGR.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+#define RTC_WAKE_DAY_S              86400U
+#define RTC_WAKE_PRER               ((RTC_WAKE_PREDIV_A << RTC_PRER_PREDIV_A_Pos) | RTC_WAKE_PREDIV_S)
+/* ALRAWF wait, a few RTC clocks */
+#define RTC_WAKE_ALRAW_WAIT         10000U
+
+/* Variables -----------------------------------------------------------------*/
+/* Jobs: period, next due SysTick tick, callback (0: free) */
+static uint32_t JobPeriod[RTC_WAKE_MAX_JOBS];
+static uint32_t JobDue[RTC_WAKE_MAX_JOBS];
+static RtcWake_Callback JobCallback[RTC_WAKE_MAX_JOBS];
+
+static uint8_t Started;
+static uint32_t LastTicks;
+/* ms since RtcWake_Init() on the RTC, and the remainder in 1/1000 ticks */
+static uint32_t RtcMs;
+static uint32_t RtcFrac;
+/* SysTick tick at RtcMs 0 */
+static uint32_t TickOffset;
+static __IO uint8_t AlarmFired;
+
+static RtcWake_StatsTypeDef WakeStats;
+
+/**
+  * @brief RTC time of day in sub-second ticks
+  * @param Ticks time of day, (PREDIV_S + 1) ticks a second
+  * @retval 1 valid, 0 RTC stopped or shadow registers in use
+  * @note also used by ENERGY to time STOP
+  */
+uint8_t RtcWake_GetTicks(uint32_t *Ticks)
+{
+  uint32_t ssr;
+  uint32_t tr;
+  uint32_t s;
+  uint32_t sec;
+
+  if (((RCC->BDCR & RCC_BDCR_RTCEN) == 0) || ((RTC->CR & RTC_CR_BYPSHAD) == 0))
+  {
+    return 0;
+  }
+  /* direct reads: TR again if SS wrapped in between */
+  do
+  {
+    ssr = RTC->SSR;
+    tr = RTC->TR;
+  } while (ssr != RTC->SSR);
+
+  s = RTC->PRER & RTC_PRER_PREDIV_S;
+  sec = ((((tr & RTC_TR_HT) >> RTC_TR_HT_Pos) * 10U) + ((tr & RTC_TR_HU) >> RTC_TR_HU_Pos)) * 3600U;
+  sec += ((((tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos) * 10U) + ((tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos)) * 60U;
+  sec += (((tr & RTC_TR_ST) >> RTC_TR_ST_Pos) * 10U) + ((tr & RTC_TR_SU) >> RTC_TR_SU_Pos);
+  /* SSR counts down from PREDIV_S */
+  *Ticks = (sec * (s + 1U)) + (s - (ssr & RTC_SSR_SS));
+  return 1;
+}
+
+/**
+  * @brief Add the RTC time since the last read to RtcMs
+  * @param None
+  * @retval None
+  * @note at least every 70 minutes: ticks x 1000 must fit 32 bits
+  */
+static void RtcWake_Track(void)
+{
+  uint32_t ticks;
+  uint32_t delta;
+
+  if (!RtcWake_GetTicks(&ticks))
+  {
+    return;
+  }
+  delta = (ticks >= LastTicks) ? (ticks - LastTicks) : (ticks + (RTC_WAKE_DAY_S * RTC_WAKE_TICK_HZ) - LastTicks);
+  LastTicks = ticks;
+  delta = (delta * 1000U) + RtcFrac;
+  RtcMs += delta / RTC_WAKE_TICK_HZ;
+  RtcFrac = delta % RTC_WAKE_TICK_HZ;
+}
+
+/**
+  * @brief Arm alarm A
+  * @param Ticks time of day of the alarm in ticks
+  * @retval None
+  */
+static void RtcWake_SetAlarm(uint32_t Ticks)
+{
+  MS32_RTC_AlarmTypeDef alarm;
+  uint32_t sec = Ticks / RTC_WAKE_TICK_HZ;
+  uint32_t wait = RTC_WAKE_ALRAW_WAIT;
+
+  alarm.AlarmTime.TimeFormat = MS32_RTC_TIME_FORMAT_AM_OR_24;
+  alarm.AlarmTime.Hours = (uint8_t)(sec / 3600U);
+  alarm.AlarmTime.Minutes = (uint8_t)((sec / 60U) % 60U);
+  alarm.AlarmTime.Seconds = (uint8_t)(sec % 60U);
+  alarm.AlarmMask = MS32_RTC_ALARM_MASK_DATEWEEKDAY;
+  alarm.AlarmDateWeekDaySel = MS32_RTC_ALARM_DATEWEEKDAYSEL_DATE;
+  alarm.AlarmDateWeekDay = 1;
+
+  MS32_RTC_DisableWriteProtection(RTC);
+  MS32_RTC_ALARM_Disable(RTC);
+  while (!MS32_RTC_IsActiveFlag_ALRAW(RTC) && (wait != 0))
+  {
+    wait--;
+  }
+  MS32_RTC_ALARM_SetSubSecondMask(RTC, RTC_WAKE_ALARM_MASKSS);
+  MS32_RTC_ALARM_SetSubSecond(RTC, RTC_WAKE_PREDIV_S - (Ticks % RTC_WAKE_TICK_HZ));
+  MS32_RTC_SetAlarm(RTC, MS32_RTC_FORMAT_BIN, &alarm);
+  /* MS32_RTC_SetAlarm() protects the registers again */
+  MS32_RTC_DisableWriteProtection(RTC);
+  MS32_RTC_ClearFlag_ALRA(RTC);
+  MS32_EXTI_ClearFlag_0_31(MS32_EXTI_LINE_17);
+  AlarmFired = 0;
+  MS32_RTC_EnableIT_ALRA(RTC);
+  MS32_RTC_ALARM_Enable(RTC);
+  MS32_RTC_EnableWriteProtection(RTC);
+}
+
+/**
+  * @brief Start LSE and the RTC, alarm A on EXTI line 17
+  * @param None
+  * @retval SUCCESS, ERROR LSE did not start or the RTC runs on another clock
+  * @note call after SysTick_Init(); the ms count starts at the current tick
+  */
+ErrorStatus RtcWake_Init(void)
+{
+  MS32_RTC_InitTypeDef init;
+  uint32_t start = SysTick_GetTick();
+
+  MS32_APB1_GRP1_EnableClock(MS32_APB1_GRP1_PERIPH_PWR);
+  MS32_PWR_EnableBkUpAccess();
+  MS32_RCC_LSE_Enable();
+  while (!MS32_RCC_LSE_IsReady())
+  {
+    if ((SysTick_GetTick() - start) > RTC_WAKE_LSE_TIMEOUT_MS)
+    {
+      return ERROR;
+    }
+  }
+  if (MS32_RCC_GetRTCClockSource() == MS32_RCC_RTC_CLKSOURCE_NONE)
+  {
+    MS32_RCC_SetRTCClockSource(MS32_RCC_RTC_CLKSOURCE_LSE);
+  }
+  else if (MS32_RCC_GetRTCClockSource() != MS32_RCC_RTC_CLKSOURCE_LSE)
+  {
+    /* only a backup domain reset changes it */
+    return ERROR;
+  }
+  MS32_RCC_EnableRTC();
+
+  if (RTC->PRER != RTC_WAKE_PRER)
+  {
+    init.HourFormat = MS32_RTC_HOURFORMAT_24HOUR;
+    init.AsynchPrescaler = RTC_WAKE_PREDIV_A;
+    init.SynchPrescaler = RTC_WAKE_PREDIV_S;
+    if (MS32_RTC_Init(RTC, &init, DISABLE, MS32_RTC_CALIB_OUTPUT_NONE) != SUCCESS)
+    {
+      return ERROR;
+    }
+  }
+  MS32_RTC_DisableWriteProtection(RTC);
+  MS32_RTC_EnableShadowRegBypass(RTC);
+  MS32_RTC_EnableWriteProtection(RTC);
+
+  MS32_EXTI_EnableRisingTrig_0_31(MS32_EXTI_LINE_17);
+  MS32_EXTI_EnableIT_0_31(MS32_EXTI_LINE_17);
+  NVIC_SetPriority(RTC_IRQn, 0x1);
+  NVIC_EnableIRQ(RTC_IRQn);
+
+  __disable_irq();
+  RtcWake_GetTicks(&LastTicks);
+  RtcMs = 0;
+  RtcFrac = 0;
+  TickOffset = SysTick_GetTick();
+  Started = 1;
+  __enable_irq();
+  return SUCCESS;
+}
+
+/**
+  * @brief Start a periodic job
+  * @param Job 0 ~ RTC_WAKE_MAX_JOBS-1
+  * @param PeriodMs period, first run one period from now
+  * @param Callback job, runs in RtcWake_Run()
+  * @retval SUCCESS, ERROR bad job number or period
+  */
+ErrorStatus RtcWake_Start(uint8_t Job, uint32_t PeriodMs, RtcWake_Callback Callback)
+{
+  if ((Job >= RTC_WAKE_MAX_JOBS) || (PeriodMs == 0) || (PeriodMs > 0x7FFFFFFFU))
+  {
+    return ERROR;
+  }
+  JobPeriod[Job] = PeriodMs;
+  JobDue[Job] = SysTick_GetTick() + PeriodMs;
+  JobCallback[Job] = Callback;
+  return SUCCESS;
+}
+
+/**
+  * @brief Stop a job
+  * @param Job 0 ~ RTC_WAKE_MAX_JOBS-1
+  * @retval None
+  */
+void RtcWake_Stop(uint8_t Job)
+{
+  if (Job < RTC_WAKE_MAX_JOBS)
+  {
+    JobCallback[Job] = 0;
+  }
+}
+
+/**
+  * @brief Run the due jobs, then sleep until the next one or an interrupt
+  * @param None
+  * @retval None
+  * @note call from the main loop; returns after every wake-up. STOP is
+  *       voted through POWER_MGR_CLIENT_RTC, other votes may keep the
+  *       core in SLEEP.
+  */
+void RtcWake_Run(void)
+{
+  uint32_t now;
+  uint32_t late;
+  uint32_t left;
+  uint32_t wait = 0xFFFFFFFFU;
+  uint32_t ticks;
+  uint8_t stop = 0;
+  uint8_t i;
+
+  if (!Started)
+  {
+    return;
+  }
+  __disable_irq();
+  RtcWake_Track();
+  __enable_irq();
+
+  now = SysTick_GetTick();
+  for (i = 0; i < RTC_WAKE_MAX_JOBS; i++)
+  {
+    late = now - JobDue[i];
+    if ((JobCallback[i] == 0) || ((int32_t)late < 0))
+    {
+      continue;
+    }
+    WakeStats.Runs++;
+    WakeStats.LastLateMs = late;
+    if (late > WakeStats.MaxLateMs)
+    {
+      WakeStats.MaxLateMs = late;
+    }
+    JobCallback[i]();
+    JobDue[i] += JobPeriod[i];
+    if ((int32_t)(now - JobDue[i]) >= 0)
+    {
+      /* more than a period behind: restart the period */
+      WakeStats.Skips++;
+      JobDue[i] = now + JobPeriod[i];
+    }
+  }
+
+  now = SysTick_GetTick();
+  for (i = 0; i < RTC_WAKE_MAX_JOBS; i++)
+  {
+    if (JobCallback[i] == 0)
+    {
+      continue;
+    }
+    left = JobDue[i] - now;
+    if ((int32_t)left <= 0)
+    {
+      return;
+    }
+    if (left < wait)
+    {
+      wait = left;
+    }
+  }
+  if (wait == 0xFFFFFFFFU)
+  {
+    return;
+  }
+
+  if ((wait >= RTC_WAKE_THRESHOLD_MS) && RtcWake_GetTicks(&ticks))
+  {
+    if (wait > RTC_WAKE_MAX_STOP_MS)
+    {
+      wait = RTC_WAKE_MAX_STOP_MS;
+    }
+    /* rounded up: the tick is at or past the due time after the resync */
+    ticks += ((wait * RTC_WAKE_TICK_HZ) + 999U) / 1000U;
+    if (ticks >= (RTC_WAKE_DAY_S * RTC_WAKE_TICK_HZ))
+    {
+      ticks -= RTC_WAKE_DAY_S * RTC_WAKE_TICK_HZ;
+    }
+    RtcWake_SetAlarm(ticks);
+    /* the STOP time only is taken from the RTC: the tick and the RTC ms,
+       quantized apart by up to 2ms, are aligned at the entry */
+    __disable_irq();
+    RtcWake_Track();
+    TickOffset = SysTick_GetTick() - RtcMs;
+    __enable_irq();
+    PowerMgr_Vote(POWER_MGR_CLIENT_RTC, POWER_MGR_STOP_LP);
+    stop = 1;
+  }
+  else
+  {
+    /* SysTick times the wait */
+    PowerMgr_Vote(POWER_MGR_CLIENT_RTC, POWER_MGR_SLEEP);
+  }
+
+  if (PowerMgr_Idle() >= POWER_MGR_STOP)
+  {
+    WakeStats.Stops++;
+    if (stop && AlarmFired)
+    {
+      WakeStats.AlarmWakes++;
+    }
+  }
+  PowerMgr_Vote(POWER_MGR_CLIENT_RTC, POWER_MGR_STOP_LP);
+}
+
+/**
+  * @brief Move the SysTick tick to the RTC time after STOP
+  * @param None
+  * @retval None
+  * @note call by PowerMgr_Idle() after the clock restore, interrupts
+  *       disabled; does nothing before RtcWake_Init()
+  */
+void RtcWake_Resync(void)
+{
+  if (!Started)
+  {
+    return;
+  }
+  RtcWake_Track();
+  WakeStats.ResyncMs += SysTick_Resync(TickOffset + RtcMs);
+}
+
+/**
+  * @brief Restart the RTC time tracking from the current RTC time
+  * @param None
+  * @retval None
+  * @note call after the RTC time was shifted or set (RTC_CAL), with
+  *       interrupts disabled since RtcWake_Resync() before the change:
+  *       the jump is a correction of the RTC, not elapsed time
+  */
+void RtcWake_Rebase(void)
+{
+  if (Started)
+  {
+    RtcWake_GetTicks(&LastTicks);
+  }
+}
+
+/**
+  * @brief Read the scheduler statistics
+  * @param Stats pointer to a RtcWake_StatsTypeDef structure
+  * @retval None
+  */
+void RtcWake_GetStats(RtcWake_StatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = WakeStats;
+  __enable_irq();
+}
+
+/**
+  * @brief Alarm A interrupt
+  * @param None
+  * @retval None
+  * @note call by RTC_IRQHandler()
+  */
+void RtcWake_IRQHandler(void)
+{
+  if (MS32_RTC_IsActiveFlag_ALRA(RTC))
+  {
+    MS32_RTC_ClearFlag_ALRA(RTC);
+    AlarmFired = 1;
+  }
+  MS32_EXTI_ClearFlag_0_31(MS32_EXTI_LINE_17);
+}
+
+/******************************** END OF FILE *********************************/
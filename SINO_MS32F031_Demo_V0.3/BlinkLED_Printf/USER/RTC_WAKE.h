@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    RTC_WAKE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of RTC_WAKE.c file.
+  *
+  *          Periodic jobs with long sleeps on the RTC:
+  *             RTC on LSE, RTC_WAKE_TICK_HZ sub-second ticks, shadow
+  *             registers bypassed
+  *             next job within RTC_WAKE_THRESHOLD_MS   ------> SLEEP, SysTick
+  *             next job further away                   ------> alarm A, STOP
+  *             STOP exit                               ------> SysTick ms tick
+  *                                                             set from the RTC
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTC_WAKE_H
+#define __RTC_WAKE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* LSE 32768Hz / (PREDIV_A + 1) / (PREDIV_S + 1) = 1Hz, 1024 ticks a second */
+#define RTC_WAKE_PREDIV_A           31U
+#define RTC_WAKE_PREDIV_S           1023U
+#define RTC_WAKE_TICK_HZ            (RTC_WAKE_PREDIV_S + 1U)
+/* Alarm A compares SS[9:0], all RTC_WAKE_PREDIV_S bits */
+#define RTC_WAKE_ALARM_MASKSS       10U
+
+/* Waits from this length on use the alarm and STOP */
+#define RTC_WAKE_THRESHOLD_MS       20U
+/* Longest STOP, the ms conversion needs a RTC read at least every 70 minutes */
+#define RTC_WAKE_MAX_STOP_MS        3600000U
+#define RTC_WAKE_LSE_TIMEOUT_MS     2000U
+
+#define RTC_WAKE_MAX_JOBS           4U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Job callback, runs in RtcWake_Run()
+  */
+typedef void (*RtcWake_Callback)(void);
+
+typedef struct
+{
+  uint32_t Stops;           /* sleeps on the alarm */
+  uint32_t AlarmWakes;      /* ended by the alarm, the others by another interrupt */
+  uint32_t ResyncMs;        /* added to the SysTick tick after STOP, sum */
+  uint32_t Runs;            /* job callbacks */
+  uint32_t Skips;           /* periods dropped, a job more than a period late */
+  uint32_t LastLateMs;      /* job run after its due time */
+  uint32_t MaxLateMs;
+} RtcWake_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+ErrorStatus RtcWake_Init(void);
+ErrorStatus RtcWake_Start(uint8_t Job, uint32_t PeriodMs, RtcWake_Callback Callback);
+void RtcWake_Stop(uint8_t Job);
+void RtcWake_Run(void);
+uint8_t RtcWake_GetTicks(uint32_t *Ticks);
+void RtcWake_Resync(void);
+void RtcWake_Rebase(void);
+void RtcWake_GetStats(RtcWake_StatsTypeDef *Stats);
+
+void RtcWake_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __RTC_WAKE_H */
+
+/******************************** END OF FILE *********************************/
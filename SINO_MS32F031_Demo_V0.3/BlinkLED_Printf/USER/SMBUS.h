@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    SMBUS.h
+  * @author  SINOMCU-AE
+  * @brief   SMBus / PMBus definitions shared by SMBUS_DEVICE.c and SMBUS_HOST.c.
+  *
+  *          I2C1 in SMBus mode:
+  *             PB6   ------> I2C1_SCL
+  *             PB7   ------> I2C1_SDA
+  *             PB5   ------> I2C1_SMBA  (SMBALERT#, open drain)
+  *          PEC (CRC-8, x^8+x^2+x+1) is generated and checked by the I2C1
+  *          PEC unit; clock low timeouts are detected by TIMEOUTR.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SMBUS_H
+#define __SMBUS_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "I2C1_TIMING.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* SMBus 3.x block transfers carry up to 255 bytes, 32 keeps RAM small */
+#define SMBUS_BLOCK_MAX             32U
+
+/* Alert Response Address, 7 bit */
+#define SMBUS_ARA                   0x0CU
+
+/* Transfer types, the data after the command code */
+#define SMBUS_SEND                  0U      /* none (send byte) */
+#define SMBUS_BYTE                  1U      /* 1 byte */
+#define SMBUS_WORD                  2U      /* 2 bytes, LSB first */
+#define SMBUS_BLOCK                 3U      /* count + count bytes */
+#define SMBUS_RECEIVE               4U      /* host only: 1 byte read, no command code (ARA) */
+
+/* TIMEOUTR counts 2048 I2CCLK per step */
+#define SMBUS_TIMEOUT_STEPS(MS)     (((MS) * I2C1_TIMING_CLK_KHZ) / 2048)
+/* tTIMEOUT: SCL low 25ms (min) ~ 35ms (max), detect just above 25ms */
+#define SMBUS_TIMEOUTA              SMBUS_TIMEOUT_STEPS(25)
+/* cumulative stretch: tLOW:SEXT 25ms for a device, tLOW:MEXT 10ms for a host */
+#define SMBUS_TIMEOUTB_DEVICE       (SMBUS_TIMEOUT_STEPS(25) - 1)
+#define SMBUS_TIMEOUTB_HOST         (SMBUS_TIMEOUT_STEPS(10) - 1)
+
+#if SMBUS_TIMEOUT_STEPS(25) > 4096
+#error "SMBus timeout does not fit TIMEOUTR at this I2CCLK"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __SMBUS_H */
+
+/******************************** END OF FILE *********************************/
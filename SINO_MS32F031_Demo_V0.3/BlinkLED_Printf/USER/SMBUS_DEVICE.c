@@ -0,0 +1,477 @@
+/**
+  ******************************************************************************
+  * @file 		SMBUS_DEVICE.c
+	* @author		SINOMCU-AE
+  * @brief 		SMBus / PMBus device with hardware PEC and timeouts
+  *
+  *          This file provides an SMBus device on I2C1:
+  *             slave byte control with NBYTES = 1 and RELOAD stretches SCL
+  *             after the command code and after a block count, so the
+  *             table lookup can program NBYTES for the rest of the write
+  *             and ACK or NACK the byte;
+  *             the last byte of every write and read is the PEC, checked
+  *             (PECBYTE, NACK on mismatch) or appended by the I2C1 PEC unit,
+  *             no CRC-8 is computed in software;
+  *             TIMEOUTR detects SCL low beyond tTIMEOUT and the cumulative
+  *             stretch limit tLOW:SEXT, the hardware releases the bus;
+  *             SMBus_Device_RaiseAlert() drives SMBALERT# and enables the
+  *             Alert Response Address, the ARA read releases it.
+  *          PEC is required on every transfer.
+  *
+  *          Needed call SMBus_Device_IRQHandler() in I2C1_IRQHandler().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "SMBUS_DEVICE.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Transaction phase */
+#define PH_IDLE                     0U
+#define PH_CMD                      1U      /* next byte is the command code */
+#define PH_COUNT                    2U      /* next byte is the block count */
+#define PH_DATA                     3U      /* data bytes and PEC */
+#define PH_WAIT_READ                4U      /* read-only command, repeated start expected */
+#define PH_READ                     5U      /* sending to the host */
+
+/* Variables -----------------------------------------------------------------*/
+static const SMBus_CmdTypeDef *CmdTable;
+static uint8_t CmdCount;
+static uint8_t Enabled;
+
+static const SMBus_CmdTypeDef *Cur;
+static uint8_t Phase;
+static uint8_t CmdCode;
+static uint8_t Buf[SMBUS_BLOCK_MAX + 2];  /* [count] data [PEC] */
+static uint8_t Pos;
+static uint8_t Expect;                    /* bytes of Buf for a complete write */
+static uint8_t Len;                       /* bytes to send */
+static uint8_t RxBad;
+static uint8_t AraRead;
+static __IO uint8_t AlertPending;
+
+static SMBus_DeviceStatsTypeDef DevStats;
+
+/**
+  * @brief Find a command in the table
+  * @param Code command code
+  * @retval table entry, 0 not found
+  */
+static const SMBus_CmdTypeDef *SMBus_Device_Find(uint8_t Code)
+{
+  uint32_t i;
+
+  for (i = 0; i < CmdCount; i++)
+  {
+    if (CmdTable[i].Code == Code)
+    {
+      return &CmdTable[i];
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief Program the next receive step and release SCL
+  * @param Count bytes, PEC included when Last
+  * @param Last 1: no RELOAD, the final byte is the PEC
+  * @retval None
+  */
+static void SMBus_Device_Receive(uint8_t Count, uint8_t Last)
+{
+  if (Last != 0U)
+  {
+    MS32_I2C_DisableReloadMode(I2C1);
+    MS32_I2C_EnableSMBusPECCompare(I2C1);
+  }
+  else
+  {
+    MS32_I2C_EnableReloadMode(I2C1);
+  }
+  MS32_I2C_SetTransferSize(I2C1, Count);
+}
+
+/**
+  * @brief Decide on the byte held by TCR (command code or block count)
+  * @param None
+  * @retval None
+  * @note SCL is stretched before the ACK bit until NBYTES is written
+  */
+static void SMBus_Device_Dispatch(void)
+{
+  uint32_t t0 = SysTick_GetUs();
+  uint32_t us;
+  uint8_t ok = 1;
+
+  if (Phase == PH_CMD)
+  {
+    Cur = SMBus_Device_Find(CmdCode);
+    if (Cur == 0)
+    {
+      ok = 0;
+    }
+    else if ((Cur->Access & SMBUS_WR) == 0U)
+    {
+      /* only a repeated start read may follow */
+      Phase = PH_WAIT_READ;
+      MS32_I2C_AcknowledgeNextData(I2C1, MS32_I2C_ACK);
+      SMBus_Device_Receive(1, 0);
+    }
+    else if (Cur->Type == SMBUS_BLOCK)
+    {
+      Phase = PH_COUNT;
+      MS32_I2C_AcknowledgeNextData(I2C1, MS32_I2C_ACK);
+      SMBus_Device_Receive(1, 0);
+    }
+    else
+    {
+      /* SEND: PEC only, BYTE / WORD: data + PEC; a read may still follow */
+      Phase = PH_DATA;
+      Pos = 0;
+      Expect = Cur->Type + 1U;
+      MS32_I2C_AcknowledgeNextData(I2C1, MS32_I2C_ACK);
+      SMBus_Device_Receive(Expect, 1);
+    }
+  }
+  else if ((Phase == PH_COUNT) && (Buf[0] != 0U) && (Buf[0] <= Cur->Size))
+  {
+    Phase = PH_DATA;
+    Pos = 1;
+    Expect = Buf[0] + 2U;
+    MS32_I2C_AcknowledgeNextData(I2C1, MS32_I2C_ACK);
+    SMBus_Device_Receive(Buf[0] + 1U, 1);
+  }
+  else
+  {
+    ok = 0;
+  }
+
+  if (ok == 0U)
+  {
+    DevStats.BadCommands++;
+    RxBad = 1;
+    Phase = PH_IDLE;
+    MS32_I2C_AcknowledgeNextData(I2C1, MS32_I2C_NACK);
+    SMBus_Device_Receive(1, 0);
+  }
+
+  us = SysTick_GetUs() - t0;
+  if (us > DevStats.MaxDispatchUs)
+  {
+    DevStats.MaxDispatchUs = us;
+  }
+}
+
+/**
+  * @brief Load the reply for a read into Buf
+  * @param None
+  * @retval None
+  */
+static void SMBus_Device_LoadReply(void)
+{
+  uint32_t i;
+  uint8_t count = 0;
+
+  AraRead = 0;
+  if (MS32_I2C_GetAddressMatchCode(I2C1) == (SMBUS_ARA << 1))
+  {
+    /* alert response: own address in bits 7:1 */
+    Buf[0] = (uint8_t)(SMBUS_DEVICE_ADDR << 1);
+    Len = 1;
+    AraRead = 1;
+  }
+  else if ((Cur != 0) && ((Cur->Access & SMBUS_RD) != 0U) && (Cur->Type != SMBUS_SEND) &&
+           (Phase != PH_CMD) && (RxBad == 0U))
+  {
+    if (Cur->Type == SMBUS_BLOCK)
+    {
+      count = (Cur->Data[0] <= Cur->Size) ? Cur->Data[0] : Cur->Size;
+      Len = count + 1U;
+    }
+    else
+    {
+      Len = Cur->Type;
+    }
+    for (i = 0; i < Len; i++)
+    {
+      Buf[i] = Cur->Data[i];
+    }
+    if (Cur->Type == SMBUS_BLOCK)
+    {
+      Buf[0] = count;
+    }
+  }
+  else
+  {
+    DevStats.BadCommands++;
+    Buf[0] = 0xFF;
+    Len = 1;
+  }
+}
+
+/**
+  * @brief Abandon the transaction after an error
+  * @param None
+  * @retval None
+  */
+static void SMBus_Device_Abort(void)
+{
+  MS32_I2C_DisableIT_TX(I2C1);
+  MS32_I2C_ClearFlag_TXE(I2C1);
+  Phase = PH_IDLE;
+  Cur = 0;
+  RxBad = 1;
+}
+
+/**
+  * @brief SMBus device Initialization Function
+  * @param Table command table, kept by the driver
+  * @param Count entries
+  * @retval None
+  * @note address SMBUS_DEVICE_ADDR, bus speed from I2C1_TIMING.h
+  */
+void SMBus_Device_Init(const SMBus_CmdTypeDef *Table, uint8_t Count)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_I2C_InitTypeDef I2C_InitStruct;
+
+  CmdTable = Table;
+  CmdCount = Count;
+  Cur = 0;
+  Phase = PH_IDLE;
+  AlertPending = 0;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
+  MS32_RCC_SetI2CClockSource(I2C1_TIMING_CLKSOURCE);
+  /**I2C1 GPIO Configuration
+  PB5   ------> I2C1_SMBA
+  PB6   ------> I2C1_SCL
+  PB7   ------> I2C1_SDA
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_6 | MS32_GPIO_PIN_7;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_OPENDRAIN;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_5;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_3;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  MS32_I2C_StructInit(&I2C_InitStruct);
+  I2C_InitStruct.PeripheralMode = MS32_I2C_MODE_SMBUS_DEVICE;
+  I2C_InitStruct.Timing = I2C1_TIMING;
+  I2C_InitStruct.OwnAddress1 = SMBUS_DEVICE_ADDR << 1;
+  I2C_InitStruct.OwnAddrSize = MS32_I2C_OWNADDRESS1_7BIT;
+  I2C_InitStruct.TypeAcknowledge = MS32_I2C_ACK;
+  MS32_I2C_Init(I2C1, &I2C_InitStruct);
+
+  /* PEC, byte control and timeouts are set with PE = 0 */
+  MS32_I2C_Disable(I2C1);
+  MS32_I2C_EnableSlaveByteControl(I2C1);
+  MS32_I2C_EnableSMBusPEC(I2C1);
+  MS32_I2C_ConfigSMBusTimeout(I2C1, SMBUS_TIMEOUTA, MS32_I2C_SMBUS_TIMEOUTA_MODE_SCL_LOW, SMBUS_TIMEOUTB_DEVICE);
+  MS32_I2C_EnableSMBusTimeout(I2C1, MS32_I2C_SMBUS_AMS32_TIMEOUT);
+
+  /* TC covers TCR; ERR covers PECERR, TIMEOUT, BERR, ARLO, OVR */
+  MS32_I2C_EnableIT_ADDR(I2C1);
+  MS32_I2C_EnableIT_RX(I2C1);
+  MS32_I2C_EnableIT_TC(I2C1);
+  MS32_I2C_EnableIT_STOP(I2C1);
+  MS32_I2C_EnableIT_ERR(I2C1);
+  NVIC_SetPriority(I2C1_IRQn, 0x1);
+  NVIC_EnableIRQ(I2C1_IRQn);
+
+  Enabled = 1;
+  MS32_I2C_Enable(I2C1);
+}
+
+/**
+  * @brief Pull SMBALERT# low until the host reads the Alert Response Address
+  * @param None
+  * @retval None
+  */
+void SMBus_Device_RaiseAlert(void)
+{
+  AlertPending = 1;
+  MS32_I2C_EnableSMBusAlert(I2C1);
+}
+
+/**
+  * @brief Check whether the last alert is still waiting for the host
+  * @param None
+  * @retval 1 SMBALERT# low, 0 released
+  */
+uint8_t SMBus_Device_IsAlertPending(void)
+{
+  return AlertPending;
+}
+
+/**
+  * @brief I2C1 SMBus device event / error interrupt
+  * @param None
+  * @retval None
+  * @note call by I2C1_IRQHandler()
+  */
+void SMBus_Device_IRQHandler(void)
+{
+  uint8_t data;
+  uint32_t i;
+
+  if (Enabled == 0U)
+  {
+    return;
+  }
+
+  if (MS32_I2C_IsActiveSMBusFlag_PECERR(I2C1))
+  {
+    /* the PEC byte has been NACKed by hardware */
+    MS32_I2C_ClearSMBusFlag_PECERR(I2C1);
+    DevStats.PecErrors++;
+    RxBad = 1;
+  }
+  if (MS32_I2C_IsActiveSMBusFlag_TIMEOUT(I2C1))
+  {
+    MS32_I2C_ClearSMBusFlag_TIMEOUT(I2C1);
+    DevStats.Timeouts++;
+    SMBus_Device_Abort();
+  }
+  if (MS32_I2C_IsActiveFlag_BERR(I2C1) || MS32_I2C_IsActiveFlag_ARLO(I2C1) || MS32_I2C_IsActiveFlag_OVR(I2C1))
+  {
+    MS32_I2C_ClearFlag_BERR(I2C1);
+    MS32_I2C_ClearFlag_ARLO(I2C1);
+    MS32_I2C_ClearFlag_OVR(I2C1);
+    DevStats.Errors++;
+    SMBus_Device_Abort();
+  }
+
+  if (MS32_I2C_IsActiveFlag_RXNE(I2C1))
+  {
+    data = MS32_I2C_ReceiveData8(I2C1);
+    if (Phase == PH_CMD)
+    {
+      CmdCode = data;
+    }
+    else if (Phase == PH_COUNT)
+    {
+      Buf[0] = data;
+    }
+    else if ((Phase == PH_DATA) && (Pos < Expect))
+    {
+      Buf[Pos++] = data;
+    }
+    else
+    {
+      RxBad = 1;
+    }
+  }
+
+  if (MS32_I2C_IsActiveFlag_TCR(I2C1))
+  {
+    SMBus_Device_Dispatch();
+  }
+
+  if (MS32_I2C_IsActiveFlag_ADDR(I2C1))
+  {
+    if (MS32_I2C_GetTransferDirection(I2C1) == MS32_I2C_DIRECTION_READ)
+    {
+      SMBus_Device_LoadReply();
+      Phase = PH_READ;
+      Pos = 0;
+      /* data then the PEC from the PEC unit */
+      MS32_I2C_DisableReloadMode(I2C1);
+      MS32_I2C_SetTransferSize(I2C1, Len + 1U);
+      MS32_I2C_EnableSMBusPECCompare(I2C1);
+      MS32_I2C_ClearFlag_TXE(I2C1);
+      MS32_I2C_EnableIT_TX(I2C1);
+    }
+    else
+    {
+      Phase = PH_CMD;
+      Cur = 0;
+      RxBad = 0;
+      MS32_I2C_AcknowledgeNextData(I2C1, MS32_I2C_ACK);
+      SMBus_Device_Receive(1, 0);
+    }
+    /* releases SCL */
+    MS32_I2C_ClearFlag_ADDR(I2C1);
+  }
+
+  if (MS32_I2C_IsActiveFlag_TXIS(I2C1) && (Phase == PH_READ))
+  {
+    MS32_I2C_TransmitData8(I2C1, (Pos < Len) ? Buf[Pos++] : 0xFF);
+  }
+
+  if (MS32_I2C_IsActiveFlag_STOP(I2C1))
+  {
+    MS32_I2C_ClearFlag_STOP(I2C1);
+    /* the host NACKs the last byte it reads */
+    MS32_I2C_ClearFlag_NACK(I2C1);
+    MS32_I2C_DisableIT_TX(I2C1);
+    MS32_I2C_ClearFlag_TXE(I2C1);
+
+    if (Phase == PH_DATA)
+    {
+      if ((RxBad == 0U) && (Pos == Expect))
+      {
+        /* PEC matched: copy without the PEC byte */
+        for (i = 0; i + 1U < Expect; i++)
+        {
+          Cur->Data[i] = Buf[i];
+        }
+        DevStats.Writes++;
+        if (Cur->Callback != 0)
+        {
+          Cur->Callback(Cur, (Cur->Type == SMBUS_BLOCK) ? Buf[0] : Cur->Type);
+        }
+      }
+      else if (RxBad == 0U)
+      {
+        /* stopped early, PEC not received */
+        DevStats.Errors++;
+      }
+    }
+    else if (Phase == PH_READ)
+    {
+      DevStats.Reads++;
+      if (AraRead != 0U)
+      {
+        AraRead = 0;
+        DevStats.AlertResponses++;
+        MS32_I2C_DisableSMBusAlert(I2C1);
+        AlertPending = 0;
+      }
+    }
+    Phase = PH_IDLE;
+    Cur = 0;
+  }
+}
+
+/**
+  * @brief Read the device statistics
+  * @param Stats pointer to a SMBus_DeviceStatsTypeDef structure
+  * @retval None
+  */
+void SMBus_Device_GetStats(SMBus_DeviceStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = DevStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    SMBUS_DEVICE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of SMBUS_DEVICE.c file.
+  *
+  *          SMBus / PMBus device on I2C1, address SMBUS_DEVICE_ADDR:
+  *             write: S addr+W cmd [count] data.. PEC P
+  *             read:  S addr+W cmd Sr addr+R [count] data.. PEC P
+  *          Commands come from a table; a write is committed to the
+  *          command buffer only after the PEC byte matched.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SMBUS_DEVICE_H
+#define __SMBUS_DEVICE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "SMBUS.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* 7 bit device address */
+#define SMBUS_DEVICE_ADDR           0x40U
+
+/* Command access */
+#define SMBUS_RD                    0x01U
+#define SMBUS_WR                    0x02U
+
+/* Exported types ------------------------------------------------------------*/
+struct SMBus_Cmd;
+
+/**
+  * @brief Write callback, runs in the I2C1 interrupt after the data (PEC
+  *        checked) is copied to the command buffer; Len is the data length
+  */
+typedef void (*SMBus_CmdCallback)(const struct SMBus_Cmd *Cmd, uint8_t Len);
+
+typedef struct SMBus_Cmd
+{
+  uint8_t Code;             /* command code */
+  uint8_t Type;             /* SMBUS_SEND / BYTE / WORD / BLOCK */
+  uint8_t Access;           /* SMBUS_RD | SMBUS_WR */
+  uint8_t Size;             /* SMBUS_BLOCK: buffer data size, 1~SMBUS_BLOCK_MAX */
+  uint8_t *Data;            /* BYTE 1, WORD 2 (LSB first), BLOCK count + Size bytes */
+  SMBus_CmdCallback Callback; /* 0: none */
+} SMBus_CmdTypeDef;
+
+typedef struct
+{
+  uint32_t Writes;          /* committed, PEC good */
+  uint32_t Reads;
+  uint32_t PecErrors;       /* write dropped, PEC byte NACKed */
+  uint32_t Timeouts;        /* SCL held low past tTIMEOUT / tLOW:SEXT */
+  uint32_t BadCommands;     /* unknown code, wrong access or count, NACKed */
+  uint32_t Errors;          /* BERR, ARLO, OVR, aborted transfers */
+  uint32_t AlertResponses;  /* ARA read while SMBALERT# was low */
+  uint32_t MaxDispatchUs;   /* command byte to SCL release, table lookup included */
+} SMBus_DeviceStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void SMBus_Device_Init(const SMBus_CmdTypeDef *Table, uint8_t Count);
+void SMBus_Device_RaiseAlert(void);
+uint8_t SMBus_Device_IsAlertPending(void);
+void SMBus_Device_GetStats(SMBus_DeviceStatsTypeDef *Stats);
+
+void SMBus_Device_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __SMBUS_DEVICE_H */
+
+/******************************** END OF FILE *********************************/
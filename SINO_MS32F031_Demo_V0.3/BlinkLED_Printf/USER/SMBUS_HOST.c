@@ -0,0 +1,444 @@
+/**
+  ******************************************************************************
+  * @file 		SMBUS_HOST.c
+	* @author		SINOMCU-AE
+  * @brief 		SMBus / PMBus host with hardware PEC and timeouts
+  *
+  *          This file provides an interrupt driven SMBus host on I2C1:
+  *             the PEC unit appends the PEC to writes (SMBUS_AUTOEND_WITH_PEC)
+  *             and checks the PEC closing a read, a mismatch ends the
+  *             transfer with SMBUS_XFER_PEC_ERROR;
+  *             a block read fetches the count with NBYTES = 1 and RELOAD,
+  *             then reloads NBYTES with count + PEC;
+  *             TIMEOUTR ends a transfer held by SCL low beyond tTIMEOUT or
+  *             a device stretching past tLOW:MEXT;
+  *             SMBALERT# falling edges and host notify messages (address
+  *             0x08) are latched for the main loop.
+  *
+  *          Needed call SMBus_Host_IRQHandler() in I2C1_IRQHandler().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "SMBUS_HOST.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Transfer phase */
+#define HP_WRITE                    0U      /* command and data, then PEC */
+#define HP_CMD                      1U      /* command code of a read */
+#define HP_READ                     2U      /* data then PEC */
+
+/* Variables -----------------------------------------------------------------*/
+static SMBus_HostXferTypeDef * __IO Active;
+static uint8_t Phase;
+static uint8_t Result;
+static uint8_t TxBuf[SMBUS_BLOCK_MAX + 2];
+static uint8_t TxLen;
+static uint8_t RxLen;                     /* data bytes expected, PEC not counted */
+static uint8_t Pos;
+static uint8_t Enabled;
+
+static __IO uint8_t AlertLatched;
+static uint8_t NotifyRx;
+static uint8_t NotifyPos;
+static uint8_t NotifyBuf[3];
+static __IO uint8_t NotifyLatched;
+static uint8_t NotifyAddr;
+static uint16_t NotifyValue;
+
+static SMBus_HostStatsTypeDef HostStats;
+
+/**
+  * @brief End the active transfer
+  * @param Status SMBUS_XFER_xxx
+  * @retval None
+  */
+static void SMBus_Host_Finish(uint8_t Status)
+{
+  SMBus_HostXferTypeDef *xfer = Active;
+
+  /* a byte left in TXDR by a NACK would go out in the next transfer */
+  MS32_I2C_ClearFlag_TXE(I2C1);
+  if (xfer == 0)
+  {
+    return;
+  }
+
+  HostStats.Transfers++;
+  if (Status == SMBUS_XFER_NACK)
+  {
+    HostStats.Nacks++;
+  }
+  else if (Status == SMBUS_XFER_PEC_ERROR)
+  {
+    HostStats.PecErrors++;
+  }
+  else if (Status == SMBUS_XFER_TIMEOUT)
+  {
+    HostStats.Timeouts++;
+  }
+  else if (Status != SMBUS_XFER_DONE)
+  {
+    HostStats.Errors++;
+  }
+
+  Active = 0;
+  xfer->Status = Status;
+}
+
+/**
+  * @brief SMBus host Initialization Function
+  * @param None
+  * @retval None
+  * @note bus speed from I2C1_TIMING.h
+  */
+void SMBus_Host_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_I2C_InitTypeDef I2C_InitStruct;
+
+  Active = 0;
+  AlertLatched = 0;
+  NotifyLatched = 0;
+  NotifyRx = 0;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOB);
+  MS32_RCC_SetI2CClockSource(I2C1_TIMING_CLKSOURCE);
+  /**I2C1 GPIO Configuration
+  PB5   ------> I2C1_SMBA
+  PB6   ------> I2C1_SCL
+  PB7   ------> I2C1_SDA
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_6 | MS32_GPIO_PIN_7;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_OPENDRAIN;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_UP;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_1;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_5;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_3;
+  MS32_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  MS32_I2C_StructInit(&I2C_InitStruct);
+  /* host mode also acknowledges address 0x08 for host notify */
+  I2C_InitStruct.PeripheralMode = MS32_I2C_MODE_SMBUS_HOST;
+  I2C_InitStruct.Timing = I2C1_TIMING;
+  I2C_InitStruct.TypeAcknowledge = MS32_I2C_ACK;
+  MS32_I2C_Init(I2C1, &I2C_InitStruct);
+
+  /* PEC, alert and timeouts are set with PE = 0 */
+  MS32_I2C_Disable(I2C1);
+  MS32_I2C_EnableSMBusPEC(I2C1);
+  MS32_I2C_EnableSMBusAlert(I2C1);
+  MS32_I2C_ConfigSMBusTimeout(I2C1, SMBUS_TIMEOUTA, MS32_I2C_SMBUS_TIMEOUTA_MODE_SCL_LOW, SMBUS_TIMEOUTB_HOST);
+  MS32_I2C_EnableSMBusTimeout(I2C1, MS32_I2C_SMBUS_AMS32_TIMEOUT);
+
+  /* TC covers TCR; ERR covers PECERR, TIMEOUT, ALERT, BERR, ARLO, OVR */
+  MS32_I2C_EnableIT_TX(I2C1);
+  MS32_I2C_EnableIT_RX(I2C1);
+  MS32_I2C_EnableIT_TC(I2C1);
+  MS32_I2C_EnableIT_STOP(I2C1);
+  MS32_I2C_EnableIT_NACK(I2C1);
+  MS32_I2C_EnableIT_ADDR(I2C1);
+  MS32_I2C_EnableIT_ERR(I2C1);
+  NVIC_SetPriority(I2C1_IRQn, 0x1);
+  NVIC_EnableIRQ(I2C1_IRQn);
+
+  Enabled = 1;
+  MS32_I2C_Enable(I2C1);
+}
+
+/**
+  * @brief Start a transfer
+  * @param Xfer transfer descriptor, owned by the driver while SMBUS_XFER_ACTIVE
+  * @retval SUCCESS started, ERROR busy or invalid descriptor
+  */
+ErrorStatus SMBus_Host_Submit(SMBus_HostXferTypeDef *Xfer)
+{
+  uint32_t i;
+  uint8_t n;
+
+  if (Xfer->Read != 0U)
+  {
+    if ((Xfer->Type == SMBUS_SEND) || ((Xfer->Type == SMBUS_BLOCK) && (Xfer->Size == 0U)))
+    {
+      return ERROR;
+    }
+  }
+  else if ((Xfer->Type == SMBUS_RECEIVE) ||
+           ((Xfer->Type == SMBUS_BLOCK) && ((Xfer->Data[0] == 0U) || (Xfer->Data[0] > SMBUS_BLOCK_MAX))))
+  {
+    return ERROR;
+  }
+
+  __disable_irq();
+  if (Active != 0)
+  {
+    __enable_irq();
+    return ERROR;
+  }
+  Active = Xfer;
+  Xfer->Status = SMBUS_XFER_ACTIVE;
+  Result = SMBUS_XFER_DONE;
+  Pos = 0;
+
+  if (Xfer->Type == SMBUS_RECEIVE)
+  {
+    Phase = HP_READ;
+    RxLen = 1;
+    MS32_I2C_HandleTransfer(I2C1, (uint32_t)Xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                            RxLen + 1U, MS32_I2C_MODE_SMBUS_AUTOEND_WITH_PEC, MS32_I2C_GENERATE_START_READ);
+  }
+  else if (Xfer->Read != 0U)
+  {
+    Phase = HP_CMD;
+    TxBuf[0] = Xfer->Cmd;
+    TxLen = 1;
+    MS32_I2C_HandleTransfer(I2C1, (uint32_t)Xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                            1, MS32_I2C_MODE_SMBUS_SOFTEND_NO_PEC, MS32_I2C_GENERATE_START_WRITE);
+  }
+  else
+  {
+    Phase = HP_WRITE;
+    TxBuf[0] = Xfer->Cmd;
+    n = (Xfer->Type == SMBUS_BLOCK) ? (Xfer->Data[0] + 1U) : Xfer->Type;
+    for (i = 0; i < n; i++)
+    {
+      TxBuf[1 + i] = Xfer->Data[i];
+    }
+    TxLen = n + 1U;
+    MS32_I2C_HandleTransfer(I2C1, (uint32_t)Xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                            TxLen + 1U, MS32_I2C_MODE_SMBUS_AUTOEND_WITH_PEC, MS32_I2C_GENERATE_START_WRITE);
+  }
+  __enable_irq();
+
+  return SUCCESS;
+}
+
+/**
+  * @brief Check that no transfer is in progress
+  * @param None
+  * @retval 1 idle, 0 busy
+  */
+uint8_t SMBus_Host_IsIdle(void)
+{
+  return (Active == 0) ? 1U : 0U;
+}
+
+/**
+  * @brief Take the SMBALERT# event, then read SMBUS_ARA with SMBUS_RECEIVE
+  * @param None
+  * @retval 1 a device pulled SMBALERT# since the last call
+  */
+uint8_t SMBus_Host_TakeAlert(void)
+{
+  uint8_t alert = AlertLatched;
+
+  AlertLatched = 0;
+  return alert;
+}
+
+/**
+  * @brief Take the last host notify message
+  * @param Addr 7 bit address of the notifying device
+  * @param Value data word
+  * @retval 1 a message was received since the last call
+  */
+uint8_t SMBus_Host_TakeNotify(uint8_t *Addr, uint16_t *Value)
+{
+  uint8_t got;
+
+  __disable_irq();
+  got = NotifyLatched;
+  *Addr = NotifyAddr;
+  *Value = NotifyValue;
+  NotifyLatched = 0;
+  __enable_irq();
+
+  return got;
+}
+
+/**
+  * @brief I2C1 SMBus host event / error interrupt
+  * @param None
+  * @retval None
+  * @note call by I2C1_IRQHandler()
+  */
+void SMBus_Host_IRQHandler(void)
+{
+  SMBus_HostXferTypeDef *xfer;
+  uint8_t data;
+  uint8_t count;
+
+  if (Enabled == 0U)
+  {
+    return;
+  }
+  xfer = Active;
+
+  if (MS32_I2C_IsActiveSMBusFlag_ALERT(I2C1))
+  {
+    MS32_I2C_ClearSMBusFlag_ALERT(I2C1);
+    AlertLatched = 1;
+    HostStats.Alerts++;
+  }
+  if (MS32_I2C_IsActiveSMBusFlag_PECERR(I2C1))
+  {
+    /* STOP follows (AUTOEND) */
+    MS32_I2C_ClearSMBusFlag_PECERR(I2C1);
+    Result = SMBUS_XFER_PEC_ERROR;
+  }
+  if (MS32_I2C_IsActiveSMBusFlag_TIMEOUT(I2C1))
+  {
+    /* hardware has sent STOP / released the lines */
+    MS32_I2C_ClearSMBusFlag_TIMEOUT(I2C1);
+    NotifyRx = 0;
+    SMBus_Host_Finish(SMBUS_XFER_TIMEOUT);
+    return;
+  }
+  if (MS32_I2C_IsActiveFlag_BERR(I2C1) || MS32_I2C_IsActiveFlag_ARLO(I2C1) || MS32_I2C_IsActiveFlag_OVR(I2C1))
+  {
+    /* no STOP will follow: reset the state machine and end here */
+    MS32_I2C_ClearFlag_BERR(I2C1);
+    MS32_I2C_ClearFlag_ARLO(I2C1);
+    MS32_I2C_ClearFlag_OVR(I2C1);
+    MS32_I2C_Disable(I2C1);
+    MS32_I2C_ClearFlag_NACK(I2C1);
+    MS32_I2C_ClearFlag_STOP(I2C1);
+    MS32_I2C_Enable(I2C1);
+    NotifyRx = 0;
+    SMBus_Host_Finish(SMBUS_XFER_ERROR);
+    return;
+  }
+
+  /* host notify: a device writes its address and a data word to 0x08 */
+  if (MS32_I2C_IsActiveFlag_ADDR(I2C1))
+  {
+    NotifyRx = 1;
+    NotifyPos = 0;
+    MS32_I2C_ClearFlag_ADDR(I2C1);
+  }
+
+  if (MS32_I2C_IsActiveFlag_RXNE(I2C1))
+  {
+    data = MS32_I2C_ReceiveData8(I2C1);
+    if (NotifyRx != 0U)
+    {
+      if (NotifyPos < sizeof(NotifyBuf))
+      {
+        NotifyBuf[NotifyPos++] = data;
+      }
+    }
+    else if ((xfer != 0) && (Pos < RxLen))
+    {
+      /* the PEC byte after RxLen is checked by hardware and dropped */
+      xfer->Data[Pos++] = data;
+    }
+  }
+
+  if (MS32_I2C_IsActiveFlag_TXIS(I2C1))
+  {
+    MS32_I2C_TransmitData8(I2C1, (Pos < TxLen) ? TxBuf[Pos++] : 0xFF);
+  }
+
+  if (MS32_I2C_IsActiveFlag_NACK(I2C1))
+  {
+    MS32_I2C_ClearFlag_NACK(I2C1);
+    Result = SMBUS_XFER_NACK;
+    if (!MS32_I2C_IsEnabledAutoEndMode(I2C1))
+    {
+      MS32_I2C_GenerateStopCondition(I2C1);
+    }
+  }
+
+  if (MS32_I2C_IsActiveFlag_STOP(I2C1))
+  {
+    MS32_I2C_ClearFlag_STOP(I2C1);
+    if (NotifyRx != 0U)
+    {
+      NotifyRx = 0;
+      if (NotifyPos == sizeof(NotifyBuf))
+      {
+        NotifyAddr = NotifyBuf[0] >> 1;
+        NotifyValue = (uint16_t)(NotifyBuf[1] | ((uint16_t)NotifyBuf[2] << 8));
+        NotifyLatched = 1;
+        HostStats.Notifies++;
+      }
+    }
+    else
+    {
+      SMBus_Host_Finish(Result);
+    }
+    return;
+  }
+
+  if (xfer == 0)
+  {
+    return;
+  }
+
+  if (MS32_I2C_IsActiveFlag_TCR(I2C1))
+  {
+    /* block count received, NBYTES was 1 with RELOAD */
+    count = xfer->Data[0];
+    if ((count == 0U) || (count > xfer->Size))
+    {
+      /* read one more byte, NACK it and stop */
+      Result = SMBUS_XFER_ERROR;
+      MS32_I2C_HandleTransfer(I2C1, (uint32_t)xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                              1, MS32_I2C_MODE_AUTOEND, MS32_I2C_GENERATE_NOSTARTSTOP);
+    }
+    else
+    {
+      RxLen = count + 1U;
+      MS32_I2C_HandleTransfer(I2C1, (uint32_t)xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                              count + 1U, MS32_I2C_MODE_SMBUS_AUTOEND_WITH_PEC, MS32_I2C_GENERATE_NOSTARTSTOP);
+    }
+  }
+  else if (MS32_I2C_IsActiveFlag_TC(I2C1) && (Phase == HP_CMD))
+  {
+    /* command code sent, repeated start read */
+    Phase = HP_READ;
+    Pos = 0;
+    if (xfer->Type == SMBUS_BLOCK)
+    {
+      RxLen = 1;
+      MS32_I2C_HandleTransfer(I2C1, (uint32_t)xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                              1, MS32_I2C_MODE_SMBUS_RELOAD, MS32_I2C_GENERATE_START_READ);
+    }
+    else
+    {
+      RxLen = xfer->Type;
+      MS32_I2C_HandleTransfer(I2C1, (uint32_t)xfer->Addr << 1, MS32_I2C_ADDRSLAVE_7BIT,
+                              RxLen + 1U, MS32_I2C_MODE_SMBUS_AUTOEND_WITH_PEC, MS32_I2C_GENERATE_START_READ);
+    }
+  }
+}
+
+/**
+  * @brief Read the host statistics
+  * @param Stats pointer to a SMBus_HostStatsTypeDef structure
+  * @retval None
+  */
+void SMBus_Host_GetStats(SMBus_HostStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = HostStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
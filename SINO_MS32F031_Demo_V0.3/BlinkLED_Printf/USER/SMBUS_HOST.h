@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    SMBUS_HOST.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of SMBUS_HOST.c file.
+  *
+  *          SMBus / PMBus host on I2C1, one transfer at a time:
+  *             write: S addr+W cmd [count] data.. PEC P
+  *             read:  S addr+W cmd Sr addr+R [count] data.. PEC P
+  *             receive byte (ARA): S addr+R data PEC P
+  *          SMBALERT# on PB5 is latched by the I2C1 alert detector.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SMBUS_HOST_H
+#define __SMBUS_HOST_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "SMBUS.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Transfer Status */
+#define SMBUS_XFER_IDLE             0U
+#define SMBUS_XFER_ACTIVE           1U
+#define SMBUS_XFER_DONE             2U
+#define SMBUS_XFER_NACK             3U
+#define SMBUS_XFER_PEC_ERROR        4U      /* PEC of the reply did not match */
+#define SMBUS_XFER_TIMEOUT          5U      /* SCL low past tTIMEOUT / tLOW:MEXT */
+#define SMBUS_XFER_ERROR            6U      /* BERR, ARLO, bad block count */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t Addr;             /* 7 bit device address */
+  uint8_t Cmd;              /* command code, unused for SMBUS_RECEIVE */
+  uint8_t Type;             /* SMBUS_SEND / BYTE / WORD / BLOCK / RECEIVE */
+  uint8_t Read;             /* 0: write, 1: read */
+  uint8_t *Data;            /* BYTE 1, WORD 2 (LSB first), BLOCK count + data */
+  uint8_t Size;             /* SMBUS_BLOCK read: data bytes Data can take */
+  __IO uint8_t Status;      /* SMBUS_XFER_xxx, written by the driver */
+} SMBus_HostXferTypeDef;
+
+typedef struct
+{
+  uint32_t Transfers;
+  uint32_t Nacks;
+  uint32_t PecErrors;
+  uint32_t Timeouts;
+  uint32_t Errors;
+  uint32_t Alerts;          /* SMBALERT# falling edges */
+  uint32_t Notifies;        /* host notify messages to address 0x08 */
+} SMBus_HostStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void SMBus_Host_Init(void);
+ErrorStatus SMBus_Host_Submit(SMBus_HostXferTypeDef *Xfer);
+uint8_t SMBus_Host_IsIdle(void);
+uint8_t SMBus_Host_TakeAlert(void);
+uint8_t SMBus_Host_TakeNotify(uint8_t *Addr, uint16_t *Value);
+void SMBus_Host_GetStats(SMBus_HostStatsTypeDef *Stats);
+
+void SMBus_Host_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __SMBUS_HOST_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,340 @@
+/**
+  ******************************************************************************
+  * @file 		SPI1_MASTER.c
+	* @author		SINOMCU-AE
+  * @brief 		SPI1 master transaction queue over DMA
+  *
+  *          This file provides a queued SPI1 master:
+  *             every SPI1_XferTypeDef is one chip select cycle, clocked by
+  *             DMA1 Channel2 (RX) / Channel3 (TX) without CPU work between
+  *             bytes;
+  *             the RX complete interrupt releases chip select, starts the
+  *             next queued transaction and then runs the callback, so the
+  *             bus gap between transactions is one interrupt entry.
+  *          Transactions start in submit order; the descriptor and its
+  *          buffers belong to the driver until Status is SPI1_XFER_DONE or
+  *          SPI1_XFER_ERROR. A DMA transfer error on either channel stops
+  *          both, drains the SPI FIFOs and ends the transaction with
+  *          SPI1_XFER_ERROR.
+  *
+  *          Needed call SPI1_Master_DMA_IRQHandler() in
+  *          DMA1_Channel2_3_IRQHandler().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "SPI1_MASTER.h"
+#include "CLOCK_PLAN.h"
+#include "SysTick_Delay.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SPI_QUEUE_MASK              (SPI1_MASTER_QUEUE_DEPTH - 1U)
+
+/* Variables -----------------------------------------------------------------*/
+static SPI1_XferTypeDef *Queue[SPI1_MASTER_QUEUE_DEPTH];
+static uint32_t QueueIn;
+static uint32_t QueueOut;
+static SPI1_XferTypeDef * __IO Active;
+
+static const uint8_t DummyTx = SPI1_MASTER_DUMMY;
+static uint8_t DummyRx;
+
+static uint32_t StartUs;
+static SPI1_MasterStatsTypeDef SpiStats;
+
+/**
+  * @brief Start the oldest queued transaction if the bus is free
+  * @param None
+  * @retval None
+  * @note call with interrupts disabled or from the DMA interrupt
+  */
+static void SPI1_Master_Start(void)
+{
+  SPI1_XferTypeDef *xfer;
+
+  if ((Active != 0) || (QueueIn == QueueOut))
+  {
+    return;
+  }
+  xfer = Queue[QueueOut & SPI_QUEUE_MASK];
+  QueueOut++;
+  Active = xfer;
+  xfer->Status = SPI1_XFER_ACTIVE;
+
+  MS32_DMA_DisableChannel(DMA1, SPI1_MASTER_RX_DMA_CHANNEL);
+  MS32_DMA_DisableChannel(DMA1, SPI1_MASTER_TX_DMA_CHANNEL);
+
+  if (xfer->RxBuf != 0)
+  {
+    MS32_DMA_SetMemoryAddress(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, (uint32_t)xfer->RxBuf);
+    MS32_DMA_SetMemoryIncMode(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, MS32_DMA_MEMORY_INCREMENT);
+  }
+  else
+  {
+    MS32_DMA_SetMemoryAddress(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, (uint32_t)&DummyRx);
+    MS32_DMA_SetMemoryIncMode(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, MS32_DMA_MEMORY_NOINCREMENT);
+  }
+  MS32_DMA_SetDataLength(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, xfer->Len);
+
+  if (xfer->TxBuf != 0)
+  {
+    MS32_DMA_SetMemoryAddress(DMA1, SPI1_MASTER_TX_DMA_CHANNEL, (uint32_t)xfer->TxBuf);
+    MS32_DMA_SetMemoryIncMode(DMA1, SPI1_MASTER_TX_DMA_CHANNEL, MS32_DMA_MEMORY_INCREMENT);
+  }
+  else
+  {
+    MS32_DMA_SetMemoryAddress(DMA1, SPI1_MASTER_TX_DMA_CHANNEL, (uint32_t)&DummyTx);
+    MS32_DMA_SetMemoryIncMode(DMA1, SPI1_MASTER_TX_DMA_CHANNEL, MS32_DMA_MEMORY_NOINCREMENT);
+  }
+  MS32_DMA_SetDataLength(DMA1, SPI1_MASTER_TX_DMA_CHANNEL, xfer->Len);
+
+  /* chip select low: reset half of BSRR */
+  if (xfer->CsPort != 0)
+  {
+    xfer->CsPort->BSRR = xfer->CsPin << 16;
+  }
+  StartUs = SysTick_GetUs();
+
+  /* RX first so no received byte can be missed */
+  MS32_DMA_EnableChannel(DMA1, SPI1_MASTER_RX_DMA_CHANNEL);
+  MS32_DMA_EnableChannel(DMA1, SPI1_MASTER_TX_DMA_CHANNEL);
+}
+
+/**
+  * @brief SPI1 master Initialization Function
+  * @param None
+  * @retval None
+  * @note mode 0, 8 bit, MSB first, SCK = PCLK / SPI1_MASTER_PRESCALER_DIV
+  */
+void SPI1_Master_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_SPI_InitTypeDef SPI_InitStruct;
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOA);
+  /**SPI1 GPIO Configuration
+  PA5   ------> SPI1_SCK
+  PA6   ------> SPI1_MISO
+  PA7   ------> SPI1_MOSI
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_5 | MS32_GPIO_PIN_6 | MS32_GPIO_PIN_7;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_NO;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_0;
+  MS32_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  MS32_SPI_StructInit(&SPI_InitStruct);
+  SPI_InitStruct.TransferDirection = MS32_SPI_FUMS32_DUPLEX;
+  SPI_InitStruct.Mode = MS32_SPI_MODE_MASTER;
+  SPI_InitStruct.DataWidth = MS32_SPI_DATAWIDTH_8BIT;
+  SPI_InitStruct.ClockPolarity = MS32_SPI_POLARITY_LOW;
+  SPI_InitStruct.ClockPhase = MS32_SPI_PHASE_1EDGE;
+  SPI_InitStruct.NSS = MS32_SPI_NSS_SOFT;
+  SPI_InitStruct.BaudRate = SPI1_MASTER_PRESCALER;
+  SPI_InitStruct.BitOrder = MS32_SPI_MSB_FIRST;
+  SPI_InitStruct.CRCCalculation = MS32_SPI_CRCCALCULATION_DISABLE;
+  MS32_SPI_Disable(SPI1);
+  MS32_SPI_Init(SPI1, &SPI_InitStruct);
+  /* RXNE per byte for 8 bit frames */
+  MS32_SPI_SetRxFIFOThreshold(SPI1, MS32_SPI_RX_FIFO_TH_QUARTER);
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_SPI_DMA_GetRegAddr(SPI1);
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_PERIPH_TO_MEMORY;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_NORMAL;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.PeriphOrM2MSrcDataSize = MS32_DMA_PDATAALIGN_BYTE;
+  DMA_InitStruct.MemoryOrM2MDstDataSize = MS32_DMA_MDATAALIGN_BYTE;
+  /* RX above TX: a late RX read is an overrun, a late TX write only a gap */
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_HIGH;
+  MS32_DMA_DisableChannel(DMA1, SPI1_MASTER_RX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, &DMA_InitStruct);
+
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_MEMORY_TO_PERIPH;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_MEDIUM;
+  MS32_DMA_DisableChannel(DMA1, SPI1_MASTER_TX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, SPI1_MASTER_TX_DMA_CHANNEL, &DMA_InitStruct);
+
+  MS32_DMA_ITConfig(DMA1, SPI1_MASTER_RX_DMA_CHANNEL, MS32_DMA_CCR_TCIE | MS32_DMA_CCR_TEIE, 0x1);
+  /* TX shares the DMA1_Channel2_3 vector, only its errors matter */
+  MS32_DMA_EnableIT_TE(DMA1, SPI1_MASTER_TX_DMA_CHANNEL);
+
+  QueueIn = 0;
+  QueueOut = 0;
+  Active = 0;
+
+  MS32_SPI_EnableDMAReq_RX(SPI1);
+  MS32_SPI_EnableDMAReq_TX(SPI1);
+  MS32_SPI_Enable(SPI1);
+}
+
+/**
+  * @brief Configure a chip select pin, output push-pull, released (high)
+  * @param Port GPIO port
+  * @param Pin MS32_GPIO_PIN_x
+  * @retval None
+  * @note enable the port clock before
+  */
+void SPI1_Master_ConfigCS(GPIO_TypeDef *Port, uint32_t Pin)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  Port->BSRR = Pin;
+  GPIO_InitStruct.Pin = Pin;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_OUTPUT;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_NO;
+  MS32_GPIO_Init(Port, &GPIO_InitStruct);
+}
+
+/**
+  * @brief Queue a transaction, it starts at once when the bus is free
+  * @param Xfer transaction descriptor, Len 1~65535
+  * @retval SUCCESS queued, ERROR queue full or Len 0
+  * @note may be called from the completion callback
+  */
+ErrorStatus SPI1_Master_Submit(SPI1_XferTypeDef *Xfer)
+{
+  if (Xfer->Len == 0U)
+  {
+    return ERROR;
+  }
+
+  __disable_irq();
+  if ((QueueIn - QueueOut) >= SPI1_MASTER_QUEUE_DEPTH)
+  {
+    SpiStats.QueueFull++;
+    __enable_irq();
+    return ERROR;
+  }
+  Xfer->Status = SPI1_XFER_QUEUED;
+  Queue[QueueIn & SPI_QUEUE_MASK] = Xfer;
+  QueueIn++;
+  SPI1_Master_Start();
+  __enable_irq();
+
+  return SUCCESS;
+}
+
+/**
+  * @brief Check that nothing is queued or on the bus
+  * @param None
+  * @retval 1 idle, 0 busy
+  */
+uint8_t SPI1_Master_IsIdle(void)
+{
+  return ((Active == 0) && (QueueIn == QueueOut)) ? 1U : 0U;
+}
+
+/**
+  * @brief Stop both DMA channels and empty the SPI after a transfer error
+  * @param None
+  * @retval None
+  * @note bytes already in the TX FIFO are clocked out first, at most 4
+  */
+static void SPI1_Master_Abort(void)
+{
+  MS32_DMA_DisableChannel(DMA1, SPI1_MASTER_TX_DMA_CHANNEL);
+  MS32_DMA_DisableChannel(DMA1, SPI1_MASTER_RX_DMA_CHANNEL);
+  while ((MS32_SPI_GetTxFIFOLevel(SPI1) != MS32_SPI_TX_FIFO_EMPTY) || MS32_SPI_IsActiveFlag_BSY(SPI1))
+  {
+  }
+  /* nothing of this transaction may reach the next RX buffer */
+  while (MS32_SPI_IsActiveFlag_RXNE(SPI1))
+  {
+    (void)MS32_SPI_ReceiveData8(SPI1);
+  }
+}
+
+/**
+  * @brief DMA1 Channel2 (SPI1_RX) transfer complete, Channel2 / Channel3
+  *        transfer error interrupt
+  * @param None
+  * @retval None
+  * @note call by DMA1_Channel2_3_IRQHandler()
+  */
+void SPI1_Master_DMA_IRQHandler(void)
+{
+  SPI1_XferTypeDef *xfer;
+  uint8_t error;
+
+  error = (MS32_DMA_IsActiveFlag_TE2(DMA1) || MS32_DMA_IsActiveFlag_TE3(DMA1)) ? 1U : 0U;
+  if (!MS32_DMA_IsActiveFlag_TC2(DMA1) && !error)
+  {
+    return;
+  }
+  MS32_DMA_ClearFlag_GI2(DMA1);
+  MS32_DMA_ClearFlag_TE3(DMA1);
+
+  xfer = Active;
+  if (xfer == 0)
+  {
+    return;
+  }
+  if (error)
+  {
+    SPI1_Master_Abort();
+  }
+
+  /* last byte received: SCK has stopped, chip select high */
+  if (xfer->CsPort != 0)
+  {
+    xfer->CsPort->BSRR = xfer->CsPin;
+  }
+  SpiStats.BusyUs += SysTick_GetUs() - StartUs;
+  Active = 0;
+  if (error)
+  {
+    SpiStats.Errors++;
+    xfer->Status = SPI1_XFER_ERROR;
+  }
+  else
+  {
+    /* PCLK read now: CLOCK_SCALE may have changed it since init */
+    SpiStats.WireUs += (uint32_t)(((uint64_t)xfer->Len * 8U * SPI1_MASTER_PRESCALER_DIV * 1000000U) /
+                                  ClockPlan_PclkHz());
+    SpiStats.Bytes += xfer->Len;
+    SpiStats.Transfers++;
+    xfer->Status = SPI1_XFER_DONE;
+  }
+
+  /* keep the bus busy before spending time in the callback */
+  SPI1_Master_Start();
+  if (xfer->Callback != 0)
+  {
+    xfer->Callback(xfer);
+  }
+}
+
+/**
+  * @brief Read the transfer statistics
+  * @param Stats pointer to a SPI1_MasterStatsTypeDef structure
+  * @retval None
+  * @note bus utilisation = BusyUs / elapsed time,
+  *       overhead per transaction = (BusyUs - WireUs) / Transfers
+  */
+void SPI1_Master_GetStats(SPI1_MasterStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = SpiStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    SPI1_MASTER.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of SPI1_MASTER.c file.
+  *
+  *          This file describes the SPI1 master DMA path:
+  *             PA5   ------> SPI1_SCK
+  *             PA6   ------> SPI1_MISO
+  *             PA7   ------> SPI1_MOSI
+  *             SPI1_RX ------> DMA1 Channel2
+  *             SPI1_TX ------> DMA1 Channel3
+  *             chip select: any GPIO, driven through BSRR / BRR
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SPI1_MASTER_H
+#define __SPI1_MASTER_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Queued transactions, must be a power of 2 */
+#define SPI1_MASTER_QUEUE_DEPTH     8U
+/* SCK = PCLK / SPI1_MASTER_PRESCALER_DIV, keep both in step */
+#define SPI1_MASTER_PRESCALER       MS32_SPI_BAUDRATEPRESCALER_DIV4
+#define SPI1_MASTER_PRESCALER_DIV   4U
+/* Sent when a transaction has no TX buffer */
+#define SPI1_MASTER_DUMMY           0xFFU
+
+#define SPI1_MASTER_RX_DMA_CHANNEL  MS32_DMA_CHANNEL_2
+#define SPI1_MASTER_TX_DMA_CHANNEL  MS32_DMA_CHANNEL_3
+
+/* Transaction Status */
+#define SPI1_XFER_IDLE              0U
+#define SPI1_XFER_QUEUED            1U
+#define SPI1_XFER_ACTIVE            2U
+#define SPI1_XFER_DONE              3U
+#define SPI1_XFER_ERROR             4U      /* DMA transfer error, RxBuf incomplete */
+
+/* Exported types ------------------------------------------------------------*/
+struct SPI1_Xfer;
+
+/**
+  * @brief Completion callback, runs in the DMA interrupt after chip select
+  *        is released; may submit further transactions
+  */
+typedef void (*SPI1_XferCallback)(struct SPI1_Xfer *Xfer);
+
+typedef struct SPI1_Xfer
+{
+  GPIO_TypeDef *CsPort;     /* 0: no chip select */
+  uint32_t CsPin;           /* MS32_GPIO_PIN_x, active low */
+  const uint8_t *TxBuf;     /* 0: send SPI1_MASTER_DUMMY */
+  uint8_t *RxBuf;           /* 0: received bytes are dropped */
+  uint16_t Len;             /* 1~65535 */
+  SPI1_XferCallback Callback; /* 0: poll Status */
+  void *Context;            /* free for the callback */
+  __IO uint8_t Status;      /* SPI1_XFER_xxx, written by the driver */
+} SPI1_XferTypeDef;
+
+typedef struct
+{
+  uint32_t Transfers;
+  uint32_t Bytes;
+  uint32_t BusyUs;          /* chip select low time, sum */
+  uint32_t WireUs;          /* SCK time of the same bytes, sum */
+  uint32_t QueueFull;       /* SPI1_Master_Submit() refused */
+  uint32_t Errors;          /* transactions ended by a DMA transfer error */
+} SPI1_MasterStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void SPI1_Master_Init(void);
+void SPI1_Master_ConfigCS(GPIO_TypeDef *Port, uint32_t Pin);
+ErrorStatus SPI1_Master_Submit(SPI1_XferTypeDef *Xfer);
+uint8_t SPI1_Master_IsIdle(void);
+void SPI1_Master_GetStats(SPI1_MasterStatsTypeDef *Stats);
+
+void SPI1_Master_DMA_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __SPI1_MASTER_H */
+
+/******************************** END OF FILE *********************************/
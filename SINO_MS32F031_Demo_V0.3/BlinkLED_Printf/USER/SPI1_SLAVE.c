@@ -0,0 +1,245 @@
+/**
+  ******************************************************************************
+  * @file 		SPI1_SLAVE.c
+	* @author		SINOMCU-AE
+  * @brief 		SPI1 slave snapshot streaming by DMA
+  *
+  *          This file provides a read-only SPI1 slave endpoint:
+  *             three snapshot buffers: the application fills the write
+  *             buffer, the ready buffer holds the newest complete snapshot,
+  *             DMA1 Channel3 feeds the reading buffer to the TX FIFO, no
+  *             interrupt per byte;
+  *             SPI1_Slave_EndPublish() swaps write and ready, so a finished
+  *             snapshot never waits for, nor overwrites, a host read;
+  *             NSS rising edge (EXTI4) ends a frame: SPI1 is reset to drop
+  *             the bytes left in the TX FIFO, a newer ready buffer swaps
+  *             with the reading one and DMA is reloaded.
+  *          The head and tail SEQ of a frame only differ if memory is
+  *          corrupted; the host can keep them as a torn read check.
+  *
+  *          Needed call SPI1_Slave_EXTI_IRQHandler() in EXTI4_15_IRQHandler().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "SPI1_SLAVE.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SNAP_SIZE                   (SPI1_SLAVE_PAYLOAD + 4U)
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t SnapBuf[3][SNAP_SIZE];
+static uint8_t SnapWrite;                    /* buffer being published */
+static __IO uint8_t SnapReady;               /* newest complete buffer */
+static __IO uint8_t SnapReading;             /* buffer loaded in DMA */
+static __IO uint8_t SnapFresh;               /* SnapReady newer than SnapReading */
+static uint16_t SnapSeq;
+
+static uint32_t SpiCR1;
+static uint32_t SpiCR2;
+static uint8_t Enabled;                      /* EXTI line 4 is the NSS edge */
+
+static SPI1_SlaveStatsTypeDef SlaveStats;
+
+/**
+  * @brief Point DMA at the newest snapshot and restart SPI1
+  * @param None
+  * @retval None
+  * @note SPI1 registers are restored from SpiCR1 / SpiCR2 after the reset;
+  *       call from the NSS interrupt or before it is enabled
+  */
+static void SPI1_Slave_Load(void)
+{
+  uint8_t buf = SnapReading;
+
+  if (SnapFresh)
+  {
+    /* the old reading buffer becomes the next spare for EndPublish() */
+    SnapReading = SnapReady;
+    SnapReady = buf;
+    buf = SnapReading;
+    SnapFresh = 0;
+  }
+
+  MS32_DMA_DisableChannel(DMA1, SPI1_SLAVE_TX_DMA_CHANNEL);
+  /* disabling SPE keeps the TX FIFO, only a reset empties it */
+  MS32_APB1_GRP2_ForceReset(MS32_APB1_GRP2_PERIPH_SPI1);
+  MS32_APB1_GRP2_ReleaseReset(MS32_APB1_GRP2_PERIPH_SPI1);
+
+  MS32_DMA_SetMemoryAddress(DMA1, SPI1_SLAVE_TX_DMA_CHANNEL, (uint32_t)SnapBuf[buf]);
+  MS32_DMA_SetDataLength(DMA1, SPI1_SLAVE_TX_DMA_CHANNEL, SNAP_SIZE);
+  MS32_DMA_EnableChannel(DMA1, SPI1_SLAVE_TX_DMA_CHANNEL);
+
+  SPI1->CR2 = SpiCR2;
+  SPI1->CR1 = SpiCR1;
+}
+
+/**
+  * @brief SPI1 slave Initialization Function
+  * @param None
+  * @retval SUCCESS, ERROR EXTI line 4 already triggers for another driver
+  *         (EXTI_INPUT pin 4), nothing is configured
+  * @note mode 0, 8 bit, MSB first, hardware NSS
+  */
+ErrorStatus SPI1_Slave_Init(void)
+{
+  MS32_GPIO_InitTypeDef GPIO_InitStruct = {0};
+  MS32_SPI_InitTypeDef SPI_InitStruct;
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+  MS32_EXTI_InitTypeDef EXTI_InitStruct;
+
+  if ((Enabled == 0U) && ((EXTI->RTSR | EXTI->FTSR) & MS32_EXTI_LINE_4))
+  {
+    return ERROR;
+  }
+
+  /* Peripheral clock enable */
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_GPIOA);
+  /**SPI1 GPIO Configuration
+  PA4   ------> SPI1_NSS
+  PA5   ------> SPI1_SCK
+  PA6   ------> SPI1_MISO
+  */
+  GPIO_InitStruct.Pin = MS32_GPIO_PIN_4 | MS32_GPIO_PIN_5 | MS32_GPIO_PIN_6;
+  GPIO_InitStruct.Mode = MS32_GPIO_MODE_ALTERNATE;
+  GPIO_InitStruct.Speed = MS32_GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.OutputType = MS32_GPIO_OUTPUT_PUSHPULL;
+  GPIO_InitStruct.Pull = MS32_GPIO_PULL_NO;
+  GPIO_InitStruct.Alternate = MS32_GPIO_AF_0;
+  MS32_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  MS32_SPI_StructInit(&SPI_InitStruct);
+  SPI_InitStruct.TransferDirection = MS32_SPI_FUMS32_DUPLEX;
+  SPI_InitStruct.Mode = MS32_SPI_MODE_SLAVE;
+  SPI_InitStruct.DataWidth = MS32_SPI_DATAWIDTH_8BIT;
+  SPI_InitStruct.ClockPolarity = MS32_SPI_POLARITY_LOW;
+  SPI_InitStruct.ClockPhase = MS32_SPI_PHASE_1EDGE;
+  SPI_InitStruct.NSS = MS32_SPI_NSS_HARD_INPUT;
+  SPI_InitStruct.BitOrder = MS32_SPI_MSB_FIRST;
+  SPI_InitStruct.CRCCalculation = MS32_SPI_CRCCALCULATION_DISABLE;
+  MS32_SPI_Disable(SPI1);
+  MS32_SPI_Init(SPI1, &SPI_InitStruct);
+  MS32_SPI_SetRxFIFOThreshold(SPI1, MS32_SPI_RX_FIFO_TH_QUARTER);
+  MS32_SPI_EnableDMAReq_TX(SPI1);
+  /* MOSI is not read, the RX side just overruns until the next reset */
+  SpiCR2 = SPI1->CR2;
+  SpiCR1 = SPI1->CR1 | SPI_CR1_SPE;
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_SPI_DMA_GetRegAddr(SPI1);
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_MEMORY_TO_PERIPH;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_NORMAL;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.PeriphOrM2MSrcDataSize = MS32_DMA_PDATAALIGN_BYTE;
+  DMA_InitStruct.MemoryOrM2MDstDataSize = MS32_DMA_MDATAALIGN_BYTE;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_VERYHIGH;
+  MS32_DMA_DisableChannel(DMA1, SPI1_SLAVE_TX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, SPI1_SLAVE_TX_DMA_CHANNEL, &DMA_InitStruct);
+
+  /* NSS rising edge: frame done */
+  MS32_EXTI_StructInit(&EXTI_InitStruct);
+  EXTI_InitStruct.Line_0_31 = MS32_EXTI_LINE_4;
+  EXTI_InitStruct.LineCommand = ENABLE;
+  EXTI_InitStruct.Mode = MS32_EXTI_MODE_IT;
+  EXTI_InitStruct.Trigger = MS32_EXTI_TRIGGER_RISING;
+  MS32_EXTI_Init(&EXTI_InitStruct);
+  MS32_EXTI_PinITConfig(MS32_EXTI_LINE_4, MS32_EXTI_PORTA, 0x0, ENABLE);
+
+  SnapSeq = 0;
+  SnapWrite = 0;
+  SnapReady = 1;
+  SnapReading = 2;
+  SnapFresh = 0;
+  SPI1_Slave_Load();
+  Enabled = 1;
+  return SUCCESS;
+}
+
+/**
+  * @brief Start a snapshot
+  * @param None
+  * @retval payload area, SPI1_SLAVE_PAYLOAD bytes
+  * @note call from one context only, finish with SPI1_Slave_EndPublish();
+  *       the write buffer is neither sent nor the newest snapshot, the
+  *       NSS interrupt never touches it
+  */
+uint8_t *SPI1_Slave_BeginPublish(void)
+{
+  uint8_t *buf;
+
+  SnapSeq++;
+  buf = SnapBuf[SnapWrite];
+  buf[0] = (uint8_t)SnapSeq;
+  buf[1] = (uint8_t)(SnapSeq >> 8);
+  return &buf[2];
+}
+
+/**
+  * @brief Close the snapshot, it is sent from the next NSS low period
+  * @param None
+  * @retval None
+  * @note a ready snapshot the host has not read yet is replaced
+  */
+void SPI1_Slave_EndPublish(void)
+{
+  uint8_t *buf = SnapBuf[SnapWrite];
+  uint8_t spare;
+
+  buf[SNAP_SIZE - 2U] = (uint8_t)SnapSeq;
+  buf[SNAP_SIZE - 1U] = (uint8_t)(SnapSeq >> 8);
+
+  __disable_irq();
+  spare = SnapReady;
+  if (SnapFresh)
+  {
+    SlaveStats.Overwritten++;
+  }
+  SnapReady = SnapWrite;
+  SnapFresh = 1;
+  __enable_irq();
+  SnapWrite = spare;
+  SlaveStats.Published++;
+}
+
+/**
+  * @brief NSS rising edge interrupt
+  * @param None
+  * @retval None
+  * @note call by EXTI4_15_IRQHandler(); line 4 is left to the other
+  *       handlers of the vector until SPI1_Slave_Init() has taken it
+  */
+void SPI1_Slave_EXTI_IRQHandler(void)
+{
+  if ((Enabled != 0U) && MS32_EXTI_IsActiveFlag_0_31(MS32_EXTI_LINE_4))
+  {
+    MS32_EXTI_ClearFlag_0_31(MS32_EXTI_LINE_4);
+    SPI1_Slave_Load();
+    SlaveStats.Frames++;
+  }
+}
+
+/**
+  * @brief Read the endpoint statistics
+  * @param Stats pointer to a SPI1_SlaveStatsTypeDef structure
+  * @retval None
+  */
+void SPI1_Slave_GetStats(SPI1_SlaveStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = SlaveStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
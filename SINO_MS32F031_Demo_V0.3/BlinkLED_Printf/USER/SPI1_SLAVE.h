@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    SPI1_SLAVE.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of SPI1_SLAVE.c file.
+  *
+  *          SPI1 slave streaming endpoint:
+  *             PA4   ------> SPI1_NSS   (from host, also EXTI4)
+  *             PA5   ------> SPI1_SCK
+  *             PA6   ------> SPI1_MISO
+  *             SPI1_TX ------> DMA1 Channel3
+  *          Every NSS low period the host clocks out one snapshot,
+  *          little endian:
+  *             SEQ(2) PAYLOAD(SPI1_SLAVE_PAYLOAD) SEQ(2)
+  *          both SEQ fields equal: consistent snapshot; different: torn,
+  *          read again.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SPI1_SLAVE_H
+#define __SPI1_SLAVE_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Snapshot payload in bytes, the frame is 4 bytes longer */
+#define SPI1_SLAVE_PAYLOAD          28U
+
+#define SPI1_SLAVE_TX_DMA_CHANNEL   MS32_DMA_CHANNEL_3
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Frames;          /* NSS released by the host */
+  uint32_t Published;
+  uint32_t Overwritten;     /* published snapshots replaced before a read */
+} SPI1_SlaveStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+ErrorStatus SPI1_Slave_Init(void);
+uint8_t *SPI1_Slave_BeginPublish(void);
+void SPI1_Slave_EndPublish(void);
+void SPI1_Slave_GetStats(SPI1_SlaveStatsTypeDef *Stats);
+
+void SPI1_Slave_EXTI_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __SPI1_SLAVE_H */
+
+/******************************** END OF FILE *********************************/
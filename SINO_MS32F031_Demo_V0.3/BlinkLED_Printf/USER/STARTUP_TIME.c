@@ -0,0 +1,183 @@
+/**
+  ******************************************************************************
+  * @file 		STARTUP_TIME.c
+	* @author		SINOMCU-AE
+  * @brief 		Reset-to-application startup timing
+  *
+  *          This file provides a phase timer for the boot sequence:
+  *             TIM17 counts 1us from HSI at SystemInit() entry;
+  *             the clock switch in SetSysClock() saves the count in CCR1
+  *             and restarts the counter on the new timer clock, so the
+  *             two parts add up to one time line;
+  *             the first part runs before the C library has copied .data
+  *             and cleared .bss: only timer registers hold it, no RAM;
+  *             TIM17 is released by StartupTime_End().
+  *
+  *          The counter is 16 bit: marks after the clock switch are kept
+  *          right while they come less than 65ms apart.
+  *
+  *          The STARTUP_DMAZERO region is cleared word by word by DMA1
+  *          Channel1 (memory to memory from one zero word), the CPU sets up
+  *          the peripherals meanwhile; bytes past the last whole word are
+  *          cleared by the CPU.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+#ifndef STARTUP_DMAZERO_BASE
+/* UNINIT execution region RW_DMAZERO of the scatter file */
+extern uint8_t Image$$RW_DMAZERO$$ZI$$Base[];
+extern uint8_t Image$$RW_DMAZERO$$ZI$$Length[];
+#define STARTUP_DMAZERO_BASE        ((uint8_t *)Image$$RW_DMAZERO$$ZI$$Base)
+#define STARTUP_DMAZERO_BYTES       ((uint32_t)Image$$RW_DMAZERO$$ZI$$Length)
+#endif
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t Wraps;
+static StartupTime_TypeDef Times;
+
+static const uint32_t ZeroWord = 0;
+
+/**
+  * @brief Start the phase timer at 1us from HSI
+  * @param None
+  * @retval None
+  * @note call by SystemInit_EarlyHook() first; registers only, RAM is not
+  *       set up yet
+  */
+void StartupTime_Begin(void)
+{
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_TIM17);
+  MS32_TIM_SetPrescaler(TIM17, (HSI_VALUE / 1000000U) - 1U);
+  MS32_TIM_SetAutoReload(TIM17, 0xFFFF);
+  MS32_TIM_GenerateEvent_UPDATE(TIM17);
+  MS32_TIM_ClearFlag_UPDATE(TIM17);
+  MS32_TIM_EnableCounter(TIM17);
+}
+
+/**
+  * @brief Keep the elapsed time over the clock switch
+  * @param TimerClk new TIM17 kernel clock in Hz
+  * @retval None
+  * @note call by SystemInit_ClockReadyHook() once SW has switched;
+  *       registers only
+  */
+void StartupTime_ClockReady(uint32_t TimerClk)
+{
+  MS32_TIM_OC_SetCompareCH1(TIM17, MS32_TIM_GetCounter(TIM17));
+  MS32_TIM_SetPrescaler(TIM17, (TimerClk / 1000000U) - 1U);
+  /* loads the prescaler and restarts from 0 */
+  MS32_TIM_GenerateEvent_UPDATE(TIM17);
+  MS32_TIM_ClearFlag_UPDATE(TIM17);
+}
+
+/**
+  * @brief Time stamp a phase
+  * @param Phase STARTUP_PHASE_MAIN or later
+  * @retval None
+  */
+void StartupTime_Mark(uint8_t Phase)
+{
+  if (Phase >= STARTUP_PHASES)
+  {
+    return;
+  }
+  if (MS32_TIM_IsActiveFlag_UPDATE(TIM17))
+  {
+    MS32_TIM_ClearFlag_UPDATE(TIM17);
+    Wraps++;
+  }
+  Times.PhaseUs[STARTUP_PHASE_CLOCK] = MS32_TIM_OC_GetCompareCH1(TIM17);
+  Times.PhaseUs[Phase] = Times.PhaseUs[STARTUP_PHASE_CLOCK] + (Wraps << 16) + MS32_TIM_GetCounter(TIM17);
+}
+
+/**
+  * @brief Stop the phase timer, the times stay readable
+  * @param None
+  * @retval None
+  */
+void StartupTime_End(void)
+{
+  MS32_TIM_DisableCounter(TIM17);
+  MS32_APB1_GRP2_DisableClock(MS32_APB1_GRP2_PERIPH_TIM17);
+}
+
+/**
+  * @brief Start clearing the STARTUP_DMAZERO region by DMA
+  * @param None
+  * @retval None
+  * @note call from main() before the peripheral set up; nothing in the
+  *       region may be used before StartupTime_ZeroWait()
+  */
+void StartupTime_ZeroStart(void)
+{
+  uint32_t words = STARTUP_DMAZERO_BYTES >> 2;
+
+  if (words == 0U)
+  {
+    return;
+  }
+  MS32_AHB1_GRP1_EnableClock(MS32_AHB1_GRP1_PERIPH_DMA1);
+  MS32_DMA_DisableChannel(DMA1, STARTUP_ZERO_DMA_CHANNEL);
+  MS32_DMA_ConfigTransfer(DMA1, STARTUP_ZERO_DMA_CHANNEL,
+                          MS32_DMA_DIRECTION_MEMORY_TO_MEMORY | MS32_DMA_MODE_NORMAL |
+                          MS32_DMA_PERIPH_NOINCREMENT | MS32_DMA_MEMORY_INCREMENT |
+                          MS32_DMA_PDATAALIGN_WORD | MS32_DMA_MDATAALIGN_WORD |
+                          MS32_DMA_PRIORITY_LOW);
+  MS32_DMA_SetPeriphAddress(DMA1, STARTUP_ZERO_DMA_CHANNEL, (uint32_t)&ZeroWord);
+  MS32_DMA_SetMemoryAddress(DMA1, STARTUP_ZERO_DMA_CHANNEL, (uint32_t)STARTUP_DMAZERO_BASE);
+  MS32_DMA_SetDataLength(DMA1, STARTUP_ZERO_DMA_CHANNEL, words);
+  MS32_DMA_ClearFlag_GI1(DMA1);
+  MS32_DMA_EnableChannel(DMA1, STARTUP_ZERO_DMA_CHANNEL);
+}
+
+/**
+  * @brief Wait until the STARTUP_DMAZERO region is clear, free the channel
+  * @param None
+  * @retval None
+  */
+void StartupTime_ZeroWait(void)
+{
+  uint32_t bytes = STARTUP_DMAZERO_BYTES;
+  uint32_t i;
+
+  if ((bytes >> 2) != 0U)
+  {
+    while (!MS32_DMA_IsActiveFlag_TC1(DMA1))
+    {
+    }
+    MS32_DMA_ClearFlag_GI1(DMA1);
+    MS32_DMA_DisableChannel(DMA1, STARTUP_ZERO_DMA_CHANNEL);
+  }
+  for (i = bytes & ~3U; i < bytes; i++)
+  {
+    STARTUP_DMAZERO_BASE[i] = 0;
+  }
+}
+
+/**
+  * @brief Read the phase times
+  * @param Result pointer to a StartupTime_TypeDef structure
+  * @retval None
+  */
+void StartupTime_Get(StartupTime_TypeDef *Result)
+{
+  *Result = Times;
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,83 @@
+/**
+  ******************************************************************************
+  * @file    STARTUP_TIME.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of STARTUP_TIME.c file.
+  *
+  *          Reset-to-application timing on TIM17, 1us resolution:
+  *             StartupTime_Begin()       SystemInit() entry, time 0
+  *             StartupTime_ClockReady()  end of SetSysClock()
+  *             StartupTime_Mark()        main() and later phases
+  *          The time before SystemInit() (power on / brownout reset
+  *          temporization, option byte load) is not visible to the core.
+  *
+  *          RAM the C library start up does not clear (scatter file
+  *          Keil_Project/BlinkLED_Printf.sct, UNINIT regions):
+  *             STARTUP_NOINIT    ------> never cleared, for buffers that are
+  *                                       written before they are read
+  *             STARTUP_DMAZERO   ------> cleared by DMA1 Channel1 from
+  *                                       StartupTime_ZeroStart() while the
+  *                                       peripherals are set up, ready after
+  *                                       StartupTime_ZeroWait()
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STARTUP_TIME_H
+#define __STARTUP_TIME_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Phases, times are from SystemInit() entry */
+#define STARTUP_PHASE_CLOCK         0U      /* SYSCLK on the CLOCK_PLAN.h result */
+#define STARTUP_PHASE_MAIN          1U      /* C library .data copy and .bss clear done */
+#define STARTUP_PHASE_PERIPH        2U      /* SysTick, GPIO and USART1 up */
+#define STARTUP_PHASES              3U
+
+#if defined(__CC_ARM)
+#define STARTUP_NOINIT              __attribute__((section(".bss.noinit"), zero_init))
+#define STARTUP_DMAZERO             __attribute__((section(".bss.dmazero"), zero_init, aligned(4)))
+#else
+#define STARTUP_NOINIT              __attribute__((section(".bss.noinit")))
+#define STARTUP_DMAZERO             __attribute__((section(".bss.dmazero"), aligned(4)))
+#endif
+
+/* Clears the STARTUP_DMAZERO region, free again after StartupTime_ZeroWait() */
+#define STARTUP_ZERO_DMA_CHANNEL    MS32_DMA_CHANNEL_1
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t PhaseUs[STARTUP_PHASES];
+} StartupTime_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void StartupTime_Begin(void);
+void StartupTime_ClockReady(uint32_t TimerClk);
+void StartupTime_Mark(uint8_t Phase);
+void StartupTime_End(void);
+void StartupTime_Get(StartupTime_TypeDef *Result);
+void StartupTime_ZeroStart(void);
+void StartupTime_ZeroWait(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __STARTUP_TIME_H */
+
+/******************************** END OF FILE *********************************/
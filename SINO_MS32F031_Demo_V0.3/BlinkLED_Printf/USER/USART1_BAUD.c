@@ -0,0 +1,401 @@
+/**
+  ******************************************************************************
+  * @file 		USART1_BAUD.c
+	* @author		SINOMCU-AE
+  * @brief 		USART1 baud rate manager
+  *
+  *          This file provides functions to run USART1 above 115200:
+  *             BRR for oversampling 16 and 8 from the USART kernel clock,
+  *             integer math only, with the resulting baud error in ppm;
+  *             a step-up handshake over USART1_PKT confirmed by the
+  *             USART auto baud unit (0x55 frame).
+  *
+  *          Oversampling 8 writes USARTDIV[3:0] >> 1 to BRR[2:0], so its
+  *          divider is always even: BRR is built from 2 * round(clk / baud),
+  *          the resolution equals oversampling 16 but the divider may go
+  *          down to 8 (max baud = clk / 8).
+  *
+  *          Error at some kernel clocks (ppm, OS8 only when clk/baud < 16):
+  *             8MHz:   115200 +6400  230400 -7900  460800 +21200  1000000 0(OS8)
+  *             24MHz:  115200 +1600  921600 +1600  1500000 0      3000000 0(OS8)
+  *             48MHz:  115200 -800   921600 +1600  3000000 0      6000000 0(OS8)
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "USART1_BAUD.h"
+#include "USART1_CFG.h"
+#include "USART1_PKT.h"
+#include "SysTick_Delay.h"
+#include "CLOCK_SCALE.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BAUD_STATE_IDLE             0U
+#define BAUD_STATE_PENDING          1U      /* reply queued, waiting for TX to drain */
+#define BAUD_STATE_WAIT_ABR         2U      /* new rate on, waiting for host 0x55 */
+
+/* Variables -----------------------------------------------------------------*/
+const uint32_t USART1_BaudRateTable[] =
+{
+  115200, 230400, 460800, 921600, 1000000, 1500000, 2000000, 3000000, 6000000
+};
+const uint8_t USART1_BaudRateTableSize = sizeof(USART1_BaudRateTable) / sizeof(USART1_BaudRateTable[0]);
+
+static USART1_BaudTypeDef BaudCurrent = {USART1_BAUDRATE, USART1_BAUDRATE, 0, MS32_USART_OVERSAMPLING_16, 0};
+static USART1_BaudTypeDef BaudPrevious;
+static USART1_BaudTypeDef BaudTarget;
+static uint8_t BaudState;
+static uint32_t BaudTick;
+
+static USART1_BaudStatsTypeDef BaudStats;
+
+/**
+  * @brief Store a 32 bit value LSB first
+  * @param Buf destination, any alignment
+  * @param Value value
+  * @retval None
+  */
+static void USART1_Baud_Put32(uint8_t *Buf, uint32_t Value)
+{
+  Buf[0] = (uint8_t)Value;
+  Buf[1] = (uint8_t)(Value >> 8);
+  Buf[2] = (uint8_t)(Value >> 16);
+  Buf[3] = (uint8_t)(Value >> 24);
+}
+
+/**
+  * @brief Absolute value of a ppm error
+  * @param Ppm signed error
+  * @retval |Ppm|
+  */
+static uint32_t USART1_Baud_AbsPpm(int32_t Ppm)
+{
+  return (Ppm < 0) ? (uint32_t)(-Ppm) : (uint32_t)Ppm;
+}
+
+/**
+  * @brief Compute BRR and baud error for one oversampling mode
+  * @param PeriphClk USART kernel clock in Hz
+  * @param OverSampling MS32_USART_OVERSAMPLING_16 or MS32_USART_OVERSAMPLING_8
+  * @param BaudRate requested baud rate
+  * @param Cfg result
+  * @retval SUCCESS, ERROR when the divider is out of range for this mode
+  */
+ErrorStatus USART1_Baud_Calc(uint32_t PeriphClk, uint32_t OverSampling, uint32_t BaudRate, USART1_BaudTypeDef *Cfg)
+{
+  uint32_t div;
+  uint32_t nominal;
+  uint32_t diff;
+  uint32_t ppm;
+
+  if (BaudRate == 0U)
+  {
+    return ERROR;
+  }
+
+  /* clk / baud rounded, the effective divider in both modes */
+  div = (PeriphClk + (BaudRate / 2U)) / BaudRate;
+
+  if (OverSampling == MS32_USART_OVERSAMPLING_8)
+  {
+    if ((div < 8U) || (div > 0x7FFFU))
+    {
+      return ERROR;
+    }
+    Cfg->BRR = (uint16_t)(((div << 1) & 0xFFF0U) | (div & 0x7U));
+  }
+  else
+  {
+    if ((div < 16U) || (div > 0xFFFFU))
+    {
+      return ERROR;
+    }
+    Cfg->BRR = (uint16_t)div;
+  }
+
+  /* error = (clk - baud * div) / (baud * div), |clk - baud * div| <= baud / 2 */
+  nominal = BaudRate * div;
+  diff = (PeriphClk >= nominal) ? (PeriphClk - nominal) : (nominal - PeriphClk);
+  ppm = (uint32_t)(((uint64_t)diff * 1000000U) / nominal);
+
+  Cfg->BaudRate = BaudRate;
+  Cfg->ActualBaud = (PeriphClk + (div / 2U)) / div;
+  Cfg->ErrorPpm = (PeriphClk >= nominal) ? (int32_t)ppm : -(int32_t)ppm;
+  Cfg->OverSampling = OverSampling;
+
+  return SUCCESS;
+}
+
+/**
+  * @brief Pick the oversampling mode for a baud rate at the current clock
+  * @param BaudRate requested baud rate
+  * @param MaxErrorPpm accepted error
+  * @param Cfg result
+  * @retval SUCCESS, ERROR when the rate is not reachable within MaxErrorPpm
+  * @note oversampling 16 is preferred, it tolerates more clock deviation
+  */
+ErrorStatus USART1_Baud_Select(uint32_t BaudRate, uint32_t MaxErrorPpm, USART1_BaudTypeDef *Cfg)
+{
+  uint32_t clk;
+
+  clk = MS32_RCC_GetUSARTClockFreq(MS32_RCC_USART1_CLKSOURCE);
+
+  if ((USART1_Baud_Calc(clk, MS32_USART_OVERSAMPLING_16, BaudRate, Cfg) != SUCCESS) &&
+      (USART1_Baud_Calc(clk, MS32_USART_OVERSAMPLING_8, BaudRate, Cfg) != SUCCESS))
+  {
+    return ERROR;
+  }
+
+  if (USART1_Baud_AbsPpm(Cfg->ErrorPpm) > MaxErrorPpm)
+  {
+    return ERROR;
+  }
+  return SUCCESS;
+}
+
+/**
+  * @brief Write a baud configuration, OVER8 and CR2 need UE = 0
+  * @param Cfg configuration
+  * @param AutoBaud 1: arm auto baud on the next 0x55 frame
+  * @retval None
+  */
+static void USART1_Baud_Write(const USART1_BaudTypeDef *Cfg, uint8_t AutoBaud)
+{
+  /* let the last stop bit out at the old rate */
+  while (!MS32_USART_IsActiveFlag_TC(USART1));
+
+  MS32_USART_Disable(USART1);
+  MS32_USART_SetOverSampling(USART1, Cfg->OverSampling);
+  USART1->BRR = Cfg->BRR;
+  if (AutoBaud)
+  {
+    MS32_USART_SetAutoBaudRateMode(USART1, MS32_USART_AUTOBAUD_DETECT_ON_55_FRAME);
+    MS32_USART_EnableAutoBaudRate(USART1);
+  }
+  else
+  {
+    MS32_USART_DisableAutoBaudRate(USART1);
+  }
+  MS32_USART_Enable(USART1);
+}
+
+/**
+  * @brief Switch USART1 to a baud configuration
+  * @param Cfg result of USART1_Baud_Select()
+  * @retval None
+  * @note blocks until the current character is sent
+  */
+void USART1_Baud_Apply(const USART1_BaudTypeDef *Cfg)
+{
+  USART1_Baud_Write(Cfg, 0);
+  BaudCurrent = *Cfg;
+}
+
+/**
+  * @brief Highest table rate reachable at the current clock
+  * @param MaxErrorPpm accepted error
+  * @retval baud rate, 0 when none
+  */
+uint32_t USART1_Baud_GetMaxRate(uint32_t MaxErrorPpm)
+{
+  USART1_BaudTypeDef cfg;
+  uint8_t i;
+
+  for (i = USART1_BaudRateTableSize; i > 0U; i--)
+  {
+    if (USART1_Baud_Select(USART1_BaudRateTable[i - 1U], MaxErrorPpm, &cfg) == SUCCESS)
+    {
+      return USART1_BaudRateTable[i - 1U];
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief Baud rate USART1 is configured for
+  * @param None
+  * @retval baud rate
+  */
+uint32_t USART1_Baud_GetCurrent(void)
+{
+  return BaudCurrent.BaudRate;
+}
+
+/**
+  * @brief USART1_PKT command USART1_BAUD_CMD_ID
+  * @param Req request payload, empty or the new baud rate (4 bytes, LSB first)
+  * @param ReqLen request length
+  * @param Rsp response payload
+  * @retval response length
+  * @note register in the USART1_Pkt_Init() command table
+  */
+uint8_t USART1_Baud_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp)
+{
+  uint32_t baud;
+
+  if (BaudState != BAUD_STATE_IDLE)
+  {
+    Rsp[0] = USART1_BAUD_STATUS_BUSY;
+    return 1;
+  }
+
+  if (ReqLen < 4U)
+  {
+    Rsp[0] = USART1_BAUD_STATUS_OK;
+    USART1_Baud_Put32(&Rsp[1], USART1_Baud_GetMaxRate(USART1_BAUD_MAX_ERROR_PPM));
+    USART1_Baud_Put32(&Rsp[5], BaudCurrent.BaudRate);
+    return 9;
+  }
+
+  baud = (uint32_t)Req[0] | ((uint32_t)Req[1] << 8) | ((uint32_t)Req[2] << 16) | ((uint32_t)Req[3] << 24);
+  if (USART1_Baud_Select(baud, USART1_BAUD_MAX_ERROR_PPM, &BaudTarget) != SUCCESS)
+  {
+    Rsp[0] = USART1_BAUD_STATUS_REJECT;
+    return 1;
+  }
+
+  /* the reply still goes out at the old rate, USART1_Baud_Poll() switches after it */
+  BaudState = BAUD_STATE_PENDING;
+  Rsp[0] = USART1_BAUD_STATUS_OK;
+  USART1_Baud_Put32(&Rsp[1], BaudTarget.ActualBaud);
+  USART1_Baud_Put32(&Rsp[5], (uint32_t)BaudTarget.ErrorPpm);
+  return 9;
+}
+
+/**
+  * @brief Baud handshake state machine
+  * @param None
+  * @retval None
+  * @note call from the main loop after USART1_Pkt_Poll()
+  */
+void USART1_Baud_Poll(void)
+{
+  uint32_t measured;
+  uint32_t diff;
+
+  switch (BaudState)
+  {
+    case BAUD_STATE_PENDING:
+      if (!USART1_Pkt_IsTxIdle())
+      {
+        break;
+      }
+      /* revert target is what the hardware runs now, whoever set it */
+      BaudPrevious = BaudCurrent;
+      BaudPrevious.BRR = (uint16_t)USART1->BRR;
+      BaudPrevious.OverSampling = MS32_USART_GetOverSampling(USART1);
+      USART1_Baud_Write(&BaudTarget, 1);
+      BaudTick = SysTick_GetTick();
+      BaudState = BAUD_STATE_WAIT_ABR;
+      break;
+
+    case BAUD_STATE_WAIT_ABR:
+      if (MS32_USART_IsActiveFlag_ABR(USART1) && !MS32_USART_IsActiveFlag_ABRE(USART1))
+      {
+        /* BRR now holds the measured divider, it must agree with the plan */
+        measured = MS32_USART_GetBaudRate(USART1, MS32_RCC_GetUSARTClockFreq(MS32_RCC_USART1_CLKSOURCE), BaudTarget.OverSampling);
+        BaudStats.LastMeasuredBaud = measured;
+        diff = (measured >= BaudTarget.ActualBaud) ? (measured - BaudTarget.ActualBaud) : (BaudTarget.ActualBaud - measured);
+        if (diff <= ((BaudTarget.ActualBaud / 1000U) * USART1_BAUD_MAX_ERROR_PPM) / 1000U)
+        {
+          /* keep the measured divider, it absorbs the host clock error too */
+          BaudTarget.BRR = (uint16_t)USART1->BRR;
+          BaudTarget.ActualBaud = measured;
+          USART1_Baud_Apply(&BaudTarget);
+          BaudStats.Switches++;
+          BaudState = BAUD_STATE_IDLE;
+          break;
+        }
+      }
+
+      if (MS32_USART_IsActiveFlag_ABRE(USART1) || MS32_USART_IsActiveFlag_ABR(USART1) ||
+          ((SysTick_GetTick() - BaudTick) >= USART1_BAUD_TIMEOUT_MS))
+      {
+        USART1_Baud_Apply(&BaudPrevious);
+        BaudStats.Reverts++;
+        BaudState = BAUD_STATE_IDLE;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief Read the handshake statistics
+  * @param Stats pointer to a USART1_BaudStatsTypeDef structure
+  * @retval None
+  */
+void USART1_Baud_GetStats(USART1_BaudStatsTypeDef *Stats)
+{
+  *Stats = BaudStats;
+}
+
+/**
+  * @brief Recompute a rate for the current USART kernel clock
+  * @param Cfg rate to recompute, USART1_BAUDRATE if it is out of reach now
+  * @retval None
+  */
+static void USART1_Baud_Recalc(USART1_BaudTypeDef *Cfg)
+{
+  USART1_BaudTypeDef cfg;
+
+  if (USART1_Baud_Select(Cfg->BaudRate, USART1_BAUD_MAX_ERROR_PPM, &cfg) != SUCCESS)
+  {
+    USART1_Baud_Select(USART1_BAUDRATE, USART1_BAUD_MAX_ERROR_PPM, &cfg);
+    BaudStats.Reverts++;
+  }
+  *Cfg = cfg;
+}
+
+/**
+  * @brief CLOCK_SCALE re-timing: BRR follows the kernel clock, the baud
+  *        rate (and a step-up handshake in progress) is kept
+  * @param Phase CLOCK_SCALE_PRE or CLOCK_SCALE_POST
+  * @param Sysclk new SYSCLK, the kernel clock is read back from RCC
+  * @retval None
+  * @note register with ClockScale_Register()
+  */
+void USART1_Baud_ClockCallback(uint8_t Phase, uint32_t Sysclk)
+{
+  (void)Sysclk;
+
+  if (Phase == CLOCK_SCALE_PRE)
+  {
+    /* let the last stop bit out at the old rate */
+    while (!MS32_USART_IsActiveFlag_TC(USART1));
+    return;
+  }
+
+  USART1_Baud_Recalc(&BaudCurrent);
+  if (BaudState == BAUD_STATE_WAIT_ABR)
+  {
+    /* the host is already on the target rate */
+    USART1_Baud_Recalc(&BaudPrevious);
+    USART1_Baud_Recalc(&BaudTarget);
+    USART1_Baud_Write(&BaudTarget, 1);
+  }
+  else
+  {
+    if (BaudState == BAUD_STATE_PENDING)
+    {
+      USART1_Baud_Recalc(&BaudTarget);
+    }
+    USART1_Baud_Write(&BaudCurrent, 0);
+  }
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file    USART1_BAUD.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of USART1_BAUD.c file.
+  *
+  *          Baud step-up handshake, carried by USART1_PKT command
+  *          USART1_BAUD_CMD_ID:
+  *             request payload empty    ------> reply: status, max baud, current baud
+  *             request payload baud(4)  ------> reply: status, actual baud, error ppm
+  *             after an OK reply the MCU switches rate and arms auto baud
+  *             (0x55 frame), host sends 0x55 0x00 at the new rate; no 0x55
+  *             within USART1_BAUD_TIMEOUT_MS reverts to the previous rate.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USART1_BAUD_H
+#define __USART1_BAUD_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Accepted baud error, +-2% is the usual 8N1 budget split between two ends */
+#define USART1_BAUD_MAX_ERROR_PPM   20000U
+#define USART1_BAUD_TIMEOUT_MS      500U
+
+#define USART1_BAUD_CMD_ID          0x10U
+
+#define USART1_BAUD_STATUS_OK       0x00U
+#define USART1_BAUD_STATUS_REJECT   0x01U   /* rate not reachable within error */
+#define USART1_BAUD_STATUS_BUSY     0x02U   /* previous switch not finished */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t BaudRate;        /* requested rate */
+  uint32_t ActualBaud;      /* rate produced by BRR */
+  int32_t  ErrorPpm;        /* (actual - requested) / requested */
+  uint32_t OverSampling;    /* MS32_USART_OVERSAMPLING_16 or MS32_USART_OVERSAMPLING_8 */
+  uint16_t BRR;             /* value for the BRR register */
+} USART1_BaudTypeDef;
+
+typedef struct
+{
+  uint32_t Switches;        /* confirmed by auto baud */
+  uint32_t Reverts;         /* timeout or auto baud error */
+  uint32_t LastMeasuredBaud;
+} USART1_BaudStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+extern const uint32_t USART1_BaudRateTable[];
+extern const uint8_t USART1_BaudRateTableSize;
+
+/* Exported functions prototypes ---------------------------------------------*/
+ErrorStatus USART1_Baud_Calc(uint32_t PeriphClk, uint32_t OverSampling, uint32_t BaudRate, USART1_BaudTypeDef *Cfg);
+ErrorStatus USART1_Baud_Select(uint32_t BaudRate, uint32_t MaxErrorPpm, USART1_BaudTypeDef *Cfg);
+void USART1_Baud_Apply(const USART1_BaudTypeDef *Cfg);
+uint32_t USART1_Baud_GetMaxRate(uint32_t MaxErrorPpm);
+uint32_t USART1_Baud_GetCurrent(void);
+
+uint8_t USART1_Baud_CmdHandler(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp);
+void USART1_Baud_Poll(void);
+void USART1_Baud_GetStats(USART1_BaudStatsTypeDef *Stats);
+void USART1_Baud_ClockCallback(uint8_t Phase, uint32_t Sysclk);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __USART1_BAUD_H */
+
+/******************************** END OF FILE *********************************/
@@ -61,7 +61,7 @@ void USART1_UART_Init(void)
   MS32_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
   /* UART parameter configuration*/
-  USART_InitStruct.BaudRate = 115200;
+  USART_InitStruct.BaudRate = USART1_BAUDRATE;
   USART_InitStruct.DataWidth = MS32_USART_DATAWIDTH_8B;
   USART_InitStruct.StopBits = MS32_USART_STOPBITS_1;
   USART_InitStruct.Parity = MS32_USART_PARITY_NONE;
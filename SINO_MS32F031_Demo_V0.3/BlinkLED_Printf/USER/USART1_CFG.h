@@ -26,6 +26,9 @@
 #include "ms32f0xx.h"
 
 /* Exported macro ------------------------------------------------------------*/
+/* Power-on baud rate, USART1_BAUD can step it up at run time */
+#define USART1_BAUDRATE           115200U
+
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
 /* Exported functions prototypes ---------------------------------------------*/
@@ -0,0 +1,487 @@
+/**
+  ******************************************************************************
+  * @file 		USART1_PKT.c
+	* @author		SINOMCU-AE
+  * @brief 		COBS framed binary command / telemetry protocol on USART1
+  *
+  *          This file provides functions of the packet protocol:
+  *             receive       : USART1_RX circular DMA, packets split on 0x00
+  *             transmit      : DMA1 Channel4 (USART1_TX remapped), sent
+  *                             straight from the buffer the packet is built in
+  *             integrity     : hardware CRC unit
+  *             request/reply : SEQ is echoed, a repeated SEQ is answered
+  *                             from the last response without re-executing
+  *
+  *          Needed call USART1_Pkt_DMA_IRQHandler() in DMA1_Channel4_5_IRQHandler().
+  *          printf (fputc) must not be used on USART1 while this is running.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "USART1_PKT.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PKT_HEADER_LEN      3U
+#define PKT_CRC_LEN         4U
+#define PKT_RAW_MAX         (PKT_HEADER_LEN + USART1_PKT_MAX_PAYLOAD + PKT_CRC_LEN)
+/* COBS code byte + raw packet + 0x00 delimiter */
+#define PKT_BUF_SIZE        (1U + PKT_RAW_MAX + 1U)
+
+#define PKT_SLOT_RESPONSE   0U
+#define PKT_SLOT_TELEMETRY  1U
+#define PKT_SLOT_NUM        2U
+
+#if (PKT_RAW_MAX > 253U)
+#error "USART1_PKT_MAX_PAYLOAD too large for single-block in place COBS"
+#endif
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t TxBuf[PKT_SLOT_NUM][PKT_BUF_SIZE] STARTUP_NOINIT;
+static uint8_t TxLen[PKT_SLOT_NUM];
+static __IO uint8_t TxPending;              /* bit per slot, waiting for DMA */
+static __IO uint8_t TxActive;               /* bit per slot, on DMA now */
+
+static uint8_t RxAcc[PKT_BUF_SIZE] STARTUP_NOINIT;
+static uint16_t RxAccLen;
+static uint8_t RxDiscard;                   /* skip until next delimiter */
+
+static uint8_t RspValid;
+static uint8_t LastSeq;
+static uint8_t LastId;
+static uint8_t TelemetrySeq;
+
+static const USART1_PktCmdTypeDef *CmdTable;
+static uint8_t CmdCount;
+
+static USART1_PktStatsTypeDef PktStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void USART1_Pkt_StartTx(void);
+
+/**
+  * @brief COBS encode a packet in place
+  * @param Buf packet in Buf[1..Len], Buf[0] is reserved for the first code byte
+  * @param Len raw packet length, 1~253 (single COBS block, no byte insertion)
+  * @retval Encoded length including the trailing 0x00 delimiter (Len + 2)
+  */
+uint16_t COBS_EncodeInPlace(uint8_t *Buf, uint16_t Len)
+{
+  uint16_t code_pos = 0;
+  uint8_t code = 1;
+  uint16_t i;
+
+  for (i = 1; i <= Len; i++)
+  {
+    if (Buf[i] == 0)
+    {
+      Buf[code_pos] = code;
+      code_pos = i;
+      code = 1;
+    }
+    else
+    {
+      code++;
+    }
+  }
+  Buf[code_pos] = code;
+  Buf[Len + 1U] = 0;
+
+  return (uint16_t)(Len + 2U);
+}
+
+/**
+  * @brief COBS decode in place, the output is written from Buf[0]
+  * @param Buf encoded bytes without the 0x00 delimiter
+  * @param Len encoded length
+  * @retval Decoded length, 0 on malformed input
+  */
+uint16_t COBS_DecodeInPlace(uint8_t *Buf, uint16_t Len)
+{
+  uint16_t i = 0;
+  uint16_t o = 0;
+  uint8_t code;
+  uint8_t k;
+
+  while (i < Len)
+  {
+    code = Buf[i++];
+    if (code == 0)
+    {
+      return 0;
+    }
+    for (k = 1; k < code; k++)
+    {
+      if (i >= Len)
+      {
+        return 0;
+      }
+      Buf[o++] = Buf[i++];
+    }
+    if ((code != 0xFFU) && (i < Len))
+    {
+      Buf[o++] = 0;
+    }
+  }
+
+  return o;
+}
+
+/**
+  * @brief Add CRC, COBS encode and queue a packet built in TxBuf[Slot]
+  * @param Slot PKT_SLOT_RESPONSE or PKT_SLOT_TELEMETRY
+  * @param Type,Seq,Id packet header
+  * @param Len payload length already written at TxBuf[Slot][4]
+  * @retval None
+  */
+static void USART1_Pkt_Queue(uint8_t Slot, uint8_t Type, uint8_t Seq, uint8_t Id, uint8_t Len)
+{
+  uint8_t *buf = TxBuf[Slot];
+  uint16_t n = PKT_HEADER_LEN + Len;
+  uint32_t crc;
+
+  buf[1] = Type;
+  buf[2] = Seq;
+  buf[3] = Id;
+  crc = MS32_CRC_Calculate(MS32_CRC_RECALC, MS32_CRC_INPUTDATA_FORMAT_BYTES, (uint32_t *)&buf[1], n);
+  buf[1U + n] = (uint8_t)crc;
+  buf[2U + n] = (uint8_t)(crc >> 8);
+  buf[3U + n] = (uint8_t)(crc >> 16);
+  buf[4U + n] = (uint8_t)(crc >> 24);
+  n += PKT_CRC_LEN;
+
+  TxLen[Slot] = (uint8_t)COBS_EncodeInPlace(buf, n);
+
+  __disable_irq();
+  TxPending |= (uint8_t)(1U << Slot);
+  __enable_irq();
+  USART1_Pkt_StartTx();
+}
+
+/**
+  * @brief Start the next queued packet if the TX DMA is idle, response first
+  * @param None
+  * @retval None
+  */
+static void USART1_Pkt_StartTx(void)
+{
+  uint8_t slot;
+
+  __disable_irq();
+  if ((TxActive == 0) && (TxPending != 0))
+  {
+    slot = (TxPending & (1U << PKT_SLOT_RESPONSE)) ? PKT_SLOT_RESPONSE : PKT_SLOT_TELEMETRY;
+    TxPending &= (uint8_t)~(1U << slot);
+    TxActive = (uint8_t)(1U << slot);
+
+    MS32_DMA_DisableChannel(DMA1, USART1_PKT_TX_DMA_CHANNEL);
+    MS32_DMA_SetMemoryAddress(DMA1, USART1_PKT_TX_DMA_CHANNEL, (uint32_t)TxBuf[slot]);
+    MS32_DMA_SetDataLength(DMA1, USART1_PKT_TX_DMA_CHANNEL, TxLen[slot]);
+    MS32_DMA_EnableChannel(DMA1, USART1_PKT_TX_DMA_CHANNEL);
+  }
+  __enable_irq();
+}
+
+/**
+  * @brief Check, dispatch and answer one decoded packet
+  * @param Pkt decoded packet
+  * @param Len decoded length
+  * @retval None
+  */
+static void USART1_Pkt_Handle(const uint8_t *Pkt, uint16_t Len)
+{
+  uint8_t *rsp = &TxBuf[PKT_SLOT_RESPONSE][1U + PKT_HEADER_LEN];
+  USART1_RxStatsTypeDef rx_stats;
+  uint32_t crc;
+  uint8_t seq;
+  uint8_t id;
+  uint8_t req_len;
+  uint8_t rsp_len = 0;
+  uint8_t type = USART1_PKT_TYPE_RESPONSE;
+  uint8_t i;
+
+  if ((Len < (PKT_HEADER_LEN + PKT_CRC_LEN)) || (Len > PKT_RAW_MAX))
+  {
+    PktStats.FormatErrors++;
+    return;
+  }
+
+  Len -= PKT_CRC_LEN;
+  crc = MS32_CRC_Calculate(MS32_CRC_RECALC, MS32_CRC_INPUTDATA_FORMAT_BYTES, (uint32_t *)Pkt, Len);
+  if ((Pkt[Len] != (uint8_t)crc) || (Pkt[Len + 1U] != (uint8_t)(crc >> 8)) ||
+      (Pkt[Len + 2U] != (uint8_t)(crc >> 16)) || (Pkt[Len + 3U] != (uint8_t)(crc >> 24)))
+  {
+    PktStats.CrcErrors++;
+    return;
+  }
+
+  PktStats.RxPackets++;
+  if (Pkt[0] != USART1_PKT_TYPE_REQUEST)
+  {
+    return;
+  }
+
+  seq = Pkt[1];
+  id = Pkt[2];
+  req_len = (uint8_t)(Len - PKT_HEADER_LEN);
+  Pkt += PKT_HEADER_LEN;
+
+  /* host retry: the encoded response is still in its buffer */
+  if (RspValid && (seq == LastSeq) && (id == LastId))
+  {
+    PktStats.Retransmits++;
+    __disable_irq();
+    TxPending |= (uint8_t)(1U << PKT_SLOT_RESPONSE);
+    __enable_irq();
+    USART1_Pkt_StartTx();
+    return;
+  }
+
+  if (id == USART1_PKT_CMD_PING)
+  {
+    for (i = 0; i < req_len; i++)
+    {
+      rsp[i] = Pkt[i];
+    }
+    rsp_len = req_len;
+  }
+  else if (id == USART1_PKT_CMD_RX_STATS)
+  {
+    /* rsp is not word aligned, copy byte by byte (little endian fields) */
+    USART1_RxDMA_GetStats(&rx_stats);
+    for (i = 0; i < sizeof(rx_stats); i++)
+    {
+      rsp[i] = ((const uint8_t *)&rx_stats)[i];
+    }
+    rsp_len = sizeof(rx_stats);
+  }
+  else
+  {
+    type = USART1_PKT_TYPE_NAK;
+    rsp[0] = USART1_PKT_NAK_UNKNOWN_CMD;
+    rsp_len = 1;
+    for (i = 0; i < CmdCount; i++)
+    {
+      if (CmdTable[i].Id == id)
+      {
+        type = USART1_PKT_TYPE_RESPONSE;
+        rsp_len = CmdTable[i].Handler(Pkt, req_len, rsp);
+        break;
+      }
+    }
+  }
+
+  RspValid = 1;
+  LastSeq = seq;
+  LastId = id;
+  USART1_Pkt_Queue(PKT_SLOT_RESPONSE, type, seq, id, rsp_len);
+}
+
+/**
+  * @brief Packet protocol Initialization Function
+  * @param Cmds application command table, may be 0
+  * @param Count number of entries in Cmds
+  * @retval None
+  * @note call after USART1_UART_Init() and USART1_RxDMA_Init()
+  */
+void USART1_Pkt_Init(const USART1_PktCmdTypeDef *Cmds, uint8_t Count)
+{
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+  MS32_CRC_InitTypeDef CRC_InitStruct;
+
+  CmdTable = Cmds;
+  CmdCount = Count;
+  RxAccLen = 0;
+  RxDiscard = 0;
+  RspValid = 0;
+  TxPending = 0;
+  TxActive = 0;
+
+  MS32_CRC_StructInit(&CRC_InitStruct);
+  MS32_CRC_Init(&CRC_InitStruct);
+
+  /* USART1_TX request on DMA1 Channel4 */
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_SYSCFG);
+  MS32_SYSCFG_SetRemapDMA_USART(MS32_SYSCFG_USART1TX_RMP_DMA1CH4);
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_USART_DMA_GetRegAddr(USART1, MS32_USART_DMA_REG_DATA_TRANSMIT);
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_MEMORY_TO_PERIPH;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_NORMAL;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_MEDIUM;
+  MS32_DMA_DisableChannel(DMA1, USART1_PKT_TX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, USART1_PKT_TX_DMA_CHANNEL, &DMA_InitStruct);
+  MS32_DMA_ITConfig(DMA1, USART1_PKT_TX_DMA_CHANNEL, MS32_DMA_CCR_TCIE, 0x1);
+
+  MS32_USART_EnableDMAReq_TX(USART1);
+}
+
+/**
+  * @brief Handle every complete packet in the accumulator
+  * @param None
+  * @retval None
+  * @note stops while the previous response is still queued so requests
+  *       are never answered out of order
+  */
+static void USART1_Pkt_Parse(void)
+{
+  uint16_t start = 0;
+  uint16_t i;
+  uint16_t n;
+  uint8_t stall = 0;
+
+  for (i = 0; i < RxAccLen; i++)
+  {
+    if (RxAcc[i] != 0)
+    {
+      continue;
+    }
+    if ((TxPending | TxActive) & (1U << PKT_SLOT_RESPONSE))
+    {
+      stall = 1;
+      break;
+    }
+
+    if (RxDiscard)
+    {
+      RxDiscard = 0;
+    }
+    else if (i > start)
+    {
+      n = COBS_DecodeInPlace(&RxAcc[start], (uint16_t)(i - start));
+      if (n == 0)
+      {
+        PktStats.FormatErrors++;
+      }
+      else
+      {
+        USART1_Pkt_Handle(&RxAcc[start], n);
+      }
+    }
+    start = (uint16_t)(i + 1U);
+  }
+
+  /* keep the unfinished tail, drop it if it can never fit; a stalled tail
+     holds whole packets waiting for the response slot; a long run counts
+     as one error however many reads it takes */
+  n = (uint16_t)(RxAccLen - start);
+  if ((n >= PKT_BUF_SIZE) && !stall)
+  {
+    if (!RxDiscard)
+    {
+      PktStats.FormatErrors++;
+    }
+    RxDiscard = 1;
+    n = 0;
+  }
+  for (i = 0; i < n; i++)
+  {
+    RxAcc[i] = RxAcc[start + i];
+  }
+  RxAccLen = n;
+}
+
+/**
+  * @brief Pull received bytes, handle every complete packet
+  * @param None
+  * @retval None
+  * @note call from main loop; the ring is read as a byte stream, only as
+  *       much as the accumulator takes, the rest waits in the ring
+  */
+void USART1_Pkt_Poll(void)
+{
+  uint16_t got;
+
+  do
+  {
+    got = USART1_RxDMA_Read(&RxAcc[RxAccLen], (uint16_t)(PKT_BUF_SIZE - RxAccLen));
+    RxAccLen += got;
+    USART1_Pkt_Parse();
+  } while ((got != 0) && !((TxPending | TxActive) & (1U << PKT_SLOT_RESPONSE)));
+}
+
+/**
+  * @brief Telemetry payload buffer, filled in place by the caller
+  * @param None
+  * @retval Pointer to USART1_PKT_MAX_PAYLOAD bytes, 0 while the previous
+  *         telemetry packet is still being sent
+  */
+uint8_t *USART1_Pkt_GetTelemetryBuffer(void)
+{
+  if ((TxPending | TxActive) & (1U << PKT_SLOT_TELEMETRY))
+  {
+    return 0;
+  }
+  return &TxBuf[PKT_SLOT_TELEMETRY][1U + PKT_HEADER_LEN];
+}
+
+/**
+  * @brief Send the telemetry payload written to USART1_Pkt_GetTelemetryBuffer()
+  * @param Stream stream ID, goes to the packet ID field
+  * @param Len payload length, 0~USART1_PKT_MAX_PAYLOAD
+  * @retval SUCCESS queued, ERROR buffer busy or Len too long
+  */
+ErrorStatus USART1_Pkt_SendTelemetry(uint8_t Stream, uint8_t Len)
+{
+  if ((Len > USART1_PKT_MAX_PAYLOAD) || (USART1_Pkt_GetTelemetryBuffer() == 0))
+  {
+    PktStats.TxBusy++;
+    return ERROR;
+  }
+
+  USART1_Pkt_Queue(PKT_SLOT_TELEMETRY, USART1_PKT_TYPE_TELEMETRY, TelemetrySeq++, Stream, Len);
+  return SUCCESS;
+}
+
+/**
+  * @brief Read the protocol statistics
+  * @param Stats pointer to a USART1_PktStatsTypeDef structure
+  * @retval None
+  */
+void USART1_Pkt_GetStats(USART1_PktStatsTypeDef *Stats)
+{
+  *Stats = PktStats;
+}
+
+/**
+  * @brief Check that no packet is queued or on DMA
+  * @param None
+  * @retval 1 idle, 0 busy
+  * @note the last byte may still be in the USART, check TC before
+  *       touching the line
+  */
+uint8_t USART1_Pkt_IsTxIdle(void)
+{
+  return ((TxPending | TxActive) == 0U) ? 1U : 0U;
+}
+
+/**
+  * @brief DMA1 Channel4 transfer complete interrupt
+  * @param None
+  * @retval None
+  * @note call by DMA1_Channel4_5_IRQHandler()
+  */
+void USART1_Pkt_DMA_IRQHandler(void)
+{
+  if (MS32_DMA_IsActiveFlag_TC4(DMA1))
+  {
+    MS32_DMA_ClearFlag_TC4(DMA1);
+    TxActive = 0;
+    USART1_Pkt_StartTx();
+  }
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    USART1_PKT.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of USART1_PKT.c file.
+  *
+  *          Binary packet layout before COBS encoding:
+  *             TYPE(1) SEQ(1) ID(1) PAYLOAD(0~USART1_PKT_MAX_PAYLOAD) CRC32(4, LSB first)
+  *          On the wire every packet is COBS encoded and ends with 0x00.
+  *          CRC32 is the hardware CRC unit result (poly 0x04C11DB7,
+  *          init 0xFFFFFFFF, no reflection) over TYPE..PAYLOAD.
+  *
+  *          Wire cost is PAYLOAD + 9 bytes, e.g. 16 byte telemetry:
+  *             115200 baud  ------> about 460 frames/s
+  *             1000000 baud ------> about 4000 frames/s
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USART1_PKT_H
+#define __USART1_PKT_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "USART1_RX.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define USART1_PKT_MAX_PAYLOAD      48U
+
+#define USART1_PKT_TX_DMA_CHANNEL   MS32_DMA_CHANNEL_4
+
+/* Packet TYPE field */
+#define USART1_PKT_TYPE_REQUEST     0x01U
+#define USART1_PKT_TYPE_RESPONSE    0x02U
+#define USART1_PKT_TYPE_TELEMETRY   0x03U
+#define USART1_PKT_TYPE_NAK         0x04U
+
+/* Built-in command ID */
+#define USART1_PKT_CMD_PING         0x00U   /* echo payload */
+#define USART1_PKT_CMD_RX_STATS     0x01U   /* USART1_RxStatsTypeDef */
+
+/* NAK payload */
+#define USART1_PKT_NAK_UNKNOWN_CMD  0x01U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Command handler, writes the response payload to Rsp
+  *        (USART1_PKT_MAX_PAYLOAD bytes available) and returns its length
+  */
+typedef uint8_t (*USART1_PktHandler)(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp);
+
+typedef struct
+{
+  uint8_t Id;
+  USART1_PktHandler Handler;
+} USART1_PktCmdTypeDef;
+
+typedef struct
+{
+  uint32_t RxPackets;
+  uint32_t CrcErrors;
+  uint32_t FormatErrors;    /* bad COBS, too short or too long */
+  uint32_t Retransmits;     /* repeated request SEQ answered from cache */
+  uint32_t TxBusy;          /* telemetry dropped, DMA still sending */
+} USART1_PktStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void USART1_Pkt_Init(const USART1_PktCmdTypeDef *Cmds, uint8_t Count);
+void USART1_Pkt_Poll(void);
+uint8_t *USART1_Pkt_GetTelemetryBuffer(void);
+ErrorStatus USART1_Pkt_SendTelemetry(uint8_t Stream, uint8_t Len);
+void USART1_Pkt_GetStats(USART1_PktStatsTypeDef *Stats);
+uint8_t USART1_Pkt_IsTxIdle(void);
+
+uint16_t COBS_EncodeInPlace(uint8_t *Buf, uint16_t Len);
+uint16_t COBS_DecodeInPlace(uint8_t *Buf, uint16_t Len);
+
+void USART1_Pkt_DMA_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __USART1_PKT_H */
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,335 @@
+/**
+  ******************************************************************************
+  * @file 		USART1_RX.c
+	* @author		SINOMCU-AE
+  * @brief 		USART1 receive by circular DMA
+  *
+  *          This file provides functions to receive on USART1 without
+  *          per-byte interrupts:
+  *             DMA1 Channel5 (USART1_RX remapped) runs in circular mode
+  *             into RxRing; the CPU only wakes on DMA half/complete,
+  *             USART IDLE and USART receiver timeout (RTO).
+  *             A frame ends after USART1_RX_TIMEOUT_BITS of line silence.
+  *
+  *          Needed call USART1_RxDMA_IRQHandler() in USART1_IRQHandler() and
+  *          USART1_RxDMA_DMA_IRQHandler() in DMA1_Channel4_5_IRQHandler().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "USART1_RX.h"
+#include "SysTick_Delay.h"
+#include "STARTUP_TIME.h"
+
+/* Private define ------------------------------------------------------------*/
+#define RX_RING_MASK        (USART1_RX_RING_SIZE - 1U)
+#define RX_FRAME_MASK       (USART1_RX_FRAME_DEPTH - 1U)
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t RxRing[USART1_RX_RING_SIZE] STARTUP_NOINIT;
+
+/* Byte counters are free running, ring index = counter & RX_RING_MASK */
+static __IO uint32_t RxHead;                 /* written by DMA, synced in ISR */
+static uint32_t RxTail;                      /* consumed by application */
+static uint16_t RxLastPos;                   /* DMA ring position at last sync */
+
+static __IO uint32_t FrameEnd[USART1_RX_FRAME_DEPTH];
+static __IO uint32_t FrameIn;                /* ISR side */
+static uint32_t FrameOut;                    /* application side */
+static uint32_t LastFrameEnd;
+static __IO uint32_t LastFrameUs;            /* SysTick_GetUs() at the last RTO */
+
+static USART1_RxStatsTypeDef RxStats;
+
+/**
+  * @brief Account the bytes DMA wrote since the last call
+  * @param None
+  * @retval None
+  * @note call from USART1 / DMA interrupt only; both share one priority,
+  *       DMA half/complete interrupts guarantee a call every half ring
+  */
+static void USART1_RxDMA_Sync(void)
+{
+  uint16_t pos;
+
+  pos = (uint16_t)(USART1_RX_RING_SIZE - MS32_DMA_GetDataLength(DMA1, USART1_RX_DMA_CHANNEL));
+  pos &= RX_RING_MASK;
+
+  RxHead += (uint16_t)(pos - RxLastPos) & RX_RING_MASK;
+  RxLastPos = pos;
+  RxStats.RxBytes = RxHead;
+}
+
+/**
+  * @brief Byte counter up to the DMA position now
+  * @param None
+  * @retval free running count, RxHead plus the bytes not synced yet
+  * @note call from the application; RxHead alone may be a half ring old
+  */
+static uint32_t USART1_RxDMA_HeadNow(void)
+{
+  uint32_t head;
+  uint16_t pos;
+
+  __disable_irq();
+  pos = (uint16_t)(USART1_RX_RING_SIZE - MS32_DMA_GetDataLength(DMA1, USART1_RX_DMA_CHANNEL));
+  pos &= RX_RING_MASK;
+  head = RxHead + ((uint16_t)(pos - RxLastPos) & RX_RING_MASK);
+  __enable_irq();
+  return head;
+}
+
+/**
+  * @brief USART1 DMA receive Initialization Function
+  * @param None
+  * @retval None
+  * @note call after USART1_UART_Init()
+  */
+void USART1_RxDMA_Init(void)
+{
+  MS32_DMA_InitTypeDef DMA_InitStruct;
+
+  /* USART1_RX request on DMA1 Channel5, keeps channel 2/3 free for SPI/I2C */
+  MS32_APB1_GRP2_EnableClock(MS32_APB1_GRP2_PERIPH_SYSCFG);
+  MS32_SYSCFG_SetRemapDMA_USART(MS32_SYSCFG_USART1RX_RMP_DMA1CH5);
+
+  MS32_DMA_StructInit(&DMA_InitStruct);
+  DMA_InitStruct.PeriphOrM2MSrcAddress  = MS32_USART_DMA_GetRegAddr(USART1, MS32_USART_DMA_REG_DATA_RECEIVE);
+  DMA_InitStruct.MemoryOrM2MDstAddress  = (uint32_t)RxRing;
+  DMA_InitStruct.Direction              = MS32_DMA_DIRECTION_PERIPH_TO_MEMORY;
+  DMA_InitStruct.Mode                   = MS32_DMA_MODE_CIRCULAR;
+  DMA_InitStruct.PeriphOrM2MSrcIncMode  = MS32_DMA_PERIPH_NOINCREMENT;
+  DMA_InitStruct.MemoryOrM2MDstIncMode  = MS32_DMA_MEMORY_INCREMENT;
+  DMA_InitStruct.PeriphOrM2MSrcDataSize = MS32_DMA_PDATAALIGN_BYTE;
+  DMA_InitStruct.MemoryOrM2MDstDataSize = MS32_DMA_MDATAALIGN_BYTE;
+  DMA_InitStruct.NbData                 = USART1_RX_RING_SIZE;
+  DMA_InitStruct.Priority               = MS32_DMA_PRIORITY_HIGH;
+  MS32_DMA_DisableChannel(DMA1, USART1_RX_DMA_CHANNEL);
+  MS32_DMA_Init(DMA1, USART1_RX_DMA_CHANNEL, &DMA_InitStruct);
+  MS32_DMA_ITConfig(DMA1, USART1_RX_DMA_CHANNEL, MS32_DMA_CCR_HTIE | MS32_DMA_CCR_TCIE, 0x1);
+
+  RxHead = 0;
+  RxTail = 0;
+  RxLastPos = 0;
+  FrameIn = 0;
+  FrameOut = 0;
+  LastFrameEnd = 0;
+
+  /* RTOEN is configured with the USART disabled */
+  MS32_USART_Disable(USART1);
+  MS32_USART_SetRxTimeout(USART1, USART1_RX_TIMEOUT_BITS);
+  MS32_USART_EnableRxTimeout(USART1);
+  MS32_USART_EnableDMAReq_RX(USART1);
+  MS32_DMA_EnableChannel(DMA1, USART1_RX_DMA_CHANNEL);
+  MS32_USART_ITConfig(USART1, MS32_USART_CR1_IDLEIE | MS32_USART_CR1_RTOIE | MS32_USART_CR3_EIE, 0x1);
+  MS32_USART_Enable(USART1);
+}
+
+/**
+  * @brief USART1 receive interrupt: idle line, receiver timeout and errors
+  * @param None
+  * @retval None
+  * @note call by USART1_IRQHandler()
+  */
+void USART1_RxDMA_IRQHandler(void)
+{
+  if (!MS32_USART_IsEnabledDMAReq_RX(USART1))
+  {
+    return;
+  }
+
+  if (MS32_USART_IsActiveFlag_ORE(USART1))
+  {
+    MS32_USART_ClearFlag_ORE(USART1);
+    RxStats.OverrunErrors++;
+  }
+  if (MS32_USART_IsActiveFlag_FE(USART1) || MS32_USART_IsActiveFlag_NE(USART1))
+  {
+    MS32_USART_ClearFlag_FE(USART1);
+    MS32_USART_ClearFlag_NE(USART1);
+  }
+
+  if (MS32_USART_IsActiveFlag_IDLE(USART1))
+  {
+    MS32_USART_ClearFlag_IDLE(USART1);
+    USART1_RxDMA_Sync();
+  }
+
+  if (MS32_USART_IsActiveFlag_RTO(USART1))
+  {
+    MS32_USART_ClearFlag_RTO(USART1);
+    USART1_RxDMA_Sync();
+
+    if (RxHead != LastFrameEnd)
+    {
+      if ((FrameIn - FrameOut) < USART1_RX_FRAME_DEPTH)
+      {
+        FrameEnd[FrameIn & RX_FRAME_MASK] = RxHead;
+        FrameIn++;
+        LastFrameEnd = RxHead;
+        LastFrameUs = SysTick_GetUs();
+        RxStats.Frames++;
+      }
+      else
+      {
+        /* bytes stay in the ring and join the next frame */
+        RxStats.FrameDrops++;
+      }
+    }
+  }
+}
+
+/**
+  * @brief DMA1 Channel5 half / complete transfer interrupt
+  * @param None
+  * @retval None
+  * @note call by DMA1_Channel4_5_IRQHandler()
+  */
+void USART1_RxDMA_DMA_IRQHandler(void)
+{
+  if (MS32_DMA_IsActiveFlag_HT5(DMA1) || MS32_DMA_IsActiveFlag_TC5(DMA1))
+  {
+    MS32_DMA_ClearFlag_HT5(DMA1);
+    MS32_DMA_ClearFlag_TC5(DMA1);
+    USART1_RxDMA_Sync();
+  }
+}
+
+/**
+  * @brief Copy out the oldest complete frame
+  * @param Buf destination buffer
+  * @param MaxLen size of Buf, longer frames are truncated and counted in
+  *        FrameTruncations
+  * @retval Number of bytes copied, 0 when no frame is ready or the frame
+  *         was overwritten before it was read
+  */
+uint16_t USART1_RxDMA_GetFrame(uint8_t *Buf, uint16_t MaxLen)
+{
+  uint32_t start;
+  uint32_t end;
+  uint32_t len;
+  uint32_t i;
+
+  if (FrameIn == FrameOut)
+  {
+    return 0;
+  }
+
+  start = RxTail;
+  end = FrameEnd[FrameOut & RX_FRAME_MASK];
+  len = end - start;
+  if (len > MaxLen)
+  {
+    len = MaxLen;
+    RxStats.FrameTruncations++;
+  }
+
+  for (i = 0; i < len; i++)
+  {
+    Buf[i] = RxRing[(start + i) & RX_RING_MASK];
+  }
+
+  RxTail = end;
+  FrameOut++;
+
+  /* DMA may have lapped the frame before or during the copy: the DMA
+     position is read again after it, RxHead may not be synced yet */
+  if ((USART1_RxDMA_HeadNow() - start) > USART1_RX_RING_SIZE)
+  {
+    RxStats.RingOverflows++;
+    return 0;
+  }
+
+  return (uint16_t)len;
+}
+
+/**
+  * @brief Copy out received bytes as a stream, frame bounds ignored
+  * @param Buf destination buffer
+  * @param MaxLen size of Buf, the bytes past it stay in the ring
+  * @retval Number of bytes copied, 0 when none is waiting or the ring was
+  *         lapped (the lost bytes are skipped and counted in RingOverflows)
+  * @note frames read through here are taken off the frame queue
+  */
+uint16_t USART1_RxDMA_Read(uint8_t *Buf, uint16_t MaxLen)
+{
+  uint32_t start = RxTail;
+  uint32_t head = USART1_RxDMA_HeadNow();
+  uint32_t len;
+  uint32_t i;
+
+  len = head - start;
+  if (len > MaxLen)
+  {
+    len = MaxLen;
+  }
+  for (i = 0; i < len; i++)
+  {
+    Buf[i] = RxRing[(start + i) & RX_RING_MASK];
+  }
+  RxTail = start + len;
+
+  /* DMA may have lapped the bytes before or during the copy */
+  head = USART1_RxDMA_HeadNow();
+  if ((head - start) > USART1_RX_RING_SIZE)
+  {
+    RxStats.RingOverflows++;
+    RxTail = head;
+    len = 0;
+  }
+
+  while ((FrameIn != FrameOut) && ((int32_t)(FrameEnd[FrameOut & RX_FRAME_MASK] - RxTail) <= 0))
+  {
+    FrameOut++;
+  }
+
+  return (uint16_t)len;
+}
+
+/**
+  * @brief Bytes received and not consumed yet (including an open frame)
+  * @param None
+  * @retval Number of bytes
+  */
+uint16_t USART1_RxDMA_Available(void)
+{
+  /* RxHead may be behind RxTail after a read of bytes not synced yet */
+  return (uint16_t)(USART1_RxDMA_HeadNow() - RxTail);
+}
+
+/**
+  * @brief Time the last frame was closed by the receiver timeout
+  * @param None
+  * @retval SysTick_GetUs() value, the line went idle USART1_RX_TIMEOUT_BITS
+  *         bit times earlier
+  */
+uint32_t USART1_RxDMA_GetFrameTime(void)
+{
+  return LastFrameUs;
+}
+
+/**
+  * @brief Read the receive statistics
+  * @param Stats pointer to a USART1_RxStatsTypeDef structure
+  * @retval None
+  */
+void USART1_RxDMA_GetStats(USART1_RxStatsTypeDef *Stats)
+{
+  __disable_irq();
+  *Stats = RxStats;
+  __enable_irq();
+}
+
+/******************************** END OF FILE *********************************/
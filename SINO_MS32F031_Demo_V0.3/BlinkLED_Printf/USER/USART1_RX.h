@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    USART1_RX.h
+  * @author  SINOMCU-AE
+  * @brief   Header file of USART1_RX.c file.
+  *
+  *          This file describes the USART1 DMA receive path:
+  *             USART1_RX ------> DMA1 Channel5 (circular)
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USART1_RX_H
+#define __USART1_RX_H
+
+/* Private includes ----------------------------------------------------------*/
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Receive ring size in bytes, must be a power of 2 */
+#define USART1_RX_RING_SIZE         128U
+/* Frame descriptors waiting for the application, must be a power of 2 */
+#define USART1_RX_FRAME_DEPTH       8U
+/* Line silence (in bit times) that closes a frame, 0x000000~0xFFFFFF */
+#define USART1_RX_TIMEOUT_BITS      20U
+
+#define USART1_RX_DMA_CHANNEL       MS32_DMA_CHANNEL_5
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t RxBytes;         /* bytes moved by DMA since init */
+  uint32_t Frames;          /* frames closed by receiver timeout */
+  uint32_t OverrunErrors;   /* USART ORE: a byte arrived before DMA read RDR */
+  uint32_t RingOverflows;   /* application read too late, DMA lapped the reader */
+  uint32_t FrameDrops;      /* frame closed while the descriptor queue was full */
+  uint32_t FrameTruncations;/* frame longer than the reader's buffer, tail dropped */
+} USART1_RxStatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions prototypes ---------------------------------------------*/
+void USART1_RxDMA_Init(void);
+uint16_t USART1_RxDMA_GetFrame(uint8_t *Buf, uint16_t MaxLen);
+uint16_t USART1_RxDMA_Read(uint8_t *Buf, uint16_t MaxLen);
+uint16_t USART1_RxDMA_Available(void);
+uint32_t USART1_RxDMA_GetFrameTime(void);
+void USART1_RxDMA_GetStats(USART1_RxStatsTypeDef *Stats);
+
+void USART1_RxDMA_IRQHandler(void);
+void USART1_RxDMA_DMA_IRQHandler(void);
+
+/* Private defines -----------------------------------------------------------*/
+
+#endif /* __USART1_RX_H */
+
+/******************************** END OF FILE *********************************/
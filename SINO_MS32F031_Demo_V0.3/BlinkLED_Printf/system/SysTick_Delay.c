@@ -27,6 +27,8 @@
 
 /* Variables -----------------------------------------------------------------*/
 static __IO uint32_t TimeDelayCnt;
+static __IO uint32_t TimeTickCnt;
+static uint32_t TickReload;       /* LOAD of a full 1ms period */
 
 
 /**
@@ -43,6 +45,7 @@ void SysTick_Init(void)
   { 
     while (1); 
   }
+  TickReload = SysTick->LOAD;
   
   NVIC_SetPriority(SysTick_IRQn, 0x3);
 }
@@ -55,6 +58,7 @@ void SysTick_Init(void)
   */
 void SysTickDelay_Decrement(void)
 {
+  TimeTickCnt++;
   if (TimeDelayCnt != 0x00)
   { 
     TimeDelayCnt--;
@@ -73,4 +77,91 @@ void SysTick_Ms(volatile uint32_t Cnt)
     while(TimeDelayCnt != 0);
 }
 
+/**
+  * @brief ms count since SysTick_Init()
+  * @param None
+  * @retval ms tick, wraps after 2^32 ms
+  */
+uint32_t SysTick_GetTick(void)
+{
+    return TimeTickCnt;
+}
+
+/**
+  * @brief us count since SysTick_Init(), for time stamps
+  * @param None
+  * @retval us, wraps after 2^32 us
+  * @note valid in interrupts that block SysTick_Handler(): a pending
+  *       SysTick with the counter already reloaded adds the missed 1ms
+  */
+uint32_t SysTick_GetUs(void)
+{
+    uint32_t tick;
+    uint32_t val;
+    uint32_t pend;
+
+    do
+    {
+        tick = TimeTickCnt;
+        val = SysTick->VAL;
+        pend = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    } while (tick != TimeTickCnt);
+
+    if ((pend != 0U) && (val > (TickReload >> 1)))
+    {
+        tick++;
+    }
+    return (tick * 1000U) + (((TickReload - val) * 1000U) / (TickReload + 1U));
+}
+
+/**
+  * @brief Keep the 1ms tick after HCLK has changed
+  * @param Hclk new HCLK in Hz, SystemCoreClock
+  * @retval None
+  * @note call with interrupts disabled, right after the clock switch.
+  *       The time left in the current period is rescaled to the new clock
+  *       (a one-off LOAD for the next reload), so the tick keeps its phase
+  *       and SysTick_GetUs() stays monotonic.
+  */
+void SysTick_Retime(uint32_t Hclk)
+{
+    uint32_t reload = (Hclk / 1000U) - 1U;
+    uint32_t left;
+
+    /* VAL <= 48000 and reload + 1 <= 48000, the product fits 32 bits */
+    left = (SysTick->VAL * (reload + 1U)) / (TickReload + 1U);
+    if (left < 2U)
+    {
+        left = 2U;
+    }
+
+    /* writing VAL reloads from LOAD on the next clock, without a tick */
+    SysTick->LOAD = left - 1U;
+    SysTick->VAL = 0;
+    __NOP();
+    __NOP();
+    SysTick->LOAD = reload;
+    TickReload = reload;
+}
+
+/**
+  * @brief Move the ms tick forward to an external time base
+  * @param Ms ms tick the time base gives now
+  * @retval ms added
+  * @note call with interrupts disabled, after STOP (SysTick stopped).
+  *       The tick never goes back: ahead of Ms it is left as it is and
+  *       the time base catches up during the next STOP.
+  */
+uint32_t SysTick_Resync(uint32_t Ms)
+{
+    uint32_t step = Ms - TimeTickCnt;
+
+    if ((int32_t)step <= 0)
+    {
+        return 0;
+    }
+    TimeTickCnt = Ms;
+    return step;
+}
+
 /******************************** END OF FILE *********************************/
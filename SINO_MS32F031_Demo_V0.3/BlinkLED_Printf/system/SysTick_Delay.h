@@ -32,6 +32,10 @@
 void SysTick_Init(void);
 void SysTickDelay_Decrement(void);
 void SysTick_Ms(volatile uint32_t Cnt);
+uint32_t SysTick_GetTick(void);
+uint32_t SysTick_GetUs(void);
+void SysTick_Retime(uint32_t Hclk);
+uint32_t SysTick_Resync(uint32_t Ms);
 
 void SysDelay_Init(void);
 void SysDelay_ms(volatile uint32_t Cnt);
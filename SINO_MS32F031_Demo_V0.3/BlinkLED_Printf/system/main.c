@@ -29,6 +29,190 @@
 /* LED blink half cycle in ms  */
 #define LED_BLINK_HALF_PRE  200 
 
+/* 1: USART1 runs the binary packet protocol (USART1_PKT) instead of printf */
+#define USART1_PKT_DEMO     0
+/* 1: USART1 runs a Modbus RTU slave on RS-485 (MODBUS_RTU) instead of printf */
+#define MODBUS_RTU_DEMO     0
+/* 1: USART1 runs a LIN slave node (LIN_SLAVE) instead of printf */
+#define LIN_SLAVE_DEMO      0
+/* 1: printf mode also runs a SPI1 DMA transaction every blink (CS on PA4) */
+#define SPI1_MASTER_DEMO    0
+/* 1: printf mode also streams a snapshot to a SPI1 host (SPI1_SLAVE), excludes SPI1_MASTER_DEMO */
+#define SPI1_SLAVE_DEMO     0
+/* 1: printf mode also reads 2 bytes of register 0 at I2C address 0x48 every blink,
+      DMA channels shared with SPI1, excludes SPI1_MASTER_DEMO and SPI1_SLAVE_DEMO */
+#define I2C1_MASTER_DEMO    0
+/* 1: printf mode also serves a register map at I2C address 0x30 (I2C1_SLAVE),
+      excludes I2C1_MASTER_DEMO and SPI1_MASTER_DEMO (DMA channel 2) */
+#define I2C1_SLAVE_DEMO     0
+/* 1: printf mode also runs a PMBus style SMBus device at address 0x40 (SMBUS_DEVICE),
+      excludes the other I2C1 demos */
+#define SMBUS_DEVICE_DEMO   0
+/* 1: printf mode also reads READ_VIN of the SMBus device at 0x40 every blink and
+      answers SMBALERT# (SMBUS_HOST), excludes the other I2C1 demos */
+#define SMBUS_HOST_DEMO     0
+/* 1: printf mode also switches SYSCLK between HSI 8MHz and PLL 48MHz every
+      CLOCK_SCALE_DEMO_BLINKS blinks (CLOCK_SCALE), printf baud and blink rate unchanged */
+#define CLOCK_SCALE_DEMO    0
+#define CLOCK_SCALE_DEMO_BLINKS 10
+/* 1: printf mode also supervises HSE (CLOCK_CSS): failover to the HSI PLL on a
+      HSE failure and back once it runs again; needs CLOCK_PLAN_SOURCE 1 or 2 */
+#define CLOCK_CSS_DEMO      0
+
+/* 1: printf mode also trims HSI against the reference of HSI_TRIM_REF (HSI_TRIM),
+      LSE by default */
+#define HSI_TRIM_DEMO       0
+/* 1: printf mode also sleeps through the blink delay (POWER_MGR, SLEEP) and every
+      POWER_MGR_DEMO_STOP_BLINKS blinks stops until a character arrives on USART1 */
+#define POWER_MGR_DEMO      0
+#define POWER_MGR_DEMO_STOP_BLINKS 10
+/* 1: printf mode also prints the time in each power mode and the estimated
+      charge (ENERGY) every blink; USART1_PKT mode always answers ENERGY_CMD_ID */
+#define ENERGY_DEMO         0
+/* 1: a RTC_WAKE job blinks and prints every RTC_WAKE_DEMO_PERIOD_MS, STOP in
+      between (RTC alarm), instead of the blink loop; needs LSE */
+#define RTC_WAKE_DEMO       0
+#define RTC_WAKE_DEMO_PERIOD_MS 10000
+/* 1: USART1_PKT mode also answers RTC_CAL_CMD_ID (host time sync, set RTC_CAL_REF
+      to 1); printf mode calibrates the RTC against HSE (RTC_CAL_REF 0, needs
+      CLOCK_PLAN_SOURCE 1 or 2) and prints the error and correction every blink */
+#define RTC_CAL_DEMO        0
+/* 1: journal RTC_TS edges and tamper events to flash (RTC_LOG); USART1_PKT mode
+      also answers RTC_LOG_CMD_ID, printf mode prints the counters every blink */
+#define RTC_LOG_DEMO        0
+/* 1: printf mode also prints the debounced events of a key on PA0 to ground
+      (EXTI_INPUT): press, release, long press, click, double click, pulse train */
+#define EXTI_INPUT_DEMO     0
+/* 1: printf mode also reads a quadrature encoder on PB4/PB5, index on PB0
+      (ENCODER) and prints position, speed and index checks every blink */
+#define ENCODER_DEMO        0
+/* 1: printf mode also time stamps both edges of PA2 by DMA (CAPTURE) and prints
+      frequency, duty and period jitter of the last batch every blink */
+#define CAPTURE_DEMO        0
+
+#if CLOCK_CSS_DEMO && (CLOCK_PLAN_SOURCE == 0)
+#error "CLOCK_CSS_DEMO needs a HSE clock plan (CLOCK_PLAN_SOURCE 1 or 2)"
+#endif
+#if RTC_CAL_DEMO && !USART1_PKT_DEMO && (RTC_CAL_REF == 0) && (CLOCK_PLAN_SOURCE == 0)
+#error "RTC_CAL_DEMO with RTC_CAL_REF 0 needs a HSE clock plan (CLOCK_PLAN_SOURCE 1 or 2)"
+#endif
+#if RTC_CAL_DEMO && HSI_TRIM_DEMO && (RTC_CAL_REF == 0)
+#error "RTC_CAL_REF 0 and HSI_TRIM_DEMO both use TIM14"
+#endif
+
+#if USART1_PKT_DEMO
+/* Packet commands on top of the USART1_PKT built-ins */
+static const USART1_PktCmdTypeDef PktCmdTable[] =
+{
+  {USART1_BAUD_CMD_ID, USART1_Baud_CmdHandler},
+  {ENERGY_CMD_ID, Energy_CmdHandler},
+#if RTC_CAL_DEMO
+  {RTC_CAL_CMD_ID, RtcCal_CmdHandler},
+#endif
+#if RTC_LOG_DEMO
+  {RTC_LOG_CMD_ID, RtcLog_CmdHandler},
+#endif
+};
+#endif
+
+#if LIN_SLAVE_DEMO
+/* ID 0x10 command from master: LED blink half cycle in 10ms, 0 stops blinking
+   ID 0x11 status to master: running count, LSB first */
+static uint8_t LinCmd[1] = {LED_BLINK_HALF_PRE / 10};
+static uint8_t LinStatus[4];
+static const LIN_FrameTypeDef LinFrameTable[] =
+{
+  {0x10, LIN_SUBSCRIBE, sizeof(LinCmd), LinCmd},
+  {0x11, LIN_PUBLISH, sizeof(LinStatus), LinStatus},
+};
+#endif
+
+#if SPI1_MASTER_DEMO
+static uint8_t SpiTx[4] = {0x9F, 0xFF, 0xFF, 0xFF};
+static uint8_t SpiRx[4];
+static SPI1_XferTypeDef SpiXfer = {GPIOA, MS32_GPIO_PIN_4, SpiTx, SpiRx, sizeof(SpiTx), 0, 0, SPI1_XFER_IDLE};
+#endif
+
+#if I2C1_MASTER_DEMO
+static const uint8_t I2cReg[1] = {0x00};
+static uint8_t I2cRx[2];
+static I2C1_XferTypeDef I2cXfer = {0x48, I2cReg, sizeof(I2cReg), I2cRx, sizeof(I2cRx), 0, 0, I2C1_XFER_IDLE};
+#endif
+
+#if SMBUS_DEVICE_DEMO
+/* PMBus commands, READ_VIN carries the running count */
+static uint8_t PmbOperation[1] = {0x80};
+static uint8_t PmbCapability[1] = {0x80};      /* PEC supported, 100kHz */
+static uint8_t PmbReadVin[2];
+static uint8_t PmbRevision[1] = {0x22};        /* part I 1.2, part II 1.2 */
+static uint8_t PmbMfrId[1 + 7] = {7, 'S', 'I', 'N', 'O', 'M', 'C', 'U'};
+static __IO uint8_t PmbFaultsCleared;
+
+static void Pmb_ClearFaults(const SMBus_CmdTypeDef *Cmd, uint8_t Len)
+{
+  PmbFaultsCleared = 1;
+}
+
+static const SMBus_CmdTypeDef SmbCmdTable[] =
+{
+  {0x01, SMBUS_BYTE,  SMBUS_RD | SMBUS_WR, 0, PmbOperation, 0},
+  {0x03, SMBUS_SEND,  SMBUS_WR, 0, 0, Pmb_ClearFaults},
+  {0x19, SMBUS_BYTE,  SMBUS_RD, 0, PmbCapability, 0},
+  {0x88, SMBUS_WORD,  SMBUS_RD, 0, PmbReadVin, 0},
+  {0x98, SMBUS_BYTE,  SMBUS_RD, 0, PmbRevision, 0},
+  {0x99, SMBUS_BLOCK, SMBUS_RD, 7, PmbMfrId, 0},
+};
+#endif
+
+#if SMBUS_HOST_DEMO
+static uint8_t SmbVin[2];
+static uint8_t SmbAra[1];
+static SMBus_HostXferTypeDef SmbVinXfer = {0x40, 0x88, SMBUS_WORD, 1, SmbVin, 0, SMBUS_XFER_IDLE};
+static SMBus_HostXferTypeDef SmbAraXfer = {SMBUS_ARA, 0, SMBUS_RECEIVE, 1, SmbAra, 0, SMBUS_XFER_IDLE};
+#endif
+
+#if RTC_WAKE_DEMO
+static void RtcWake_DemoJob(void)
+{
+  LED1_TOGGLE();
+  LED2_TOGGLE();
+}
+#endif
+
+#if EXTI_INPUT_DEMO
+static void ExtiInput_DemoEvent(uint8_t Pin, uint8_t Event, uint8_t Count)
+{
+  static const char *const name[] = {"press", "release", "long", "click", "double", "train"};
+
+  printf("\r\n-----key PA%d:%s %d", Pin, name[Event], Count);
+}
+
+static const ExtiInput_PinTypeDef KeyTable[] =
+{
+  {GPIOA, 0, 1, ExtiInput_DemoEvent},
+};
+#endif
+
+/**
+  * @brief  SystemInit() entry: startup time line from 0, saved HSI trim
+  *         before anything runs from HSI
+  * @note   before the scatter loading, registers and flash only
+  */
+void SystemInit_EarlyHook(void)
+{
+  StartupTime_Begin();
+  HsiTrim_Restore();
+}
+
+/**
+  * @brief  SystemInit() clock switch done (or HSE timeout)
+  * @param  TimerClk TIM17 kernel clock in Hz from now on
+  */
+void SystemInit_ClockReadyHook(uint32_t TimerClk)
+{
+  StartupTime_ClockReady(TimerClk);
+}
+
 /**
   * @brief  Retargets the C library printf function to the USART.
   * @param  
@@ -56,23 +240,512 @@ int fputc(int ch, FILE *f)
 int main(void) 
 {
     uint32_t count=0;
+#if USART1_PKT_DEMO
+    uint32_t tick;
+    uint8_t *telemetry;
+#elif MODBUS_RTU_DEMO || LIN_SLAVE_DEMO
+    uint32_t tick;
+#elif RTC_WAKE_DEMO
+    uint32_t runs = 0;
+    RtcWake_StatsTypeDef rtc_stats;
+    RtcTime_StampTypeDef stamp;
+#else
+    uint8_t frame[32];
+    uint16_t len;
+    StartupTime_TypeDef boot;
+#if SPI1_MASTER_DEMO
+    SPI1_MasterStatsTypeDef spi_stats;
+#endif
+#if SPI1_SLAVE_DEMO
+    uint8_t *snapshot;
+#endif
+#if I2C1_MASTER_DEMO
+    I2C1_MasterStatsTypeDef i2c_stats;
+#endif
+#if I2C1_SLAVE_DEMO
+    uint8_t *regs;
+    uint32_t writes;
+#endif
+#if SMBUS_DEVICE_DEMO
+    SMBus_DeviceStatsTypeDef smb_dev_stats;
+#endif
+#if SMBUS_HOST_DEMO
+    SMBus_HostStatsTypeDef smb_host_stats;
+#endif
+#if CLOCK_SCALE_DEMO
+    ClockScale_StatsTypeDef scale_stats;
+#endif
+#if CLOCK_CSS_DEMO
+    ClockCss_StatsTypeDef css_stats;
+#endif
+#if HSI_TRIM_DEMO
+    HsiTrim_StatsTypeDef trim_stats;
+#endif
+#if POWER_MGR_DEMO || EXTI_INPUT_DEMO || ENCODER_DEMO
+    uint32_t start;
+#endif
+#if POWER_MGR_DEMO
+    PowerMgr_StatsTypeDef power_stats;
+#endif
+#if EXTI_INPUT_DEMO
+    ExtiInput_StatsTypeDef key_stats;
+#endif
+#if ENCODER_DEMO
+    Encoder_StatsTypeDef enc_stats;
+#endif
+#if CAPTURE_DEMO
+    Capture_ResultTypeDef cap_result;
+    Capture_StatsTypeDef cap_stats;
+#endif
+#if ENERGY_DEMO
+    Energy_ReportTypeDef energy;
+#endif
+#if RTC_CAL_DEMO
+    RtcCal_StatsTypeDef cal_stats;
+#endif
+#if RTC_LOG_DEMO
+    RtcLog_StatsTypeDef log_stats;
+#endif
+#endif
   
+    StartupTime_Mark(STARTUP_PHASE_MAIN);
+    /* the STARTUP_DMAZERO variables clear meanwhile, none is used before
+       StartupTime_ZeroWait() */
+    StartupTime_ZeroStart();
+    /* SystemInit() may have stayed on HSI (HSE timeout), SystemCoreClock
+       holds the planned value again after the scatter loading */
+    SystemCoreClockUpdate();
     SysTick_Init();
     GPIO_Initialization();
     USART1_UART_Init();
+#if !LIN_SLAVE_DEMO
+    /* LIN_SLAVE takes every byte by RXNE */
+    USART1_RxDMA_Init();
+#endif
+    StartupTime_ZeroWait();
+    StartupTime_Mark(STARTUP_PHASE_PERIPH);
+    StartupTime_End();
   
+#if USART1_PKT_DEMO
+    USART1_Pkt_Init(PktCmdTable, sizeof(PktCmdTable) / sizeof(PktCmdTable[0]));
+    Energy_Init();
+#if RTC_CAL_DEMO || RTC_LOG_DEMO
+    RtcWake_Init();
+#endif
+#if RTC_CAL_DEMO
+    RtcCal_Init();
+#endif
+#if RTC_LOG_DEMO
+    RtcLog_Init();
+#endif
+    LED1_ON(); 
+    LED2_OFF(); 
+    tick = SysTick_GetTick();
+    
+    while(1) 
+    {
+        USART1_Pkt_Poll();
+        USART1_Baud_Poll();
+#if RTC_CAL_DEMO
+        RtcCal_Poll();
+#endif
+#if RTC_LOG_DEMO
+        RtcLog_Poll();
+#endif
+        
+        if((SysTick_GetTick() - tick) >= LED_BLINK_HALF_PRE)
+        {
+            tick += LED_BLINK_HALF_PRE;
+            LED1_TOGGLE();
+            LED2_TOGGLE();
+            count++;
+            
+            /* telemetry stream 0: running count, built in the DMA buffer */
+            telemetry = USART1_Pkt_GetTelemetryBuffer();
+            if(telemetry != 0)
+            {
+                telemetry[0] = (uint8_t)count;
+                telemetry[1] = (uint8_t)(count >> 8);
+                telemetry[2] = (uint8_t)(count >> 16);
+                telemetry[3] = (uint8_t)(count >> 24);
+                USART1_Pkt_SendTelemetry(0, 4);
+            }
+        }
+    }
+#elif MODBUS_RTU_DEMO
+    Modbus_RTU_Init();
+    Modbus_HoldingRegs[0] = LED_BLINK_HALF_PRE;
+    LED1_ON(); 
+    LED2_OFF(); 
+    tick = SysTick_GetTick();
+    
+    while(1) 
+    {
+        Modbus_RTU_Poll();
+        
+        /* holding register 0: LED blink half cycle in ms, 0 stops blinking */
+        if((Modbus_HoldingRegs[0] != 0) && ((SysTick_GetTick() - tick) >= Modbus_HoldingRegs[0]))
+        {
+            tick = SysTick_GetTick();
+            LED1_TOGGLE();
+            LED2_TOGGLE();
+            count++;
+            
+            /* input register 0/1: running count low/high word */
+            Modbus_InputRegs[0] = (uint16_t)count;
+            Modbus_InputRegs[1] = (uint16_t)(count >> 16);
+        }
+    }
+#elif LIN_SLAVE_DEMO
+    LIN_Slave_Init(LinFrameTable, sizeof(LinFrameTable) / sizeof(LinFrameTable[0]));
+#if LIN_SLAVE_HSI_TRIM
+    HsiTrim_Init();
+#endif
+    LED1_ON(); 
+    LED2_OFF(); 
+    tick = SysTick_GetTick();
+    
+    while(1) 
+    {
+        if((LinCmd[0] != 0) && ((SysTick_GetTick() - tick) >= (LinCmd[0] * 10U)))
+        {
+            tick = SysTick_GetTick();
+            LED1_TOGGLE();
+            LED2_TOGGLE();
+            count++;
+            
+            /* published from the USART interrupt, update as a whole */
+            __disable_irq();
+            LinStatus[0] = (uint8_t)count;
+            LinStatus[1] = (uint8_t)(count >> 8);
+            LinStatus[2] = (uint8_t)(count >> 16);
+            LinStatus[3] = (uint8_t)(count >> 24);
+            __enable_irq();
+        }
+#if LIN_SLAVE_HSI_TRIM
+        HsiTrim_Poll();
+#endif
+    }
+#elif RTC_WAKE_DEMO
+    LED1_ON(); 
+    LED2_OFF(); 
+    if(RtcWake_Init() != SUCCESS)
+    {
+        printf("\r\n-----rtc: no LSE");
+    }
+    RtcWake_Start(0, RTC_WAKE_DEMO_PERIOD_MS, RtcWake_DemoJob);
+    
+    while(1) 
+    {
+        RtcWake_Run();
+        count++;
+        
+        RtcWake_GetStats(&rtc_stats);
+        if(rtc_stats.Runs != runs)
+        {
+            runs = rtc_stats.Runs;
+            if(RtcTime_Get(&stamp))
+            {
+                printf("\r\n-----rtc time:%u.%03u",stamp.Seconds,(stamp.SubTicks * 1000U) / RTC_WAKE_TICK_HZ);
+            }
+            printf("\r\n-----rtc job:%d at %dms, %d wakes, %d stops (%d alarm), resync %dms, late %dms (max %dms)",
+                   runs,SysTick_GetTick(),count,rtc_stats.Stops,rtc_stats.AlarmWakes,rtc_stats.ResyncMs,
+                   rtc_stats.LastLateMs,rtc_stats.MaxLateMs);
+            /* last character out before STOP */
+            while(!MS32_USART_IsActiveFlag_TC(USART1));
+        }
+    }
+#else
     LED1_ON(); 
     LED2_OFF(); 
     printf("\r\n*****UART Example*****\r\n");
+    StartupTime_Get(&boot);
+    printf("\r\n-----startup: clock %dus, main %dus, periph %dus",
+           boot.PhaseUs[STARTUP_PHASE_CLOCK],boot.PhaseUs[STARTUP_PHASE_MAIN],boot.PhaseUs[STARTUP_PHASE_PERIPH]);
+#if SPI1_SLAVE_DEMO
+    if (SPI1_Slave_Init() != SUCCESS)
+    {
+        printf("\r\n-----SPI1 slave: EXTI line 4 in use");
+    }
+#endif
+#if SPI1_MASTER_DEMO
+    SPI1_Master_Init();
+    SPI1_Master_ConfigCS(GPIOA, MS32_GPIO_PIN_4);
+#endif
+#if I2C1_MASTER_DEMO
+    I2C1_Master_Init();
+#endif
+#if I2C1_SLAVE_DEMO
+    I2C1_Slave_Init();
+#endif
+#if SMBUS_DEVICE_DEMO
+    SMBus_Device_Init(SmbCmdTable, sizeof(SmbCmdTable) / sizeof(SmbCmdTable[0]));
+#endif
+#if SMBUS_HOST_DEMO
+    SMBus_Host_Init();
+#endif
+#if CLOCK_SCALE_DEMO || CLOCK_CSS_DEMO
+    ClockScale_Register(USART1_Baud_ClockCallback);
+#if I2C1_MASTER_DEMO
+    ClockScale_Register(I2C1_Master_ClockCallback);
+#endif
+#endif
+#if CLOCK_CSS_DEMO
+    ClockCss_Init();
+#endif
+#if HSI_TRIM_DEMO
+    HsiTrim_Init();
+#endif
+#if ENERGY_DEMO
+    Energy_Init();
+#endif
+#if RTC_CAL_DEMO || RTC_LOG_DEMO
+    if(RtcWake_Init() != SUCCESS)
+    {
+        printf("\r\n-----rtc: no LSE");
+    }
+#endif
+#if RTC_CAL_DEMO
+    RtcCal_Init();
+#endif
+#if RTC_LOG_DEMO
+    RtcLog_Init();
+#endif
+#if EXTI_INPUT_DEMO
+    ExtiInput_Init(KeyTable, sizeof(KeyTable) / sizeof(KeyTable[0]));
+#endif
+#if ENCODER_DEMO
+    Encoder_Init();
+#endif
+#if CAPTURE_DEMO
+    Capture_Init();
+#endif
+#if POWER_MGR_DEMO
+    PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_SLEEP);
+    PowerMgr_EnableUsartWake();
+#endif
   
     while(1) 
     {
+#if POWER_MGR_DEMO || EXTI_INPUT_DEMO || ENCODER_DEMO
+        start = SysTick_GetTick();
+        while((SysTick_GetTick() - start) < LED_BLINK_HALF_PRE)
+        {
+#if EXTI_INPUT_DEMO
+            ExtiInput_Poll();
+#endif
+#if ENCODER_DEMO
+            Encoder_Poll();
+#endif
+#if POWER_MGR_DEMO
+            PowerMgr_Idle();
+#endif
+        }
+#else
         SysTick_Ms(LED_BLINK_HALF_PRE);
+#endif
         LED1_TOGGLE();
         LED2_TOGGLE();
         count++;
         printf("\r\n-----running count:%d",count);
+        
+        while((len = USART1_RxDMA_GetFrame(frame, sizeof(frame))) != 0)
+        {
+            printf("\r\n-----rx frame:%d bytes",len);
+        }
+#if SPI1_SLAVE_DEMO
+        /* snapshot: running count and ms tick, LSB first */
+        snapshot = SPI1_Slave_BeginPublish();
+        snapshot[0] = (uint8_t)count;
+        snapshot[1] = (uint8_t)(count >> 8);
+        snapshot[2] = (uint8_t)(count >> 16);
+        snapshot[3] = (uint8_t)(count >> 24);
+        snapshot[4] = (uint8_t)SysTick_GetTick();
+        snapshot[5] = (uint8_t)(SysTick_GetTick() >> 8);
+        snapshot[6] = (uint8_t)(SysTick_GetTick() >> 16);
+        snapshot[7] = (uint8_t)(SysTick_GetTick() >> 24);
+        SPI1_Slave_EndPublish();
+#endif
+#if SPI1_MASTER_DEMO
+        if(SpiXfer.Status != SPI1_XFER_QUEUED && SpiXfer.Status != SPI1_XFER_ACTIVE)
+        {
+            SPI1_Master_Submit(&SpiXfer);
+        }
+        SPI1_Master_GetStats(&spi_stats);
+        printf("\r\n-----spi:%d xfers, busy %dus, wire %dus, err %d",spi_stats.Transfers,spi_stats.BusyUs,spi_stats.WireUs,spi_stats.Errors);
+#endif
+#if I2C1_MASTER_DEMO
+        I2C1_Master_Poll();
+        if(I2cXfer.Status != I2C1_XFER_QUEUED && I2cXfer.Status != I2C1_XFER_ACTIVE)
+        {
+            if(I2cXfer.Status == I2C1_XFER_DONE)
+            {
+                printf("\r\n-----i2c reg0:0x%02X%02X",I2cRx[0],I2cRx[1]);
+            }
+            I2C1_Master_Submit(&I2cXfer);
+        }
+        I2C1_Master_GetStats(&i2c_stats);
+        printf("\r\n-----i2c:%d xfers, %d bytes, busy %dus, nack %d, err %d, recover %d",
+               i2c_stats.Transfers,i2c_stats.Bytes,i2c_stats.BusyUs,i2c_stats.Nacks,i2c_stats.Errors,i2c_stats.Recoveries);
+#endif
+#if I2C1_SLAVE_DEMO
+        /* read-only registers 8~15: running count and ms tick, LSB first */
+        regs = I2C1_Slave_BeginUpdate();
+        regs[8] = (uint8_t)count;
+        regs[9] = (uint8_t)(count >> 8);
+        regs[10] = (uint8_t)(count >> 16);
+        regs[11] = (uint8_t)(count >> 24);
+        regs[12] = (uint8_t)SysTick_GetTick();
+        regs[13] = (uint8_t)(SysTick_GetTick() >> 8);
+        regs[14] = (uint8_t)(SysTick_GetTick() >> 16);
+        regs[15] = (uint8_t)(SysTick_GetTick() >> 24);
+        I2C1_Slave_EndUpdate();
+        
+        /* read-write registers 0~7: report master writes */
+        writes = I2C1_Slave_TakeWrites();
+        if(writes != 0)
+        {
+            I2C1_Slave_Read(0, frame, I2C1_SLAVE_RW_SIZE);
+            printf("\r\n-----i2c write mask 0x%02X, reg0:0x%02X",writes,frame[0]);
+        }
+#endif
+#if SMBUS_DEVICE_DEMO
+        __disable_irq();
+        PmbReadVin[0] = (uint8_t)count;
+        PmbReadVin[1] = (uint8_t)(count >> 8);
+        __enable_irq();
+        /* SMBALERT# every 16 blinks, released by the host ARA read */
+        if((count & 0x0F) == 0)
+        {
+            SMBus_Device_RaiseAlert();
+        }
+        if(PmbFaultsCleared != 0)
+        {
+            PmbFaultsCleared = 0;
+            printf("\r\n-----smbus CLEAR_FAULTS");
+        }
+        SMBus_Device_GetStats(&smb_dev_stats);
+        printf("\r\n-----smbus:%d wr, %d rd, pec err %d, timeout %d, bad cmd %d, ara %d, dispatch max %dus, operation 0x%02X",
+               smb_dev_stats.Writes,smb_dev_stats.Reads,smb_dev_stats.PecErrors,smb_dev_stats.Timeouts,
+               smb_dev_stats.BadCommands,smb_dev_stats.AlertResponses,smb_dev_stats.MaxDispatchUs,PmbOperation[0]);
+#endif
+#if SMBUS_HOST_DEMO
+        if(SMBus_Host_IsIdle())
+        {
+            if(SmbVinXfer.Status == SMBUS_XFER_DONE)
+            {
+                SmbVinXfer.Status = SMBUS_XFER_IDLE;
+                printf("\r\n-----smbus READ_VIN:0x%02X%02X",SmbVin[1],SmbVin[0]);
+            }
+            if(SmbAraXfer.Status == SMBUS_XFER_DONE)
+            {
+                SmbAraXfer.Status = SMBUS_XFER_IDLE;
+                printf("\r\n-----smbus alert from 0x%02X",SmbAra[0] >> 1);
+            }
+            /* SMBALERT# first: the alerting device answers the ARA read */
+            if(SMBus_Host_TakeAlert())
+            {
+                SMBus_Host_Submit(&SmbAraXfer);
+            }
+            else
+            {
+                SMBus_Host_Submit(&SmbVinXfer);
+            }
+        }
+        SMBus_Host_GetStats(&smb_host_stats);
+        printf("\r\n-----smbus:%d xfers, nack %d, pec err %d, timeout %d, err %d, alert %d",
+               smb_host_stats.Transfers,smb_host_stats.Nacks,smb_host_stats.PecErrors,
+               smb_host_stats.Timeouts,smb_host_stats.Errors,smb_host_stats.Alerts);
+#endif
+#if CLOCK_SCALE_DEMO
+        if((count % CLOCK_SCALE_DEMO_BLINKS) == 0)
+        {
+            ClockScale_Set((ClockScale_Get() == CLOCK_SCALE_HIGH) ? CLOCK_SCALE_LOW : CLOCK_SCALE_HIGH);
+            ClockScale_GetStats(&scale_stats);
+            printf("\r\n-----clock:%dHz tick %dms, %d switches, last %dus (blackout %dus), max %dus (blackout %dus)",
+                   SystemCoreClock,SysTick_GetTick(),scale_stats.Switches,scale_stats.LastUs,
+                   scale_stats.LastBlackoutUs,scale_stats.MaxUs,scale_stats.MaxBlackoutUs);
+        }
+#endif
+#if CLOCK_CSS_DEMO
+        ClockCss_Poll();
+        ClockCss_GetStats(&css_stats);
+        if(css_stats.Failovers != 0)
+        {
+            printf("\r\n-----hse:state %d, clock %dHz, %d failovers (last %dus), %d retries, %d restores, down last %dms total %dms",
+                   ClockCss_GetState(),SystemCoreClock,css_stats.Failovers,css_stats.LastFailoverUs,
+                   css_stats.Retries,css_stats.Restores,css_stats.LastDownMs,css_stats.TotalDownMs);
+        }
+#endif
+#if HSI_TRIM_DEMO
+        HsiTrim_Poll();
+        HsiTrim_GetStats(&trim_stats);
+        printf("\r\n-----hsi trim:%d, error %dppm, %d measurements, %d adjusts, settled %d, %d saves",
+               trim_stats.Trim,trim_stats.LastErrorPpm,trim_stats.Measurements,trim_stats.Adjusts,
+               trim_stats.Settled,trim_stats.Saves);
+#endif
+#if POWER_MGR_DEMO
+        if((count % POWER_MGR_DEMO_STOP_BLINKS) == 0)
+        {
+            printf("\r\n-----stop, a character on USART1 wakes");
+            while(!MS32_USART_IsActiveFlag_TC(USART1));
+            PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_STOP);
+            PowerMgr_Idle();
+            PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_SLEEP);
+            PowerMgr_GetStats(&power_stats);
+            printf("\r\n-----power:%d sleeps, %d stops, usart wake %d (last %dus, max %dus), restore fails %d",
+                   power_stats.Entries[POWER_MGR_SLEEP],power_stats.Entries[POWER_MGR_STOP],
+                   power_stats.Wakes[POWER_MGR_WAKE_USART1],power_stats.LastWakeUs[POWER_MGR_WAKE_USART1],
+                   power_stats.MaxWakeUs[POWER_MGR_WAKE_USART1],power_stats.RestoreFails);
+        }
+#endif
+#if ENERGY_DEMO
+        Energy_GetReport(&energy);
+        printf("\r\n-----energy:run %dms, sleep %dms, stop %dms (untimed %d), %duAh, average %duA",
+               energy.StateMs[POWER_MGR_RUN],energy.StateMs[POWER_MGR_SLEEP],
+               energy.StateMs[POWER_MGR_STOP] + energy.StateMs[POWER_MGR_STOP_LP],
+               energy.StopUntimed,energy.ChargeUAh,energy.AverageUA);
+#endif
+#if RTC_CAL_DEMO
+        RtcCal_Poll();
+        RtcCal_GetStats(&cal_stats);
+        printf("\r\n-----rtc cal:error %dppb, correction %dppb, %d measurements, %d writes, overcaptures %d",
+               cal_stats.LastErrorPpb,cal_stats.CorrPpb,cal_stats.Measurements,cal_stats.Writes,
+               cal_stats.Overcaptures);
+#endif
+#if RTC_LOG_DEMO
+        RtcLog_Poll();
+        RtcLog_GetStats(&log_stats);
+        printf("\r\n-----rtc log:%d events, %d records, %d bytes, %d erases, drops %d, lost %d, errors %d",
+               log_stats.Events,log_stats.Records,log_stats.BytesWritten,log_stats.Erases,
+               log_stats.Drops,log_stats.HwLost,log_stats.SaveErrors);
+#endif
+#if EXTI_INPUT_DEMO
+        ExtiInput_GetStats(&key_stats);
+        printf("\r\n-----key:%d edges, %d bounces, %d events, isr %d cycles (max %d)",
+               key_stats.Edges,key_stats.Bounces,key_stats.Events,key_stats.IsrCycles,
+               key_stats.IsrCyclesMax);
+#endif
+#if ENCODER_DEMO
+        Encoder_GetStats(&enc_stats);
+        printf("\r\n-----encoder:position %d, speed %d counts/s, index %d (errors %d, last %d), update %d cycles (max %d)",
+               (int32_t)Encoder_GetPosition(),Encoder_GetSpeed() >> ENCODER_SPEED_SHIFT,enc_stats.IndexPulses,
+               enc_stats.IndexErrors,enc_stats.LastIndexError,enc_stats.UpdateCycles,enc_stats.UpdateCyclesMax);
+#endif
+#if CAPTURE_DEMO
+        Capture_GetStats(&cap_stats);
+        if (Capture_GetResult(&cap_result) == SUCCESS)
+        {
+            printf("\r\n-----capture:%d.%03d Hz, duty %d.%02d%%, period %d~%d, jitter %d clocks",
+                   cap_result.FreqMilliHz / 1000,cap_result.FreqMilliHz % 1000,cap_result.DutyBp / 100,
+                   cap_result.DutyBp % 100,cap_result.PeriodMin,cap_result.PeriodMax,cap_result.JitterRms);
+        }
+        printf("\r\n-----capture:%d edges, %d batches, overcaptures %d, overruns %d, batch %d cycles (max %d)",
+               cap_stats.Edges,cap_stats.Batches,cap_stats.Overcaptures,cap_stats.Overruns,
+               cap_stats.BatchCycles,cap_stats.BatchCyclesMax);
+#endif
     }
+#endif
 }
 
 /******************************** END OF FILE *********************************/
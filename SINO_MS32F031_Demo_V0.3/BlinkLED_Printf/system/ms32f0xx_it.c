@@ -36,10 +36,10 @@
   * @param  None
   * @retval None
   */
-// void NMI_Handler (void) 
-// {
-    
-// }
+void NMI_Handler (void) 
+{
+    ClockCss_NMI_IRQHandler();
+}
 
 /**
   * @brief  This function handles Hard Fault exception.
@@ -91,13 +91,65 @@ void SysTick_Handler(void)
 /******************************************************************************/
 
 
+/**
+  * @brief This function handles RTC.
+  */
+void RTC_IRQHandler(void)
+{
+    RtcWake_IRQHandler();
+    RtcLog_IRQHandler();
+}
+
+/**
+  * @brief This function handles EXTI0_1.
+  */
+void EXTI0_1_IRQHandler(void)
+{
+    ExtiInput_IRQHandler();
+}
+
+/**
+  * @brief This function handles EXTI2_3.
+  */
+void EXTI2_3_IRQHandler(void)
+{
+    ExtiInput_IRQHandler();
+}
+
+/**
+  * @brief This function handles EXTI4_15.
+  */
+void EXTI4_15_IRQHandler(void)
+{
+    SPI1_Slave_EXTI_IRQHandler();
+    ExtiInput_IRQHandler();
+}
+
 /**
   * @brief This function handles DMA1_Channel1.
   */
-// void DMA1_Channel1_IRQHandler(void) 
-// {
-    
-// }
+void DMA1_Channel1_IRQHandler(void)
+{
+    Capture_DMA_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA1_Channel2_3.
+  */
+void DMA1_Channel2_3_IRQHandler(void)
+{
+    I2C1_Slave_DMA_IRQHandler();
+    SPI1_Master_DMA_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA1_Channel4_5.
+  */
+void DMA1_Channel4_5_IRQHandler(void)
+{
+    USART1_RxDMA_DMA_IRQHandler();
+    USART1_Pkt_DMA_IRQHandler();
+}
 
 /**
   * @brief This function handles ADC1 comp.
@@ -134,18 +186,40 @@ void SysTick_Handler(void)
 /**
   * @brief This function handles Timer3.
   */
-// void TIM3_IRQHandler(void)
-// {
-    
-// }
+void TIM3_IRQHandler(void)
+{
+    Encoder_TIM3_IRQHandler();
+}
+
+/**
+  * @brief This function handles Timer14.
+  */
+void TIM14_IRQHandler(void)
+{
+    HsiTrim_TIM14_IRQHandler();
+    RtcCal_TIM14_IRQHandler();
+}
 
 /**
   * @brief This function handles USART1.
   */
-// void USART1_IRQHandler(void)
-// {
-    
-// }
+void USART1_IRQHandler(void)
+{
+    LIN_Slave_IRQHandler();
+    USART1_RxDMA_IRQHandler();
+    PowerMgr_USART1_IRQHandler();
+}
+
+/**
+  * @brief This function handles I2C1.
+  */
+void I2C1_IRQHandler(void)
+{
+    I2C1_Slave_IRQHandler();
+    I2C1_Master_IRQHandler();
+    SMBus_Device_IRQHandler();
+    SMBus_Host_IRQHandler();
+}
 
 /**
   * @brief  This function handles PPP interrupt request.
@@ -29,6 +29,30 @@
 
 #include "GPIO_CFG.h"
 #include "USART1_CFG.h"
+#include "USART1_RX.h"
+#include "USART1_PKT.h"
+#include "USART1_BAUD.h"
+#include "MODBUS_RTU.h"
+#include "LIN_SLAVE.h"
+#include "SPI1_MASTER.h"
+#include "SPI1_SLAVE.h"
+#include "I2C1_MASTER.h"
+#include "I2C1_SLAVE.h"
+#include "SMBUS_DEVICE.h"
+#include "SMBUS_HOST.h"
+#include "CLOCK_SCALE.h"
+#include "CLOCK_CSS.h"
+#include "HSI_TRIM.h"
+#include "POWER_MGR.h"
+#include "ENERGY.h"
+#include "RTC_WAKE.h"
+#include "RTC_CAL.h"
+#include "RTC_TIME.h"
+#include "RTC_LOG.h"
+#include "EXTI_INPUT.h"
+#include "ENCODER.h"
+#include "CAPTURE.h"
+#include "STARTUP_TIME.h"
 
 #include "SysTick_Delay.h"
 #include "ms32f0xx_it.h"
@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file    host_test.h
+  * @author  SINOMCU-AE
+  * @brief   Checks for the host tests.
+  *
+  *          The host tests build the hardware independent functions of the
+  *          USER modules with the PC compiler (see Makefile); a module is
+  *          included as source, only the functions a test calls are linked.
+  *          A test that runs register code points the peripheral macro
+  *          (USART1, ...) at a RAM copy of the register block.
+  *
+	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOST_TEST_H
+#define __HOST_TEST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+
+/* Exported macro ------------------------------------------------------------*/
+static int HostTestFails;
+static int HostTestChecks;
+
+#define CHECK(cond)                                                           \
+  do                                                                          \
+  {                                                                           \
+    HostTestChecks++;                                                         \
+    if (!(cond))                                                              \
+    {                                                                         \
+      HostTestFails++;                                                        \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);         \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                        \
+  do                                                                          \
+  {                                                                           \
+    long long va_ = (long long)(a);                                           \
+    long long vb_ = (long long)(b);                                           \
+    HostTestChecks++;                                                         \
+    if (va_ != vb_)                                                           \
+    {                                                                         \
+      HostTestFails++;                                                        \
+      printf("%s:%d: %s = %lld, expected %lld\n", __FILE__, __LINE__, #a,     \
+             va_, vb_);                                                       \
+    }                                                                         \
+  } while (0)
+
+/* Cortex-M0 instructions of the module sources, include after the device
+   header (it defines the CMSIS versions) and before the module source */
+#undef __disable_irq
+#define __disable_irq()             ((void)0)
+#undef __enable_irq
+#define __enable_irq()              ((void)0)
+#undef __WFI
+#define __WFI()                     ((void)0)
+#undef __DSB
+#define __DSB()                     ((void)0)
+#undef __ISB
+#define __ISB()                     ((void)0)
+#undef __NOP
+#define __NOP()                     ((void)0)
+
+/* summary line, exit status of main() */
+#define HOST_TEST_END()                                                       \
+  (printf("%s: %d checks, %d failed\n", __FILE__, HostTestChecks,             \
+          HostTestFails), (HostTestFails != 0))
+
+#endif /* __HOST_TEST_H */
+
+/******************************** END OF FILE *********************************/
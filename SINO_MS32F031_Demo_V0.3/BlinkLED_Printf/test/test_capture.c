@@ -0,0 +1,595 @@
+/**
+  ******************************************************************************
+  * @file 		test_capture.c
+	* @author		SINOMCU-AE
+  * @brief 		Host edge sequence test of the DMA input capture
+  *
+  *          CAPTURE.c runs on RAM copies of the RCC, TIM2, DMA1, GPIOA and
+  *          SysTick registers. A signal generator makes the edges of PA2:
+  *          each toggles the pin level, latches its 48MHz TIM2 time in CCR3
+  *          (CC3OF if the last one was not taken yet) and the DMA model
+  *          moves CCR3 into the ring, counting the channel down and setting
+  *          HT and TC as the circular channel does. The DMA interrupt runs
+  *          at once unless held. GPIOA and the DMA length are reached
+  *          through functions that count the accesses, so an edge can come
+  *          between the level reads of a restart and the DMA can move on
+  *          while a batch is read. The time starts 2s before the 32 bit
+  *          TIM2 wrap.
+  *          Checked: every batch published at 1kHz ~ 2MHz (up to 4M edges/s,
+  *          far beyond an interrupt per edge) for the period count,
+  *          frequency, duty, shortest and longest period and jitter, across
+  *          the TIM2 wrap and the ring wrap; jitter of a known size; the
+  *          parity from the pin level at the start and after each restart;
+  *          an edge lost while the DMA was held; the interrupt late by 31
+  *          and 32 edges after the half and after the complete flag; the
+  *          DMA moving by 31 and 32 edges while a batch is read; an edge
+  *          during the restart. The results and the host time of one batch
+  *          are printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static TIM_TypeDef HostTim2;
+static DMA_TypeDef HostDma;
+static GPIO_TypeDef HostGpioA;
+static SysTick_Type HostSysTick;
+
+/* DMA1 channel 1 */
+static uint8_t HostDmaOn;
+static uint32_t HostDmaNdt;
+static uint32_t HostDmaIsr;
+static uint32_t HostDmaIe;
+
+static uint32_t GpioAccesses;
+static uint32_t EdgeAtGpio;     /* an edge at this GPIOA access, 0: never */
+static uint32_t DmaLenAccesses;
+static uint32_t EdgesAtLen;     /* edges before this DMA length read, 0: never */
+static uint32_t EdgesAtLenN;
+
+static void SigNext(void);
+
+/**
+  * @brief GPIOA register block, counting the accesses
+  */
+static GPIO_TypeDef *HostGpioAAccess(void)
+{
+  if (++GpioAccesses == EdgeAtGpio)
+  {
+    SigNext();
+  }
+  return &HostGpioA;
+}
+
+/**
+  * @brief DMA channel length, counting the reads
+  */
+static uint32_t HostDmaLength(void)
+{
+  uint32_t n;
+
+  if (++DmaLenAccesses == EdgesAtLen)
+  {
+    for (n = 0; n < EdgesAtLenN; n++)
+    {
+      SigNext();
+    }
+  }
+  return HostDmaNdt;
+}
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef TIM2
+#define TIM2                        (&HostTim2)
+#undef DMA1
+#define DMA1                        (&HostDma)
+#undef GPIOA
+#define GPIOA                       (HostGpioAAccess())
+#undef SysTick
+#define SysTick                     (&HostSysTick)
+/* the bus inline functions were compiled with the device registers */
+#define MS32_AHB1_GRP1_EnableClock(Periphs)                 (HostRcc.AHBENR |= (Periphs))
+#define MS32_APB1_GRP1_EnableClock(Periphs)                 (HostRcc.APB1ENR |= (Periphs))
+/* the channel registers are reached through 32 bit address math */
+#define MS32_TIM_IC_Config(TIMx, Channel, Configuration)    (HostIcChannel = (Channel), HostIcConfig = (Configuration))
+#define MS32_DMA_EnableChannel(DMAx, Channel)               (HostDmaOn = 1U)
+#define MS32_DMA_DisableChannel(DMAx, Channel)              (HostDmaOn = 0U)
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostDmaNdt = (NbData))
+#define MS32_DMA_GetDataLength(DMAx, Channel)               (HostDmaLength())
+#define MS32_DMA_EnableIT_HT(DMAx, Channel)                 (HostDmaIe |= DMA_CCR_HTIE)
+#define MS32_DMA_EnableIT_TC(DMAx, Channel)                 (HostDmaIe |= DMA_CCR_TCIE)
+#define MS32_DMA_IsActiveFlag_HT1(DMAx)                     ((HostDmaIsr & DMA_ISR_HTIF1) != 0U)
+#define MS32_DMA_IsActiveFlag_TC1(DMAx)                     ((HostDmaIsr & DMA_ISR_TCIF1) != 0U)
+#define MS32_DMA_ClearFlag_HT1(DMAx)                        (HostDmaIsr &= ~DMA_ISR_HTIF1)
+#define MS32_DMA_ClearFlag_TC1(DMAx)                        (HostDmaIsr &= ~DMA_ISR_TCIF1)
+/* SR is write 0 to clear */
+#define MS32_TIM_ClearFlag_CC3OVR(TIMx)                     ((TIMx)->SR &= ~TIM_SR_CC3OF)
+/* reading a CCR clears its flag */
+#define MS32_TIM_IC_GetCaptureCH3(TIMx)                     (HostCcr3(TIMx))
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                (HostNvicOn = 1U)
+
+static uint32_t HostIcChannel;
+static uint32_t HostIcConfig;
+static uint8_t HostNvicOn;
+
+/**
+  * @brief CCR3 read, its flag cleared
+  */
+static uint32_t HostCcr3(TIM_TypeDef *Tim)
+{
+  Tim->SR &= ~TIM_SR_CC3IF;
+  return Tim->CCR3;
+}
+
+#include "../USER/CAPTURE.c"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_TIMCLK_HZ               48000000.0
+/* TIM2 wraps 2s into the test */
+#define SIM_T0                      (4294967296.0 - (2.0 * SIM_TIMCLK_HZ))
+#define SIM_BATCHES                 200U
+#define BATCH_LOOPS                 1000000U
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000U;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static double Now;              /* TIM2 clocks, the last edge */
+static uint8_t Level;           /* PA2 */
+static uint8_t DmaHeld;
+static uint8_t IrqHeld;
+static uint8_t InIrq;
+static uint32_t Wraps;
+static uint32_t LastStamp;
+
+/* the signal: rising at T0 + k P (+ J on odd k), high for H */
+static double SigT0;
+static double SigP;
+static double SigH;
+static double SigJ;
+static uint64_t SigK;
+
+/* batches checked against the signal */
+static uint32_t CheckFrom;      /* published batches before: the change */
+static uint32_t Checked;
+static uint32_t LastBatches;
+static uint32_t LastRestarts;
+static uint8_t AfterRestart;
+static uint8_t RiseOddSeen;
+static Capture_ResultTypeDef Last;
+
+/* Stubs of the modules CAPTURE calls ----------------------------------------*/
+ErrorStatus MS32_GPIO_Init(GPIO_TypeDef *GPIOx, MS32_GPIO_InitTypeDef *GpioInitStr)
+{
+  CHECK_EQ(GpioInitStr->Pin, MS32_GPIO_PIN_2);
+  CHECK_EQ(GpioInitStr->Mode, MS32_GPIO_MODE_ALTERNATE);
+  CHECK_EQ(GpioInitStr->Alternate, MS32_GPIO_AF_2);
+  (void)GPIOx;
+  return SUCCESS;
+}
+
+void MS32_DMA_StructInit(MS32_DMA_InitTypeDef *DmaInitStr)
+{
+  memset(DmaInitStr, 0, sizeof(*DmaInitStr));
+}
+
+ErrorStatus MS32_DMA_Init(DMA_TypeDef *DMAx, uint32_t Channel, MS32_DMA_InitTypeDef *DmaInitStr)
+{
+  CHECK_EQ(Channel, MS32_DMA_CHANNEL_1);
+  CHECK_EQ(DmaInitStr->PeriphOrM2MSrcAddress, (uint32_t)(uintptr_t)&HostTim2.CCR3);
+  CHECK_EQ(DmaInitStr->MemoryOrM2MDstAddress, (uint32_t)(uintptr_t)CapBuf);
+  CHECK_EQ(DmaInitStr->Direction, MS32_DMA_DIRECTION_PERIPH_TO_MEMORY);
+  CHECK_EQ(DmaInitStr->Mode, MS32_DMA_MODE_CIRCULAR);
+  CHECK_EQ(DmaInitStr->PeriphOrM2MSrcIncMode, MS32_DMA_PERIPH_NOINCREMENT);
+  CHECK_EQ(DmaInitStr->MemoryOrM2MDstIncMode, MS32_DMA_MEMORY_INCREMENT);
+  CHECK_EQ(DmaInitStr->PeriphOrM2MSrcDataSize, MS32_DMA_PDATAALIGN_WORD);
+  CHECK_EQ(DmaInitStr->MemoryOrM2MDstDataSize, MS32_DMA_MDATAALIGN_WORD);
+  CHECK_EQ(DmaInitStr->NbData, CAPTURE_BUF_SIZE);
+  CHECK_EQ(HostDmaOn, 0);
+  HostDmaNdt = DmaInitStr->NbData;
+  (void)DMAx;
+  return SUCCESS;
+}
+
+/**
+  * @brief The published batch against the signal
+  * @param Fresh first batch after a restart: one period less, no jitter
+  */
+static void CheckBatch(uint8_t Fresh)
+{
+  Capture_ResultTypeDef r;
+  uint32_t periods = (CAPTURE_HALF / 2U) - (Fresh ? 1U : 0U);
+  double f = SIM_TIMCLK_HZ / SigP;
+  double sum = periods * SigP;
+
+  CHECK_EQ(Capture_GetResult(&r), SUCCESS);
+  Last = r;
+  Checked++;
+  CHECK_EQ(r.TickHz, 48000000U);
+  CHECK_EQ(r.Periods, periods);
+  /* a clock at each end of the sum, J if the ends have different parity */
+  CHECK(fabs(r.FreqMilliHz - (f * 1000.0)) <= ((f * 1000.0 * (1.0 + SigJ)) / sum) + 1.0);
+  CHECK(fabs(r.DutyBp - ((SigH / SigP) * 10000.0)) <= ((10000.0 * (periods + 1.0 + SigJ)) / sum) + 1.0);
+  CHECK((r.PeriodMin + 1.0) >= (SigP - SigJ));
+  CHECK(r.PeriodMax <= (SigP + SigJ + 1.0));
+  if (Fresh)
+  {
+    CHECK_EQ(r.JitterRms, 0);
+  }
+  else
+  {
+    CHECK(fabs(r.JitterRms - SigJ) <= 2.0);
+  }
+}
+
+/**
+  * @brief The DMA interrupt, unless held; checks what it published
+  */
+static void Irq(void)
+{
+  Capture_StatsTypeDef s;
+  uint32_t restarts;
+
+  while (!IrqHeld && !InIrq && (HostDmaIsr & (DMA_ISR_HTIF1 | DMA_ISR_TCIF1)))
+  {
+    CHECK_EQ(HostDmaIe, DMA_CCR_HTIE | DMA_CCR_TCIE);
+    InIrq = 1;
+    Capture_DMA_IRQHandler();
+    InIrq = 0;
+    Capture_GetStats(&s);
+    restarts = s.Overruns + s.Overcaptures;
+    if (s.Batches != LastBatches)
+    {
+      /* a restart after the publication, never before it in one interrupt */
+      CHECK_EQ(s.Batches, LastBatches + 1U);
+      LastBatches = s.Batches;
+      if (s.Batches > CheckFrom)
+      {
+        CheckBatch(AfterRestart);
+      }
+      AfterRestart = 0;
+    }
+    if (restarts != LastRestarts)
+    {
+      LastRestarts = restarts;
+      AfterRestart = 1;
+      RiseOddSeen |= (uint8_t)(1U << RiseOdd);
+      CHECK_EQ(RiseOdd, Level);
+      CHECK_EQ(HostDmaNdt, CAPTURE_BUF_SIZE);
+    }
+  }
+}
+
+/**
+  * @brief The DMA takes CCR3 into the ring
+  */
+static void DmaService(void)
+{
+  uint32_t t;
+
+  if (!DmaHeld && HostDmaOn && (HostTim2.DIER & TIM_DIER_CC3DE) && (HostTim2.SR & TIM_SR_CC3IF))
+  {
+    t = HostCcr3(&HostTim2);
+    CapBuf[CAPTURE_BUF_SIZE - HostDmaNdt] = t;
+    Wraps += (t < LastStamp) ? 1U : 0U;
+    LastStamp = t;
+    if (--HostDmaNdt == CAPTURE_HALF)
+    {
+      HostDmaIsr |= DMA_ISR_HTIF1;
+    }
+    if (HostDmaNdt == 0U)
+    {
+      HostDmaIsr |= DMA_ISR_TCIF1;
+      HostDmaNdt = CAPTURE_BUF_SIZE;
+    }
+  }
+}
+
+/**
+  * @brief One edge of PA2 at TIM2 time T
+  */
+static void Edge(double T)
+{
+  Now = T;
+  Level ^= 1U;
+  HostGpioA.IDR = (uint32_t)Level << 2;
+  if (HostTim2.CCER & TIM_CCER_CC3E)
+  {
+    HostTim2.SR |= (HostTim2.SR & TIM_SR_CC3IF) ? TIM_SR_CC3OF : 0U;
+    HostTim2.CCR3 = (uint32_t)(uint64_t)T;
+    HostTim2.SR |= TIM_SR_CC3IF;
+  }
+  DmaService();
+  Irq();
+}
+
+/**
+  * @brief The next edge of the signal
+  */
+static void SigNext(void)
+{
+  double t = SigT0 + (SigK * SigP) + ((SigK & 1U) ? SigJ : 0.0);
+
+  if (Level)
+  {
+    Edge(floor(t + SigH));
+    SigK++;
+  }
+  else
+  {
+    Edge(floor(t));
+  }
+}
+
+/**
+  * @brief A new signal from half a period on; checks from the third batch
+  */
+static void SigSet(double Hz, double Duty, double Jitter)
+{
+  Capture_StatsTypeDef s;
+
+  SigP = SIM_TIMCLK_HZ / Hz;
+  SigH = floor((SigP * Duty) + 0.5);
+  SigJ = Jitter;
+  SigK = 0;
+  /* low: rising in half a period; high: falling */
+  SigT0 = Now + (SigP / 2.0) - (Level ? SigH : 0.0);
+  Capture_GetStats(&s);
+  CheckFrom = s.Batches + 2U;
+}
+
+/**
+  * @brief Edges of the signal
+  */
+static void Run(uint32_t Edges)
+{
+  for (; Edges > 0; Edges--)
+  {
+    SigNext();
+  }
+}
+
+/**
+  * @brief Edges up to a DMA flag, interrupt held
+  */
+static void RunToFlag(uint32_t Flag)
+{
+  while (HostDmaNdt != ((Flag == DMA_ISR_HTIF1) ? (CAPTURE_HALF + 1U) : 1U))
+  {
+    SigNext();
+  }
+  IrqHeld = 1;
+  SigNext();
+  CHECK_EQ(HostDmaIsr, Flag);
+}
+
+/**
+  * @brief Host time of one batch, ns
+  */
+static double BatchNs(void)
+{
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t i;
+  uint32_t k;
+  uint32_t first;
+  uint32_t t = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < BATCH_LOOPS; i++)
+  {
+    /* the next half of a 1MHz 1/3 signal, the DMA in the other half */
+    first = (i & 1U) * CAPTURE_HALF;
+    for (k = first; k < (first + CAPTURE_HALF); k += 2U)
+    {
+      CapBuf[k ^ RiseOdd] = t;
+      CapBuf[k ^ RiseOdd ^ 1U] = t + 16U;
+      t += 48U;
+    }
+    HostDmaNdt = (i & 1U) ? CAPTURE_BUF_SIZE : CAPTURE_HALF;
+    Capture_Batch(first);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BATCH_LOOPS;
+}
+
+int main(void)
+{
+  static const struct
+  {
+    double Hz;
+    double Duty;
+  } rates[] = {{1000.0, 0.25}, {7000.0, 0.6}, {33333.0, 0.1}, {100000.0, 0.5},
+               {500000.0, 0.75}, {1000000.0, 1.0 / 3.0}, {2000000.0, 0.5}};
+  Capture_ResultTypeDef r;
+  Capture_StatsTypeDef s;
+  uint32_t checked;
+  uint32_t edges;
+  uint32_t flag;
+  double ns;
+  uint32_t k;
+  uint32_t n;
+
+  HostSysTick.LOAD = 47999U;
+  CHECK_EQ(Capture_GetResult(&r), ERROR);
+
+  /* high at the start: the rising edges at odd indexes */
+  Now = SIM_T0;
+  LastStamp = (uint32_t)(uint64_t)SIM_T0;
+  Level = 1;
+  HostGpioA.IDR = 1U << 2;
+  Capture_Init();
+  CHECK(HostRcc.AHBENR & MS32_AHB1_GRP1_PERIPH_GPIOA);
+  CHECK(HostRcc.AHBENR & MS32_AHB1_GRP1_PERIPH_DMA1);
+  CHECK(HostRcc.APB1ENR & MS32_APB1_GRP1_PERIPH_TIM2);
+  CHECK(HostTim2.CR1 & TIM_CR1_CEN);
+  CHECK_EQ(HostTim2.ARR, 0xFFFFFFFFU);
+  CHECK_EQ(HostTim2.PSC, 0);
+  CHECK_EQ(HostIcChannel, MS32_TIM_CHANNEL_CH3);
+  CHECK_EQ(HostIcConfig & MS32_TIM_IC_POLARITY_BOTHEDGE, MS32_TIM_IC_POLARITY_BOTHEDGE);
+  CHECK(HostTim2.CCER & TIM_CCER_CC3E);
+  CHECK(HostTim2.DIER & TIM_DIER_CC3DE);
+  CHECK_EQ(HostTim2.CR2 & TIM_CR2_CCDS, 0);
+  CHECK(HostDmaOn);
+  CHECK_EQ(HostDmaNdt, CAPTURE_BUF_SIZE);
+  CHECK_EQ(HostDmaIe, DMA_CCR_HTIE | DMA_CCR_TCIE);
+  CHECK(HostNvicOn);
+  CHECK_EQ(RiseOdd, 1);
+  CHECK_EQ(Capture_GetResult(&r), ERROR);
+  AfterRestart = 1;
+
+  /* rates: a batch interrupt every 32 edges, the DMA takes the rest */
+  printf("        Hz  duty   measured mHz  duty bp  min  max  edges/s  batches/s  cycles/batch\n");
+  for (k = 0; k < (sizeof(rates) / sizeof(rates[0])); k++)
+  {
+    SigSet(rates[k].Hz, rates[k].Duty, 0);
+    checked = Checked;
+    Run(SIM_BATCHES * CAPTURE_HALF);
+    CHECK(Checked >= (checked + SIM_BATCHES - 3U));
+    printf("%10.0f %5.3f %14lu %8u %4lu %4lu %8.0f %10.0f %13.0f\n", rates[k].Hz, rates[k].Duty,
+           (unsigned long)Last.FreqMilliHz, Last.DutyBp, (unsigned long)Last.PeriodMin,
+           (unsigned long)Last.PeriodMax, 2.0 * rates[k].Hz, (2.0 * rates[k].Hz) / CAPTURE_HALF,
+           (CAPTURE_HALF * SIM_TIMCLK_HZ) / (2.0 * rates[k].Hz));
+    if (k == 0U)
+    {
+      /* over the TIM2 wrap */
+      CHECK_EQ(Wraps, 1);
+    }
+  }
+  Capture_GetStats(&s);
+  CHECK_EQ(s.Overruns, 0);
+  CHECK_EQ(s.Overcaptures, 0);
+
+  /* jitter: periods of P + J and P - J in turn */
+  SigSet(10000.0, 0.5, 37.0);
+  Run(20U * CAPTURE_HALF);
+  printf("10kHz, periods 4800 +-37: jitter rms %lu, min %lu, max %lu\n", (unsigned long)Last.JitterRms,
+         (unsigned long)Last.PeriodMin, (unsigned long)Last.PeriodMax);
+  CHECK_EQ(Last.JitterRms, 37);
+  CHECK_EQ(Last.PeriodMin, 4800 - 37);
+  CHECK_EQ(Last.PeriodMax, 4800 + 37);
+
+  /* an edge lost while the DMA was held: restart, the parity turns */
+  SigSet(100000.0, 0.3, 0);
+  Run(10U * CAPTURE_HALF);
+  for (n = 1; n <= 2U; n++)
+  {
+    Run(5U);
+    DmaHeld = 1;
+    Run(2U);
+    CHECK(HostTim2.SR & TIM_SR_CC3OF);
+    DmaHeld = 0;
+    DmaService();
+    checked = Checked;
+    Run(10U * CAPTURE_HALF);
+    Capture_GetStats(&s);
+    CHECK_EQ(s.Overcaptures, n);
+    CHECK(Checked >= (checked + 8U));
+  }
+  CHECK_EQ(RiseOddSeen, 3);
+
+  /* the interrupt late by 31 edges: the DMA still in the other half; by 32
+     the ring lapped, after the half and after the complete */
+  for (n = 0; n < 2U; n++)
+  {
+    flag = n ? DMA_ISR_TCIF1 : DMA_ISR_HTIF1;
+    RunToFlag(flag);
+    Run(CAPTURE_HALF - 1U);
+    checked = Checked;
+    IrqHeld = 0;
+    Irq();
+    CHECK_EQ(Checked, checked + 1U);
+    Capture_GetStats(&s);
+    CHECK_EQ(s.Overruns, n);
+    RunToFlag(flag);
+    Run(CAPTURE_HALF);
+    CHECK_EQ(HostDmaIsr, DMA_ISR_HTIF1 | DMA_ISR_TCIF1);
+    checked = Checked;
+    IrqHeld = 0;
+    Irq();
+    CHECK_EQ(Checked, checked);
+    Capture_GetStats(&s);
+    CHECK_EQ(s.Overruns, n + 1U);
+    CHECK_EQ(HostDmaIsr, 0);
+    Run(10U * CAPTURE_HALF);
+    CHECK(Checked >= (checked + 9U));
+  }
+
+  /* the DMA moving on while a batch is read: 31 edges, then 32 */
+  for (n = CAPTURE_HALF - 1U; n <= CAPTURE_HALF; n++)
+  {
+    RunToFlag(DMA_ISR_HTIF1);
+    DmaLenAccesses = 0;
+    EdgesAtLen = 2;
+    EdgesAtLenN = n;
+    checked = Checked;
+    IrqHeld = 0;
+    Irq();
+    EdgesAtLen = 0;
+    CHECK(DmaLenAccesses >= 2U);
+    Capture_GetStats(&s);
+    CHECK_EQ(s.Overruns, (n == CAPTURE_HALF) ? 3U : 2U);
+    CHECK((Checked > checked) == (n < CAPTURE_HALF));
+    Run(10U * CAPTURE_HALF);
+  }
+
+  /* an edge at each level read of a restart: before the capture is on it
+     is not in the ring, after it the ring starts again */
+  for (n = 1; n <= 10U; n++)
+  {
+    Run(3U);
+    GpioAccesses = 0;
+    EdgeAtGpio = n;
+    Capture_Restart();
+    EdgeAtGpio = 0;
+    if (GpioAccesses < n)
+    {
+      /* past the last read */
+      break;
+    }
+    CHECK_EQ(GpioAccesses, (n == 2U) ? 4U : 2U);
+    CHECK_EQ(RiseOdd, Level);
+    CHECK_EQ(HostDmaNdt, CAPTURE_BUF_SIZE);
+    AfterRestart = 1;
+    checked = Checked;
+    Run(10U * CAPTURE_HALF);
+    CHECK(Checked >= (checked + 9U));
+  }
+  CHECK_EQ(n, 3);
+
+  Capture_GetStats(&s);
+  CHECK_EQ(s.Batches, LastBatches);
+  CHECK(s.Edges >= (s.Batches * CAPTURE_HALF));
+  edges = s.Edges;
+  printf("%lu batches checked, %lu edges, %lu overcaptures, %lu overruns\n", (unsigned long)Checked,
+         (unsigned long)edges, (unsigned long)s.Overcaptures, (unsigned long)s.Overruns);
+  ns = BatchNs();
+  printf("Capture_Batch() host time: %.1f ns, %.2f ns per edge\n", ns, ns / CAPTURE_HALF);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
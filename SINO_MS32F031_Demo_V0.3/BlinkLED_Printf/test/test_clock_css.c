@@ -0,0 +1,306 @@
+/**
+  ******************************************************************************
+  * @file 		test_clock_css.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the CLOCK_CSS failover and recovery state machine
+  *
+  *          CLOCK_CSS.c runs on a RAM copy of the RCC registers with a HSE
+  *          plan. The crystal model sets HSERDY SIM_HSE_START_MS after HSEON while
+  *          the crystal is fitted and clears it otherwise; time passes in
+  *          1ms steps with ClockCss_Poll() every PollMs. CLOCK_SCALE is a
+  *          stub keeping the profile.
+  *          Checked: arming on a running crystal and the failover of a
+  *          crystal missing at ClockCss_Init(); the NMI only acts on CSSF,
+  *          clears it, turns the CSS off and moves to the backup profile;
+  *          restarts every CLOCK_CSS_RETRY_MS, a crystal that does not
+  *          start within CLOCK_CSS_STARTUP_MS is stopped again; a crystal
+  *          lost during the stable time starts over; CLOCK_CSS_STABLE_MS of
+  *          HSERDY arms the CSS before CLOCK_SCALE goes back to HIGH; the
+  *          statistics. The restore delay after the crystal comes back is
+  *          printed for a few poll periods.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Private define ------------------------------------------------------------*/
+#define CLOCK_PLAN_SOURCE           1
+#define CLOCK_PLAN_SYSCLK_HZ        48000000UL
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+#define SIM_HSE_START_MS            3U
+#define SIM_FAILOVER_US             40U
+
+static RCC_TypeDef HostRcc;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+/* the RCC inline functions were compiled with the device RCC */
+#define MS32_RCC_HSE_EnableCSS()                            (HostRcc.CR |= RCC_CR_CSSON)
+#define MS32_RCC_HSE_DisableCSS()                           (HostRcc.CR &= ~RCC_CR_CSSON)
+#define MS32_RCC_IsActiveFlag_HSECSS()                      ((HostRcc.CIR & RCC_CIR_CSSF) != 0U)
+/* CSSC is write 1 to clear CSSF */
+#define MS32_RCC_ClearFlag_HSECSS()                         (HostRcc.CIR &= ~RCC_CIR_CSSF)
+
+#include "../USER/CLOCK_CSS.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t HostMs;
+static uint32_t HostUs;
+static uint8_t HseFitted = 1;
+static uint32_t HseOnAt;
+static uint32_t HostCr;
+static uint8_t ScaleProfile = CLOCK_SCALE_HIGH;
+static uint32_t ScaleFailovers;
+static uint32_t ScaleSets;
+static uint8_t CssAtSet;        /* CSSON when CLOCK_SCALE went back to HIGH */
+
+/* Stubs of the modules CLOCK_CSS calls --------------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return HostMs;
+}
+
+uint32_t SysTick_GetUs(void)
+{
+  return HostUs;
+}
+
+void ClockScale_Failover(void)
+{
+  HostUs += SIM_FAILOVER_US;
+  ScaleFailovers++;
+  ScaleProfile = CLOCK_SCALE_BACKUP;
+}
+
+ErrorStatus ClockScale_Set(uint8_t Profile)
+{
+  ScaleSets++;
+  CssAtSet = (HostRcc.CR & RCC_CR_CSSON) ? 1U : 0U;
+  ScaleProfile = Profile;
+  return SUCCESS;
+}
+
+uint8_t ClockScale_Get(void)
+{
+  return ScaleProfile;
+}
+
+/**
+  * @brief One millisecond of the crystal model
+  */
+static void Step(void)
+{
+  HostMs++;
+  HostUs += 1000U;
+  if ((HostRcc.CR & RCC_CR_HSEON) && !(HostCr & RCC_CR_HSEON))
+  {
+    HseOnAt = HostMs;
+  }
+  if ((HostRcc.CR & RCC_CR_HSEON) && HseFitted && ((HostMs - HseOnAt) >= SIM_HSE_START_MS))
+  {
+    HostRcc.CR |= RCC_CR_HSERDY;
+  }
+  else
+  {
+    HostRcc.CR &= ~RCC_CR_HSERDY;
+  }
+  HostCr = HostRcc.CR;
+}
+
+/**
+  * @brief Let Ms pass, ClockCss_Poll() every PollMs
+  */
+static void Run(uint32_t Ms, uint32_t PollMs)
+{
+  while (Ms-- != 0U)
+  {
+    Step();
+    if ((HostMs % PollMs) == 0U)
+    {
+      ClockCss_Poll();
+    }
+  }
+}
+
+/**
+  * @brief Crystal failure seen by the CSS: hardware on HSI, HSE off, NMI
+  */
+static void CssFail(void)
+{
+  HseFitted = 0;
+  HostRcc.CR &= ~(RCC_CR_HSEON | RCC_CR_HSERDY);
+  HostCr = HostRcc.CR;
+  HostRcc.CIR |= RCC_CIR_CSSF;
+  ClockCss_NMI_IRQHandler();
+}
+
+/**
+  * @brief Back to the start: armed on a running crystal
+  */
+static void Restart(void)
+{
+  State = CLOCK_CSS_OFF;
+  memset(&CssStats, 0, sizeof(CssStats));
+  HseFitted = 1;
+  HostRcc.CR = RCC_CR_HSION | RCC_CR_HSIRDY | RCC_CR_HSEON | RCC_CR_HSERDY;
+  HostRcc.CIR = 0;
+  HostCr = HostRcc.CR;
+  ScaleProfile = CLOCK_SCALE_HIGH;
+  ClockCss_Init();
+}
+
+/**
+  * @brief Restore delay after the crystal comes back, one poll period
+  */
+static uint32_t RestoreDelay(uint32_t PollMs, uint32_t BackAfterMs)
+{
+  uint32_t back;
+  uint32_t limit;
+
+  Restart();
+  CssFail();
+  Run(BackAfterMs, PollMs);
+  HseFitted = 1;
+  back = HostMs;
+  limit = HostMs + (3U * CLOCK_CSS_RETRY_MS);
+  while ((ScaleProfile != CLOCK_SCALE_HIGH) && (HostMs < limit))
+  {
+    Run(1, PollMs);
+  }
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_ARMED);
+  return HostMs - back;
+}
+
+int main(void)
+{
+  ClockCss_StatsTypeDef stats;
+  static const uint32_t polls[] = {1, 10, 50, 200};
+  uint32_t i;
+  uint32_t t;
+
+  /* a running crystal is armed */
+  Restart();
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_ARMED);
+  CHECK(HostRcc.CR & RCC_CR_CSSON);
+  CHECK(HostRcc.CR & RCC_CR_HSEON);
+  CHECK_EQ(ScaleFailovers, 0);
+  Run(5000, 10);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_ARMED);
+
+  /* NMI of another source: nothing */
+  ClockCss_NMI_IRQHandler();
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_ARMED);
+  CHECK(HostRcc.CR & RCC_CR_CSSON);
+
+  /* CSS failure */
+  t = HostMs;
+  CssFail();
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_DOWN);
+  CHECK_EQ(HostRcc.CIR & RCC_CIR_CSSF, 0);
+  CHECK_EQ(HostRcc.CR & RCC_CR_CSSON, 0);
+  CHECK_EQ(ScaleProfile, CLOCK_SCALE_BACKUP);
+  CHECK_EQ(ScaleFailovers, 1);
+  ClockCss_GetStats(&stats);
+  CHECK_EQ(stats.Failovers, 1);
+  CHECK_EQ(stats.LastFailoverUs, SIM_FAILOVER_US);
+
+  /* dead crystal: one restart a period, stopped after the start up time */
+  Run(CLOCK_CSS_RETRY_MS - 1U, 1);
+  CHECK_EQ(HostRcc.CR & RCC_CR_HSEON, 0);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_DOWN);
+  Run(1, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_PROBE);
+  CHECK(HostRcc.CR & RCC_CR_HSEON);
+  CHECK_EQ(HostRcc.CR & RCC_CR_CSSON, 0);
+  Run(CLOCK_CSS_STARTUP_MS, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_DOWN);
+  CHECK_EQ(HostRcc.CR & RCC_CR_HSEON, 0);
+  Run((4U * CLOCK_CSS_RETRY_MS) - CLOCK_CSS_STARTUP_MS, 1);
+  ClockCss_GetStats(&stats);
+  CHECK_EQ(stats.Retries, 5);
+  CHECK_EQ(stats.Restores, 0);
+  CHECK_EQ(ScaleSets, 0);
+
+  /* the fifth restart is probing: let it fail */
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_PROBE);
+  Run(CLOCK_CSS_STARTUP_MS, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_DOWN);
+
+  /* crystal back, lost again within the stable time: starts over */
+  HseFitted = 1;
+  Run(CLOCK_CSS_RETRY_MS - CLOCK_CSS_STARTUP_MS, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_PROBE);
+  Run(CLOCK_CSS_STABLE_MS / 2U, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_PROBE);
+  HseFitted = 0;
+  Run(1, 1);
+  Run(1, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_DOWN);
+  CHECK_EQ(HostRcc.CR & RCC_CR_HSEON, 0);
+  CHECK_EQ(ScaleSets, 0);
+
+  /* stable: CSS armed first, then the planned clock */
+  HseFitted = 1;
+  for (i = 0; (i < (2U * CLOCK_CSS_RETRY_MS)) && (ScaleSets == 0U); i++)
+  {
+    Run(1, 1);
+  }
+  CHECK_EQ(ScaleSets, 1);
+  CHECK_EQ(CssAtSet, 1);
+  CHECK_EQ(ScaleProfile, CLOCK_SCALE_HIGH);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_ARMED);
+  ClockCss_GetStats(&stats);
+  CHECK_EQ(stats.Restores, 1);
+  CHECK_EQ(stats.LastDownMs, HostMs - t);
+  CHECK_EQ(stats.TotalDownMs, HostMs - t);
+
+  /* the low profile is not forced up on a restore */
+  CssFail();
+  ScaleProfile = CLOCK_SCALE_LOW;
+  HseFitted = 1;
+  Run(CLOCK_CSS_RETRY_MS + CLOCK_CSS_STABLE_MS + SIM_HSE_START_MS + 2U, 1);
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_ARMED);
+  CHECK_EQ(ScaleProfile, CLOCK_SCALE_LOW);
+  CHECK_EQ(ScaleSets, 1);
+
+  /* crystal missing at reset: failover from ClockCss_Init() */
+  HseFitted = 0;
+  HostRcc.CR = RCC_CR_HSION | RCC_CR_HSIRDY | RCC_CR_HSEON;
+  HostCr = HostRcc.CR;
+  State = CLOCK_CSS_OFF;
+  ScaleProfile = CLOCK_SCALE_HIGH;
+  t = ScaleFailovers;
+  ClockCss_Init();
+  CHECK_EQ(ClockCss_GetState(), CLOCK_CSS_DOWN);
+  CHECK_EQ(HostRcc.CR & (RCC_CR_HSEON | RCC_CR_CSSON), 0);
+  CHECK_EQ(ScaleFailovers, t + 1U);
+  CHECK_EQ(ScaleProfile, CLOCK_SCALE_BACKUP);
+
+  /* restore delay: next retry, start up and stable time, rounded to the poll */
+  for (i = 0; i < (sizeof(polls) / sizeof(polls[0])); i++)
+  {
+    t = RestoreDelay(polls[i], 2500U);
+    CHECK(t <= (CLOCK_CSS_RETRY_MS + CLOCK_CSS_STABLE_MS + SIM_HSE_START_MS + (3U * polls[i])));
+    printf("poll %3ums: crystal back to HSE in use %4ums (retry %ums, stable %ums)\n",
+           polls[i], t, CLOCK_CSS_RETRY_MS, CLOCK_CSS_STABLE_MS);
+  }
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,316 @@
+/**
+  ******************************************************************************
+  * @file 		test_clock_scale.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the CLOCK_SCALE profile switch with a HSE plan
+  *
+  *          CLOCK_SCALE.c runs on RAM copies of the RCC and FLASH registers,
+  *          built with a HSE plan (8MHz crystal, SYSCLK = HCLK 48MHz, PCLK
+  *          24MHz). Every RCC access goes through the clock model: 1us
+  *          passes, HSERDY comes HseStartUs after HSEON, PLLRDY PllLockUs
+  *          after PLLON, SWS follows SW once the source is ready. SysTick_GetUs()
+  *          also advances 1us a call.
+  *          Checked: the order of the PRE / POST callbacks and their SYSCLK;
+  *          flash latency, bus prescalers and SystemCoreClock of both
+  *          profiles; LOW stops the PLL and the crystal; leaving LOW starts
+  *          HSE and waits for HSERDY before the PLL, refused without any
+  *          callback when it does not start; a PLL that does not lock
+  *          stops the crystal it started; from the backup profile the
+  *          crystal is left to CLOCK_CSS; the statistics. The switch and
+  *          blackout times of the model are printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Private define ------------------------------------------------------------*/
+#define CLOCK_PLAN_SOURCE           1
+#define CLOCK_PLAN_SYSCLK_HZ        48000000UL
+#define CLOCK_PLAN_HCLK_HZ          48000000UL
+#define CLOCK_PLAN_PCLK_HZ          24000000UL
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+#define SIM_HSE_START_US            1500U
+#define SIM_PLL_LOCK_US             100U
+#define SIM_NEVER                   0xFFFFFFFFU
+
+static RCC_TypeDef HostRcc;
+static FLASH_TypeDef HostFlash;
+static uint32_t HostUs;
+static uint32_t HseStartUs = SIM_HSE_START_US;
+static uint32_t PllLockUs = SIM_PLL_LOCK_US;
+static uint32_t HseOnAt;
+static uint32_t PllOnAt;
+static uint32_t HostCr;         /* CR at the last access, for the ON edges */
+
+/**
+  * @brief Clock model, run on every RCC access
+  */
+static RCC_TypeDef *HostRccUpdate(void)
+{
+  uint32_t cr = HostRcc.CR;
+  uint32_t sw = HostRcc.CFGR & RCC_CFGR_SW;
+  uint8_t ready;
+
+  HostUs++;
+  if ((cr & RCC_CR_HSEON) && !(HostCr & RCC_CR_HSEON))
+  {
+    HseOnAt = HostUs;
+  }
+  if ((cr & RCC_CR_PLLON) && !(HostCr & RCC_CR_PLLON))
+  {
+    PllOnAt = HostUs;
+  }
+  cr &= ~(RCC_CR_HSERDY | RCC_CR_PLLRDY);
+  if ((cr & RCC_CR_HSEON) && (HseStartUs != SIM_NEVER) && ((HostUs - HseOnAt) >= HseStartUs))
+  {
+    cr |= RCC_CR_HSERDY;
+  }
+  /* PLL on HSE / PREDIV needs the crystal */
+  if ((cr & RCC_CR_PLLON) && (PllLockUs != SIM_NEVER) && ((HostUs - PllOnAt) >= PllLockUs) &&
+      (((HostRcc.CFGR & RCC_CFGR_PLLSRC) == RCC_CFGR_PLLSRC_HSI_DIV2) || (cr & RCC_CR_HSERDY)))
+  {
+    cr |= RCC_CR_PLLRDY;
+  }
+  HostRcc.CR = cr;
+  HostCr = cr;
+  ready = (sw == RCC_CFGR_SW_HSI) || ((sw == RCC_CFGR_SW_HSE) && (cr & RCC_CR_HSERDY)) ||
+          ((sw == RCC_CFGR_SW_PLL) && (cr & RCC_CR_PLLRDY));
+  if (ready)
+  {
+    HostRcc.CFGR = (HostRcc.CFGR & ~RCC_CFGR_SWS) | (sw << 2);
+  }
+  return &HostRcc;
+}
+
+#undef RCC
+#define RCC                         (HostRccUpdate())
+#undef FLASH
+#define FLASH                       (&HostFlash)
+
+#include "../USER/CLOCK_SCALE.c"
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = CLOCK_PLAN_HCLK_HZ;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static uint32_t RetimeHclk;
+static uint8_t CbPhase[8];
+static uint32_t CbSysclk[8];
+static uint8_t CbCount;
+
+/* Stubs of the modules CLOCK_SCALE calls ------------------------------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return HostUs++;
+}
+
+void SysTick_Retime(uint32_t Hclk)
+{
+  RetimeHclk = Hclk;
+}
+
+/**
+  * @brief Re-timing callback, records the calls
+  */
+static void Callback(uint8_t Phase, uint32_t Sysclk)
+{
+  if (CbCount < 8U)
+  {
+    CbPhase[CbCount] = Phase;
+    CbSysclk[CbCount] = Sysclk;
+  }
+  CbCount++;
+}
+
+/**
+  * @brief Reset the callback record
+  */
+static void CbClear(void)
+{
+  CbCount = 0;
+  memset(CbPhase, 0xFF, sizeof(CbPhase));
+}
+
+/**
+  * @brief The registers of the planned clock, as SystemInit() leaves them
+  */
+static void PlannedClock(void)
+{
+  HostRcc.CR = RCC_CR_HSION | RCC_CR_HSIRDY | RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY;
+  HostCr = HostRcc.CR;
+  HostRcc.CFGR2 = CLOCK_PLAN_CFGR2;
+  HostRcc.CFGR = CLOCK_PLAN_CFGR_PLL | CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE | CLOCK_PLAN_SW | CLOCK_PLAN_SWS;
+  HostFlash.ACR = CLOCK_PLAN_ACR;
+}
+
+/**
+  * @brief Check the registers of the high profile
+  */
+static void CheckHigh(void)
+{
+  CHECK_EQ(ClockScale_Get(), CLOCK_SCALE_HIGH);
+  CHECK_EQ(HostRcc.CR & (RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY),
+           RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_PLL);
+  CHECK_EQ(HostRcc.CFGR & CLOCK_SCALE_PLL_MASK, CLOCK_PLAN_CFGR_PLL);
+  CHECK_EQ(HostRcc.CFGR & (RCC_CFGR_HPRE | RCC_CFGR_PPRE), CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE);
+  CHECK_EQ(HostRcc.CFGR2, CLOCK_PLAN_CFGR2);
+  CHECK_EQ(HostFlash.ACR, FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY);
+  CHECK_EQ(SystemCoreClock, CLOCK_PLAN_HCLK_HZ);
+  CHECK_EQ(RetimeHclk, CLOCK_PLAN_HCLK_HZ);
+}
+
+/**
+  * @brief Check the registers of the low profile
+  */
+static void CheckLow(void)
+{
+  CHECK_EQ(ClockScale_Get(), CLOCK_SCALE_LOW);
+  CHECK_EQ(HostRcc.CR & (RCC_CR_HSEON | RCC_CR_PLLON), 0);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_HSI);
+  CHECK_EQ(HostRcc.CFGR & (RCC_CFGR_HPRE | RCC_CFGR_PPRE), 0);
+  CHECK_EQ(HostFlash.ACR, FLASH_ACR_PRFTBE);
+  CHECK_EQ(SystemCoreClock, HSI_VALUE);
+  CHECK_EQ(RetimeHclk, HSI_VALUE);
+  CHECK_EQ(HseStopped, 1);
+}
+
+/**
+  * @brief Check a PRE / POST pair of one switch
+  */
+static void CheckPair(uint32_t Sysclk)
+{
+  CHECK_EQ(CbCount, 2);
+  CHECK_EQ(CbPhase[0], CLOCK_SCALE_PRE);
+  CHECK_EQ(CbSysclk[0], Sysclk);
+  CHECK_EQ(CbPhase[1], CLOCK_SCALE_POST);
+  CHECK_EQ(CbSysclk[1], Sysclk);
+}
+
+int main(void)
+{
+  ClockScale_StatsTypeDef stats;
+  uint32_t i;
+
+  PlannedClock();
+  CHECK_EQ(ClockScale_Register(Callback), SUCCESS);
+  for (i = 1; i < CLOCK_SCALE_MAX_CALLBACKS; i++)
+  {
+    CHECK_EQ(ClockScale_Register(Callback), SUCCESS);
+  }
+  CHECK_EQ(ClockScale_Register(Callback), ERROR);
+  CallbackCount = 1;
+
+  /* same profile: nothing */
+  CbClear();
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), SUCCESS);
+  CHECK_EQ(CbCount, 0);
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_BACKUP), ERROR);
+
+  /* down: PLL and crystal off */
+  CbClear();
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_LOW), SUCCESS);
+  CheckPair(HSI_VALUE);
+  CheckLow();
+  ClockScale_GetStats(&stats);
+  printf("HIGH -> LOW : %4uus, interrupts off %3uus\n", stats.LastUs, stats.LastBlackoutUs);
+
+  /* up: crystal start, then the PLL */
+  CbClear();
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), SUCCESS);
+  CheckPair(CLOCK_PLAN_SYSCLK_HZ);
+  CheckHigh();
+  CHECK_EQ(HseStopped, 0);
+  ClockScale_GetStats(&stats);
+  CHECK(stats.LastUs >= (SIM_HSE_START_US + SIM_PLL_LOCK_US));
+  CHECK(stats.LastBlackoutUs < 20U);
+  printf("LOW -> HIGH : %4uus, interrupts off %3uus (HSE start %uus, PLL lock %uus)\n",
+         stats.LastUs, stats.LastBlackoutUs, SIM_HSE_START_US, SIM_PLL_LOCK_US);
+  CHECK_EQ(stats.Switches, 2);
+  CHECK_EQ(stats.PllFails, 0);
+
+  /* crystal that does not start: refused before any callback, stays off */
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_LOW), SUCCESS);
+  HseStartUs = SIM_NEVER;
+  CbClear();
+  i = HostUs;
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), ERROR);
+  CHECK_EQ(CbCount, 0);
+  CheckLow();
+  CHECK((HostUs - i) > CLOCK_SCALE_HSE_TIMEOUT_US);
+  ClockScale_GetStats(&stats);
+  CHECK_EQ(stats.PllFails, 1);
+  CHECK_EQ(stats.Switches, 3);
+  /* back once it starts */
+  HseStartUs = SIM_HSE_START_US;
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), SUCCESS);
+  CheckHigh();
+
+  /* PLL that does not lock: POST on HSI undoes PRE, the crystal is stopped again */
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_LOW), SUCCESS);
+  PllLockUs = SIM_NEVER;
+  CbClear();
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), ERROR);
+  CHECK_EQ(CbCount, 2);
+  CHECK_EQ(CbPhase[0], CLOCK_SCALE_PRE);
+  CHECK_EQ(CbPhase[1], CLOCK_SCALE_POST);
+  CHECK_EQ(CbSysclk[1], HSI_VALUE);
+  CheckLow();
+  ClockScale_GetStats(&stats);
+  CHECK_EQ(stats.PllFails, 2);
+  PllLockUs = SIM_PLL_LOCK_US;
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), SUCCESS);
+  CheckHigh();
+
+  /* CSS failover: hardware on HSI, HSE and its PLL off, then the backup PLL */
+  HostRcc.CR &= ~(RCC_CR_HSEON | RCC_CR_PLLON);
+  HostRcc.CFGR &= ~RCC_CFGR_SW;
+  CbClear();
+  ClockScale_Failover();
+  CHECK_EQ(ClockScale_Get(), CLOCK_SCALE_BACKUP);
+  CHECK_EQ(CbCount, 1);
+  CHECK_EQ(CbPhase[0], CLOCK_SCALE_POST);
+  CHECK_EQ(CbSysclk[0], CLOCK_PLAN_BACKUP_SYSCLK_HZ);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_PLL);
+  CHECK_EQ(HostRcc.CFGR & CLOCK_SCALE_PLL_MASK, CLOCK_PLAN_BACKUP_CFGR_PLL);
+  CHECK_EQ(HostFlash.ACR, CLOCK_PLAN_BACKUP_ACR);
+  /* HIGH is refused while CLOCK_CSS has no crystal */
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), ERROR);
+  CHECK_EQ(ClockScale_Get(), CLOCK_SCALE_BACKUP);
+  /* CLOCK_CSS probing the crystal: LOW leaves it running */
+  HostRcc.CR |= RCC_CR_HSEON;
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_LOW), SUCCESS);
+  CHECK_EQ(ClockScale_Get(), CLOCK_SCALE_LOW);
+  CHECK(HostRcc.CR & RCC_CR_HSEON);
+  CHECK_EQ(HostRcc.CR & RCC_CR_PLLON, 0);
+  CHECK_EQ(HseStopped, 0);
+  for (i = 0; i < SIM_HSE_START_US; i++)
+  {
+    (void)RCC;
+  }
+  CHECK_EQ(ClockScale_Set(CLOCK_SCALE_HIGH), SUCCESS);
+  CheckHigh();
+  ClockScale_GetStats(&stats);
+  CHECK_EQ(stats.Failovers, 1);
+  printf("%u switches, longest %uus, interrupts off at most %uus\n",
+         stats.Switches, stats.MaxUs, stats.MaxBlackoutUs);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,518 @@
+/**
+  ******************************************************************************
+  * @file 		test_encoder.c
+	* @author		SINOMCU-AE
+  * @brief 		Host simulation of the encoder position and M/T speed estimate
+  *
+  *          ENCODER.c runs on RAM copies of the RCC, TIM2, TIM3 and SysTick
+  *          registers. A synthetic encoder moves along a speed profile in
+  *          1us steps; every count it crosses steps the TIM3 counter (x4,
+  *          16 bits, UIF on a wrap), an A rising edge latches TIM3 CCR1 and,
+  *          as TRGO does, the 48MHz TIM2 time of the crossing in TIM2 CCR1;
+  *          one count in ENCODER_COUNTS_PER_REV is the index (TIM3 CCR3).
+  *          Reading a CCR clears its flag, as the hardware does. The TIM3
+  *          interrupt runs at once unless held; TIM2 is reached through a
+  *          function that counts the accesses, so an edge can be made to
+  *          come between any two reads of Encoder_Update().
+  *          Checked: the 64 bit position at every estimate over many wraps
+  *          both ways, with a wrap pending and after a reversal before the
+  *          interrupt; the speed error at 53 ~ 987650 counts/s against the
+  *          speed only counted over the period (M method); a ramp through
+  *          zero; the fall to 0 after a stop; the capture pair never torn by
+  *          an edge; index pulses, lost counts and a reversal over the index.
+  *          The errors and the host time of one update are printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static TIM_TypeDef HostTim2;
+static TIM_TypeDef HostTim3;
+static SysTick_Type HostSysTick;
+static uint32_t Tim2Accesses;
+static uint32_t EdgeAt;         /* an A edge at this TIM2 access, 0: never */
+
+static void EdgeNow(void);
+
+/**
+  * @brief TIM2 register block, counting the accesses
+  */
+static TIM_TypeDef *HostTim2Access(void)
+{
+  if (++Tim2Accesses == EdgeAt)
+  {
+    EdgeNow();
+  }
+  return &HostTim2;
+}
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef TIM2
+#define TIM2                        (HostTim2Access())
+#undef TIM3
+#define TIM3                        (&HostTim3)
+#undef SysTick
+#define SysTick                     (&HostSysTick)
+/* the bus inline functions were compiled with the device registers */
+#define MS32_AHB1_GRP1_EnableClock(Periphs)                 (HostRcc.AHBENR |= (Periphs))
+#define MS32_APB1_GRP1_EnableClock(Periphs)                 (HostRcc.APB1ENR |= (Periphs))
+/* the channel registers are reached through 32 bit address math */
+#define MS32_TIM_IC_Config(TIMx, Channel, Configuration)    ((void)(TIMx))
+/* SR is write 0 to clear */
+#define MS32_TIM_ClearFlag_UPDATE(TIMx)                     ((TIMx)->SR &= ~TIM_SR_UIF)
+#define MS32_TIM_ClearFlag_CC1(TIMx)                        ((TIMx)->SR &= ~TIM_SR_CC1IF)
+#define MS32_TIM_ClearFlag_CC3(TIMx)                        ((TIMx)->SR &= ~TIM_SR_CC3IF)
+/* reading a CCR clears its flag */
+#define MS32_TIM_IC_GetCaptureCH1(TIMx)                     (HostCcr(TIMx, 1))
+#define MS32_TIM_IC_GetCaptureCH3(TIMx)                     (HostCcr(TIMx, 3))
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+
+/**
+  * @brief CCR read, its flag cleared
+  */
+static uint32_t HostCcr(TIM_TypeDef *Tim, uint8_t Channel)
+{
+  if (Channel == 1U)
+  {
+    Tim->SR &= ~TIM_SR_CC1IF;
+    return Tim->CCR1;
+  }
+  Tim->SR &= ~TIM_SR_CC3IF;
+  return Tim->CCR3;
+}
+
+#include "../USER/ENCODER.c"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_TIMCLK_HZ               48000000.0
+#define SIM_STEP_S                  1e-6
+#define SIM_SPEED(X)                ((double)(X) / (1 << ENCODER_SPEED_SHIFT))
+#define UPDATE_LOOPS                1000000U
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000U;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static uint32_t HostMs;
+static double SimT;             /* s */
+static double SimPos;           /* counts, the encoder shaft */
+static int64_t Count;           /* counts TIM3 took, floor(SimPos) unless lost */
+static int64_t IndexShift;      /* counts lost: the index comes that much early */
+static uint8_t IrqHeld;
+static uint32_t PosBad;
+
+/* Stubs of the modules ENCODER calls ----------------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return HostMs;
+}
+
+ErrorStatus MS32_GPIO_Init(GPIO_TypeDef *GPIOx, MS32_GPIO_InitTypeDef *GpioInitStr)
+{
+  (void)GPIOx;
+  (void)GpioInitStr;
+  return SUCCESS;
+}
+
+void MS32_TIM_ENCODER_StructInit(MS32_TIM_ENCODER_InitTypeDef *TIM_EncoderInitStruct)
+{
+  memset(TIM_EncoderInitStruct, 0, sizeof(*TIM_EncoderInitStruct));
+}
+
+ErrorStatus MS32_TIM_ENCODER_Init(TIM_TypeDef *TIMx, MS32_TIM_ENCODER_InitTypeDef *TIM_EncoderInitStruct)
+{
+  CHECK_EQ(TIM_EncoderInitStruct->EncoderMode, MS32_TIM_ENCODERMODE_X4_TI12);
+  TIMx->SMCR = TIM_EncoderInitStruct->EncoderMode;
+  return SUCCESS;
+}
+
+/**
+  * @brief The TIM3 interrupt, unless held
+  */
+static void Irq(void)
+{
+  if (!IrqHeld && (HostTim3.SR & (TIM_SR_UIF | TIM_SR_CC3IF)))
+  {
+    Encoder_TIM3_IRQHandler();
+  }
+}
+
+/**
+  * @brief TIM2 time of a moment
+  */
+static uint32_t Cycles(double T)
+{
+  return (uint32_t)(uint64_t)(T * SIM_TIMCLK_HZ);
+}
+
+/**
+  * @brief One count taken by TIM3 at time T, Dir +1 / -1
+  */
+static void CountStep(int Dir, double T)
+{
+  uint32_t phase;
+
+  Count += Dir;
+  HostTim3.CNT = (uint16_t)Count;
+  if (((Dir > 0) && (HostTim3.CNT == 0U)) || ((Dir < 0) && (HostTim3.CNT == 0xFFFFU)))
+  {
+    HostTim3.SR |= TIM_SR_UIF;
+  }
+  /* A rising: 0 -> 1 up, 3 -> 2 down (A, B: 00 10 11 01) */
+  phase = (uint32_t)Count & 3U;
+  if (((Dir > 0) && (phase == 1U)) || ((Dir < 0) && (phase == 2U)))
+  {
+    HostTim3.SR |= (HostTim3.SR & TIM_SR_CC1IF) ? TIM_SR_CC1OF : 0U;
+    HostTim3.CCR1 = HostTim3.CNT;
+    HostTim3.SR |= TIM_SR_CC1IF;
+    HostTim2.CCR1 = Cycles(T);
+    HostTim2.SR |= TIM_SR_CC1IF;
+  }
+  /* the index is one count wide: latched on the way in, either way */
+  if ((((Count + IndexShift) % ENCODER_COUNTS_PER_REV) + ENCODER_COUNTS_PER_REV) % ENCODER_COUNTS_PER_REV == 0)
+  {
+    HostTim3.CCR3 = HostTim3.CNT;
+    HostTim3.SR |= TIM_SR_CC3IF;
+  }
+  Irq();
+}
+
+/**
+  * @brief Counts, one at a time at the same moment
+  */
+static void Step(int Counts)
+{
+  for (; Counts > 0; Counts--)
+  {
+    SimPos += 1.0;
+    CountStep(1, SimT);
+  }
+  for (; Counts < 0; Counts++)
+  {
+    SimPos -= 1.0;
+    CountStep(-1, SimT);
+  }
+}
+
+/**
+  * @brief Move the shaft at Speed counts/s for Dt
+  */
+static void Move(double Speed, double Dt)
+{
+  double to = SimPos + (Speed * Dt);
+  double n;
+
+  if (Speed > 0)
+  {
+    for (n = floor(SimPos) + 1.0; n <= to; n += 1.0)
+    {
+      CountStep(1, SimT + ((n - SimPos) / Speed));
+    }
+  }
+  else if (Speed < 0)
+  {
+    for (n = floor(SimPos); n > to; n -= 1.0)
+    {
+      CountStep(-1, SimT + ((n - SimPos) / Speed));
+    }
+  }
+  SimPos = to;
+  SimT += Dt;
+  HostTim2.CNT = Cycles(SimT);
+}
+
+/**
+  * @brief Up to the next A rising edge, now: the edge Encoder_Update() meets
+  */
+static void EdgeNow(void)
+{
+  do
+  {
+    SimPos += 1.0;
+    CountStep(1, SimT);
+  } while (((uint32_t)Count & 3U) != 1U);
+}
+
+/**
+  * @brief Run 1ms at a speed profile: Speed(t) counts/s, then an estimate
+  */
+static void Ms(double (*Speed)(double), double Arg)
+{
+  uint32_t i;
+
+  for (i = 0; i < 1000U; i++)
+  {
+    Move(Speed((SimT - Arg) + (SIM_STEP_S / 2)), SIM_STEP_S);
+  }
+  HostMs++;
+  Encoder_Poll();
+  PosBad += Encoder_GetPosition() != Count;
+}
+
+/* Speed profiles */
+static double Constant;
+static double SpeedConst(double T)
+{
+  (void)T;
+  return Constant;
+}
+
+/* 0 up to 200000 counts/s in 0.5s, down through 0 to -200000 in 1s, back to 0 */
+#define RAMP_ACCEL                  400000.0
+static double SpeedRamp(double T)
+{
+  if (T < 0.5)
+  {
+    return RAMP_ACCEL * T;
+  }
+  if (T < 1.5)
+  {
+    return 200000.0 - (RAMP_ACCEL * (T - 0.5));
+  }
+  return (T < 2.0) ? (-200000.0 + (RAMP_ACCEL * (T - 1.5))) : 0.0;
+}
+
+/**
+  * @brief Host time of one Encoder_Update(), ns
+  */
+static double UpdateNs(uint8_t Edge)
+{
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t i;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < UPDATE_LOOPS; i++)
+  {
+    if (Edge)
+    {
+      HostTim2.CCR1 += 48000U;
+      HostTim2.SR |= TIM_SR_CC1IF;
+      HostTim3.CCR1 = HostTim3.CNT;
+    }
+    Encoder_Update();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / UPDATE_LOOPS;
+}
+
+int main(void)
+{
+  static const double speeds[] = {53.0, -437.0, 4321.0, -43210.0, 432100.0, 987650.0};
+  Encoder_StatsTypeDef stats;
+  double err;
+  double errMax;
+  double mErrMax;
+  double v;
+  double last;
+  int64_t pos;
+  int64_t mPos;
+  uint32_t edgeTime;
+  uint32_t i;
+  uint32_t k;
+  uint32_t n;
+
+  HostSysTick.LOAD = 47999U;
+  Encoder_Init();
+  CHECK_EQ(HostTim3.SMCR, MS32_TIM_ENCODERMODE_X4_TI12);
+  CHECK(HostTim3.DIER & TIM_DIER_UIE);
+  CHECK(HostTim3.DIER & TIM_DIER_CC3IE);
+  CHECK_EQ(HostTim3.CR2 & TIM_CR2_MMS, MS32_TIM_TRGO_CC1IF);
+  CHECK_EQ(HostTim2.SMCR & TIM_SMCR_TS, ENCODER_TIME_TS);
+  CHECK_EQ(HostTim2.ARR, 0xFFFFFFFFU);
+  CHECK(HostTim2.CR1 & HostTim3.CR1 & TIM_CR1_CEN);
+  CHECK_EQ(Encoder_GetSpeed(), 0);
+
+  /* constant speeds: M/T against the counts of the period alone */
+  printf("   counts/s   M/T max error   M max error (counts/s)\n");
+  for (k = 0; k < (sizeof(speeds) / sizeof(speeds[0])); k++)
+  {
+    Constant = speeds[k];
+    /* settled: three edges on */
+    for (i = 0; i < (1U + (uint32_t)(12000.0 / fabs(Constant))); i++)
+    {
+      Ms(SpeedConst, 0);
+    }
+    errMax = 0;
+    mErrMax = 0;
+    mPos = Count;
+    for (i = 0; i < 1000U; i++)
+    {
+      Ms(SpeedConst, 0);
+      err = fabs(SIM_SPEED(Encoder_GetSpeed()) - Constant);
+      errMax = (err > errMax) ? err : errMax;
+      err = fabs((double)((Count - mPos) * 1000) - Constant);
+      mErrMax = (err > mErrMax) ? err : mErrMax;
+      mPos = Count;
+    }
+    printf("%11.0f %15.4f %13.1f\n", Constant, errMax, mErrMax);
+    /* a cycle of 48MHz over the edges of a period, and the speed LSB */
+    CHECK(errMax <= ((fabs(Constant) * 1e-4) + SIM_SPEED(1)));
+  }
+  CHECK_EQ(PosBad, 0);
+  Encoder_GetStats(&stats);
+  CHECK(stats.Overflows > 15U);
+  CHECK_EQ(stats.IndexErrors, 0);
+  CHECK(stats.IndexPulses > 100U);
+
+  /* a ramp through 0: the estimate lags the speed by about a period */
+  last = SimT;
+  errMax = 0;
+  for (i = 0; i < 2100U; i++)
+  {
+    Ms(SpeedRamp, last);
+    v = SpeedRamp(SimT - last);
+    if (fabs(v) > 10000.0)
+    {
+      err = fabs(SIM_SPEED(Encoder_GetSpeed()) - v);
+      errMax = (err > errMax) ? err : errMax;
+    }
+  }
+  printf("ramp at %.0f counts/s^2: max error %.1f counts/s above 10000 counts/s\n", RAMP_ACCEL, errMax);
+  CHECK(errMax < (RAMP_ACCEL * 1.5e-3));
+  CHECK_EQ(PosBad, 0);
+
+  /* a stop: the speed falls off with the time since the last edge, then 0 */
+  Constant = 4000.0;
+  for (i = 0; i < 20U; i++)
+  {
+    Ms(SpeedConst, 0);
+  }
+  Constant = 0;
+  last = SIM_SPEED(Encoder_GetSpeed());
+  for (i = 1; i <= ENCODER_STOP_MS; i++)
+  {
+    Ms(SpeedConst, 0);
+    v = SIM_SPEED(Encoder_GetSpeed());
+    CHECK(v <= last);
+    CHECK(v <= (ENCODER_EDGE_COUNTS * 1000.0 / (i - 1U + 0.001)) + 1.0);
+    last = v;
+    if (i == (ENCODER_STOP_MS - 2U))
+    {
+      CHECK(v > 0);
+    }
+  }
+  CHECK_EQ(Encoder_GetSpeed(), 0);
+  CHECK_EQ(EdgeValid, 0);
+  /* and back: two edges for a speed */
+  Constant = -2000.0;
+  for (i = 0; i < 10U; i++)
+  {
+    Ms(SpeedConst, 0);
+  }
+  CHECK(fabs(SIM_SPEED(Encoder_GetSpeed()) + 2000.0) <= (2000.0 * 1e-4) + SIM_SPEED(1));
+
+  /* an edge between any two TIM2 reads of an update: the pair stays one edge */
+  Constant = 0;
+  for (n = 1; n <= 20U; n++)
+  {
+    HostMs++;
+    Ms(SpeedConst, 0);
+    SimT += 1e-4;
+    HostTim2.CNT = Cycles(SimT);
+    Tim2Accesses = 0;
+    EdgeAt = n;
+    HostMs++;
+    Encoder_Poll();
+    EdgeAt = 0;
+    if (Tim2Accesses < n)
+    {
+      /* past the last read */
+      break;
+    }
+    edgeTime = HostTim2.CCR1;
+    CHECK_EQ(EdgeTime, edgeTime);
+    CHECK_EQ((uint16_t)EdgePos, (uint16_t)HostTim3.CCR1);
+    CHECK_EQ(CaptureTime, edgeTime);
+  }
+  /* an edge at each read of the first pass */
+  CHECK(n > 4U);
+  CHECK_EQ(Encoder_GetPosition(), Count);
+
+  /* wraps: pending while the position is read, and a reversal before the
+     interrupt, up and down */
+  while (HostTim3.CNT != 0xFFFDU)
+  {
+    SimPos += 1.0;
+    CountStep(1, SimT);
+  }
+  IrqHeld = 1;
+  Step(6);                      /* to 3 */
+  CHECK(HostTim3.SR & TIM_SR_UIF);
+  CHECK_EQ(Encoder_GetPosition(), Count);
+  CHECK_EQ(HostTim3.SR & TIM_SR_UIF, 0);
+  Step(-2);
+  IrqHeld = 0;
+  Irq();
+  CHECK_EQ(Encoder_GetPosition(), Count);
+  IrqHeld = 1;
+  Step(3);                      /* up over 0 to 2, turned: 1 */
+  Step(-1);
+  IrqHeld = 0;
+  Irq();
+  CHECK_EQ(Encoder_GetPosition(), Count);
+  IrqHeld = 1;
+  Step(-3);                     /* down over 0 to 0xFFFE, turned: 0xFFFF */
+  Step(1);
+  IrqHeld = 0;
+  Irq();
+  CHECK_EQ(Encoder_GetPosition(), Count);
+
+  /* index: whole revolutions, 3 counts lost, back over the same index */
+  Encoder_GetStats(&stats);
+  k = stats.IndexPulses;
+  n = stats.IndexErrors;
+  Constant = 400000.0;
+  for (i = 0; i < 100U; i++)
+  {
+    Ms(SpeedConst, 0);          /* 10 revolutions */
+  }
+  Encoder_GetStats(&stats);
+  CHECK((stats.IndexPulses - k) >= 9U);
+  CHECK_EQ(stats.IndexErrors, n);
+  IndexShift += 3;
+  for (i = 0; i < 20U; i++)
+  {
+    Ms(SpeedConst, 0);
+  }
+  Encoder_GetStats(&stats);
+  CHECK_EQ(stats.IndexErrors, n + 1U);
+  CHECK_EQ(stats.LastIndexError, -3);
+  Constant = -400000.0;
+  for (i = 0; i < 20U; i++)
+  {
+    Ms(SpeedConst, 0);
+  }
+  Encoder_GetStats(&stats);
+  CHECK_EQ(stats.IndexErrors, n + 1U);
+  CHECK_EQ(PosBad, 0);
+  CHECK(stats.Updates > 5000U);
+
+  printf("Encoder_Update() host time: no edge %.1f ns, new edge %.1f ns\n", UpdateNs(0), UpdateNs(1));
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,237 @@
+/**
+  ******************************************************************************
+  * @file 		test_energy.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the ENERGY time in state and charge accumulator
+  *
+  *          ENERGY.c runs on RAM copies of the RCC and RTC registers,
+  *          SysTick_GetUs() and RtcWake_GetTicks() return the model time
+  *          (1024 RTC ticks a second).
+  *          Checked: nothing is accounted before Energy_Init(); the charge
+  *          of RUN and SLEEP (uA per MHz of HCLK, state and enabled clocks,
+  *          TIM2 included) and of STOP / STOP_LP (state only) to the uA.us;
+  *          one hour at a known current gives that current in uAh; STOP
+  *          timed on the RTC, over midnight, and on SysTick alone without
+  *          the RTC; the clock enables sampled at each mode change and poll;
+  *          the average current; the command pages and their lengths within
+  *          USART1_PKT_MAX_PAYLOAD.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static RTC_TypeDef HostRtc;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef RTC
+#define RTC                         (&HostRtc)
+
+#include "../USER/ENERGY.c"
+#include "USART1_PKT.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_TICK_HZ                 1024U
+#define SIM_DAY_TICKS               (86400U * SIM_TICK_HZ)
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000U;
+
+static uint32_t HostUs;
+static uint32_t HostTicks;
+static uint8_t RtcRunning = 1;
+
+/* Stubs of the modules ENERGY calls -----------------------------------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return HostUs;
+}
+
+uint8_t RtcWake_GetTicks(uint32_t *Ticks)
+{
+  if (!RtcRunning)
+  {
+    return 0;
+  }
+  *Ticks = HostTicks;
+  return 1;
+}
+
+/**
+  * @brief Read back a 32 bit value LSB first
+  */
+static uint32_t Get32(const uint8_t *Buf)
+{
+  return Buf[0] | ((uint32_t)Buf[1] << 8) | ((uint32_t)Buf[2] << 16) | ((uint32_t)Buf[3] << 24);
+}
+
+/**
+  * @brief Reset the accumulator
+  */
+static void Reset(void)
+{
+  memset(StateUs, 0, sizeof(StateUs));
+  memset(ClockUs, 0, sizeof(ClockUs));
+  Charge = 0;
+  StopUntimed = 0;
+  Started = 0;
+}
+
+int main(void)
+{
+  Energy_ReportTypeDef report;
+  uint8_t req[1] = {0};
+  uint8_t rsp[USART1_PKT_MAX_PAYLOAD + 8];
+  uint64_t expect;
+  uint32_t mhz;
+  uint32_t ua;
+  uint8_t len;
+  uint8_t i;
+
+  HostRtc.PRER = SIM_TICK_HZ - 1U;
+  HostRcc.AHBENR = RCC_AHBENR_DMAEN;
+  HostRcc.APB1ENR = RCC_APB1ENR_TIM2EN;
+
+  /* before Energy_Init(): nothing */
+  Energy_Enter(POWER_MGR_SLEEP);
+  HostUs += 1000U;
+  Energy_Enter(POWER_MGR_RUN);
+  CHECK_EQ(Charge, 0);
+  CHECK_EQ(StateUs[POWER_MGR_SLEEP], 0);
+
+  /* RUN at 48MHz with DMA and TIM2 */
+  mhz = SystemCoreClock / 1000000U;
+  Energy_Init();
+  HostUs += 1000U;
+  Energy_Poll();
+  CHECK_EQ(StateUs[POWER_MGR_RUN], 1000);
+  CHECK_EQ(ClockUs[ENERGY_CLK_DMA], 1000);
+  CHECK_EQ(ClockUs[ENERGY_CLK_TIM2], 1000);
+  CHECK_EQ(ClockUs[ENERGY_CLK_USART1], 0);
+  expect = 1000ULL * ((ENERGY_RUN_UA_PER_MHZ + ClockUaPerMhz[ENERGY_CLK_DMA] +
+                       ClockUaPerMhz[ENERGY_CLK_TIM2]) * mhz);
+  CHECK_EQ(Charge, expect);
+
+  /* SLEEP with USART1 enabled after the poll: seen from the next sample */
+  HostRcc.APB2ENR = RCC_APB2ENR_USART1EN;
+  Energy_Enter(POWER_MGR_SLEEP);
+  HostUs += 500U;
+  Energy_Enter(POWER_MGR_RUN);
+  CHECK_EQ(StateUs[POWER_MGR_SLEEP], 500);
+  CHECK_EQ(ClockUs[ENERGY_CLK_USART1], 500);
+  expect += 500ULL * ((ENERGY_SLEEP_UA_PER_MHZ + ClockUaPerMhz[ENERGY_CLK_DMA] +
+                       ClockUaPerMhz[ENERGY_CLK_TIM2] + ClockUaPerMhz[ENERGY_CLK_USART1]) * mhz);
+  CHECK_EQ(Charge, expect);
+
+  /* STOP timed on the RTC: 2s, the clocks are not charged */
+  HostTicks = 1000U;
+  Energy_Enter(POWER_MGR_STOP);
+  HostTicks += 2U * SIM_TICK_HZ;
+  HostUs += 7U;
+  Energy_Enter(POWER_MGR_RUN);
+  CHECK_EQ(StateUs[POWER_MGR_STOP], 2000000);
+  CHECK_EQ(ClockUs[ENERGY_CLK_DMA], 1500);
+  expect += 2000000ULL * ENERGY_STOP_UA;
+  CHECK_EQ(Charge, expect);
+
+  /* STOP_LP over midnight: 0.5s */
+  HostTicks = SIM_DAY_TICKS - (SIM_TICK_HZ / 4U);
+  Energy_Enter(POWER_MGR_STOP_LP);
+  HostTicks = SIM_TICK_HZ / 4U;
+  Energy_Enter(POWER_MGR_RUN);
+  CHECK_EQ(StateUs[POWER_MGR_STOP_LP], 500000);
+  expect += 500000ULL * ENERGY_STOP_LP_UA;
+  CHECK_EQ(Charge, expect);
+  CHECK_EQ(StopUntimed, 0);
+
+  /* STOP without the RTC: the SysTick part only */
+  RtcRunning = 0;
+  Energy_Enter(POWER_MGR_STOP);
+  HostUs += 30U;
+  Energy_Enter(POWER_MGR_RUN);
+  CHECK_EQ(StateUs[POWER_MGR_STOP], 2000030);
+  CHECK_EQ(StopUntimed, 1);
+  expect += 30ULL * ENERGY_STOP_UA;
+  CHECK_EQ(Charge, expect);
+  RtcRunning = 1;
+
+  /* the report: average current over all states */
+  Energy_GetReport(&report);
+  CHECK_EQ(report.StateMs[POWER_MGR_RUN], 1);
+  CHECK_EQ(report.StateMs[POWER_MGR_STOP], 2000);
+  CHECK_EQ(report.StateMs[POWER_MGR_STOP_LP], 500);
+  CHECK_EQ(report.ClockMs[ENERGY_CLK_TIM2], 1);
+  CHECK_EQ(report.StopUntimed, 1);
+  CHECK_EQ(report.AverageUA, expect / (1000U + 500U + 2000030U + 500000U));
+  CHECK_EQ(report.ChargeUAh, 0);
+
+  /* one hour of RUN at 8MHz, TIM2 alone: that many uAh */
+  Reset();
+  SystemCoreClock = 8000000U;
+  mhz = 8U;
+  HostRcc.AHBENR = 0;
+  HostRcc.APB1ENR = RCC_APB1ENR_TIM2EN;
+  HostRcc.APB2ENR = 0;
+  ua = (ENERGY_RUN_UA_PER_MHZ + ClockUaPerMhz[ENERGY_CLK_TIM2]) * mhz;
+  Energy_Init();
+  for (i = 0; i < 6U; i++)
+  {
+    /* ten minutes a poll, within the 32 bit us wrap */
+    HostUs += 600000000U;
+    Energy_Poll();
+  }
+  Energy_GetReport(&report);
+  CHECK_EQ(report.StateMs[POWER_MGR_RUN], 3600000);
+  CHECK_EQ(report.ClockMs[ENERGY_CLK_TIM2], 3600000);
+  CHECK_EQ(report.ChargeUAh, ua);
+  CHECK_EQ(report.AverageUA, ua);
+  printf("1h RUN at 8MHz with TIM2: %uuAh, average %uuA\n", report.ChargeUAh, report.AverageUA);
+
+  /* command pages */
+  len = Energy_CmdHandler(req, 0, rsp);
+  CHECK_EQ(rsp[0], ENERGY_PAGE_STATES);
+  CHECK_EQ(len, 1 + (4 * ENERGY_STATES) + 12);
+  CHECK_EQ(Get32(&rsp[1 + (4 * POWER_MGR_RUN)]), 3600000);
+  CHECK_EQ(Get32(&rsp[len - 8]), ua);
+  CHECK_EQ(Get32(&rsp[len - 4]), ua);
+  CHECK(len <= USART1_PKT_MAX_PAYLOAD);
+
+  req[0] = ENERGY_PAGE_CLOCKS;
+  len = Energy_CmdHandler(req, 1, rsp);
+  CHECK_EQ(rsp[0], ENERGY_PAGE_CLOCKS);
+  CHECK_EQ(len, 1 + (4 * ENERGY_PAGE_CLOCKS_MAX));
+  CHECK(len <= USART1_PKT_MAX_PAYLOAD);
+  CHECK_EQ(Get32(&rsp[1 + (4 * ENERGY_CLK_DMA)]), 0);
+
+  req[0] = ENERGY_PAGE_CLOCKS2;
+  len = Energy_CmdHandler(req, 1, rsp);
+  CHECK_EQ(rsp[0], ENERGY_PAGE_CLOCKS2);
+  CHECK_EQ(len, 1 + (4 * (ENERGY_CLOCKS - ENERGY_PAGE_CLOCKS_MAX)));
+  CHECK_EQ(Get32(&rsp[1 + (4 * (ENERGY_CLK_TIM2 - ENERGY_PAGE_CLOCKS_MAX))]), 3600000);
+
+  /* unknown page: the states */
+  req[0] = 0x7FU;
+  len = Energy_CmdHandler(req, 1, rsp);
+  CHECK_EQ(rsp[0], ENERGY_PAGE_STATES);
+  CHECK_EQ(len, 1 + (4 * ENERGY_STATES) + 12);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,347 @@
+/**
+  ******************************************************************************
+  * @file 		test_exti_input.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the debounced EXTI inputs with bouncing edges
+  *
+  *          ExtiInput_Init(), ExtiInput_IRQHandler() and ExtiInput_Poll()
+  *          run on RAM copies of the EXTI, SYSCFG, RCC, SysTick and GPIO
+  *          registers (the GPIO blocks 0x400 apart as on the chip). The
+  *          edge model latches EXTI_PR for every edge of a line with a
+  *          trigger, interrupts when the line is unmasked, and keeps a line
+  *          pending until the driver clears it; time is a 1ms tick.
+  *          Bursts of contact bounce (edges 50~900us apart) are injected on
+  *          press and release.
+  *          Checked: one interrupt per burst, the line masked until the
+  *          debounce ends, press / release / long / click / double / train
+  *          events, a glitch back to the old level counted as a bounce,
+  *          edges of two lines in one interrupt, the EXTICR port codes, and
+  *          that a line SPI1_SLAVE already triggers on (line 4) is refused.
+  *          The host time of one interrupt dispatch is printed for one and
+  *          for three pending lines.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DISPATCH_LOOPS              1000000U
+
+static EXTI_TypeDef HostExti;
+static SYSCFG_TypeDef HostSyscfg;
+static RCC_TypeDef HostRcc;
+static SysTick_Type HostSysTick;
+static uint32_t HostGpio[6][0x100];     /* GPIOA ~ GPIOF, 0x400 bytes each */
+static uint32_t HostPending;            /* EXTI_PR as the hardware keeps it */
+
+#undef EXTI
+#define EXTI                        (&HostExti)
+#undef SYSCFG
+#define SYSCFG                      (&HostSyscfg)
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef SysTick
+#define SysTick                     (&HostSysTick)
+#undef GPIOA_BASE
+#define GPIOA_BASE                  ((uint32_t)HostGpio[0])
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+#define MS32_APB1_GRP2_EnableClock(Periphs)                 ((void)0)
+
+#include "../USER/EXTI_INPUT.c"
+
+/* Private define ------------------------------------------------------------*/
+#define PORT_A                      ((GPIO_TypeDef *)HostGpio[0])
+#define PORT_B                      ((GPIO_TypeDef *)HostGpio[1])
+#define PORT_C                      ((GPIO_TypeDef *)HostGpio[2])
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t SimMs;
+static uint8_t EvtPin[64];
+static uint8_t EvtType[64];
+static uint8_t EvtCount[64];
+static uint32_t Evts;
+static uint32_t Irqs;
+
+/* Stubs of the modules EXTI_INPUT calls -----------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return SimMs;
+}
+
+static void Event(uint8_t Pin, uint8_t Type, uint8_t Count)
+{
+  if (Evts < sizeof(EvtPin))
+  {
+    EvtPin[Evts] = Pin;
+    EvtType[Evts] = Type;
+    EvtCount[Evts] = Count;
+    Evts++;
+  }
+}
+
+static const ExtiInput_PinTypeDef Keys[3] =
+{
+  {PORT_A, 0, 1, Event},        /* PA0 to ground, pull-up */
+  {PORT_B, 5, 0, Event},        /* PB5 to VDD, pull-down */
+  {PORT_C, 13, 1, Event},
+};
+
+/**
+  * @brief EXTI4_15 / EXTI0_1 interrupt: PR as latched, the driver's write
+  *        clears what it saw
+  */
+static void Irq(void)
+{
+  uint32_t seen = HostPending & Lines;
+
+  if ((HostPending & HostExti.IMR) == 0U)
+  {
+    return;
+  }
+  Irqs++;
+  HostExti.PR = HostPending;
+  ExtiInput_IRQHandler();
+  HostPending &= ~seen;
+  HostExti.PR = HostPending;
+}
+
+/**
+  * @brief Set a pin level; an edge latches its line if it has a trigger
+  */
+static void Level(GPIO_TypeDef *Port, uint8_t Pin, uint8_t High)
+{
+  uint32_t bit = 1UL << Pin;
+  uint32_t old = Port->IDR & bit;
+
+  Port->IDR = High ? (Port->IDR | bit) : (Port->IDR & ~bit);
+  if ((old == 0U) && High && (HostExti.RTSR & bit))
+  {
+    HostPending |= bit;
+  }
+  if (old && !High && (HostExti.FTSR & bit))
+  {
+    HostPending |= bit;
+  }
+  Irq();
+}
+
+/**
+  * @brief Time passes in 1ms ticks, ExtiInput_Poll() once per tick; the
+  *        lines it clears and unmasks behave as on the chip
+  */
+static void Wait(uint32_t Ms)
+{
+  uint32_t before;
+
+  while (Ms-- != 0U)
+  {
+    SimMs++;
+    before = Bouncing;
+    HostExti.PR = HostPending;
+    ExtiInput_Poll();
+    HostPending &= ~(before & ~Bouncing);
+    HostExti.PR = HostPending;
+    /* unmasked with an edge latched after the read */
+    Irq();
+  }
+}
+
+/**
+  * @brief Contact bounce to a new level: 5 edges within 3ms
+  */
+static void Chatter(GPIO_TypeDef *Port, uint8_t Pin, uint8_t To)
+{
+  Level(Port, Pin, To);
+  Level(Port, Pin, !To);
+  Level(Port, Pin, To);
+  Wait(1);
+  Level(Port, Pin, !To);
+  Level(Port, Pin, To);
+  Wait(2);
+}
+
+/**
+  * @brief Host time of one interrupt dispatch with Pending lines
+  * @retval ns
+  */
+static double DispatchNs(uint32_t Pending)
+{
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t i;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < DISPATCH_LOOPS; i++)
+  {
+    HostExti.PR = Pending;
+    ExtiInput_IRQHandler();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / DISPATCH_LOOPS;
+}
+
+int main(void)
+{
+  static const ExtiInput_PinTypeDef nss[1] = {{PORT_A, 4, 1, Event}};
+  ExtiInput_StatsTypeDef stats;
+  double one;
+  double three;
+
+  /* idle levels: PA0 / PC13 high (pull-up), PB5 low */
+  PORT_A->IDR = 1U << 0;
+  PORT_C->IDR = 1U << 13;
+  HostSysTick.LOAD = 47999;
+
+  /* line 4 is the SPI1 slave NSS edge: refused, nothing changed */
+  HostExti.RTSR = MS32_EXTI_LINE_4;
+  CHECK(ExtiInput_Init(nss, 1) == ERROR);
+  CHECK_EQ(HostExti.FTSR, 0);
+  CHECK_EQ(Lines, 0);
+  CHECK(ExtiInput_Init(Keys, EXTI_INPUT_MAX_PINS + 1U) == ERROR);
+
+  CHECK(ExtiInput_Init(Keys, 3) == SUCCESS);
+  CHECK_EQ(HostSyscfg.EXTICR[0] & 0xFU, 0);
+  CHECK_EQ((HostSyscfg.EXTICR[1] >> 4) & 0xFU, 1);
+  CHECK_EQ((HostSyscfg.EXTICR[3] >> 4) & 0xFU, 2);
+  CHECK_EQ(HostExti.RTSR, MS32_EXTI_LINE_4 | (1U << 0) | (1U << 5) | (1U << 13));
+  CHECK_EQ(HostExti.IMR, 0);
+  /* a changed table releases the old lines, the SPI1 one stays */
+  CHECK(ExtiInput_Init(Keys, 2) == SUCCESS);
+  CHECK_EQ(HostExti.FTSR, (1U << 0) | (1U << 5));
+  CHECK(ExtiInput_Init(Keys, 3) == SUCCESS);
+
+  /* start state after the debounce time, no event */
+  Wait(EXTI_INPUT_DEBOUNCE_MS + 1U);
+  CHECK_EQ(HostExti.IMR, (1U << 0) | (1U << 5) | (1U << 13));
+  CHECK_EQ(Evts, 0);
+  CHECK_EQ(ExtiInput_IsPressed(0), 0);
+
+  /* bouncing press: one interrupt, the line masked until the debounce ends */
+  Chatter(PORT_A, 0, 0);
+  CHECK_EQ(Irqs, 1);
+  CHECK_EQ(HostExti.IMR & 1U, 0);
+  CHECK_EQ(Evts, 0);
+  Wait(EXTI_INPUT_DEBOUNCE_MS);
+  CHECK_EQ(Evts, 1);
+  CHECK_EQ(EvtType[0], EXTI_INPUT_EVT_PRESS);
+  CHECK(ExtiInput_IsPressed(0));
+  CHECK_EQ(HostExti.IMR & 1U, 1);
+  /* bouncing release, then the click window */
+  Chatter(PORT_A, 0, 1);
+  CHECK_EQ(Irqs, 2);
+  Wait(EXTI_INPUT_DEBOUNCE_MS);
+  CHECK_EQ(EvtType[1], EXTI_INPUT_EVT_RELEASE);
+  Wait(EXTI_INPUT_CLICK_MS);
+  CHECK_EQ(Evts, 3);
+  CHECK_EQ(EvtType[2], EXTI_INPUT_EVT_CLICK);
+  CHECK_EQ(EvtCount[2], 1);
+
+  /* double click on PB5 (active high) */
+  Evts = 0;
+  Chatter(PORT_B, 5, 1);
+  Wait(60);
+  Chatter(PORT_B, 5, 0);
+  Wait(60);
+  Chatter(PORT_B, 5, 1);
+  Wait(60);
+  Chatter(PORT_B, 5, 0);
+  Wait(EXTI_INPUT_CLICK_MS + EXTI_INPUT_DEBOUNCE_MS);
+  CHECK_EQ(Evts, 5);
+  CHECK_EQ(EvtPin[4], 5);
+  CHECK_EQ(EvtType[4], EXTI_INPUT_EVT_DOUBLE);
+  CHECK_EQ(EvtCount[4], 2);
+
+  /* three clicks: pulse train */
+  Evts = 0;
+  Chatter(PORT_C, 13, 0);
+  Wait(50);
+  Chatter(PORT_C, 13, 1);
+  Wait(50);
+  Chatter(PORT_C, 13, 0);
+  Wait(50);
+  Chatter(PORT_C, 13, 1);
+  Wait(50);
+  Chatter(PORT_C, 13, 0);
+  Wait(50);
+  Chatter(PORT_C, 13, 1);
+  Wait(EXTI_INPUT_CLICK_MS + EXTI_INPUT_DEBOUNCE_MS);
+  CHECK_EQ(Evts, 7);
+  CHECK_EQ(EvtType[6], EXTI_INPUT_EVT_TRAIN);
+  CHECK_EQ(EvtCount[6], 3);
+
+  /* long press, no click after it */
+  Evts = 0;
+  Chatter(PORT_A, 0, 0);
+  Wait(EXTI_INPUT_LONG_MS + EXTI_INPUT_DEBOUNCE_MS);
+  CHECK_EQ(Evts, 2);
+  CHECK_EQ(EvtType[1], EXTI_INPUT_EVT_LONG);
+  Chatter(PORT_A, 0, 1);
+  Wait(EXTI_INPUT_CLICK_MS + EXTI_INPUT_DEBOUNCE_MS);
+  CHECK_EQ(Evts, 3);
+  CHECK_EQ(EvtType[2], EXTI_INPUT_EVT_RELEASE);
+
+  /* a glitch that ends on the old level: a bounce, no event */
+  ExtiInput_GetStats(&stats);
+  Evts = 0;
+  Level(PORT_B, 5, 1);
+  Level(PORT_B, 5, 0);
+  Wait(EXTI_INPUT_DEBOUNCE_MS + 1U);
+  CHECK_EQ(Evts, 0);
+  {
+    ExtiInput_StatsTypeDef now;
+
+    ExtiInput_GetStats(&now);
+    CHECK_EQ(now.Bounces - stats.Bounces, 1);
+    CHECK_EQ(now.Edges - stats.Edges, 1);
+  }
+
+  /* two lines in one interrupt */
+  Irqs = 0;
+  HostPending |= (1U << 0) | (1U << 13);
+  PORT_A->IDR &= ~(1U << 0);
+  PORT_C->IDR &= ~(1U << 13);
+  Irq();
+  CHECK_EQ(Irqs, 1);
+  CHECK_EQ(HostExti.IMR, 1U << 5);
+  Wait(EXTI_INPUT_DEBOUNCE_MS);
+  CHECK(ExtiInput_IsPressed(0));
+  CHECK(ExtiInput_IsPressed(13));
+  /* line 4 pending for the SPI1 slave is neither taken nor cleared */
+  HostPending |= MS32_EXTI_LINE_4;
+  HostExti.IMR |= MS32_EXTI_LINE_4;
+  Irq();
+  CHECK_EQ(HostPending, MS32_EXTI_LINE_4);
+  HostPending = 0;
+
+  ExtiInput_GetStats(&stats);
+  printf("%u edges taken, %u bounces, %u events\n", stats.Edges, stats.Bounces, stats.Events);
+  CHECK_EQ(stats.Edges, 17);
+  CHECK_EQ(stats.Bounces, 1);
+  CHECK_EQ(stats.Events, 20);
+
+  one = DispatchNs(1U << 5);
+  three = DispatchNs((1U << 0) | (1U << 5) | (1U << 13));
+  printf("dispatch: 1 line %.1f ns, 3 lines %.1f ns\n", one, three);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,350 @@
+/**
+  ******************************************************************************
+  * @file 		test_hsi_trim.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the HSI trimming loop against the LSE reference
+  *
+  *          HSI_TRIM.c (HSI_TRIM_REF 0) runs on RAM copies of the RCC and
+  *          TIM14 registers and a RAM flash page. The oscillator model gives
+  *          the real HSI error of a HSITRIM value: a part offset plus a
+  *          step 5% smaller than the nominal HSI_TRIM_STEP_PPM. TIM14 counts
+  *          the 48MHz timer clock derived from that HSI and latches the
+  *          counter on every 8th edge of a 32768Hz LSE; a capture on a set
+  *          CC1IF raises CC1OF and reading CCR1 clears CC1IF, as the
+  *          hardware does.
+  *          Checked: HsiTrim_Restore() takes the last valid record and skips
+  *          broken ones; the loop settles within one step for part offsets
+  *          of -5.2% ~ +5.2%, at most HSI_TRIM_MAX_STEPS a measurement; the trim
+  *          is saved once after HSI_TRIM_SETTLE quiet measurements and
+  *          again after a drift; a full page is erased before the next
+  *          record; a lost capture drops the measurement; nothing is
+  *          measured on HSE or before LSERDY; the trim stays in 0 ~ 31. The
+  *          measurements to settle are printed for each offset.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Private define ------------------------------------------------------------*/
+#define HSI_TRIM_REF                0
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+#define SIM_STEP_PPM                3800.0  /* real HSITRIM step of the part */
+#define SIM_TIMCLK_HZ               48000000.0
+#define SIM_LSE_HZ                  32768.0
+
+static RCC_TypeDef HostRcc;
+static TIM_TypeDef HostTim14;
+static uint32_t HostErases;
+static uint32_t HostWrites;
+static uint8_t HostLseReady = 1;
+static uint32_t HostIcConfig;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef TIM14
+#define TIM14                       (&HostTim14)
+/* the bus, PWR and RCC inline functions were compiled with the device registers */
+#define MS32_APB1_GRP1_EnableClock(Periphs)                 (HostRcc.APB1ENR |= (Periphs))
+#define MS32_PWR_EnableBkUpAccess()                         ((void)0)
+#define MS32_RCC_LSE_Enable()                               (HostRcc.BDCR |= RCC_BDCR_LSEON)
+#define MS32_RCC_LSE_IsReady()                              (HostLseReady)
+#define MS32_RCC_GetRTCClockSource()                        (HostRcc.BDCR & RCC_BDCR_RTCSEL)
+#define MS32_RCC_SetRTCClockSource(Source)                  (HostRcc.BDCR |= (Source))
+/* the channel registers are reached through 32 bit address math */
+#define MS32_TIM_IC_Config(TIMx, Channel, Configuration)    (HostIcConfig = (Configuration))
+/* SR is write 0 to clear */
+#define MS32_TIM_ClearFlag_CC1(TIMx)                        (HostTim14.SR &= ~TIM_SR_CC1IF)
+#define MS32_TIM_ClearFlag_CC1OVR(TIMx)                     (HostTim14.SR &= ~TIM_SR_CC1OF)
+/* reading CCR1 clears CC1IF */
+#define MS32_TIM_IC_GetCaptureCH1(TIMx)                     (HostTim14.SR &= ~TIM_SR_CC1IF, HostTim14.CCR1)
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+
+#include "HSI_TRIM.h"
+static uint32_t HostPage[HSI_TRIM_FLASH_PAGE_SIZE / 4U];
+/* the last flash page */
+#undef HSI_TRIM_FLASH_ADDR
+#define HSI_TRIM_FLASH_ADDR         ((uintptr_t)HostPage)
+
+#include "../USER/HSI_TRIM.c"
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000U;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static uint32_t HostMs;
+static double OffsetPpm;        /* HSI error of the part at HSITRIM 16 */
+static double Now;              /* s */
+static double Ticks;            /* timer clock periods since start */
+static double NextEdge;         /* s, next 8th LSE edge */
+static uint8_t DropCapture;     /* the next capture comes on a set CC1IF */
+
+/* Stubs of the modules HSI_TRIM calls ---------------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return HostMs;
+}
+
+void GPIO_ApplyTable(const GPIO_PinCfgTypeDef *Table, uint8_t Count)
+{
+  (void)Table;
+  (void)Count;
+}
+
+ErrorStatus MS32_FLASH_PageErase(uint32_t page)
+{
+  CHECK_EQ(page, HSI_TRIM_FLASH_PAGE);
+  memset(HostPage, 0xFF, sizeof(HostPage));
+  HostErases++;
+  return SUCCESS;
+}
+
+ErrorStatus MS32_FLASH_Write(uint32_t addr, uint8_t *dat_buf, uint32_t len)
+{
+  uint32_t i = (addr - (uint32_t)(uintptr_t)HostPage) / 4U;
+
+  CHECK_EQ(len, 4);
+  CHECK(i < (sizeof(HostPage) / 4U));
+  CHECK_EQ(HostPage[i], HSI_TRIM_ERASED);
+  memcpy(&HostPage[i], dat_buf, 4U);
+  HostWrites++;
+  return SUCCESS;
+}
+
+/**
+  * @brief Real HSI error of the trim now, ppm
+  */
+static double HsiErrorPpm(void)
+{
+  uint32_t trim = (HostRcc.CR & RCC_CR_HSITRIM) >> RCC_CR_HSITRIM_Pos;
+
+  return OffsetPpm + (((double)trim - HSI_TRIM_DEFAULT) * SIM_STEP_PPM);
+}
+
+/**
+  * @brief One millisecond: TIM14 counts, the 8th LSE edges capture, SysTick
+  */
+static void Step(void)
+{
+  double end = Now + 0.001;
+  double rate = SIM_TIMCLK_HZ * (1.0 + (HsiErrorPpm() / 1e6));
+
+  while (NextEdge < end)
+  {
+    Ticks += (NextEdge - Now) * rate;
+    Now = NextEdge;
+    NextEdge += 8.0 / SIM_LSE_HZ;
+    if (HostRcc.BDCR & RCC_BDCR_LSEON)
+    {
+      HostTim14.CCR1 = (uint32_t)Ticks & 0xFFFFU;
+      if ((HostTim14.SR & TIM_SR_CC1IF) || DropCapture)
+      {
+        HostTim14.SR |= TIM_SR_CC1OF;
+        DropCapture = 0;
+      }
+      HostTim14.SR |= TIM_SR_CC1IF;
+      if (HostTim14.DIER & TIM_DIER_CC1IE)
+      {
+        HsiTrim_TIM14_IRQHandler();
+      }
+    }
+  }
+  Ticks += (end - Now) * rate;
+  Now = end;
+  HostMs++;
+}
+
+/**
+  * @brief Run Ms with HsiTrim_Poll() every 10ms
+  */
+static void Run(uint32_t Ms)
+{
+  while (Ms-- != 0U)
+  {
+    Step();
+    if ((HostMs % 10U) == 0U)
+    {
+      HsiTrim_Poll();
+    }
+  }
+}
+
+/**
+  * @brief Run until Count more measurements are done
+  */
+static void Measure(uint32_t Count)
+{
+  uint32_t target = TrimStats.Measurements + TrimStats.Overcaptures + Count;
+  uint32_t limit = HostMs + (Count * 2U * HSI_TRIM_PERIOD_MS);
+
+  while (((TrimStats.Measurements + TrimStats.Overcaptures) < target) && (HostMs < limit))
+  {
+    Run(1);
+  }
+}
+
+/**
+  * @brief Records in the page
+  */
+static uint32_t Records(void)
+{
+  uint32_t i;
+
+  for (i = 0; (i < (sizeof(HostPage) / 4U)) && (HostPage[i] != HSI_TRIM_ERASED); i++)
+  {
+  }
+  return i;
+}
+
+/**
+  * @brief A part with its offset from reset: restore, init, settle
+  * @retval measurements until settled and saved
+  */
+static uint32_t Settle(double Offset)
+{
+  uint32_t n;
+  int32_t last = 0;
+  uint8_t trim;
+
+  OffsetPpm = Offset;
+  MODIFY_REG(HostRcc.CR, RCC_CR_HSITRIM, HSI_TRIM_DEFAULT << RCC_CR_HSITRIM_Pos);
+  memset(&TrimStats, 0, sizeof(TrimStats));
+  HsiTrim_Restore();
+  HsiTrim_Init();
+  for (n = 0; (n < 40U) && (TrimStats.Saves == 0U); n++)
+  {
+    trim = TrimStats.Trim;
+    Measure(1);
+    CHECK(abs((int32_t)TrimStats.Trim - (int32_t)trim) <= HSI_TRIM_MAX_STEPS);
+    CHECK(TrimStats.Trim <= HSI_TRIM_MAX);
+    last = TrimStats.LastErrorPpm;
+  }
+  CHECK_EQ(TrimStats.Saves, 1);
+  CHECK(abs(last) <= (HSI_TRIM_STEP_PPM / 2));
+  CHECK(fabs(HsiErrorPpm()) <= (SIM_STEP_PPM / 2.0) + 500.0);
+  CHECK_EQ(TrimStats.Settled, HSI_TRIM_SETTLE);
+  return n;
+}
+
+int main(void)
+{
+  static const int32_t offsets[] = {-52000, -25000, -9000, -1000, 0, 3000, 17000, 52000};
+  HsiTrim_StatsTypeDef stats;
+  uint32_t i;
+  uint32_t n;
+
+  memset(HostPage, 0xFF, sizeof(HostPage));
+  HostRcc.CFGR = RCC_CFGR_SW_PLL | RCC_CFGR_SWS_PLL | RCC_CFGR_PLLSRC_HSI_DIV2;
+  NextEdge = 8.0 / SIM_LSE_HZ;
+
+  /* restore: the last good record, broken ones skipped, erased page untouched */
+  MODIFY_REG(HostRcc.CR, RCC_CR_HSITRIM, HSI_TRIM_DEFAULT << RCC_CR_HSITRIM_Pos);
+  HsiTrim_Restore();
+  CHECK_EQ((HostRcc.CR & RCC_CR_HSITRIM) >> RCC_CR_HSITRIM_Pos, HSI_TRIM_DEFAULT);
+  HostPage[0] = HSI_TRIM_RECORD(12U);
+  HostPage[1] = HSI_TRIM_RECORD(20U);
+  HostPage[2] = HSI_TRIM_RECORD(9U) ^ 0x00010000U;
+  HostPage[3] = HSI_TRIM_RECORD(40U);
+  HsiTrim_Restore();
+  CHECK_EQ((HostRcc.CR & RCC_CR_HSITRIM) >> RCC_CR_HSITRIM_Pos, 20);
+  memset(HostPage, 0xFF, sizeof(HostPage));
+
+  /* init: LSE on and selected for the RTC, TIM14 capturing */
+  HsiTrim_Init();
+  CHECK(HostRcc.BDCR & RCC_BDCR_LSEON);
+  CHECK_EQ(HostRcc.BDCR & RCC_BDCR_RTCSEL, MS32_RCC_RTC_CLKSOURCE_LSE);
+  CHECK(HostTim14.CR1 & TIM_CR1_CEN);
+  CHECK(HostTim14.CCER & TIM_CCER_CC1E);
+  CHECK_EQ(HostIcConfig & MS32_TIM_ICPSC_DIV8, MS32_TIM_ICPSC_DIV8);
+
+  /* settling from part offsets */
+  for (i = 0; i < (sizeof(offsets) / sizeof(offsets[0])); i++)
+  {
+    n = Settle(offsets[i]);
+    HsiTrim_GetStats(&stats);
+    printf("HSI %+6dppm at trim 16: trim %2u after %2u measurements (%u adjusts), "
+           "error %+5dppm measured, %+6.0fppm real\n",
+           offsets[i], stats.Trim, n, stats.Adjusts, stats.LastErrorPpm, HsiErrorPpm());
+    memset(HostPage, 0xFF, sizeof(HostPage));
+  }
+  CHECK_EQ(HostErases, 0);
+
+  /* saved once, not again while nothing changes */
+  n = Settle(17000);
+  CHECK_EQ(Records(), 1);
+  Measure(10);
+  CHECK_EQ(TrimStats.Saves, 1);
+  CHECK_EQ(Records(), 1);
+  /* drift: one more record */
+  OffsetPpm -= 2.5 * SIM_STEP_PPM;
+  Measure(HSI_TRIM_SETTLE + 3U);
+  CHECK_EQ(TrimStats.Saves, 2);
+  CHECK_EQ(Records(), 2);
+  CHECK_EQ(HsiTrim_Load(), TrimStats.Trim);
+
+  /* a full page is erased before the next record */
+  for (i = Records(); i < (sizeof(HostPage) / 4U); i++)
+  {
+    HostPage[i] = HSI_TRIM_RECORD((uint32_t)TrimStats.Trim);
+  }
+  OffsetPpm += 2.5 * SIM_STEP_PPM;
+  Measure(HSI_TRIM_SETTLE + 3U);
+  CHECK_EQ(HostErases, 1);
+  CHECK_EQ(Records(), 1);
+  CHECK_EQ(HsiTrim_Load(), TrimStats.Trim);
+
+  /* a lost capture drops the measurement */
+  n = TrimStats.Measurements;
+  Run(HSI_TRIM_PERIOD_MS);
+  DropCapture = 1;
+  Measure(1);
+  CHECK_EQ(TrimStats.Overcaptures, 1);
+  CHECK_EQ(TrimStats.Measurements, n);
+  Measure(1);
+  CHECK_EQ(TrimStats.Measurements, n + 1U);
+
+  /* SYSCLK from HSE, or no LSE: nothing measured */
+  n = TrimStats.Measurements;
+  HostRcc.CFGR = RCC_CFGR_SW_PLL | RCC_CFGR_SWS_PLL | RCC_CFGR_PLLSRC_HSE_PREDIV;
+  Run(3U * HSI_TRIM_PERIOD_MS);
+  HostRcc.CFGR = RCC_CFGR_SW_HSE | RCC_CFGR_SWS_HSE;
+  Run(3U * HSI_TRIM_PERIOD_MS);
+  HostRcc.CFGR = RCC_CFGR_SW_PLL | RCC_CFGR_SWS_PLL | RCC_CFGR_PLLSRC_HSI_DIV2;
+  HostLseReady = 0;
+  Run(3U * HSI_TRIM_PERIOD_MS);
+  CHECK_EQ(TrimStats.Measurements, n);
+  HostLseReady = 1;
+  Measure(1);
+  CHECK_EQ(TrimStats.Measurements, n + 1U);
+
+  /* a reference far off: steps limited, trim kept in range */
+  OffsetPpm = 300000.0;
+  Measure(12);
+  CHECK_EQ(TrimStats.Trim, 0);
+  OffsetPpm = -300000.0;
+  Measure(12);
+  CHECK_EQ(TrimStats.Trim, HSI_TRIM_MAX);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
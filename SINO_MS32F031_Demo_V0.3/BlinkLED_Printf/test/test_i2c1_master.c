@@ -0,0 +1,320 @@
+/**
+  ******************************************************************************
+  * @file 		test_i2c1_master.c
+	* @author		SINOMCU-AE
+  * @brief 		Host throughput simulation of the I2C1 master engine
+  *
+  *          I2C1_Master_IRQHandler() runs on a RAM copy of the I2C1
+  *          registers against a bus model: every HandleTransfer() request
+  *          takes START + address (10 SCL) when it starts a phase, 9 SCL
+  *          per byte and 1 SCL for STOP, the SCL period taken from TIMINGR
+  *          as I2C1_TIMING.h builds it; TC / TCR stretch SCL until the
+  *          interrupt, each interrupt costs I2C_SIM_IRQ_NS. DMA is modelled
+  *          by moving the bytes of the active descriptor.
+  *          Transactions per second are measured at 100kHz, 400kHz and
+  *          1MHz (I2CCLK = 48MHz SYSCLK, 1MHz is rejected at HSI) for a
+  *          register read (1 byte write, 2 byte read) and a 300 byte burst
+  *          (RELOAD), queued back to back from the completion callback.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_I2CCLK_KHZ              48000U
+#define SIM_RISE_NS                 100U
+#define SIM_FALL_NS                 10U
+/* interrupt entry + handler at 48MHz, about 150 cycles */
+#define I2C_SIM_IRQ_NS              3000U
+#define SIM_SLAVE_ADDR              0x48U
+#define SIM_XFERS                   200U
+
+static I2C_TypeDef HostI2c1;
+static uint64_t SimNs;
+static uint32_t SclNs;
+static uint32_t PendingFlags;
+static uint64_t PendingNs;
+static uint8_t SimRead;
+static uint32_t TxPos;
+static uint32_t RxPos;
+static uint8_t SlaveReg;
+static uint8_t SlaveMem[256];
+
+static void HostHandleTransfer(I2C_TypeDef *I2Cx, uint32_t SlaveAddr, uint32_t SlaveAddrSize,
+                               uint32_t TransferSize, uint32_t EndMode, uint32_t Request);
+
+#undef I2C1
+#define I2C1                        (&HostI2c1)
+#define MS32_I2C_HandleTransfer     HostHandleTransfer
+/* DMA channel registers are reached through 32 bit address math; the bus
+   model moves the bytes of the active descriptor instead */
+#define MS32_DMA_DisableChannel(DMAx, Channel)              ((void)0)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               ((void)0)
+#define MS32_DMA_SetMemoryAddress(DMAx, Channel, Address)   ((void)0)
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       ((void)0)
+
+#include "../USER/I2C1_MASTER.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t RegNo[1];
+static uint8_t RxBuf[300];
+static uint32_t Submitted;
+static uint32_t Target;
+
+/* Stubs of the modules I2C1_MASTER calls ----------------------------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return (uint32_t)(SimNs / 1000U);
+}
+
+uint32_t SysTick_GetTick(void)
+{
+  return (uint32_t)(SimNs / 1000000U);
+}
+
+/**
+  * @brief Bus model of one CR2 write: START, address, NBYTES bytes, end
+  *        condition; the flag it raises is pending until the bus gets there
+  */
+static void HostHandleTransfer(I2C_TypeDef *I2Cx, uint32_t SlaveAddr, uint32_t SlaveAddrSize,
+                               uint32_t TransferSize, uint32_t EndMode, uint32_t Request)
+{
+  I2C1_XferTypeDef *xfer = Active;
+  uint64_t t = SimNs;
+  uint32_t i;
+
+  I2Cx->CR2 = SlaveAddr | SlaveAddrSize | (TransferSize << I2C_CR2_NBYTES_Pos) | EndMode | (Request & ~0x80000000U);
+  if (Request != MS32_I2C_GENERATE_NOSTARTSTOP)
+  {
+    SimRead = (Request == MS32_I2C_GENERATE_START_READ) ? 1U : 0U;
+    if (SimRead)
+    {
+      RxPos = 0;
+    }
+    else
+    {
+      TxPos = 0;
+    }
+    t += 10U * SclNs;
+    if ((SlaveAddr >> 1) != SIM_SLAVE_ADDR)
+    {
+      /* address NACK: AUTOEND sends STOP, the driver does otherwise */
+      PendingFlags = I2C_ISR_NACKF | ((EndMode == MS32_I2C_MODE_AUTOEND) ? I2C_ISR_STOPF : 0U);
+      PendingNs = t + ((EndMode == MS32_I2C_MODE_AUTOEND) ? SclNs : 0U);
+      return;
+    }
+  }
+
+  for (i = 0; i < TransferSize; i++)
+  {
+    if (SimRead)
+    {
+      xfer->RxBuf[RxPos++] = SlaveMem[SlaveReg++];
+    }
+    else if (TxPos++ == 0U)
+    {
+      SlaveReg = xfer->TxBuf[0];
+    }
+    else
+    {
+      SlaveMem[SlaveReg++] = xfer->TxBuf[TxPos - 1U];
+    }
+  }
+  t += (uint64_t)TransferSize * 9U * SclNs;
+
+  if (EndMode == MS32_I2C_MODE_RELOAD)
+  {
+    PendingFlags = I2C_ISR_TCR;
+  }
+  else if (EndMode == MS32_I2C_MODE_SOFTEND)
+  {
+    PendingFlags = I2C_ISR_TC;
+  }
+  else
+  {
+    PendingFlags = I2C_ISR_STOPF;
+    t += SclNs;
+  }
+  PendingNs = t;
+}
+
+/**
+  * @brief Run the bus and the interrupt until nothing is pending
+  * @param None
+  * @retval None
+  */
+static void Run(void)
+{
+  while (PendingFlags != 0U)
+  {
+    if (PendingNs > SimNs)
+    {
+      SimNs = PendingNs;
+    }
+    HostI2c1.ISR = PendingFlags;
+    PendingFlags = 0;
+    HostI2c1.ICR = 0;
+
+    SimNs += I2C_SIM_IRQ_NS;
+    I2C1_Master_IRQHandler();
+
+    if (HostI2c1.CR2 & I2C_CR2_STOP)
+    {
+      HostI2c1.CR2 &= ~I2C_CR2_STOP;
+      PendingFlags |= I2C_ISR_STOPF;
+      PendingNs = SimNs + SclNs;
+    }
+  }
+}
+
+/**
+  * @brief Completion callback: keep the queue fed until Target
+  */
+static void Resubmit(I2C1_XferTypeDef *Xfer)
+{
+  if (Submitted < Target)
+  {
+    Submitted++;
+    I2C1_Master_Submit(Xfer);
+  }
+}
+
+/**
+  * @brief SCL period of a TIMINGR value, the sync model of I2C1_TIMING.h
+  * @param Timing TIMINGR
+  * @retval ns
+  */
+static uint32_t SclPeriodNs(uint32_t Timing)
+{
+  uint32_t presc = ((Timing & I2C_TIMINGR_PRESC) >> I2C_TIMINGR_PRESC_Pos) + 1U;
+  uint32_t scll = ((Timing & I2C_TIMINGR_SCLL) >> I2C_TIMINGR_SCLL_Pos) + 1U;
+  uint32_t sclh = ((Timing & I2C_TIMINGR_SCLH) >> I2C_TIMINGR_SCLH_Pos) + 1U;
+  uint32_t cycles = (scll + sclh) * presc + 4U;
+
+  return (uint32_t)(((uint64_t)cycles * 1000000U) / SIM_I2CCLK_KHZ) +
+         SIM_RISE_NS + SIM_FALL_NS + 2U * I2C_TIMING_TAF_MIN;
+}
+
+/**
+  * @brief Back to back transactions at one bus speed
+  * @param Speed SCL in Hz
+  * @param TxLen write phase bytes
+  * @param RxLen read phase bytes
+  * @param Bus SCL periods one transaction needs on the wire
+  * @retval transactions per second
+  */
+static uint32_t Measure(uint32_t Speed, uint16_t TxLen, uint16_t RxLen, uint32_t Bus)
+{
+  static I2C1_XferTypeDef xfer;
+  I2C1_MasterStatsTypeDef stats;
+  uint64_t t0;
+  uint32_t rate;
+  uint32_t ideal;
+  uint32_t i;
+
+  SclNs = SclPeriodNs(I2C_TIMING_VALUE(SIM_I2CCLK_KHZ, Speed, SIM_RISE_NS, SIM_FALL_NS));
+  CHECK(SclNs >= 1000000000U / Speed);
+
+  for (i = 0; i < sizeof(SlaveMem); i++)
+  {
+    SlaveMem[i] = (uint8_t)(i * 7U + 3U);
+  }
+  for (i = 0; i < sizeof(RxBuf); i++)
+  {
+    RxBuf[i] = 0;
+  }
+  I2cStats = (I2C1_MasterStatsTypeDef){0};
+  RegNo[0] = 0x10;
+  xfer.Addr = SIM_SLAVE_ADDR;
+  xfer.TxBuf = RegNo;
+  xfer.TxLen = TxLen;
+  xfer.RxBuf = RxBuf;
+  xfer.RxLen = RxLen;
+  xfer.Callback = Resubmit;
+
+  Submitted = 1;
+  Target = SIM_XFERS;
+  t0 = SimNs;
+  CHECK_EQ(I2C1_Master_Submit(&xfer), SUCCESS);
+  Run();
+
+  I2C1_Master_GetStats(&stats);
+  CHECK_EQ(xfer.Status, I2C1_XFER_DONE);
+  CHECK_EQ(stats.Transfers, SIM_XFERS);
+  CHECK_EQ(stats.Bytes, SIM_XFERS * ((uint32_t)TxLen + RxLen));
+  CHECK_EQ(stats.Nacks + stats.Errors, 0);
+  for (i = 0; i < RxLen; i++)
+  {
+    CHECK_EQ(RxBuf[i], SlaveMem[(uint8_t)(0x10U + i)]);
+  }
+
+  rate = (uint32_t)(((uint64_t)SIM_XFERS * 1000000000U) / (SimNs - t0));
+  ideal = (uint32_t)(1000000000U / ((uint64_t)Bus * SclNs));
+  /* interrupt time only where SCL is stretched or the bus is idle */
+  CHECK(rate <= ideal);
+  CHECK(rate * 10U >= ideal * 8U);
+  printf("%7u Hz SCL %4u ns, %3u+%3u bytes: %6u xfers/s, %5u%% of the wire limit, %7u bytes/s\n",
+         Speed, SclNs, TxLen, RxLen, rate, (rate * 100U) / ideal,
+         rate * ((uint32_t)TxLen + RxLen));
+  return rate;
+}
+
+int main(void)
+{
+  static const uint32_t speeds[3] = {100000, 400000, 1000000};
+  static I2C1_XferTypeDef probe;
+  static I2C1_XferTypeDef next;
+  uint32_t reg[3];
+  uint32_t burst[3];
+  uint8_t i;
+
+  Enabled = 1;
+  for (i = 0; i < 3U; i++)
+  {
+    CHECK(I2C_TIMING_VALID(SIM_I2CCLK_KHZ, speeds[i], SIM_RISE_NS, SIM_FALL_NS));
+    /* START + address, 1 byte, restart + address, 2 bytes, STOP */
+    reg[i] = Measure(speeds[i], 1, 2, 10U + 9U + 10U + 18U + 1U);
+    /* 300 bytes: 255 + 45 with RELOAD in between */
+    burst[i] = Measure(speeds[i], 1, 300, 10U + 9U + 10U + 2700U + 1U);
+  }
+  CHECK(reg[1] > 3U * reg[0]);
+  CHECK(reg[2] > reg[1]);
+  CHECK(burst[2] > burst[1]);
+
+  /* address NACK ends with STOP, the queue goes on */
+  I2cStats = (I2C1_MasterStatsTypeDef){0};
+  Target = 0;
+  probe.Addr = 0x50;
+  probe.TxBuf = RegNo;
+  probe.TxLen = 1;
+  probe.RxBuf = RxBuf;
+  probe.RxLen = 2;
+  next = probe;
+  next.Addr = SIM_SLAVE_ADDR;
+  CHECK_EQ(I2C1_Master_Submit(&probe), SUCCESS);
+  CHECK_EQ(I2C1_Master_Submit(&next), SUCCESS);
+  Run();
+  CHECK_EQ(probe.Status, I2C1_XFER_NACK);
+  CHECK_EQ(next.Status, I2C1_XFER_DONE);
+  CHECK_EQ(I2cStats.Nacks, 1);
+  CHECK_EQ(I2cStats.Transfers, 2);
+  CHECK(I2C1_Master_IsIdle());
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,251 @@
+/**
+  ******************************************************************************
+  * @file 		test_i2c1_slave.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the I2C1 slave register map
+  *
+  *          I2C1_Slave_IRQHandler() runs on a RAM copy of the I2C1
+  *          registers; the test plays the master. DMA is modelled as the
+  *          hardware moves bytes: it refills TXDR whenever TXE is set, so
+  *          one byte past the last one the master reads sits in TXDR at
+  *          STOP. Every pass of the model ends at the map end, the start
+  *          is MAP_SIZE - CNDTR.
+  *          Checked: the register pointer advances and wraps over reads,
+  *          writes and repeated starts; a firmware update in the middle of
+  *          a read never tears the value the master gets.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+static I2C_TypeDef HostI2c1;
+static uint32_t HostDmaOn;
+static uint32_t HostDmaLen;
+static uint32_t HostDmaTc;
+
+/**
+  * @brief RXDR read, clears RXNE as the hardware does
+  */
+static uint8_t HostReceiveData8(I2C_TypeDef *I2Cx)
+{
+  I2Cx->ISR &= ~I2C_ISR_RXNE;
+  return (uint8_t)I2Cx->RXDR;
+}
+
+#undef I2C1
+#define I2C1                        (&HostI2c1)
+#define MS32_I2C_ReceiveData8       HostReceiveData8
+/* writing ISR only sets TXE, the other bits are read only */
+#define MS32_I2C_ClearFlag_TXE(I2Cx)                        ((I2Cx)->ISR |= I2C_ISR_TXE)
+/* DMA channel registers are reached through 32 bit address math */
+#define MS32_DMA_DisableChannel(DMAx, Channel)              (HostDmaOn = 0)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               (HostDmaOn = 1)
+#define MS32_DMA_SetMemoryAddress(DMAx, Channel, Address)   ((void)0)
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostDmaLen = (NbData))
+#define MS32_DMA_GetDataLength(DMAx, Channel)               (HostDmaLen)
+#define MS32_DMA_IsActiveFlag_TC2(DMAx)                     (HostDmaTc)
+#define MS32_DMA_ClearFlag_GI2(DMAx)                        (HostDmaTc = 0)
+
+#include "../USER/I2C1_SLAVE.c"
+
+/**
+  * @brief One interrupt with Flags, ICR clears as the hardware does
+  */
+static void Irq(uint32_t Flags)
+{
+  HostI2c1.ISR |= Flags;
+  HostI2c1.ICR = 0;
+  I2C1_Slave_IRQHandler();
+  HostI2c1.ISR &= ~(HostI2c1.ICR | I2C_ISR_DIR);
+}
+
+/**
+  * @brief DMA request: TXDR empty, the channel moves the next map byte
+  */
+static void DmaRequest(void)
+{
+  if (!(HostI2c1.ISR & I2C_ISR_TXE) || !HostDmaOn || (HostDmaLen == 0U))
+  {
+    return;
+  }
+  HostI2c1.TXDR = Map[Serving][I2C1_SLAVE_MAP_SIZE - HostDmaLen];
+  HostI2c1.ISR &= ~I2C_ISR_TXE;
+  HostDmaLen--;
+  if (HostDmaLen == 0U)
+  {
+    HostDmaTc = 1;
+    I2C1_Slave_DMA_IRQHandler();
+  }
+}
+
+/**
+  * @brief Master write: address, then Len bytes
+  */
+static void MasterWrite(const uint8_t *Data, uint8_t Len)
+{
+  uint8_t i;
+
+  Irq(I2C_ISR_ADDR);
+  for (i = 0; i < Len; i++)
+  {
+    HostI2c1.RXDR = Data[i];
+    Irq(I2C_ISR_RXNE);
+  }
+}
+
+/**
+  * @brief Master read of Len bytes, NACK on the last; Update() runs after
+  *        byte At, as firmware would between two bytes
+  */
+static void MasterRead(uint8_t *Data, uint8_t Len, uint8_t At, void (*Update)(void))
+{
+  uint8_t i;
+
+  Irq(I2C_ISR_ADDR | I2C_ISR_DIR);
+  DmaRequest();
+  for (i = 0; i < Len; i++)
+  {
+    /* TXDR to the shift register, DMA refills at once */
+    Data[i] = (uint8_t)HostI2c1.TXDR;
+    HostI2c1.ISR |= I2C_ISR_TXE;
+    DmaRequest();
+    if ((Update != 0) && (i == At))
+    {
+      Update();
+    }
+  }
+}
+
+static void Stop(uint32_t Flags)
+{
+  Irq(I2C_ISR_STOPF | Flags);
+}
+
+static uint8_t Value;
+
+/**
+  * @brief Firmware update of the 4 byte value at register 16
+  */
+static void UpdateValue(void)
+{
+  uint8_t *regs = I2C1_Slave_BeginUpdate();
+
+  Value++;
+  regs[16] = Value;
+  regs[17] = Value;
+  regs[18] = Value;
+  regs[19] = Value;
+  I2C1_Slave_EndUpdate();
+}
+
+int main(void)
+{
+  uint8_t buf[40];
+  uint8_t cmd[4];
+  uint8_t *regs;
+  uint8_t i;
+  uint8_t n;
+
+  Enabled = 1;
+  HostI2c1.ISR = I2C_ISR_TXE;
+  regs = I2C1_Slave_BeginUpdate();
+  for (i = 0; i < I2C1_SLAVE_MAP_SIZE; i++)
+  {
+    regs[i] = (uint8_t)(0x40U + i);
+  }
+  I2C1_Slave_EndUpdate();
+
+  /* pointer 5, repeated start, 3 bytes; the next read goes on at 8 */
+  cmd[0] = 5;
+  MasterWrite(cmd, 1);
+  MasterRead(buf, 3, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[0], 0x45);
+  CHECK_EQ(buf[2], 0x47);
+  CHECK_EQ(Pointer, 8);
+  MasterRead(buf, 2, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[0], 0x48);
+  CHECK_EQ(buf[1], 0x49);
+  CHECK_EQ(Pointer, 10);
+
+  /* read, repeated start, read again */
+  MasterRead(buf, 1, 0, 0);
+  MasterRead(&buf[1], 1, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[0], 0x4A);
+  CHECK_EQ(buf[1], 0x4B);
+  CHECK_EQ(Pointer, 12);
+
+  /* wrap past the map end, and exactly to it */
+  cmd[0] = 30;
+  MasterWrite(cmd, 1);
+  MasterRead(buf, 4, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[0], 0x5E);
+  CHECK_EQ(buf[1], 0x5F);
+  CHECK_EQ(buf[2], 0x40);
+  CHECK_EQ(buf[3], 0x41);
+  CHECK_EQ(Pointer, 2);
+  cmd[0] = 28;
+  MasterWrite(cmd, 1);
+  Stop(0);
+  MasterRead(buf, 4, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[3], 0x5F);
+  CHECK_EQ(Pointer, 0);
+  /* more than the whole map */
+  MasterRead(buf, 40, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[32], 0x40);
+  CHECK_EQ(buf[39], 0x47);
+  CHECK_EQ(Pointer, 8);
+
+  /* write 2 bytes at 2: committed at STOP, the pointer moves on to 4 */
+  cmd[0] = 2;
+  cmd[1] = 0xA1;
+  cmd[2] = 0xA2;
+  MasterWrite(cmd, 3);
+  Stop(0);
+  CHECK_EQ(Pointer, 4);
+  CHECK_EQ(I2C1_Slave_TakeWrites(), 0x0C);
+  I2C1_Slave_Read(2, buf, 2);
+  CHECK_EQ(buf[0], 0xA1);
+  CHECK_EQ(buf[1], 0xA2);
+  MasterRead(buf, 1, 0, 0);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[0], 0x44);
+
+  /* firmware updates while the master reads the 4 byte value */
+  for (n = 0; n < 100U; n++)
+  {
+    UpdateValue();
+    cmd[0] = 16;
+    MasterWrite(cmd, 1);
+    MasterRead(buf, 4, (uint8_t)(n % 4U), UpdateValue);
+    Stop(I2C_ISR_NACKF);
+    CHECK_EQ(buf[0], (uint8_t)(Value - 1U));
+    CHECK(buf[1] == buf[0] && buf[2] == buf[0] && buf[3] == buf[0]);
+    CHECK_EQ(Pointer, 20);
+  }
+  CHECK_EQ(SlaveStats.Errors, 0);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
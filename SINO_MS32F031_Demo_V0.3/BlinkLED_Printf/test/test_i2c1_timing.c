@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file 		test_i2c1_timing.c
+	* @author		SINOMCU-AE
+  * @brief 		Host TIMINGR table generator and check of I2C1_TIMING.h
+  *
+  *          Prints I2C_TIMING_VALUE() for I2CCLK 8/16/24/48MHz, 100kHz /
+  *          400kHz / 1MHz and a few rise / fall times, and checks every
+  *          accepted value in floating point against the I2C specification
+  *          with the timing model of the reference manual: SCL never
+  *          faster than the target, tLOW / tHIGH, data setup, data hold
+  *          and data valid time. The values in the I2C1_TIMING.h table are
+  *          pinned.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+#include "I2C1_TIMING.h"
+
+/* Private define ------------------------------------------------------------*/
+/* I2C_TIMING_xxx of one I2CCLK (kHz) / speed / rise / fall, as run time values */
+#define TIMING_FIELDS(K, F, TR, TF) \
+  { (K), (F), (TR), (TF), I2C_TIMING_VALID(K, F, TR, TF), I2C_TIMING_VALUE(K, F, TR, TF) }
+
+typedef struct
+{
+  uint32_t Khz;
+  uint32_t Speed;
+  uint32_t RiseNs;
+  uint32_t FallNs;
+  uint32_t Valid;
+  uint32_t Timing;
+} TimingCase;
+
+#define CASES_OF(K) \
+  TIMING_FIELDS(K, 100000, 100, 10),  TIMING_FIELDS(K, 400000, 100, 10),  \
+  TIMING_FIELDS(K, 1000000, 100, 10), TIMING_FIELDS(K, 100000, 1000, 300), \
+  TIMING_FIELDS(K, 95000, 1000, 300), TIMING_FIELDS(K, 400000, 300, 300), \
+  TIMING_FIELDS(K, 390000, 300, 300), TIMING_FIELDS(K, 1000000, 120, 120)
+
+static const TimingCase Cases[] =
+{
+  CASES_OF(8000), CASES_OF(16000), CASES_OF(24000), CASES_OF(48000)
+};
+
+/**
+  * @brief Check one accepted TIMINGR against the specification
+  * @param Case clock, speed, rise / fall and the macro result
+  * @retval None
+  */
+static void CheckCase(const TimingCase *Case)
+{
+  uint32_t t = Case->Timing;
+  double tclk = 1e6 / Case->Khz;
+  double tpresc = (((t & I2C_TIMINGR_PRESC) >> I2C_TIMINGR_PRESC_Pos) + 1U) * tclk;
+  double scll = ((t & I2C_TIMINGR_SCLL) >> I2C_TIMINGR_SCLL_Pos) + 1U;
+  double sclh = ((t & I2C_TIMINGR_SCLH) >> I2C_TIMINGR_SCLH_Pos) + 1U;
+  uint32_t sdadel = (t & I2C_TIMINGR_SDADEL) >> I2C_TIMINGR_SDADEL_Pos;
+  uint32_t scldel = (t & I2C_TIMINGR_SCLDEL) >> I2C_TIMINGR_SCLDEL_Pos;
+  double tr = Case->RiseNs;
+  double tf = Case->FallNs;
+  uint32_t f = Case->Speed;
+  /* fastest bus: analog filter and synchronisation at their minimum */
+  double sync = tr + tf + 2.0 * I2C_TIMING_TAF_MIN + 4.0 * tclk;
+  double period = (scll + sclh) * tpresc + sync;
+  double fmax = 1e9 / period;
+  double tlow = scll * tpresc + I2C_TIMING_TAF_MIN + 2.0 * tclk;
+  double thigh = sclh * tpresc + I2C_TIMING_TAF_MIN + 2.0 * tclk;
+
+  CHECK(period >= 1e9 / f - 1e-6);
+  CHECK(tlow >= I2C_TIMING_TLOW_MIN(f) - 1e-6);
+  CHECK(thigh >= I2C_TIMING_THIGH_MIN(f) - 1e-6);
+  CHECK((scldel + 1U) * tpresc >= tr + I2C_TIMING_TSUDAT_MIN(f) - 1e-6);
+  CHECK(sdadel * tpresc + 3.0 * tclk >= tf - I2C_TIMING_TAF_MIN - 1e-6);
+  /* data valid bounds the added delay only: SDADEL 0 is always allowed,
+     as in the Fm+ examples of the reference manual at 16MHz */
+  CHECK((sdadel == 0U) ||
+        (sdadel * tpresc + tr + I2C_TIMING_TAF_MAX + 4.0 * tclk <= I2C_TIMING_TVDDAT_MAX(f) + 1e-6));
+  CHECK(sdadel + scldel + 1U <= scll);
+  /* not needlessly slow: within one prescaled clock, plus the sync rounding */
+  CHECK(period < 1e9 / f + tpresc + tclk + 1e-6);
+
+  printf("%5u kHz %7u Hz  tr %4u tf %3u  0x%08X  %7.0f Hz  low %5.0f high %5.0f ns\n",
+         Case->Khz, f, Case->RiseNs, Case->FallNs, t, fmax, tlow, thigh);
+}
+
+int main(void)
+{
+  uint32_t i;
+
+  printf(" I2CCLK   speed    rise / fall   TIMINGR     fastest SCL\n");
+  for (i = 0; i < sizeof(Cases) / sizeof(Cases[0]); i++)
+  {
+    if (Cases[i].Valid)
+    {
+      CheckCase(&Cases[i]);
+    }
+    else
+    {
+      printf("%5u kHz %7u Hz  tr %4u tf %3u  rejected\n",
+             Cases[i].Khz, Cases[i].Speed, Cases[i].RiseNs, Cases[i].FallNs);
+    }
+  }
+
+  /* the table in I2C1_TIMING.h, rise 100ns / fall 10ns */
+  CHECK_EQ(I2C_TIMING_VALUE(8000, 100000, 100, 10), 0x00202227);
+  /* was 0x00100408, 406kHz: the sync part rounded up as one sum */
+  CHECK_EQ(I2C_TIMING_VALUE(8000, 400000, 100, 10), 0x00100409);
+  CHECK_EQ(I2C_TIMING_VALUE(8000, 1000000, 100, 10), 0x00100001);
+  CHECK_EQ(I2C_TIMING_VALUE(16000, 100000, 100, 10), 0x00504651);
+  CHECK_EQ(I2C_TIMING_VALUE(16000, 400000, 100, 10), 0x00300A15);
+  CHECK_EQ(I2C_TIMING_VALUE(16000, 1000000, 100, 10), 0x00200205);
+  CHECK_EQ(I2C_TIMING_VALUE(24000, 100000, 100, 10), 0x00806A7B);
+  CHECK_EQ(I2C_TIMING_VALUE(24000, 400000, 100, 10), 0x00401120);
+  CHECK_EQ(I2C_TIMING_VALUE(24000, 1000000, 100, 10), 0x00300409);
+  CHECK_EQ(I2C_TIMING_VALUE(48000, 100000, 100, 10), 0x10806B7C);
+  CHECK_EQ(I2C_TIMING_VALUE(48000, 400000, 100, 10), 0x00902444);
+  CHECK_EQ(I2C_TIMING_VALUE(48000, 1000000, 100, 10), 0x00700B15);
+  /* specification maximum rise + fall: full speed only at the faster
+     clocks, a few percent lower everywhere */
+  CHECK(!I2C_TIMING_VALID(8000, 100000, 1000, 300));
+  CHECK(!I2C_TIMING_VALID(16000, 100000, 1000, 300));
+  CHECK(I2C_TIMING_VALID(24000, 100000, 1000, 300));
+  CHECK(I2C_TIMING_VALID(8000, 95000, 1000, 300));
+  CHECK(I2C_TIMING_VALID(8000, 400000, 300, 300));
+  CHECK(I2C_TIMING_VALID(48000, 390000, 300, 300));
+  /* 240ns edges leave too little of 1us for tLOW + tHIGH */
+  CHECK(!I2C_TIMING_VALID(48000, 1000000, 120, 120));
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,260 @@
+/**
+  ******************************************************************************
+  * @file 		test_lin_slave.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the LIN slave state machine
+  *
+  *          LIN_Slave_IRQHandler() runs on a RAM copy of the USART1
+  *          registers; the test plays the master: break, sync field with
+  *          the auto baud result, PID, then the response bytes, and for a
+  *          published frame echoes every byte the slave writes to TDR back
+  *          into RDR as the single wire bus does.
+  *          Init must stop a USART1_RX DMA path left on.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HOST_CLK                    8000000U
+#define TDR_EMPTY                   0xFFFFU
+
+static USART_TypeDef HostUsart1;
+static uint32_t HostDmaDisabled;
+static uint32_t HostUs;
+
+/**
+  * @brief RDR read, clears RXNE as the hardware does
+  */
+static uint8_t HostReceiveData8(USART_TypeDef *USARTx)
+{
+  USARTx->ISR &= ~USART_ISR_RXNE;
+  return (uint8_t)USARTx->RDR;
+}
+
+#undef USART1
+#define USART1                      (&HostUsart1)
+#define MS32_USART_ReceiveData8     HostReceiveData8
+/* DMA channel registers are reached through 32 bit address math */
+#define MS32_DMA_DisableChannel(DMAx, Channel)  (HostDmaDisabled |= (1UL << (Channel)))
+
+#include "../USER/LIN_SLAVE.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t Cmd[1];
+static uint8_t Status[4] = {0x11, 0x22, 0x33, 0x44};
+static uint8_t Diag[8];
+
+static const LIN_FrameTypeDef Frames[] =
+{
+  {0x10, LIN_SUBSCRIBE, sizeof(Cmd), Cmd},
+  {0x11, LIN_PUBLISH, sizeof(Status), Status},
+  {LIN_ID_MASTER_REQ, LIN_SUBSCRIBE, sizeof(Diag), Diag},
+};
+
+static uint8_t Sent[16];
+static uint8_t SentLen;
+
+/* Stubs of the modules and library functions LIN_SLAVE calls -------------*/
+uint32_t SysTick_GetUs(void)
+{
+  HostUs += 50U;
+  return HostUs;
+}
+
+uint32_t MS32_RCC_GetUSARTClockFreq(uint32_t UsartxSource)
+{
+  return HOST_CLK;
+}
+
+ErrorStatus USART1_Baud_Select(uint32_t BaudRate, uint32_t MaxErrorPpm, USART1_BaudTypeDef *Cfg)
+{
+  Cfg->BaudRate = BaudRate;
+  Cfg->BRR = (uint16_t)((HOST_CLK + (BaudRate / 2U)) / BaudRate);
+  Cfg->OverSampling = MS32_USART_OVERSAMPLING_16;
+  return SUCCESS;
+}
+
+void USART1_Baud_Apply(const USART1_BaudTypeDef *Cfg)
+{
+  HostUsart1.BRR = Cfg->BRR;
+}
+
+void MS32_USART_ITConfig(USART_TypeDef *USARTx, uint32_t InterruptFunc, uint32_t Priority)
+{
+  USARTx->CR1 |= InterruptFunc & MS32_USART_CR1_ALLIE;
+  USARTx->CR2 |= InterruptFunc & MS32_USART_CR2_ALLIE;
+  USARTx->CR3 |= InterruptFunc & MS32_USART_CR3_ALLIE;
+}
+
+/**
+  * @brief One received byte into the interrupt; for a published response
+  *        every byte written to TDR comes back as the next received byte
+  * @param Data byte on the bus
+  * @param Flags more ISR flags with RXNE
+  * @retval None
+  */
+static void Rx(uint8_t Data, uint32_t Flags)
+{
+  HostUsart1.TDR = TDR_EMPTY;
+  HostUsart1.RDR = Data;
+  HostUsart1.ISR = USART_ISR_RXNE | Flags;
+  LIN_Slave_IRQHandler();
+  HostUsart1.ISR = 0;
+
+  while ((HostUsart1.TDR != TDR_EMPTY) && (SentLen < sizeof(Sent)))
+  {
+    Sent[SentLen] = (uint8_t)HostUsart1.TDR;
+    Rx(Sent[SentLen++], 0);
+  }
+}
+
+/**
+  * @brief Break and sync field, the auto baud unit measured Baud
+  * @param Baud master rate seen by the slave clock
+  * @retval None
+  */
+static void Header(uint32_t Baud, uint8_t Id)
+{
+  SentLen = 0;
+  Rx(0x00, USART_ISR_LBDF | USART_ISR_FE);
+  HostUsart1.BRR = (HOST_CLK + (Baud / 2U)) / Baud;
+  Rx(0x55, USART_ISR_ABRF);
+  Rx(LIN_PidTable[Id & 0x3FU], 0);
+}
+
+/**
+  * @brief Reference checksum, carry added back in
+  * @param Pid protected ID, 0 for classic
+  * @param Data bytes
+  * @param Len bytes
+  * @retval checksum
+  */
+static uint8_t RefChecksum(uint8_t Pid, const uint8_t *Data, uint8_t Len)
+{
+  uint32_t sum = Pid;
+  uint8_t i;
+
+  for (i = 0; i < Len; i++)
+  {
+    sum += Data[i];
+    sum = (sum & 0xFFU) + (sum >> 8);
+  }
+  return (uint8_t)~sum;
+}
+
+int main(void)
+{
+  static const uint8_t spec[3] = {0x55, 0x93, 0xE5};
+  static const uint8_t diag[8] = {0x7F, 0x06, 0xB2, 0x00, 0xFF, 0x7F, 0xFF, 0xFF};
+  uint8_t id;
+  uint8_t p0;
+  uint8_t p1;
+  uint8_t i;
+
+  /* PID parity: P0 = ID0^ID1^ID2^ID4, P1 = !(ID1^ID3^ID4^ID5) */
+  for (id = 0; id < 64U; id++)
+  {
+    p0 = (uint8_t)(((id >> 0) ^ (id >> 1) ^ (id >> 2) ^ (id >> 4)) & 1U);
+    p1 = (uint8_t)(~((id >> 1) ^ (id >> 3) ^ (id >> 4) ^ (id >> 5)) & 1U);
+    CHECK_EQ(LIN_PidTable[id], id | (p0 << 6) | (p1 << 7));
+  }
+  /* LIN 2.x specification example: PID 0x4A, data 55 93 E5 */
+  CHECK_EQ(LIN_Checksum(0x4A, spec, 3), 0xE6);
+  CHECK_EQ(LIN_Checksum(0x4A, spec, 3), RefChecksum(0x4A, spec, 3));
+  /* diagnostic frames: classic, PID not summed */
+  CHECK_EQ(LIN_Checksum(LIN_PidTable[LIN_ID_MASTER_REQ], diag, 8), RefChecksum(0, diag, 8));
+
+  /* USART1_RxDMA_Init() ran before: DMA request, RTO and IDLE armed */
+  HostUsart1.CR1 = USART_CR1_UE | USART_CR1_RE | USART_CR1_TE | USART_CR1_IDLEIE | USART_CR1_RTOIE;
+  HostUsart1.CR2 = USART_CR2_RTOEN;
+  HostUsart1.CR3 = USART_CR3_DMAR | USART_CR3_EIE;
+  LIN_Slave_Init(Frames, sizeof(Frames) / sizeof(Frames[0]));
+  CHECK((HostUsart1.CR3 & USART_CR3_DMAR) == 0);
+  CHECK((HostUsart1.CR3 & USART_CR3_EIE) == 0);
+  CHECK((HostUsart1.CR1 & (USART_CR1_IDLEIE | USART_CR1_RTOIE)) == 0);
+  CHECK((HostUsart1.CR2 & USART_CR2_RTOEN) == 0);
+  CHECK(HostDmaDisabled & (1UL << USART1_RX_DMA_CHANNEL));
+  CHECK(HostUsart1.CR2 & USART_CR2_LINEN);
+  CHECK(HostUsart1.CR2 & USART_CR2_LBDIE);
+  CHECK(HostUsart1.CR1 & USART_CR1_RXNEIE);
+  CHECK((HostUsart1.CR1 & USART_CR1_UE) != 0);
+
+  /* subscribed frame 0x10, master 2% fast */
+  Header(19584, 0x10);
+  Rx(0x07, 0);
+  Rx(RefChecksum(LIN_PidTable[0x10], (const uint8_t *)"\x07", 1), 0);
+  CHECK_EQ(Cmd[0], 0x07);
+  CHECK_EQ(LinStats.Headers, 1);
+  CHECK_EQ(LinStats.Frames, 1);
+  CHECK_EQ(LinStats.LastBaud, HOST_CLK / HostUsart1.BRR);
+  CHECK_EQ(LinEvents, 0x1);
+  CHECK_EQ(SentLen, 0);
+
+  /* published frame 0x11: data and checksum on the bus, each read back */
+  Header(19200, 0x11);
+  CHECK_EQ(SentLen, 5);
+  for (i = 0; i < 4U; i++)
+  {
+    CHECK_EQ(Sent[i], Status[i]);
+  }
+  CHECK_EQ(Sent[4], RefChecksum(LIN_PidTable[0x11], Status, 4));
+  CHECK_EQ(LinStats.Frames, 2);
+  CHECK_EQ(LinEvents, 0x3);
+  CHECK_EQ(LinStats.BitErrors, 0);
+  CHECK(LinStats.MinMarginUs < 0x7FFFFFFF);
+
+  /* master request 0x3C, classic checksum */
+  Header(19200, LIN_ID_MASTER_REQ);
+  for (i = 0; i < 8U; i++)
+  {
+    Rx(diag[i], 0);
+  }
+  Rx(RefChecksum(0, diag, 8), 0);
+  CHECK_EQ(LinStats.Frames, 3);
+  CHECK_EQ(Diag[2], 0xB2);
+
+  /* wrong checksum: data not taken */
+  Header(19200, 0x10);
+  Rx(0x09, 0);
+  Rx(0x00, 0);
+  CHECK_EQ(LinStats.ChecksumErrors, 1);
+  CHECK_EQ(Cmd[0], 0x07);
+
+  /* parity error, unknown ID, sync out of tolerance: no response */
+  SentLen = 0;
+  Rx(0x00, USART_ISR_LBDF | USART_ISR_FE);
+  Rx(0x55, USART_ISR_ABRF);
+  Rx(LIN_PidTable[0x11] ^ 0x80U, 0);
+  CHECK_EQ(LinStats.ParityErrors, 1);
+  Header(19200, 0x20);
+  CHECK_EQ(SentLen, 0);
+  Header(23040, 0x11);
+  CHECK_EQ(LinStats.SyncErrors, 1);
+  CHECK_EQ(SentLen, 0);
+  CHECK_EQ(HostUsart1.BRR, (HOST_CLK + 9600U) / 19200U);
+
+  /* no break seen: bytes are ignored */
+  Rx(LIN_PidTable[0x11], 0);
+  CHECK_EQ(SentLen, 0);
+  CHECK_EQ(LinStats.Headers, 4);
+  CHECK_EQ(LinStats.Frames, 3);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,349 @@
+/**
+  ******************************************************************************
+  * @file 		test_modbus_rtu.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the Modbus RTU slave against a scripted master
+  *
+  *          MODBUS_RTU.c runs on top of USART1_RX.c with RAM copies of the
+  *          USART1 and DMA1 registers, at 19200 baud 8E1 (11 bits per
+  *          character). The line model puts each master byte into the
+  *          receive ring through the DMA model and keeps time in bit
+  *          times: one character of silence raises IDLE, RTOR bit times
+  *          (as Modbus_RTU_Init() programs them) raise RTO and close the
+  *          frame. The TX DMA is the reply in TxBuf with its length.
+  *          Checked: the CRC-16 table against the bitwise CRC and the
+  *          specification example, the RTOR value of t3.5 and the DE
+  *          timing, read / write replies, bad CRC, illegal function,
+  *          address and value exceptions, broadcast executed without a
+  *          reply, other slaves ignored, a request while the reply is still
+  *          on DMA, and a frame with a gap inside: under t3.5 the frame stays
+  *          whole (t1.5 is not checked, the CRC is the guard), at t3.5 it is
+  *          two frames and both fail the CRC.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_BAUD                    19200U
+#define SIM_CHAR_BITS               11U
+
+static USART_TypeDef HostUsart1;
+static DMA_TypeDef HostDma1;
+static uint32_t HostRxNdt;
+static uint32_t HostTxNdt;
+static uint32_t HostBaud = SIM_BAUD;
+static uint64_t HostBits;
+
+#undef USART1
+#define USART1                      (&HostUsart1)
+#undef DMA1
+#define DMA1                        (&HostDma1)
+/* SYSCFG clock and DMA remap, no host copy */
+#define MS32_APB1_GRP2_EnableClock(Periphs)                 ((void)0)
+#define MS32_SYSCFG_SetRemapDMA_USART(Remap)                ((void)0)
+/* DMA channel registers are reached through 32 bit address math: channel 5
+   is the receive ring, channel 4 the reply in TxBuf */
+#define MS32_DMA_GetDataLength(DMAx, Channel)               (((Channel) == MS32_DMA_CHANNEL_4) ? HostTxNdt : HostRxNdt)
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostTxNdt = (NbData))
+#define MS32_DMA_DisableChannel(DMAx, Channel)              ((void)0)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               ((void)0)
+/* ICR / IFCR writes clear the ISR bits at once */
+#define MS32_USART_ClearFlag_IDLE(USARTx)                   ((USARTx)->ISR &= ~USART_ISR_IDLE)
+#define MS32_USART_ClearFlag_RTO(USARTx)                    ((USARTx)->ISR &= ~USART_ISR_RTOF)
+#define MS32_DMA_ClearFlag_HT5(DMAx)                        ((DMAx)->ISR &= ~DMA_ISR_HTIF5)
+#define MS32_DMA_ClearFlag_TC5(DMAx)                        ((DMAx)->ISR &= ~DMA_ISR_TCIF5)
+
+#include "../USER/USART1_RX.c"
+#include "../USER/MODBUS_RTU.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t Reply[MODBUS_BUF_SIZE];
+static uint16_t ReplyLen;
+static uint32_t Replies;
+
+/* Stubs of the modules and library functions MODBUS_RTU calls -------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return (uint32_t)((HostBits * 1000000U) / HostBaud);
+}
+
+uint32_t USART1_Baud_GetCurrent(void)
+{
+  return HostBaud;
+}
+
+ErrorStatus MS32_GPIO_Init(GPIO_TypeDef *GPIOx, MS32_GPIO_InitTypeDef *GpioInitStr)
+{
+  return SUCCESS;
+}
+
+void MS32_DMA_StructInit(MS32_DMA_InitTypeDef *DmaInitStr)
+{
+}
+
+ErrorStatus MS32_DMA_Init(DMA_TypeDef *DMAx, uint32_t Channel, MS32_DMA_InitTypeDef *DmaInitStr)
+{
+  return SUCCESS;
+}
+
+/**
+  * @brief Reference CRC-16, bitwise, 0xA001 reflected, init 0xFFFF
+  */
+static uint16_t RefCrc16(const uint8_t *Buf, uint16_t Len)
+{
+  uint16_t crc = 0xFFFFU;
+  uint8_t bit;
+
+  while (Len--)
+  {
+    crc ^= *Buf++;
+    for (bit = 0; bit < 8U; bit++)
+    {
+      crc = (crc & 1U) ? (uint16_t)((crc >> 1) ^ 0xA001U) : (uint16_t)(crc >> 1);
+    }
+  }
+  return crc;
+}
+
+/**
+  * @brief One character on the line, DMA moves it into the ring
+  */
+static void LineByte(uint8_t Data)
+{
+  HostBits += SIM_CHAR_BITS;
+  RxRing[USART1_RX_RING_SIZE - HostRxNdt] = Data;
+  HostRxNdt = (HostRxNdt == 1U) ? USART1_RX_RING_SIZE : (HostRxNdt - 1U);
+  if (HostRxNdt == (USART1_RX_RING_SIZE / 2U))
+  {
+    HostDma1.ISR |= DMA_ISR_HTIF5;
+    USART1_RxDMA_DMA_IRQHandler();
+  }
+  else if (HostRxNdt == USART1_RX_RING_SIZE)
+  {
+    HostDma1.ISR |= DMA_ISR_TCIF5;
+    USART1_RxDMA_DMA_IRQHandler();
+  }
+}
+
+/**
+  * @brief Line silent for Chars characters: IDLE after one, RTO after RTOR
+  *        bit times
+  */
+static void Silence(uint32_t Chars)
+{
+  uint32_t bits = Chars * SIM_CHAR_BITS;
+  uint32_t rto = HostUsart1.RTOR & USART_RTOR_RTO;
+
+  if (bits >= SIM_CHAR_BITS)
+  {
+    HostBits += SIM_CHAR_BITS;
+    bits -= SIM_CHAR_BITS;
+    HostUsart1.ISR |= USART_ISR_IDLE;
+    USART1_RxDMA_IRQHandler();
+  }
+  if ((bits + SIM_CHAR_BITS) >= rto)
+  {
+    HostBits += rto - SIM_CHAR_BITS;
+    bits -= rto - SIM_CHAR_BITS;
+    HostUsart1.ISR |= USART_ISR_RTOF;
+    USART1_RxDMA_IRQHandler();
+  }
+  HostBits += bits;
+}
+
+/**
+  * @brief Master sends Pdu with its CRC, a gap of GapChars after byte GapAt,
+  *        then the line stays silent; the slave is polled
+  * @param Pdu request without CRC
+  * @param Len bytes
+  * @param GapAt 0 no gap
+  * @param GapChars gap in characters
+  * @retval reply length with CRC, 0 no reply
+  */
+static uint16_t Transact(const uint8_t *Pdu, uint16_t Len, uint16_t GapAt, uint32_t GapChars)
+{
+  uint8_t frame[MODBUS_BUF_SIZE + 8];
+  uint16_t crc = RefCrc16(Pdu, Len);
+  uint16_t i;
+
+  memcpy(frame, Pdu, Len);
+  frame[Len] = (uint8_t)crc;
+  frame[Len + 1U] = (uint8_t)(crc >> 8);
+  for (i = 0; i < Len + 2U; i++)
+  {
+    if ((GapAt != 0U) && (i == GapAt))
+    {
+      Silence(GapChars);
+    }
+    LineByte(frame[i]);
+  }
+  Silence(4);
+  Modbus_RTU_Poll();
+  Modbus_RTU_Poll();
+
+  /* TX DMA: the reply goes out, DE follows the USART */
+  ReplyLen = (uint16_t)HostTxNdt;
+  if (ReplyLen != 0U)
+  {
+    memcpy(Reply, TxBuf, ReplyLen);
+    HostBits += ReplyLen * SIM_CHAR_BITS;
+    HostTxNdt = 0;
+    Replies++;
+    crc = RefCrc16(Reply, (uint16_t)(ReplyLen - 2U));
+    CHECK((Reply[ReplyLen - 2U] == (uint8_t)crc) && (Reply[ReplyLen - 1U] == (uint8_t)(crc >> 8)));
+  }
+  return ReplyLen;
+}
+
+int main(void)
+{
+  /* specification example: read 10 holding registers from 0 */
+  static const uint8_t example[8] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD};
+  static const uint8_t rd_holding[6] = {0x01, 0x03, 0x00, 0x02, 0x00, 0x03};
+  static const uint8_t rd_input[6] = {0x01, 0x04, 0x00, 0x00, 0x00, 0x02};
+  static const uint8_t wr_single[6] = {0x01, 0x06, 0x00, 0x05, 0x12, 0x34};
+  static const uint8_t wr_multi[11] = {0x01, 0x10, 0x00, 0x0E, 0x00, 0x02, 0x04, 0xAA, 0xBB, 0xCC, 0xDD};
+  static const uint8_t bad_fc[6] = {0x01, 0x05, 0x00, 0x00, 0xFF, 0x00};
+  static const uint8_t bad_addr[6] = {0x01, 0x03, 0x00, 0x0F, 0x00, 0x02};
+  static const uint8_t bad_qty[6] = {0x01, 0x04, 0x00, 0x00, 0x00, 0x00};
+  static const uint8_t bad_wr_addr[6] = {0x01, 0x06, 0x00, 0x10, 0x00, 0x01};
+  static const uint8_t broadcast[6] = {0x00, 0x06, 0x00, 0x07, 0x56, 0x78};
+  static const uint8_t other[6] = {0x02, 0x06, 0x00, 0x07, 0x00, 0x01};
+  uint8_t buf[256];
+  Modbus_RTU_StatsTypeDef stats;
+  uint32_t i;
+  uint32_t crc_errors;
+
+  /* CRC-16 table against the bitwise CRC */
+  for (i = 0; i < sizeof(buf); i++)
+  {
+    buf[i] = (uint8_t)((i * 73U) ^ (i >> 3));
+  }
+  for (i = 0; i <= sizeof(buf); i += 17U)
+  {
+    CHECK_EQ(Modbus_CRC16(buf, (uint16_t)i), RefCrc16(buf, (uint16_t)i));
+  }
+  CHECK_EQ(Modbus_CRC16(example, 6), 0xCDC5);
+  CHECK_EQ(Modbus_CRC16(example, 8), 0);
+
+  /* t3.5: 38.5 bit times at 19200, 1750us above */
+  HostUsart1.ISR = USART_ISR_TC;
+  HostBaud = 115200U;
+  Modbus_RTU_Init();
+  CHECK_EQ(HostUsart1.RTOR & USART_RTOR_RTO, 202);
+  HostBaud = SIM_BAUD;
+  Modbus_RTU_Init();
+  CHECK_EQ(HostUsart1.RTOR & USART_RTOR_RTO, 39);
+  /* DE driven by the USART, MODBUS_RTU_DE_TIME on both edges, active high */
+  CHECK(HostUsart1.CR3 & USART_CR3_DEM);
+  CHECK((HostUsart1.CR3 & USART_CR3_DEP) == 0);
+  CHECK_EQ((HostUsart1.CR1 & USART_CR1_DEAT) >> USART_CR1_DEAT_Pos, MODBUS_RTU_DE_TIME);
+  CHECK_EQ((HostUsart1.CR1 & USART_CR1_DEDT) >> USART_CR1_DEDT_Pos, MODBUS_RTU_DE_TIME);
+  CHECK(HostUsart1.CR1 & USART_CR1_PCE);
+  CHECK(HostUsart1.CR3 & USART_CR3_DMAT);
+
+  /* USART1_RxDMA_Init() ran before: DMA request on, ring empty */
+  HostUsart1.CR3 |= USART_CR3_DMAR;
+  HostRxNdt = USART1_RX_RING_SIZE;
+  for (i = 0; i < MODBUS_RTU_HOLDING_NUM; i++)
+  {
+    Modbus_HoldingRegs[i] = (uint16_t)(0x1000U + i);
+    Modbus_InputRegs[i] = (uint16_t)(0x2000U + i);
+  }
+
+  /* reads */
+  CHECK_EQ(Transact(rd_holding, 6, 0, 0), 11);
+  CHECK(memcmp(Reply, "\x01\x03\x06\x10\x02\x10\x03\x10\x04", 9) == 0);
+  CHECK_EQ(Transact(rd_input, 6, 0, 0), 9);
+  CHECK(memcmp(Reply, "\x01\x04\x04\x20\x00\x20\x01", 7) == 0);
+  /* writes: the reply echoes address and value / quantity */
+  CHECK_EQ(Transact(wr_single, 6, 0, 0), 8);
+  CHECK(memcmp(Reply, wr_single, 6) == 0);
+  CHECK_EQ(Modbus_HoldingRegs[5], 0x1234);
+  CHECK_EQ(Transact(wr_multi, 11, 0, 0), 8);
+  CHECK(memcmp(Reply, wr_multi, 6) == 0);
+  CHECK_EQ(Modbus_HoldingRegs[14], 0xAABB);
+  CHECK_EQ(Modbus_HoldingRegs[15], 0xCCDD);
+
+  /* exceptions: function | 0x80 and the code */
+  CHECK_EQ(Transact(bad_fc, 6, 0, 0), 5);
+  CHECK(memcmp(Reply, "\x01\x85\x01", 3) == 0);
+  CHECK_EQ(Transact(bad_addr, 6, 0, 0), 5);
+  CHECK(memcmp(Reply, "\x01\x83\x02", 3) == 0);
+  CHECK_EQ(Transact(bad_qty, 6, 0, 0), 5);
+  CHECK(memcmp(Reply, "\x01\x84\x03", 3) == 0);
+  CHECK_EQ(Transact(bad_wr_addr, 6, 0, 0), 5);
+  CHECK(memcmp(Reply, "\x01\x86\x02", 3) == 0);
+
+  /* broadcast executes without a reply, another slave is ignored */
+  CHECK_EQ(Transact(broadcast, 6, 0, 0), 0);
+  CHECK_EQ(Modbus_HoldingRegs[7], 0x5678);
+  CHECK_EQ(Transact(other, 6, 0, 0), 0);
+  CHECK_EQ(Modbus_HoldingRegs[7], 0x5678);
+
+  /* bad CRC: no reply */
+  Modbus_RTU_GetStats(&stats);
+  crc_errors = stats.CrcErrors;
+  memcpy(buf, rd_holding, 6);
+  buf[6] = 0x00;
+  buf[7] = 0x00;
+  for (i = 0; i < 8U; i++)
+  {
+    LineByte(buf[i]);
+  }
+  Silence(4);
+  Modbus_RTU_Poll();
+  CHECK_EQ(HostTxNdt, 0);
+  Modbus_RTU_GetStats(&stats);
+  CHECK_EQ(stats.CrcErrors, crc_errors + 1U);
+
+  /* gap of 2 characters, over t1.5 and under t3.5: one frame */
+  CHECK_EQ(Transact(rd_holding, 6, 4, 2), 11);
+  /* gap of 4 characters, over t3.5: two frames, both fail the CRC */
+  CHECK_EQ(Transact(rd_holding, 6, 4, 4), 0);
+  Modbus_RTU_GetStats(&stats);
+  CHECK_EQ(stats.CrcErrors, crc_errors + 3U);
+
+  /* a request while the reply is on DMA waits for it */
+  HostTxNdt = 5;
+  for (i = 0; i < 8U; i++)
+  {
+    LineByte((i < 6U) ? rd_input[i] : (uint8_t)(RefCrc16(rd_input, 6) >> (8U * (i - 6U))));
+  }
+  Silence(4);
+  Modbus_RTU_Poll();
+  CHECK_EQ(HostTxNdt, 5);
+  HostTxNdt = 0;
+  Modbus_RTU_Poll();
+  CHECK_EQ(HostTxNdt, 9);
+  HostTxNdt = 0;
+
+  Modbus_RTU_GetStats(&stats);
+  CHECK_EQ(stats.Requests, 11);
+  CHECK_EQ(stats.Exceptions, 4);
+  CHECK_EQ(Replies, 9);
+  /* RTO to reply: polled at the end of 4 characters of silence, 5 bits */
+  CHECK(stats.MaxTurnaroundUs >= 259U);
+  CHECK(stats.MaxTurnaroundUs <= 261U);
+  CHECK_EQ(HostUsart1.ISR & (USART_ISR_IDLE | USART_ISR_RTOF), 0);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
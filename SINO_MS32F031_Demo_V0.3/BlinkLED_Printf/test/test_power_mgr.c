@@ -0,0 +1,504 @@
+/**
+  ******************************************************************************
+  * @file 		test_power_mgr.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the POWER_MGR votes, clock gating and STOP restore
+  *
+  *          POWER_MGR.c runs on RAM copies of the RCC, EXTI, USART1 and
+  *          SysTick registers, built with a HSE plan (8MHz crystal, SYSCLK =
+  *          HCLK 48MHz). Every RCC access goes through the clock model: 1us
+  *          passes, HSERDY comes HseStartUs after HSEON, PLLRDY PllLockUs
+  *          after PLLON, SWS follows SW once the source is ready. SysTick
+  *          counts HSI cycles of the model time. The STOP model leaves SYSCLK
+  *          on HSI with HSE and PLL off and raises the flag of the wake source.
+  *          Checked: the vote masks and the mode they allow; the bus clocks
+  *          gated during the sleep (idle clients only, DMA kept for a busy
+  *          client, USART1 kept once it wakes the core) and all restored
+  *          after it; the regulator of STOP and STOP_LP; the wake source;
+  *          HSE, PLL and SYSCLK back on the profile clock, nothing to do
+  *          from the low profile, the PLL alone from the backup profile; a
+  *          crystal that does not restart goes to the CSS failover, a PLL
+  *          that does not lock to the CLOCK_SCALE failover; the Energy_Enter
+  *          order and the statistics. The wake latency of the model is printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Private define ------------------------------------------------------------*/
+#define CLOCK_PLAN_SOURCE           1
+#define CLOCK_PLAN_SYSCLK_HZ        48000000UL
+#define CLOCK_PLAN_HCLK_HZ          48000000UL
+#define CLOCK_PLAN_PCLK_HZ          24000000UL
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+#define SIM_HSE_START_US            1500U
+#define SIM_PLL_LOCK_US             100U
+#define SIM_NEVER                   0xFFFFFFFFU
+#define SIM_STOP_US                 12345U
+#define SIM_SYSTICK_LOAD            (CLOCK_PLAN_HCLK_HZ / 1000U - 1U)
+#define SIM_ENABLED_AHB             (RCC_AHBENR_DMAEN | RCC_AHBENR_GPIOAEN)
+#define SIM_ENABLED_APB1            (RCC_APB1ENR_I2C1EN | RCC_APB1ENR_TIM14EN | RCC_APB1ENR_PWREN)
+#define SIM_ENABLED_APB2            (RCC_APB2ENR_USART1EN | RCC_APB2ENR_SPI1EN | RCC_APB2ENR_SYSCFGCOMPEN)
+
+static RCC_TypeDef HostRcc;
+static EXTI_TypeDef HostExti;
+static USART_TypeDef HostUsart1;
+static SysTick_Type HostSysTick;
+static uint32_t HostUs;
+static uint32_t HseStartUs = SIM_HSE_START_US;
+static uint32_t PllLockUs = SIM_PLL_LOCK_US;
+static uint32_t HseOnAt;
+static uint32_t PllOnAt;
+static uint32_t HostCr;         /* CR at the last access, for the ON edges */
+
+/**
+  * @brief Clock model, run on every RCC access
+  */
+static RCC_TypeDef *HostRccUpdate(void)
+{
+  uint32_t cr = HostRcc.CR;
+  uint32_t sw = HostRcc.CFGR & RCC_CFGR_SW;
+  uint8_t ready;
+
+  HostUs++;
+  if ((cr & RCC_CR_HSEON) && !(HostCr & RCC_CR_HSEON))
+  {
+    HseOnAt = HostUs;
+  }
+  if ((cr & RCC_CR_PLLON) && !(HostCr & RCC_CR_PLLON))
+  {
+    PllOnAt = HostUs;
+  }
+  cr &= ~(RCC_CR_HSERDY | RCC_CR_PLLRDY);
+  if ((cr & RCC_CR_HSEON) && (HseStartUs != SIM_NEVER) && ((HostUs - HseOnAt) >= HseStartUs))
+  {
+    cr |= RCC_CR_HSERDY;
+  }
+  /* PLL on HSE / PREDIV needs the crystal */
+  if ((cr & RCC_CR_PLLON) && (PllLockUs != SIM_NEVER) && ((HostUs - PllOnAt) >= PllLockUs) &&
+      (((HostRcc.CFGR & RCC_CFGR_PLLSRC) == RCC_CFGR_PLLSRC_HSI_DIV2) || (cr & RCC_CR_HSERDY)))
+  {
+    cr |= RCC_CR_PLLRDY;
+  }
+  HostRcc.CR = cr;
+  HostCr = cr;
+  ready = (sw == RCC_CFGR_SW_HSI) || ((sw == RCC_CFGR_SW_HSE) && (cr & RCC_CR_HSERDY)) ||
+          ((sw == RCC_CFGR_SW_PLL) && (cr & RCC_CR_PLLRDY));
+  if (ready)
+  {
+    HostRcc.CFGR = (HostRcc.CFGR & ~RCC_CFGR_SWS) | (sw << 2);
+  }
+  return &HostRcc;
+}
+
+/**
+  * @brief SysTick model: a down counter of the HSI cycles of the model time
+  */
+static SysTick_Type *HostSysTickUpdate(void)
+{
+  uint32_t counts = HostUs * (HSI_VALUE / 1000000U);
+
+  HostSysTick.LOAD = SIM_SYSTICK_LOAD;
+  HostSysTick.VAL = SIM_SYSTICK_LOAD - (counts % (SIM_SYSTICK_LOAD + 1U));
+  return &HostSysTick;
+}
+
+#undef RCC
+#define RCC                         (HostRccUpdate())
+#undef EXTI
+#define EXTI                        (&HostExti)
+#undef USART1
+#define USART1                      (&HostUsart1)
+#undef SysTick
+#define SysTick                     (HostSysTickUpdate())
+/* the EXTI and RCC inline functions were compiled with the device registers */
+#define MS32_EXTI_IsActiveFlag_0_31(ExtiLine)               ((HostExti.PR & (ExtiLine)) == (ExtiLine))
+#define MS32_RCC_SetUSARTClockSource(Source)                \
+  (HostRcc.CFGR3 = (HostRcc.CFGR3 & ~(RCC_CFGR3_USART1SW << (((Source) & 0xFF000000U) >> 24U))) | \
+                   ((Source) & 0x00FFFFFFU))
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+
+#include "../USER/POWER_MGR.c"
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = CLOCK_PLAN_HCLK_HZ;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static uint8_t ScaleProfile = CLOCK_SCALE_HIGH;
+static uint32_t ScaleFailovers;
+static uint32_t CssFailovers;
+static uint32_t Resyncs;
+static uint8_t EnergyState[8];
+static uint8_t EnergyCount;
+static uint8_t BaudPhase[4];
+static uint8_t BaudCount;
+static uint8_t WakeBy = POWER_MGR_WAKE_RTC;
+static uint32_t SleepAhb;       /* enable registers while the core sleeps */
+static uint32_t SleepApb1;
+static uint32_t SleepApb2;
+static uint32_t SleepRegulator;
+static uint32_t Sleeps;
+static uint32_t Stops;
+
+/* Stubs of the modules POWER_MGR calls --------------------------------------*/
+uint8_t ClockScale_Get(void)
+{
+  return ScaleProfile;
+}
+
+void ClockScale_Failover(void)
+{
+  ScaleFailovers++;
+  ScaleProfile = CLOCK_SCALE_BACKUP;
+}
+
+void ClockCss_Failover(void)
+{
+  CssFailovers++;
+  ScaleProfile = CLOCK_SCALE_BACKUP;
+}
+
+void Energy_Enter(uint8_t State)
+{
+  if (EnergyCount < 8U)
+  {
+    EnergyState[EnergyCount] = State;
+  }
+  EnergyCount++;
+}
+
+void RtcWake_Resync(void)
+{
+  Resyncs++;
+}
+
+void USART1_Baud_ClockCallback(uint8_t Phase, uint32_t Sysclk)
+{
+  if (BaudCount < 4U)
+  {
+    BaudPhase[BaudCount] = Phase;
+  }
+  BaudCount++;
+  if (Phase == CLOCK_SCALE_POST)
+  {
+    HostUsart1.CR1 |= USART_CR1_UE;
+  }
+}
+
+/**
+  * @brief Record the clocks of the sleep
+  */
+static void RecordSleep(void)
+{
+  SleepAhb = HostRcc.AHBENR;
+  SleepApb1 = HostRcc.APB1ENR;
+  SleepApb2 = HostRcc.APB2ENR;
+}
+
+void MS32_PWR_EnterSLEEPMode(uint32_t SLEEPEntry)
+{
+  Sleeps++;
+  RecordSleep();
+  HostUs += 1000U;
+}
+
+/**
+  * @brief STOP model: SYSCLK back on HSI, HSE and PLL off, wake flag raised
+  */
+void MS32_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry)
+{
+  Stops++;
+  RecordSleep();
+  SleepRegulator = Regulator;
+  HostRcc.CR &= ~(RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY);
+  HostRcc.CFGR &= ~(RCC_CFGR_SW | RCC_CFGR_SWS);
+  HostCr = HostRcc.CR;
+  /* SysTick stood still, the model time goes on */
+  HostUs += SIM_STOP_US;
+  switch (WakeBy)
+  {
+    case POWER_MGR_WAKE_EXTI:
+      HostExti.PR |= EXTI_PR_PIF3;
+      break;
+    case POWER_MGR_WAKE_RTC:
+      HostExti.PR |= EXTI_PR_PIF17;
+      break;
+    case POWER_MGR_WAKE_USART1:
+      HostUsart1.ISR |= USART_ISR_WUF;
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief The registers of the planned clock, the bus clocks of all clients on
+  */
+static void PlannedClock(void)
+{
+  HostRcc.CR = RCC_CR_HSION | RCC_CR_HSIRDY | RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY;
+  HostCr = HostRcc.CR;
+  HostRcc.CFGR2 = CLOCK_PLAN_CFGR2;
+  HostRcc.CFGR = CLOCK_PLAN_CFGR_PLL | CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE | CLOCK_PLAN_SW | CLOCK_PLAN_SWS;
+  HostRcc.AHBENR = SIM_ENABLED_AHB;
+  HostRcc.APB1ENR = SIM_ENABLED_APB1;
+  HostRcc.APB2ENR = SIM_ENABLED_APB2;
+  ScaleProfile = CLOCK_SCALE_HIGH;
+}
+
+/**
+  * @brief Clear the wake flags and the call records
+  */
+static void Clear(void)
+{
+  HostExti.PR = 0;
+  HostUsart1.ISR &= ~USART_ISR_WUF;
+  EnergyCount = 0;
+  memset(EnergyState, 0xFF, sizeof(EnergyState));
+  SleepAhb = 0;
+  SleepApb1 = 0;
+  SleepApb2 = 0;
+}
+
+/**
+  * @brief Check the Energy_Enter calls of one sleep
+  */
+static void CheckEnergy(uint8_t Mode)
+{
+  CHECK_EQ(EnergyCount, 2);
+  CHECK_EQ(EnergyState[0], Mode);
+  CHECK_EQ(EnergyState[1], POWER_MGR_RUN);
+}
+
+/**
+  * @brief Check all bus clocks are back
+  */
+static void CheckClocksBack(void)
+{
+  CHECK_EQ(HostRcc.AHBENR, SIM_ENABLED_AHB);
+  CHECK_EQ(HostRcc.APB1ENR, SIM_ENABLED_APB1);
+  CHECK_EQ(HostRcc.APB2ENR, SIM_ENABLED_APB2);
+}
+
+/**
+  * @brief Check SYSCLK on the HSE PLL of the plan
+  */
+static void CheckHigh(void)
+{
+  CHECK_EQ(HostRcc.CR & (RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY),
+           RCC_CR_HSEON | RCC_CR_HSERDY | RCC_CR_PLLON | RCC_CR_PLLRDY);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_PLL);
+}
+
+int main(void)
+{
+  PowerMgr_StatsTypeDef stats;
+  uint32_t resyncs;
+  uint32_t start;
+
+  PlannedClock();
+
+  /* votes: the deepest mode nobody forbids */
+  CHECK_EQ(PowerMgr_GetMode(), POWER_MGR_STOP_LP);
+  PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_RUN);
+  CHECK_EQ(PowerMgr_GetMode(), POWER_MGR_RUN);
+  PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_STOP_LP);
+  PowerMgr_Vote(POWER_MGR_CLIENT_SPI1 | POWER_MGR_CLIENT_I2C1, POWER_MGR_SLEEP);
+  CHECK_EQ(PowerMgr_GetMode(), POWER_MGR_SLEEP);
+  CHECK_EQ(Blocks[POWER_MGR_STOP], POWER_MGR_CLIENT_SPI1 | POWER_MGR_CLIENT_I2C1);
+  CHECK_EQ(Blocks[POWER_MGR_STOP_LP], POWER_MGR_CLIENT_SPI1 | POWER_MGR_CLIENT_I2C1);
+  PowerMgr_Vote(POWER_MGR_CLIENT_I2C1, POWER_MGR_STOP);
+  CHECK_EQ(PowerMgr_GetMode(), POWER_MGR_SLEEP);
+  PowerMgr_Vote(POWER_MGR_CLIENT_SPI1, POWER_MGR_STOP_LP);
+  CHECK_EQ(PowerMgr_GetMode(), POWER_MGR_STOP);
+  CHECK_EQ(Blocks[POWER_MGR_STOP], 0);
+  CHECK_EQ(Blocks[POWER_MGR_STOP_LP], POWER_MGR_CLIENT_I2C1);
+  PowerMgr_Vote(POWER_MGR_CLIENT_I2C1, POWER_MGR_STOP_LP);
+  CHECK_EQ(PowerMgr_GetMode(), POWER_MGR_STOP_LP);
+
+  /* a RUN vote: no sleep, no gate */
+  Clear();
+  PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_RUN);
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_RUN);
+  CHECK_EQ(Sleeps + Stops, 0);
+  CHECK_EQ(EnergyCount, 0);
+  CheckClocksBack();
+
+  /* SLEEP with SPI1 busy: USART1 and I2C1 gated, the DMA SPI1 uses kept,
+     TIM14 has never voted and is left alone */
+  Clear();
+  PowerMgr_Vote(POWER_MGR_CLIENT_APP, POWER_MGR_STOP_LP);
+  PowerMgr_Vote(POWER_MGR_CLIENT_USART1 | POWER_MGR_CLIENT_I2C1, POWER_MGR_STOP_LP);
+  PowerMgr_Vote(POWER_MGR_CLIENT_SPI1, POWER_MGR_SLEEP);
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_SLEEP);
+  CHECK_EQ(Sleeps, 1);
+  CHECK_EQ(SleepAhb, SIM_ENABLED_AHB);
+  CHECK_EQ(SleepApb1, SIM_ENABLED_APB1 & ~RCC_APB1ENR_I2C1EN);
+  CHECK_EQ(SleepApb2, SIM_ENABLED_APB2 & ~RCC_APB2ENR_USART1EN);
+  CheckClocksBack();
+  CheckEnergy(POWER_MGR_SLEEP);
+  CHECK_EQ(Resyncs, 0);
+
+  /* STOP_LP with all idle: DMA and TIM14 gated too, low power regulator,
+     HSE, PLL and SYSCLK back before the clocks */
+  Clear();
+  PowerMgr_Vote(POWER_MGR_CLIENT_SPI1 | POWER_MGR_CLIENT_TIM14 | POWER_MGR_CLIENT_RTC, POWER_MGR_STOP_LP);
+  WakeBy = POWER_MGR_WAKE_RTC;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  CHECK_EQ(Stops, 1);
+  CHECK_EQ(SleepRegulator, MS32_PWR_MODE_STOP_LPREGU);
+  CHECK_EQ(SleepAhb, SIM_ENABLED_AHB & ~RCC_AHBENR_DMAEN);
+  CHECK_EQ(SleepApb1, SIM_ENABLED_APB1 & ~(RCC_APB1ENR_I2C1EN | RCC_APB1ENR_TIM14EN));
+  CHECK_EQ(SleepApb2, SIM_ENABLED_APB2 & ~(RCC_APB2ENR_USART1EN | RCC_APB2ENR_SPI1EN));
+  CheckClocksBack();
+  CheckHigh();
+  CheckEnergy(POWER_MGR_STOP_LP);
+  CHECK_EQ(Resyncs, 1);
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.Wakes[POWER_MGR_WAKE_RTC], 1);
+  CHECK(stats.LastWakeUs[POWER_MGR_WAKE_RTC] >= (SIM_HSE_START_US + SIM_PLL_LOCK_US));
+  CHECK(stats.LastWakeUs[POWER_MGR_WAKE_RTC] < (SIM_HSE_START_US + SIM_PLL_LOCK_US + 20U));
+  CHECK_EQ(stats.RestoreFails, 0);
+  printf("STOP_LP on HIGH, RTC wake    : %4uus (HSE start %uus, PLL lock %uus)\n",
+         stats.LastWakeUs[POWER_MGR_WAKE_RTC], SIM_HSE_START_US, SIM_PLL_LOCK_US);
+
+  /* STOP on the main regulator, EXTI pin wake */
+  Clear();
+  PowerMgr_Vote(POWER_MGR_CLIENT_I2C1, POWER_MGR_STOP);
+  WakeBy = POWER_MGR_WAKE_EXTI;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP);
+  CHECK_EQ(SleepRegulator, MS32_PWR_MODE_STOP_MAINREGU);
+  /* I2C1 busy keeps its APB1 clock and the DMA */
+  CHECK_EQ(SleepAhb, SIM_ENABLED_AHB);
+  CHECK_EQ(SleepApb1, SIM_ENABLED_APB1 & ~RCC_APB1ENR_TIM14EN);
+  CheckClocksBack();
+  CheckHigh();
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.Wakes[POWER_MGR_WAKE_EXTI], 1);
+  PowerMgr_Vote(POWER_MGR_CLIENT_I2C1, POWER_MGR_STOP_LP);
+
+  /* no flag: another interrupt */
+  Clear();
+  WakeBy = POWER_MGR_WAKE_OTHER;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.Wakes[POWER_MGR_WAKE_OTHER], 1);
+
+  /* USART1 wake: HSI kernel clock, start bit wake, never gated */
+  BaudCount = 0;
+  PowerMgr_EnableUsartWake();
+  CHECK_EQ(BaudCount, 2);
+  CHECK_EQ(BaudPhase[0], CLOCK_SCALE_PRE);
+  CHECK_EQ(BaudPhase[1], CLOCK_SCALE_POST);
+  CHECK_EQ(HostRcc.CFGR3 & RCC_CFGR3_USART1SW, MS32_RCC_USART1_CLKSOURCE_HSI & RCC_CFGR3_USART1SW);
+  CHECK_EQ(HostUsart1.CR3 & USART_CR3_WUS, MS32_USART_WAKEUP_ON_STARTBIT);
+  CHECK(HostUsart1.CR3 & USART_CR3_WUFIE);
+  CHECK(HostUsart1.CR1 & USART_CR1_UESM);
+  CHECK(HostUsart1.CR1 & USART_CR1_UE);
+  Clear();
+  WakeBy = POWER_MGR_WAKE_USART1;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  CHECK_EQ(SleepApb2, SIM_ENABLED_APB2 & ~RCC_APB2ENR_SPI1EN);
+  /* the DMA of USART1 stays on with it */
+  CHECK_EQ(SleepAhb, SIM_ENABLED_AHB);
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.Wakes[POWER_MGR_WAKE_USART1], 1);
+  /* WUF is cleared by writing WUCF */
+  HostUsart1.ICR = 0;
+  PowerMgr_USART1_IRQHandler();
+  CHECK_EQ(HostUsart1.ICR, USART_ICR_WUCF);
+
+  /* low profile: SYSCLK stays on HSI, nothing to wait for */
+  Clear();
+  ScaleProfile = CLOCK_SCALE_LOW;
+  HostRcc.CR &= ~(RCC_CR_HSEON | RCC_CR_PLLON);
+  HostRcc.CFGR &= ~RCC_CFGR_SW;
+  WakeBy = POWER_MGR_WAKE_RTC;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  CHECK_EQ(HostRcc.CR & (RCC_CR_HSEON | RCC_CR_PLLON), 0);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_HSI);
+  PowerMgr_GetStats(&stats);
+  CHECK(stats.LastWakeUs[POWER_MGR_WAKE_RTC] < 10U);
+  CHECK_EQ(stats.RestoreFails, 0);
+  printf("STOP_LP on LOW, RTC wake     : %4uus\n", stats.LastWakeUs[POWER_MGR_WAKE_RTC]);
+
+  /* crystal that does not restart: CSS failover, HSE left off */
+  PlannedClock();
+  Clear();
+  HseStartUs = SIM_NEVER;
+  resyncs = Resyncs;
+  start = HostUs;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  CHECK_EQ(CssFailovers, 1);
+  CHECK_EQ(ScaleFailovers, 0);
+  CHECK_EQ(HostRcc.CR & RCC_CR_HSEON, 0);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_HSI);
+  CHECK_EQ(Resyncs, resyncs + 1U);
+  CheckClocksBack();
+  CheckEnergy(POWER_MGR_STOP_LP);
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.RestoreFails, 1);
+  /* longer than one SysTick period: the recorded time has wrapped */
+  CHECK((HostUs - start - SIM_STOP_US) > POWER_MGR_HSE_WAIT);
+  printf("STOP_LP, no crystal          : %4uus to the CSS failover\n", HostUs - start - SIM_STOP_US);
+  HseStartUs = SIM_HSE_START_US;
+
+  /* backup profile: the HSI PLL alone */
+  Clear();
+  ScaleProfile = CLOCK_SCALE_BACKUP;
+  HostRcc.CR &= ~(RCC_CR_HSEON | RCC_CR_PLLON);
+  HostRcc.CFGR = CLOCK_PLAN_BACKUP_CFGR_PLL | RCC_CFGR_SW_PLL | RCC_CFGR_SWS_PLL;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  CHECK_EQ(HostRcc.CR & RCC_CR_HSEON, 0);
+  CHECK(HostRcc.CR & RCC_CR_PLLRDY);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_PLL);
+  PowerMgr_GetStats(&stats);
+  CHECK(stats.LastWakeUs[POWER_MGR_WAKE_RTC] >= SIM_PLL_LOCK_US);
+  CHECK_EQ(stats.RestoreFails, 1);
+  printf("STOP_LP on BACKUP, RTC wake  : %4uus\n", stats.LastWakeUs[POWER_MGR_WAKE_RTC]);
+
+  /* PLL that does not lock: CLOCK_SCALE failover, PLL left off */
+  PlannedClock();
+  Clear();
+  PllLockUs = SIM_NEVER;
+  CHECK_EQ(PowerMgr_Idle(), POWER_MGR_STOP_LP);
+  CHECK_EQ(ScaleFailovers, 1);
+  CHECK_EQ(CssFailovers, 1);
+  CHECK_EQ(HostRcc.CR & RCC_CR_PLLON, 0);
+  CHECK_EQ(HostRcc.CFGR & RCC_CFGR_SWS, RCC_CFGR_SWS_HSI);
+  CheckClocksBack();
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.RestoreFails, 2);
+  PllLockUs = SIM_PLL_LOCK_US;
+
+  PowerMgr_GetStats(&stats);
+  CHECK_EQ(stats.Entries[POWER_MGR_RUN], 1);
+  CHECK_EQ(stats.Entries[POWER_MGR_SLEEP], 1);
+  CHECK_EQ(stats.Entries[POWER_MGR_STOP], 1);
+  CHECK_EQ(stats.Entries[POWER_MGR_STOP_LP], 7);
+  printf("wakes EXTI %u, RTC %u, USART1 %u, other %u\n",
+         stats.Wakes[POWER_MGR_WAKE_EXTI], stats.Wakes[POWER_MGR_WAKE_RTC],
+         stats.Wakes[POWER_MGR_WAKE_USART1], stats.Wakes[POWER_MGR_WAKE_OTHER]);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
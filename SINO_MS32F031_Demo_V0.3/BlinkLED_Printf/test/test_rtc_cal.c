@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * @file 		test_rtc_cal.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the RTC_CAL smooth calibration loop
+  *
+  *          RTC_CAL.c runs on RAM copies of the RCC, RTC and TIM14 registers.
+  *          The RTC model counts 1024 ticks a second of a LSE off by
+  *          LseErrPpb, sped up or slowed down by the RTC_CALR correction;
+  *          SetTime and ShiftSec move its count as the RTC does.
+  *          Built twice: test_rtc_cal with RTC_CAL_REF 0, TIM14 captures of
+  *          every 8th LSE edge on a 48MHz HSE timer clock; test_rtc_cal_sync
+  *          with RTC_CAL_REF 1, host syncs on the real time of day.
+  *          Checked: the LSE error measured to the ppb, the correction moving
+  *          1/RTC_CAL_GAIN of the way and the CALP / CALM pulses written for
+  *          it, clamped at -511 / +512 pulses; no measurement off HSE, without
+  *          LSE or within RTC_CAL_PERIOD_MS, none kept after an overcapture;
+  *          (REF 1) the drift estimate from syncs 15 minutes apart, over
+  *          midnight, none for syncs closer than RTC_CAL_SYNC_MIN_MS, the
+  *          residual drift of a day; the phase shift, the time set of whole
+  *          seconds and the refused syncs; the command. The convergence is
+  *          printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Private define ------------------------------------------------------------*/
+#ifndef RTC_CAL_REF
+#define RTC_CAL_REF                 0
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+#define SIM_TIMCLK_HZ               48000000.0
+#define SIM_LSE_HZ                  32768.0
+#define SIM_TICK_HZ                 1024.0
+#define SIM_DAY_TICKS               (86400.0 * SIM_TICK_HZ)
+
+static RCC_TypeDef HostRcc;
+static RTC_TypeDef HostRtc;
+static TIM_TypeDef HostTim14;
+static uint8_t HostLseReady = 1;
+static uint32_t HostIcConfig;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef RTC
+#define RTC                         (&HostRtc)
+#undef TIM14
+#define TIM14                       (&HostTim14)
+/* the bus and RCC inline functions were compiled with the device registers */
+#define MS32_APB1_GRP1_EnableClock(Periphs)                 (HostRcc.APB1ENR |= (Periphs))
+#define MS32_RCC_LSE_IsReady()                              (HostLseReady)
+/* the channel registers are reached through 32 bit address math */
+#define MS32_TIM_IC_Config(TIMx, Channel, Configuration)    (HostIcConfig = (Configuration))
+/* SR is write 0 to clear */
+#define MS32_TIM_ClearFlag_CC1(TIMx)                        (HostTim14.SR &= ~TIM_SR_CC1IF)
+#define MS32_TIM_ClearFlag_CC1OVR(TIMx)                     (HostTim14.SR &= ~TIM_SR_CC1OF)
+/* reading CCR1 clears CC1IF */
+#define MS32_TIM_IC_GetCaptureCH1(TIMx)                     (HostTim14.SR &= ~TIM_SR_CC1IF, HostTim14.CCR1)
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+
+#include "../USER/RTC_CAL.c"
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000U;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static double RealS;            /* real time of day, s */
+static double RtcPos;           /* RTC count, ticks of the day */
+static double LseErrPpb;        /* LSE error of the part, + is fast */
+static uint8_t RtcValid = 1;
+static uint32_t Resyncs;
+static uint32_t Rebases;
+
+/**
+  * @brief Correction in RTC_CALR, pulses per 2^20 RTCCLK
+  */
+static int32_t CalPulses(void)
+{
+  return ((HostRtc.CALR & RTC_CALR_CALP) ? 512 : 0) - (int32_t)(HostRtc.CALR & RTC_CALR_CALM);
+}
+
+/**
+  * @brief Real time and the RTC running together
+  */
+static void Run(double Seconds)
+{
+  RealS += Seconds;
+  RtcPos += Seconds * SIM_TICK_HZ * (1.0 + (LseErrPpb / 1e9)) * (1.0 + (CalPulses() / 1048576.0));
+}
+
+/**
+  * @brief RTC and real time in ticks of the day
+  */
+static uint32_t RtcTicks(void)
+{
+  return (uint32_t)fmod(floor(RtcPos), SIM_DAY_TICKS);
+}
+
+/**
+  * @brief Host time of day in ms
+  */
+static uint32_t HostMs(void)
+{
+  return (uint32_t)fmod(floor(RealS * 1000.0), 86400000.0);
+}
+
+/**
+  * @brief RTC minus real time, ticks
+  */
+static double RtcOffset(void)
+{
+  return remainder(RtcPos - (RealS * SIM_TICK_HZ), SIM_DAY_TICKS);
+}
+
+/* Stubs of the modules RTC_CAL calls ----------------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return (uint32_t)(RealS * 1000.0);
+}
+
+uint8_t RtcWake_GetTicks(uint32_t *Ticks)
+{
+  if (!RtcValid)
+  {
+    return 0;
+  }
+  *Ticks = RtcTicks();
+  return 1;
+}
+
+void RtcWake_Resync(void)
+{
+  Resyncs++;
+}
+
+void RtcWake_Rebase(void)
+{
+  Rebases++;
+}
+
+void MS32_RTC_Cal(RTC_TypeDef *RTCx, uint32_t InsertPulse, uint32_t Period, uint16_t CalMin)
+{
+  CHECK_EQ(Period, MS32_RTC_CALIB_PERIOD_32SEC);
+  CHECK(CalMin <= RTC_CALR_CALM);
+  RTCx->CALR = InsertPulse | Period | CalMin;
+}
+
+ErrorStatus MS32_RTC_SetTime(RTC_TypeDef *RTCx, uint32_t RtcFormat, MS32_RTC_TimeTypeDef *RtcTimeStr,
+                             uint32_t ShadowBypassEn)
+{
+  CHECK_EQ(RtcFormat, MS32_RTC_FORMAT_BIN);
+  CHECK(RtcTimeStr->Hours < 24U);
+  CHECK(RtcTimeStr->Minutes < 60U);
+  CHECK(RtcTimeStr->Seconds < 60U);
+  RtcPos = ((RtcTimeStr->Hours * 3600.0) + (RtcTimeStr->Minutes * 60.0) + RtcTimeStr->Seconds) * SIM_TICK_HZ;
+  return SUCCESS;
+}
+
+void MS32_RTC_ShiftSec(RTC_TypeDef *RTCx, uint32_t ShiftSecond, uint16_t Fraction)
+{
+  CHECK(Fraction <= RTC_WAKE_PREDIV_S);
+  RtcPos += (ShiftSecond == MS32_RTC_SHIFT_SECOND_ADVANCE) ? (SIM_TICK_HZ - Fraction) : -(double)Fraction;
+}
+
+#if RTC_CAL_REF == 0
+/**
+  * @brief One measurement: every 8th LSE edge captured on the timer clock
+  * @param OverAt capture that comes on a set CC1IF, 0: none
+  */
+static void Measure(uint32_t OverAt)
+{
+  double period = 8.0 * SIM_TIMCLK_HZ / (SIM_LSE_HZ * (1.0 + (LseErrPpb / 1e9)));
+  static double counts;
+  uint32_t n = 0;
+
+  RtcCal_Poll();
+  CHECK(Running);
+  CHECK(HostTim14.DIER & TIM_DIER_CC1IE);
+  while (HostTim14.DIER & TIM_DIER_CC1IE)
+  {
+    counts += period;
+    HostTim14.CCR1 = (uint32_t)fmod(floor(counts), 65536.0);
+    n++;
+    HostTim14.SR |= TIM_SR_CC1IF;
+    if (n == OverAt)
+    {
+      HostTim14.SR |= TIM_SR_CC1OF;
+    }
+    RtcCal_TIM14_IRQHandler();
+    CHECK(n <= RTC_CAL_CAPTURES + 1U);
+  }
+  CHECK_EQ(n, RTC_CAL_CAPTURES + 1U);
+  CHECK(Done);
+  Run(1.0);
+  RtcCal_Poll();
+  /* written on the next poll */
+  RtcCal_Poll();
+}
+#endif
+
+int main(void)
+{
+  RtcCal_StatsTypeDef stats;
+  uint8_t req[4] = {0};
+  uint8_t rsp[16];
+  uint32_t ms;
+  uint32_t i;
+  double e;
+  double drift;
+  int32_t want;
+
+  RealS = 20.0 * 3600.0;
+  RtcPos = RealS * SIM_TICK_HZ;
+
+  /* the calibration already in the backup domain is taken */
+  HostRtc.CALR = RTC_CALR_CALP | 500U;
+  RtcCal_Init();
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.CorrPpb, (12 * 1000000000LL) / 1048576);
+  HostRtc.CALR = 0;
+  RtcCal_Init();
+
+#if RTC_CAL_REF == 0
+  /* 48MHz timer clock on the HSE PLL */
+  HostRcc.CFGR = RCC_CFGR_SWS_PLL | RCC_CFGR_PLLSRC_HSE_PREDIV;
+  CHECK(HostRcc.APB1ENR & RCC_APB1ENR_TIM14EN);
+  CHECK_EQ(HostIcConfig & TIM_CCMR1_IC1PSC, MS32_TIM_ICPSC_DIV8 & TIM_CCMR1_IC1PSC);
+  CHECK(HostTim14.CR1 & TIM_CR1_CEN);
+  CHECK(HostTim14.CCER & TIM_CCER_CC1E);
+
+  /* +25ppm LSE: measured to the ppb, the correction halves the gap each time */
+  LseErrPpb = 25000.0;
+  want = 0;
+  ms = 0;
+  printf("LSE +25ppm  error ppb  corr ppb  CALR pulses\n");
+  for (i = 0; i < 12U; i++)
+  {
+    Measure(0);
+    RtcCal_GetStats(&stats);
+    CHECK(fabs(stats.LastErrorPpb - LseErrPpb) < 50.0);
+    CHECK_EQ(stats.Measurements, i + 1U);
+    CHECK_EQ(CalPulses(), Pulses);
+    /* RTC_CALR written when the pulses change only */
+    ms += (CalPulses() != want) ? 1U : 0U;
+    want = CalPulses();
+    CHECK_EQ(stats.Writes, ms);
+    printf("%10u  %9d  %8d  %11d\n", i + 1U, stats.LastErrorPpb, stats.CorrPpb, CalPulses());
+    /* nothing before RTC_CAL_PERIOD_MS */
+    RtcCal_Poll();
+    CHECK_EQ(Running, 0);
+    Run(RTC_CAL_PERIOD_MS / 1000U);
+  }
+  CHECK(fabs(stats.CorrPpb + LseErrPpb) < 100.0);
+  want = (int32_t)lround(-LseErrPpb * 1048576.0 / 1e9);
+  CHECK_EQ(CalPulses(), want);
+  CHECK_EQ(HostRtc.CALR & RTC_CALR_CALP, 0);
+  /* the corrected RTC over a day */
+  drift = RtcOffset();
+  Run(86400.0);
+  drift = (RtcOffset() - drift) * 1000.0 / SIM_TICK_HZ;
+  CHECK(fabs(drift) < 100.0);
+  printf("residual drift %.1fms a day\n", drift);
+
+  /* overcapture: measurement dropped, the correction kept */
+  Measure(RTC_CAL_CAPTURES / 2U);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Overcaptures, 1);
+  CHECK_EQ(stats.Measurements, 12);
+
+  /* no measurement off HSE, or without LSE */
+  Run(RTC_CAL_PERIOD_MS / 1000U);
+  HostRcc.CFGR = RCC_CFGR_SWS_PLL | RCC_CFGR_PLLSRC_HSI_DIV2;
+  RtcCal_Poll();
+  CHECK_EQ(Running, 0);
+  HostRcc.CFGR = RCC_CFGR_SWS_HSI;
+  RtcCal_Poll();
+  CHECK_EQ(Running, 0);
+  HostRcc.CFGR = RCC_CFGR_SWS_HSE;
+  HostLseReady = 0;
+  RtcCal_Poll();
+  CHECK_EQ(Running, 0);
+  HostLseReady = 1;
+
+  /* slow LSE: CALP inserts 512 pulses, CALM takes some back */
+  LseErrPpb = -300000.0;
+  for (i = 0; i < 14U; i++)
+  {
+    Measure(0);
+    Run(RTC_CAL_PERIOD_MS / 1000U);
+  }
+  RtcCal_GetStats(&stats);
+  want = (int32_t)lround(-LseErrPpb * 1048576.0 / 1e9);
+  CHECK(abs(CalPulses() - want) <= 1);
+  CHECK(HostRtc.CALR & RTC_CALR_CALP);
+  printf("LSE -300ppm: CALP, CALM %u, corr %dppb\n", (uint32_t)(HostRtc.CALR & RTC_CALR_CALM), stats.CorrPpb);
+
+  /* beyond the range: clamped at -511 pulses */
+  LseErrPpb = 600000.0;
+  for (i = 0; i < 14U; i++)
+  {
+    Measure(0);
+    Run(RTC_CAL_PERIOD_MS / 1000U);
+  }
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(CalPulses(), RTC_CAL_PULSES_MIN);
+  CHECK_EQ(stats.CorrPpb, (RTC_CAL_PULSES_MIN * 1000000000LL) / 1048576);
+
+  /* a host sync still corrects the phase */
+  RtcPos += 10.0;
+  RtcCal_GetStats(&stats);
+  i = stats.Shifts;
+  CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Shifts, i + 1U);
+  CHECK(fabs(RtcOffset()) < 1.0);
+  CHECK_EQ(stats.Measurements, 40);
+#else
+  /* refused syncs */
+  CHECK_EQ(RtcCal_Sync(86400000U), ERROR);
+  RtcValid = 0;
+  CHECK_EQ(RtcCal_Sync(HostMs()), ERROR);
+  RtcValid = 1;
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Syncs, 0);
+
+  /* +20ppm LSE, a sync every 15 minutes, over midnight */
+  LseErrPpb = 20000.0;
+  CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+  CHECK_EQ(Based, 1);
+  printf("LSE +20ppm  offset ms  error ppb  corr ppb  CALR pulses\n");
+  for (i = 0; i < 24U; i++)
+  {
+    Run(900.0);
+    CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+    RtcCal_Poll();
+    RtcCal_GetStats(&stats);
+    CHECK_EQ(stats.Measurements, i + 1U);
+    /* the syncs are 1/1024s apart at worst: 1.1ppm over 15 minutes, on the drift left */
+    e = LseErrPpb + ((CalPulses() * 1e9) / 1048576.0);
+    /* phase errors below RTC_CAL_PHASE_MS are left */
+    CHECK(fabs(RtcOffset()) < 3.0);
+    printf("%10u  %9d  %9d  %8d  %11d\n", i + 1U, stats.LastOffsetMs, stats.LastErrorPpb, stats.CorrPpb,
+           CalPulses());
+  }
+  CHECK(RealS > 86400.0);
+  CHECK(fabs(e) < 1500.0);
+  CHECK(abs(CalPulses() - (int32_t)lround(-LseErrPpb * 1048576.0 / 1e9)) <= 1);
+  CHECK_EQ(stats.Syncs, 25);
+  /* syncs less than a day apart */
+  drift = RtcOffset();
+  Run(82800.0);
+  drift = (RtcOffset() - drift) * 1000.0 * (86400.0 / 82800.0) / SIM_TICK_HZ;
+  CHECK(fabs(drift) < 130.0);
+  printf("residual drift %.1fms a day\n", drift);
+  CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Measurements, 25);
+
+  /* syncs closer than RTC_CAL_SYNC_MIN_MS: no estimate, no phase fix, base kept */
+  RtcCal_GetStats(&stats);
+  i = stats.Shifts;
+  ms = BaseHostMs;
+  Run(60.0);
+  RtcPos += 20.0;
+  CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Shifts, i);
+  CHECK_EQ(stats.Measurements, 25);
+  CHECK_EQ(BaseHostMs, ms);
+  CHECK(stats.LastOffsetMs >= 19);
+
+  /* five seconds off: set, no estimate, a new base */
+  Run(900.0);
+  RtcPos -= (5.0 * SIM_TICK_HZ) + 300.0;
+  CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Sets, 1);
+  CHECK_EQ(stats.Measurements, 25);
+  CHECK(fabs(RtcOffset()) < 1.0);
+  CHECK_EQ(BaseOffset, 0);
+
+  /* the correction follows a LSE that moves (temperature) */
+  LseErrPpb = -10000.0;
+  for (i = 0; i < 16U; i++)
+  {
+    Run(900.0);
+    CHECK_EQ(RtcCal_Sync(HostMs()), SUCCESS);
+    RtcCal_Poll();
+  }
+  CHECK(abs(CalPulses() - (int32_t)lround(-LseErrPpb * 1048576.0 / 1e9)) <= 1);
+  CHECK(HostRtc.CALR & RTC_CALR_CALP);
+#endif
+
+  /* command: empty asks the state, 4 bytes sync */
+  CHECK_EQ(RtcCal_CmdHandler(req, 0, rsp), 13);
+  CHECK_EQ(rsp[0], RTC_CAL_STATUS_OK);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ((int32_t)(rsp[9] | (rsp[10] << 8) | (rsp[11] << 16) | ((uint32_t)rsp[12] << 24)), stats.CorrPpb);
+  ms = HostMs();
+  req[0] = (uint8_t)ms;
+  req[1] = (uint8_t)(ms >> 8);
+  req[2] = (uint8_t)(ms >> 16);
+  req[3] = (uint8_t)(ms >> 24);
+  i = stats.Syncs;
+  CHECK_EQ(RtcCal_CmdHandler(req, 4, rsp), 13);
+  CHECK_EQ(rsp[0], RTC_CAL_STATUS_OK);
+  RtcCal_GetStats(&stats);
+  CHECK_EQ(stats.Syncs, i + 1U);
+  req[3] = 0xFFU;
+  CHECK_EQ(RtcCal_CmdHandler(req, 4, rsp), 13);
+  CHECK_EQ(rsp[0], RTC_CAL_STATUS_REJECT);
+  CHECK(Resyncs != 0);
+  CHECK(Rebases != 0);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,535 @@
+/**
+  ******************************************************************************
+  * @file 		test_rtc_log.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the RTC event journal with synthetic bursts
+  *
+  *          RTC_LOG.c and RTC_TIME.c run on RAM copies of the RCC, RTC and
+  *          EXTI registers and two RAM flash pages (mapped below 4GB: the
+  *          module keeps flash addresses in 32 bits). The RTC model latches
+  *          a RTC_TS edge or a tamper event (TAMPTS) in TSTR / TSDR / TSSSR
+  *          and sets TSF; an event while TSF is set raises TSOVF and keeps
+  *          the stamp, as the hardware does. The flash model takes every
+  *          byte once after an erase and decodes the records as they are
+  *          programmed; time is a 1ms tick.
+  *          Checked: the tamper and time stamp setup; a batch of
+  *          RTC_LOG_BATCH records and a lone record after RTC_LOG_FLUSH_MS;
+  *          a ring full of events with the overflow counted as drops; TSOVF
+  *          journaled as a lost event; a tamper with its latched stamp or
+  *          at the current time; the stamp year taken back over new year;
+  *          the absolute time after a long gap or a clock set back; every
+  *          event of long random bursts decoded back from flash over many
+  *          page changes, the previous page kept; the journal resumed
+  *          after a reset; a flash error; the command pages. The flash
+  *          bytes and erases per record are printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static RTC_TypeDef HostRtc;
+static EXTI_TypeDef HostExti;
+static uint32_t HostTsConfig;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef RTC
+#define RTC                         (&HostRtc)
+#undef EXTI
+#define EXTI                        (&HostExti)
+/* the EXTI inline functions were compiled with the device registers */
+#define MS32_EXTI_EnableRisingTrig_0_31(ExtiLine)           (HostExti.RTSR |= (ExtiLine))
+#define MS32_EXTI_EnableIT_0_31(ExtiLine)                   (HostExti.IMR |= (ExtiLine))
+#define MS32_EXTI_ClearFlag_0_31(ExtiLine)                  (HostExti.PR &= ~(ExtiLine))
+/* the ISR flags are write 0 to clear, WRITE_REG() would set the others of the copy */
+#define MS32_RTC_ClearFlag_TS(RTCx)                         ((RTCx)->ISR &= ~RTC_ISR_TSF)
+#define MS32_RTC_ClearFlag_TSOV(RTCx)                       ((RTCx)->ISR &= ~RTC_ISR_TSOVF)
+#define MS32_RTC_ClearFlag_TAMP1(RTCx)                      ((RTCx)->ISR &= ~RTC_ISR_TAMP1F)
+#define MS32_RTC_ClearFlag_TAMP2(RTCx)                      ((RTCx)->ISR &= ~RTC_ISR_TAMP2F)
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+
+#include "RTC_LOG.h"
+static uint8_t *HostFlash;
+/* flash pages 29 and 30 */
+#undef RTC_LOG_FLASH_ADDR
+#define RTC_LOG_FLASH_ADDR          ((uint32_t)(uintptr_t)HostFlash)
+
+#include "../USER/RTC_TIME.c"
+#include "../USER/RTC_LOG.c"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_FLASH_SIZE              (RTC_LOG_FLASH_PAGES * RTC_LOG_FLASH_PAGE_SIZE)
+#define SIM_EVENTS                  20000U
+#define SIM_T0                      1735689000U     /* 2024-12-31 23:50:00 */
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t HostMs;
+static uint32_t Erases[RTC_LOG_FLASH_PAGES];
+static uint32_t WriteCalls;
+static uint8_t FlashFail;
+
+/* records expected, and decoded from the flash as they are programmed */
+static uint32_t ExpSec[SIM_EVENTS + 64U];
+static uint16_t ExpSub[SIM_EVENTS + 64U];
+static uint8_t ExpEvt[SIM_EVENTS + 64U];
+static uint32_t Exps;
+static uint32_t DecSec[SIM_EVENTS + 64U];
+static uint16_t DecSub[SIM_EVENTS + 64U];
+static uint8_t DecEvt[SIM_EVENTS + 64U];
+static uint32_t Decs;
+static uint32_t DecTime;
+static uint8_t DecAbsolute;
+static uint32_t DecBad;
+
+/* Stubs of the modules RTC_LOG calls ----------------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return HostMs;
+}
+
+void RtcWake_Resync(void)
+{
+}
+
+void RtcWake_Rebase(void)
+{
+}
+
+ErrorStatus MS32_RTC_EnterInitMode(RTC_TypeDef *RTCx)
+{
+  (void)RTCx;
+  return SUCCESS;
+}
+
+void MS32_RTC_TimStampConfig(RTC_TypeDef *RTCx, uint32_t TimStampEn, uint32_t TimStampEdge)
+{
+  HostTsConfig = TimStampEdge | ((TimStampEn == ENABLE) ? RTC_CR_TSE : 0U);
+  MODIFY_REG(RTCx->CR, RTC_CR_TSE | RTC_CR_TSEDGE, HostTsConfig);
+}
+
+ErrorStatus MS32_FLASH_PageErase(uint32_t page)
+{
+  uint32_t p = page - RTC_LOG_FLASH_PAGE;
+
+  CHECK(p < RTC_LOG_FLASH_PAGES);
+  if (FlashFail || (p >= RTC_LOG_FLASH_PAGES))
+  {
+    return ERROR;
+  }
+  memset(&HostFlash[p * RTC_LOG_FLASH_PAGE_SIZE], 0xFF, RTC_LOG_FLASH_PAGE_SIZE);
+  Erases[p]++;
+  return SUCCESS;
+}
+
+ErrorStatus MS32_FLASH_Write(uint32_t addr, uint8_t *dat_buf, uint32_t len)
+{
+  uint32_t at = addr - RTC_LOG_FLASH_ADDR;
+  uint32_t word;
+  uint32_t i;
+
+  if (FlashFail)
+  {
+    return ERROR;
+  }
+  WriteCalls++;
+  CHECK_EQ(at & 3U, 0);
+  CHECK_EQ(len & 3U, 0);
+  CHECK((at + len) <= SIM_FLASH_SIZE);
+  /* within one page, every byte programmed once after the erase */
+  CHECK_EQ(at / RTC_LOG_FLASH_PAGE_SIZE, (at + len - 1U) / RTC_LOG_FLASH_PAGE_SIZE);
+  for (i = 0; i < len; i++)
+  {
+    DecBad += HostFlash[at + i] != 0xFFU;
+  }
+  memcpy(&HostFlash[at], dat_buf, len);
+
+  for (i = 0; i < len; i += 4U)
+  {
+    word = dat_buf[i] | ((uint32_t)dat_buf[i + 1U] << 8) | ((uint32_t)dat_buf[i + 2U] << 16) |
+           ((uint32_t)dat_buf[i + 3U] << 24);
+    if (((at + i) % RTC_LOG_FLASH_PAGE_SIZE) == 0U)
+    {
+      DecBad += (word & 0xFFFFU) != RTC_LOG_MAGIC;
+    }
+    else if (((at + i) % RTC_LOG_FLASH_PAGE_SIZE) == 4U)
+    {
+      DecTime = word;
+    }
+    else if (DecAbsolute)
+    {
+      DecTime = word;
+      DecAbsolute = 0;
+    }
+    else if (word == RTC_LOG_ESCAPE)
+    {
+      DecAbsolute = 1;
+    }
+    else
+    {
+      DecTime += (word >> 10) & RTC_LOG_DELTA_MAX;
+      DecSec[Decs] = DecTime;
+      DecSub[Decs] = (uint16_t)(word & 0x3FFU);
+      DecEvt[Decs] = (uint8_t)(word >> 30);
+      Decs++;
+    }
+  }
+  return SUCCESS;
+}
+
+/**
+  * @brief Two BCD digits
+  */
+static uint32_t Bcd(uint32_t Value)
+{
+  return ((Value / 10U) << 4) | (Value % 10U);
+}
+
+/**
+  * @brief Show a Unix time on TR, DR and SSR
+  */
+static void RtcShow(uint32_t Sec, uint32_t Sub)
+{
+  time_t t = (time_t)Sec;
+  struct tm tm;
+
+  gmtime_r(&t, &tm);
+  HostRtc.TR = (Bcd(tm.tm_hour) << RTC_TR_HU_Pos) | (Bcd(tm.tm_min) << RTC_TR_MNU_Pos) |
+               (Bcd(tm.tm_sec) << RTC_TR_SU_Pos);
+  HostRtc.DR = (Bcd(tm.tm_year - 100) << RTC_DR_YU_Pos) | (Bcd(tm.tm_mon + 1) << RTC_DR_MU_Pos) |
+               (Bcd(tm.tm_mday) << RTC_DR_DU_Pos) |
+               ((uint32_t)((tm.tm_wday == 0) ? 7 : tm.tm_wday) << RTC_DR_WDU_Pos);
+  HostRtc.SSR = RTC_WAKE_PREDIV_S - Sub;
+}
+
+/**
+  * @brief An event on the RTC: the stamp latched unless TSF is still set
+  * @param Evt RTC_LOG_EVT_TS, _TAMP1, _TAMP2
+  * @param Latch the event takes a time stamp (RTC_TS edge, or TAMPTS)
+  */
+static void Event(uint8_t Evt, uint32_t Sec, uint32_t Sub, uint8_t Latch)
+{
+  time_t t = (time_t)Sec;
+  struct tm tm;
+
+  if (Latch && (HostRtc.ISR & RTC_ISR_TSF))
+  {
+    HostRtc.ISR |= RTC_ISR_TSOVF;
+  }
+  else if (Latch)
+  {
+    gmtime_r(&t, &tm);
+    HostRtc.TSTR = (Bcd(tm.tm_hour) << RTC_TR_HU_Pos) | (Bcd(tm.tm_min) << RTC_TR_MNU_Pos) |
+                   (Bcd(tm.tm_sec) << RTC_TR_SU_Pos);
+    HostRtc.TSDR = (Bcd(tm.tm_mon + 1) << RTC_DR_MU_Pos) | (Bcd(tm.tm_mday) << RTC_DR_DU_Pos) |
+                   ((uint32_t)((tm.tm_wday == 0) ? 7 : tm.tm_wday) << RTC_DR_WDU_Pos);
+    HostRtc.TSSSR = RTC_WAKE_PREDIV_S - Sub;
+    HostRtc.ISR |= RTC_ISR_TSF;
+  }
+  if (Evt == RTC_LOG_EVT_TAMP1)
+  {
+    HostRtc.ISR |= RTC_ISR_TAMP1F;
+  }
+  if (Evt == RTC_LOG_EVT_TAMP2)
+  {
+    HostRtc.ISR |= RTC_ISR_TAMP2F;
+  }
+  HostExti.PR |= MS32_EXTI_LINE_19;
+}
+
+/**
+  * @brief A record the journal must hold
+  */
+static void Expect(uint8_t Evt, uint32_t Sec, uint32_t Sub)
+{
+  ExpEvt[Exps] = Evt;
+  ExpSec[Exps] = Sec;
+  ExpSub[Exps] = (uint16_t)Sub;
+  Exps++;
+}
+
+/**
+  * @brief A RTC_TS edge serviced at once
+  */
+static void Edge(uint32_t Sec, uint32_t Sub)
+{
+  Event(RTC_LOG_EVT_TS, Sec, Sub, 1);
+  RtcLog_IRQHandler();
+  Expect(RTC_LOG_EVT_TS, Sec, Sub);
+}
+
+/**
+  * @brief Mismatches between the expected and the decoded records
+  */
+static uint32_t Compare(void)
+{
+  uint32_t bad = (Decs != Exps) ? 1U : 0U;
+  uint32_t i;
+
+  for (i = 0; (i < Decs) && (i < Exps); i++)
+  {
+    if ((DecSec[i] != ExpSec[i]) || (DecSub[i] != ExpSub[i]) || (DecEvt[i] != ExpEvt[i]))
+    {
+      if (bad == 0U)
+      {
+        printf("record %u: %u %u.%u, expected %u %u.%u\n", i, DecEvt[i], DecSec[i], DecSub[i],
+               ExpEvt[i], ExpSec[i], ExpSub[i]);
+      }
+      bad++;
+    }
+  }
+  return bad + DecBad;
+}
+
+/**
+  * @brief Read back a 32 bit value LSB first
+  */
+static uint32_t Get32(const uint8_t *Buf)
+{
+  return Buf[0] | ((uint32_t)Buf[1] << 8) | ((uint32_t)Buf[2] << 16) | ((uint32_t)Buf[3] << 24);
+}
+
+int main(void)
+{
+  RtcLog_StatsTypeDef stats;
+  uint8_t req[3];
+  uint8_t rsp[64];
+  uint32_t sec = SIM_T0;
+  uint32_t calls;
+  uint32_t burst;
+  uint32_t page;
+  uint32_t offset;
+  uint32_t last;
+  uint32_t i;
+  uint32_t k;
+  uint8_t len;
+
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  HostFlash = mmap(NULL, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+  CHECK(HostFlash != MAP_FAILED);
+  CHECK_EQ((uintptr_t)HostFlash, RTC_LOG_FLASH_ADDR);
+  memset(HostFlash, 0xFF, SIM_FLASH_SIZE);
+  HostRtc.PRER = RTC_WAKE_PREDIV_S;
+  HostRtc.ISR = RTC_ISR_INITS;
+  HostRcc.BDCR = RCC_BDCR_RTCEN;
+  RtcShow(SIM_T0, 0);
+
+  /* setup on erased pages: no page in use */
+  RtcLog_Init();
+  CHECK_EQ(Page, RTC_LOG_NO_PAGE);
+  CHECK_EQ(HostRtc.TAFCR & (RTC_TAFCR_TAMP1E | RTC_TAFCR_TAMP2E | RTC_TAFCR_TAMPTS | RTC_TAFCR_TAMPIE),
+           RTC_TAFCR_TAMP1E | RTC_TAFCR_TAMP2E | RTC_TAFCR_TAMPTS | RTC_TAFCR_TAMPIE);
+  CHECK_EQ(HostRtc.TAFCR & (RTC_TAFCR_TAMP1TRG | RTC_TAFCR_TAMP2TRG), RTC_LOG_TAMPER_TRG);
+  CHECK_EQ(HostTsConfig, RTC_CR_TSE | RTC_LOG_TS_EDGE);
+  CHECK(HostRtc.CR & RTC_CR_TSIE);
+  CHECK(HostExti.IMR & HostExti.RTSR & MS32_EXTI_LINE_19);
+
+  /* a batch: flushed at RTC_LOG_BATCH records, not before */
+  for (i = 0; i < RTC_LOG_BATCH; i++)
+  {
+    RtcLog_Poll();
+    CHECK_EQ(Decs, 0);
+    Edge(sec, i * 100U);
+    HostMs += 250U;
+    sec++;
+  }
+  CHECK_EQ(HostExti.PR, 0);
+  RtcLog_Poll();
+  CHECK_EQ(Erases[0], 1);
+  CHECK_EQ(WriteCalls, 2);        /* page header, the batch */
+  CHECK_EQ(Compare(), 0);
+  CHECK_EQ(Offset, RTC_LOG_HEADER + (RTC_LOG_BATCH * 4U));
+
+  /* a lone record: after RTC_LOG_FLUSH_MS */
+  Edge(sec, 1023U);
+  HostMs += RTC_LOG_FLUSH_MS - 1U;
+  RtcLog_Poll();
+  CHECK_EQ(Decs, RTC_LOG_BATCH);
+  HostMs++;
+  RtcLog_Poll();
+  CHECK_EQ(Compare(), 0);
+
+  /* more events than the ring holds before a poll: the rest dropped */
+  for (i = 0; i < (RTC_LOG_RING + 3U); i++)
+  {
+    sec += 2U;
+    Event(RTC_LOG_EVT_TS, sec, i, 1);
+    RtcLog_IRQHandler();
+    if (i < RTC_LOG_RING)
+    {
+      Expect(RTC_LOG_EVT_TS, sec, i);
+    }
+  }
+  calls = WriteCalls;
+  RtcLog_Poll();
+  CHECK_EQ(WriteCalls - calls, RTC_LOG_RING / RTC_LOG_BATCH);
+  CHECK_EQ(Compare(), 0);
+  RtcLog_GetStats(&stats);
+  CHECK_EQ(stats.Drops, 3);
+  CHECK_EQ(stats.Events, RTC_LOG_BATCH + 1U + RTC_LOG_RING + 3U);
+
+  /* TSOVF: a second edge before the interrupt, the first stamp kept */
+  sec += 5U;
+  Event(RTC_LOG_EVT_TS, sec, 512U, 1);
+  Event(RTC_LOG_EVT_TS, sec + 1U, 0, 1);
+  RtcLog_IRQHandler();
+  Expect(RTC_LOG_EVT_LOST, sec, 512U);
+  Expect(RTC_LOG_EVT_TS, sec, 512U);
+  CHECK_EQ(HostRtc.ISR & (RTC_ISR_TSF | RTC_ISR_TSOVF), 0);
+
+  /* tampers: with the latched stamp (TAMPTS), at the current time without */
+  sec += 3U;
+  Event(RTC_LOG_EVT_TAMP1, sec, 7U, 1);
+  RtcLog_IRQHandler();
+  Expect(RTC_LOG_EVT_TAMP1, sec, 7U);
+  RtcShow(sec + 1U, 300U);
+  Event(RTC_LOG_EVT_TAMP2, 0, 0, 0);
+  RtcLog_IRQHandler();
+  Expect(RTC_LOG_EVT_TAMP2, sec + 1U, 300U);
+  CHECK_EQ(HostRtc.ISR & (RTC_ISR_TSF | RTC_ISR_TAMP1F | RTC_ISR_TAMP2F), 0);
+
+  /* stamped on 31 December, read on 1 January: last year */
+  sec = SIM_T0 + 599U;            /* 2024-12-31 23:59:59 */
+  RtcShow(sec + 2U, 0);           /* 2025-01-01 00:00:01 */
+  Edge(sec, 1000U);
+  RtcShow(946684800U + (10U * 365U + 3U) * 86400U, 0);   /* 2010-01-01 */
+  Edge(946684800U + (10U * 365U + 2U) * 86400U + 3600U, 0);  /* 2009-12-31 01:00 */
+  RtcShow(1767225600U, 0);        /* 2026-01-01, and back to the stamp time */
+  Edge(1767225600U - 1U, 0);
+
+  /* a gap past the delta field, then the clock set back: absolute times */
+  Edge(1767225600U + RTC_LOG_DELTA_MAX + 10U, 0);
+  Edge(1767225600U, 0);
+  RtcLog_Flush();
+  CHECK_EQ(Compare(), 0);
+  RtcLog_GetStats(&stats);
+  CHECK_EQ(stats.HwLost, 1);
+  CHECK_EQ(stats.Records, Exps);
+  /* back to 2009, on to 2025, the gap, back to 2026: four absolute times */
+  CHECK_EQ(stats.BytesWritten, RTC_LOG_HEADER + (Exps * 4U) + (4U * 8U));
+
+  /* long random bursts, polled between them: a poll leaves less than a
+     batch, so bursts up to the rest of the ring lose nothing */
+  srand(46);
+  sec = 1767225600U;
+  for (k = 0; Exps < SIM_EVENTS; k++)
+  {
+    burst = 1U + ((uint32_t)rand() % (RTC_LOG_RING - RTC_LOG_BATCH + 1U));
+    for (i = 0; i < burst; i++)
+    {
+      sec += (uint32_t)rand() % 3U;
+      RtcShow(sec, 0);
+      Edge(sec, (uint32_t)rand() & RTC_WAKE_PREDIV_S);
+      HostMs++;
+    }
+    /* the main loop comes round every 1~3000ms */
+    HostMs += 1U + ((uint32_t)rand() % 3000U);
+    RtcLog_Poll();
+    if ((k % 64U) == 0U)
+    {
+      sec += (uint32_t)rand() % 100000U;
+    }
+  }
+  RtcLog_Flush();
+  CHECK_EQ(Compare(), 0);
+  RtcLog_GetStats(&stats);
+  CHECK_EQ(stats.Drops, 3);
+  CHECK_EQ(stats.Records, Exps);
+  CHECK_EQ(stats.Erases, Erases[0] + Erases[1]);
+  CHECK(Erases[0] > 10U);
+  CHECK(Erases[1] > 10U);
+  printf("%u records in %u flash writes, %u bytes (%.3f per record), %u erases (%.1f records each)\n",
+         stats.Records, WriteCalls, stats.BytesWritten, (double)stats.BytesWritten / stats.Records,
+         stats.Erases, (double)stats.Records / stats.Erases);
+  CHECK(stats.BytesWritten < (stats.Records * 41U / 10U));
+  CHECK(WriteCalls < (stats.Records / 4U));
+
+  /* the other page is the previous one, full and one sequence older */
+  page = Page;
+  CHECK_EQ(Get32(&HostFlash[(1U - page) * RTC_LOG_FLASH_PAGE_SIZE]) & 0xFFFFU, RTC_LOG_MAGIC);
+  CHECK_EQ((uint16_t)(Get32(&HostFlash[(1U - page) * RTC_LOG_FLASH_PAGE_SIZE]) >> 16), (uint16_t)(Seq - 1U));
+  CHECK(Get32(&HostFlash[((2U - page) * RTC_LOG_FLASH_PAGE_SIZE) - RTC_LOG_RECORD_MAX]) != RTC_LOG_ERASED);
+
+  /* reset: the journal resumes at the end of the newest page */
+  offset = Offset;
+  last = LastSec;
+  k = Seq;
+  Page = RTC_LOG_NO_PAGE;
+  Seq = 0;
+  Offset = 0;
+  LastSec = 0;
+  RtcLog_Init();
+  CHECK_EQ(Page, page);
+  CHECK_EQ(Seq, k);
+  CHECK_EQ(Offset, offset);
+  CHECK_EQ(LastSec, last);
+  for (i = 0; i < RTC_LOG_BATCH; i++)
+  {
+    Edge(++sec, i);
+  }
+  RtcLog_Poll();
+  CHECK_EQ(Compare(), 0);
+
+  /* a flash error: those records are gone, the next ones decode right */
+  for (i = 0; i < 3U; i++)
+  {
+    sec += 10U;
+    Event(RTC_LOG_EVT_TS, sec, i, 1);
+    RtcLog_IRQHandler();
+  }
+  FlashFail = 1;
+  RtcLog_Flush();
+  FlashFail = 0;
+  RtcLog_GetStats(&stats);
+  CHECK_EQ(stats.SaveErrors, 1);
+  Edge(sec + 1U, 5U);
+  RtcLog_Flush();
+  CHECK_EQ(Compare(), 0);
+
+  /* command: statistics, then journal bytes from an offset */
+  len = RtcLog_CmdHandler(req, 0, rsp);
+  RtcLog_GetStats(&stats);
+  CHECK_EQ(len, 29);
+  CHECK_EQ(rsp[0], RTC_LOG_PAGE_STATS);
+  CHECK_EQ(Get32(&rsp[1]), stats.Events);
+  CHECK_EQ(Get32(&rsp[13]), stats.Records);
+  CHECK_EQ(Get32(&rsp[25]), 1);
+  req[0] = RTC_LOG_PAGE_FLASH;
+  req[1] = 0x04U;
+  req[2] = 0x04U;                 /* offset 0x404 */
+  len = RtcLog_CmdHandler(req, 3, rsp);
+  CHECK_EQ(len, 3U + RTC_LOG_READ_MAX);
+  CHECK_EQ(rsp[1], 0x04);
+  CHECK_EQ(Get32(&rsp[3]), Get32(&HostFlash[0x404]));
+  req[1] = (uint8_t)(SIM_FLASH_SIZE - 4U);
+  req[2] = (uint8_t)((SIM_FLASH_SIZE - 4U) >> 8);
+  len = RtcLog_CmdHandler(req, 3, rsp);
+  CHECK_EQ(len, 3U + 4U);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,394 @@
+/**
+  ******************************************************************************
+  * @file 		test_rtc_time.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the RTC calendar and Unix time conversion
+  *
+  *          RTC_TIME.c runs on RAM copies of the RCC and RTC registers; the
+  *          RTC block is reached through a function that counts the
+  *          accesses, so a second (or midnight) roll can be made to happen
+  *          between any two reads of a snapshot. The C library with TZ=UTC
+  *          is the reference calendar.
+  *          Checked: the reciprocal divisions exact over their whole input
+  *          ranges; every day of 2000-01-01 ~ 2099-12-31 at a moving time of
+  *          day, and at its first and last second, against gmtime() and
+  *          mktime() both ways (weekday included); every second of each
+  *          28 Feb ~ 1 Mar (leap days of 2000, 2004 ... 2096); the range
+  *          ends: 2099-12-31 23:59:59 is RTC_TIME_EPOCH_MAX, 2100 (not a
+  *          leap year, and past the 2 digit RTC year) and 1999 refused by
+  *          RtcTime_Set(); the 12 hour format; the snapshot never mixing the
+  *          two sides of a roll, the sub-seconds after a shift, no stamp
+  *          with the RTC stopped or never set; RtcTime_Set() registers.
+  *          The host time of one conversion is printed against mktime()
+  *          and gmtime(); the host divides in hardware, the M0 does not.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static RTC_TypeDef HostRtc;
+static uint32_t RtcAccesses;
+static uint32_t RollAt;         /* roll to RollTr / RollDr / RollSsr at this access, 0: never */
+static uint32_t RollTr;
+static uint32_t RollDr;
+static uint32_t RollSsr;
+
+/**
+  * @brief RTC register block, counting the accesses
+  */
+static RTC_TypeDef *HostRtcAccess(void)
+{
+  if (++RtcAccesses == RollAt)
+  {
+    HostRtc.TR = RollTr;
+    HostRtc.DR = RollDr;
+    HostRtc.SSR = RollSsr;
+  }
+  return &HostRtc;
+}
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef RTC
+#define RTC                         (HostRtcAccess())
+
+#include "../USER/RTC_TIME.c"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_PREDIV_S                1023U
+#define SIM_DAYS                    36525U      /* 2000 ~ 2099 */
+#define BENCH_LOOPS                 1000000U
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t Resyncs;
+static uint32_t Rebases;
+static ErrorStatus InitStatus = SUCCESS;
+
+/* Stubs of the modules RTC_TIME calls ---------------------------------------*/
+void RtcWake_Resync(void)
+{
+  Resyncs++;
+}
+
+void RtcWake_Rebase(void)
+{
+  Rebases++;
+}
+
+ErrorStatus MS32_RTC_EnterInitMode(RTC_TypeDef *RTCx)
+{
+  if (InitStatus == SUCCESS)
+  {
+    RTCx->ISR |= RTC_ISR_INIT | RTC_ISR_INITF;
+  }
+  return InitStatus;
+}
+
+/**
+  * @brief Two BCD digits, reference
+  */
+static uint32_t Bcd(uint32_t Value)
+{
+  return ((Value / 10U) << 4) | (Value % 10U);
+}
+
+/**
+  * @brief RTC_TR of a broken down time, 24 hours
+  */
+static uint32_t TrOf(const struct tm *Tm)
+{
+  return (Bcd(Tm->tm_hour) << RTC_TR_HU_Pos) | (Bcd(Tm->tm_min) << RTC_TR_MNU_Pos) |
+         (Bcd(Tm->tm_sec) << RTC_TR_SU_Pos);
+}
+
+/**
+  * @brief RTC_DR of a broken down time, WeekDay 1 Monday ~ 7 Sunday
+  */
+static uint32_t DrOf(const struct tm *Tm)
+{
+  return (Bcd(Tm->tm_year - 100) << RTC_DR_YU_Pos) | (Bcd(Tm->tm_mon + 1) << RTC_DR_MU_Pos) |
+         (Bcd(Tm->tm_mday) << RTC_DR_DU_Pos) |
+         ((uint32_t)((Tm->tm_wday == 0) ? 7 : Tm->tm_wday) << RTC_DR_WDU_Pos);
+}
+
+/**
+  * @brief Both ways against the C library, count the mismatches
+  */
+static uint32_t Convert(uint32_t Epoch, uint8_t WithMktime)
+{
+  MS32_RTC_DateTypeDef date;
+  MS32_RTC_TimeTypeDef time;
+  time_t t = (time_t)Epoch;
+  struct tm tm;
+  struct tm back;
+  uint32_t bad = 0;
+
+  gmtime_r(&t, &tm);
+  RtcTime_FromEpoch(Epoch, &date, &time);
+  bad += (date.Year != (tm.tm_year - 100)) || (date.Month != (tm.tm_mon + 1)) ||
+         (date.Day != tm.tm_mday) || (date.WeekDay != ((tm.tm_wday == 0) ? 7 : tm.tm_wday));
+  bad += (time.Hours != tm.tm_hour) || (time.Minutes != tm.tm_min) ||
+         (time.Seconds != tm.tm_sec) || (time.TimeFormat != MS32_RTC_TIME_FORMAT_AM_OR_24);
+  bad += RtcTime_ToEpoch(TrOf(&tm), DrOf(&tm)) != Epoch;
+  if (WithMktime)
+  {
+    back = tm;
+    back.tm_isdst = 0;
+    bad += (uint32_t)mktime(&back) != Epoch;
+  }
+  return bad;
+}
+
+/**
+  * @brief Host time of one call, ns
+  */
+static double Elapsed(const struct timespec *T0)
+{
+  struct timespec t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return ((t1.tv_sec - T0->tv_sec) * 1e9 + (t1.tv_nsec - T0->tv_nsec)) / BENCH_LOOPS;
+}
+
+int main(void)
+{
+  MS32_RTC_DateTypeDef date;
+  MS32_RTC_TimeTypeDef time;
+  RtcTime_StampTypeDef stamp;
+  struct timespec t0;
+  struct tm tm;
+  time_t t;
+  uint64_t sum = 0;
+  uint32_t epoch;
+  uint32_t bad;
+  uint32_t day;
+  uint32_t x;
+  uint32_t i;
+  double ns[4];
+
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  /* the reciprocal divisions over their input ranges */
+  bad = 0;
+  for (x = 0; x < 86400U; x++)
+  {
+    bad += RTC_TIME_DIV3600(x) != (x / 3600U);
+  }
+  for (x = 0; x < 3600U; x++)
+  {
+    bad += RTC_TIME_DIV60(x) != (x / 60U);
+  }
+  for (x = 0; x < 49720U; x++)
+  {
+    bad += RTC_TIME_DIV7(x) != (x / 7U);
+  }
+  for (x = 0; x < 36525U; x++)
+  {
+    bad += RTC_TIME_DIV1461(x) != (x / 1461U);
+  }
+  for (x = 0; x < 100U; x++)
+  {
+    bad += RTC_TIME_DIV10(x) != (x / 10U);
+    bad += RtcTime_ToBcd(x) != Bcd(x);
+    bad += RtcTime_FromBcd(Bcd(x)) != x;
+  }
+  CHECK_EQ(bad, 0);
+  /* days of any 32 bit time: both sides of every day boundary */
+  bad = 0;
+  for (day = 1; day <= (0xFFFFFFFFU / RTC_TIME_DAY_S); day++)
+  {
+    bad += RTC_TIME_DIV86400((day * RTC_TIME_DAY_S) - 1U) != (day - 1U);
+    bad += RTC_TIME_DIV86400(day * RTC_TIME_DAY_S) != day;
+  }
+  CHECK_EQ(RTC_TIME_DIV86400(0xFFFFFFFFU), 0xFFFFFFFFU / RTC_TIME_DAY_S);
+  CHECK_EQ(bad, 0);
+
+  /* every day of the range: a moving time of day, the first and last second */
+  for (day = 0; day < SIM_DAYS; day++)
+  {
+    epoch = RTC_TIME_EPOCH_MIN + (day * RTC_TIME_DAY_S);
+    bad = Convert(epoch + ((day * 7919U) % RTC_TIME_DAY_S), 1);
+    bad += Convert(epoch, 1);
+    bad += Convert(epoch + RTC_TIME_DAY_S - 1U, 1);
+    CHECK_EQ(bad, 0);
+  }
+
+  /* every second of 28 Feb ~ 1 Mar: the leap years of a 2000 ~ 2099 RTC */
+  for (i = 0; i < 100U; i++)
+  {
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 100 + (int)i;
+    tm.tm_mon = 1;
+    tm.tm_mday = 28;
+    epoch = (uint32_t)mktime(&tm);
+    bad = 0;
+    for (x = 0; x < ((((i & 3U) == 0U) ? 3U : 2U) * RTC_TIME_DAY_S); x++)
+    {
+      bad += Convert(epoch + x, 0);
+    }
+    CHECK_EQ(bad, 0);
+    RtcTime_FromEpoch(epoch + RTC_TIME_DAY_S, &date, &time);
+    CHECK_EQ(date.Month, ((i & 3U) == 0U) ? 2 : 3);
+    CHECK_EQ(date.Day, ((i & 3U) == 0U) ? 29 : 1);
+  }
+
+  /* the range ends */
+  RtcTime_FromEpoch(RTC_TIME_EPOCH_MIN, &date, &time);
+  CHECK_EQ(date.Year, 0);
+  CHECK_EQ(date.Month, 1);
+  CHECK_EQ(date.Day, 1);
+  CHECK_EQ(date.WeekDay, 6);      /* Saturday */
+  RtcTime_FromEpoch(RTC_TIME_EPOCH_MAX, &date, &time);
+  CHECK_EQ(date.Year, 99);
+  CHECK_EQ(date.Month, 12);
+  CHECK_EQ(date.Day, 31);
+  CHECK_EQ(date.WeekDay, 4);      /* Thursday */
+  CHECK_EQ(time.Hours, 23);
+  CHECK_EQ(time.Minutes, 59);
+  CHECK_EQ(time.Seconds, 59);
+  CHECK_EQ(RtcTime_ToEpoch(0x235959U, 0x999231U), RTC_TIME_EPOCH_MAX);
+  /* 2000 is a leap year, 2100 is not: only the former is in range */
+  t = (time_t)RTC_TIME_EPOCH_MAX + 1 + (59 * RTC_TIME_DAY_S);
+  gmtime_r(&t, &tm);
+  CHECK_EQ(tm.tm_mon + 1, 3);
+  CHECK_EQ(tm.tm_mday, 1);
+  CHECK_EQ(RtcTime_ToEpoch(0, 0x004229U), RTC_TIME_EPOCH_MIN + (59 * RTC_TIME_DAY_S));
+  /* the 2 digit year rolls 99 to 00: back to 2000 */
+  CHECK_EQ(RtcTime_ToEpoch(0, 0x00C101U), RTC_TIME_EPOCH_MIN);
+  /* month 0 (never written) reads as January */
+  CHECK_EQ(RtcTime_ToEpoch(0, 0x000001U), RTC_TIME_EPOCH_MIN);
+  Resyncs = 0;
+  CHECK(RtcTime_Set(RTC_TIME_EPOCH_MAX + 1U) == ERROR);
+  CHECK(RtcTime_Set(RTC_TIME_EPOCH_MIN - 1U) == ERROR);
+  CHECK_EQ(Resyncs, 0);
+
+  /* 12 hour format: 12 AM is 0h, 12 PM is 12h, 1 PM is 13h */
+  HostRtc.CR = RTC_CR_FMT;
+  CHECK_EQ(RtcTime_ToEpoch(0x120000U, 0x00C101U), RTC_TIME_EPOCH_MIN);
+  CHECK_EQ(RtcTime_ToEpoch(RTC_TR_PM | 0x120000U, 0x00C101U), RTC_TIME_EPOCH_MIN + (12U * 3600U));
+  CHECK_EQ(RtcTime_ToEpoch(RTC_TR_PM | 0x011500U, 0x00C101U), RTC_TIME_EPOCH_MIN + (13U * 3600U) + 900U);
+  CHECK_EQ(RtcTime_ToEpoch(0x115959U, 0x00C101U), RTC_TIME_EPOCH_MIN + (12U * 3600U) - 1U);
+  HostRtc.CR = 0;
+
+  /* snapshot: the RTC stopped or never set */
+  HostRtc.PRER = SIM_PREDIV_S;
+  CHECK_EQ(RtcTime_Get(&stamp), 0);
+  HostRcc.BDCR = RCC_BDCR_RTCEN;
+  CHECK_EQ(RtcTime_Get(&stamp), 0);
+  HostRtc.ISR = RTC_ISR_INITS;
+
+  /* snapshot: midnight 2024-02-29 rolls before, between any two reads of
+     SSR, TR, DR and their second reading, or after them */
+  for (i = 2; i <= 8U; i++)
+  {
+    HostRtc.TR = 0x235959U;
+    HostRtc.DR = 0x246228U;     /* Wednesday 2024-02-28 */
+    HostRtc.SSR = 0;
+    RollTr = 0;
+    RollDr = 0x248229U;         /* Thursday 2024-02-29 */
+    RollSsr = SIM_PREDIV_S;
+    RtcAccesses = 0;
+    RollAt = i;                 /* access 1: INITS */
+    CHECK_EQ(RtcTime_Get(&stamp), 1);
+    if (i < 8U)
+    {
+      CHECK_EQ(stamp.Seconds, 1709164800U);
+      CHECK_EQ(stamp.SubTicks, 0);
+    }
+    else
+    {
+      CHECK_EQ(stamp.Seconds, 1709164800U - 1U);
+      CHECK_EQ(stamp.SubTicks, SIM_PREDIV_S);
+    }
+    /* a roll within the first reading is read again: more than INITS,
+       two readings, PRER and CR */
+    CHECK_EQ(RtcAccesses > 9U, (i > 2U) && (i < 8U));
+  }
+  RollAt = 0;
+
+  /* sub-seconds: SSR counts down, after a shift it reads above PREDIV_S */
+  HostRtc.SSR = SIM_PREDIV_S - 100U;
+  RtcTime_Get(&stamp);
+  CHECK_EQ(stamp.Seconds, 1709164800U);
+  CHECK_EQ(stamp.SubTicks, 100);
+  HostRtc.SSR = SIM_PREDIV_S + 1U + 200U;
+  RtcTime_Get(&stamp);
+  CHECK_EQ(stamp.Seconds, 1709164800U - 1U);
+  CHECK_EQ(stamp.SubTicks, SIM_PREDIV_S - 200U);
+
+  /* RtcTime_Set: time and date in BCD, one init mode, RTC_WAKE carried over */
+  Resyncs = 0;
+  Rebases = 0;
+  HostRtc.ISR = RTC_ISR_INITS;
+  CHECK(RtcTime_Set(4102444799U - (RTC_TIME_DAY_S * 365U) - 3723U) == SUCCESS);    /* 2098-12-31 22:57:56 */
+  CHECK_EQ(HostRtc.TR, 0x225756U);
+  CHECK_EQ(HostRtc.DR, 0x987231U);                     /* Wednesday */
+  CHECK_EQ(HostRtc.ISR & RTC_ISR_INIT, 0);
+  CHECK_EQ(HostRtc.WPR, 0xFFU);
+  CHECK_EQ(Resyncs, 1);
+  CHECK_EQ(Rebases, 1);
+  InitStatus = ERROR;
+  HostRtc.TR = 0;
+  CHECK(RtcTime_Set(RTC_TIME_EPOCH_MIN) == ERROR);
+  CHECK_EQ(HostRtc.TR, 0);
+  CHECK_EQ(Rebases, 2);
+  InitStatus = SUCCESS;
+
+  /* host time of one conversion, over the whole range */
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < BENCH_LOOPS; i++)
+  {
+    t = (time_t)RTC_TIME_EPOCH_MIN + ((uint64_t)i * 3155U);
+    gmtime_r(&t, &tm);
+    sum += tm.tm_mday;
+  }
+  ns[0] = Elapsed(&t0);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < BENCH_LOOPS; i++)
+  {
+    RtcTime_FromEpoch(RTC_TIME_EPOCH_MIN + (i * 3155U), &date, &time);
+    sum += date.Day;
+  }
+  ns[1] = Elapsed(&t0);
+  gmtime_r(&t, &tm);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < BENCH_LOOPS; i++)
+  {
+    tm.tm_sec = (int)(i & 63U);
+    tm.tm_isdst = 0;
+    sum += (uint32_t)mktime(&tm);
+  }
+  ns[2] = Elapsed(&t0);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < BENCH_LOOPS; i++)
+  {
+    sum += RtcTime_ToEpoch(0x235900U | (i & 0x3FU), 0x999231U);
+  }
+  ns[3] = Elapsed(&t0);
+  printf("to date: gmtime %.1f ns, RtcTime_FromEpoch %.1f ns\n", ns[0], ns[1]);
+  printf("to epoch: mktime %.1f ns, RtcTime_ToEpoch %.1f ns (sum %llu)\n", ns[2], ns[3],
+         (unsigned long long)(sum & 0xFFFFU));
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,456 @@
+/**
+  ******************************************************************************
+  * @file 		test_rtc_wake.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the RTC_WAKE scheduler and STOP resync
+  *
+  *          RTC_WAKE.c runs on RAM copies of the RCC, RTC and EXTI registers.
+  *          The model keeps the real time in us: the RTC shows it as TR and
+  *          SSR (1024 ticks a second, from a settable time of day), the
+  *          SysTick tick follows it in RUN and SLEEP and stands still in
+  *          STOP. The POWER_MGR stub sleeps 1ms on a SLEEP vote; on a STOP
+  *          vote it runs the real time to the armed alarm (or to an earlier
+  *          interrupt), calls RtcWake_Resync() as PowerMgr_Idle() does,
+  *          then the alarm interrupt.
+  *          Checked: the LSE timeout and the foreign RTC clock refused; the
+  *          time of day in ticks, nothing without RTCEN or BYPSHAD; the job
+  *          arguments; short waits on SLEEP and SysTick; long waits on the
+  *          alarm (time and sub-second, rounded up, over midnight, at most
+  *          RTC_WAKE_MAX_STOP_MS); the SysTick tick moved to the RTC time
+  *          with no drift over a thousand STOPs of an odd period; wakes by
+  *          another interrupt; skipped periods; RtcWake_Rebase() after a RTC
+  *          jump. The lateness of the jobs for a few periods is printed.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static RTC_TypeDef HostRtc;
+static EXTI_TypeDef HostExti;
+static uint8_t LseFitted = 1;
+static uint32_t HostTick;
+
+/**
+  * @brief LSERDY poll, 1ms a poll
+  */
+static uint32_t HostLseReady(void)
+{
+  HostTick++;
+  if (LseFitted && (HostRcc.BDCR & RCC_BDCR_LSEON))
+  {
+    HostRcc.BDCR |= RCC_BDCR_LSERDY;
+  }
+  return (HostRcc.BDCR & RCC_BDCR_LSERDY) != 0U;
+}
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef RTC
+#define RTC                         (&HostRtc)
+#undef EXTI
+#define EXTI                        (&HostExti)
+/* the RCC, PWR and EXTI inline functions were compiled with the device registers */
+#define MS32_APB1_GRP1_EnableClock(Periphs)                 (HostRcc.APB1ENR |= (Periphs))
+#define MS32_PWR_EnableBkUpAccess()                         ((void)0)
+#define MS32_RCC_LSE_Enable()                               (HostRcc.BDCR |= RCC_BDCR_LSEON)
+#define MS32_RCC_LSE_IsReady()                              (HostLseReady())
+#define MS32_RCC_GetRTCClockSource()                        (HostRcc.BDCR & RCC_BDCR_RTCSEL)
+#define MS32_RCC_SetRTCClockSource(Source)                  (HostRcc.BDCR = (HostRcc.BDCR & ~RCC_BDCR_RTCSEL) | (Source))
+#define MS32_RCC_EnableRTC()                                (HostRcc.BDCR |= RCC_BDCR_RTCEN)
+#define MS32_EXTI_EnableRisingTrig_0_31(ExtiLine)           (HostExti.RTSR |= (ExtiLine))
+#define MS32_EXTI_EnableIT_0_31(ExtiLine)                   (HostExti.IMR |= (ExtiLine))
+#define MS32_EXTI_ClearFlag_0_31(ExtiLine)                  (HostExti.PR &= ~(ExtiLine))
+/* ALRAF is write 0 to clear, WRITE_REG() would set the other flags of the copy */
+#define MS32_RTC_ClearFlag_ALRA(RTCx)                       ((RTCx)->ISR &= ~RTC_ISR_ALRAF)
+#undef NVIC_SetPriority
+#define NVIC_SetPriority(IRQn, Priority)                    ((void)0)
+#undef NVIC_EnableIRQ
+#define NVIC_EnableIRQ(IRQn)                                ((void)0)
+
+#include "../USER/RTC_WAKE.c"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_DAY_TICKS               (RTC_WAKE_DAY_S * RTC_WAKE_TICK_HZ)
+#define SIM_ODD_PERIOD_MS           333U
+#define SIM_ODD_STOPS               1000U
+
+/* Variables -----------------------------------------------------------------*/
+static uint64_t RealUs;         /* real time */
+static uint64_t RtcBaseUs;      /* real time of RTC tick 0 */
+static uint32_t RtcInits;
+static uint32_t AlarmTicks;     /* armed alarm, time of day in ticks */
+static uint32_t AlarmSets;
+static uint8_t LastVote = 0xFF;
+static uint32_t IrqAfterMs;     /* another interrupt ends STOP after this, 0: none */
+static uint32_t JobRuns[RTC_WAKE_MAX_JOBS];
+static uint32_t JobRunTick[RTC_WAKE_MAX_JOBS];
+
+/**
+  * @brief Show the real time on TR and SSR
+  */
+static void RtcShow(void)
+{
+  uint32_t ticks = (uint32_t)((((RealUs - RtcBaseUs) * RTC_WAKE_TICK_HZ) / 1000000U) % SIM_DAY_TICKS);
+  uint32_t sec = ticks / RTC_WAKE_TICK_HZ;
+  uint32_t h = sec / 3600U;
+  uint32_t m = (sec / 60U) % 60U;
+  uint32_t s = sec % 60U;
+
+  HostRtc.TR = ((h / 10U) << RTC_TR_HT_Pos) | ((h % 10U) << RTC_TR_HU_Pos) |
+               ((m / 10U) << RTC_TR_MNT_Pos) | ((m % 10U) << RTC_TR_MNU_Pos) |
+               ((s / 10U) << RTC_TR_ST_Pos) | ((s % 10U) << RTC_TR_SU_Pos);
+  HostRtc.SSR = RTC_WAKE_PREDIV_S - (ticks % RTC_WAKE_TICK_HZ);
+}
+
+/**
+  * @brief Set the RTC time of day, in ticks
+  */
+static void RtcSet(uint32_t Ticks)
+{
+  RtcBaseUs = RealUs - (((uint64_t)Ticks * 1000000U) / RTC_WAKE_TICK_HZ);
+  /* the division above rounds down: keep the tick exact */
+  while ((((RealUs - RtcBaseUs) * RTC_WAKE_TICK_HZ) / 1000000U) < Ticks)
+  {
+    RtcBaseUs--;
+  }
+  RtcShow();
+}
+
+/**
+  * @brief RTC time of day in ticks
+  */
+static uint32_t RtcNow(void)
+{
+  return (uint32_t)((((RealUs - RtcBaseUs) * RTC_WAKE_TICK_HZ) / 1000000U) % SIM_DAY_TICKS);
+}
+
+/**
+  * @brief Real time running with SysTick
+  */
+static void Run(uint32_t Ms)
+{
+  RealUs += (uint64_t)Ms * 1000U;
+  HostTick += Ms;
+  RtcShow();
+}
+
+/* Stubs of the modules RTC_WAKE calls ---------------------------------------*/
+uint32_t SysTick_GetTick(void)
+{
+  return HostTick;
+}
+
+uint32_t SysTick_Resync(uint32_t Ms)
+{
+  uint32_t step = Ms - HostTick;
+
+  if ((int32_t)step <= 0)
+  {
+    return 0;
+  }
+  HostTick = Ms;
+  return step;
+}
+
+ErrorStatus MS32_RTC_Init(RTC_TypeDef *RTCx, MS32_RTC_InitTypeDef *RtcInitStr, uint32_t RefInEn, uint32_t CoeFunc)
+{
+  RtcInits++;
+  RTCx->PRER = (RtcInitStr->AsynchPrescaler << RTC_PRER_PREDIV_A_Pos) | RtcInitStr->SynchPrescaler;
+  return SUCCESS;
+}
+
+ErrorStatus MS32_RTC_SetAlarm(RTC_TypeDef *RTCx, uint32_t RtcFormat, MS32_RTC_AlarmTypeDef *RtcAlarmStr)
+{
+  uint32_t sec = (RtcAlarmStr->AlarmTime.Hours * 3600U) + (RtcAlarmStr->AlarmTime.Minutes * 60U) +
+                 RtcAlarmStr->AlarmTime.Seconds;
+
+  AlarmSets++;
+  CHECK_EQ(RtcFormat, MS32_RTC_FORMAT_BIN);
+  CHECK_EQ(RtcAlarmStr->AlarmMask, MS32_RTC_ALARM_MASK_DATEWEEKDAY);
+  CHECK_EQ((RTCx->ALRMASSR & RTC_ALRMASSR_MASKSS) >> RTC_ALRMASSR_MASKSS_Pos, RTC_WAKE_ALARM_MASKSS);
+  AlarmTicks = (sec * RTC_WAKE_TICK_HZ) + (RTC_WAKE_PREDIV_S - (RTCx->ALRMASSR & RTC_ALRMASSR_SS));
+  return SUCCESS;
+}
+
+void PowerMgr_Vote(uint32_t Client, uint8_t Mode)
+{
+  CHECK_EQ(Client, POWER_MGR_CLIENT_RTC);
+  LastVote = Mode;
+}
+
+/**
+  * @brief SLEEP for 1ms, or STOP until the alarm or another interrupt
+  */
+uint8_t PowerMgr_Idle(void)
+{
+  uint32_t ticks;
+  uint8_t alarm;
+
+  if (LastVote != POWER_MGR_STOP_LP)
+  {
+    Run(1);
+    return POWER_MGR_SLEEP;
+  }
+  alarm = (HostRtc.CR & (RTC_CR_ALRAE | RTC_CR_ALRAIE)) == (RTC_CR_ALRAE | RTC_CR_ALRAIE);
+  ticks = alarm ? ((AlarmTicks + SIM_DAY_TICKS - RtcNow()) % SIM_DAY_TICKS) : SIM_DAY_TICKS;
+  if ((IrqAfterMs != 0) && (((uint64_t)IrqAfterMs * RTC_WAKE_TICK_HZ) < ((uint64_t)ticks * 1000U)))
+  {
+    RealUs += (uint64_t)IrqAfterMs * 1000U;
+    alarm = 0;
+  }
+  else
+  {
+    /* to the first us of the alarm tick */
+    while (RtcNow() != AlarmTicks)
+    {
+      RealUs++;
+    }
+  }
+  RtcShow();
+  RtcWake_Resync();
+  if (alarm)
+  {
+    HostRtc.ISR |= RTC_ISR_ALRAF;
+    HostExti.PR |= MS32_EXTI_LINE_17;
+    RtcWake_IRQHandler();
+    CHECK_EQ(HostRtc.ISR & RTC_ISR_ALRAF, 0);
+    CHECK_EQ(HostExti.PR & MS32_EXTI_LINE_17, 0);
+  }
+  return POWER_MGR_STOP_LP;
+}
+
+static void Job0(void)
+{
+  JobRuns[0]++;
+  JobRunTick[0] = HostTick;
+}
+
+static void Job1(void)
+{
+  JobRuns[1]++;
+  JobRunTick[1] = HostTick;
+}
+
+/**
+  * @brief Real time of the RTC in ms since tick 0, over the day
+  */
+static uint32_t RtcMsOfDay(void)
+{
+  return (uint32_t)(((uint64_t)RtcNow() * 1000U) / RTC_WAKE_TICK_HZ);
+}
+
+int main(void)
+{
+  RtcWake_StatsTypeDef stats;
+  static const uint32_t periods[] = {50, 250, 1000, 5000, 60000};
+  uint32_t ticks;
+  uint32_t start;
+  uint32_t due;
+  uint32_t i;
+  uint32_t p;
+
+  HostRtc.ISR = RTC_ISR_ALRAWF;
+
+  /* no crystal: ERROR after RTC_WAKE_LSE_TIMEOUT_MS */
+  LseFitted = 0;
+  CHECK_EQ(RtcWake_Init(), ERROR);
+  CHECK(HostTick > RTC_WAKE_LSE_TIMEOUT_MS);
+  CHECK_EQ(Started, 0);
+  LseFitted = 1;
+
+  /* RTC on another clock: only a backup domain reset changes it */
+  HostRcc.BDCR = MS32_RCC_RTC_CLKSOURCE_LSI;
+  CHECK_EQ(RtcWake_Init(), ERROR);
+  HostRcc.BDCR = 0;
+
+  /* time of day in ticks: nothing before RTCEN and BYPSHAD */
+  RealUs = 1000000U;
+  RtcSet((23U * 3600U + 59U * 60U + 58U) * RTC_WAKE_TICK_HZ + 1000U);
+  CHECK_EQ(RtcWake_GetTicks(&ticks), 0);
+  CHECK_EQ(RtcWake_Init(), SUCCESS);
+  CHECK_EQ(RtcInits, 1);
+  CHECK_EQ(HostRtc.PRER, RTC_WAKE_PRER);
+  CHECK_EQ(HostRcc.BDCR & RCC_BDCR_RTCSEL, MS32_RCC_RTC_CLKSOURCE_LSE);
+  CHECK(HostRcc.BDCR & RCC_BDCR_RTCEN);
+  CHECK(HostRtc.CR & RTC_CR_BYPSHAD);
+  CHECK(HostExti.IMR & MS32_EXTI_LINE_17);
+  CHECK(HostExti.RTSR & MS32_EXTI_LINE_17);
+  CHECK_EQ(RtcWake_GetTicks(&ticks), 1);
+  CHECK_EQ(ticks, (23U * 3600U + 59U * 60U + 58U) * RTC_WAKE_TICK_HZ + 1000U);
+  for (i = 0; i < SIM_DAY_TICKS; i += 4099U)
+  {
+    RtcSet(i);
+    CHECK_EQ(RtcWake_GetTicks(&ticks), 1);
+    CHECK_EQ(ticks, i);
+  }
+  HostRtc.CR &= ~RTC_CR_BYPSHAD;
+  CHECK_EQ(RtcWake_GetTicks(&ticks), 0);
+  HostRtc.CR |= RTC_CR_BYPSHAD;
+  /* already set up: a second Init keeps the prescalers */
+  CHECK_EQ(RtcWake_Init(), SUCCESS);
+  CHECK_EQ(RtcInits, 1);
+
+  /* job arguments */
+  CHECK_EQ(RtcWake_Start(RTC_WAKE_MAX_JOBS, 100, Job0), ERROR);
+  CHECK_EQ(RtcWake_Start(0, 0, Job0), ERROR);
+  CHECK_EQ(RtcWake_Start(0, 0x80000000U, Job0), ERROR);
+  /* no job: returns without sleeping */
+  LastVote = 0xFF;
+  RtcWake_Run();
+  CHECK_EQ(LastVote, 0xFF);
+
+  /* a short period sleeps on SysTick */
+  CHECK_EQ(RtcWake_Start(0, 10, Job0), SUCCESS);
+  start = HostTick;
+  while ((HostTick - start) < 100U)
+  {
+    RtcWake_Run();
+    CHECK_EQ(LastVote, POWER_MGR_STOP_LP);
+  }
+  CHECK_EQ(JobRuns[0], 9);
+  RtcWake_GetStats(&stats);
+  CHECK_EQ(stats.Stops, 0);
+  CHECK_EQ(stats.MaxLateMs, 0);
+  RtcWake_Stop(0);
+
+  /* a long period: alarm one period ahead, rounded up to the tick, over midnight */
+  RtcSet(SIM_DAY_TICKS - 300U);
+  RtcWake_Rebase();
+  memset(JobRuns, 0, sizeof(JobRuns));
+  CHECK_EQ(RtcWake_Start(1, 1000, Job1), SUCCESS);
+  due = HostTick + 1000U;
+  ticks = RtcNow();
+  RtcWake_Run();
+  CHECK_EQ(AlarmSets, 1);
+  CHECK_EQ(AlarmTicks, (ticks + RTC_WAKE_TICK_HZ) % SIM_DAY_TICKS);
+  CHECK(AlarmTicks < 1024U);
+  RtcWake_GetStats(&stats);
+  CHECK_EQ(stats.Stops, 1);
+  CHECK_EQ(stats.AlarmWakes, 1);
+  CHECK(HostTick >= due);
+  CHECK(HostTick <= due + 1U);
+  RtcWake_Run();
+  CHECK_EQ(JobRuns[1], 1);
+  CHECK(JobRunTick[1] >= due);
+
+  /* no drift: the tick follows the RTC through many odd STOPs */
+  RtcWake_Stop(1);
+  CHECK_EQ(RtcWake_Start(0, SIM_ODD_PERIOD_MS, Job0), SUCCESS);
+  JobRuns[0] = 0;
+  start = HostTick;
+  p = RtcMsOfDay();
+  for (i = 0; i < SIM_ODD_STOPS; i++)
+  {
+    RtcWake_Run();
+  }
+  RtcWake_Run();
+  CHECK_EQ(JobRuns[0], SIM_ODD_STOPS);
+  /* tick and RTC agree to the ms after 333s of STOP */
+  i = (RtcMsOfDay() + 86400000U - p) % 86400000U;
+  CHECK((HostTick - start) >= (i - 1U));
+  CHECK((HostTick - start) <= (i + 1U));
+  RtcWake_GetStats(&stats);
+  CHECK(stats.MaxLateMs <= 1U);
+  CHECK_EQ(stats.Stops - stats.AlarmWakes, 0);
+  printf("%u STOPs of %ums: SysTick %ums, RTC %ums\n", SIM_ODD_STOPS, SIM_ODD_PERIOD_MS, HostTick - start, i);
+  RtcWake_Stop(0);
+
+  /* longer than RTC_WAKE_MAX_STOP_MS: two alarms */
+  CHECK_EQ(RtcWake_Start(0, 2U * RTC_WAKE_MAX_STOP_MS, Job0), SUCCESS);
+  JobRuns[0] = 0;
+  i = AlarmSets;
+  start = HostTick;
+  RtcWake_Run();
+  CHECK_EQ(JobRuns[0], 0);
+  CHECK((HostTick - start) >= RTC_WAKE_MAX_STOP_MS);
+  CHECK((HostTick - start) <= RTC_WAKE_MAX_STOP_MS + 1U);
+  RtcWake_Run();
+  RtcWake_Run();
+  CHECK_EQ(JobRuns[0], 1);
+  CHECK(AlarmSets >= i + 2U);
+  RtcWake_Stop(0);
+
+  /* another interrupt ends STOP early: the tick still follows the RTC */
+  CHECK_EQ(RtcWake_Start(0, 1000, Job0), SUCCESS);
+  RtcWake_GetStats(&stats);
+  i = stats.AlarmWakes;
+  IrqAfterMs = 400U;
+  start = HostTick;
+  RtcWake_Run();
+  IrqAfterMs = 0;
+  CHECK((HostTick - start) >= 399U);
+  CHECK((HostTick - start) <= 401U);
+  RtcWake_GetStats(&stats);
+  CHECK_EQ(stats.AlarmWakes, i);
+  /* the alarm is armed again for the rest of the period */
+  RtcWake_Run();
+  RtcWake_GetStats(&stats);
+  CHECK(stats.AlarmWakes > i);
+
+  /* more than a period late: one run, the period restarts */
+  RtcWake_Stop(0);
+  CHECK_EQ(RtcWake_Start(0, 30, Job0), SUCCESS);
+  JobRuns[0] = 0;
+  RtcWake_GetStats(&stats);
+  i = stats.Skips;
+  Run(100);
+  due = HostTick + 30U;
+  RtcWake_Run();
+  CHECK_EQ(JobRuns[0], 1);
+  RtcWake_GetStats(&stats);
+  CHECK_EQ(stats.Skips, i + 1U);
+  CHECK_EQ(stats.LastLateMs, 70);
+  CHECK_EQ(JobDue[0], due);
+  RtcWake_Stop(0);
+
+  /* RTC set forward by an hour: Rebase keeps the jump out of the tick */
+  start = HostTick;
+  __disable_irq();
+  RtcWake_Resync();
+  RtcSet((RtcNow() + 3600U * RTC_WAKE_TICK_HZ) % SIM_DAY_TICKS);
+  RtcWake_Rebase();
+  __enable_irq();
+  RtcWake_Resync();
+  CHECK_EQ(HostTick, start);
+
+  /* lateness of the jobs, one period at a time */
+  printf("period    runs  stops  alarm wakes  max late\n");
+  for (p = 0; p < (sizeof(periods) / sizeof(periods[0])); p++)
+  {
+    memset(&WakeStats, 0, sizeof(WakeStats));
+    JobRuns[0] = 0;
+    CHECK_EQ(RtcWake_Start(0, periods[p], Job0), SUCCESS);
+    while (JobRuns[0] < 20U)
+    {
+      RtcWake_Run();
+    }
+    RtcWake_Stop(0);
+    RtcWake_GetStats(&stats);
+    CHECK(stats.MaxLateMs <= 1U);
+    CHECK_EQ(stats.Skips, 0);
+    /* every Run() sleeps once more after the job */
+    CHECK_EQ(stats.AlarmWakes, (periods[p] >= RTC_WAKE_THRESHOLD_MS) ? (stats.Runs + 1U) : 0U);
+    printf("%6ums  %4u  %5u  %11u  %6ums\n", periods[p], stats.Runs, stats.Stops, stats.AlarmWakes,
+           stats.MaxLateMs);
+  }
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
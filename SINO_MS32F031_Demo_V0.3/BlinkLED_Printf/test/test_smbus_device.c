@@ -0,0 +1,460 @@
+/**
+  ******************************************************************************
+  * @file 		test_smbus_device.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the SMBus / PMBus device: PEC framing and dispatch
+  *
+  *          SMBus_Device_IRQHandler() runs on a RAM copy of the I2C1
+  *          registers; the test plays the host. The PEC unit is modelled as
+  *          the hardware runs it: CRC-8 over every byte on the bus from
+  *          START to STOP, repeated start address included; a received PEC
+  *          byte is compared when PECBYTE is set and NBYTES runs out without
+  *          RELOAD, a transmitted one replaces the last byte of NBYTES.
+  *          Checked: the reference CRC-8 against the catalogue check value
+  *          and PMBus frames worked out by hand; the device takes a write
+  *          only with a good PEC and puts the right PEC after every reply;
+  *          unknown commands, wrong access and block counts are NACKed.
+  *          The command dispatch (table lookup to SCL release) is timed on
+  *          the host for the first and the last entry of a 64 entry table.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <time.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DISPATCH_LOOPS              200000U
+
+static I2C_TypeDef HostI2c1;
+static uint32_t HostLeft;
+static uint8_t HostPec;
+static uint32_t HostUs;
+
+/**
+  * @brief RXDR read, clears RXNE as the hardware does
+  */
+static uint8_t HostReceiveData8(I2C_TypeDef *I2Cx)
+{
+  I2Cx->ISR &= ~I2C_ISR_RXNE;
+  return (uint8_t)I2Cx->RXDR;
+}
+
+/**
+  * @brief NBYTES write, reloads the byte counter and releases TCR
+  */
+static void HostSetTransferSize(I2C_TypeDef *I2Cx, uint32_t TransferSize)
+{
+  MODIFY_REG(I2Cx->CR2, I2C_CR2_NBYTES, TransferSize << I2C_CR2_NBYTES_Pos);
+  I2Cx->ISR &= ~I2C_ISR_TCR;
+  HostLeft = TransferSize;
+}
+
+#undef I2C1
+#define I2C1                        (&HostI2c1)
+#define MS32_I2C_ReceiveData8       HostReceiveData8
+#define MS32_I2C_SetTransferSize    HostSetTransferSize
+/* writing ISR only sets TXE, the other bits are read only */
+#define MS32_I2C_ClearFlag_TXE(I2Cx)                        ((I2Cx)->ISR |= I2C_ISR_TXE)
+
+#include "../USER/SMBUS_DEVICE.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t Operation[1] = {0x80};
+static uint8_t VoutCommand[2];
+static uint8_t ReadVin[2] = {0x2C, 0x1A};
+static uint8_t MfrId[1 + 7] = {5, 'S', 'I', 'N', 'O', '3'};
+static uint8_t UserData[1 + 8];
+static uint32_t Cleared;
+
+static void ClearFaults(const SMBus_CmdTypeDef *Cmd, uint8_t Len)
+{
+  Cleared++;
+}
+
+static const SMBus_CmdTypeDef Cmds[] =
+{
+  {0x01, SMBUS_BYTE,  SMBUS_RD | SMBUS_WR, 0, Operation, 0},
+  {0x03, SMBUS_SEND,  SMBUS_WR, 0, 0, ClearFaults},
+  {0x21, SMBUS_WORD,  SMBUS_RD | SMBUS_WR, 0, VoutCommand, 0},
+  {0x88, SMBUS_WORD,  SMBUS_RD, 0, ReadVin, 0},
+  {0x99, SMBUS_BLOCK, SMBUS_RD, 7, MfrId, 0},
+  {0xB0, SMBUS_BLOCK, SMBUS_RD | SMBUS_WR, 8, UserData, 0},
+};
+
+static SMBus_CmdTypeDef BigTable[64];
+static uint8_t BigData[64][2];
+
+/* Stubs of the modules SMBUS_DEVICE calls ---------------------------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return HostUs++;
+}
+
+/**
+  * @brief Reference PEC, CRC-8 x^8+x^2+x+1, bitwise, MSB first
+  * @param Crc running value, 0 at START
+  * @param Data bytes
+  * @param Len bytes
+  * @retval CRC-8
+  */
+static uint8_t RefPec(uint8_t Crc, const uint8_t *Data, uint32_t Len)
+{
+  uint32_t i;
+  uint8_t bit;
+
+  for (i = 0; i < Len; i++)
+  {
+    Crc ^= Data[i];
+    for (bit = 0; bit < 8U; bit++)
+    {
+      Crc = (Crc & 0x80U) ? (uint8_t)((Crc << 1) ^ 0x07U) : (uint8_t)(Crc << 1);
+    }
+  }
+  return Crc;
+}
+
+/**
+  * @brief One interrupt with Flags, ICR clears as the hardware does
+  */
+static void Irq(uint32_t Flags)
+{
+  HostI2c1.ISR |= Flags;
+  HostI2c1.ICR = 0;
+  SMBus_Device_IRQHandler();
+  HostI2c1.ISR &= ~(HostI2c1.ICR | I2C_ISR_TXIS);
+}
+
+/**
+  * @brief START or repeated start and the address byte; the device always
+  *        ACKs its addresses
+  * @param Addr 7 bit address
+  * @param Read 1 read
+  * @retval None
+  */
+static void Start(uint8_t Addr, uint8_t Read)
+{
+  uint8_t byte = (uint8_t)((Addr << 1) | Read);
+
+  HostPec = RefPec(HostPec, &byte, 1);
+  /* address match clears PECBYTE */
+  HostI2c1.CR2 &= ~I2C_CR2_PECBYTE;
+  HostI2c1.ISR &= ~(I2C_ISR_ADDCODE | I2C_ISR_DIR);
+  HostI2c1.ISR |= ((uint32_t)Addr << I2C_ISR_ADDCODE_Pos) | (Read ? I2C_ISR_DIR : 0U);
+  Irq(I2C_ISR_ADDR);
+}
+
+/**
+  * @brief Host write of Len bytes after the address
+  * @retval bytes ACKed, the host stops at the first NACK
+  */
+static uint8_t Write(const uint8_t *Data, uint8_t Len)
+{
+  uint32_t flags;
+  uint8_t i;
+  uint8_t nack;
+
+  for (i = 0; i < Len; i++)
+  {
+    HostPec = RefPec(HostPec, &Data[i], 1);
+    HostI2c1.RXDR = Data[i];
+    flags = I2C_ISR_RXNE;
+    nack = 0;
+    if (HostLeft != 0U)
+    {
+      HostLeft--;
+    }
+    if (HostLeft == 0U)
+    {
+      if (HostI2c1.CR2 & I2C_CR2_RELOAD)
+      {
+        /* SCL stretched before the ACK bit until NBYTES is written */
+        flags |= I2C_ISR_TCR;
+      }
+      else if (HostI2c1.CR2 & I2C_CR2_PECBYTE)
+      {
+        /* the PEC byte: CRC over the frame and the PEC itself is 0 */
+        HostI2c1.CR2 &= ~I2C_CR2_PECBYTE;
+        if (HostPec != 0U)
+        {
+          flags |= I2C_ISR_PECERR;
+          nack = 1;
+        }
+      }
+    }
+    Irq(flags);
+    if (HostI2c1.CR2 & I2C_CR2_NACK)
+    {
+      HostI2c1.CR2 &= ~I2C_CR2_NACK;
+      nack = 1;
+    }
+    if (nack != 0U)
+    {
+      return i;
+    }
+  }
+  return Len;
+}
+
+/**
+  * @brief Host read of Len bytes, PEC included; the PEC unit sends the
+  *        last byte of NBYTES when PECBYTE is set
+  */
+static void Read(uint8_t *Data, uint8_t Len)
+{
+  uint8_t i;
+
+  for (i = 0; i < Len; i++)
+  {
+    if ((HostLeft == 1U) && (HostI2c1.CR2 & I2C_CR2_PECBYTE))
+    {
+      HostI2c1.CR2 &= ~I2C_CR2_PECBYTE;
+      Data[i] = HostPec;
+    }
+    else
+    {
+      if (HostI2c1.CR1 & I2C_CR1_TXIE)
+      {
+        Irq(I2C_ISR_TXIS);
+      }
+      Data[i] = (uint8_t)HostI2c1.TXDR;
+    }
+    HostPec = RefPec(HostPec, &Data[i], 1);
+    if (HostLeft != 0U)
+    {
+      HostLeft--;
+    }
+  }
+}
+
+/**
+  * @brief STOP, the host NACKed the last byte of a read
+  */
+static void Stop(uint32_t Flags)
+{
+  Irq(I2C_ISR_STOPF | Flags);
+  HostI2c1.CR2 &= ~I2C_CR2_PECBYTE;
+  HostPec = 0;
+}
+
+/**
+  * @brief Whole write transaction: command and data, PEC appended plus Bad
+  * @retval bytes ACKed
+  */
+static uint8_t WriteFrame(uint8_t Cmd, const uint8_t *Data, uint8_t Len, uint8_t Bad)
+{
+  uint8_t frame[SMBUS_BLOCK_MAX + 4];
+  uint8_t acked;
+  uint8_t i;
+
+  frame[0] = (uint8_t)(SMBUS_DEVICE_ADDR << 1);
+  frame[1] = Cmd;
+  for (i = 0; i < Len; i++)
+  {
+    frame[2 + i] = Data[i];
+  }
+  frame[2 + Len] = (uint8_t)(RefPec(0, frame, Len + 2U) + Bad);
+
+  Start(SMBUS_DEVICE_ADDR, 0);
+  acked = Write(&frame[1], Len + 2U);
+  Stop(0);
+  return acked;
+}
+
+/**
+  * @brief Whole read transaction: command, repeated start, Len bytes + PEC
+  * @retval 1 the PEC received matches the reference over the frame
+  */
+static uint8_t ReadFrame(uint8_t Cmd, uint8_t *Data, uint8_t Len)
+{
+  uint8_t frame[SMBUS_BLOCK_MAX + 5];
+
+  frame[0] = (uint8_t)(SMBUS_DEVICE_ADDR << 1);
+  frame[1] = Cmd;
+  frame[2] = (uint8_t)((SMBUS_DEVICE_ADDR << 1) | 1U);
+  Start(SMBUS_DEVICE_ADDR, 0);
+  Write(&Cmd, 1);
+  Start(SMBUS_DEVICE_ADDR, 1);
+  Read(Data, Len + 1U);
+  Stop(I2C_ISR_NACKF);
+
+  memcpy(&frame[3], Data, Len);
+  return (RefPec(0, frame, Len + 3U) == Data[Len]) ? 1U : 0U;
+}
+
+/**
+  * @brief Host time of one command byte dispatch
+  * @param Code command code
+  * @retval ns
+  */
+static double DispatchNs(uint8_t Code)
+{
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t i;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < DISPATCH_LOOPS; i++)
+  {
+    Phase = PH_CMD;
+    CmdCode = Code;
+    SMBus_Device_Dispatch();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / DISPATCH_LOOPS;
+}
+
+int main(void)
+{
+  static const uint8_t check[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  /* PMBus frames, address 0x40 (0x80 / 0x81), PEC worked out by hand */
+  static const uint8_t operation[4] = {0x80, 0x01, 0x80, 0x97};
+  static const uint8_t vout[5] = {0x80, 0x21, 0x34, 0x12, 0xCA};
+  static const uint8_t clear[3] = {0x80, 0x03, 0xBF};
+  static const uint8_t vin[6] = {0x80, 0x88, 0x81, 0x2C, 0x1A, 0x62};
+  uint8_t buf[SMBUS_BLOCK_MAX + 2];
+  double first;
+  double last;
+  double unknown;
+  uint32_t i;
+
+  /* CRC-8 catalogue check value, and 0 over a frame with its PEC */
+  CHECK_EQ(RefPec(0, check, 9), 0xF4);
+  CHECK_EQ(RefPec(0, operation, 3), operation[3]);
+  CHECK_EQ(RefPec(0, operation, 4), 0);
+  CHECK_EQ(RefPec(0, vout, 4), vout[4]);
+  CHECK_EQ(RefPec(0, clear, 2), clear[2]);
+  CHECK_EQ(RefPec(0, vin, 5), vin[5]);
+
+  CmdTable = Cmds;
+  CmdCount = sizeof(Cmds) / sizeof(Cmds[0]);
+  Enabled = 1;
+  HostI2c1.ISR = I2C_ISR_TXE;
+
+  /* write byte OPERATION 0x00 with a good PEC, then a bad one */
+  buf[0] = 0x00;
+  CHECK_EQ(WriteFrame(0x01, buf, 1, 0), 3);
+  CHECK_EQ(Operation[0], 0x00);
+  CHECK_EQ(DevStats.Writes, 1);
+  buf[0] = 0x80;
+  CHECK_EQ(WriteFrame(0x01, buf, 1, 1), 2);
+  CHECK_EQ(Operation[0], 0x00);
+  CHECK_EQ(DevStats.PecErrors, 1);
+  CHECK_EQ(DevStats.Writes, 1);
+  /* the hand worked frame */
+  Start(SMBUS_DEVICE_ADDR, 0);
+  CHECK_EQ(Write(&operation[1], 3), 3);
+  Stop(0);
+  CHECK_EQ(Operation[0], 0x80);
+
+  /* write word VOUT_COMMAND, send byte CLEAR_FAULTS */
+  Start(SMBUS_DEVICE_ADDR, 0);
+  CHECK_EQ(Write(&vout[1], 4), 4);
+  Stop(0);
+  CHECK_EQ(VoutCommand[0], 0x34);
+  CHECK_EQ(VoutCommand[1], 0x12);
+  Start(SMBUS_DEVICE_ADDR, 0);
+  CHECK_EQ(Write(&clear[1], 2), 2);
+  Stop(0);
+  CHECK_EQ(Cleared, 1);
+  CHECK_EQ(WriteFrame(0x03, buf, 0, 0x55), 1);
+  CHECK_EQ(Cleared, 1);
+  CHECK_EQ(DevStats.PecErrors, 2);
+
+  /* read word READ_VIN: data and the PEC over both address bytes */
+  CHECK(ReadFrame(0x88, buf, 2));
+  CHECK_EQ(buf[0], vin[3]);
+  CHECK_EQ(buf[1], vin[4]);
+  CHECK_EQ(buf[2], vin[5]);
+  CHECK(ReadFrame(0x21, buf, 2));
+  CHECK_EQ(buf[1], 0x12);
+
+  /* block read MFR_ID, block write and read back of a user block */
+  CHECK(ReadFrame(0x99, buf, 6));
+  CHECK_EQ(buf[0], 5);
+  CHECK(memcmp(&buf[1], "SINO3", 5) == 0);
+  buf[0] = 8;
+  for (i = 0; i < 8U; i++)
+  {
+    buf[1 + i] = (uint8_t)(0xA0U + i);
+  }
+  CHECK_EQ(WriteFrame(0xB0, buf, 9, 0), 11);
+  CHECK_EQ(UserData[8], 0xA7);
+  memset(buf, 0, sizeof(buf));
+  CHECK(ReadFrame(0xB0, buf, 9));
+  CHECK_EQ(buf[0], 8);
+  CHECK_EQ(buf[8], 0xA7);
+  buf[0] = 3;
+  CHECK_EQ(WriteFrame(0xB0, buf, 4, 2), 5);
+  CHECK_EQ(UserData[0], 8);
+  CHECK_EQ(DevStats.PecErrors, 3);
+  CHECK_EQ(DevStats.Writes, 5);
+
+  /* NACKed: unknown code at once, data to the read only READ_VIN, block
+     count 0 and above the buffer */
+  CHECK_EQ(WriteFrame(0x7E, buf, 1, 0), 0);
+  CHECK_EQ(WriteFrame(0x88, buf, 2, 0), 1);
+  buf[0] = 0;
+  CHECK_EQ(WriteFrame(0xB0, buf, 1, 0), 1);
+  buf[0] = 9;
+  CHECK_EQ(WriteFrame(0xB0, buf, 10, 0), 1);
+  CHECK_EQ(DevStats.BadCommands, 4);
+  CHECK_EQ(DevStats.Writes, 5);
+  CHECK_EQ(UserData[0], 8);
+
+  /* SMBALERT#: the ARA read returns the address, PEC over 0x19 + reply */
+  SMBus_Device_RaiseAlert();
+  CHECK(HostI2c1.CR1 & I2C_CR1_ALERTEN);
+  Start(SMBUS_ARA, 1);
+  Read(buf, 2);
+  Stop(I2C_ISR_NACKF);
+  CHECK_EQ(buf[0], SMBUS_DEVICE_ADDR << 1);
+  CHECK_EQ(buf[1], 0x63);
+  CHECK_EQ(SMBus_Device_IsAlertPending(), 0);
+  CHECK((HostI2c1.CR1 & I2C_CR1_ALERTEN) == 0);
+  CHECK_EQ(DevStats.AlertResponses, 1);
+  CHECK_EQ(DevStats.Errors, 0);
+
+  /* dispatch cost: the stub clock moves 1us per read */
+  CHECK_EQ(DevStats.MaxDispatchUs, 1);
+  for (i = 0; i < 64U; i++)
+  {
+    BigTable[i].Code = (uint8_t)(i * 4U);
+    BigTable[i].Type = SMBUS_WORD;
+    BigTable[i].Access = SMBUS_RD | SMBUS_WR;
+    BigTable[i].Data = BigData[i];
+  }
+  CmdTable = BigTable;
+  CmdCount = 64;
+  first = DispatchNs(0x00);
+  last = DispatchNs(0xFC);
+  unknown = DispatchNs(0xFD);
+  Phase = PH_IDLE;
+  printf("dispatch, 64 entries: first %.0f ns, last %.0f ns, unknown %.0f ns\n", first, last, unknown);
+  CmdTable = Cmds;
+  CmdCount = sizeof(Cmds) / sizeof(Cmds[0]);
+  first = DispatchNs(0x01);
+  last = DispatchNs(0xB0);
+  Phase = PH_IDLE;
+  printf("dispatch, %u entries: first %.0f ns, last %.0f ns\n", CmdCount, first, last);
+  /* the table still works after the timing runs */
+  CHECK(ReadFrame(0x88, buf, 2));
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,321 @@
+/**
+  ******************************************************************************
+  * @file 		test_smbus_host.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the SMBus host: PEC framing of every transfer type
+  *
+  *          SMBus_Host_IRQHandler() runs on a RAM copy of the I2C1 registers
+  *          against a bus model with a device at 0x40 that also answers the
+  *          Alert Response Address. Every HandleTransfer() request runs as
+  *          the hardware does: START + address when asked, NBYTES bytes with
+  *          TXIS / RXNE, then TCR, TC or STOP. The PEC unit is modelled as
+  *          in test_smbus_device.c: CRC-8 over every byte from START to STOP;
+  *          with PECBYTE and no RELOAD it sends the last byte of a write and
+  *          compares the last byte of a read.
+  *          Checked: the bytes on the bus of each write, PEC included, are
+  *          the PMBus frames worked out by hand; a read with a good PEC is
+  *          taken, a corrupted PEC ends with SMBUS_XFER_PEC_ERROR.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_DEVICE_ADDR             0x40U
+
+static I2C_TypeDef HostI2c1;
+static uint32_t HostRequest;
+static uint8_t HostRequested;
+static uint8_t HostRead;
+static uint8_t HostPec;
+
+static void HostHandleTransfer(I2C_TypeDef *I2Cx, uint32_t SlaveAddr, uint32_t SlaveAddrSize,
+                               uint32_t TransferSize, uint32_t EndMode, uint32_t Request);
+
+/**
+  * @brief RXDR read, clears RXNE as the hardware does
+  */
+static uint8_t HostReceiveData8(I2C_TypeDef *I2Cx)
+{
+  I2Cx->ISR &= ~I2C_ISR_RXNE;
+  return (uint8_t)I2Cx->RXDR;
+}
+
+#undef I2C1
+#define I2C1                        (&HostI2c1)
+#define MS32_I2C_HandleTransfer     HostHandleTransfer
+#define MS32_I2C_ReceiveData8       HostReceiveData8
+/* writing ISR only sets TXE, the other bits are read only */
+#define MS32_I2C_ClearFlag_TXE(I2Cx)                        ((I2Cx)->ISR |= I2C_ISR_TXE)
+
+#include "../USER/SMBUS_HOST.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t Bus[SMBUS_BLOCK_MAX + 4];  /* bytes the device received */
+static uint8_t BusLen;
+static uint8_t Reply[SMBUS_BLOCK_MAX + 2];
+static uint8_t ReplyPos;
+static uint8_t Corrupt;                   /* XORed into the PEC the device sends */
+
+/**
+  * @brief Reference PEC, CRC-8 x^8+x^2+x+1, bitwise, MSB first
+  * @param Crc running value, 0 at START
+  * @param Data bytes
+  * @param Len bytes
+  * @retval CRC-8
+  */
+static uint8_t RefPec(uint8_t Crc, const uint8_t *Data, uint32_t Len)
+{
+  uint32_t i;
+  uint8_t bit;
+
+  for (i = 0; i < Len; i++)
+  {
+    Crc ^= Data[i];
+    for (bit = 0; bit < 8U; bit++)
+    {
+      Crc = (Crc & 0x80U) ? (uint8_t)((Crc << 1) ^ 0x07U) : (uint8_t)(Crc << 1);
+    }
+  }
+  return Crc;
+}
+
+/**
+  * @brief CR2 write of the driver, run by Run()
+  */
+static void HostHandleTransfer(I2C_TypeDef *I2Cx, uint32_t SlaveAddr, uint32_t SlaveAddrSize,
+                               uint32_t TransferSize, uint32_t EndMode, uint32_t Request)
+{
+  I2Cx->CR2 = SlaveAddr | SlaveAddrSize | (TransferSize << I2C_CR2_NBYTES_Pos) | EndMode | (Request & ~0x80000000U);
+  HostRequest = Request;
+  HostRequested = 1;
+}
+
+/**
+  * @brief One interrupt with Flags, ICR clears as the hardware does
+  */
+static void Irq(uint32_t Flags)
+{
+  HostI2c1.ISR |= Flags;
+  HostI2c1.ICR = 0;
+  SMBus_Host_IRQHandler();
+  HostI2c1.ISR &= ~(HostI2c1.ICR | I2C_ISR_TXIS | I2C_ISR_TC | I2C_ISR_TCR);
+}
+
+static void Stop(void)
+{
+  HostPec = 0;
+  Irq(I2C_ISR_STOPF);
+}
+
+/**
+  * @brief Bus model of one CR2 request: START + address, NBYTES bytes, end
+  * @param None
+  * @retval None
+  */
+static void Transfer(void)
+{
+  uint32_t cr2 = HostI2c1.CR2;
+  uint32_t n = (cr2 & I2C_CR2_NBYTES) >> I2C_CR2_NBYTES_Pos;
+  uint8_t pec = ((cr2 & I2C_CR2_PECBYTE) && !(cr2 & I2C_CR2_RELOAD)) ? 1U : 0U;
+  uint32_t flags;
+  uint8_t byte;
+  uint32_t i;
+
+  /* the direction is taken at START only */
+  if (HostRequest != MS32_I2C_GENERATE_NOSTARTSTOP)
+  {
+    HostRead = (cr2 & I2C_CR2_RD_WRN) ? 1U : 0U;
+    byte = (uint8_t)((cr2 & I2C_CR2_SADD) | HostRead);
+    HostPec = RefPec(HostPec, &byte, 1);
+    if (((byte >> 1) != SIM_DEVICE_ADDR) && ((byte >> 1) != SMBUS_ARA))
+    {
+      Irq(I2C_ISR_NACKF);
+      if ((cr2 & I2C_CR2_AUTOEND) || (HostI2c1.CR2 & I2C_CR2_STOP))
+      {
+        Stop();
+      }
+      return;
+    }
+    if (HostRead)
+    {
+      ReplyPos = 0;
+    }
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    flags = 0;
+    if (HostRead)
+    {
+      byte = ((i + 1U == n) && pec) ? (uint8_t)(HostPec ^ Corrupt) : Reply[ReplyPos++];
+      HostPec = RefPec(HostPec, &byte, 1);
+      if ((i + 1U == n) && pec && (HostPec != 0U))
+      {
+        flags = I2C_ISR_PECERR;
+      }
+      HostI2c1.RXDR = byte;
+      Irq(I2C_ISR_RXNE | flags);
+    }
+    else
+    {
+      if ((i + 1U == n) && pec)
+      {
+        byte = HostPec;
+      }
+      else
+      {
+        Irq(I2C_ISR_TXIS);
+        byte = (uint8_t)HostI2c1.TXDR;
+      }
+      HostPec = RefPec(HostPec, &byte, 1);
+      Bus[BusLen++] = byte;
+    }
+  }
+
+  if (cr2 & I2C_CR2_RELOAD)
+  {
+    Irq(I2C_ISR_TCR);
+  }
+  else if (cr2 & I2C_CR2_AUTOEND)
+  {
+    Stop();
+  }
+  else
+  {
+    Irq(I2C_ISR_TC);
+  }
+}
+
+/**
+  * @brief Submit and run the bus until the driver stops asking
+  * @retval final status
+  */
+static uint8_t Run(SMBus_HostXferTypeDef *Xfer)
+{
+  BusLen = 0;
+  CHECK_EQ(SMBus_Host_Submit(Xfer), SUCCESS);
+  while (HostRequested != 0U)
+  {
+    HostRequested = 0;
+    Transfer();
+  }
+  CHECK(SMBus_Host_IsIdle());
+  return Xfer->Status;
+}
+
+int main(void)
+{
+  static const uint8_t check[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  /* PMBus frames, address 0x40 (0x80 / 0x81), PEC worked out by hand */
+  static const uint8_t operation[4] = {0x80, 0x01, 0x80, 0x97};
+  static const uint8_t vout[5] = {0x80, 0x21, 0x34, 0x12, 0xCA};
+  static const uint8_t clear[3] = {0x80, 0x03, 0xBF};
+  uint8_t data[SMBUS_BLOCK_MAX + 1];
+  SMBus_HostXferTypeDef xfer = {SIM_DEVICE_ADDR, 0x01, SMBUS_BYTE, 0, data, 0, SMBUS_XFER_IDLE};
+  SMBus_HostStatsTypeDef stats;
+
+  CHECK_EQ(RefPec(0, check, 9), 0xF4);
+
+  Enabled = 1;
+  HostI2c1.ISR = I2C_ISR_TXE;
+
+  /* writes: command, data and the PEC the PEC unit appends */
+  data[0] = 0x80;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(BusLen, 3);
+  CHECK(memcmp(Bus, &operation[1], 3) == 0);
+  xfer.Cmd = 0x21;
+  xfer.Type = SMBUS_WORD;
+  data[0] = 0x34;
+  data[1] = 0x12;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(BusLen, 4);
+  CHECK(memcmp(Bus, &vout[1], 4) == 0);
+  xfer.Cmd = 0x03;
+  xfer.Type = SMBUS_SEND;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(BusLen, 2);
+  CHECK(memcmp(Bus, &clear[1], 2) == 0);
+  /* block write: count, data, PEC over the whole frame */
+  xfer.Cmd = 0xB0;
+  xfer.Type = SMBUS_BLOCK;
+  data[0] = 3;
+  data[1] = 0xA0;
+  data[2] = 0xA1;
+  data[3] = 0xA2;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(BusLen, 6);
+  CHECK_EQ(Bus[1], 3);
+  CHECK_EQ(RefPec(RefPec(0, operation, 1), Bus, 6), 0);
+
+  /* read word READ_VIN: good PEC, then corrupted */
+  xfer.Cmd = 0x88;
+  xfer.Type = SMBUS_WORD;
+  xfer.Read = 1;
+  Reply[0] = 0x2C;
+  Reply[1] = 0x1A;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(BusLen, 1);
+  CHECK_EQ(data[0], 0x2C);
+  CHECK_EQ(data[1], 0x1A);
+  Corrupt = 0x01;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_PEC_ERROR);
+  Corrupt = 0;
+
+  /* block read MFR_ID: count through RELOAD, then data and PEC */
+  xfer.Cmd = 0x99;
+  xfer.Type = SMBUS_BLOCK;
+  xfer.Size = 7;
+  memcpy(Reply, "\x05SINO3", 6);
+  memset(data, 0, sizeof(data));
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(data[0], 5);
+  CHECK(memcmp(&data[1], "SINO3", 5) == 0);
+  Corrupt = 0x80;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_PEC_ERROR);
+  Corrupt = 0;
+  /* count above Size */
+  Reply[0] = 8;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_ERROR);
+
+  /* ARA: receive byte, PEC over 0x19 and the address */
+  xfer.Addr = SMBUS_ARA;
+  xfer.Type = SMBUS_RECEIVE;
+  Reply[0] = SIM_DEVICE_ADDR << 1;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_DONE);
+  CHECK_EQ(data[0], SIM_DEVICE_ADDR << 1);
+  CHECK_EQ(RefPec(0, (const uint8_t *)"\x19\x80", 2), 0x63);
+
+  /* no device at 0x41 */
+  xfer.Addr = SIM_DEVICE_ADDR + 1U;
+  xfer.Type = SMBUS_WORD;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_NACK);
+  xfer.Read = 0;
+  CHECK_EQ(Run(&xfer), SMBUS_XFER_NACK);
+
+  SMBus_Host_GetStats(&stats);
+  CHECK_EQ(stats.Transfers, 12);
+  CHECK_EQ(stats.PecErrors, 2);
+  CHECK_EQ(stats.Nacks, 2);
+  CHECK_EQ(stats.Errors, 1);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
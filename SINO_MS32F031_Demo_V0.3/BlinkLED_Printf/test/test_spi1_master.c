@@ -0,0 +1,485 @@
+/**
+  ******************************************************************************
+  * @file 		test_spi1_master.c
+	* @author		SINOMCU-AE
+  * @brief 		Host simulation of the SPI1 master DMA transaction queue
+  *
+  *          SPI1_Master_DMA_IRQHandler() runs on RAM copies of the DMA1,
+  *          SPI1 and GPIO registers. The DMA model keeps the memory address,
+  *          increment mode, count and enable of channel 2 (RX) / 3 (TX) as
+  *          the driver sets them; the bus model clocks the active
+  *          transaction through them against one slave per chip select
+  *          (each answers the byte it gets XOR its key), advances time by
+  *          the SCK time of PCLK / SPI1_MASTER_PRESCALER_DIV and raises TC2
+  *          (or TE3) for the interrupt, which costs SIM_IRQ_NS.
+  *          Checked: transactions start and complete in submit order across
+  *          devices, each starts with only its own chip select low and ends
+  *          with it high, dummy TX / dropped RX switch the memory address
+  *          and increment mode, Len 0 and a full queue are refused, a
+  *          callback submits behind the queued transactions, a transfer
+  *          error ends only its own transaction, and the statistics.
+  *          Bus utilisation and overhead per transaction are printed for
+  *          back to back 4 byte and 64 byte transactions (WireUs is
+  *          truncated to whole us per transaction, the overhead absorbs it).
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+/* interrupt entry + handler + next start at 48MHz, about 100 cycles */
+#define SIM_IRQ_NS                  2000U
+#define SIM_XFERS                   200U
+
+typedef struct
+{
+  uint32_t Address;         /* low 32 bits, compared only */
+  uint32_t Inc;
+  uint32_t Ndt;
+  uint8_t Enabled;
+} HostChannelTypeDef;
+
+static DMA_TypeDef HostDma1;
+static SPI_TypeDef HostSpi1;
+static RCC_TypeDef HostRcc;
+static GPIO_TypeDef HostGpioA;
+static GPIO_TypeDef HostGpioB;
+static HostChannelTypeDef HostCh[4];
+
+#undef DMA1
+#define DMA1                        (&HostDma1)
+#undef SPI1
+#define SPI1                        (&HostSpi1)
+#undef RCC
+#define RCC                         (&HostRcc)
+/* DMA channel registers are reached through 32 bit address math */
+#define MS32_DMA_DisableChannel(DMAx, Channel)              (HostCh[Channel].Enabled = 0U)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               (HostCh[Channel].Enabled = 1U)
+#define MS32_DMA_SetMemoryAddress(DMAx, Channel, Addr)      (HostCh[Channel].Address = (Addr))
+#define MS32_DMA_SetMemoryIncMode(DMAx, Channel, IncMode)   (HostCh[Channel].Inc = (IncMode))
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostCh[Channel].Ndt = (NbData))
+/* IFCR writes clear the ISR bits at once */
+#define MS32_DMA_ClearFlag_GI2(DMAx)                        \
+  ((DMAx)->ISR &= ~(DMA_ISR_GIF2 | DMA_ISR_TCIF2 | DMA_ISR_HTIF2 | DMA_ISR_TEIF2))
+#define MS32_DMA_ClearFlag_TE3(DMAx)                        ((DMAx)->ISR &= ~DMA_ISR_TEIF3)
+
+#include "../USER/SPI1_MASTER.c"
+
+/* Private define ------------------------------------------------------------*/
+#define RX                          SPI1_MASTER_RX_DMA_CHANNEL
+#define TX                          SPI1_MASTER_TX_DMA_CHANNEL
+#define CS_A                        MS32_GPIO_PIN_4
+#define CS_B                        MS32_GPIO_PIN_1
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000;
+const uint8_t APBPrescTable[8] = {0, 0, 0, 0, 1, 2, 3, 4};
+
+static uint64_t SimNs;
+static uint32_t CsLevel[2];         /* GPIOA, GPIOB output levels */
+static uint8_t DevLog[3][1200];     /* bytes each slave received, 2: no CS */
+static uint32_t DevLen[3];
+static uint32_t ErrorAt;            /* transaction number ending with TE3, 0: none */
+static uint32_t Clocked;
+static uint32_t BadCs;
+static uint32_t BadDma;
+static uint8_t Done[32];
+static uint32_t DoneCount;
+static SPI1_XferTypeDef *FollowUp;
+
+/* Stubs of the modules SPI1_MASTER calls ----------------------------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return (uint32_t)(SimNs / 1000U);
+}
+
+ErrorStatus MS32_GPIO_Init(GPIO_TypeDef *GPIOx, MS32_GPIO_InitTypeDef *GpioInitStr)
+{
+  return SUCCESS;
+}
+
+/**
+  * @brief Apply the BSRR writes since the last call to the pin levels
+  */
+static void HostGpio(void)
+{
+  GPIO_TypeDef *port[2] = {&HostGpioA, &HostGpioB};
+  uint32_t i;
+
+  for (i = 0; i < 2U; i++)
+  {
+    CsLevel[i] |= port[i]->BSRR & 0xFFFFU;
+    CsLevel[i] &= ~(port[i]->BSRR >> 16);
+    port[i]->BSRR = 0;
+  }
+}
+
+/**
+  * @brief Slave selected by a transaction: 0 GPIOA CS_A, 1 GPIOB CS_B, 2 none
+  */
+static uint32_t Device(const SPI1_XferTypeDef *Xfer)
+{
+  if (Xfer->CsPort == 0)
+  {
+    return 2U;
+  }
+  return (Xfer->CsPort == &HostGpioA) ? 0U : 1U;
+}
+
+/**
+  * @brief Chip select of Dev low, every other one high
+  */
+static uint8_t OnlySelected(uint32_t Dev)
+{
+  uint8_t a = ((CsLevel[0] & CS_A) == 0U) ? 1U : 0U;
+  uint8_t b = ((CsLevel[1] & CS_B) == 0U) ? 1U : 0U;
+
+  return (a == (Dev == 0U)) && (b == (Dev == 1U));
+}
+
+/**
+  * @brief Bus model: clock the active transaction through the two DMA
+  *        channels, then the RX complete (or transfer error) interrupt
+  * @retval 0 bus idle
+  */
+static uint8_t Clock(void)
+{
+  static const uint8_t key[3] = {0x5AU, 0xA5U, 0x00U};
+  SPI1_XferTypeDef *xfer = Active;
+  uint32_t dev;
+  uint32_t len;
+  uint32_t i;
+  uint8_t txb;
+  uint8_t rxb;
+
+  if (xfer == 0)
+  {
+    return 0;
+  }
+  dev = Device(xfer);
+  HostGpio();
+  BadCs += OnlySelected(dev) ? 0U : 1U;
+  /* both channels armed for this descriptor, or the dummy byte */
+  BadDma += (HostCh[RX].Enabled && HostCh[TX].Enabled) ? 0U : 1U;
+  BadDma += ((HostCh[RX].Ndt == xfer->Len) && (HostCh[TX].Ndt == xfer->Len)) ? 0U : 1U;
+  if (xfer->TxBuf != 0)
+  {
+    BadDma += ((HostCh[TX].Address == (uint32_t)xfer->TxBuf) && (HostCh[TX].Inc == MS32_DMA_MEMORY_INCREMENT)) ? 0U : 1U;
+  }
+  else
+  {
+    BadDma += ((HostCh[TX].Address == (uint32_t)&DummyTx) && (HostCh[TX].Inc == MS32_DMA_MEMORY_NOINCREMENT)) ? 0U : 1U;
+  }
+  if (xfer->RxBuf != 0)
+  {
+    BadDma += ((HostCh[RX].Address == (uint32_t)xfer->RxBuf) && (HostCh[RX].Inc == MS32_DMA_MEMORY_INCREMENT)) ? 0U : 1U;
+  }
+  else
+  {
+    BadDma += ((HostCh[RX].Address == (uint32_t)&DummyRx) && (HostCh[RX].Inc == MS32_DMA_MEMORY_NOINCREMENT)) ? 0U : 1U;
+  }
+
+  Clocked++;
+  len = (Clocked == ErrorAt) ? (xfer->Len / 2U) : xfer->Len;
+  for (i = 0; i < len; i++)
+  {
+    txb = HostCh[TX].Inc ? xfer->TxBuf[i] : DummyTx;
+    if (DevLen[dev] < sizeof(DevLog[0]))
+    {
+      DevLog[dev][DevLen[dev]++] = txb;
+    }
+    rxb = txb ^ key[dev];
+    if (HostCh[RX].Inc)
+    {
+      xfer->RxBuf[i] = rxb;
+    }
+    else
+    {
+      DummyRx = rxb;
+    }
+  }
+  SimNs += ((uint64_t)len * 8U * SPI1_MASTER_PRESCALER_DIV * 1000000000U) / ClockPlan_PclkHz();
+  HostDma1.ISR |= (Clocked == ErrorAt) ? (DMA_ISR_GIF3 | DMA_ISR_TEIF3) : (DMA_ISR_GIF2 | DMA_ISR_TCIF2);
+  SimNs += SIM_IRQ_NS;
+  SPI1_Master_DMA_IRQHandler();
+  CHECK_EQ(HostDma1.ISR & (DMA_ISR_TCIF2 | DMA_ISR_TEIF2 | DMA_ISR_TEIF3), 0);
+  HostGpio();
+  /* released, unless the next transaction selects the same device */
+  if ((Active == 0) || (Device(Active) != dev))
+  {
+    BadCs += ((dev == 2U) || !OnlySelected(dev)) ? 0U : 1U;
+  }
+  return 1;
+}
+
+/**
+  * @brief Completion callback: record the order, submit the follow-up once
+  */
+static void XferDone(SPI1_XferTypeDef *Xfer)
+{
+  if (DoneCount < sizeof(Done))
+  {
+    Done[DoneCount++] = (uint8_t)(uintptr_t)Xfer->Context;
+  }
+  if ((Xfer->Context == (void *)1) && (FollowUp != 0))
+  {
+    CHECK(SPI1_Master_Submit(FollowUp) == SUCCESS);
+    FollowUp = 0;
+  }
+}
+
+/**
+  * @brief Transaction descriptor
+  */
+static void Describe(SPI1_XferTypeDef *Xfer, uint32_t Dev, const uint8_t *Tx, uint8_t *Rx, uint16_t Len, uint32_t Id)
+{
+  Xfer->CsPort = (Dev == 0U) ? &HostGpioA : ((Dev == 1U) ? &HostGpioB : 0);
+  Xfer->CsPin = (Dev == 0U) ? CS_A : CS_B;
+  Xfer->TxBuf = Tx;
+  Xfer->RxBuf = Rx;
+  Xfer->Len = Len;
+  Xfer->Callback = XferDone;
+  Xfer->Context = (void *)(uintptr_t)Id;
+  Xfer->Status = SPI1_XFER_IDLE;
+}
+
+/**
+  * @brief Clock until the queue is empty
+  */
+static void RunAll(void)
+{
+  while (Clock() != 0U)
+  {
+  }
+}
+
+/**
+  * @brief SIM_XFERS back to back transactions of Len bytes on device 0,
+  *        each resubmitted from its callback; print utilisation
+  */
+static void Throughput(uint16_t Len)
+{
+  static uint8_t tx[64];
+  static uint8_t rx[64];
+  SPI1_XferTypeDef xfer[2];
+  SPI1_MasterStatsTypeDef before;
+  SPI1_MasterStatsTypeDef after;
+  uint64_t t0 = SimNs;
+  uint32_t n = 0;
+  uint32_t busy;
+  uint32_t wire;
+  uint32_t elapsed;
+
+  SPI1_Master_GetStats(&before);
+  Describe(&xfer[0], 0, tx, rx, Len, 100);
+  Describe(&xfer[1], 0, tx, rx, Len, 101);
+  xfer[0].Callback = 0;
+  xfer[1].Callback = 0;
+  CHECK(SPI1_Master_Submit(&xfer[0]) == SUCCESS);
+  CHECK(SPI1_Master_Submit(&xfer[1]) == SUCCESS);
+  /* the application keeps one transaction queued behind the active one */
+  while (Clock() != 0U)
+  {
+    if (++n <= (SIM_XFERS - 2U))
+    {
+      CHECK(SPI1_Master_Submit(&xfer[n & 1U]) == SUCCESS);
+    }
+  }
+  SPI1_Master_GetStats(&after);
+  busy = after.BusyUs - before.BusyUs;
+  wire = after.WireUs - before.WireUs;
+  elapsed = (uint32_t)((SimNs - t0) / 1000U);
+  CHECK_EQ(after.Transfers - before.Transfers, SIM_XFERS);
+  CHECK_EQ(after.Bytes - before.Bytes, SIM_XFERS * Len);
+  /* chip select time = SCK time + one interrupt per transaction */
+  CHECK((busy - wire) >= (SIM_XFERS * (SIM_IRQ_NS / 1000U)) - SIM_XFERS);
+  CHECK((busy - wire) <= (SIM_XFERS * (SIM_IRQ_NS / 1000U)) + SIM_XFERS);
+  printf("%3u byte transactions, SCK %lu kHz: %7.0f transactions/s, chip select %5.1f%%, "
+         "SCK %5.1f%% of the time, overhead %.2f us per transaction\n",
+         Len, (unsigned long)(ClockPlan_PclkHz() / SPI1_MASTER_PRESCALER_DIV / 1000U),
+         SIM_XFERS * 1e6 / elapsed, 100.0 * busy / elapsed, 100.0 * wire / elapsed, (double)(busy - wire) / SIM_XFERS);
+}
+
+int main(void)
+{
+  static const uint8_t txa[6] = {0x80, 0x11, 0x22, 0x33, 0x44, 0x55};
+  static const uint8_t txb[3] = {0x03, 0xC0, 0x01};
+  static uint8_t rx[16][8];
+  SPI1_XferTypeDef xfer[16];
+  SPI1_XferTypeDef late;
+  SPI1_MasterStatsTypeDef stats;
+  uint32_t i;
+
+  /* SYSCLK 48MHz, HCLK 48MHz, PCLK 24MHz: SCK 6MHz */
+  HostRcc.CFGR = RCC_CFGR_PPRE_DIV2;
+  SPI1_Master_ConfigCS(&HostGpioA, CS_A);
+  SPI1_Master_ConfigCS(&HostGpioB, CS_B);
+  HostGpio();
+  CHECK(OnlySelected(3));
+  CHECK(SPI1_Master_IsIdle());
+
+  /* Len 0 refused, nothing starts */
+  Describe(&xfer[0], 0, txa, rx[0], 0, 0);
+  CHECK(SPI1_Master_Submit(&xfer[0]) == ERROR);
+  CHECK(SPI1_Master_IsIdle());
+
+  /* A, B, A, no CS: the first starts at once, the rest queue */
+  Describe(&xfer[0], 0, txa, rx[0], 6, 1);
+  Describe(&xfer[1], 1, txb, rx[1], 3, 2);
+  Describe(&xfer[2], 0, txa + 2, rx[2], 2, 3);
+  Describe(&xfer[3], 2, txb, rx[3], 1, 4);
+  for (i = 0; i < 4U; i++)
+  {
+    CHECK(SPI1_Master_Submit(&xfer[i]) == SUCCESS);
+  }
+  CHECK_EQ(xfer[0].Status, SPI1_XFER_ACTIVE);
+  CHECK_EQ(xfer[1].Status, SPI1_XFER_QUEUED);
+  CHECK_EQ(xfer[3].Status, SPI1_XFER_QUEUED);
+  HostGpio();
+  CHECK(OnlySelected(0));
+  CHECK(!SPI1_Master_IsIdle());
+  /* the first completion starts the second before its callback runs */
+  CHECK(Clock());
+  CHECK_EQ(xfer[0].Status, SPI1_XFER_DONE);
+  CHECK(Active == &xfer[1]);
+  CHECK(OnlySelected(1));
+  RunAll();
+  CHECK(SPI1_Master_IsIdle());
+  CHECK_EQ(DoneCount, 4);
+  for (i = 0; i < 4U; i++)
+  {
+    CHECK_EQ(Done[i], i + 1U);
+    CHECK_EQ(xfer[i].Status, SPI1_XFER_DONE);
+  }
+  CHECK_EQ(DevLen[0], 8);
+  CHECK_EQ(DevLog[0][0], 0x80);
+  CHECK_EQ(DevLog[0][5], 0x55);
+  CHECK_EQ(DevLog[0][6], 0x22);
+  CHECK_EQ(DevLog[0][7], 0x33);
+  CHECK_EQ(DevLen[1], 3);
+  CHECK_EQ(DevLog[1][1], 0xC0);
+  CHECK_EQ(DevLen[2], 1);
+  CHECK_EQ(rx[0][1], 0x11 ^ 0x5A);
+  CHECK_EQ(rx[1][2], 0x01 ^ 0xA5);
+  CHECK_EQ(rx[2][1], 0x33 ^ 0x5A);
+  CHECK_EQ(rx[3][0], 0x03);
+  HostGpio();
+  CHECK(OnlySelected(3));
+
+  /* read with the dummy byte, write dropping what comes back */
+  memset(rx, 0, sizeof(rx));
+  Describe(&xfer[0], 1, 0, rx[0], 4, 5);
+  Describe(&xfer[1], 0, txa, 0, 6, 6);
+  CHECK(SPI1_Master_Submit(&xfer[0]) == SUCCESS);
+  CHECK(SPI1_Master_Submit(&xfer[1]) == SUCCESS);
+  RunAll();
+  CHECK_EQ(DevLen[1], 7);
+  CHECK_EQ(DevLog[1][3], SPI1_MASTER_DUMMY);
+  CHECK_EQ(DevLog[1][6], SPI1_MASTER_DUMMY);
+  CHECK_EQ(rx[0][0], SPI1_MASTER_DUMMY ^ 0xA5);
+  CHECK_EQ(rx[0][3], SPI1_MASTER_DUMMY ^ 0xA5);
+  CHECK_EQ(DummyRx, 0x55 ^ 0x5A);
+  CHECK_EQ(DevLog[0][13], 0x55);
+
+  /* one active and a full queue; the tenth is refused */
+  DoneCount = 0;
+  for (i = 0; i < 10U; i++)
+  {
+    Describe(&xfer[i], i & 1U, txa, rx[i], 2, 10U + i);
+  }
+  for (i = 0; i < 9U; i++)
+  {
+    CHECK(SPI1_Master_Submit(&xfer[i]) == SUCCESS);
+  }
+  CHECK(SPI1_Master_Submit(&xfer[9]) == ERROR);
+  CHECK_EQ(xfer[9].Status, SPI1_XFER_IDLE);
+  SPI1_Master_GetStats(&stats);
+  CHECK_EQ(stats.QueueFull, 1);
+  RunAll();
+  CHECK_EQ(DoneCount, 9);
+  for (i = 0; i < 9U; i++)
+  {
+    CHECK_EQ(Done[i], 10U + i);
+  }
+
+  /* a callback submits behind the transactions already queued */
+  DoneCount = 0;
+  Describe(&xfer[0], 0, txa, rx[0], 2, 1);
+  Describe(&xfer[1], 1, txb, rx[1], 2, 2);
+  Describe(&xfer[2], 0, txb, rx[2], 2, 3);
+  Describe(&late, 1, txa, rx[3], 2, 9);
+  FollowUp = &late;
+  for (i = 0; i < 3U; i++)
+  {
+    CHECK(SPI1_Master_Submit(&xfer[i]) == SUCCESS);
+  }
+  RunAll();
+  CHECK_EQ(DoneCount, 4);
+  CHECK_EQ(Done[0], 1);
+  CHECK_EQ(Done[1], 2);
+  CHECK_EQ(Done[2], 3);
+  CHECK_EQ(Done[3], 9);
+  CHECK_EQ(late.Status, SPI1_XFER_DONE);
+
+  /* TE3 halfway through the second: only it fails, the third runs */
+  DoneCount = 0;
+  SPI1_Master_GetStats(&stats);
+  ErrorAt = Clocked + 2U;
+  HostSpi1.SR = 0;
+  Describe(&xfer[0], 0, txa, rx[0], 4, 1);
+  Describe(&xfer[1], 1, txa, rx[1], 4, 2);
+  Describe(&xfer[2], 0, txa, rx[2], 4, 3);
+  for (i = 0; i < 3U; i++)
+  {
+    CHECK(SPI1_Master_Submit(&xfer[i]) == SUCCESS);
+  }
+  RunAll();
+  CHECK_EQ(xfer[0].Status, SPI1_XFER_DONE);
+  CHECK_EQ(xfer[1].Status, SPI1_XFER_ERROR);
+  CHECK_EQ(xfer[2].Status, SPI1_XFER_DONE);
+  CHECK_EQ(DoneCount, 3);
+  CHECK_EQ(Done[2], 3);
+  {
+    SPI1_MasterStatsTypeDef now;
+
+    SPI1_Master_GetStats(&now);
+    CHECK_EQ(now.Errors - stats.Errors, 1);
+    CHECK_EQ(now.Transfers - stats.Transfers, 2);
+    CHECK_EQ(now.Bytes - stats.Bytes, 8);
+  }
+  HostGpio();
+  CHECK(OnlySelected(3));
+  ErrorAt = 0;
+
+  CHECK_EQ(BadCs, 0);
+  CHECK_EQ(BadDma, 0);
+
+  /* utilisation at PCLK 24MHz, then at 12MHz: WireUs follows PCLK */
+  Throughput(4);
+  Throughput(64);
+  HostRcc.CFGR = RCC_CFGR_PPRE_DIV4;
+  Throughput(4);
+  Throughput(64);
+  SPI1_Master_GetStats(&stats);
+  printf("%u transactions, %u bytes, busy %u us, wire %u us, %u errors, %u refused\n",
+         stats.Transfers, stats.Bytes, stats.BusyUs, stats.WireUs, stats.Errors, stats.QueueFull);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
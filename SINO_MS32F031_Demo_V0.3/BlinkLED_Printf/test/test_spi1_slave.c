@@ -0,0 +1,243 @@
+/**
+  ******************************************************************************
+  * @file 		test_spi1_slave.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the SPI1 slave snapshot endpoint
+  *
+  *          SPI1_Slave_EXTI_IRQHandler() runs on RAM copies of the SPI1,
+  *          EXTI and DMA1 registers. The master model pulls NSS low and
+  *          clocks a frame byte by byte; the DMA model reads each byte from
+  *          the buffer whose address the driver loaded only when it is
+  *          clocked, so a buffer the application writes during the frame
+  *          would show. Between two bytes the application takes a random
+  *          number of publish steps (BeginPublish, one payload byte each,
+  *          EndPublish); the payload is a function of SEQ. NSS rising raises
+  *          EXTI line 4 and runs the interrupt.
+  *          Checked: every frame has equal head and tail SEQ and the payload
+  *          of that SEQ, carries the newest snapshot completed before its
+  *          NSS low period (or repeats the last one), SEQ never goes back (16 bit wrap);
+  *          the Frames / Published / Overwritten counters; the handler
+  *          leaves line 4 pending until SPI1_Slave_Init() has run.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_FRAMES                  20000U
+
+static SPI_TypeDef HostSpi1;
+static EXTI_TypeDef HostExti;
+static DMA_TypeDef HostDma1;
+static uint32_t HostTxAddr;
+static uint32_t HostTxNdt;
+static uint32_t HostSpiResets;
+
+#undef SPI1
+#define SPI1                        (&HostSpi1)
+#undef EXTI
+#define EXTI                        (&HostExti)
+#undef DMA1
+#define DMA1                        (&HostDma1)
+/* DMA channel registers are reached through 32 bit address math */
+#define MS32_DMA_DisableChannel(DMAx, Channel)              ((void)0)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               ((void)0)
+#define MS32_DMA_SetMemoryAddress(DMAx, Channel, Address)   (HostTxAddr = (Address))
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostTxNdt = (NbData))
+/* the reset is what empties the TX FIFO */
+#define MS32_APB1_GRP2_ForceReset(Periphs)                  (HostSpiResets++)
+#define MS32_APB1_GRP2_ReleaseReset(Periphs)                ((void)0)
+/* the EXTI inline functions use the device address; PR is write 1 to clear */
+#define MS32_EXTI_IsActiveFlag_0_31(ExtiLine)               ((HostExti.PR & (ExtiLine)) == (ExtiLine))
+#define MS32_EXTI_ClearFlag_0_31(ExtiLine)                  (HostExti.PR &= ~(ExtiLine))
+
+#include "../USER/SPI1_SLAVE.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t Rand = 12345U;
+static uint32_t AppStep;        /* 0: idle, 1: begun, 2..: payload bytes written + 1 */
+static uint8_t *AppBuf;
+static uint16_t AppSeq;
+static uint16_t LatestDone;     /* SEQ of the newest EndPublish() */
+static uint32_t Published;
+static uint32_t Overwritten;
+static uint8_t FreshSinceLoad; /* a snapshot completed since the last load */
+
+/**
+  * @brief Pseudo random 0 ~ Range - 1
+  */
+static uint32_t Random(uint32_t Range)
+{
+  Rand = Rand * 1103515245U + 12345U;
+  return (Rand >> 16) % Range;
+}
+
+/**
+  * @brief Payload byte k of snapshot Seq
+  */
+static uint8_t Payload(uint16_t Seq, uint32_t k)
+{
+  return (uint8_t)((Seq * 7U) + (k * 13U) + (Seq >> 8));
+}
+
+/**
+  * @brief One publish step of the application
+  */
+static void AppRun(void)
+{
+  if (AppStep == 0U)
+  {
+    AppBuf = SPI1_Slave_BeginPublish();
+    AppSeq++;
+    AppStep = 1;
+  }
+  else if (AppStep <= SPI1_SLAVE_PAYLOAD)
+  {
+    AppBuf[AppStep - 1U] = Payload(AppSeq, AppStep - 1U);
+    AppStep++;
+  }
+  else
+  {
+    SPI1_Slave_EndPublish();
+    Overwritten += FreshSinceLoad;
+    FreshSinceLoad = 1;
+    LatestDone = AppSeq;
+    Published++;
+    AppStep = 0;
+  }
+}
+
+/**
+  * @brief One byte clocked out: the DMA reads it from the loaded buffer now
+  */
+static uint8_t Shift(uint32_t Pos)
+{
+  uint32_t i;
+
+  for (i = 0; i < 3U; i++)
+  {
+    if (HostTxAddr == (uint32_t)SnapBuf[i])
+    {
+      return (Pos < HostTxNdt) ? SnapBuf[i][Pos] : 0U;
+    }
+  }
+  return 0xEEU;
+}
+
+/**
+  * @brief NSS rising edge
+  */
+static void NssRise(void)
+{
+  HostExti.PR |= MS32_EXTI_LINE_4;
+  SPI1_Slave_EXTI_IRQHandler();
+}
+
+int main(void)
+{
+  uint8_t frame[SNAP_SIZE];
+  SPI1_SlaveStatsTypeDef stats;
+  uint16_t expect;
+  uint16_t last = 0;
+  uint16_t head;
+  uint16_t tail;
+  uint32_t torn = 0;
+  uint32_t stale = 0;
+  uint32_t wrong = 0;
+  uint32_t repeats = 0;
+  uint32_t f;
+  uint32_t k;
+  uint32_t steps;
+  uint8_t fast;
+
+  /* not initialised: line 4 belongs to another handler, left pending */
+  HostExti.PR = MS32_EXTI_LINE_4;
+  SPI1_Slave_EXTI_IRQHandler();
+  CHECK_EQ(HostExti.PR, MS32_EXTI_LINE_4);
+  CHECK_EQ(HostSpiResets, 0);
+  HostExti.PR = 0;
+
+  /* SPI1_Slave_Init() without the library setup */
+  SpiCR1 = SPI_CR1_SPE;
+  SpiCR2 = SPI_CR2_TXDMAEN;
+  SnapWrite = 0;
+  SnapReady = 1;
+  SnapReading = 2;
+  SnapFresh = 0;
+  SPI1_Slave_Load();
+  Enabled = 1;
+  CHECK_EQ(HostTxNdt, SNAP_SIZE);
+  CHECK_EQ(HostSpi1.CR1, SPI_CR1_SPE);
+  CHECK_EQ(HostSpi1.CR2, SPI_CR2_TXDMAEN);
+
+  for (f = 0; f < SIM_FRAMES; f++)
+  {
+    /* idle time between frames; a publish takes 30 steps, so the host
+       reads slower than the application publishes, then faster */
+    fast = (f & 0x400U) ? 0U : 1U;
+    steps = Random(fast ? 200U : 8U);
+    while (steps-- != 0U)
+    {
+      AppRun();
+    }
+    /* the frame carries what the last NSS rising edge loaded */
+    expect = SnapBuf[SnapReading][0] | (SnapBuf[SnapReading][1] << 8);
+    for (k = 0; k < SNAP_SIZE; k++)
+    {
+      frame[k] = Shift(k);
+      steps = Random(fast ? 4U : 2U);
+      while (steps-- != 0U)
+      {
+        AppRun();
+      }
+    }
+    NssRise();
+    FreshSinceLoad = 0;
+
+    head = frame[0] | (frame[1] << 8);
+    tail = frame[SNAP_SIZE - 2U] | (frame[SNAP_SIZE - 1U] << 8);
+    torn += (head != tail) ? 1U : 0U;
+    wrong += (head != expect) ? 1U : 0U;
+    stale += ((int16_t)(head - last) < 0) ? 1U : 0U;
+    repeats += ((head == last) && (f != 0U)) ? 1U : 0U;
+    for (k = 0; (head != 0U) && (k < SPI1_SLAVE_PAYLOAD); k++)
+    {
+      torn += (frame[2U + k] != Payload(head, k)) ? 1U : 0U;
+    }
+    last = head;
+    /* the next frame is the newest complete snapshot */
+    CHECK_EQ(SnapBuf[SnapReading][0] | (SnapBuf[SnapReading][1] << 8), LatestDone);
+  }
+  SPI1_Slave_GetStats(&stats);
+  printf("%u frames: %u published, %u replaced unread, %u repeated, %u torn, %u out of order\n",
+         stats.Frames, stats.Published, stats.Overwritten, repeats, torn, stale);
+  CHECK_EQ(torn, 0);
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(stale, 0);
+  CHECK(repeats > 0U);
+  CHECK_EQ(stats.Frames, SIM_FRAMES);
+  CHECK_EQ(stats.Published, Published);
+  CHECK_EQ(stats.Overwritten, Overwritten);
+  CHECK(Overwritten > 0U);
+  CHECK_EQ(HostSpiResets, SIM_FRAMES + 1U);
+  CHECK_EQ(HostExti.PR, 0);
+  CHECK_EQ(HostSpi1.CR1, SPI_CR1_SPE);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
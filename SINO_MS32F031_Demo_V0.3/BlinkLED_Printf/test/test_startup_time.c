@@ -0,0 +1,307 @@
+/**
+  ******************************************************************************
+  * @file 		test_startup_time.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the startup phase timer and the DMA zero fill
+  *
+  *          STARTUP_TIME.c runs on RAM copies of the RCC, TIM17 and DMA1
+  *          registers. The timer model counts 1us ticks at whatever
+  *          prescaler the module loaded and raises UIF on each wrap; the DMA
+  *          model copies one source word per step into a RAM block that
+  *          stands for the RW_DMAZERO region, one step per busy-wait poll.
+  *          A modelled boot (HSI until the clock switch, scatter loading,
+  *          peripheral set up with the DMA clearing meanwhile) prints the
+  *          phase budget for the project buffer sizes.
+  *          Checked: the phase times over the clock switch and over timer
+  *          wraps, marks more than 65ms apart lose the extra wraps as documented;
+  *          TIM17 is released by StartupTime_End(); the zero fill for
+  *          every length 0 ~ 67 bytes (DMA words, CPU tail, nothing past
+  *          the end, no DMA below one word); the channel configuration and
+  *          the channel being free after StartupTime_ZeroWait().
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+#include "USART1_RX.h"
+#include "USART1_PKT.h"
+#include "MODBUS_RTU.h"
+#include "CAPTURE.h"
+#include "RTC_LOG.h"
+#include "I2C1_SLAVE.h"
+#include "ENERGY.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_ZERO_MAX                68U
+#define SIM_GUARD                   8U
+
+/* Boot model, 48MHz HCLK after the clock switch */
+#define SIM_HCLK_MHZ                48U
+#define SIM_CLOCK_US                180U    /* HSI to SW on the PLL (lock time) */
+#define SIM_DATA_BYTES              256U    /* .data copied by __scatterload */
+#define SIM_BSS_BYTES               1024U   /* .bss still cleared by the library */
+#define SIM_PERIPH_CYCLES           6000U   /* SysTick, GPIO table, USART1, RX DMA */
+#define SIM_COPY_CYCLES_PER_WORD    4U      /* LDM / STM loop from flash, 1 wait state */
+#define SIM_ZERO_CYCLES_PER_WORD    2U      /* STM loop of the library clear */
+#define SIM_DMA_CYCLES_PER_WORD     5U      /* flash read, SRAM write, arbitration */
+
+/* the private buffer sizes of USART1_PKT.c (header 3, CRC 4) and MODBUS_RTU.c */
+#define SIM_PKT_BUF                 (1U + 3U + USART1_PKT_MAX_PAYLOAD + 4U + 1U)
+#define SIM_MODBUS_BUF              (9U + (2U * MODBUS_RTU_MAX_REGS))
+#define SIM_NOINIT_BYTES            (USART1_RX_RING_SIZE + (3U * SIM_PKT_BUF) + (2U * SIM_MODBUS_BUF) + \
+                                     (4U * CAPTURE_BUF_SIZE) + (7U * RTC_LOG_RING))
+#define SIM_DMAZERO_BYTES           ((3U * I2C1_SLAVE_MAP_SIZE) + (8U * (ENERGY_STATES + ENERGY_CLOCKS)))
+
+static RCC_TypeDef HostRcc;
+static TIM_TypeDef HostTim17;
+static DMA_TypeDef HostDma1;
+static uint8_t HostZero[SIM_ZERO_MAX + SIM_GUARD] __attribute__((aligned(4)));
+static uint32_t HostZeroBytes;
+static uint32_t HostDmaCfg;
+static uint32_t HostDmaSrc;
+static uint32_t HostDmaDst;
+static uint32_t HostDmaNdt;
+static uint32_t HostDmaDone;
+static uint32_t HostDmaSteps;
+static uint32_t HostDmaStarts;
+static uint8_t HostDmaEn;
+static const uint32_t *HostDmaFrom;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef TIM17
+#define TIM17                       (&HostTim17)
+#undef DMA1
+#define DMA1                        (&HostDma1)
+/* the bus inline functions were compiled with the device RCC */
+#define MS32_APB1_GRP2_EnableClock(Periphs)                 (HostRcc.APB2ENR |= (Periphs))
+#define MS32_APB1_GRP2_DisableClock(Periphs)                (HostRcc.APB2ENR &= ~(Periphs))
+#define MS32_AHB1_GRP1_EnableClock(Periphs)                 (HostRcc.AHBENR |= (Periphs))
+
+/**
+  * @brief One word of the memory to memory transfer
+  */
+static void HostDmaStep(void)
+{
+  if ((HostDmaEn == 0U) || (HostDmaDone >= HostDmaNdt))
+  {
+    return;
+  }
+  memcpy(&HostZero[HostDmaDone * 4U], HostDmaFrom, 4U);
+  HostDmaDone++;
+  HostDmaSteps++;
+  if (HostDmaDone == HostDmaNdt)
+  {
+    HostDma1.ISR |= DMA_ISR_GIF1 | DMA_ISR_TCIF1;
+  }
+}
+
+/* DMA channel registers are reached through 32 bit address math */
+#define MS32_DMA_DisableChannel(DMAx, Channel)              (HostDmaEn = 0U)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               (HostDmaEn = 1U, HostDmaDone = 0U, HostDmaStarts++)
+#define MS32_DMA_ConfigTransfer(DMAx, Channel, Config)      (HostDmaCfg = (Config))
+#define MS32_DMA_SetPeriphAddress(DMAx, Channel, Address)   (HostDmaSrc = (Address))
+#define MS32_DMA_SetMemoryAddress(DMAx, Channel, Address)   (HostDmaDst = (Address))
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostDmaNdt = (NbData))
+#define MS32_DMA_ClearFlag_GI1(DMAx)                        (HostDma1.ISR &= ~(DMA_ISR_GIF1 | DMA_ISR_TCIF1 | \
+                                                                               DMA_ISR_HTIF1 | DMA_ISR_TEIF1))
+/* the transfer goes on while the CPU polls */
+#define MS32_DMA_IsActiveFlag_TC1(DMAx)                     (HostDmaStep(), ((HostDma1.ISR & DMA_ISR_TCIF1) != 0U))
+/* the RW_DMAZERO region */
+#define STARTUP_DMAZERO_BASE        HostZero
+#define STARTUP_DMAZERO_BYTES       HostZeroBytes
+
+#include "../USER/STARTUP_TIME.c"
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t Now;            /* true time since StartupTime_Begin(), us */
+static uint32_t Wrapped;        /* counter wraps of the model */
+
+/**
+  * @brief Let time pass, TIM17 at its 1us prescaler
+  */
+static void Run(uint32_t Us)
+{
+  if (HostTim17.EGR & TIM_EGR_UG)
+  {
+    /* update event: prescaler loaded, counter restarts */
+    HostTim17.EGR = 0;
+    HostTim17.CNT = 0;
+  }
+  Now += Us;
+  if ((HostTim17.CR1 & TIM_CR1_CEN) == 0U)
+  {
+    return;
+  }
+  HostTim17.CNT += Us;
+  while (HostTim17.CNT > HostTim17.ARR)
+  {
+    HostTim17.CNT -= HostTim17.ARR + 1U;
+    HostTim17.SR |= TIM_SR_UIF;
+    Wrapped++;
+  }
+}
+
+/**
+  * @brief Cycles at the model HCLK to whole us
+  */
+static uint32_t CyclesUs(uint32_t Cycles)
+{
+  return (Cycles + SIM_HCLK_MHZ - 1U) / SIM_HCLK_MHZ;
+}
+
+/**
+  * @brief Zero fill of one region length, DMA part running Steps words early
+  */
+static void ZeroFill(uint32_t Bytes, uint32_t Steps)
+{
+  uint32_t i;
+
+  memset(HostZero, 0xA5, sizeof(HostZero));
+  memset(&HostDma1, 0, sizeof(HostDma1));
+  HostRcc.AHBENR = 0;
+  HostZeroBytes = Bytes;
+  HostDmaStarts = 0;
+  HostDmaNdt = 0;
+  StartupTime_ZeroStart();
+  if ((Bytes >> 2) == 0U)
+  {
+    CHECK_EQ(HostDmaStarts, 0);
+    CHECK_EQ(HostRcc.AHBENR, 0);
+  }
+  else
+  {
+    CHECK_EQ(HostDmaStarts, 1);
+    CHECK(HostRcc.AHBENR & RCC_AHBENR_DMAEN);
+    CHECK_EQ(HostDmaNdt, Bytes >> 2);
+    CHECK_EQ(HostDmaDst, (uint32_t)HostZero);
+    CHECK_EQ(HostDmaSrc, (uint32_t)&ZeroWord);
+    CHECK_EQ(HostDmaCfg, MS32_DMA_DIRECTION_MEMORY_TO_MEMORY | MS32_DMA_MEMORY_INCREMENT |
+                         MS32_DMA_PDATAALIGN_WORD | MS32_DMA_MDATAALIGN_WORD);
+  }
+  /* peripheral set up meanwhile */
+  while (Steps-- != 0U)
+  {
+    HostDmaStep();
+  }
+  StartupTime_ZeroWait();
+  for (i = 0; i < Bytes; i++)
+  {
+    CHECK_EQ(HostZero[i], 0);
+  }
+  for (i = Bytes; i < sizeof(HostZero); i++)
+  {
+    CHECK_EQ(HostZero[i], 0xA5);
+  }
+  CHECK_EQ(HostDmaEn, 0);
+  CHECK_EQ(HostDma1.ISR & DMA_ISR_TCIF1, 0);
+}
+
+int main(void)
+{
+  StartupTime_TypeDef t;
+  uint32_t clock;
+  uint32_t main_us;
+  uint32_t zero_us;
+  uint32_t dma_us;
+  uint32_t periph_us;
+  uint32_t wait_us;
+  uint32_t bytes;
+  uint32_t i;
+
+  /* SystemInit() entry on HSI */
+  StartupTime_Begin();
+  CHECK(HostRcc.APB2ENR & RCC_APB2ENR_TIM17EN);
+  CHECK_EQ(HostTim17.PSC, (HSI_VALUE / 1000000U) - 1U);
+  CHECK_EQ(HostTim17.ARR, 0xFFFF);
+  CHECK(HostTim17.CR1 & TIM_CR1_CEN);
+  Run(SIM_CLOCK_US);
+  StartupTime_ClockReady(SIM_HCLK_MHZ * 1000000U);
+  CHECK_EQ(HostTim17.PSC, SIM_HCLK_MHZ - 1U);
+  CHECK_EQ(HostTim17.CCR1, SIM_CLOCK_US);
+  clock = Now;
+
+  /* scatter loading, the noinit and dmazero regions skipped */
+  Run(CyclesUs(((SIM_DATA_BYTES / 4U) * SIM_COPY_CYCLES_PER_WORD) +
+               ((SIM_BSS_BYTES / 4U) * SIM_ZERO_CYCLES_PER_WORD)));
+  StartupTime_Mark(STARTUP_PHASE_MAIN);
+  main_us = Now;
+  /* DMA clear behind the peripheral set up */
+  periph_us = CyclesUs(SIM_PERIPH_CYCLES);
+  dma_us = CyclesUs((SIM_DMAZERO_BYTES / 4U) * SIM_DMA_CYCLES_PER_WORD);
+  wait_us = (dma_us > periph_us) ? (dma_us - periph_us) : 0U;
+  Run(periph_us + wait_us);
+  StartupTime_Mark(STARTUP_PHASE_PERIPH);
+  StartupTime_Get(&t);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_CLOCK], clock);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_MAIN], main_us);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_PERIPH], Now);
+
+  zero_us = CyclesUs(((SIM_NOINIT_BYTES + SIM_DMAZERO_BYTES) / 4U) * SIM_ZERO_CYCLES_PER_WORD);
+  printf("boot at %uMHz: clock ready %uus, main %uus, peripherals %uus\n",
+         SIM_HCLK_MHZ, t.PhaseUs[STARTUP_PHASE_CLOCK], t.PhaseUs[STARTUP_PHASE_MAIN],
+         t.PhaseUs[STARTUP_PHASE_PERIPH]);
+  printf("  .data %uB + .bss %uB by the library: %uus\n", SIM_DATA_BYTES, SIM_BSS_BYTES,
+         main_us - clock);
+  printf("  noinit %uB + dmazero %uB left out of the library clear: %uus saved\n",
+         SIM_NOINIT_BYTES, SIM_DMAZERO_BYTES, zero_us);
+  printf("  DMA clear %uus behind %uus of peripheral set up: %uus waited\n",
+         dma_us, periph_us, wait_us);
+
+  /* later marks keep counting over wraps while they come within 65ms */
+  for (i = 0; i < 5U; i++)
+  {
+    Run(60000U);
+    StartupTime_Mark(STARTUP_PHASE_PERIPH);
+  }
+  StartupTime_Get(&t);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_PERIPH], Now);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_CLOCK], clock);
+  /* one flag for two or three wraps */
+  Wrapped = 0;
+  Run(140000U);
+  StartupTime_Mark(STARTUP_PHASE_PERIPH);
+  StartupTime_Get(&t);
+  CHECK(Wrapped >= 2U);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_PERIPH], Now - ((Wrapped - 1U) << 16));
+  /* out of range phase ignored */
+  StartupTime_Mark(STARTUP_PHASES);
+  StartupTime_Get(&t);
+  CHECK_EQ(t.PhaseUs[STARTUP_PHASE_PERIPH], Now - ((Wrapped - 1U) << 16));
+
+  StartupTime_End();
+  CHECK_EQ(HostTim17.CR1 & TIM_CR1_CEN, 0);
+  CHECK_EQ(HostRcc.APB2ENR & RCC_APB2ENR_TIM17EN, 0);
+  CHECK_EQ(ZeroWord, 0);
+
+  /* zero fill, DMA done before the wait or finished by the polls */
+  HostDmaFrom = &ZeroWord;
+  for (bytes = 0; bytes < SIM_ZERO_MAX; bytes++)
+  {
+    ZeroFill(bytes, 0);
+    ZeroFill(bytes, bytes / 8U);
+    ZeroFill(bytes, bytes);
+  }
+  /* every whole word by the DMA, only the tail by the CPU */
+  HostDmaSteps = 0;
+  ZeroFill(SIM_ZERO_MAX, 0);
+  CHECK_EQ(HostDmaSteps, SIM_ZERO_MAX / 4U);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
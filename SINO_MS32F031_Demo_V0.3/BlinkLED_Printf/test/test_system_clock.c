@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file 		test_system_clock.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of SystemCoreClockUpdate() and the HSE timeout path
+  *
+  *          system_ms32f0xx.c runs on RAM copies of the RCC and FLASH
+  *          registers, built with a HSE plan (8MHz crystal, SYSCLK 48MHz,
+  *          HCLK 24MHz, PCLK 12MHz).
+  *          Checked: SystemCoreClockUpdate() against an exact reference for
+  *          every SYSCLK source, PLL source, PREDIV, PLLMUL and HPRE setting;
+  *          ClockPlan_TimClkHz() for every APB prescaler; the CLOCK_PLAN.h
+  *          register values and the backup plan give the planned clocks; SystemInit() with a HSE that never starts stays on
+  *          HSI, and SystemCoreClockUpdate() then reports HSI over the
+  *          planned value the scatter loading puts back.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Private define ------------------------------------------------------------*/
+#define CLOCK_PLAN_SOURCE           1
+#define CLOCK_PLAN_SYSCLK_HZ        48000000UL
+#define CLOCK_PLAN_HCLK_HZ          24000000UL
+#define CLOCK_PLAN_PCLK_HZ          12000000UL
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static RCC_TypeDef HostRcc;
+static FLASH_TypeDef HostFlash;
+static uint32_t HostReadyClk;
+
+#undef RCC
+#define RCC                         (&HostRcc)
+#undef FLASH
+#define FLASH                       (&HostFlash)
+
+#include "../../chip/ms32f0xx/source/system_ms32f0xx.c"
+
+/* Project hook SystemInit() calls ------------------------------------------*/
+void SystemInit_ClockReadyHook(uint32_t TimerClk)
+{
+  HostReadyClk = TimerClk;
+}
+
+/**
+  * @brief Reference HCLK of a RCC_CFGR / RCC_CFGR2 setting, exact
+  * @param Cfgr RCC_CFGR, SWS used
+  * @param Cfgr2 RCC_CFGR2
+  * @retval Hz
+  */
+static uint32_t RefHclk(uint32_t Cfgr, uint32_t Cfgr2)
+{
+  static const uint32_t hdiv[16] = {1, 1, 1, 1, 1, 1, 1, 1, 2, 4, 8, 16, 64, 128, 256, 512};
+  /* PLLMUL 0000 x2 ... 1110 x16, 1111 x16 */
+  static const uint32_t mul[16] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 16};
+  uint64_t sysclk;
+
+  if ((Cfgr & RCC_CFGR_SWS) == RCC_CFGR_SWS_HSE)
+  {
+    sysclk = HSE_VALUE;
+  }
+  else if ((Cfgr & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)
+  {
+    sysclk = HSI_VALUE;
+  }
+  else if ((Cfgr & RCC_CFGR_PLLSRC) == RCC_CFGR_PLLSRC_HSE_PREDIV)
+  {
+    sysclk = (uint64_t)HSE_VALUE * mul[(Cfgr & RCC_CFGR_PLLMUL) >> RCC_CFGR_PLLMUL_Pos] /
+             ((Cfgr2 & RCC_CFGR2_PREDIV) + 1U);
+  }
+  else
+  {
+    sysclk = (uint64_t)(HSI_VALUE / 2U) * mul[(Cfgr & RCC_CFGR_PLLMUL) >> RCC_CFGR_PLLMUL_Pos];
+  }
+  return (uint32_t)(sysclk / hdiv[(Cfgr & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos]);
+}
+
+/**
+  * @brief SystemCoreClockUpdate() on one register setting
+  * @retval 1 equal to the reference
+  */
+static uint8_t UpdateMatches(uint32_t Cfgr, uint32_t Cfgr2)
+{
+  RCC->CFGR = Cfgr;
+  RCC->CFGR2 = Cfgr2;
+  SystemCoreClock = 0;
+  SystemCoreClockUpdate();
+  if (SystemCoreClock != RefHclk(Cfgr, Cfgr2))
+  {
+    printf("CFGR 0x%08X CFGR2 %u: %u Hz, expected %u Hz\n", Cfgr, Cfgr2, SystemCoreClock, RefHclk(Cfgr, Cfgr2));
+    return 0;
+  }
+  return 1;
+}
+
+int main(void)
+{
+  static const uint32_t sws[3] = {RCC_CFGR_SWS_HSI, RCC_CFGR_SWS_HSE, RCC_CFGR_SWS_PLL};
+  uint32_t src;
+  uint32_t prediv;
+  uint32_t mul;
+  uint32_t hpre;
+  uint32_t s;
+  uint32_t cfgr;
+  uint32_t bad = 0;
+  uint32_t runs = 0;
+
+  /* every source, PLL setting and AHB prescaler */
+  for (s = 0; s < 3U; s++)
+  {
+    for (src = 0; src < 2U; src++)
+    {
+      for (prediv = 0; prediv < 16U; prediv++)
+      {
+        for (mul = 0; mul < 16U; mul++)
+        {
+          for (hpre = 0; hpre < 16U; hpre++)
+          {
+            cfgr = sws[s] | (src ? RCC_CFGR_PLLSRC_HSE_PREDIV : RCC_CFGR_PLLSRC_HSI_DIV2) |
+                   (mul << RCC_CFGR_PLLMUL_Pos) | (hpre << RCC_CFGR_HPRE_Pos);
+            bad += (UpdateMatches(cfgr, prediv) == 0U) ? 1U : 0U;
+            runs++;
+          }
+        }
+      }
+    }
+  }
+  printf("%u register settings, %u wrong\n", runs, bad);
+  CHECK_EQ(bad, 0);
+  /* PLLMUL 1111 is x16 as RCC_CFGR_PLLMUL16; HSE / 3 is not a whole Hz */
+  RCC->CFGR = RCC_CFGR_SWS_PLL | RCC_CFGR_PLLMUL;
+  RCC->CFGR2 = 0;
+  SystemCoreClockUpdate();
+  CHECK_EQ(SystemCoreClock, 64000000);
+  RCC->CFGR = RCC_CFGR_SWS_PLL | RCC_CFGR_PLLSRC_HSE_PREDIV | (4U << RCC_CFGR_PLLMUL_Pos);
+  RCC->CFGR2 = 2;
+  SystemCoreClockUpdate();
+  CHECK_EQ(SystemCoreClock, 16000000);
+
+  /* timer clock of every APB prescaler: PCLK, x2 when divided */
+  SystemCoreClock = 48000000;
+  for (s = 0; s < 8U; s++)
+  {
+    RCC->CFGR = s << RCC_CFGR_PPRE_Pos;
+    CHECK_EQ(ClockPlan_TimClkHz(), (s < 4U) ? 48000000U : (2U * 48000000U) >> (s - 3U));
+  }
+
+  /* the planned and the backup register values */
+  CHECK_EQ(CLOCK_PLAN_PREDIV, 1);
+  CHECK_EQ(CLOCK_PLAN_PLLMUL, 6);
+  RCC->CFGR = CLOCK_PLAN_CFGR | CLOCK_PLAN_SWS;
+  RCC->CFGR2 = CLOCK_PLAN_CFGR2;
+  SystemCoreClockUpdate();
+  CHECK_EQ(SystemCoreClock, CLOCK_PLAN_HCLK_HZ);
+  CHECK_EQ(ClockPlan_PclkHz(), CLOCK_PLAN_PCLK_HZ);
+  CHECK_EQ(ClockPlan_TimClkHz(), CLOCK_PLAN_TIMCLK_HZ);
+  RCC->CFGR = CLOCK_PLAN_BACKUP_CFGR_PLL | CLOCK_PLAN_HPRE | CLOCK_PLAN_PPRE | RCC_CFGR_SWS_PLL;
+  SystemCoreClockUpdate();
+  CHECK_EQ(SystemCoreClock, CLOCK_PLAN_BACKUP_SYSCLK_HZ / CLOCK_PLAN_AHB_DIV);
+
+  /* reset state, HSE never ready: SystemInit() gives up and stays on HSI */
+  RCC->CR = RCC_CR_HSION | RCC_CR_HSIRDY;
+  RCC->CFGR = 0;
+  RCC->CFGR2 = 0;
+  FLASH->ACR = 0;
+  SystemInit();
+  CHECK((RCC->CR & (RCC_CR_HSEON | RCC_CR_PLLON)) == 0);
+  CHECK_EQ(RCC->CFGR, 0);
+  CHECK_EQ(FLASH->ACR, 0);
+  CHECK_EQ(HostReadyClk, HSI_VALUE);
+  /* scatter loading puts the initial value back, main() updates it */
+  SystemCoreClock = CLOCK_PLAN_HCLK_HZ;
+  SystemCoreClockUpdate();
+  CHECK_EQ(SystemCoreClock, HSI_VALUE);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
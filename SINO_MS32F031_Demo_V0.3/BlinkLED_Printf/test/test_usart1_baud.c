@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file 		test_usart1_baud.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of USART1_Baud_Calc()
+  *
+  *          BRR and baud error for every kernel clock of the clock plans and
+  *          every rate of USART1_BaudRateTable, both oversampling modes,
+  *          against a floating point reference; a few pairs pinned.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "../USER/USART1_BAUD.c"
+#include "host_test.h"
+#include <math.h>
+
+/* Variables -----------------------------------------------------------------*/
+uint32_t SystemCoreClock = 48000000;
+
+static const uint32_t ClockTable[] = {8000000, 16000000, 24000000, 48000000};
+
+/**
+  * @brief Effective divider the USART runs with for a BRR value
+  * @param OverSampling mode
+  * @param Brr register value
+  * @retval kernel clocks per bit
+  */
+static uint32_t BrrToDiv(uint32_t OverSampling, uint16_t Brr)
+{
+  if (OverSampling == MS32_USART_OVERSAMPLING_8)
+  {
+    /* BRR[2:0] holds USARTDIV[3:1], baud = 2 * clk / USARTDIV */
+    return (((uint32_t)Brr & 0xFFF0U) | (((uint32_t)Brr & 0x7U) << 1)) / 2U;
+  }
+  return Brr;
+}
+
+/**
+  * @brief One clock / rate / mode against the reference
+  * @param Clk kernel clock
+  * @param OverSampling mode
+  * @param Baud rate
+  * @retval None
+  */
+static void CheckPair(uint32_t Clk, uint32_t OverSampling, uint32_t Baud)
+{
+  USART1_BaudTypeDef cfg;
+  ErrorStatus status;
+  uint32_t div = (uint32_t)floor((double)Clk / Baud + 0.5);
+  uint32_t min = (OverSampling == MS32_USART_OVERSAMPLING_8) ? 8U : 16U;
+  double ppm;
+
+  status = USART1_Baud_Calc(Clk, OverSampling, Baud, &cfg);
+  if (div < min)
+  {
+    CHECK_EQ(status, ERROR);
+    return;
+  }
+  CHECK_EQ(status, SUCCESS);
+  CHECK_EQ(BrrToDiv(OverSampling, cfg.BRR), div);
+  CHECK_EQ(cfg.ActualBaud, (uint32_t)floor((double)Clk / div + 0.5));
+  ppm = ((double)Clk - (double)Baud * div) * 1e6 / ((double)Baud * div);
+  CHECK(fabs(cfg.ErrorPpm - ppm) <= 1.0);
+  CHECK_EQ(cfg.OverSampling, OverSampling);
+}
+
+int main(void)
+{
+  USART1_BaudTypeDef cfg;
+  uint8_t c;
+  uint8_t r;
+
+  for (c = 0; c < sizeof(ClockTable) / sizeof(ClockTable[0]); c++)
+  {
+    for (r = 0; r < USART1_BaudRateTableSize; r++)
+    {
+      CheckPair(ClockTable[c], MS32_USART_OVERSAMPLING_16, USART1_BaudRateTable[r]);
+      CheckPair(ClockTable[c], MS32_USART_OVERSAMPLING_8, USART1_BaudRateTable[r]);
+    }
+  }
+
+  /* pinned: the table in USART1_BAUD.c */
+  CHECK_EQ(USART1_Baud_Calc(8000000, MS32_USART_OVERSAMPLING_16, 115200, &cfg), SUCCESS);
+  CHECK_EQ(cfg.BRR, 0x45);
+  CHECK_EQ(cfg.ErrorPpm, 6441);
+  CHECK_EQ(USART1_Baud_Calc(48000000, MS32_USART_OVERSAMPLING_16, 115200, &cfg), SUCCESS);
+  CHECK_EQ(cfg.BRR, 0x1A1);
+  CHECK_EQ(cfg.ErrorPpm, -799);
+  CHECK_EQ(USART1_Baud_Calc(24000000, MS32_USART_OVERSAMPLING_16, 921600, &cfg), SUCCESS);
+  CHECK_EQ(cfg.BRR, 0x1A);
+  CHECK_EQ(cfg.ErrorPpm, 1602);
+  CHECK_EQ(USART1_Baud_Calc(8000000, MS32_USART_OVERSAMPLING_16, 1000000, &cfg), ERROR);
+  CHECK_EQ(USART1_Baud_Calc(8000000, MS32_USART_OVERSAMPLING_8, 1000000, &cfg), SUCCESS);
+  CHECK_EQ(cfg.BRR, 0x10);
+  CHECK_EQ(cfg.ErrorPpm, 0);
+  CHECK_EQ(USART1_Baud_Calc(8000000, MS32_USART_OVERSAMPLING_8, 460800, &cfg), SUCCESS);
+  CHECK_EQ(cfg.BRR, 0x21);
+  CHECK_EQ(USART1_Baud_Calc(48000000, MS32_USART_OVERSAMPLING_8, 6000000, &cfg), SUCCESS);
+  CHECK_EQ(cfg.ActualBaud, 6000000);
+  CHECK_EQ(USART1_Baud_Calc(48000000, MS32_USART_OVERSAMPLING_8, 0, &cfg), ERROR);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
@@ -0,0 +1,451 @@
+/**
+  ******************************************************************************
+  * @file 		test_usart1_pkt.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the COBS packet protocol and its loopback rate
+  *
+  *          COBS_EncodeInPlace() / COBS_DecodeInPlace() are checked against
+  *          a reference COBS (the one of tools/usart1_pkt.py): zero runs,
+  *          no zero at all, and the decoder on frames of 254, 255 bytes and
+  *          more (0xFF code blocks, the encoder stops at one block).
+  *          USART1_Pkt_Poll() then runs against a host client: the line
+  *          into the device is a byte buffer read through USART1_RxDMA_Read(),
+  *          the TX DMA is replaced by a copy into the line back, the CRC
+  *          unit by the bitwise CRC32 of the client.
+  *          Checked: PING echo, retransmit from cache, unknown command NAK,
+  *          and the recovery after corrupt delimiters (one missing, one
+  *          extra, a code byte past the end, an over-long run).
+  *          Printed: PING round trips and telemetry frames per second on
+  *          the wire at 115200 and 1000000 baud (10 bits per byte, from
+  *          the encoded lengths), and the host loopback rate of the whole
+  *          path (client encode, Poll, CRC, handler, response decode).
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <time.h>
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static DMA_TypeDef HostDma1;
+static const uint8_t *HostTxAddr;
+static uint32_t HostTxLen;
+
+#undef DMA1
+#define DMA1                        (&HostDma1)
+/* DMA channel registers are reached through 32 bit address math; the host
+   takes the buffer (slot of USART1_Pkt_StartTx) and length instead */
+#define MS32_DMA_DisableChannel(DMAx, Channel)              ((void)0)
+#define MS32_DMA_EnableChannel(DMAx, Channel)               ((void)0)
+#define MS32_DMA_SetMemoryAddress(DMAx, Channel, Address)   (HostTxAddr = TxBuf[slot])
+#define MS32_DMA_SetDataLength(DMAx, Channel, NbData)       (HostTxLen = (NbData))
+#define MS32_DMA_ClearFlag_TC4(DMAx)                        ((DMAx)->ISR &= ~DMA_ISR_TCIF4)
+
+#include "../USER/USART1_PKT.c"
+
+/* Private define ------------------------------------------------------------*/
+#define LINE_SIZE                   2048U
+#define LOOPBACK_PINGS              200000U
+
+/* Variables -----------------------------------------------------------------*/
+static uint8_t ToDevice[LINE_SIZE];
+static uint32_t ToDeviceLen;
+static uint32_t ToDevicePos;
+static uint8_t FromDevice[LINE_SIZE];
+static uint32_t FromDeviceLen;
+static uint8_t ClientSeq;
+
+static uint8_t Double(const uint8_t *Req, uint8_t ReqLen, uint8_t *Rsp)
+{
+  Rsp[0] = (uint8_t)(Req[0] * 2U);
+  return 1;
+}
+
+static const USART1_PktCmdTypeDef Cmds[] =
+{
+  {0x20, Double},
+};
+
+/* Stubs of the modules and library functions USART1_PKT calls -------------*/
+/**
+  * @brief CRC unit: poly 0x04C11DB7, init 0xFFFFFFFF, MSB first, no reflection
+  */
+uint32_t MS32_CRC_Calculate(uint32_t CalcMethod, uint32_t InputDataFormat, uint32_t pBuffer[], uint32_t BufferLength)
+{
+  const uint8_t *data = (const uint8_t *)pBuffer;
+  uint32_t crc = 0xFFFFFFFFU;
+  uint32_t i;
+  uint8_t bit;
+
+  for (i = 0; i < BufferLength; i++)
+  {
+    crc ^= (uint32_t)data[i] << 24;
+    for (bit = 0; bit < 8U; bit++)
+    {
+      crc = (crc & 0x80000000U) ? ((crc << 1) ^ 0x04C11DB7U) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+uint16_t USART1_RxDMA_Read(uint8_t *Buf, uint16_t MaxLen)
+{
+  uint32_t len = ToDeviceLen - ToDevicePos;
+
+  if (len > MaxLen)
+  {
+    len = MaxLen;
+  }
+  memcpy(Buf, &ToDevice[ToDevicePos], len);
+  ToDevicePos += len;
+  return (uint16_t)len;
+}
+
+void USART1_RxDMA_GetStats(USART1_RxStatsTypeDef *Stats)
+{
+  memset(Stats, 0, sizeof(*Stats));
+}
+
+/**
+  * @brief Reference COBS encoder, 0xFF blocks, trailing 0x00 delimiter
+  * @retval encoded length with the delimiter
+  */
+static uint32_t RefEncode(const uint8_t *Raw, uint32_t Len, uint8_t *Out)
+{
+  uint32_t code_pos = 0;
+  uint32_t o = 1;
+  uint8_t code = 1;
+  uint32_t i;
+
+  for (i = 0; i < Len; i++)
+  {
+    if (Raw[i] == 0U)
+    {
+      Out[code_pos] = code;
+      code_pos = o++;
+      code = 1;
+    }
+    else
+    {
+      Out[o++] = Raw[i];
+      if (++code == 0xFFU)
+      {
+        Out[code_pos] = code;
+        code_pos = o++;
+        code = 1;
+      }
+    }
+  }
+  Out[code_pos] = code;
+  Out[o++] = 0;
+  return o;
+}
+
+/**
+  * @brief Put one request on the line to the device
+  * @retval encoded length with the delimiter
+  */
+static uint32_t Request(uint8_t Seq, uint8_t Id, const uint8_t *Payload, uint8_t Len)
+{
+  uint8_t raw[PKT_RAW_MAX];
+  uint32_t crc;
+  uint32_t n;
+
+  raw[0] = USART1_PKT_TYPE_REQUEST;
+  raw[1] = Seq;
+  raw[2] = Id;
+  memcpy(&raw[3], Payload, Len);
+  crc = MS32_CRC_Calculate(MS32_CRC_RECALC, MS32_CRC_INPUTDATA_FORMAT_BYTES, (uint32_t *)raw, 3U + Len);
+  raw[3U + Len] = (uint8_t)crc;
+  raw[4U + Len] = (uint8_t)(crc >> 8);
+  raw[5U + Len] = (uint8_t)(crc >> 16);
+  raw[6U + Len] = (uint8_t)(crc >> 24);
+  n = RefEncode(raw, 7U + Len, &ToDevice[ToDeviceLen]);
+  ToDeviceLen += n;
+  return n;
+}
+
+/**
+  * @brief Poll the device and run its TX DMA to the end
+  */
+static void Service(void)
+{
+  USART1_Pkt_Poll();
+  while (TxActive != 0U)
+  {
+    memcpy(&FromDevice[FromDeviceLen], HostTxAddr, HostTxLen);
+    FromDeviceLen += HostTxLen;
+    HostDma1.ISR |= DMA_ISR_TCIF4;
+    USART1_Pkt_DMA_IRQHandler();
+    USART1_Pkt_Poll();
+  }
+  if (ToDevicePos == ToDeviceLen)
+  {
+    ToDevicePos = 0;
+    ToDeviceLen = 0;
+  }
+}
+
+/**
+  * @brief Take the first packet the device sent, CRC checked
+  * @param Pkt decoded packet out, CRC removed
+  * @retval decoded length without CRC, 0 when none or bad
+  */
+static uint32_t Response(uint8_t *Pkt)
+{
+  uint8_t enc[LINE_SIZE];
+  uint32_t end = 0;
+  uint32_t n;
+  uint32_t crc;
+
+  while ((end < FromDeviceLen) && (FromDevice[end] != 0U))
+  {
+    end++;
+  }
+  if (end == FromDeviceLen)
+  {
+    return 0;
+  }
+  memcpy(enc, FromDevice, end);
+  FromDeviceLen -= end + 1U;
+  memmove(FromDevice, &FromDevice[end + 1U], FromDeviceLen);
+
+  n = COBS_DecodeInPlace(enc, (uint16_t)end);
+  if (n < 7U)
+  {
+    return 0;
+  }
+  n -= 4U;
+  crc = MS32_CRC_Calculate(MS32_CRC_RECALC, MS32_CRC_INPUTDATA_FORMAT_BYTES, (uint32_t *)enc, n);
+  if ((enc[n] | (enc[n + 1U] << 8) | (enc[n + 2U] << 16) | ((uint32_t)enc[n + 3U] << 24)) != crc)
+  {
+    return 0;
+  }
+  memcpy(Pkt, enc, n);
+  return n;
+}
+
+/**
+  * @brief One PING round trip with Len payload bytes
+  * @retval 1 echoed
+  */
+static uint8_t Ping(const uint8_t *Payload, uint8_t Len)
+{
+  uint8_t rsp[PKT_RAW_MAX];
+  uint8_t seq = ClientSeq++;
+
+  Request(seq, USART1_PKT_CMD_PING, Payload, Len);
+  Service();
+  return (Response(rsp) == (3U + Len)) && (rsp[0] == USART1_PKT_TYPE_RESPONSE) &&
+         (rsp[1] == seq) && (memcmp(&rsp[3], Payload, Len) == 0);
+}
+
+/**
+  * @brief Encode and decode Raw with the module, check against the reference
+  */
+static void RoundTrip(const uint8_t *Raw, uint16_t Len)
+{
+  uint8_t buf[PKT_BUF_SIZE];
+  uint8_t ref[PKT_BUF_SIZE + 2];
+  uint16_t n;
+
+  memcpy(&buf[1], Raw, Len);
+  n = COBS_EncodeInPlace(buf, Len);
+  CHECK_EQ(n, RefEncode(Raw, Len, ref));
+  CHECK(memcmp(buf, ref, n) == 0);
+  CHECK(memchr(buf, 0, n - 1U) == 0);
+  CHECK_EQ(COBS_DecodeInPlace(buf, (uint16_t)(n - 1U)), Len);
+  CHECK(memcmp(buf, Raw, Len) == 0);
+}
+
+int main(void)
+{
+  static uint8_t raw[1024];
+  static uint8_t enc[1100];
+  static uint8_t pkt[PKT_RAW_MAX];
+  static const uint16_t big[] = {253, 254, 255, 256, 508, 509, 510, 1000};
+  static const uint32_t bauds[2] = {115200, 1000000};
+  USART1_PktStatsTypeDef stats;
+  uint8_t payload[USART1_PKT_MAX_PAYLOAD];
+  uint32_t errors;
+  uint32_t bad = 0;
+  uint32_t n;
+  uint32_t i;
+  uint32_t k;
+  uint32_t baud;
+  uint32_t rsp_len;
+  clock_t t0;
+  double s;
+
+  /* encoder: every length it takes, zero free, all zero, zero runs */
+  for (n = 1; n <= PKT_RAW_MAX; n++)
+  {
+    for (i = 0; i < n; i++)
+    {
+      raw[i] = (uint8_t)(i + 1U);
+    }
+    RoundTrip(raw, (uint16_t)n);
+    memset(raw, 0, n);
+    RoundTrip(raw, (uint16_t)n);
+    for (i = 0; i < n; i++)
+    {
+      raw[i] = ((i % 7U) < 3U) ? 0U : (uint8_t)(0xA0U + i);
+    }
+    RoundTrip(raw, (uint16_t)n);
+  }
+
+  /* decoder on frames past one block: 0xFF codes, with and without zeros */
+  for (k = 0; k < sizeof(big) / sizeof(big[0]); k++)
+  {
+    for (i = 0; i < big[k]; i++)
+    {
+      raw[i] = (uint8_t)((i % 255U) + 1U);
+    }
+    n = RefEncode(raw, big[k], enc);
+    CHECK(enc[0] == ((big[k] < 254U) ? (big[k] + 1U) : 0xFFU));
+    CHECK_EQ(COBS_DecodeInPlace(enc, (uint16_t)(n - 1U)), big[k]);
+    CHECK(memcmp(enc, raw, big[k]) == 0);
+    for (i = 0; i < big[k]; i++)
+    {
+      raw[i] = ((i % 300U) == 299U) ? 0U : (uint8_t)((i % 251U) + 1U);
+    }
+    n = RefEncode(raw, big[k], enc);
+    CHECK_EQ(COBS_DecodeInPlace(enc, (uint16_t)(n - 1U)), big[k]);
+    CHECK(memcmp(enc, raw, big[k]) == 0);
+  }
+  /* malformed: a code byte past the end, a 0x00 inside */
+  enc[0] = 5;
+  enc[1] = 1;
+  enc[2] = 2;
+  CHECK_EQ(COBS_DecodeInPlace(enc, 3), 0);
+  enc[0] = 2;
+  enc[1] = 1;
+  enc[2] = 0;
+  CHECK_EQ(COBS_DecodeInPlace(enc, 3), 0);
+
+  /* request / response through Poll */
+  /* USART1_Pkt_Init() without the CRC and DMA setup */
+  CmdTable = Cmds;
+  CmdCount = sizeof(Cmds) / sizeof(Cmds[0]);
+  memset(payload, 0, sizeof(payload));
+  CHECK(Ping(payload, 0));
+  CHECK(Ping(payload, USART1_PKT_MAX_PAYLOAD));
+  for (i = 0; i < sizeof(payload); i++)
+  {
+    payload[i] = (uint8_t)(i * 29U);
+  }
+  CHECK(Ping(payload, USART1_PKT_MAX_PAYLOAD));
+  /* application command, unknown command */
+  payload[0] = 21;
+  Request(ClientSeq++, 0x20, payload, 1);
+  Service();
+  CHECK_EQ(Response(pkt), 4);
+  CHECK_EQ(pkt[3], 42);
+  Request(ClientSeq++, 0x7E, payload, 1);
+  Service();
+  CHECK_EQ(Response(pkt), 4);
+  CHECK_EQ(pkt[0], USART1_PKT_TYPE_NAK);
+  CHECK_EQ(pkt[3], USART1_PKT_NAK_UNKNOWN_CMD);
+  /* retry of the last SEQ is answered from the cache */
+  Request((uint8_t)(ClientSeq - 1U), 0x7E, payload, 1);
+  Service();
+  CHECK_EQ(Response(pkt), 4);
+  CHECK_EQ(pkt[0], USART1_PKT_TYPE_NAK);
+  /* two requests in one read are answered in order */
+  Request(ClientSeq, USART1_PKT_CMD_PING, payload, 2);
+  Request((uint8_t)(ClientSeq + 1U), USART1_PKT_CMD_PING, payload, 3);
+  Service();
+  CHECK_EQ(Response(pkt), 5);
+  CHECK_EQ(pkt[1], ClientSeq);
+  CHECK_EQ(Response(pkt), 6);
+  CHECK_EQ(pkt[1], (uint8_t)(ClientSeq + 1U));
+  ClientSeq += 2U;
+  USART1_Pkt_GetStats(&stats);
+  CHECK_EQ(stats.RxPackets, 8);
+  CHECK_EQ(stats.Retransmits, 1);
+  CHECK_EQ(stats.CrcErrors + stats.FormatErrors, 0);
+
+  /* delimiter lost between two packets: one error, the next is answered */
+  n = Request(ClientSeq++, USART1_PKT_CMD_PING, payload, 4);
+  ToDeviceLen--;
+  Request(ClientSeq++, USART1_PKT_CMD_PING, payload, 4);
+  Service();
+  CHECK_EQ(Response(pkt), 0);
+  CHECK(Ping(payload, 8));
+  /* extra delimiter inside a packet: two errors */
+  n = Request(ClientSeq++, USART1_PKT_CMD_PING, payload, 20);
+  ToDevice[ToDeviceLen - n + 10U] = 0;
+  Service();
+  CHECK_EQ(Response(pkt), 0);
+  CHECK(Ping(payload, 8));
+  /* last code byte points past the delimiter */
+  n = Request(ClientSeq++, USART1_PKT_CMD_PING, payload, 4);
+  ToDevice[ToDeviceLen - n] = (uint8_t)(n + 3U);
+  Service();
+  CHECK_EQ(Response(pkt), 0);
+  /* empty packets between delimiters are no error */
+  ToDevice[ToDeviceLen++] = 0;
+  ToDevice[ToDeviceLen++] = 0;
+  CHECK(Ping(payload, 8));
+  /* a run longer than any packet is dropped up to the next delimiter */
+  memset(&ToDevice[ToDeviceLen], 0x55, 3U * PKT_BUF_SIZE);
+  ToDeviceLen += 3U * PKT_BUF_SIZE;
+  ToDevice[ToDeviceLen++] = 0;
+  CHECK(Ping(payload, 8));
+  USART1_Pkt_GetStats(&stats);
+  errors = stats.CrcErrors + stats.FormatErrors;
+  CHECK_EQ(errors, 5);
+  CHECK_EQ(stats.RxPackets, 12);
+  CHECK_EQ(FromDeviceLen, 0);
+
+  /* wire rate from the encoded lengths, 10 bits per byte */
+  for (k = 0; k < 3U; k++)
+  {
+    n = (k == 0U) ? 0U : ((k == 1U) ? 16U : USART1_PKT_MAX_PAYLOAD);
+    ToDeviceLen = 0;
+    i = Request(0, USART1_PKT_CMD_PING, payload, (uint8_t)n);
+    ToDeviceLen = 0;
+    CHECK_EQ(i, n + 9U);
+    for (baud = 0; baud < 2U; baud++)
+    {
+      printf("payload %2u, %7u baud: telemetry %5u frames/s, PING %5u round trips/s\n",
+             n, bauds[baud], bauds[baud] / 10U / i, bauds[baud] / 10U / (2U * i));
+    }
+  }
+  CHECK_EQ(115200U / 10U / (16U + 9U), 460);
+  CHECK_EQ(1000000U / 10U / (16U + 9U), 4000);
+
+  /* host loopback: the whole path, back to back */
+  for (k = 0; k < 2U; k++)
+  {
+    n = (k == 0U) ? 16U : USART1_PKT_MAX_PAYLOAD;
+    t0 = clock();
+    for (i = 0; i < LOOPBACK_PINGS; i++)
+    {
+      payload[0] = (uint8_t)i;
+      bad += Ping(payload, (uint8_t)n) ? 0U : 1U;
+    }
+    s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    rsp_len = 2U * (n + 9U) * LOOPBACK_PINGS;
+    printf("host loopback, payload %2u: %.0f round trips/s, %.1f MB/s on the line\n",
+           n, LOOPBACK_PINGS / s, rsp_len / s / 1e6);
+  }
+  CHECK_EQ(bad, 0);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
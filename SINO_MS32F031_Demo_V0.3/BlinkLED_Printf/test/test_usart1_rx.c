@@ -0,0 +1,355 @@
+/**
+  ******************************************************************************
+  * @file 		test_usart1_rx.c
+	* @author		SINOMCU-AE
+  * @brief 		Host test of the USART1 circular DMA receive path
+  *
+  *          USART1_RxDMA_IRQHandler() and USART1_RxDMA_DMA_IRQHandler() run
+  *          on RAM copies of the USART1 and DMA1 registers. The DMA model
+  *          writes each byte the line delivers into RxRing, counts CNDTR
+  *          down (reload at 0) and raises HT / TC at half and full ring;
+  *          the interrupt runs at once or, masked, when the test lets it.
+  *          Every byte on the line is numbered, the reader checks each byte
+  *          it gets against its number.
+  *          Checked: bursts closed by IDLE and RTO across the half / full
+  *          transfer boundaries, frames queued and read later, stream reads
+  *          of bytes no interrupt has synced yet, a late DMA interrupt, a
+  *          full frame queue, the ring lapped before and during the copy,
+  *          and the byte, frame, overrun and lap counters.
+  *
+ 	******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2021 sinomcu
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by sinomcu under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ms32f0xx.h"
+#include "host_test.h"
+
+static USART_TypeDef HostUsart1;
+static DMA_TypeDef HostDma1;
+static uint32_t HostNdt;
+static uint32_t HostNdtReads;
+static uint32_t HostLapAt;
+
+static uint32_t HostGetDataLength(void);
+
+#undef USART1
+#define USART1                      (&HostUsart1)
+#undef DMA1
+#define DMA1                        (&HostDma1)
+/* DMA channel registers are reached through 32 bit address math */
+#define MS32_DMA_GetDataLength(DMAx, Channel)   HostGetDataLength()
+/* ICR / IFCR writes clear the ISR bits at once */
+#define MS32_USART_ClearFlag_ORE(USARTx)        ((USARTx)->ISR &= ~USART_ISR_ORE)
+#define MS32_USART_ClearFlag_FE(USARTx)         ((USARTx)->ISR &= ~USART_ISR_FE)
+#define MS32_USART_ClearFlag_NE(USARTx)         ((USARTx)->ISR &= ~USART_ISR_NE)
+#define MS32_USART_ClearFlag_IDLE(USARTx)       ((USARTx)->ISR &= ~USART_ISR_IDLE)
+#define MS32_USART_ClearFlag_RTO(USARTx)        ((USARTx)->ISR &= ~USART_ISR_RTOF)
+#define MS32_DMA_ClearFlag_HT5(DMAx)            ((DMAx)->ISR &= ~DMA_ISR_HTIF5)
+#define MS32_DMA_ClearFlag_TC5(DMAx)            ((DMAx)->ISR &= ~DMA_ISR_TCIF5)
+
+#include "../USER/USART1_RX.c"
+
+/* Private define ------------------------------------------------------------*/
+#define RING                        USART1_RX_RING_SIZE
+
+/* Variables -----------------------------------------------------------------*/
+static uint32_t Sent;       /* bytes the line delivered */
+static uint32_t Taken;      /* number of the next byte the reader expects */
+static uint32_t BadBytes;
+static uint8_t IrqMasked;
+
+/* Stubs of the modules USART1_RX calls ------------------------------------*/
+uint32_t SysTick_GetUs(void)
+{
+  return Sent * 87U;
+}
+
+/**
+  * @brief Byte number n on the line, differs from n - RING and n - 256
+  */
+static uint8_t Pattern(uint32_t n)
+{
+  return (uint8_t)((n * 37U) + (n >> 7));
+}
+
+/**
+  * @brief DMA1 channel 5 interrupt
+  */
+static void DmaIrq(void)
+{
+  if (HostDma1.ISR & (DMA_ISR_HTIF5 | DMA_ISR_TCIF5))
+  {
+    USART1_RxDMA_DMA_IRQHandler();
+  }
+}
+
+/**
+  * @brief USART1 interrupt with Flags
+  */
+static void UsartIrq(uint32_t Flags)
+{
+  HostUsart1.ISR |= Flags;
+  USART1_RxDMA_IRQHandler();
+}
+
+/**
+  * @brief Count bytes arrive on the line, DMA moves each into the ring
+  * @param Count bytes
+  * @retval None
+  */
+static void Arrive(uint32_t Count)
+{
+  while (Count-- != 0U)
+  {
+    RxRing[RING - HostNdt] = Pattern(Sent++);
+    HostNdt = (HostNdt == 1U) ? RING : (HostNdt - 1U);
+    if (HostNdt == (RING / 2U))
+    {
+      HostDma1.ISR |= DMA_ISR_HTIF5;
+    }
+    else if (HostNdt == RING)
+    {
+      HostDma1.ISR |= DMA_ISR_TCIF5;
+    }
+    if (IrqMasked == 0U)
+    {
+      DmaIrq();
+    }
+  }
+}
+
+/**
+  * @brief CNDTR read; at read HostLapAt a whole ring arrives first, as it
+  *        would while the reader copies
+  */
+static uint32_t HostGetDataLength(void)
+{
+  if (++HostNdtReads == HostLapAt)
+  {
+    Arrive(RING + 3U);
+  }
+  return HostNdt;
+}
+
+/**
+  * @brief Line silent: IDLE after one character, RTO after the timeout
+  */
+static void EndFrame(void)
+{
+  UsartIrq(USART_ISR_IDLE);
+  UsartIrq(USART_ISR_RTOF);
+}
+
+/**
+  * @brief Check Len bytes the reader got against the line
+  */
+static void Verify(const uint8_t *Buf, uint32_t Len)
+{
+  uint32_t i;
+
+  for (i = 0; i < Len; i++)
+  {
+    if (Buf[i] != Pattern(Taken + i))
+    {
+      BadBytes++;
+    }
+  }
+  Taken += Len;
+}
+
+static uint16_t TakeFrame(void)
+{
+  uint8_t buf[2U * RING];
+  uint16_t len = USART1_RxDMA_GetFrame(buf, sizeof(buf));
+
+  Verify(buf, len);
+  return len;
+}
+
+static uint16_t TakeStream(uint16_t MaxLen)
+{
+  uint8_t buf[2U * RING];
+  uint16_t len = USART1_RxDMA_Read(buf, MaxLen);
+
+  Verify(buf, len);
+  return len;
+}
+
+int main(void)
+{
+  static const uint16_t sizes[] = {10, 60, 1, 64, 100, 127, RING, 33, 2};
+  USART1_RxStatsTypeDef stats;
+  uint8_t buf[RING];
+  uint32_t frames = 0;
+  uint32_t i;
+
+  /* USART1_RxDMA_Init() ran: DMA request on, CNDTR at the ring size */
+  HostUsart1.CR3 = USART_CR3_DMAR;
+  HostNdt = RING;
+
+  /* one burst per frame, across the HT / TC boundaries, up to a full ring */
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    Arrive(sizes[i]);
+    EndFrame();
+    CHECK_EQ(TakeFrame(), sizes[i]);
+    frames++;
+  }
+  /* IDLE in the middle of a frame only syncs, RTO closes it */
+  Arrive(20);
+  UsartIrq(USART_ISR_IDLE);
+  Arrive(50);
+  EndFrame();
+  CHECK_EQ(TakeFrame(), 70);
+  frames++;
+  /* RTO without new bytes is no frame */
+  UsartIrq(USART_ISR_RTOF);
+  CHECK_EQ(TakeFrame(), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RxBytes, Sent);
+  CHECK_EQ(stats.Frames, frames);
+  CHECK_EQ(stats.RingOverflows, 0);
+
+  /* frames queued, read later */
+  for (i = 0; i < 3U; i++)
+  {
+    Arrive(40);
+    EndFrame();
+  }
+  frames += 3U;
+  CHECK_EQ(USART1_RxDMA_Available(), 120);
+  CHECK_EQ(TakeFrame(), 40);
+  CHECK_EQ(TakeFrame(), 40);
+  CHECK_EQ(TakeFrame(), 40);
+  CHECK_EQ(TakeFrame(), 0);
+
+  /* stream read of bytes no interrupt has synced yet */
+  IrqMasked = 1;
+  Arrive(50);
+  CHECK_EQ(USART1_RxDMA_Available(), 50);
+  CHECK_EQ(TakeStream(16), 16);
+  CHECK_EQ(TakeStream(16), 16);
+  CHECK_EQ(TakeStream(16), 16);
+  CHECK_EQ(TakeStream(16), 2);
+  CHECK_EQ(TakeStream(16), 0);
+  IrqMasked = 0;
+  DmaIrq();
+  CHECK_EQ(USART1_RxDMA_Available(), 0);
+  /* a frame read through the stream leaves the frame queue */
+  Arrive(10);
+  EndFrame();
+  frames++;
+  CHECK_EQ(TakeStream(RING), 10);
+  CHECK_EQ(TakeFrame(), 0);
+
+  /* late DMA interrupt: one sync takes 120 bytes */
+  IrqMasked = 1;
+  Arrive(120);
+  CHECK(HostDma1.ISR & (DMA_ISR_HTIF5 | DMA_ISR_TCIF5));
+  IrqMasked = 0;
+  DmaIrq();
+  CHECK_EQ(HostDma1.ISR & (DMA_ISR_HTIF5 | DMA_ISR_TCIF5), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RxBytes, Sent);
+  EndFrame();
+  frames++;
+  CHECK_EQ(TakeFrame(), 120);
+
+  /* frame queue full: the ninth frame is dropped, its bytes join the next */
+  for (i = 0; i < USART1_RX_FRAME_DEPTH + 1U; i++)
+  {
+    Arrive(10);
+    EndFrame();
+  }
+  frames += USART1_RX_FRAME_DEPTH;
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.FrameDrops, 1);
+  for (i = 0; i < USART1_RX_FRAME_DEPTH; i++)
+  {
+    CHECK_EQ(TakeFrame(), 10);
+  }
+  Arrive(5);
+  EndFrame();
+  frames++;
+  CHECK_EQ(TakeFrame(), 15);
+
+  /* overrun and line errors are counted and cleared */
+  UsartIrq(USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE);
+  UsartIrq(USART_ISR_ORE);
+  CHECK_EQ(HostUsart1.ISR, 0);
+
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RxBytes, Sent);
+  CHECK_EQ(stats.Frames, frames);
+  CHECK_EQ(stats.OverrunErrors, 2);
+  CHECK_EQ(stats.RingOverflows, 0);
+  CHECK_EQ(stats.FrameTruncations, 0);
+  CHECK_EQ(Taken, Sent);
+  CHECK_EQ(BadBytes, 0);
+
+  /* lapped before the read: the frame is given up */
+  Arrive(RING + 20U);
+  EndFrame();
+  frames++;
+  CHECK_EQ(TakeFrame(), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RingOverflows, 1);
+  Taken = Sent;
+  /* lapped during the frame copy */
+  Arrive(10);
+  EndFrame();
+  frames++;
+  HostNdtReads = 0;
+  HostLapAt = 1;
+  CHECK_EQ(TakeFrame(), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RingOverflows, 2);
+  /* the stream read behind it skips the lapped bytes to the DMA position */
+  CHECK_EQ(USART1_RxDMA_Read(buf, 3), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RingOverflows, 3);
+  Taken = Sent;
+  /* lapped during the stream copy: skipped to the DMA position */
+  Arrive(10);
+  HostNdtReads = 0;
+  HostLapAt = 2;
+  CHECK_EQ(USART1_RxDMA_Read(buf, RING), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RingOverflows, 4);
+  Taken = Sent;
+  CHECK_EQ(USART1_RxDMA_Available(), 0);
+  /* nothing left behind or doubled after the laps */
+  Arrive(30);
+  EndFrame();
+  frames++;
+  CHECK_EQ(TakeFrame(), 30);
+  CHECK_EQ(TakeFrame(), 0);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.RxBytes, Sent);
+  CHECK_EQ(stats.Frames, frames);
+  CHECK_EQ(stats.RingOverflows, 4);
+  CHECK_EQ(Taken, Sent);
+  CHECK_EQ(BadBytes, 0);
+
+  /* DMA request off (LIN mode): the handler leaves the flags alone */
+  HostUsart1.CR3 = 0;
+  UsartIrq(USART_ISR_RTOF | USART_ISR_ORE);
+  USART1_RxDMA_GetStats(&stats);
+  CHECK_EQ(stats.OverrunErrors, 2);
+  CHECK_EQ(HostUsart1.ISR, USART_ISR_RTOF | USART_ISR_ORE);
+
+  return HOST_TEST_END();
+}
+
+/******************************** END OF FILE *********************************/
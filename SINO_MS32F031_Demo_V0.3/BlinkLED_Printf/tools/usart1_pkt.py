@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+USART1_PKT host client.
+
+Packet before COBS encoding (see USART1_PKT.h):
+    TYPE(1) SEQ(1) ID(1) PAYLOAD(0~48) CRC32(4, LSB first)
+CRC32 is the MS32 CRC unit: poly 0x04C11DB7, init 0xFFFFFFFF, no
+reflection, no final xor, over TYPE..PAYLOAD.  Every packet is COBS
+encoded and ends with 0x00.
+
+Usage:
+    usart1_pkt.py PORT ping [--baud 115200]
+    usart1_pkt.py PORT stats
+    usart1_pkt.py PORT bench [--rates 115200,1000000] [--seconds 5]
+    usart1_pkt.py selftest
+
+bench runs PING round trips at every rate, stepping the board up with
+USART1_BAUD_CMD_ID (0x10) and the 0x55 0x00 auto baud frames, and reports
+frames per second (request + response = 2 frames on the wire).
+Needs pyserial for a real port.
+"""
+
+import struct
+import sys
+import time
+
+TYPE_REQUEST = 0x01
+TYPE_RESPONSE = 0x02
+TYPE_TELEMETRY = 0x03
+TYPE_NAK = 0x04
+
+CMD_PING = 0x00
+CMD_RX_STATS = 0x01
+CMD_BAUD = 0x10
+
+MAX_PAYLOAD = 48
+
+RX_STATS_FIELDS = ("RxBytes", "Frames", "OverrunErrors", "RingOverflows",
+                   "FrameDrops", "FrameTruncations")
+
+
+def crc32_ms32(data):
+    crc = 0xFFFFFFFF
+    for b in data:
+        crc ^= b << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7) if (crc & 0x80000000) else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+def cobs_encode(raw):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for b in raw:
+        if b == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos = len(out)
+                out.append(0)
+                code = 1
+    out[code_pos] = code
+    out.append(0)
+    return bytes(out)
+
+
+def cobs_decode(enc):
+    out = bytearray()
+    i = 0
+    while i < len(enc):
+        code = enc[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(enc):
+            return None
+        out += enc[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(enc):
+            out.append(0)
+    return bytes(out)
+
+
+def build(ptype, seq, pid, payload=b""):
+    raw = bytes([ptype, seq & 0xFF, pid]) + bytes(payload)
+    return cobs_encode(raw + struct.pack("<I", crc32_ms32(raw)))
+
+
+def parse(enc):
+    """Encoded packet without the delimiter -> (type, seq, id, payload) or None"""
+    raw = cobs_decode(enc)
+    if raw is None or len(raw) < 7:
+        return None
+    body, crc = raw[:-4], struct.unpack("<I", raw[-4:])[0]
+    if crc32_ms32(body) != crc:
+        return None
+    return body[0], body[1], body[2], body[3:]
+
+
+class Client(object):
+    def __init__(self, port, timeout=0.2, retries=3):
+        self.port = port
+        self.timeout = timeout
+        self.retries = retries
+        self.seq = 0
+        self.acc = bytearray()
+        self.telemetry = 0
+        self.bad = 0
+
+    def _next_packet(self, deadline):
+        while True:
+            end = self.acc.find(b"\x00")
+            if end >= 0:
+                enc = bytes(self.acc[:end])
+                del self.acc[:end + 1]
+                if not enc:
+                    continue
+                pkt = parse(enc)
+                if pkt is None:
+                    self.bad += 1
+                    continue
+                return pkt
+            if time.monotonic() >= deadline:
+                return None
+            chunk = self.port.read(max(1, self.port.in_waiting))
+            self.acc += chunk
+
+    def request(self, pid, payload=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        frame = build(TYPE_REQUEST, self.seq, pid, payload)
+        for _ in range(self.retries):
+            # same SEQ on retry: the board answers from its response cache
+            self.port.write(frame)
+            deadline = time.monotonic() + self.timeout
+            while True:
+                pkt = self._next_packet(deadline)
+                if pkt is None:
+                    break
+                ptype, seq, rid, data = pkt
+                if ptype == TYPE_TELEMETRY:
+                    self.telemetry += 1
+                elif seq == self.seq and rid == pid:
+                    if ptype == TYPE_NAK:
+                        raise IOError("NAK 0x%02X for command 0x%02X" % (data[0], pid))
+                    return data
+        raise IOError("no response to command 0x%02X" % pid)
+
+    def set_baud(self, baud):
+        status = self.request(CMD_BAUD, struct.pack("<I", baud))
+        if status[0] != 0:
+            raise IOError("baud %d refused, status %d" % (baud, status[0]))
+        actual = struct.unpack("<I", status[1:5])[0]
+        # reply went out at the old rate, the board now waits for 0x55 0x00
+        time.sleep(0.01)
+        self.port.baudrate = baud
+        self.port.reset_input_buffer()
+        self.port.write(b"\x55\x00")
+        self.port.flush()
+        time.sleep(0.02)
+        return actual
+
+
+def bench(cli, rates, seconds):
+    payload = bytes(range(1, 17))
+    results = []
+    for rate in rates:
+        if rate != cli.port.baudrate:
+            cli.set_baud(rate)
+        cli.request(CMD_PING, payload)
+        count = 0
+        start = time.monotonic()
+        while time.monotonic() - start < seconds:
+            if cli.request(CMD_PING, payload) != payload:
+                raise IOError("ping payload mismatch")
+            count += 1
+        dt = time.monotonic() - start
+        results.append((rate, count / dt, 2 * count / dt))
+    for rate, rtt, fps in results:
+        print("%8d baud: %7.1f round trips/s, %7.1f frames/s" % (rate, rtt, fps))
+    return results
+
+
+def selftest():
+    class Loop(object):
+        """Board side echo of USART1_PKT, PING and RX_STATS only"""
+
+        def __init__(self):
+            self.baudrate = 115200
+            self.rx = bytearray()
+            self.tx = bytearray()
+            self.drop = 1
+
+        @property
+        def in_waiting(self):
+            return len(self.tx)
+
+        def write(self, data):
+            self.rx += data
+            while b"\x00" in self.rx:
+                end = self.rx.index(b"\x00")
+                enc, self.rx = bytes(self.rx[:end]), self.rx[end + 1:]
+                ptype, seq, pid, data = parse(enc)
+                if self.drop:
+                    self.drop -= 1
+                    continue
+                self.tx += build(TYPE_TELEMETRY, 0, 5, b"\x00\x01")
+                if pid == CMD_PING:
+                    self.tx += build(TYPE_RESPONSE, seq, pid, data)
+                else:
+                    self.tx += build(TYPE_NAK, seq, pid, b"\x01")
+
+        def read(self, n):
+            out, self.tx = bytes(self.tx[:n]), self.tx[n:]
+            return out
+
+    assert crc32_ms32(b"123456789") == 0x0376E6E7
+    for raw in (b"", b"\x00", b"\x11\x00\x00\x22", bytes(range(256)), b"\x01" * 300):
+        enc = cobs_encode(raw)
+        assert enc.count(b"\x00") == 1 and enc[-1] == 0
+        assert cobs_decode(enc[:-1]) == raw
+    # single block packets equal the in place encoder: code + raw + 0x00
+    assert cobs_encode(b"\x01\x00\x02") == b"\x02\x01\x02\x02\x00"
+    cli = Client(Loop(), timeout=0.01)
+    assert cli.request(CMD_PING, b"\x00abc\x00") == b"\x00abc\x00"
+    assert cli.telemetry == 1
+    try:
+        cli.request(0x7F)
+        assert False
+    except IOError:
+        pass
+    print("selftest passed")
+
+
+def main(argv):
+    if len(argv) >= 2 and argv[1] == "selftest":
+        selftest()
+        return 0
+    if len(argv) < 3:
+        print(__doc__)
+        return 1
+
+    import argparse
+    import serial
+
+    ap = argparse.ArgumentParser()
+    ap.add_argument("port")
+    ap.add_argument("command", choices=("ping", "stats", "bench"))
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--rates", default="115200,1000000")
+    ap.add_argument("--seconds", type=float, default=5.0)
+    args = ap.parse_args(argv[1:])
+
+    port = serial.Serial(args.port, args.baud, timeout=0)
+    cli = Client(port)
+    if args.command == "ping":
+        t = time.monotonic()
+        cli.request(CMD_PING, b"ping")
+        print("ping %.2f ms" % ((time.monotonic() - t) * 1000))
+    elif args.command == "stats":
+        data = cli.request(CMD_RX_STATS)
+        for name, value in zip(RX_STATS_FIELDS, struct.unpack("<%dI" % (len(data) // 4), data)):
+            print("%-16s %d" % (name, value))
+    else:
+        bench(cli, [int(r) for r in args.rates.split(",")], args.seconds)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -25,6 +25,11 @@ extern const uint8_t  APBPrescTable[8];    /*!< APB prescalers table values */
 extern void SystemInit            (void);
 extern void SystemCoreClockUpdate (void);
 
+/* Optional hooks of the project, SystemInit() calls the ones it defines.
+   They run before the scatter loading: registers and flash only, no RAM */
+extern void SystemInit_EarlyHook      (void);             /*!< SystemInit() entry */
+extern void SystemInit_ClockReadyHook (uint32_t TimerClk); /*!< SYSCLK switched, or HSE timeout */
+
 
 #ifdef __cplusplus
 }
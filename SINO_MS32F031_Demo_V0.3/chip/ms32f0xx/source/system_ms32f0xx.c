@@ -1,5 +1,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "ms32f0xx.h"
+/* clock plan of the project: CLOCK_PLAN_SOURCE, HCLK / PCLK targets */
+#include "CLOCK_PLAN.h"
 
 
 /* Private typedef -----------------------------------------------------------*/
@@ -10,22 +12,23 @@
 #endif /* HSE_VALUE */
 
 #if !defined  (HSI_VALUE)
-  #define HSI_VALUE    ((uint32_t)16000000) /*!< Default value of the Internal oscillator in Hz.
+  #define HSI_VALUE    ((uint32_t)8000000)  /*!< Default value of the Internal oscillator in Hz.
                                                 This value can be provided and adapted by the user application. */
 #endif /* HSI_VALUE */
 
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
-//uint32_t SystemCoreClock   = HSI_VALUE >> 1;
-
-uint32_t SystemCoreClock   = 48000000;
+uint32_t SystemCoreClock   = CLOCK_PLAN_HCLK_HZ;
 const uint8_t  AHBPrescTable[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9};
 const uint8_t  APBPrescTable[8]  = {0, 0, 0, 0, 1, 2, 3, 4};
 
-#define PLL_SOURCE_HSI        //cflcfl0915
 static void SetSysClock(void);//cflcfl0915
 
+/* weak references: a project without the hook links, SystemInit() skips it */
+extern __WEAK void SystemInit_EarlyHook(void);
+extern __WEAK void SystemInit_ClockReadyHook(uint32_t TimerClk);
+
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
@@ -37,6 +40,21 @@ static void SetSysClock(void);//cflcfl0915
   */
 void SystemInit (void) 
 {
+  /* project hook: startup time line, saved HSI trim */
+  if (SystemInit_EarlyHook != 0)
+  {
+    SystemInit_EarlyHook();
+  }
+
+  /* Fast path: clock tree still at its reset state (power on, pin or
+     software reset), the planned values are written directly */
+  if (((RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_HSI) &&
+      ((RCC->CR & (RCC_CR_PLLON | RCC_CR_HSEON)) == 0))
+  {
+    SetSysClock();
+    return;
+  }
+
   /* Set HSION bit */
   RCC->CR |= (uint32_t)0x00000001;
 
@@ -72,105 +90,61 @@ void SystemInit (void)
 }
 
 
+/**
+  * @brief  Switch SYSCLK to the CLOCK_PLAN.h result: wait states first, then
+  *         the final RCC_CFGR2 / RCC_CFGR values are written as a whole.
+  * @param  None
+  * @retval None
+  */
 static void SetSysClock(void)
 {
-  __IO uint32_t StartUpCounter = 0, HSEStatus = 0;
-  
-  /* SYSCLK, HCLK, PCLK configuration ----------------------------------------*/
-#if defined (PLL_SOURCE_HSI)
-  /* At this stage the HSI is already enabled */
-
-  /* Enable Prefetch Buffer and set Flash Latency */
-  FLASH->ACR = FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY;
- 
-  /* HCLK = SYSCLK */
-  RCC->CFGR |= (uint32_t)RCC_CFGR_HPRE_DIV1;
-      
-  /* PCLK = HCLK */
-  RCC->CFGR |= (uint32_t)RCC_CFGR_PPRE_DIV1;
-
-  /* PLL configuration = (HSI/2) * 12 = ~48 MHz */
-  RCC->CFGR &= (uint32_t)((uint32_t)~(RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE | ((uint32_t)0x003C0000)));
-  RCC->CFGR |= (uint32_t)(((uint32_t)0x00000000) | ((uint32_t)0x00000000) | ((uint32_t)0x00280000));
-            
-  /* Enable PLL */
-  RCC->CR |= RCC_CR_PLLON;
+#if CLOCK_PLAN_SOURCE != 0
+  uint32_t StartUpCounter = 0;
 
-  /* Wait till PLL is ready */
-  while((RCC->CR & RCC_CR_PLLRDY) == 0)
+  /* Enable HSE, wait till it is ready and if Time out is reached stay on HSI */
+  RCC->CR |= CLOCK_PLAN_CR_HSE;
+  while (((RCC->CR & RCC_CR_HSERDY) == 0) && (StartUpCounter < CLOCK_PLAN_HSE_TIMEOUT))
+  {
+    StartUpCounter++;
+  }
+  if ((RCC->CR & RCC_CR_HSERDY) == 0)
   {
+    RCC->CR &= ~CLOCK_PLAN_CR_HSE;
+    /* SystemCoreClock is not written here: the scatter loading after
+       SystemInit() sets it back to CLOCK_PLAN_HCLK_HZ, main() reads the
+       running clock tree with SystemCoreClockUpdate() */
+    if (SystemInit_ClockReadyHook != 0)
+    {
+      SystemInit_ClockReadyHook(HSI_VALUE);
+    }
+    return;
   }
+#endif
+
+  /* SYSCLK only goes up from HSI here: Flash latency before the switch */
+  FLASH->ACR = CLOCK_PLAN_ACR;
 
-  /* Select PLL as system clock source */
-  RCC->CFGR &= (uint32_t)((uint32_t)~(RCC_CFGR_SW));
-  RCC->CFGR |= (uint32_t)RCC_CFGR_SW_PLL;    
+  /* PLL source, multiplier, predivider and bus prescalers, SW still HSI */
+  RCC->CFGR2 = CLOCK_PLAN_CFGR2;
+  RCC->CFGR = CLOCK_PLAN_CFGR;
 
-  /* Wait till PLL is used as system clock source */
-  while ((RCC->CFGR & (uint32_t)RCC_CFGR_SWS) != (uint32_t)RCC_CFGR_SWS_PLL)
+#if CLOCK_PLAN_USE_PLL
+  /* Enable PLL and wait till it is ready */
+  RCC->CR |= RCC_CR_PLLON;
+  while ((RCC->CR & RCC_CR_PLLRDY) == 0)
   {
   }
-#else
- #if defined (PLL_SOURCE_HSE)
-  /* Enable HSE */    
-  RCC->CR |= ((uint32_t)RCC_CR_HSEON);
- #elif defined (PLL_SOURCE_HSE_BYPASS)
-  /* HSE oscillator bypassed with external clock */    
-  RCC->CR |= (uint32_t)(RCC_CR_HSEON | RCC_CR_HSEBYP);
- #endif /* PLL_SOURCE_HSE */
-   
-  /* Wait till HSE is ready and if Time out is reached exit */
-  do
-  {
-    HSEStatus = RCC->CR & RCC_CR_HSERDY;
-    StartUpCounter++;  
-  } while((HSEStatus == 0) && (StartUpCounter != HSE_STARTUP_TIMEOUT));
+#endif
 
-  if ((RCC->CR & RCC_CR_HSERDY) != RESET)
+  /* Select the planned system clock source and wait till it is used */
+  RCC->CFGR = CLOCK_PLAN_CFGR | CLOCK_PLAN_SW;
+  while ((RCC->CFGR & (uint32_t)RCC_CFGR_SWS) != CLOCK_PLAN_SWS)
   {
-    HSEStatus = (uint32_t)0x01;
   }
-  else
-  {
-    HSEStatus = (uint32_t)0x00;
-  }  
-
-  if (HSEStatus == (uint32_t)0x01)
+  if (SystemInit_ClockReadyHook != 0)
   {
-    /* Enable Prefetch Buffer and set Flash Latency */
-    FLASH->ACR = FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY;
- 
-    /* HCLK = SYSCLK */
-    RCC->CFGR |= (uint32_t)RCC_CFGR_HPRE_DIV1;
-      
-    /* PCLK = HCLK */
-    RCC->CFGR |= (uint32_t)RCC_CFGR_PPRE_DIV1;
-
-    /* PLL configuration = HSE * 6 = 48 MHz */
-    RCC->CFGR &= (uint32_t)((uint32_t)~(RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE | RCC_CFGR_PLLMULL));
-    RCC->CFGR |= (uint32_t)(RCC_CFGR_PLLSRC_PREDIV1 | RCC_CFGR_PLLXTPRE_PREDIV1 | RCC_CFGR_PLLMULL6);
-            
-    /* Enable PLL */
-    RCC->CR |= RCC_CR_PLLON;
-
-    /* Wait till PLL is ready */
-    while((RCC->CR & RCC_CR_PLLRDY) == 0)
-    {
-    }
-
-    /* Select PLL as system clock source */
-    RCC->CFGR &= (uint32_t)((uint32_t)~(RCC_CFGR_SW));
-    RCC->CFGR |= (uint32_t)RCC_CFGR_SW_PLL;    
-
-    /* Wait till PLL is used as system clock source */
-    while ((RCC->CFGR & (uint32_t)RCC_CFGR_SWS) != (uint32_t)RCC_CFGR_SWS_PLL)
-    {
-    }
+    SystemInit_ClockReadyHook(CLOCK_PLAN_TIMCLK_HZ);
   }
-  else
-  { /* If HSE fails to start-up, the application will have wrong clock 
-         configuration. User can add here some code to deal with this error */
-  }  
-#endif /* PLL_SOURCE_HSI */  
 }
 /**
    * @brief  Update SystemCoreClock variable according to Clock Register Values.
@@ -188,7 +162,7 @@ void SystemCoreClockUpdate (void) {
 
   switch (tmp) {
     case RCC_CFGR_SWS_HSI:  /* HSI used as system clock */
-      SystemCoreClock = HSI_VALUE >> 1;
+      SystemCoreClock = HSI_VALUE;
       break;
     case RCC_CFGR_SWS_HSE:  /* HSE used as system clock */
       SystemCoreClock = HSE_VALUE;
@@ -198,18 +172,23 @@ void SystemCoreClockUpdate (void) {
       pllmull = RCC->CFGR & RCC_CFGR_PLLMUL;
       pllsource = RCC->CFGR & RCC_CFGR_PLLSRC;
       pllmull = ( pllmull >> 18) + 2;
+      if (pllmull > 16) {
+        /* PLLMUL 1111 is x16 as 1110 */
+        pllmull = 16;
+      }
       predivfactor = (RCC->CFGR2 & RCC_CFGR2_PREDIV) + 1;
 
       if (pllsource == RCC_CFGR_PLLSRC_HSE_PREDIV) {
-        /* HSE used as PLL clock source : SystemCoreClock = HSE/PREDIV * PLLMUL */
-        SystemCoreClock = (HSE_VALUE / predivfactor) * pllmull;
+        /* HSE used as PLL clock source : SystemCoreClock = HSE/PREDIV * PLLMUL,
+           multiplied first: HSE/PREDIV is not always a whole Hz */
+        SystemCoreClock = (HSE_VALUE * pllmull) / predivfactor;
       } else {
         /* HSI used as PLL clock source : SystemCoreClock = HSI/2 * PLLMUL */
-        SystemCoreClock = ((HSI_VALUE >> 1) >> 1) * pllmull;
+        SystemCoreClock = (HSI_VALUE >> 1) * pllmull;
       }
       break;
     default: /* HSI used as system clock */
-      SystemCoreClock = HSI_VALUE >> 1;
+      SystemCoreClock = HSI_VALUE;
       break;
   }
   /* Compute HCLK clock frequency ----------------*/
@@ -192,9 +192,9 @@ ErrorStatus MS32_FLASH_Write(uint32_t addr, uint8_t *dat_buf, uint32_t len) {
     for (index = 0; index < len; index += 2) {
       /* need fill up '0xFF' when length is odd number */
       if ((index + 2) > len) {
-        TYPE16(addr) = 0xFF00 | ((uint16_t)(*(dat_buf + index)));
+        TYPE16(addr + index) = 0xFF00 | ((uint16_t)(*(dat_buf + index)));
       } else {
-        TYPE16(addr) = ((uint16_t)(*(dat_buf + index + 1))) << 8 | ((uint16_t)(*(dat_buf + index)));
+        TYPE16(addr + index) = ((uint16_t)(*(dat_buf + index + 1))) << 8 | ((uint16_t)(*(dat_buf + index)));
       }
       while (READ_BIT(FLASH->SR, FLASH_SR_BSY));
     }